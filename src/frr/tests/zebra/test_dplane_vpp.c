@@ -0,0 +1,538 @@
+/*
+ * VPP dataplane provider tests.
+ * Copyright (C) 2022 Cisco and/or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * The provider programs a running VPP, whose API segment prefix is the
+ * optional argument, and the routes are read back with ip_route_lookup.
+ */
+
+#include "zebra/dplane_vpp.c"
+
+#define TEST_TIMEOUT_SECS 5
+#define TEST_MAX_PATHS 4
+
+/*
+ * Shim out the zebra dataplane: the test is the dataplane pthread, and the
+ * contexts carry what the provider reads.
+ */
+DEFINE_MGROUP(ZEBRA, "zebra");
+unsigned long zebra_debug_dplane;
+struct zebra_router zrouter;
+
+struct zebra_dplane_ctx {
+	enum dplane_op_e op;
+	enum zebra_dplane_result status;
+	struct prefix dest;
+	uint32_t table;
+	struct nexthop_group ng;
+
+	TAILQ_ENTRY(zebra_dplane_ctx) entries;
+};
+
+struct zebra_dplane_provider {
+	void *data;
+	struct dplane_ctx_q inq;
+	struct dplane_ctx_q outq;
+	uint32_t out_len;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+} test_prov;
+
+struct zebra_dplane_ctx *dplane_ctx_alloc(void)
+{
+	return calloc(1, sizeof(struct zebra_dplane_ctx));
+}
+
+void dplane_ctx_reset(struct zebra_dplane_ctx *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+}
+
+void dplane_ctx_fini(struct zebra_dplane_ctx **pctx)
+{
+	nexthops_free((*pctx)->ng.nexthop);
+	free(*pctx);
+	*pctx = NULL;
+}
+
+int dplane_ctx_route_init(struct zebra_dplane_ctx *ctx, enum dplane_op_e op,
+			  struct route_node *rn, struct route_entry *re)
+{
+	return 0;
+}
+
+void dplane_ctx_enqueue_tail(struct dplane_ctx_q *q,
+			     const struct zebra_dplane_ctx *ctx)
+{
+	TAILQ_INSERT_TAIL(q, (struct zebra_dplane_ctx *)ctx, entries);
+}
+
+struct zebra_dplane_ctx *dplane_ctx_dequeue(struct dplane_ctx_q *q)
+{
+	struct zebra_dplane_ctx *ctx = TAILQ_FIRST(q);
+
+	if (ctx)
+		TAILQ_REMOVE(q, ctx, entries);
+	return ctx;
+}
+
+enum dplane_op_e dplane_ctx_get_op(const struct zebra_dplane_ctx *ctx)
+{
+	return ctx->op;
+}
+
+enum zebra_dplane_result dplane_ctx_get_status(
+	const struct zebra_dplane_ctx *ctx)
+{
+	return ctx->status;
+}
+
+void dplane_ctx_set_status(struct zebra_dplane_ctx *ctx,
+			   enum zebra_dplane_result status)
+{
+	ctx->status = status;
+}
+
+const struct prefix *dplane_ctx_get_dest(const struct zebra_dplane_ctx *ctx)
+{
+	return &ctx->dest;
+}
+
+const struct prefix *dplane_ctx_get_src(const struct zebra_dplane_ctx *ctx)
+{
+	return NULL;
+}
+
+uint32_t dplane_ctx_get_table(const struct zebra_dplane_ctx *ctx)
+{
+	return ctx->table;
+}
+
+const struct nexthop_group *dplane_ctx_get_ng(
+	const struct zebra_dplane_ctx *ctx)
+{
+	return &ctx->ng;
+}
+
+ifindex_t dplane_ctx_get_ifindex(const struct zebra_dplane_ctx *ctx)
+{
+	return IFINDEX_INTERNAL;
+}
+
+const struct ipaddr *dplane_ctx_neigh_get_ipaddr(
+	const struct zebra_dplane_ctx *ctx)
+{
+	static const struct ipaddr ip;
+
+	return &ip;
+}
+
+const struct ethaddr *dplane_ctx_neigh_get_mac(
+	const struct zebra_dplane_ctx *ctx)
+{
+	static const struct ethaddr mac;
+
+	return &mac;
+}
+
+int dplane_provider_register(const char *name,
+			     enum dplane_provider_prio prio,
+			     int flags,
+			     int (*start_fp)(struct zebra_dplane_provider *),
+			     int (*fp)(struct zebra_dplane_provider *),
+			     int (*fini_fp)(struct zebra_dplane_provider *,
+					    bool early),
+			     void *data,
+			     struct zebra_dplane_provider **prov_p)
+{
+	return 0;
+}
+
+void *dplane_provider_get_data(const struct zebra_dplane_provider *prov)
+{
+	return prov->data;
+}
+
+int dplane_provider_get_work_limit(const struct zebra_dplane_provider *prov)
+{
+	return 100;
+}
+
+int dplane_provider_work_ready(void)
+{
+	return 0;
+}
+
+uint32_t dplane_provider_out_ctx_queue_len(struct zebra_dplane_provider *prov)
+{
+	return 0;
+}
+
+struct zebra_dplane_ctx *dplane_provider_dequeue_in_ctx(
+	struct zebra_dplane_provider *prov)
+{
+	return dplane_ctx_dequeue(&prov->inq);
+}
+
+void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
+				     struct zebra_dplane_ctx *ctx)
+{
+	frr_with_mutex (&prov->mutex) {
+		dplane_ctx_enqueue_tail(&prov->outq, ctx);
+		prov->out_len++;
+		pthread_cond_signal(&prov->cond);
+	}
+}
+
+struct route_table *rib_tables_iter_next(rib_tables_iter_t *iter)
+{
+	/* the RIB is empty, nothing is replayed */
+	return NULL;
+}
+
+/* helpers */
+
+static struct timespec test_deadline(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += TEST_TIMEOUT_SECS;
+	return ts;
+}
+
+static struct zebra_dplane_ctx *route_ctx(enum dplane_op_e op,
+					  const char *prefix, uint32_t table,
+					  const char *gw1, const char *gw2)
+{
+	const char *gws[] = {gw1, gw2};
+	struct zebra_dplane_ctx *ctx;
+	struct nexthop *nh, **tail;
+	union g_addr gate;
+	unsigned int ii;
+
+	ctx = dplane_ctx_alloc();
+	ctx->op = op;
+	ctx->status = ZEBRA_DPLANE_REQUEST_SUCCESS;
+	ctx->table = table;
+	assert(str2prefix(prefix, &ctx->dest));
+
+	tail = &ctx->ng.nexthop;
+	for (ii = 0; ii < array_size(gws) && gws[ii]; ii++) {
+		if (ctx->dest.family == AF_INET) {
+			assert(inet_pton(AF_INET, gws[ii], &gate.ipv4) == 1);
+			nh = nexthop_from_ipv4(&gate.ipv4, NULL, VRF_DEFAULT);
+		} else {
+			assert(inet_pton(AF_INET6, gws[ii], &gate.ipv6) == 1);
+			nh = nexthop_from_ipv6(&gate.ipv6, VRF_DEFAULT);
+		}
+		SET_FLAG(nh->flags, NEXTHOP_FLAG_ACTIVE);
+		*tail = nh;
+		tail = &nh->next;
+	}
+
+	return ctx;
+}
+
+/*
+ * Hand the contexts to the provider as the dataplane pthread does, and
+ * wait for all of them to come back.
+ */
+static void process(struct zebra_dplane_ctx **ctxs, unsigned int n_ctxs)
+{
+	struct timespec deadline = test_deadline();
+	struct zebra_dplane_ctx *ctx;
+	unsigned int ii;
+
+	for (ii = 0; ii < n_ctxs; ii++)
+		dplane_ctx_enqueue_tail(&test_prov.inq, ctxs[ii]);
+	dplane_vpp_process(&test_prov);
+
+	frr_with_mutex (&test_prov.mutex) {
+		while (test_prov.out_len < n_ctxs)
+			assert(pthread_cond_timedwait(&test_prov.cond,
+						      &test_prov.mutex,
+						      &deadline)
+			       == 0);
+		while ((ctx = dplane_ctx_dequeue(&test_prov.outq)))
+			test_prov.out_len--;
+	}
+}
+
+struct route_lookup {
+	struct prefix p;
+	uint32_t table;
+
+	bool done;
+	int n_paths;
+	vapi_union_address_union gates[TEST_MAX_PATHS];
+};
+
+static vapi_error_e
+route_lookup_reply(vapi_ctx_t vapi, void *arg, vapi_error_e rv, bool is_last,
+		   vapi_payload_ip_route_lookup_reply *reply)
+{
+	struct route_lookup *lk = arg;
+	int ii;
+
+	frr_with_mutex (&test_prov.mutex) {
+		lk->n_paths = -1;
+		if (rv == VAPI_OK && reply->retval == 0) {
+			lk->n_paths = reply->route.n_paths;
+			for (ii = 0; ii < lk->n_paths && ii < TEST_MAX_PATHS;
+			     ii++)
+				lk->gates[ii] = reply->route.paths[ii].nh.address;
+		}
+		lk->done = true;
+		pthread_cond_signal(&test_prov.cond);
+	}
+
+	return VAPI_OK;
+}
+
+/* runs in the provider pthread, which owns the API connection */
+static int route_lookup_send(struct thread *t)
+{
+	struct route_lookup *lk = THREAD_ARG(t);
+	vapi_msg_ip_route_lookup *mp;
+
+	mp = vapi_alloc_ip_route_lookup(gdv->vapi);
+	assert(mp);
+	mp->payload.table_id = dplane_vpp_table_id(lk->table);
+	mp->payload.exact = 1;
+	dplane_vpp_prefix_encode(&lk->p, &mp->payload.prefix);
+	assert(vapi_ip_route_lookup(gdv->vapi, mp, route_lookup_reply, lk)
+	       == VAPI_OK);
+
+	return 0;
+}
+
+/*
+ * The paths VPP has for a route, -1 if it has no such route. If gw is set,
+ * it must be one of the paths.
+ */
+static int route_lookup(const char *prefix, uint32_t table, const char *gw)
+{
+	struct timespec deadline = test_deadline();
+	struct route_lookup lk = {.table = table};
+	union g_addr gate;
+	bool found = false;
+	int ii;
+
+	assert(str2prefix(prefix, &lk.p));
+	thread_add_event(gdv->fthread->master, route_lookup_send, &lk, 0,
+			 NULL);
+
+	frr_with_mutex (&test_prov.mutex) {
+		while (!lk.done)
+			assert(pthread_cond_timedwait(&test_prov.cond,
+						      &test_prov.mutex,
+						      &deadline)
+			       == 0);
+	}
+
+	if (gw == NULL || lk.n_paths < 0)
+		return lk.n_paths;
+
+	memset(&gate, 0, sizeof(gate));
+	assert(inet_pton(lk.p.family, gw, &gate) == 1);
+	for (ii = 0; ii < lk.n_paths && ii < TEST_MAX_PATHS; ii++)
+		if (!memcmp(&lk.gates[ii], &gate,
+			    lk.p.family == AF_INET ? 4 : 16))
+			found = true;
+	assert(found);
+
+	return lk.n_paths;
+}
+
+/* tests */
+
+static void test_install(void)
+{
+	struct zebra_dplane_ctx *ctxs[2];
+
+	ctxs[0] = route_ctx(DPLANE_OP_ROUTE_INSTALL, "10.99.1.0/24", 0,
+			    "192.0.2.1", NULL);
+	ctxs[1] = route_ctx(DPLANE_OP_ROUTE_INSTALL, "2001:db8:99::/64", 0,
+			    "2001:db8::1", "2001:db8::2");
+	process(ctxs, 2);
+	assert(ctxs[0]->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	assert(ctxs[1]->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	dplane_ctx_fini(&ctxs[0]);
+	dplane_ctx_fini(&ctxs[1]);
+
+	assert(route_lookup("10.99.1.0/24", 0, "192.0.2.1") == 1);
+	assert(route_lookup("2001:db8:99::/64", 0, "2001:db8::2") == 2);
+	printf("install: ok\n");
+}
+
+static void test_replace(void)
+{
+	struct zebra_dplane_ctx *ctx;
+
+	/* an update replaces the paths, it doesn't add to them */
+	ctx = route_ctx(DPLANE_OP_ROUTE_UPDATE, "10.99.1.0/24", 0,
+			"192.0.2.2", "192.0.2.3");
+	process(&ctx, 1);
+	assert(ctx->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	dplane_ctx_fini(&ctx);
+
+	assert(route_lookup("10.99.1.0/24", 0, "192.0.2.2") == 2);
+	assert(route_lookup("10.99.1.0/24", 0, "192.0.2.3") == 2);
+	printf("replace: ok\n");
+}
+
+static void test_replace_twice(void)
+{
+	struct zebra_dplane_ctx *ctxs[2];
+
+	/*
+	 * VPP merges the adjacent entries of a route in a request: the two
+	 * updates must not end up as one route with the paths of both.
+	 */
+	ctxs[0] = route_ctx(DPLANE_OP_ROUTE_UPDATE, "10.99.1.0/24", 0,
+			    "192.0.2.4", "192.0.2.5");
+	ctxs[1] = route_ctx(DPLANE_OP_ROUTE_UPDATE, "10.99.1.0/24", 0,
+			    "192.0.2.6", NULL);
+	process(ctxs, 2);
+	assert(ctxs[0]->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	assert(ctxs[1]->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	dplane_ctx_fini(&ctxs[0]);
+	dplane_ctx_fini(&ctxs[1]);
+
+	assert(route_lookup("10.99.1.0/24", 0, "192.0.2.6") == 1);
+	printf("replace twice: ok\n");
+}
+
+static void test_delete(void)
+{
+	struct zebra_dplane_ctx *ctxs[2];
+
+	ctxs[0] = route_ctx(DPLANE_OP_ROUTE_DELETE, "10.99.1.0/24", 0, NULL,
+			    NULL);
+	ctxs[1] = route_ctx(DPLANE_OP_ROUTE_DELETE, "2001:db8:99::/64", 0,
+			    NULL, NULL);
+	process(ctxs, 2);
+	assert(ctxs[0]->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	assert(ctxs[1]->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	dplane_ctx_fini(&ctxs[0]);
+	dplane_ctx_fini(&ctxs[1]);
+
+	assert(route_lookup("10.99.1.0/24", 0, NULL) == -1);
+	assert(route_lookup("2001:db8:99::/64", 0, NULL) == -1);
+	printf("delete: ok\n");
+}
+
+static void test_error(void)
+{
+	struct zebra_dplane_ctx *ctxs[3];
+
+	/*
+	 * VPP has no table 4242: the delete in it fails, the routes before
+	 * and after it in the same request don't.
+	 */
+	ctxs[0] = route_ctx(DPLANE_OP_ROUTE_INSTALL, "10.99.2.0/24", 0,
+			    "192.0.2.1", NULL);
+	ctxs[1] = route_ctx(DPLANE_OP_ROUTE_DELETE, "10.99.3.0/24", 4242,
+			    NULL, NULL);
+	ctxs[2] = route_ctx(DPLANE_OP_ROUTE_INSTALL, "10.99.4.0/24", 0,
+			    "192.0.2.1", NULL);
+	process(ctxs, 3);
+	assert(ctxs[0]->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	assert(ctxs[1]->status == ZEBRA_DPLANE_REQUEST_FAILURE);
+	assert(ctxs[2]->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	dplane_ctx_fini(&ctxs[0]);
+	dplane_ctx_fini(&ctxs[1]);
+	dplane_ctx_fini(&ctxs[2]);
+
+	assert(route_lookup("10.99.2.0/24", 0, "192.0.2.1") == 1);
+	assert(route_lookup("10.99.4.0/24", 0, "192.0.2.1") == 1);
+
+	/* a path VPP refuses fails the whole request */
+	ctxs[0] = route_ctx(DPLANE_OP_ROUTE_DELETE, "10.99.2.0/24", 0, NULL,
+			    NULL);
+	ctxs[1] = route_ctx(DPLANE_OP_ROUTE_INSTALL, "10.99.3.0/24", 4242,
+			    "192.0.2.1", NULL);
+	process(ctxs, 2);
+	assert(ctxs[0]->status == ZEBRA_DPLANE_REQUEST_FAILURE);
+	assert(ctxs[1]->status == ZEBRA_DPLANE_REQUEST_FAILURE);
+	dplane_ctx_fini(&ctxs[0]);
+	dplane_ctx_fini(&ctxs[1]);
+
+	assert(route_lookup("10.99.2.0/24", 0, "192.0.2.1") == 1);
+	assert(atomic_load_explicit(&gdv->counters.route_errors,
+				    memory_order_relaxed)
+	       == 3);
+
+	ctxs[0] = route_ctx(DPLANE_OP_ROUTE_DELETE, "10.99.2.0/24", 0, NULL,
+			    NULL);
+	ctxs[1] = route_ctx(DPLANE_OP_ROUTE_DELETE, "10.99.4.0/24", 0, NULL,
+			    NULL);
+	process(ctxs, 2);
+	assert(ctxs[0]->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	assert(ctxs[1]->status == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	dplane_ctx_fini(&ctxs[0]);
+	dplane_ctx_fini(&ctxs[1]);
+	printf("error: ok\n");
+}
+
+int main(int argc, char **argv)
+{
+	struct thread_master *master;
+	int ii;
+
+	frr_pthread_init();
+	master = thread_master_create(NULL);
+	zrouter.master = master;
+
+	TAILQ_INIT(&test_prov.inq);
+	TAILQ_INIT(&test_prov.outq);
+	pthread_mutex_init(&test_prov.mutex, NULL);
+	pthread_cond_init(&test_prov.cond, NULL);
+
+	gdv = calloc(1, sizeof(*gdv));
+	gdv->batch_size = VPP_BATCH_SIZE_DEFAULT;
+	test_prov.data = gdv;
+	assert(dplane_vpp_start(&test_prov) == 0);
+
+	if (argc > 1)
+		strlcpy(gdv->api_prefix, argv[1], sizeof(gdv->api_prefix));
+	gdv->enabled = true;
+	thread_add_event(gdv->fthread->master, dplane_vpp_process_event, gdv,
+			 DVE_CONNECT, &gdv->t_event);
+	for (ii = 0; ii < TEST_TIMEOUT_SECS * 10; ii++) {
+		if (atomic_load_explicit(&gdv->connected,
+					 memory_order_relaxed))
+			break;
+		usleep(100000);
+	}
+	assert(atomic_load_explicit(&gdv->connected, memory_order_relaxed));
+
+	test_install();
+	test_replace();
+	test_replace_twice();
+	test_delete();
+	test_error();
+
+	dplane_vpp_finish(&test_prov, true);
+	dplane_vpp_finish(&test_prov, false);
+	thread_master_free(master);
+	frr_pthread_finish();
+	return 0;
+}
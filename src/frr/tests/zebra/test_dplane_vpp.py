@@ -0,0 +1,30 @@
+import inspect
+import os
+import subprocess
+import pytest
+import frrtest
+
+# The test programs the VPP found at this API segment prefix
+vpp_prefix = os.environ.get("VPP_API_PREFIX", "")
+vpp_segment = "/dev/shm/%svpe-api" % (vpp_prefix + "-" if vpp_prefix else "")
+
+
+class TestDplaneVpp(object):
+    program = "./test_dplane_vpp"
+
+    @pytest.mark.skipif(
+        'S["VPP_DPLANE_TRUE"]=""\n' not in open("../config.status").readlines(),
+        reason="VPP dataplane not enabled",
+    )
+    @pytest.mark.skipif(not os.path.exists(vpp_segment), reason="VPP not running")
+    def test_exits_cleanly(self):
+        basedir = os.path.dirname(inspect.getsourcefile(type(self)))
+        program = os.path.join(basedir, self.program)
+        args = [frrtest.binpath(program)]
+        if vpp_prefix:
+            args.append(vpp_prefix)
+        proc = subprocess.Popen(args, stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        output, _ = proc.communicate()
+        self.exitcode = proc.wait()
+        if self.exitcode != 0:
+            raise frrtest.TestExitNonzero(self)
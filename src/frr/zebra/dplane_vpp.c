@@ -0,0 +1,1562 @@
+/*
+ * Zebra dataplane plugin programming the VPP FIB over the VPP binary API.
+ *
+ * Copyright (C) 2022 Cisco and/or its affiliates.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * The provider runs after the kernel provider. The route updates the
+ * kernel accepted are batched into ip_route_add_del_bulk requests and the
+ * neighbor updates are sent as ip_neighbor_add_del requests. Both are
+ * sent without waiting for the replies: a context is handed back to the
+ * dataplane when the reply for it arrives, with the status VPP returned.
+ *
+ * Kernel interface indices are translated to VPP interfaces with the
+ * linux-cp interface pairs, which are read when the connection to VPP
+ * comes up and again when a route uses an unknown interface.
+ *
+ * The API has no file descriptor to poll: a waiter pthread blocks on the
+ * API queue and signals an eventfd the provider pthread reads, and the
+ * provider answers one message each time.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h" /* Include this explicitly */
+#endif
+
+#include <sys/eventfd.h>
+
+#include <vapi/vapi.h>
+#include <vapi/memclnt.api.vapi.h>
+#include <vapi/vpe.api.vapi.h>
+#include <vapi/ip.api.vapi.h>
+#include <vapi/ip_neighbor.api.vapi.h>
+#include <vapi/lcp.api.vapi.h>
+
+#include "lib/zebra.h"
+#include "lib/libfrr.h"
+#include "lib/frratomic.h"
+#include "lib/command.h"
+#include "lib/memory.h"
+#include "lib/monotime.h"
+#include "lib/frr_pthread.h"
+#include "zebra/debug.h"
+#include "zebra/rib.h"
+#include "zebra/zebra_dplane.h"
+#include "zebra/zebra_router.h"
+
+DEFINE_VAPI_MSG_IDS_VPE_API_JSON;
+DEFINE_VAPI_MSG_IDS_IP_API_JSON;
+DEFINE_VAPI_MSG_IDS_IP_NEIGHBOR_API_JSON;
+DEFINE_VAPI_MSG_IDS_LCP_API_JSON;
+
+DEFINE_MTYPE_STATIC(ZEBRA, VPP_BATCH, "VPP dataplane route batch");
+DEFINE_MTYPE_STATIC(ZEBRA, VPP_ITF_MAP, "VPP dataplane interface map");
+
+/* The paths a batch can carry, see ip_route_add_del_bulk */
+#define VPP_BATCH_PATHS 16
+#define VPP_BATCH_SIZE_DEFAULT 1024
+#define VPP_BATCH_SIZE_MAX 8192
+/* Requests sent and not yet answered */
+#define VPP_MAX_OUTSTANDING 64
+#define VPP_RECONNECT_SECS 3
+/* VNET_API_ERROR_EAGAIN: the details stopped, continue from the cursor */
+#define VPP_API_ERROR_EAGAIN -165
+
+static const char *prov_name = "dplane_vpp";
+
+/*
+ * A bulk route request being built or waiting for its reply. The routes
+ * replayed after a connect have no context to complete.
+ */
+struct vpp_route_batch {
+	TAILQ_ENTRY(vpp_route_batch) entries;
+
+	struct dplane_vpp *dv;
+
+	vapi_type_fib_path paths[VPP_BATCH_PATHS];
+	uint8_t n_paths;
+
+	vapi_type_ip_route_bulk_entry *routes;
+	uint32_t n_routes;
+	uint32_t max_routes;
+
+	/* the context of each route and its first entry in routes */
+	struct vpp_batch_ctx {
+		struct zebra_dplane_ctx *ctx;
+		uint32_t first_route;
+	} *ctxs;
+	uint32_t n_ctxs;
+
+	struct timeval sent;
+};
+
+TAILQ_HEAD(vpp_batch_q, vpp_route_batch);
+
+struct dplane_vpp {
+	/* configuration */
+	bool enabled;
+	char api_prefix[64];
+	uint32_t batch_size;
+
+	/* written by the provider pthread only */
+	atomic_bool connected;
+
+	/* owned by the provider pthread */
+	vapi_ctx_t vapi;
+	struct vpp_route_batch *batch;
+	struct vpp_batch_q sendq;
+	/* the requests sent, VPP answers them in order */
+	struct vpp_batch_q inflightq;
+	struct dplane_ctx_q neighq;
+	uint32_t outstanding;
+	/* a route used an unknown interface, also set by the RIB walk */
+	atomic_bool itf_stale;
+	/* the map is being read */
+	bool itf_reading;
+	uint32_t itf_cursor;
+
+	/* VPP sw_if_index of a kernel ifindex, ~0 if none */
+	uint32_t *itf_map;
+	uint32_t itf_map_len;
+	pthread_mutex_t itf_mutex;
+
+	/* contexts from the dataplane, and batches replayed from the RIB */
+	struct dplane_ctx_q ctxqueue;
+	struct vpp_batch_q replayq;
+	pthread_mutex_t queue_mutex;
+
+	/*
+	 * The waiter signals wait_fd when a message is queued, then waits
+	 * to be armed again once the provider dispatched it.
+	 */
+	pthread_t wait_thread;
+	bool wait_running;
+	int wait_fd;
+	bool wait_armed;
+	bool wait_stop;
+	pthread_mutex_t wait_mutex;
+	pthread_cond_t wait_cond;
+
+	/* start of the current busy period */
+	struct timeval busy_start;
+	uint32_t busy_routes;
+
+	struct zebra_dplane_provider *prov;
+	struct frr_pthread *fthread;
+	struct thread *t_connect;
+	struct thread *t_dequeue;
+	struct thread *t_read;
+	struct thread *t_event;
+	struct thread *t_ribwalk;
+
+	struct {
+		/* Contexts received from the dataplane. */
+		_Atomic uint32_t dplane_contexts;
+		/* Contexts waiting for a batch or a reply. */
+		_Atomic uint32_t ctxqueue_len;
+		_Atomic uint32_t ctxqueue_len_peak;
+		/* Routes and neighbors sent, and the ones VPP refused. */
+		_Atomic uint32_t routes;
+		_Atomic uint32_t route_errors;
+		_Atomic uint32_t neighbors;
+		_Atomic uint32_t neighbor_errors;
+		/* Routes sent by the RIB walk after a connect. */
+		_Atomic uint32_t replayed_routes;
+		/* Bulk requests and their round trip time. */
+		_Atomic uint32_t batches;
+		_Atomic uint32_t batch_usec_last;
+		_Atomic uint32_t batch_usec_max;
+		/* Requests queued because too many were outstanding. */
+		_Atomic uint32_t outstanding_full;
+		/* The last time the queues drained after being busy. */
+		_Atomic uint32_t converge_usec_last;
+		_Atomic uint32_t converge_routes_last;
+		/* Connection events. */
+		_Atomic uint32_t connects;
+		_Atomic uint32_t connection_errors;
+	} counters;
+} *gdv;
+
+enum dplane_vpp_events {
+	/* (Re)connect with the current configuration. */
+	DVE_CONNECT,
+	/* Disconnect and stop programming VPP. */
+	DVE_DISABLE,
+	/* Reset counters. */
+	DVE_RESET_COUNTERS,
+	/* A batch of replayed routes was queued. */
+	DVE_REPLAY,
+};
+
+static int dplane_vpp_process_event(struct thread *t);
+static int dplane_vpp_connect(struct thread *t);
+static int dplane_vpp_read(struct thread *t);
+static int dplane_vpp_process_queue(struct thread *t);
+static int dplane_vpp_rib_send(struct thread *t);
+
+/*
+ * CLI.
+ */
+#define VPP_STR "VPP data plane configuration\n"
+
+DEFUN(vpp_connect, vpp_connect_cmd,
+      "vpp connect [api-prefix WORD]",
+      VPP_STR
+      "Program the VPP FIB\n"
+      "Shared memory prefix of the VPP API segment\n"
+      "Prefix\n")
+{
+	int idx = 0;
+
+	if (argv_find(argv, argc, "WORD", &idx))
+		strlcpy(gdv->api_prefix, argv[idx]->arg,
+			sizeof(gdv->api_prefix));
+	else
+		gdv->api_prefix[0] = '\0';
+
+	gdv->enabled = true;
+	thread_add_event(gdv->fthread->master, dplane_vpp_process_event, gdv,
+			 DVE_CONNECT, &gdv->t_event);
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_vpp_connect, no_vpp_connect_cmd,
+      "no vpp connect [api-prefix WORD]",
+      NO_STR
+      VPP_STR
+      "Program the VPP FIB\n"
+      "Shared memory prefix of the VPP API segment\n"
+      "Prefix\n")
+{
+	gdv->enabled = false;
+	thread_add_event(gdv->fthread->master, dplane_vpp_process_event, gdv,
+			 DVE_DISABLE, &gdv->t_event);
+	return CMD_SUCCESS;
+}
+
+DEFUN(vpp_batch_size, vpp_batch_size_cmd,
+      "vpp batch-size (1-8192)",
+      VPP_STR
+      "Maximum routes per bulk request\n"
+      "Number of routes\n")
+{
+	gdv->batch_size = strtoul(argv[2]->arg, NULL, 10);
+	return CMD_SUCCESS;
+}
+
+DEFUN(no_vpp_batch_size, no_vpp_batch_size_cmd,
+      "no vpp batch-size [(1-8192)]",
+      NO_STR
+      VPP_STR
+      "Maximum routes per bulk request\n"
+      "Number of routes\n")
+{
+	gdv->batch_size = VPP_BATCH_SIZE_DEFAULT;
+	return CMD_SUCCESS;
+}
+
+DEFUN(vpp_reset_counters, vpp_reset_counters_cmd,
+      "clear dplane vpp counters",
+      CLEAR_STR
+      "Zebra dataplane provider information\n"
+      VPP_STR
+      "VPP data plane statistic counters\n")
+{
+	thread_add_event(gdv->fthread->master, dplane_vpp_process_event, gdv,
+			 DVE_RESET_COUNTERS, &gdv->t_event);
+	return CMD_SUCCESS;
+}
+
+DEFUN(vpp_show_counters, vpp_show_counters_cmd,
+      "show dplane vpp counters",
+      SHOW_STR
+      "Zebra dataplane provider information\n"
+      VPP_STR
+      "VPP data plane statistic counters\n")
+{
+	uint32_t usec, routes;
+
+	vty_out(vty, "%30s\n%30s\n", "VPP dataplane counters",
+		"======================");
+	vty_out(vty, "%28s: %s\n", "Connection",
+		atomic_load_explicit(&gdv->connected, memory_order_relaxed)
+			? "up"
+			: (gdv->enabled ? "down" : "disabled"));
+
+#define SHOW_COUNTER(label, counter) \
+	vty_out(vty, "%28s: %u\n", (label), (counter))
+
+	SHOW_COUNTER("Data plane items processed",
+		     gdv->counters.dplane_contexts);
+	SHOW_COUNTER("Data plane items enqueued", gdv->counters.ctxqueue_len);
+	SHOW_COUNTER("Data plane items queue peak",
+		     gdv->counters.ctxqueue_len_peak);
+	SHOW_COUNTER("Routes sent", gdv->counters.routes);
+	SHOW_COUNTER("Route errors", gdv->counters.route_errors);
+	SHOW_COUNTER("Routes replayed", gdv->counters.replayed_routes);
+	SHOW_COUNTER("Neighbors sent", gdv->counters.neighbors);
+	SHOW_COUNTER("Neighbor errors", gdv->counters.neighbor_errors);
+	SHOW_COUNTER("Bulk requests", gdv->counters.batches);
+	SHOW_COUNTER("Bulk request last usec", gdv->counters.batch_usec_last);
+	SHOW_COUNTER("Bulk request max usec", gdv->counters.batch_usec_max);
+	SHOW_COUNTER("Outstanding limit hits", gdv->counters.outstanding_full);
+	SHOW_COUNTER("Connects", gdv->counters.connects);
+	SHOW_COUNTER("Connection errors", gdv->counters.connection_errors);
+
+#undef SHOW_COUNTER
+
+	usec = gdv->counters.converge_usec_last;
+	routes = gdv->counters.converge_routes_last;
+	vty_out(vty, "%28s: %u routes in %u.%06u secs", "Last convergence",
+		routes, usec / 1000000, usec % 1000000);
+	if (usec)
+		vty_out(vty, ", %" PRIu64 " routes/sec",
+			(uint64_t)routes * 1000000 / usec);
+	vty_out(vty, "\n");
+
+	return CMD_SUCCESS;
+}
+
+static int dplane_vpp_write_config(struct vty *vty)
+{
+	int written = 0;
+
+	if (gdv->enabled) {
+		vty_out(vty, "vpp connect");
+		if (gdv->api_prefix[0])
+			vty_out(vty, " api-prefix %s", gdv->api_prefix);
+		vty_out(vty, "\n");
+		written = 1;
+	}
+
+	if (gdv->batch_size != VPP_BATCH_SIZE_DEFAULT) {
+		vty_out(vty, "vpp batch-size %u\n", gdv->batch_size);
+		written = 1;
+	}
+
+	return written;
+}
+
+static struct cmd_node vpp_dplane_node = {
+	.name = "vpp",
+	.node = VPP_DPLANE_NODE,
+	.prompt = "",
+	.config_write = dplane_vpp_write_config,
+};
+
+/*
+ * Interface map.
+ */
+static vapi_error_e dplane_vpp_itf_pair_details(vapi_ctx_t vapi,
+						void *arg,
+						void *payload)
+{
+	vapi_payload_lcp_itf_pair_details *mp = payload;
+	struct dplane_vpp *dv = arg;
+	uint32_t ii;
+
+	frr_with_mutex (&dv->itf_mutex) {
+		if (mp->vif_index >= dv->itf_map_len) {
+			ii = dv->itf_map_len;
+			dv->itf_map_len = mp->vif_index + 64;
+			dv->itf_map = XREALLOC(MTYPE_VPP_ITF_MAP, dv->itf_map,
+					       dv->itf_map_len
+						       * sizeof(*dv->itf_map));
+			for (; ii < dv->itf_map_len; ii++)
+				dv->itf_map[ii] = ~0;
+		}
+		dv->itf_map[mp->vif_index] = mp->phy_sw_if_index;
+	}
+
+	return VAPI_OK;
+}
+
+static vapi_error_e
+dplane_vpp_itf_pair_get_reply(vapi_ctx_t vapi, void *arg, vapi_error_e rv,
+			      bool is_last,
+			      vapi_payload_lcp_itf_pair_get_reply *reply)
+{
+	struct dplane_vpp *dv = arg;
+
+	/* the get reply, then the end of the details */
+	if (reply && reply->retval == VPP_API_ERROR_EAGAIN) {
+		dv->itf_cursor = reply->cursor;
+		atomic_store_explicit(&dv->itf_stale, true,
+				      memory_order_relaxed);
+	} else if (rv != VAPI_OK || (reply && reply->retval != 0))
+		zlog_warn("%s: reading linux-cp interface pairs failed: %d/%d",
+			  prov_name, rv, reply ? reply->retval : 0);
+	if (!is_last)
+		return VAPI_OK;
+
+	if (IS_ZEBRA_DEBUG_DPLANE)
+		zlog_debug("%s: interface map has %u entries", prov_name,
+			   dv->itf_map_len);
+
+	dv->itf_reading = false;
+	dv->outstanding--;
+	return VAPI_OK;
+}
+
+static void dplane_vpp_itf_refresh(struct dplane_vpp *dv)
+{
+	vapi_msg_lcp_itf_pair_get *mp;
+
+	if (dv->itf_reading)
+		return;
+
+	/* without linux-cp, only the routes via a gateway can be sent */
+	if (!vapi_is_msg_available(dv->vapi, vapi_msg_id_lcp_itf_pair_get)) {
+		atomic_store_explicit(&dv->itf_stale, false,
+				      memory_order_relaxed);
+		return;
+	}
+
+	mp = vapi_alloc_lcp_itf_pair_get(dv->vapi);
+	if (mp == NULL)
+		return;
+	mp->payload.cursor = dv->itf_cursor;
+
+	if (vapi_lcp_itf_pair_get(dv->vapi, mp, dplane_vpp_itf_pair_get_reply,
+				  dv)
+	    != VAPI_OK) {
+		vapi_msg_free(dv->vapi, mp);
+		return;
+	}
+	atomic_store_explicit(&dv->itf_stale, false, memory_order_relaxed);
+	dv->itf_reading = true;
+	dv->itf_cursor = 0;
+	dv->outstanding++;
+}
+
+static uint32_t dplane_vpp_sw_if_index(struct dplane_vpp *dv,
+				       ifindex_t ifindex)
+{
+	uint32_t sw_if_index = ~0;
+
+	frr_with_mutex (&dv->itf_mutex) {
+		if (ifindex >= 0 && (uint32_t)ifindex < dv->itf_map_len)
+			sw_if_index = dv->itf_map[ifindex];
+	}
+
+	return sw_if_index;
+}
+
+/*
+ * Route encoding.
+ */
+static uint32_t dplane_vpp_table_id(uint32_t table_id)
+{
+	/* the kernel's main table is VPP's default table */
+	return table_id == RT_TABLE_MAIN ? 0 : table_id;
+}
+
+static void dplane_vpp_prefix_encode(const struct prefix *p,
+				     vapi_type_prefix *vp)
+{
+	memset(vp, 0, sizeof(*vp));
+	vp->len = p->prefixlen;
+	if (p->family == AF_INET) {
+		vp->address.af = ADDRESS_IP4;
+		memcpy(vp->address.un.ip4, &p->u.prefix4, 4);
+	} else {
+		vp->address.af = ADDRESS_IP6;
+		memcpy(vp->address.un.ip6, &p->u.prefix6, 16);
+	}
+}
+
+/*
+ * Encode a next hop as a VPP path. Returns -1 if VPP can't forward via
+ * it, e.g. its interface is not known to VPP.
+ */
+static int dplane_vpp_path_encode(struct dplane_vpp *dv,
+				  const struct prefix *p, uint32_t table_id,
+				  const struct nexthop *nh,
+				  vapi_type_fib_path *path)
+{
+	uint8_t ii;
+
+	memset(path, 0, sizeof(*path));
+	path->sw_if_index = ~0;
+	path->table_id = table_id;
+	path->weight = nh->weight ? nh->weight : 1;
+	path->type = FIB_API_PATH_TYPE_NORMAL;
+	path->proto = (p->family == AF_INET) ? FIB_API_PATH_NH_PROTO_IP4
+					     : FIB_API_PATH_NH_PROTO_IP6;
+
+	switch (nh->type) {
+	case NEXTHOP_TYPE_BLACKHOLE:
+		switch (nh->bh_type) {
+		case BLACKHOLE_REJECT:
+			path->type = FIB_API_PATH_TYPE_ICMP_UNREACH;
+			break;
+		case BLACKHOLE_ADMINPROHIB:
+			path->type = FIB_API_PATH_TYPE_ICMP_PROHIBIT;
+			break;
+		default:
+			path->type = FIB_API_PATH_TYPE_DROP;
+			break;
+		}
+		return 0;
+	case NEXTHOP_TYPE_IPV4:
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+		path->proto = FIB_API_PATH_NH_PROTO_IP4;
+		memcpy(path->nh.address.ip4, &nh->gate.ipv4, 4);
+		break;
+	case NEXTHOP_TYPE_IPV6:
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		path->proto = FIB_API_PATH_NH_PROTO_IP6;
+		memcpy(path->nh.address.ip6, &nh->gate.ipv6, 16);
+		break;
+	case NEXTHOP_TYPE_IFINDEX:
+		break;
+	}
+
+	if (nh->type != NEXTHOP_TYPE_IPV4 && nh->type != NEXTHOP_TYPE_IPV6) {
+		path->sw_if_index = dplane_vpp_sw_if_index(dv, nh->ifindex);
+
+		/*
+		 * VPP resolves a gateway itself, but an interface route
+		 * needs the interface.
+		 */
+		if (path->sw_if_index == (uint32_t)~0
+		    && nh->type == NEXTHOP_TYPE_IFINDEX)
+			return -1;
+	}
+
+	if (nh->nh_label) {
+		for (ii = 0; ii < nh->nh_label->num_labels
+			     && path->n_labels < array_size(path->label_stack);
+		     ii++) {
+			if (nh->nh_label->label[ii] == MPLS_LABEL_IMPLICIT_NULL)
+				continue;
+			path->label_stack[path->n_labels++].label =
+				nh->nh_label->label[ii];
+		}
+	}
+
+	return 0;
+}
+
+static struct vpp_route_batch *dplane_vpp_batch_new(struct dplane_vpp *dv)
+{
+	struct vpp_route_batch *batch;
+
+	batch = XCALLOC(MTYPE_VPP_BATCH, sizeof(*batch));
+	batch->dv = dv;
+	batch->max_routes = dv->batch_size;
+	batch->routes = XCALLOC(MTYPE_VPP_BATCH,
+				dv->batch_size * sizeof(*batch->routes));
+	batch->ctxs = XCALLOC(MTYPE_VPP_BATCH,
+			      dv->batch_size * sizeof(*batch->ctxs));
+
+	return batch;
+}
+
+static void dplane_vpp_batch_free(struct vpp_route_batch *batch)
+{
+	XFREE(MTYPE_VPP_BATCH, batch->routes);
+	XFREE(MTYPE_VPP_BATCH, batch->ctxs);
+	XFREE(MTYPE_VPP_BATCH, batch);
+}
+
+/*
+ * Add a route to a batch, one entry per next hop. Returns 1 if the
+ * batch has no room for it, or if it follows an update of the same
+ * route: VPP would merge the two into one route with both sets of paths.
+ * Returns -1 if the route can't be programmed.
+ */
+static int dplane_vpp_route_encode(struct dplane_vpp *dv,
+				   struct vpp_route_batch *batch,
+				   struct zebra_dplane_ctx *ctx)
+{
+	vapi_type_fib_path paths[VPP_BATCH_PATHS];
+	uint8_t path_index[VPP_BATCH_PATHS];
+	const struct nexthop *nh;
+	vapi_type_ip_route_bulk_entry *route;
+	vapi_type_prefix vp;
+	const struct prefix *p;
+	uint32_t table_id;
+	uint8_t n_paths, n_new, ii, jj;
+	bool is_add;
+
+	p = dplane_ctx_get_dest(ctx);
+	table_id = dplane_vpp_table_id(dplane_ctx_get_table(ctx));
+	is_add = dplane_ctx_get_op(ctx) != DPLANE_OP_ROUTE_DELETE;
+
+	dplane_vpp_prefix_encode(p, &vp);
+	if (batch->n_routes) {
+		route = &batch->routes[batch->n_routes - 1];
+		if (route->table_id == table_id
+		    && !memcmp(&route->prefix, &vp, sizeof(vp)))
+			return 1;
+	}
+
+	n_paths = 0;
+	if (is_add) {
+		for (ALL_NEXTHOPS_PTR(dplane_ctx_get_ng(ctx), nh)) {
+			if (CHECK_FLAG(nh->flags, NEXTHOP_FLAG_RECURSIVE))
+				continue;
+			if (!NEXTHOP_IS_ACTIVE(nh->flags))
+				continue;
+			if (n_paths == VPP_BATCH_PATHS)
+				return -1;
+			if (dplane_vpp_path_encode(dv, p, table_id, nh,
+						   &paths[n_paths])
+			    < 0) {
+				atomic_store_explicit(&dv->itf_stale, true,
+						      memory_order_relaxed);
+				return -1;
+			}
+			n_paths++;
+		}
+		/* no next hop is usable, remove the route from VPP */
+		if (n_paths == 0)
+			is_add = false;
+	}
+
+	/* find the paths in the batch, or the room for them */
+	n_new = 0;
+	for (ii = 0; ii < n_paths; ii++) {
+		for (jj = 0; jj < batch->n_paths + n_new; jj++)
+			if (!memcmp(&batch->paths[jj], &paths[ii],
+				    sizeof(paths[ii])))
+				break;
+		if (jj == batch->n_paths + n_new) {
+			if (jj == VPP_BATCH_PATHS)
+				return 1;
+			batch->paths[jj] = paths[ii];
+			n_new++;
+		}
+		path_index[ii] = jj;
+	}
+	if (batch->n_routes + MAX(n_paths, 1) > batch->max_routes)
+		return 1;
+	batch->n_paths += n_new;
+
+	for (ii = 0; ii < MAX(n_paths, 1); ii++) {
+		route = &batch->routes[batch->n_routes + ii];
+		memset(route, 0, sizeof(*route));
+		route->table_id = table_id;
+		route->prefix = vp;
+		route->is_add = is_add;
+		route->path_index = n_paths ? path_index[ii] : 0;
+	}
+
+	batch->ctxs[batch->n_ctxs].ctx = ctx;
+	batch->ctxs[batch->n_ctxs].first_route = batch->n_routes;
+	batch->n_ctxs++;
+	batch->n_routes += MAX(n_paths, 1);
+
+	return 0;
+}
+
+/*
+ * Completion.
+ */
+static void dplane_vpp_ctx_done(struct dplane_vpp *dv,
+				struct zebra_dplane_ctx *ctx, bool ok)
+{
+	if (!ok)
+		dplane_ctx_set_status(ctx, ZEBRA_DPLANE_REQUEST_FAILURE);
+
+	atomic_fetch_sub_explicit(&dv->counters.ctxqueue_len, 1,
+				  memory_order_relaxed);
+	dplane_provider_enqueue_out_ctx(dv->prov, ctx);
+}
+
+/* Account the end of a busy period, once all the work is done */
+static void dplane_vpp_idle_check(struct dplane_vpp *dv)
+{
+	bool idle;
+
+	if (dv->outstanding || !TAILQ_EMPTY(&dv->sendq) || dv->batch)
+		return;
+
+	frr_with_mutex (&dv->queue_mutex) {
+		idle = TAILQ_EMPTY(&dv->ctxqueue) && TAILQ_EMPTY(&dv->replayq);
+	}
+	if (!idle || dv->busy_routes == 0)
+		return;
+
+	atomic_store_explicit(&dv->counters.converge_usec_last,
+			      monotime_since(&dv->busy_start, NULL),
+			      memory_order_relaxed);
+	atomic_store_explicit(&dv->counters.converge_routes_last,
+			      dv->busy_routes, memory_order_relaxed);
+	dv->busy_routes = 0;
+}
+
+static vapi_error_e
+dplane_vpp_route_reply(vapi_ctx_t vapi, void *arg, vapi_error_e rv,
+		       bool is_last,
+		       vapi_payload_ip_route_add_del_bulk_reply *reply)
+{
+	struct vpp_route_batch *batch = arg;
+	struct dplane_vpp *dv = batch->dv;
+	uint32_t ii, usec;
+	bool ok;
+
+	dv->outstanding--;
+	TAILQ_REMOVE(&dv->inflightq, batch, entries);
+
+	usec = monotime_since(&batch->sent, NULL);
+	atomic_store_explicit(&dv->counters.batch_usec_last, usec,
+			      memory_order_relaxed);
+	if (usec > atomic_load_explicit(&dv->counters.batch_usec_max,
+					memory_order_relaxed))
+		atomic_store_explicit(&dv->counters.batch_usec_max, usec,
+				      memory_order_relaxed);
+
+	if (rv != VAPI_OK || reply->n_routes != batch->n_routes) {
+		zlog_warn("%s: bulk route request failed: %d/%d", prov_name,
+			  rv, reply ? reply->retval : 0);
+		atomic_fetch_add_explicit(&dv->counters.route_errors,
+					  batch->n_ctxs, memory_order_relaxed);
+		for (ii = 0; ii < batch->n_ctxs; ii++)
+			if (batch->ctxs[ii].ctx)
+				dplane_vpp_ctx_done(dv, batch->ctxs[ii].ctx,
+						    false);
+		goto done;
+	}
+
+	for (ii = 0; ii < batch->n_ctxs; ii++) {
+		ok = reply->retvals[batch->ctxs[ii].first_route] == 0;
+		if (!ok) {
+			atomic_fetch_add_explicit(&dv->counters.route_errors,
+						  1, memory_order_relaxed);
+			if (IS_ZEBRA_DEBUG_DPLANE)
+				zlog_debug("%s: route %u of batch failed: %d",
+					   prov_name, ii,
+					   reply->retvals[batch->ctxs[ii]
+								  .first_route]);
+		}
+		if (batch->ctxs[ii].ctx)
+			dplane_vpp_ctx_done(dv, batch->ctxs[ii].ctx, ok);
+	}
+
+done:
+	dplane_vpp_batch_free(batch);
+	dplane_provider_work_ready();
+
+	return VAPI_OK;
+}
+
+static vapi_error_e
+dplane_vpp_neigh_reply(vapi_ctx_t vapi, void *arg, vapi_error_e rv,
+		       bool is_last, vapi_payload_ip_neighbor_add_del_reply *reply)
+{
+	struct zebra_dplane_ctx *ctx;
+	bool ok = (rv == VAPI_OK && reply->retval == 0);
+
+	ctx = dplane_ctx_dequeue(&gdv->neighq);
+	assert(ctx == arg);
+	gdv->outstanding--;
+	if (!ok)
+		atomic_fetch_add_explicit(&gdv->counters.neighbor_errors, 1,
+					  memory_order_relaxed);
+	dplane_vpp_ctx_done(gdv, ctx, ok);
+	dplane_provider_work_ready();
+
+	return VAPI_OK;
+}
+
+/*
+ * Sending.
+ */
+static int dplane_vpp_batch_send(struct dplane_vpp *dv,
+				 struct vpp_route_batch *batch)
+{
+	vapi_msg_ip_route_add_del_bulk *mp;
+	vapi_error_e rv;
+
+	mp = vapi_alloc_ip_route_add_del_bulk(dv->vapi, batch->n_routes);
+	if (mp == NULL)
+		return -1;
+
+	mp->payload.n_paths = batch->n_paths;
+	memcpy(mp->payload.paths, batch->paths, sizeof(batch->paths));
+	memcpy(mp->payload.routes, batch->routes,
+	       batch->n_routes * sizeof(batch->routes[0]));
+
+	monotime(&batch->sent);
+	rv = vapi_ip_route_add_del_bulk(dv->vapi, mp, dplane_vpp_route_reply,
+					batch);
+	if (rv != VAPI_OK) {
+		vapi_msg_free(dv->vapi, mp);
+		return -1;
+	}
+
+	dv->outstanding++;
+	atomic_fetch_add_explicit(&dv->counters.batches, 1,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&dv->counters.routes, batch->n_ctxs,
+				  memory_order_relaxed);
+	return 0;
+}
+
+static int dplane_vpp_neigh_send(struct dplane_vpp *dv,
+				 struct zebra_dplane_ctx *ctx)
+{
+	vapi_msg_ip_neighbor_add_del *mp;
+	const struct ipaddr *ip;
+	vapi_type_ip_neighbor *nbr;
+	vapi_error_e rv;
+
+	mp = vapi_alloc_ip_neighbor_add_del(dv->vapi);
+	if (mp == NULL)
+		return -1;
+
+	nbr = &mp->payload.neighbor;
+	mp->payload.is_add = dplane_ctx_get_op(ctx) != DPLANE_OP_NEIGH_DELETE;
+	nbr->sw_if_index =
+		dplane_vpp_sw_if_index(dv, dplane_ctx_get_ifindex(ctx));
+	nbr->flags = IP_API_NEIGHBOR_FLAG_STATIC;
+	memcpy(nbr->mac_address, dplane_ctx_neigh_get_mac(ctx),
+	       sizeof(nbr->mac_address));
+
+	ip = dplane_ctx_neigh_get_ipaddr(ctx);
+	if (IS_IPADDR_V4(ip)) {
+		nbr->ip_address.af = ADDRESS_IP4;
+		memcpy(nbr->ip_address.un.ip4, &ip->ipaddr_v4, 4);
+	} else {
+		nbr->ip_address.af = ADDRESS_IP6;
+		memcpy(nbr->ip_address.un.ip6, &ip->ipaddr_v6, 16);
+	}
+
+	rv = vapi_ip_neighbor_add_del(dv->vapi, mp, dplane_vpp_neigh_reply,
+				      ctx);
+	if (rv != VAPI_OK) {
+		vapi_msg_free(dv->vapi, mp);
+		return -1;
+	}
+
+	dplane_ctx_enqueue_tail(&dv->neighq, ctx);
+	dv->outstanding++;
+	atomic_fetch_add_explicit(&dv->counters.neighbors, 1,
+				  memory_order_relaxed);
+	return 0;
+}
+
+/* Send the queued batches while VPP takes more requests */
+static void dplane_vpp_send(struct dplane_vpp *dv)
+{
+	struct vpp_route_batch *batch;
+
+	while ((batch = TAILQ_FIRST(&dv->sendq))) {
+		if (dv->outstanding >= VPP_MAX_OUTSTANDING) {
+			atomic_fetch_add_explicit(
+				&dv->counters.outstanding_full, 1,
+				memory_order_relaxed);
+			break;
+		}
+		if (dplane_vpp_batch_send(dv, batch) < 0)
+			break;
+		TAILQ_REMOVE(&dv->sendq, batch, entries);
+		TAILQ_INSERT_TAIL(&dv->inflightq, batch, entries);
+	}
+
+	if (dv->outstanding == 0 && !TAILQ_EMPTY(&dv->sendq))
+		/* no reply will come to retry, e.g. the API segment is full */
+		thread_add_timer_msec(dv->fthread->master,
+				      dplane_vpp_process_queue, dv, 10,
+				      &dv->t_dequeue);
+}
+
+static void dplane_vpp_batch_close(struct dplane_vpp *dv)
+{
+	if (dv->batch == NULL)
+		return;
+	if (dv->batch->n_ctxs == 0) {
+		dplane_vpp_batch_free(dv->batch);
+		dv->batch = NULL;
+		return;
+	}
+	TAILQ_INSERT_TAIL(&dv->sendq, dv->batch, entries);
+	dv->batch = NULL;
+}
+
+/*
+ * Add a route context to the open batch, closing the batch when full.
+ * Returns false if the route can't be programmed.
+ */
+static bool dplane_vpp_route_add(struct dplane_vpp *dv,
+				 struct zebra_dplane_ctx *ctx)
+{
+	int rv;
+
+	if (dv->batch == NULL)
+		dv->batch = dplane_vpp_batch_new(dv);
+
+	rv = dplane_vpp_route_encode(dv, dv->batch, ctx);
+	if (rv == 1) {
+		dplane_vpp_batch_close(dv);
+		dv->batch = dplane_vpp_batch_new(dv);
+		rv = dplane_vpp_route_encode(dv, dv->batch, ctx);
+	}
+	if (rv != 0)
+		return false;
+
+	if (dv->batch->n_routes == dv->batch->max_routes)
+		dplane_vpp_batch_close(dv);
+	return true;
+}
+
+static bool dplane_vpp_is_route(const struct zebra_dplane_ctx *ctx)
+{
+	const struct prefix *p;
+
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_ROUTE_INSTALL:
+	case DPLANE_OP_ROUTE_UPDATE:
+	case DPLANE_OP_ROUTE_DELETE:
+		break;
+	default:
+		return false;
+	}
+
+	/* VPP has no source specific routes */
+	p = dplane_ctx_get_src(ctx);
+	if (p && p->prefixlen)
+		return false;
+
+	p = dplane_ctx_get_dest(ctx);
+	return p->family == AF_INET || p->family == AF_INET6;
+}
+
+static bool dplane_vpp_is_neigh(const struct zebra_dplane_ctx *ctx)
+{
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_NEIGH_INSTALL:
+	case DPLANE_OP_NEIGH_UPDATE:
+	case DPLANE_OP_NEIGH_DELETE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static int dplane_vpp_process_queue(struct thread *t)
+{
+	struct dplane_vpp *dv = THREAD_ARG(t);
+	struct vpp_route_batch *batch;
+	struct zebra_dplane_ctx *ctx;
+
+	/* the batches the RIB walk replays first */
+	while (true) {
+		frr_with_mutex (&dv->queue_mutex) {
+			batch = TAILQ_FIRST(&dv->replayq);
+			if (batch)
+				TAILQ_REMOVE(&dv->replayq, batch, entries);
+		}
+		if (batch == NULL)
+			break;
+		if (dv->busy_routes == 0)
+			monotime(&dv->busy_start);
+		dv->busy_routes += batch->n_ctxs;
+		TAILQ_INSERT_TAIL(&dv->sendq, batch, entries);
+	}
+
+	while (dv->outstanding < VPP_MAX_OUTSTANDING) {
+		frr_with_mutex (&dv->queue_mutex) {
+			ctx = dplane_ctx_dequeue(&dv->ctxqueue);
+		}
+		if (ctx == NULL)
+			break;
+
+		if (!atomic_load_explicit(&dv->connected,
+					  memory_order_relaxed)) {
+			dplane_vpp_ctx_done(dv, ctx, true);
+			continue;
+		}
+
+		if (dplane_vpp_is_route(ctx)) {
+			if (!dplane_vpp_route_add(dv, ctx)) {
+				atomic_fetch_add_explicit(
+					&dv->counters.route_errors, 1,
+					memory_order_relaxed);
+				dplane_vpp_ctx_done(dv, ctx, false);
+				continue;
+			}
+			if (dv->busy_routes == 0)
+				monotime(&dv->busy_start);
+			dv->busy_routes++;
+		} else if (dplane_vpp_is_neigh(ctx)) {
+			if (dplane_vpp_neigh_send(dv, ctx) < 0) {
+				atomic_fetch_add_explicit(
+					&dv->counters.neighbor_errors, 1,
+					memory_order_relaxed);
+				dplane_vpp_ctx_done(dv, ctx, false);
+			}
+		} else {
+			/*
+			 * VPP has no next hop group objects; the routes
+			 * carry their resolved next hops.
+			 */
+			dplane_vpp_ctx_done(dv, ctx, true);
+		}
+	}
+
+	/*
+	 * Send a partial batch only when VPP is idle: while it works on the
+	 * requests in flight, the batch fills up with the next contexts.
+	 */
+	if (dv->outstanding == 0)
+		dplane_vpp_batch_close(dv);
+
+	if (atomic_load_explicit(&dv->itf_stale, memory_order_relaxed)
+	    && atomic_load_explicit(&dv->connected, memory_order_relaxed))
+		dplane_vpp_itf_refresh(dv);
+
+	dplane_vpp_send(dv);
+	dplane_vpp_idle_check(dv);
+
+	if (dplane_provider_out_ctx_queue_len(dv->prov) > 0)
+		dplane_provider_work_ready();
+
+	return 0;
+}
+
+/*
+ * The waiter pthread: only vapi_wait() touches the API from here, the
+ * messages are dispatched by the provider.
+ */
+static void *dplane_vpp_wait_thread(void *arg)
+{
+	struct dplane_vpp *dv = arg;
+	uint64_t one = 1;
+	vapi_error_e rv;
+	bool stop;
+
+	while (true) {
+		pthread_mutex_lock(&dv->wait_mutex);
+		while (!dv->wait_armed && !dv->wait_stop)
+			pthread_cond_wait(&dv->wait_cond, &dv->wait_mutex);
+		stop = dv->wait_stop;
+		pthread_mutex_unlock(&dv->wait_mutex);
+		if (stop)
+			break;
+
+		rv = vapi_wait(dv->vapi, VAPI_WAIT_FOR_READ);
+		if (rv == VAPI_EAGAIN)
+			continue;
+		if (rv != VAPI_OK) {
+			zlog_warn("%s: waiting for VPP messages failed: %d",
+				  prov_name, rv);
+			break;
+		}
+
+		frr_with_mutex (&dv->wait_mutex) {
+			dv->wait_armed = false;
+		}
+		if (write(dv->wait_fd, &one, sizeof(one)) < 0)
+			zlog_warn("%s: waking the provider failed: %s",
+				  prov_name, safe_strerror(errno));
+	}
+
+	return NULL;
+}
+
+static void dplane_vpp_wait_arm(struct dplane_vpp *dv)
+{
+	frr_with_mutex (&dv->wait_mutex) {
+		dv->wait_armed = true;
+		pthread_cond_signal(&dv->wait_cond);
+	}
+}
+
+static int dplane_vpp_wait_start(struct dplane_vpp *dv)
+{
+	dv->wait_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (dv->wait_fd < 0)
+		return -1;
+
+	dv->wait_armed = true;
+	dv->wait_stop = false;
+	if (pthread_create(&dv->wait_thread, NULL, dplane_vpp_wait_thread, dv)
+	    != 0) {
+		close(dv->wait_fd);
+		dv->wait_fd = -1;
+		return -1;
+	}
+	dv->wait_running = true;
+
+	thread_add_read(dv->fthread->master, dplane_vpp_read, dv, dv->wait_fd,
+			&dv->t_read);
+	return 0;
+}
+
+static void dplane_vpp_wait_stop(struct dplane_vpp *dv)
+{
+	THREAD_OFF(dv->t_read);
+	if (!dv->wait_running)
+		return;
+
+	frr_with_mutex (&dv->wait_mutex) {
+		dv->wait_stop = true;
+		pthread_cond_signal(&dv->wait_cond);
+	}
+	pthread_join(dv->wait_thread, NULL);
+	dv->wait_running = false;
+	close(dv->wait_fd);
+	dv->wait_fd = -1;
+}
+
+/* A message is queued: dispatch it, and wait for the next one */
+static int dplane_vpp_read(struct thread *t)
+{
+	struct dplane_vpp *dv = THREAD_ARG(t);
+	uint64_t n;
+	vapi_error_e rv;
+
+	if (read(dv->wait_fd, &n, sizeof(n)) < 0)
+		goto rearm;
+
+	rv = vapi_dispatch_one(dv->vapi);
+	if (rv != VAPI_OK && rv != VAPI_EAGAIN) {
+		zlog_warn("%s: reading VPP replies failed: %d", prov_name, rv);
+		atomic_fetch_add_explicit(&dv->counters.connection_errors, 1,
+					  memory_order_relaxed);
+	}
+
+	/* replies free room for the waiting work */
+	thread_add_event(dv->fthread->master, dplane_vpp_process_queue, dv, 0,
+			 &dv->t_dequeue);
+
+	dplane_vpp_wait_arm(dv);
+rearm:
+	thread_add_read(dv->fthread->master, dplane_vpp_read, dv, dv->wait_fd,
+			&dv->t_read);
+	return 0;
+}
+
+/*
+ * The API library answers the keepalives by blocking for the next message
+ * after them, so they are answered here.
+ */
+static vapi_error_e dplane_vpp_keepalive(vapi_ctx_t vapi, void *arg,
+					 void *payload)
+{
+	vapi_msg_memclnt_keepalive_reply *mp;
+
+	mp = vapi_msg_alloc(vapi, sizeof(*mp));
+	if (mp == NULL)
+		return VAPI_OK;
+
+	memset(mp, 0, sizeof(*mp));
+	mp->header._vl_msg_id = vapi_lookup_vl_msg_id(
+		vapi, vapi_msg_id_memclnt_keepalive_reply);
+	mp->header.context = vapi_get_client_index(vapi);
+	vapi_msg_memclnt_keepalive_reply_hton(mp);
+	if (vapi_send(vapi, mp) != VAPI_OK)
+		vapi_msg_free(vapi, mp);
+
+	return VAPI_OK;
+}
+
+/*
+ * Connection.
+ */
+/* Fail the contexts of the batches in a queue, and free them */
+static void dplane_vpp_batch_q_fail(struct dplane_vpp *dv,
+				    struct vpp_batch_q *q)
+{
+	struct vpp_route_batch *batch;
+	uint32_t ii;
+
+	while ((batch = TAILQ_FIRST(q))) {
+		TAILQ_REMOVE(q, batch, entries);
+		for (ii = 0; ii < batch->n_ctxs; ii++)
+			if (batch->ctxs[ii].ctx)
+				dplane_vpp_ctx_done(dv, batch->ctxs[ii].ctx,
+						    false);
+		dplane_vpp_batch_free(batch);
+	}
+}
+
+static void dplane_vpp_disconnect(struct dplane_vpp *dv)
+{
+	struct zebra_dplane_ctx *ctx;
+
+	THREAD_OFF(dv->t_connect);
+	dplane_vpp_wait_stop(dv);
+
+	if (!atomic_load_explicit(&dv->connected, memory_order_relaxed))
+		return;
+
+	/* drain the replies still outstanding before going away */
+	while (dv->outstanding
+	       && vapi_wait(dv->vapi, VAPI_WAIT_FOR_READ) == VAPI_OK
+	       && vapi_dispatch_one(dv->vapi) == VAPI_OK)
+		;
+
+	vapi_disconnect(dv->vapi);
+	atomic_store_explicit(&dv->connected, false, memory_order_relaxed);
+	dv->outstanding = 0;
+	dv->itf_reading = false;
+
+	/* what VPP didn't answer may or may not be programmed */
+	dplane_vpp_batch_close(dv);
+	dplane_vpp_batch_q_fail(dv, &dv->inflightq);
+	dplane_vpp_batch_q_fail(dv, &dv->sendq);
+	while ((ctx = dplane_ctx_dequeue(&dv->neighq)))
+		dplane_vpp_ctx_done(dv, ctx, false);
+	dplane_provider_work_ready();
+}
+
+static int dplane_vpp_connect(struct thread *t)
+{
+	struct dplane_vpp *dv = THREAD_ARG(t);
+	vapi_error_e rv;
+
+	if (!dv->enabled
+	    || atomic_load_explicit(&dv->connected, memory_order_relaxed))
+		return 0;
+
+	rv = vapi_connect(dv->vapi, "zebra",
+			  dv->api_prefix[0] ? dv->api_prefix : NULL,
+			  VPP_MAX_OUTSTANDING, VPP_MAX_OUTSTANDING * 4,
+			  VAPI_MODE_NONBLOCKING, false);
+	if (rv != VAPI_OK) {
+		atomic_fetch_add_explicit(&dv->counters.connection_errors, 1,
+					  memory_order_relaxed);
+		thread_add_timer(dv->fthread->master, dplane_vpp_connect, dv,
+				 VPP_RECONNECT_SECS, &dv->t_connect);
+		return 0;
+	}
+
+	if (!vapi_is_msg_available(dv->vapi,
+				   vapi_msg_id_ip_route_add_del_bulk)) {
+		zlog_err("%s: VPP has no ip_route_add_del_bulk API",
+			 prov_name);
+		vapi_disconnect(dv->vapi);
+		dv->enabled = false;
+		return 0;
+	}
+
+	vapi_set_event_cb(dv->vapi, vapi_msg_id_memclnt_keepalive,
+			  dplane_vpp_keepalive, dv);
+	vapi_set_event_cb(dv->vapi, vapi_msg_id_lcp_itf_pair_details,
+			  dplane_vpp_itf_pair_details, dv);
+
+	if (dplane_vpp_wait_start(dv) < 0) {
+		zlog_err("%s: can't start waiting for VPP messages: %s",
+			 prov_name, safe_strerror(errno));
+		vapi_disconnect(dv->vapi);
+		atomic_fetch_add_explicit(&dv->counters.connection_errors, 1,
+					  memory_order_relaxed);
+		thread_add_timer(dv->fthread->master, dplane_vpp_connect, dv,
+				 VPP_RECONNECT_SECS, &dv->t_connect);
+		return 0;
+	}
+
+	zlog_info("%s: connected to VPP", prov_name);
+	atomic_store_explicit(&dv->connected, true, memory_order_relaxed);
+	atomic_fetch_add_explicit(&dv->counters.connects, 1,
+				  memory_order_relaxed);
+
+	dplane_vpp_itf_refresh(dv);
+	dplane_vpp_send(dv);
+
+	/* VPP may have restarted: send it the whole RIB */
+	thread_add_event(zrouter.master, dplane_vpp_rib_send, dv, 0,
+			 &dv->t_ribwalk);
+
+	return 0;
+}
+
+/*
+ * Send all the routes installed in the RIB. This runs in the zebra main
+ * pthread and hands batches over to the provider pthread.
+ */
+static int dplane_vpp_rib_send(struct thread *t)
+{
+	struct dplane_vpp *dv = THREAD_ARG(t);
+	struct vpp_route_batch *batch = NULL;
+	struct zebra_dplane_ctx *ctx;
+	struct route_table *rt;
+	struct route_node *rn;
+	rib_tables_iter_t rt_iter;
+	rib_dest_t *dest;
+	uint32_t n_routes = 0;
+	int rv;
+
+	ctx = dplane_ctx_alloc();
+
+	rt_iter.state = RIB_TABLES_ITER_S_INIT;
+	while ((rt = rib_tables_iter_next(&rt_iter))) {
+		for (rn = route_top(rt); rn; rn = srcdest_route_next(rn)) {
+			dest = rib_dest_from_rnode(rn);
+			if (dest == NULL || dest->selected_fib == NULL)
+				continue;
+
+			dplane_ctx_reset(ctx);
+			dplane_ctx_route_init(ctx, DPLANE_OP_ROUTE_INSTALL, rn,
+					      dest->selected_fib);
+			if (!dplane_vpp_is_route(ctx))
+				continue;
+
+			if (batch == NULL)
+				batch = dplane_vpp_batch_new(dv);
+			rv = dplane_vpp_route_encode(dv, batch, ctx);
+			if (rv == 1) {
+				frr_with_mutex (&dv->queue_mutex) {
+					TAILQ_INSERT_TAIL(&dv->replayq, batch,
+							  entries);
+				}
+				batch = dplane_vpp_batch_new(dv);
+				rv = dplane_vpp_route_encode(dv, batch, ctx);
+			}
+			if (rv == 0) {
+				/* nothing to complete for a replayed route */
+				batch->ctxs[batch->n_ctxs - 1].ctx = NULL;
+				n_routes++;
+			}
+		}
+	}
+
+	if (batch && batch->n_ctxs) {
+		frr_with_mutex (&dv->queue_mutex) {
+			TAILQ_INSERT_TAIL(&dv->replayq, batch, entries);
+		}
+	} else if (batch)
+		dplane_vpp_batch_free(batch);
+
+	dplane_ctx_fini(&ctx);
+
+	atomic_fetch_add_explicit(&dv->counters.replayed_routes, n_routes,
+				  memory_order_relaxed);
+	if (IS_ZEBRA_DEBUG_DPLANE)
+		zlog_debug("%s: replaying %u RIB routes", prov_name, n_routes);
+
+	thread_add_event(dv->fthread->master, dplane_vpp_process_event, dv,
+			 DVE_REPLAY, NULL);
+
+	return 0;
+}
+
+/**
+ * Handles external (e.g. CLI, data plane or others) events.
+ */
+static int dplane_vpp_process_event(struct thread *t)
+{
+	struct dplane_vpp *dv = THREAD_ARG(t);
+	int event = THREAD_VAL(t);
+
+	switch (event) {
+	case DVE_CONNECT:
+		zlog_info("%s: manual VPP connect event", __func__);
+		dplane_vpp_disconnect(dv);
+		thread_add_event(dv->fthread->master, dplane_vpp_connect, dv,
+				 0, &dv->t_connect);
+		break;
+
+	case DVE_DISABLE:
+		zlog_info("%s: manual VPP disable event", __func__);
+		dplane_vpp_disconnect(dv);
+		break;
+
+	case DVE_RESET_COUNTERS:
+		zlog_info("%s: manual VPP counters reset event", __func__);
+		memset(&dv->counters, 0, sizeof(dv->counters));
+		break;
+
+	case DVE_REPLAY:
+		thread_add_event(dv->fthread->master, dplane_vpp_process_queue,
+				 dv, 0, &dv->t_dequeue);
+		break;
+
+	default:
+		if (IS_ZEBRA_DEBUG_DPLANE)
+			zlog_debug("%s: unhandled event %d", __func__, event);
+		break;
+	}
+
+	return 0;
+}
+
+/*
+ * Data plane functions.
+ */
+static int dplane_vpp_start(struct zebra_dplane_provider *prov)
+{
+	struct dplane_vpp *dv;
+
+	dv = dplane_provider_get_data(prov);
+	dv->fthread = frr_pthread_new(NULL, prov_name, prov_name);
+	assert(frr_pthread_run(dv->fthread, NULL) == 0);
+	dv->prov = prov;
+	TAILQ_INIT(&dv->ctxqueue);
+	TAILQ_INIT(&dv->replayq);
+	TAILQ_INIT(&dv->sendq);
+	TAILQ_INIT(&dv->inflightq);
+	TAILQ_INIT(&dv->neighq);
+	pthread_mutex_init(&dv->queue_mutex, NULL);
+	pthread_mutex_init(&dv->itf_mutex, NULL);
+	pthread_mutex_init(&dv->wait_mutex, NULL);
+	pthread_cond_init(&dv->wait_cond, NULL);
+	dv->wait_fd = -1;
+
+	if (vapi_ctx_alloc(&dv->vapi) != VAPI_OK) {
+		zlog_err("%s: can't allocate a VPP API context", prov_name);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int dplane_vpp_finish_early(struct dplane_vpp *dv)
+{
+	THREAD_OFF(dv->t_ribwalk);
+	thread_cancel_async(dv->fthread->master, &dv->t_connect, NULL);
+	thread_cancel_async(dv->fthread->master, &dv->t_read, NULL);
+	thread_cancel_async(dv->fthread->master, &dv->t_dequeue, NULL);
+
+	return 0;
+}
+
+static int dplane_vpp_finish_late(struct dplane_vpp *dv)
+{
+	struct vpp_route_batch *batch;
+
+	/* Stop the running thread. */
+	frr_pthread_stop(dv->fthread, NULL);
+
+	dplane_vpp_disconnect(dv);
+	while ((batch = TAILQ_FIRST(&dv->replayq))) {
+		TAILQ_REMOVE(&dv->replayq, batch, entries);
+		dplane_vpp_batch_free(batch);
+	}
+	vapi_ctx_free(dv->vapi);
+
+	/* Free all allocated resources. */
+	pthread_mutex_destroy(&dv->queue_mutex);
+	pthread_mutex_destroy(&dv->itf_mutex);
+	pthread_mutex_destroy(&dv->wait_mutex);
+	pthread_cond_destroy(&dv->wait_cond);
+	XFREE(MTYPE_VPP_ITF_MAP, dv->itf_map);
+	free(gdv);
+	gdv = NULL;
+
+	return 0;
+}
+
+static int dplane_vpp_finish(struct zebra_dplane_provider *prov, bool early)
+{
+	struct dplane_vpp *dv;
+
+	dv = dplane_provider_get_data(prov);
+	if (early)
+		return dplane_vpp_finish_early(dv);
+
+	return dplane_vpp_finish_late(dv);
+}
+
+static int dplane_vpp_process(struct zebra_dplane_provider *prov)
+{
+	struct zebra_dplane_ctx *ctx;
+	struct dplane_vpp *dv;
+	int counter, limit;
+	uint32_t cur_queue, peak_queue = 0;
+
+	dv = dplane_provider_get_data(prov);
+	limit = dplane_provider_get_work_limit(prov);
+	for (counter = 0; counter < limit; counter++) {
+		ctx = dplane_provider_dequeue_in_ctx(prov);
+		if (ctx == NULL)
+			break;
+
+		atomic_fetch_add_explicit(&dv->counters.dplane_contexts, 1,
+					  memory_order_relaxed);
+
+		/*
+		 * Only what the kernel accepted goes to VPP, and nothing
+		 * goes while VPP is not connected: the RIB is replayed
+		 * when it connects.
+		 */
+		if (!atomic_load_explicit(&dv->connected, memory_order_relaxed)
+		    || dplane_ctx_get_status(ctx)
+			       != ZEBRA_DPLANE_REQUEST_SUCCESS) {
+			dplane_provider_enqueue_out_ctx(prov, ctx);
+			continue;
+		}
+
+		cur_queue = atomic_fetch_add_explicit(
+			&dv->counters.ctxqueue_len, 1, memory_order_relaxed);
+		if (peak_queue < cur_queue + 1)
+			peak_queue = cur_queue + 1;
+
+		frr_with_mutex (&dv->queue_mutex) {
+			dplane_ctx_enqueue_tail(&dv->ctxqueue, ctx);
+		}
+	}
+
+	if (peak_queue > atomic_load_explicit(&dv->counters.ctxqueue_len_peak,
+					      memory_order_relaxed))
+		atomic_store_explicit(&dv->counters.ctxqueue_len_peak,
+				      peak_queue, memory_order_relaxed);
+
+	if (peak_queue)
+		thread_add_event(dv->fthread->master, dplane_vpp_process_queue,
+				 dv, 0, &dv->t_dequeue);
+
+	/* Ensure dataplane thread is rescheduled if we hit the work limit */
+	if (counter >= limit)
+		dplane_provider_work_ready();
+
+	return 0;
+}
+
+static int dplane_vpp_new(struct thread_master *tm)
+{
+	struct zebra_dplane_provider *prov = NULL;
+	int rv;
+
+	gdv = calloc(1, sizeof(*gdv));
+	gdv->batch_size = VPP_BATCH_SIZE_DEFAULT;
+	rv = dplane_provider_register(prov_name, DPLANE_PRIO_POSTPROCESS,
+				      DPLANE_PROV_FLAG_THREADED,
+				      dplane_vpp_start, dplane_vpp_process,
+				      dplane_vpp_finish, gdv, &prov);
+
+	if (IS_ZEBRA_DEBUG_DPLANE)
+		zlog_debug("%s register status: %d", prov_name, rv);
+
+	install_node(&vpp_dplane_node);
+	install_element(ENABLE_NODE, &vpp_show_counters_cmd);
+	install_element(ENABLE_NODE, &vpp_reset_counters_cmd);
+	install_element(CONFIG_NODE, &vpp_connect_cmd);
+	install_element(CONFIG_NODE, &no_vpp_connect_cmd);
+	install_element(CONFIG_NODE, &vpp_batch_size_cmd);
+	install_element(CONFIG_NODE, &no_vpp_batch_size_cmd);
+
+	return 0;
+}
+
+static int dplane_vpp_init(void)
+{
+	hook_register(frr_late_init, dplane_vpp_new);
+	return 0;
+}
+
+FRR_MODULE_SETUP(
+	.name = "dplane_vpp",
+	.version = "0.0.1",
+	.description = "Data plane plugin programming the VPP FIB.",
+	.init = dplane_vpp_init,
+);
@@ -40,6 +40,7 @@
 
 #include "fa_node.h"
 #include "public_inlines.h"
+#include "tree_lookup.h"
 
 acl_main_t acl_main;
 
@@ -297,12 +298,27 @@ validate_and_reset_acl_counters (acl_main_t * am, u32 acl_index)
       vlib_clear_combined_counters (&am->combined_acl_counters[i]);
     }
 
+  old_len = vec_len (am->acl_hit_counters);
+  vec_validate (am->acl_hit_counters, acl_index);
+  for (i = old_len; i < vec_len (am->acl_hit_counters); i++)
+    {
+      am->acl_hit_counters[i].name = 0;
+      am->acl_hit_counters[i].stat_segment_name = (void *)
+	format (0, "/acl/%d/hits%c", i, 0);
+      i32 rule_count = vec_len (am->acls[i].rules);
+      vlib_validate_simple_counter (&am->acl_hit_counters[i], rule_count);
+      vlib_clear_simple_counters (&am->acl_hit_counters[i]);
+    }
+
   /* (re)validate for the actual ACL that is getting added/updated */
   i32 rule_count = vec_len (am->acls[acl_index].rules);
   /* Validate one extra so we always have at least one counter for an ACL */
   vlib_validate_combined_counter (&am->combined_acl_counters[acl_index],
 				  rule_count);
   vlib_clear_combined_counters (&am->combined_acl_counters[acl_index]);
+  vlib_validate_simple_counter (&am->acl_hit_counters[acl_index],
+				rule_count);
+  vlib_clear_simple_counters (&am->acl_hit_counters[acl_index]);
   acl_plugin_counter_unlock (am);
 }
 
@@ -313,6 +329,41 @@ acl_api_invalid_prefix (const vl_api_prefix_t * prefix)
   return ip_prefix_decode2 (prefix, &ip_prefix);
 }
 
+static int
+acl_api_rule_check (vl_api_acl_rule_t * rule)
+{
+  if (acl_api_invalid_prefix (&rule->src_prefix))
+    return VNET_API_ERROR_INVALID_SRC_ADDRESS;
+  if (acl_api_invalid_prefix (&rule->dst_prefix))
+    return VNET_API_ERROR_INVALID_DST_ADDRESS;
+  if (ntohs (rule->srcport_or_icmptype_first) >
+      ntohs (rule->srcport_or_icmptype_last))
+    return VNET_API_ERROR_INVALID_VALUE_2;
+  if (ntohs (rule->dstport_or_icmpcode_first) >
+      ntohs (rule->dstport_or_icmpcode_last))
+    return VNET_API_ERROR_INVALID_VALUE_2;
+  return 0;
+}
+
+static void
+acl_api_rule_decode (acl_rule_t * r, vl_api_acl_rule_t * rule)
+{
+  clib_memset (r, 0, sizeof (*r));
+  r->is_permit = rule->is_permit;
+  r->is_ipv6 = rule->src_prefix.address.af;
+  ip_address_decode (&rule->src_prefix.address, &r->src);
+  ip_address_decode (&rule->dst_prefix.address, &r->dst);
+  r->src_prefixlen = rule->src_prefix.len;
+  r->dst_prefixlen = rule->dst_prefix.len;
+  r->proto = rule->proto;
+  r->src_port_or_type_first = ntohs (rule->srcport_or_icmptype_first);
+  r->src_port_or_type_last = ntohs (rule->srcport_or_icmptype_last);
+  r->dst_port_or_code_first = ntohs (rule->dstport_or_icmpcode_first);
+  r->dst_port_or_code_last = ntohs (rule->dstport_or_icmpcode_last);
+  r->tcp_flags_value = rule->tcp_flags_value;
+  r->tcp_flags_mask = rule->tcp_flags_mask;
+}
+
 static int
 acl_add_list (u32 count, vl_api_acl_rule_t rules[],
 	      u32 * acl_list_index, u8 * tag)
@@ -335,16 +386,9 @@ acl_add_list (u32 count, vl_api_acl_rule_t rules[],
   /* check if what they request is consistent */
   for (i = 0; i < count; i++)
     {
-      if (acl_api_invalid_prefix (&rules[i].src_prefix))
-	return VNET_API_ERROR_INVALID_SRC_ADDRESS;
-      if (acl_api_invalid_prefix (&rules[i].dst_prefix))
-	return VNET_API_ERROR_INVALID_DST_ADDRESS;
-      if (ntohs (rules[i].srcport_or_icmptype_first) >
-	  ntohs (rules[i].srcport_or_icmptype_last))
-	return VNET_API_ERROR_INVALID_VALUE_2;
-      if (ntohs (rules[i].dstport_or_icmpcode_first) >
-	  ntohs (rules[i].dstport_or_icmpcode_last))
-	return VNET_API_ERROR_INVALID_VALUE_2;
+      int rv = acl_api_rule_check (&rules[i]);
+      if (rv)
+	return rv;
     }
 
   if (*acl_list_index != ~0)
@@ -373,20 +417,7 @@ acl_add_list (u32 count, vl_api_acl_rule_t rules[],
   for (i = 0; i < count; i++)
     {
       r = vec_elt_at_index (acl_new_rules, i);
-      clib_memset (r, 0, sizeof (*r));
-      r->is_permit = rules[i].is_permit;
-      r->is_ipv6 = rules[i].src_prefix.address.af;
-      ip_address_decode (&rules[i].src_prefix.address, &r->src);
-      ip_address_decode (&rules[i].dst_prefix.address, &r->dst);
-      r->src_prefixlen = rules[i].src_prefix.len;
-      r->dst_prefixlen = rules[i].dst_prefix.len;
-      r->proto = rules[i].proto;
-      r->src_port_or_type_first = ntohs (rules[i].srcport_or_icmptype_first);
-      r->src_port_or_type_last = ntohs (rules[i].srcport_or_icmptype_last);
-      r->dst_port_or_code_first = ntohs (rules[i].dstport_or_icmpcode_first);
-      r->dst_port_or_code_last = ntohs (rules[i].dstport_or_icmpcode_last);
-      r->tcp_flags_value = rules[i].tcp_flags_value;
-      r->tcp_flags_mask = rules[i].tcp_flags_mask;
+      acl_api_rule_decode (r, &rules[i]);
     }
 
   if (~0 == *acl_list_index)
@@ -418,6 +449,66 @@ acl_add_list (u32 count, vl_api_acl_rule_t rules[],
   return 0;
 }
 
+/*
+ * Insert, replace or delete a single rule of an existing ACL. Unlike
+ * replacing the whole ACL with acl_add_list, this only touches the lookup
+ * entries of that one rule wherever the ACL is applied.
+ */
+static int
+acl_edit_rule (u32 acl_list_index, u32 position, acl_ace_change_t change,
+	       vl_api_acl_rule_t * rule)
+{
+  acl_main_t *am = &acl_main;
+  acl_list_t *a;
+  acl_rule_t r;
+  int rv;
+
+  if (pool_is_free_index (am->acls, acl_list_index))
+    return VNET_API_ERROR_NO_SUCH_ENTRY;
+  a = pool_elt_at_index (am->acls, acl_list_index);
+
+  if (position > vec_len (a->rules)
+      || (change != ACL_ACE_INSERT && position == vec_len (a->rules)))
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  if (change != ACL_ACE_DELETE)
+    {
+      rv = acl_api_rule_check (rule);
+      if (rv)
+	return rv;
+      acl_api_rule_decode (&r, rule);
+    }
+
+  if (am->trace_acl > 255)
+    clib_warning ("API dbg: acl_edit_rule index %d position %d change %d",
+		  acl_list_index, position, change);
+
+  switch (change)
+    {
+    case ACL_ACE_INSERT:
+      vec_insert_elts (a->rules, &r, 1, position);
+      break;
+    case ACL_ACE_DELETE:
+      vec_delete (a->rules, 1, position);
+      break;
+    case ACL_ACE_REPLACE:
+      a->rules[position] = r;
+      break;
+    }
+
+  if (am->reclassify_sessions)
+    {
+      /* a change in an ACLs if they are applied may mean a new policy epoch */
+      policy_notify_acl_change (am, acl_list_index);
+    }
+  /* the per-rule counters follow the rule positions */
+  if (change != ACL_ACE_REPLACE)
+    validate_and_reset_acl_counters (am, acl_list_index);
+  acl_plugin_lookup_context_notify_ace_change (acl_list_index, position,
+					       change);
+  return 0;
+}
+
 static int
 acl_is_used_by (u32 acl_index, u32 ** foo_index_vec_by_acl)
 {
@@ -1827,6 +1918,45 @@ vl_api_acl_del_t_handler (vl_api_acl_del_t * mp)
   REPLY_MACRO (VL_API_ACL_DEL_REPLY);
 }
 
+static void
+vl_api_acl_rule_insert_t_handler (vl_api_acl_rule_insert_t * mp)
+{
+  acl_main_t *am = &acl_main;
+  vl_api_acl_rule_insert_reply_t *rmp;
+  int rv;
+
+  rv = acl_edit_rule (ntohl (mp->acl_index), ntohl (mp->position),
+		      ACL_ACE_INSERT, &mp->r);
+
+  REPLY_MACRO (VL_API_ACL_RULE_INSERT_REPLY);
+}
+
+static void
+vl_api_acl_rule_replace_t_handler (vl_api_acl_rule_replace_t * mp)
+{
+  acl_main_t *am = &acl_main;
+  vl_api_acl_rule_replace_reply_t *rmp;
+  int rv;
+
+  rv = acl_edit_rule (ntohl (mp->acl_index), ntohl (mp->position),
+		      ACL_ACE_REPLACE, &mp->r);
+
+  REPLY_MACRO (VL_API_ACL_RULE_REPLACE_REPLY);
+}
+
+static void
+vl_api_acl_rule_delete_t_handler (vl_api_acl_rule_delete_t * mp)
+{
+  acl_main_t *am = &acl_main;
+  vl_api_acl_rule_delete_reply_t *rmp;
+  int rv;
+
+  rv = acl_edit_rule (ntohl (mp->acl_index), ntohl (mp->position),
+		      ACL_ACE_DELETE, 0);
+
+  REPLY_MACRO (VL_API_ACL_RULE_DELETE_REPLY);
+}
+
 
 static void
   vl_api_acl_stats_intf_counters_enable_t_handler
@@ -2577,6 +2707,12 @@ acl_set_aclplugin_fn (vlib_main_t * vm,
       am->use_hash_acl_matching = (val != 0);
       goto done;
     }
+  if (unformat (input, "use-tree-acl-matching %u", &val))
+    {
+      am->use_tree_acl_matching = (val != 0);
+      tree_acl_rebuild_all (am);
+      goto done;
+    }
   if (unformat (input, "l4-match-nonfirst-fragment %u", &val))
     {
       am->l4_match_nonfirst_fragment = (val != 0);
@@ -3435,6 +3571,7 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
   int show_applied_info = 0;
   int show_mask_type = 0;
   int show_bihash = 0;
+  int show_tree = 0;
   u32 show_bihash_verbose = 0;
 
   if (unformat (input, "acl"))
@@ -3458,21 +3595,29 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
       show_bihash = 1;
       unformat (input, "verbose %u", &show_bihash_verbose);
     }
+  else if (unformat (input, "tree"))
+    {
+      show_tree = 1;
+      unformat (input, "lc_index %u", &lc_index);
+    }
 
   if (!
       (show_mask_type || show_acl_hash_info || show_applied_info
-       || show_bihash))
+       || show_bihash || show_tree))
     {
       /* if no qualifiers specified, show all */
       show_mask_type = 1;
       show_acl_hash_info = 1;
       show_applied_info = 1;
       show_bihash = 1;
+      show_tree = 1;
     }
   vlib_cli_output (vm, "Stats counters enabled for interface ACLs: %d",
 		   acl_main.interface_acl_counters_enabled);
   vlib_cli_output (vm, "Use hash-based lookup for ACLs: %d",
 		   acl_main.use_hash_acl_matching);
+  vlib_cli_output (vm, "Use decision tree lookup for ACLs: %d",
+		   acl_main.use_tree_acl_matching);
   if (show_mask_type)
     acl_plugin_show_tables_mask_type ();
   if (show_acl_hash_info)
@@ -3481,6 +3626,8 @@ acl_show_aclplugin_tables_fn (vlib_main_t * vm,
     acl_plugin_show_tables_applied_info (lc_index);
   if (show_bihash)
     acl_plugin_show_tables_bihash (show_bihash_verbose);
+  if (show_tree)
+    acl_plugin_show_tables_tree (lc_index);
 
   return error;
 }
@@ -3496,6 +3643,417 @@ acl_clear_aclplugin_fn (vlib_main_t * vm,
   return error;
 }
 
+static void
+acl_match_perf_fill_addr (u8 * addr, u32 len, u8 * prefix, u32 prefixlen,
+			  u32 * seed)
+{
+  u32 i, bits;
+  u8 mask;
+
+  for (i = 0; i < len; i++)
+    {
+      bits = prefixlen > 8 * i ? clib_min (prefixlen - 8 * i, 8) : 0;
+      mask = bits ? 0xff << (8 - bits) : 0;
+      addr[i] = (random_u32 (seed) & ~mask) | (prefix[i] & mask);
+    }
+}
+
+/*
+ * Make up a 5-tuple of a first packet of a flow, either within
+ * the given rule or (r == 0) random.
+ */
+static void
+acl_match_perf_fill_5tuple (fa_5tuple_t * t, acl_rule_t * r, int is_ip6,
+			    u32 lc_index, u32 * seed)
+{
+  u8 zero[16] = { 0 };
+  u32 len = is_ip6 ? 16 : 4;
+  u8 *src, *dst;
+
+  clib_memset (t, 0, sizeof (*t));
+  src = is_ip6 ? t->ip6_addr[0].as_u8 : t->ip4_addr[0].as_u8;
+  dst = is_ip6 ? t->ip6_addr[1].as_u8 : t->ip4_addr[1].as_u8;
+
+  if (r)
+    {
+      acl_match_perf_fill_addr (src, len, is_ip6 ? r->src.ip6.as_u8 :
+				r->src.ip4.as_u8, r->src_prefixlen, seed);
+      acl_match_perf_fill_addr (dst, len, is_ip6 ? r->dst.ip6.as_u8 :
+				r->dst.ip4.as_u8, r->dst_prefixlen, seed);
+      t->l4.proto = r->proto ? r->proto : IP_PROTOCOL_TCP;
+      t->l4.port[0] = r->src_port_or_type_first +
+	random_u32 (seed) % (r->src_port_or_type_last -
+			     r->src_port_or_type_first + 1);
+      t->l4.port[1] = r->dst_port_or_code_first +
+	random_u32 (seed) % (r->dst_port_or_code_last -
+			     r->dst_port_or_code_first + 1);
+      t->pkt.tcp_flags = r->tcp_flags_value;
+    }
+  else
+    {
+      acl_match_perf_fill_addr (src, len, zero, 0, seed);
+      acl_match_perf_fill_addr (dst, len, zero, 0, seed);
+      t->l4.proto = random_u32 (seed) & 1 ? IP_PROTOCOL_TCP : IP_PROTOCOL_UDP;
+      t->l4.port[0] = random_u32 (seed);
+      t->l4.port[1] = random_u32 (seed);
+      t->pkt.tcp_flags = TCP_FLAG_SYN;
+    }
+
+  t->pkt.tcp_flags_valid = t->l4.proto == IP_PROTOCOL_TCP;
+  t->pkt.l4_valid = 1;
+  t->pkt.is_ip6 = is_ip6;
+  t->pkt.lc_index = lc_index;
+}
+
+/*
+ * Measure the rate of ACL lookups of packets without a session, per-packet
+ * and batched, for the given ACLs. Half of the 5-tuples are made up to fall
+ * within a random rule of the ACLs, the other half are random. With the
+ * decision tree matching on, the tree is measured and checked as well.
+ */
+static clib_error_t *
+acl_test_aclplugin_match_perf_fn (vlib_main_t * vm,
+				  unformat_input_t * input,
+				  vlib_cli_command_t * cmd)
+{
+  acl_main_t *am = &acl_main;
+  u32 *acls = 0, acl_index, *acl_p;
+  u32 n_flows = 100000, n_iter = 10, n_aces = 0, seed = 0xdeadbeef;
+  u32 i, j, iter, n, n_mismatch = 0;
+  u32 *scalar_result = 0, *batch_result = 0, n_tree_mismatch = 0;
+  u64 *tree_result = 0;
+  fa_5tuple_t *tuples = 0, *batch[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  acl_rule_t **rules = 0, *r;
+  applied_hash_ace_entry_t *paes;
+  acl_tree_t *tree;
+  int is_ip6 = 0;
+  u32 user_id, lc_index;
+  clib_error_t *error = 0;
+  f64 t0, t_scalar, t_batch, t_tree = 0;
+  unformat_input_t _line_input, *line_input = &_line_input;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "acl %u", &acl_index))
+	{
+	  if (pool_is_free_index (am->acls, acl_index))
+	    {
+	      error = clib_error_return (0, "ACL %u does not exist",
+					 acl_index);
+	      goto done;
+	    }
+	  vec_add1 (acls, acl_index);
+	}
+      else if (unformat (line_input, "flows %u", &n_flows))
+	;
+      else if (unformat (line_input, "iterations %u", &n_iter))
+	;
+      else if (unformat (line_input, "ip6"))
+	is_ip6 = 1;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (!vec_len (acls) || !n_flows || !n_iter)
+    {
+      error = clib_error_return (0, "at least one ACL, flows and "
+				 "iterations required");
+      goto done;
+    }
+  if (!am->use_hash_acl_matching)
+    {
+      error = clib_error_return (0, "hash-based ACL lookup is disabled");
+      goto done;
+    }
+
+  vec_foreach (acl_p, acls)
+    {
+      vec_foreach (r, am->acls[*acl_p].rules)
+	{
+	  n_aces++;
+	  if (r->is_ipv6 == is_ip6)
+	    vec_add1 (rules, r);
+	}
+    }
+
+  user_id = acl_plugin.register_user_module ("ACL match perf test", "unused",
+					     "unused");
+  lc_index = acl_plugin.get_lookup_context_index (user_id, 0, 0);
+  if (acl_plugin.set_acl_vec_for_context (lc_index, acls))
+    {
+      acl_plugin.put_lookup_context_index (lc_index);
+      error = clib_error_return (0, "could not apply the ACLs");
+      goto done;
+    }
+
+  vec_validate (tuples, n_flows - 1);
+  vec_validate (scalar_result, n_flows - 1);
+  vec_validate (batch_result, n_flows - 1);
+  for (i = 0; i < n_flows; i++)
+    {
+      r = vec_len (rules) && (random_u32 (&seed) & 1) ?
+	rules[random_u32 (&seed) % vec_len (rules)] : 0;
+      acl_match_perf_fill_5tuple (&tuples[i], r, is_ip6, lc_index, &seed);
+    }
+
+  t0 = vlib_time_now (vm);
+  for (iter = 0; iter < n_iter; iter++)
+    for (i = 0; i < n_flows; i++)
+      scalar_result[i] =
+	multi_acl_match_get_applied_ace_index (am, is_ip6, &tuples[i]);
+  t_scalar = vlib_time_now (vm) - t0;
+
+  t0 = vlib_time_now (vm);
+  for (iter = 0; iter < n_iter; iter++)
+    for (i = 0; i < n_flows; i += n)
+      {
+	n = clib_min (n_flows - i, ACL_PLUGIN_MATCH_BATCH_SIZE);
+	for (j = 0; j < n; j++)
+	  batch[j] = &tuples[i + j];
+	multi_acl_match_get_applied_ace_index_xN (am, is_ip6, lc_index, batch,
+						  n, &batch_result[i]);
+      }
+  t_batch = vlib_time_now (vm) - t0;
+
+  for (i = 0; i < n_flows; i++)
+    n_mismatch += scalar_result[i] != batch_result[i];
+
+  tree = acl_plugin_tree_for_5tuple (am, lc_index, &tuples[0]);
+  if (tree)
+    {
+      u32 acl_pos, acl_match, rule_match;
+      u8 action;
+
+      vec_validate (tree_result, n_flows - 1);
+      t0 = vlib_time_now (vm);
+      for (iter = 0; iter < n_iter; iter++)
+	for (i = 0; i < n_flows; i++)
+	  tree_result[i] =
+	    tree_multi_acl_match_5tuple (am, tree, &tuples[i], is_ip6,
+					 &action, &acl_pos, &acl_match,
+					 &rule_match) ?
+	    ((u64) acl_match << 32) | rule_match : ~0ULL;
+      t_tree = vlib_time_now (vm) - t0;
+
+      /* the hash and the tree must agree on the first matching ACE */
+      paes = am->hash_entry_vec_by_lc_index[lc_index];
+      for (i = 0; i < n_flows; i++)
+	{
+	  u64 hash_ace = ~0ULL;
+	  if (scalar_result[i] < vec_len (paes))
+	    hash_ace = ((u64) paes[scalar_result[i]].acl_index << 32) |
+	      paes[scalar_result[i]].ace_index;
+	  n_tree_mismatch += tree_result[i] != hash_ace;
+	}
+    }
+
+  vlib_cli_output (vm, "%u ACEs in %u ACLs, %u %s flows x %u iterations",
+		   n_aces, vec_len (acls), n_flows, is_ip6 ? "IPv6" : "IPv4",
+		   n_iter);
+  vlib_cli_output (vm, "  per-packet: %.2f new flows/s",
+		   (f64) n_flows * n_iter / t_scalar);
+  vlib_cli_output (vm, "  batched:    %.2f new flows/s",
+		   (f64) n_flows * n_iter / t_batch);
+  vlib_cli_output (vm, "  mismatches: %u", n_mismatch);
+  if (tree)
+    {
+      vlib_cli_output (vm, "  tree:       %.2f new flows/s",
+		       (f64) n_flows * n_iter / t_tree);
+      vlib_cli_output (vm, "  tree mismatches: %u", n_tree_mismatch);
+    }
+
+  acl_plugin.put_lookup_context_index (lc_index);
+
+done:
+  unformat_free (line_input);
+  vec_free (acls);
+  vec_free (rules);
+  vec_free (tuples);
+  vec_free (scalar_result);
+  vec_free (batch_result);
+  vec_free (tree_result);
+  return error;
+}
+
+/* Make up a random IPv4 TCP or UDP rule with a destination port range */
+static void
+acl_edit_perf_fill_rule (vl_api_acl_rule_t * r, u32 * seed)
+{
+  u32 src_len = 8 + random_u32 (seed) % 25;
+  u32 dst_len = 8 + random_u32 (seed) % 25;
+  u32 src = random_u32 (seed) & ~pow2_mask (32 - src_len);
+  u32 dst = random_u32 (seed) & ~pow2_mask (32 - dst_len);
+  u16 dport = random_u32 (seed);
+
+  clib_memset (r, 0, sizeof (*r));
+  r->is_permit = random_u32 (seed) & 1 ? ACL_ACTION_API_PERMIT :
+    ACL_ACTION_API_DENY;
+  r->src_prefix.address.af = ADDRESS_IP4;
+  r->src_prefix.len = src_len;
+  *(u32 *) r->src_prefix.address.un.ip4 = clib_host_to_net_u32 (src);
+  r->dst_prefix.address.af = ADDRESS_IP4;
+  r->dst_prefix.len = dst_len;
+  *(u32 *) r->dst_prefix.address.un.ip4 = clib_host_to_net_u32 (dst);
+  r->proto = random_u32 (seed) & 1 ? IP_PROTOCOL_TCP : IP_PROTOCOL_UDP;
+  r->srcport_or_icmptype_last = 0xffff;
+  r->dstport_or_icmpcode_first = clib_host_to_net_u16 (dport);
+  r->dstport_or_icmpcode_last =
+    clib_host_to_net_u16 (clib_min (0xffff,
+				    dport + random_u32 (seed) % 1024));
+}
+
+/*
+ * Measure the latency of the single rule edits of an ACL applied to a number
+ * of lookup contexts, against replacing the whole ACL, and check the hash
+ * lookup and the decision tree, if any, still agree with the linear walk of
+ * the ACL afterwards.
+ */
+static clib_error_t *
+acl_test_aclplugin_edit_perf_fn (vlib_main_t * vm,
+				 unformat_input_t * input,
+				 vlib_cli_command_t * cmd)
+{
+  acl_main_t *am = &acl_main;
+  u32 n_rules = 1000, n_contexts = 1, n_edits = 100, seed = 0xdeadbeef;
+  u32 n_flows = 10000, n_mismatch = 0, n_tree_mismatch = 0;
+  u32 acl_index = ~0, user_id, *lc_indices = 0, *acls = 0;
+  u32 i, position;
+  vl_api_acl_rule_t *rules = 0, rule;
+  fa_5tuple_t t;
+  applied_hash_ace_entry_t *paes;
+  acl_tree_t *tree = 0;
+  clib_error_t *error = 0;
+  f64 t0, t_replace, t_insert = 0, t_delete = 0, t_edit = 0;
+  u8 *tag = (u8 *) "edit-perf";
+  unformat_input_t _line_input, *line_input = &_line_input;
+
+  if (unformat_user (input, unformat_line_input, line_input))
+    {
+      while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+	{
+	  if (unformat (line_input, "rules %u", &n_rules))
+	    ;
+	  else if (unformat (line_input, "contexts %u", &n_contexts))
+	    ;
+	  else if (unformat (line_input, "edits %u", &n_edits))
+	    ;
+	  else
+	    {
+	      error = clib_error_return (0, "unknown input `%U'",
+					 format_unformat_error, line_input);
+	      unformat_free (line_input);
+	      return error;
+	    }
+	}
+      unformat_free (line_input);
+    }
+
+  if (!n_rules || !n_contexts || !n_edits)
+    return clib_error_return (0, "rules, contexts and edits must be "
+			      "non-zero");
+  if (!am->use_hash_acl_matching)
+    return clib_error_return (0, "hash-based ACL lookup is disabled");
+
+  vec_validate (rules, n_rules - 1);
+  for (i = 0; i < n_rules; i++)
+    acl_edit_perf_fill_rule (&rules[i], &seed);
+  if (acl_add_list (n_rules, rules, &acl_index, tag))
+    {
+      error = clib_error_return (0, "could not create the ACL");
+      goto done;
+    }
+
+  vec_add1 (acls, acl_index);
+  user_id = acl_plugin.register_user_module ("ACL edit perf test", "unused",
+					     "unused");
+  for (i = 0; i < n_contexts; i++)
+    {
+      u32 lc_index = acl_plugin.get_lookup_context_index (user_id, i, 0);
+      vec_add1 (lc_indices, lc_index);
+      acl_plugin.set_acl_vec_for_context (lc_index, acls);
+    }
+
+  /* the whole ACL gets redone in every lookup context */
+  t0 = vlib_time_now (vm);
+  acl_add_list (n_rules, rules, &acl_index, tag);
+  t_replace = vlib_time_now (vm) - t0;
+
+  for (i = 0; i < n_edits; i++)
+    {
+      acl_edit_perf_fill_rule (&rule, &seed);
+      position = random_u32 (&seed) % (n_rules + 1);
+      t0 = vlib_time_now (vm);
+      acl_edit_rule (acl_index, position, ACL_ACE_INSERT, &rule);
+      t_insert += vlib_time_now (vm) - t0;
+
+      acl_edit_perf_fill_rule (&rule, &seed);
+      position = random_u32 (&seed) % (n_rules + 1);
+      t0 = vlib_time_now (vm);
+      acl_edit_rule (acl_index, position, ACL_ACE_REPLACE, &rule);
+      t_edit += vlib_time_now (vm) - t0;
+
+      position = random_u32 (&seed) % (n_rules + 1);
+      t0 = vlib_time_now (vm);
+      acl_edit_rule (acl_index, position, ACL_ACE_DELETE, 0);
+      t_delete += vlib_time_now (vm) - t0;
+    }
+
+  /* the first matching ACE must be the same as with the linear walk */
+  paes = am->hash_entry_vec_by_lc_index[lc_indices[0]];
+  for (i = 0; i < n_flows; i++)
+    {
+      acl_rule_t *r = vec_elt_at_index (am->acls[acl_index].rules,
+					random_u32 (&seed) % n_rules);
+      u32 hash_ace = ~0, linear_ace = ~0, tree_ace = ~0, acl_match, index;
+      u32 acl_pos, trace_bitmap;
+      u8 action;
+
+      acl_match_perf_fill_5tuple (&t, (i & 1) ? r : 0, 0, lc_indices[0],
+				  &seed);
+      index = multi_acl_match_get_applied_ace_index (am, 0, &t);
+      if (index < vec_len (paes))
+	hash_ace = paes[index].ace_index;
+      single_acl_match_5tuple (am, acl_index, &t, 0, &action, &acl_match,
+			       &linear_ace, &trace_bitmap);
+      n_mismatch += hash_ace != linear_ace;
+
+      tree = acl_plugin_tree_for_5tuple (am, lc_indices[0], &t);
+      if (tree)
+	{
+	  tree_multi_acl_match_5tuple (am, tree, &t, 0, &action, &acl_pos,
+				       &acl_match, &tree_ace);
+	  n_tree_mismatch += tree_ace != linear_ace;
+	}
+    }
+
+  vlib_cli_output (vm, "ACL of %u rules applied in %u lookup contexts",
+		   n_rules, n_contexts);
+  vlib_cli_output (vm, "  replace ACL:  %.2f us", t_replace * 1e6);
+  vlib_cli_output (vm, "  insert rule:  %.2f us", t_insert * 1e6 / n_edits);
+  vlib_cli_output (vm, "  replace rule: %.2f us", t_edit * 1e6 / n_edits);
+  vlib_cli_output (vm, "  delete rule:  %.2f us", t_delete * 1e6 / n_edits);
+  vlib_cli_output (vm, "  mismatches: %u", n_mismatch);
+  if (tree)
+    vlib_cli_output (vm, "  tree mismatches: %u", n_tree_mismatch);
+
+  vec_foreach_index (i, lc_indices)
+    acl_plugin.put_lookup_context_index (lc_indices[i]);
+  acl_del_list (acl_index);
+
+done:
+  vec_free (rules);
+  vec_free (acls);
+  vec_free (lc_indices);
+  return error;
+}
+
  /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (aclplugin_set_command, static) = {
     .path = "set acl-plugin",
@@ -3547,7 +4105,7 @@ VLIB_CLI_COMMAND (aclplugin_show_sessions_command, static) = {
 
 VLIB_CLI_COMMAND (aclplugin_show_tables_command, static) = {
     .path = "show acl-plugin tables",
-    .short_help = "show acl-plugin tables [ acl [index N] | applied [ lc_index N ] | mask | hash [verbose N] ]",
+    .short_help = "show acl-plugin tables [ acl [index N] | applied [ lc_index N ] | mask | hash [verbose N] | tree [ lc_index N ] ]",
     .function = acl_show_aclplugin_tables_fn,
 };
 
@@ -3569,6 +4127,34 @@ VLIB_CLI_COMMAND (aclplugin_clear_command, static) = {
     .function = acl_clear_aclplugin_fn,
 };
 
+/*?
+ * Measure the rate at which packets without a session are classified
+ * by the hash-based ACL lookup, one at a time and in batches.
+ *
+ * @cliexpar
+ * <b><em> test acl-plugin match-perf acl <index> [acl <index> ...]
+ * [flows <n>] [iterations <n>] [ip6]</b></em>
+ ?*/
+VLIB_CLI_COMMAND (aclplugin_test_match_perf_command, static) = {
+    .path = "test acl-plugin match-perf",
+    .short_help = "test acl-plugin match-perf acl <index> [acl <index> ...] [flows <n>] [iterations <n>] [ip6]",
+    .function = acl_test_aclplugin_match_perf_fn,
+};
+
+/*?
+ * Measure how long it takes to insert, replace and delete a single rule
+ * of an ACL applied to a number of lookup contexts, compared to replacing
+ * the whole ACL.
+ *
+ * @cliexpar
+ * <b><em> test acl-plugin edit-perf [rules <n>] [contexts <n>] [edits <n>]</b></em>
+ ?*/
+VLIB_CLI_COMMAND (aclplugin_test_edit_perf_command, static) = {
+    .path = "test acl-plugin edit-perf",
+    .short_help = "test acl-plugin edit-perf [rules <n>] [contexts <n>] [edits <n>]",
+    .function = acl_test_aclplugin_edit_perf_fn,
+};
+
 /*?
  * [un]Apply an ACL to an interface.
  *  The ACL is applied in a given direction, either input or output.
@@ -3619,6 +4205,7 @@ acl_plugin_config (vlib_main_t * vm, unformat_input_t * input)
   uword hash_lookup_hash_memory;
   u32 reclassify_sessions;
   u32 use_tuple_merge;
+  u32 use_tree_matching;
   u32 tuple_merge_split_threshold;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
@@ -3657,6 +4244,8 @@ acl_plugin_config (vlib_main_t * vm, unformat_input_t * input)
 	am->hash_lookup_hash_memory = hash_lookup_hash_memory;
       else if (unformat (input, "use tuple merge %d", &use_tuple_merge))
 	am->use_tuple_merge = use_tuple_merge;
+      else if (unformat (input, "use tree matching %d", &use_tree_matching))
+	am->use_tree_acl_matching = use_tree_matching;
       else
 	if (unformat
 	    (input, "tuple merge split threshold %d",
@@ -32,6 +32,7 @@
 #include "types.h"
 #include "fa_node.h"
 #include "hash_lookup_types.h"
+#include "tree_lookup_types.h"
 #include "lookup_context.h"
 
 #define  ACL_PLUGIN_VERSION_MAJOR 1
@@ -179,6 +180,11 @@ typedef struct {
   /* Do we use the TupleMerge for hash ACLs or not */
   int use_tuple_merge;
 
+  /* Do we use the compiled decision tree rather than the hash matching */
+  int use_tree_acl_matching;
+  /* decision tree by lc_index, 0 if not built */
+  acl_tree_t **tree_by_lc_index;
+
   /* Max collision vector length before splitting the tuple */
 #define TM_SPLIT_THRESHOLD 39
   int tuple_merge_split_threshold;
@@ -299,6 +305,8 @@ typedef struct {
   /* acl counters exposed via stats segment */
   volatile u32 *acl_counter_lock;
   vlib_combined_counter_main_t *combined_acl_counters;
+  /* per-thread hash lookup hits by [acl#][ace#], always on */
+  vlib_simple_counter_main_t *acl_hit_counters;
   /* enable/disable ACL counters for interface processing */
   u32 interface_acl_counters_enabled;
 } acl_main_t;
@@ -330,6 +330,14 @@ static int api_macip_acl_interface_list_dump (vat_main_t * vam)
 {
   return 0;
 }
+static int api_acl_rule_insert (vat_main_t * vam)
+{
+  return 0;
+}
+static int api_acl_rule_replace (vat_main_t * vam)
+{
+  return 0;
+}
 
 static int api_acl_add_replace (vat_main_t * vam)
 {
@@ -815,6 +823,32 @@ static int api_acl_del (vat_main_t * vam)
     return ret;
 }
 
+static int api_acl_rule_delete (vat_main_t * vam)
+{
+    unformat_input_t * i = vam->input;
+    vl_api_acl_rule_delete_t * mp;
+    u32 acl_index = ~0;
+    u32 position = ~0;
+    int ret;
+
+    if (!unformat (i, "%d %d", &acl_index, &position)) {
+      errmsg ("missing acl index or position\n");
+      return -99;
+    }
+
+    /* Construct the API message */
+    M(ACL_RULE_DELETE, mp);
+    mp->acl_index = ntohl(acl_index);
+    mp->position = ntohl(position);
+
+    /* send it... */
+    S(mp);
+
+    /* Wait for a reply... */
+    W (ret);
+    return ret;
+}
+
 static int api_macip_acl_del (vat_main_t * vam)
 {
     unformat_input_t * i = vam->input;
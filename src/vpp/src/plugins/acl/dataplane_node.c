@@ -318,6 +318,106 @@ acl_fa_node_common_prepare_fn (vlib_main_t * vm,
     }
 }
 
+/*
+ * Look up the sessions of the whole frame, with the bucket and the
+ * data prefetches for the session bihash running ahead of the lookups.
+ */
+always_inline void
+acl_fa_node_find_sessions (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+			   u32 n_pkts, int is_ip6)
+{
+  u32 *sw_if_index = pw->sw_if_indices;
+  fa_5tuple_t *fa_5tuple = pw->fa_5tuples;
+  u64 *hash = pw->hashes;
+  u32 i;
+
+  for (i = 0; i < n_pkts; i++)
+    {
+      if (i + 4 < n_pkts)
+	acl_fa_prefetch_session_bucket_for_hash (am, is_ip6, hash[i + 4]);
+      if (i + 2 < n_pkts)
+	acl_fa_prefetch_session_data_for_hash (am, is_ip6, hash[i + 2]);
+      acl_fa_find_session_with_hash (am, is_ip6, sw_if_index[i], hash[i],
+				     &fa_5tuple[i],
+				     &pw->session_ids[i].as_u64);
+    }
+}
+
+always_inline void
+acl_fa_node_match_batch (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+			 int is_ip6, u32 lc_index, u32 * pkt_index,
+			 u32 n_pkts)
+{
+  fa_5tuple_t *match[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  u32 match_index[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  u32 i;
+
+  for (i = 0; i < n_pkts; i++)
+    match[i] = &pw->fa_5tuples[pkt_index[i]];
+
+  multi_acl_match_get_applied_ace_index_xN (am, is_ip6, lc_index, match,
+					    n_pkts, match_index);
+
+  for (i = 0; i < n_pkts; i++)
+    pw->ace_match_indices[pkt_index[i]] = match_index[i];
+}
+
+/*
+ * Run the hash ACL lookup of the packets without a session in batches,
+ * so that their bihash cache misses overlap. Packets are batched as long
+ * as they share the lookup context, which is the common case of a frame
+ * received on or sent to one interface. Non-first fragments, linear
+ * matching and the lookup contexts which have a decision tree are left
+ * to the per-packet path; a context whose tree could not be built falls
+ * back to the hash matching and is batched.
+ */
+always_inline void
+acl_fa_node_match_new_flows (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+			     u32 n_pkts, int is_ip6, int is_input,
+			     int with_stateful_datapath)
+{
+  u32 pkt_index[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  u32 i, lc_index, batch_lc_index = ~0, n_batch = 0;
+  fa_5tuple_t *fa_5tuple;
+
+  clib_memset_u32 (pw->ace_match_indices, ~0, n_pkts);
+
+  if (!am->use_hash_acl_matching)
+    return;
+
+  for (i = 0; i < n_pkts; i++)
+    {
+      fa_5tuple = &pw->fa_5tuples[i];
+      if (with_stateful_datapath && pw->session_ids[i].as_u64 != ~0ULL)
+	continue;
+      if (PREDICT_FALSE (fa_5tuple->pkt.is_nonfirst_fragment))
+	continue;
+
+      if (is_input)
+	lc_index = am->input_lc_index_by_sw_if_index[pw->sw_if_indices[i]];
+      else
+	lc_index = am->output_lc_index_by_sw_if_index[pw->sw_if_indices[i]];
+      if (acl_plugin_tree_for_5tuple (am, lc_index, fa_5tuple))
+	continue;
+
+      if (n_batch &&
+	  (lc_index != batch_lc_index ||
+	   n_batch == ACL_PLUGIN_MATCH_BATCH_SIZE))
+	{
+	  acl_fa_node_match_batch (am, pw, is_ip6, batch_lc_index, pkt_index,
+				   n_batch);
+	  n_batch = 0;
+	}
+
+      fa_5tuple->pkt.lc_index = lc_index;
+      batch_lc_index = lc_index;
+      pkt_index[n_batch++] = i;
+    }
+
+  if (n_batch)
+    acl_fa_node_match_batch (am, pw, is_ip6, batch_lc_index, pkt_index,
+			     n_batch);
+}
 
 always_inline uword
 acl_fa_inner_node_fn (vlib_main_t * vm,
@@ -343,11 +443,16 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
   u32 *sw_if_index;
   fa_5tuple_t *fa_5tuple;
   u64 *hash;
+  fa_full_session_id_t *session_id;
+  u32 *ace_match_index;
   /* for the delayed counters */
   u32 saved_matched_acl_index = 0;
   u32 saved_matched_ace_index = 0;
   u32 saved_packet_count = 0;
   u32 saved_byte_count = 0;
+  /* sessions added or deleted by the packets of this frame so far */
+  int sessions_added = 0;
+  int sessions_deleted = 0;
 
   error_node = vlib_node_get_runtime (vm, node->node_index);
   no_error_existing_session =
@@ -358,22 +463,23 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
   sw_if_index = pw->sw_if_indices;
   fa_5tuple = pw->fa_5tuples;
   hash = pw->hashes;
+  session_id = pw->session_ids;
+  ace_match_index = pw->ace_match_indices;
 
   /*
    * Now the "hard" work of session lookups and ACL lookups for new sessions.
-   * Due to the complexity, do it for the time being in single loop with
-   * the pipeline of three prefetches:
-   *    1) bucket for the session bihash
-   *    2) data for the session bihash
-   *    3) worker session record
+   * The session lookups are done for the whole frame first, and then
+   * the ACL lookups for the packets which missed, in batches. The single
+   * loop below then only prefetches the worker session record one packet
+   * ahead. Once a packet of the frame has added a session, the later
+   * packets which missed are looked up again, and once one has deleted a
+   * session all the later packets are.
    */
-
-  fa_full_session_id_t f_sess_id_next = {.as_u64 = ~0ULL };
-
-  /* find the "next" session so we can kickstart the pipeline */
   if (with_stateful_datapath)
-    acl_fa_find_session_with_hash (am, is_ip6, sw_if_index[0], hash[0],
-				   &fa_5tuple[0], &f_sess_id_next.as_u64);
+    acl_fa_node_find_sessions (am, pw, frame->n_vectors, is_ip6);
+
+  acl_fa_node_match_new_flows (am, pw, frame->n_vectors, is_ip6, is_input,
+			       with_stateful_datapath);
 
   n_left = frame->n_vectors;
   while (n_left > 0)
@@ -391,24 +497,19 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
 
       if (with_stateful_datapath)
 	{
-	  fa_full_session_id_t f_sess_id = f_sess_id_next;
+	  if (PREDICT_FALSE (sessions_deleted ||
+			     (sessions_added && session_id[0].as_u64 == ~0ULL)))
+	    acl_fa_find_session_with_hash (am, is_ip6, sw_if_index[0],
+					   hash[0], &fa_5tuple[0],
+					   &session_id[0].as_u64);
+
+	  fa_full_session_id_t f_sess_id = session_id[0];
 	  switch (n_left)
 	    {
 	    default:
-	      acl_fa_prefetch_session_bucket_for_hash (am, is_ip6, hash[5]);
-	      /* fallthrough */
-	    case 5:
-	    case 4:
-	      acl_fa_prefetch_session_data_for_hash (am, is_ip6, hash[3]);
-	      /* fallthrough */
-	    case 3:
-	    case 2:
-	      acl_fa_find_session_with_hash (am, is_ip6, sw_if_index[1],
-					     hash[1], &fa_5tuple[1],
-					     &f_sess_id_next.as_u64);
-	      if (f_sess_id_next.as_u64 != ~0ULL)
+	      if (session_id[1].as_u64 != ~0ULL)
 		{
-		  prefetch_session_entry (am, f_sess_id_next);
+		  prefetch_session_entry (am, session_id[1]);
 		}
 	      /* fallthrough */
 	    case 1:
@@ -445,19 +546,11 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
 			    f_sess_id)))
 			{
 			  acl_check_needed = 1;
+			  sessions_deleted = 1;
 			  if (node_trace_on)
 			    {
 			      trace_bitmap |= 0x40000000;
 			    }
-			  /*
-			   * If we have just deleted the session, and the next
-			   * buffer is the same 5-tuple, that session prediction
-			   * is wrong, correct it.
-			   */
-			  if ((f_sess_id_next.as_u64 != ~0ULL)
-			      && 0 == memcmp (&fa_5tuple[1], &fa_5tuple[0],
-					      sizeof (fa_5tuple[1])))
-			    f_sess_id_next.as_u64 = ~0ULL;
 			}
 		    }
 		}
@@ -472,13 +565,22 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
 		  am->output_lc_index_by_sw_if_index[sw_if_index[0]];
 
 	      action = 0;	/* deny by default */
-	      int is_match = acl_plugin_match_5tuple_inline (am, lc_index0,
-							     (fa_5tuple_opaque_t *) & fa_5tuple[0], is_ip6,
-							     &action,
-							     &match_acl_pos,
-							     &match_acl_in_index,
-							     &match_rule_index,
-							     &trace_bitmap);
+	      int is_match;
+	      if (PREDICT_TRUE (ace_match_index[0] != ~0))
+		is_match = hash_multi_acl_match_result (am, lc_index0,
+							ace_match_index[0],
+							&action,
+							&match_acl_pos,
+							&match_acl_in_index,
+							&match_rule_index);
+	      else
+		is_match = acl_plugin_match_5tuple_inline (am, lc_index0,
+							   (fa_5tuple_opaque_t *) & fa_5tuple[0], is_ip6,
+							   &action,
+							   &match_acl_pos,
+							   &match_acl_in_index,
+							   &match_rule_index,
+							   &trace_bitmap);
 	      if (PREDICT_FALSE
 		  (is_match && am->interface_acl_counters_enabled))
 		{
@@ -508,9 +610,12 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
 	      if (2 == action)
 		{
 		  if (!acl_fa_can_add_session (am, is_input, sw_if_index[0]))
-		    acl_fa_try_recycle_session (am, is_input,
-						thread_index,
-						sw_if_index[0], now);
+		    {
+		      acl_fa_try_recycle_session (am, is_input,
+						  thread_index,
+						  sw_if_index[0], now);
+		      sessions_deleted = 1;
+		    }
 
 		  if (acl_fa_can_add_session (am, is_input, sw_if_index[0]))
 		    {
@@ -534,14 +639,7 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
 						   node_trace_on,
 						   &trace_bitmap);
 		      pkts_new_session++;
-		      /*
-		       * If the next 5tuple is the same and we just added the session,
-		       * the f_sess_id_next can not be ~0. Correct it.
-		       */
-		      if ((f_sess_id_next.as_u64 == ~0ULL)
-			  && 0 == memcmp (&fa_5tuple[1], &fa_5tuple[0],
-					  sizeof (fa_5tuple[1])))
-			f_sess_id_next = f_sess_id;
+		      sessions_added = 1;
 		    }
 		  else
 		    {
@@ -574,6 +672,8 @@ acl_fa_inner_node_fn (vlib_main_t * vm,
 	  fa_5tuple++;
 	  sw_if_index++;
 	  hash++;
+	  session_id++;
+	  ace_match_index++;
 	  n_left -= 1;
 	}
     }
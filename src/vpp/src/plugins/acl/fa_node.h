@@ -231,6 +231,9 @@ typedef struct {
   fa_5tuple_t fa_5tuples[VLIB_FRAME_SIZE];
   u64 hashes[VLIB_FRAME_SIZE];
   u16 nexts[VLIB_FRAME_SIZE];
+  fa_full_session_id_t session_ids[VLIB_FRAME_SIZE];
+  /* batched ACL lookup result for session misses, ~0 if not looked up */
+  u32 ace_match_indices[VLIB_FRAME_SIZE];
 
 } acl_fa_per_worker_data_t;
 
@@ -360,7 +360,7 @@ tm_assign_mask_type_index(acl_main_t *am, fa_5tuple_t *mask, int is_ip6, u32 lc_
 		minfo->mask_type_index = mask_type_index;
 		minfo->num_entries = 0;
 		minfo->max_collisions = 0;
-		minfo->first_rule_index = ~0;
+		minfo->first_rule_priority = ~0ULL;
 
 		/*
 		 * We can use only 16 bits, since in the match there is only u16 field.
@@ -420,6 +420,15 @@ add_del_hashtable_entry(acl_main_t *am,
 }
 
 
+static int
+hash_applied_mask_info_cmp (void *a1, void *a2)
+{
+  hash_applied_mask_info_t *m1 = a1;
+  hash_applied_mask_info_t *m2 = a2;
+  return (m1->first_rule_priority > m2->first_rule_priority) -
+    (m1->first_rule_priority < m2->first_rule_priority);
+}
+
 static void
 remake_hash_applied_mask_info_vec (acl_main_t * am,
                                    applied_hash_ace_entry_t **
@@ -455,7 +464,7 @@ remake_hash_applied_mask_info_vec (acl_main_t * am,
           minfo->mask_type_index = pae->mask_type_index;
           minfo->num_entries = 0;
           minfo->max_collisions = 0;
-          minfo->first_rule_index = ~0;
+          minfo->first_rule_priority = ~0ULL;
         }
 
       minfo->num_entries = minfo->num_entries + 1;
@@ -463,10 +472,15 @@ remake_hash_applied_mask_info_vec (acl_main_t * am,
       if (vec_len (pae->colliding_rules) > minfo->max_collisions)
         minfo->max_collisions = vec_len (pae->colliding_rules);
 
-      if (minfo->first_rule_index > i)
-        minfo->first_rule_index = i;
+      u64 priority = hash_acl_ace_priority (pae->acl_position, pae->ace_index);
+      if (minfo->first_rule_priority > priority)
+        minfo->first_rule_priority = priority;
     }
 
+  /* the lookup stops at the first partition which can not do better */
+  vec_sort_with_function (new_hash_applied_mask_info_vec,
+                          hash_applied_mask_info_cmp);
+
   hash_applied_mask_info_t **hash_applied_mask_info_vec =
     vec_elt_at_index (am->hash_applied_mask_info_vec_by_lc_index, lc_index);
 
@@ -620,6 +634,51 @@ check_collision_count_and_maybe_split(acl_main_t *am, u32 lc_index, int is_ip6,
   }
 }
 
+static void
+init_applied_hash_ace(acl_main_t *am, u32 lc_index,
+                      applied_hash_ace_entry_t **applied_hash_aces,
+                      u32 index, u32 acl_position)
+{
+  applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), index);
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, pae->acl_index);
+  hash_ace_info_t *ace_info = vec_elt_at_index(ha->rules, pae->hash_ace_info_index);
+  int is_ip6 = ace_info->match.pkt.is_ip6;
+
+  pae->ace_index = ace_info->ace_index;
+  pae->acl_position = acl_position;
+  pae->action = ace_info->action;
+  /* we might link it in later */
+  pae->collision_head_ae_index = ~0;
+  pae->colliding_rules = NULL;
+  pae->mask_type_index = ~0;
+  assign_mask_type_index_to_pae(am, lc_index, is_ip6, pae);
+  u32 first_index = activate_applied_ace_hash_entry(am, lc_index, applied_hash_aces, index);
+  if (am->use_tuple_merge)
+    check_collision_count_and_maybe_split(am, lc_index, is_ip6, first_index);
+}
+
+/*
+ * Append the applied entry for one ACE of the ACL and add it to the lookup.
+ * The caller remakes the mask info vector once done.
+ */
+static void
+apply_hash_ace(acl_main_t *am, u32 lc_index,
+               applied_hash_ace_entry_t **applied_hash_aces,
+               int acl_index, u32 acl_position, u32 hash_ace_info_index)
+{
+  u32 new_index = vec_len((*applied_hash_aces));
+  /*
+   * Expand the applied aces vector to fit a new entry.
+   * One by one not to upset split_partition() if it is called.
+   */
+  vec_resize((*applied_hash_aces), 1);
+
+  applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), new_index);
+  pae->acl_index = acl_index;
+  pae->hash_ace_info_index = hash_ace_info_index;
+  init_applied_hash_ace(am, lc_index, applied_hash_aces, new_index, acl_position);
+}
+
 void
 hash_acl_apply(acl_main_t *am, u32 lc_index, int acl_index, u32 acl_position)
 {
@@ -639,8 +698,6 @@ hash_acl_apply(acl_main_t *am, u32 lc_index, int acl_index, u32 acl_position)
   hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
   u32 **hash_acl_applied_lc_index = &ha->lc_index_list;
 
-  int base_offset = vec_len(*applied_hash_aces);
-
   /* Update the bitmap of the mask types with which the lookup
      needs to happen for the ACLs applied to this lc_index */
   applied_hash_acl_info_t **applied_hash_acls = &am->applied_hash_acl_info_by_lc_index;
@@ -687,29 +744,7 @@ hash_acl_apply(acl_main_t *am, u32 lc_index, int acl_index, u32 acl_position)
 
   /* add the rules from the ACL to the hash table for lookup and append to the vector*/
   for(i=0; i < vec_len(ha->rules); i++) {
-    /*
-     * Expand the applied aces vector to fit a new entry.
-     * One by one not to upset split_partition() if it is called.
-     */
-    vec_resize((*applied_hash_aces), 1);
-
-    int is_ip6 = ha->rules[i].match.pkt.is_ip6;
-    u32 new_index = base_offset + i;
-    applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), new_index);
-    pae->acl_index = acl_index;
-    pae->ace_index = ha->rules[i].ace_index;
-    pae->acl_position = acl_position;
-    pae->action = ha->rules[i].action;
-    pae->hitcount = 0;
-    pae->hash_ace_info_index = i;
-    /* we might link it in later */
-    pae->collision_head_ae_index = ~0;
-    pae->colliding_rules = NULL;
-    pae->mask_type_index = ~0;
-    assign_mask_type_index_to_pae(am, lc_index, is_ip6, pae);
-    u32 first_index = activate_applied_ace_hash_entry(am, lc_index, applied_hash_aces, new_index);
-    if (am->use_tuple_merge)
-      check_collision_count_and_maybe_split(am, lc_index, is_ip6, first_index);
+    apply_hash_ace(am, lc_index, applied_hash_aces, acl_index, acl_position, i);
   }
   remake_hash_applied_mask_info_vec(am, applied_hash_aces, lc_index);
 }
@@ -837,6 +872,41 @@ deactivate_applied_ace_hash_entry(acl_main_t *am,
 }
 
 
+static int
+applied_hash_ace_is_free(applied_hash_ace_entry_t *pae)
+{
+  /* deactivate_applied_ace_hash_entry() leaves no mask type */
+  return pae->mask_type_index == ~0;
+}
+
+/*
+ * Fill the holes left by the deactivated entries with the entries from
+ * the end of the vector, and trim it. Where an entry sits in the vector
+ * does not matter to the lookup, which goes by the ACE priority.
+ */
+static void
+compact_applied_hash_aces(acl_main_t *am, u32 lc_index,
+                          applied_hash_ace_entry_t **applied_hash_aces)
+{
+  u32 i, n = vec_len((*applied_hash_aces));
+
+  for(i=0; i < n; i++) {
+    if (!applied_hash_ace_is_free(vec_elt_at_index((*applied_hash_aces), i)))
+      continue;
+    while ((n > i + 1) &&
+           applied_hash_ace_is_free(vec_elt_at_index((*applied_hash_aces), n - 1)))
+      n--;
+    if (n == i + 1) {
+      n = i;
+      break;
+    }
+    DBG0("COMPACT MOVE: lc_index %d, applied index %d -> %d", lc_index, n - 1, i);
+    move_applied_ace_hash_entry(am, lc_index, applied_hash_aces, n - 1, i);
+    n--;
+  }
+  _vec_len((*applied_hash_aces)) = n;
+}
+
 void
 hash_acl_unapply(acl_main_t *am, u32 lc_index, int acl_index)
 {
@@ -878,32 +948,10 @@ hash_acl_unapply(acl_main_t *am, u32 lc_index, int acl_index)
   for(i=0; i < vec_len((*applied_hash_aces)); i++) {
     if (vec_elt_at_index(*applied_hash_aces,i)->acl_index == acl_index) {
       DBG("Found applied ACL#%d at applied index %d", acl_index, i);
-      break;
+      deactivate_applied_ace_hash_entry(am, lc_index, applied_hash_aces, i);
     }
   }
-  if (vec_len((*applied_hash_aces)) <= i) {
-    DBG("Did not find applied ACL#%d at lc_index %d", acl_index, lc_index);
-    /* we went all the way without finding any entries. Probably a list was empty. */
-    return;
-  }
-
-  int base_offset = i;
-  int tail_offset = base_offset + vec_len(ha->rules);
-  int tail_len = vec_len((*applied_hash_aces)) - tail_offset;
-  DBG("base_offset: %d, tail_offset: %d, tail_len: %d", base_offset, tail_offset, tail_len);
-
-  for(i=0; i < vec_len(ha->rules); i ++) {
-    deactivate_applied_ace_hash_entry(am, lc_index,
-                                      applied_hash_aces, base_offset + i);
-  }
-  for(i=0; i < tail_len; i ++) {
-    /* move the entry at tail offset to base offset */
-    /* that is, from (tail_offset+i) -> (base_offset+i) */
-    DBG0("UNAPPLY MOVE: lc_index %d, applied index %d -> %d", lc_index, tail_offset+i, base_offset + i);
-    move_applied_ace_hash_entry(am, lc_index, applied_hash_aces, tail_offset + i, base_offset + i);
-  }
-  /* trim the end of the vector */
-  _vec_len((*applied_hash_aces)) -= vec_len(ha->rules);
+  compact_applied_hash_aces(am, lc_index, applied_hash_aces);
 
   remake_hash_applied_mask_info_vec(am, applied_hash_aces, lc_index);
 
@@ -917,8 +965,8 @@ hash_acl_unapply(acl_main_t *am, u32 lc_index, int acl_index)
  * taking into account that the ACL may not be the last
  * in the vector of applied ACLs.
  *
- * For now, walk from the end of the vector and unapply the ACLs,
- * then apply the one in question and reapply the rest.
+ * The lookup orders the ACEs by their priority, which comes
+ * from the ACL position, so the ACLs after this one stay as they are.
  */
 
 void
@@ -926,7 +974,6 @@ hash_acl_reapply(acl_main_t *am, u32 lc_index, int acl_index)
 {
   acl_lookup_context_t *acontext = pool_elt_at_index(am->acl_lookup_contexts, lc_index);
   u32 **applied_acls = &acontext->acl_indices;
-  int i;
   int start_index = vec_search((*applied_acls), acl_index);
 
   DBG0("Start index for acl %d in lc_index %d is %d", acl_index, lc_index, start_index);
@@ -936,13 +983,7 @@ hash_acl_reapply(acl_main_t *am, u32 lc_index, int acl_index)
    */
   ASSERT(start_index < vec_len(*applied_acls));
 
-  /* unapply all the ACLs at the tail side, up to the current one */
-  for(i = vec_len(*applied_acls) - 1; i > start_index; i--) {
-    hash_acl_unapply(am, lc_index, *vec_elt_at_index(*applied_acls, i));
-  }
-  for(i = start_index; i < vec_len(*applied_acls); i++) {
-    hash_acl_apply(am, lc_index, *vec_elt_at_index(*applied_acls, i), i);
-  }
+  hash_acl_apply(am, lc_index, acl_index, start_index);
 }
 
 static void
@@ -1050,6 +1091,22 @@ make_mask_and_match_from_rule(fa_5tuple_t *mask, acl_rule_t *r, hash_ace_info_t
 }
 
 
+static void
+make_hash_ace_info(acl_main_t *am, int acl_index, u32 ace_index, hash_ace_info_t *ace_info)
+{
+  fa_5tuple_t mask;
+  clib_memset(ace_info, 0, sizeof(*ace_info));
+  ace_info->acl_index = acl_index;
+  ace_info->ace_index = ace_index;
+
+  make_mask_and_match_from_rule(&mask, &am->acls[acl_index].rules[ace_index], ace_info);
+  mask.pkt.flags_reserved = 0b000;
+  ace_info->base_mask_type_index = assign_mask_type_index(am, &mask);
+  /* assign the mask type index for matching itself */
+  ace_info->match.pkt.mask_type_index_lsb = ace_info->base_mask_type_index;
+  DBG("ACE: %d mask_type_index: %d", ace_index, ace_info->base_mask_type_index);
+}
+
 int hash_acl_exists(acl_main_t *am, int acl_index)
 {
   if (acl_index >= vec_len(am->hash_acl_infos))
@@ -1080,17 +1137,7 @@ void hash_acl_add(acl_main_t *am, int acl_index)
 
   for(i=0; i < vec_len(acl_rules); i++) {
     hash_ace_info_t ace_info;
-    fa_5tuple_t mask;
-    clib_memset(&ace_info, 0, sizeof(ace_info));
-    ace_info.acl_index = acl_index;
-    ace_info.ace_index = i;
-
-    make_mask_and_match_from_rule(&mask, &acl_rules[i], &ace_info);
-    mask.pkt.flags_reserved = 0b000;
-    ace_info.base_mask_type_index = assign_mask_type_index(am, &mask);
-    /* assign the mask type index for matching itself */
-    ace_info.match.pkt.mask_type_index_lsb = ace_info.base_mask_type_index;
-    DBG("ACE: %d mask_type_index: %d", i, ace_info.base_mask_type_index);
+    make_hash_ace_info(am, acl_index, i, &ace_info);
     vec_add1(ha->rules, ace_info);
   }
   /*
@@ -1144,6 +1191,133 @@ void hash_acl_delete(acl_main_t *am, int acl_index)
 }
 
 
+/*
+ * Renumber the applied entries of the ACEs of the ACL from ace_index on,
+ * after an ACE was inserted (delta 1) or deleted (delta -1) before them,
+ * both in the entries and in the collision vectors the lookup walks.
+ */
+static void
+renumber_applied_hash_aces(applied_hash_ace_entry_t **applied_hash_aces,
+                           u32 acl_index, u32 ace_index, int delta)
+{
+  applied_hash_ace_entry_t *pae;
+  collision_match_rule_t *cr;
+
+  vec_foreach(pae, (*applied_hash_aces)) {
+    if ((pae->acl_index == acl_index) && (pae->ace_index >= ace_index)) {
+      pae->ace_index += delta;
+      pae->hash_ace_info_index += delta;
+    }
+    vec_foreach(cr, pae->colliding_rules) {
+      if ((cr->acl_index == acl_index) && (cr->ace_index >= ace_index))
+        cr->ace_index += delta;
+    }
+  }
+}
+
+static u32
+find_applied_hash_ace(applied_hash_ace_entry_t **applied_hash_aces,
+                      u32 acl_index, u32 ace_index)
+{
+  u32 i;
+  for(i=0; i < vec_len((*applied_hash_aces)); i++) {
+    applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), i);
+    if ((pae->acl_index == acl_index) && (pae->ace_index == ace_index))
+      return i;
+  }
+  return ~0;
+}
+
+static u32
+hash_acl_position(acl_main_t *am, u32 lc_index, int acl_index)
+{
+  acl_lookup_context_t *acontext = pool_elt_at_index(am->acl_lookup_contexts, lc_index);
+  return vec_search(acontext->acl_indices, acl_index);
+}
+
+void hash_acl_insert_ace(acl_main_t *am, int acl_index, u32 ace_index)
+{
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
+  hash_ace_info_t ace_info;
+  u32 *lc_index;
+  u32 i;
+
+  DBG0("HASH ACL insert ace: acl %d ace %d", acl_index, ace_index);
+  make_hash_ace_info(am, acl_index, ace_index, &ace_info);
+  vec_insert_elts(ha->rules, &ace_info, 1, ace_index);
+  for(i = ace_index + 1; i < vec_len(ha->rules); i++)
+    ha->rules[i].ace_index = i;
+
+  vec_foreach(lc_index, ha->lc_index_list) {
+    applied_hash_ace_entry_t **applied_hash_aces = get_applied_hash_aces(am, *lc_index);
+    renumber_applied_hash_aces(applied_hash_aces, acl_index, ace_index, 1);
+    apply_hash_ace(am, *lc_index, applied_hash_aces, acl_index,
+                   hash_acl_position(am, *lc_index, acl_index), ace_index);
+    remake_hash_applied_mask_info_vec(am, applied_hash_aces, *lc_index);
+  }
+}
+
+void hash_acl_delete_ace(acl_main_t *am, int acl_index, u32 ace_index)
+{
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
+  u32 *lc_index;
+  u32 i;
+
+  DBG0("HASH ACL delete ace: acl %d ace %d", acl_index, ace_index);
+  vec_foreach(lc_index, ha->lc_index_list) {
+    applied_hash_ace_entry_t **applied_hash_aces = get_applied_hash_aces(am, *lc_index);
+    u32 index = find_applied_hash_ace(applied_hash_aces, acl_index, ace_index);
+    ASSERT(index != ~0);
+    if (index != ~0) {
+      deactivate_applied_ace_hash_entry(am, *lc_index, applied_hash_aces, index);
+      compact_applied_hash_aces(am, *lc_index, applied_hash_aces);
+    }
+    renumber_applied_hash_aces(applied_hash_aces, acl_index, ace_index + 1, -1);
+    remake_hash_applied_mask_info_vec(am, applied_hash_aces, *lc_index);
+    if (vec_len((*applied_hash_aces)) == 0) {
+      vec_free((*applied_hash_aces));
+    }
+  }
+
+  release_mask_type_index(am, ha->rules[ace_index].base_mask_type_index);
+  vec_delete(ha->rules, 1, ace_index);
+  for(i = ace_index; i < vec_len(ha->rules); i++)
+    ha->rules[i].ace_index = i;
+}
+
+void hash_acl_replace_ace(acl_main_t *am, int acl_index, u32 ace_index)
+{
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
+  u32 *applied_index = 0;
+  u32 i;
+
+  DBG0("HASH ACL replace ace: acl %d ace %d", acl_index, ace_index);
+  /* take the entries out while the hash keys of the old ACE are known */
+  for(i=0; i < vec_len(ha->lc_index_list); i++) {
+    u32 lc_index = ha->lc_index_list[i];
+    applied_hash_ace_entry_t **applied_hash_aces = get_applied_hash_aces(am, lc_index);
+    u32 index = find_applied_hash_ace(applied_hash_aces, acl_index, ace_index);
+    ASSERT(index != ~0);
+    if (index != ~0)
+      deactivate_applied_ace_hash_entry(am, lc_index, applied_hash_aces, index);
+    vec_add1(applied_index, index);
+  }
+
+  release_mask_type_index(am, ha->rules[ace_index].base_mask_type_index);
+  make_hash_ace_info(am, acl_index, ace_index, vec_elt_at_index(ha->rules, ace_index));
+
+  /* and put them back in the same places */
+  for(i=0; i < vec_len(ha->lc_index_list); i++) {
+    u32 lc_index = ha->lc_index_list[i];
+    applied_hash_ace_entry_t **applied_hash_aces = get_applied_hash_aces(am, lc_index);
+    if (applied_index[i] != ~0)
+      init_applied_hash_ace(am, lc_index, applied_hash_aces, applied_index[i],
+                            hash_acl_position(am, lc_index, acl_index));
+    remake_hash_applied_mask_info_vec(am, applied_hash_aces, lc_index);
+  }
+  vec_free(applied_index);
+}
+
 void
 show_hash_acl_hash (vlib_main_t * vm, acl_main_t *am, u32 verbose)
 {
@@ -1215,7 +1389,7 @@ acl_plugin_print_pae (vlib_main_t * vm, int j, applied_hash_ace_entry_t * pae)
 		   "    %4d: acl %d rule %d action %d bitmask-ready rule %d mask type index: %d colliding_rules: %d collision_head_ae_idx %d hitcount %lld acl_pos: %d",
 		   j, pae->acl_index, pae->ace_index, pae->action,
 		   pae->hash_ace_info_index, pae->mask_type_index, vec_len(pae->colliding_rules), pae->collision_head_ae_index,
-		   pae->hitcount, pae->acl_position);
+		   vlib_get_simple_counter (&acl_main.acl_hit_counters[pae->acl_index], pae->ace_index), pae->acl_position);
   int jj;
   for(jj=0; jj<vec_len(pae->colliding_rules); jj++)
     acl_plugin_print_colliding_rule(vm, jj, vec_elt_at_index(pae->colliding_rules, jj));
@@ -1225,8 +1399,9 @@ static void
 acl_plugin_print_applied_mask_info (vlib_main_t * vm, int j, hash_applied_mask_info_t *mi)
 {
   vlib_cli_output (vm,
-		   "    %4d: mask type index %d first rule index %d num_entries %d max_collisions %d",
-		   j, mi->mask_type_index, mi->first_rule_index, mi->num_entries, mi->max_collisions);
+		   "    %4d: mask type index %d first rule acl pos %d ace %d num_entries %d max_collisions %d",
+		   j, mi->mask_type_index, (u32) (mi->first_rule_priority >> 32),
+		   (u32) mi->first_rule_priority, mi->num_entries, mi->max_collisions);
 }
 
 void
@@ -1553,7 +1728,7 @@ split_partition(acl_main_t *am, u32 first_index,
 	minfo->mask_type_index = new_mask_type_index;
 	minfo->num_entries = 0;
 	minfo->max_collisions = 0;
-	minfo->first_rule_index = ~0;
+	minfo->first_rule_priority = ~0ULL;
 
 	DBG( "TM-split_partition - mask type index-assigned!! -> %d", new_mask_type_index);
 
@@ -41,6 +41,16 @@ void hash_acl_unapply(acl_main_t *am, u32 lc_index, int acl_index);
 void hash_acl_add(acl_main_t *am, int acl_index);
 void hash_acl_delete(acl_main_t *am, int acl_index);
 
+/*
+ * Edit a single ACE of an ACL in place, after it was inserted into,
+ * replaced in or deleted from the rules of the ACL: only the hash entries
+ * of that ACE are touched in the lookup contexts the ACL is applied to.
+ */
+
+void hash_acl_insert_ace(acl_main_t *am, int acl_index, u32 ace_index);
+void hash_acl_delete_ace(acl_main_t *am, int acl_index, u32 ace_index);
+void hash_acl_replace_ace(acl_main_t *am, int acl_index, u32 ace_index);
+
 /* return if there is already a filled-in hash acl info */
 int hash_acl_exists(acl_main_t *am, int acl_index);
 
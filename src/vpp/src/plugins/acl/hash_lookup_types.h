@@ -68,10 +68,6 @@ typedef struct {
    * Collision rule vector for matching - set only on head entry
    */
   collision_match_rule_t *colliding_rules;
-  /*
-   * number of hits on this entry
-   */
-  u64 hitcount;
   /*
    * acl position in vector of ACLs within lookup context
    */
@@ -102,13 +98,25 @@ typedef union {
 
 typedef struct {
    u32 mask_type_index;
-   /* first rule # for this mask */
-   u32 first_rule_index;
    /* Debug Information */
    u32 num_entries;
    u32 max_collisions;
+   /* priority of the first rule for this mask */
+   u64 first_rule_priority;
 } hash_applied_mask_info_t;
 
+/*
+ * The ACEs of a lookup context are evaluated in the order of the ACL
+ * position, then of the ACE index; a lower value means an earlier ACE.
+ * The lookup goes by this rather than by the index of the applied entry,
+ * so the applied entries can be added and removed in any order.
+ */
+always_inline u64
+hash_acl_ace_priority (u32 acl_position, u32 ace_index)
+{
+  return ((u64) acl_position << 32) | ace_index;
+}
+
 
 #define CT_ASSERT_EQUAL(name, x,y) typedef int assert_ ## name ## _compile_time_assertion_failed[((x) == (y))-1]
 
@@ -18,6 +18,7 @@
 #include <vlib/unix/plugin.h>
 #include <plugins/acl/public_inlines.h>
 #include "hash_lookup.h"
+#include "tree_lookup.h"
 #include "elog_acl_trace.h"
 
 /* check if a given ACL exists */
@@ -207,6 +208,7 @@ static void acl_plugin_put_lookup_context_index (u32 lc_index)
   unlock_acl_vec(lc_index, acontext->acl_indices);
   vec_free(acontext->acl_indices);
   pool_put(am->acl_lookup_contexts, acontext);
+  tree_acl_rebuild(am, lc_index);
 }
 
 /*
@@ -258,6 +260,7 @@ static int acl_plugin_set_acl_vec_for_context (u32 lc_index, u32 *acl_list)
   unlock_acl_vec(lc_index, old_acl_vector);
   lock_acl_vec(lc_index, acontext->acl_indices);
   apply_acl_vec(lc_index, acontext->acl_indices);
+  tree_acl_rebuild(am, lc_index);
 
   vec_free(old_acl_vector);
 
@@ -276,12 +279,49 @@ void acl_plugin_lookup_context_notify_acl_change(u32 acl_num)
         hash_acl_delete(am, acl_num);
     }
     hash_acl_add(am, acl_num);
+    if (acl_num < vec_len(am->lc_index_vec_by_acl)) {
+      u32 *lc_index;
+      vec_foreach(lc_index, am->lc_index_vec_by_acl[acl_num]) {
+        tree_acl_rebuild(am, *lc_index);
+      }
+    }
   } else {
     /* this is a deletion notification */
     hash_acl_delete(am, acl_num);
   }
 }
 
+/*
+ * A single ACE of the ACL was edited in place: update just its hash entries
+ * and tree leaves rather than redo the whole ACL in all the lookup contexts.
+ */
+void acl_plugin_lookup_context_notify_ace_change(u32 acl_num, u32 ace_index,
+                                                 acl_ace_change_t change)
+{
+  acl_main_t *am = &acl_main;
+  if (!hash_acl_exists(am, acl_num)) {
+    acl_plugin_lookup_context_notify_acl_change(acl_num);
+    return;
+  }
+  switch (change) {
+  case ACL_ACE_INSERT:
+    hash_acl_insert_ace(am, acl_num, ace_index);
+    break;
+  case ACL_ACE_DELETE:
+    hash_acl_delete_ace(am, acl_num, ace_index);
+    break;
+  case ACL_ACE_REPLACE:
+    hash_acl_replace_ace(am, acl_num, ace_index);
+    break;
+  }
+  if (acl_num < vec_len(am->lc_index_vec_by_acl)) {
+    u32 *lc_index;
+    vec_foreach(lc_index, am->lc_index_vec_by_acl[acl_num]) {
+      tree_acl_edit_ace(am, *lc_index, acl_num, ace_index, change);
+    }
+  }
+}
+
 
 /* Fill the 5-tuple from the packet */
 
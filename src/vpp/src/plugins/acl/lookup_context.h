@@ -38,7 +38,15 @@ typedef struct {
   u32 user_val2;
 } acl_lookup_context_t;
 
+typedef enum {
+  ACL_ACE_INSERT,
+  ACL_ACE_DELETE,
+  ACL_ACE_REPLACE,
+} acl_ace_change_t;
+
 void acl_plugin_lookup_context_notify_acl_change(u32 acl_num);
+void acl_plugin_lookup_context_notify_ace_change(u32 acl_num, u32 ace_index,
+                                                 acl_ace_change_t change);
 
 void acl_plugin_show_lookup_context (u32 lc_index);
 void acl_plugin_show_lookup_user (u32 user_index);
@@ -544,6 +544,7 @@ multi_acl_match_get_applied_ace_index (acl_main_t * am, int is_ip6, fa_5tuple_t
   u64 *pkey;
   int mask_type_index, order_index;
   u32 curr_match_index = (~0 - 1);
+  u64 curr_match_priority = ~0ULL;
 
 
 
@@ -563,9 +564,9 @@ multi_acl_match_get_applied_ace_index (acl_main_t * am, int is_ip6, fa_5tuple_t
        order_index++)
     {
       minfo = vec_elt_at_index ((*hash_applied_mask_info_vec), order_index);
-      if (minfo->first_rule_index > curr_match_index)
+      if (minfo->first_rule_priority > curr_match_priority)
 	{
-	  /* Index in this and following (by construction) partitions are greater than our candidate, Avoid trying to match! */
+	  /* Priority in this and following (by construction) partitions are greater than our candidate, Avoid trying to match! */
 	  break;
 	}
 
@@ -612,12 +613,15 @@ multi_acl_match_get_applied_ace_index (acl_main_t * am, int is_ip6, fa_5tuple_t
 	  int i;
 	  for (i = 0; i < vec_len (crs); i++)
 	    {
-	      if (crs[i].applied_entry_index >= curr_match_index)
+	      u64 priority = hash_acl_ace_priority (crs[i].acl_position,
+						    crs[i].ace_index);
+	      if (priority >= curr_match_priority)
 		{
 		  continue;
 		}
 	      if (single_rule_match_5tuple (&crs[i].rule, is_ip6, match))
 		{
+		  curr_match_priority = priority;
 		  curr_match_index = crs[i].applied_entry_index;
 		}
 	    }
@@ -627,6 +631,18 @@ multi_acl_match_get_applied_ace_index (acl_main_t * am, int is_ip6, fa_5tuple_t
   return curr_match_index;
 }
 
+/*
+ * The hit counters are per thread, rather than in the applied entry which
+ * all the workers share, so counting hits on a popular rule does not bounce
+ * its cache line between the cores.
+ */
+always_inline void
+acl_plugin_count_ace_hit (acl_main_t * am, applied_hash_ace_entry_t * pae)
+{
+  vlib_increment_simple_counter (am->acl_hit_counters + pae->acl_index,
+				 os_get_thread_index (), pae->ace_index, 1);
+}
+
 always_inline int
 hash_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5tuple,
                        int is_ip6, u8 *action, u32 *acl_pos_p, u32 * acl_match_p,
@@ -637,7 +653,7 @@ hash_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5
   u32 match_index = multi_acl_match_get_applied_ace_index(am, is_ip6, pkt_5tuple);
   if (match_index < vec_len((*applied_hash_aces))) {
     applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), match_index);
-    pae->hitcount++;
+    acl_plugin_count_ace_hit (am, pae);
     *acl_pos_p = pae->acl_position;
     *acl_match_p = pae->acl_index;
     *rule_match_p = pae->ace_index;
@@ -647,7 +663,258 @@ hash_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5
   return 0;
 }
 
+/* max number of 5-tuples classified by one multi_acl_match_..._xN () call */
+#define ACL_PLUGIN_MATCH_BATCH_SIZE 32
+
+/*
+ * Batched version of multi_acl_match_get_applied_ace_index (), for up to
+ * ACL_PLUGIN_MATCH_BATCH_SIZE 5-tuples of the same lookup context.
+ *
+ * Each mask type partition is looked up for all the 5-tuples still
+ * interested in it, in two passes: compute the masked keys and their
+ * hashes and prefetch the buckets, then search. So the cache misses of
+ * the different packets overlap rather than being taken one after the
+ * other, which matters when the lookup hash is much larger than the cache.
+ */
+always_inline void
+multi_acl_match_get_applied_ace_index_xN (acl_main_t * am, int is_ip6,
+					  u32 lc_index, fa_5tuple_t ** match,
+					  u32 n_match, u32 * out_match_index)
+{
+  clib_bihash_48_8_t *h = &am->acl_lookup_hash;
+  clib_bihash_kv_48_8_t kv[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  clib_bihash_kv_48_8_t result;
+  hash_acl_lookup_value_t *result_val =
+    (hash_acl_lookup_value_t *) & result.value;
+  u64 hash[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  u64 match_priority[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  u8 active[ACL_PLUGIN_MATCH_BATCH_SIZE];
+  u64 *pmatch, *pmask, *pkey;
+  int mask_type_index, order_index;
+  u32 i, j, n_active;
+
+  ASSERT (n_match <= ACL_PLUGIN_MATCH_BATCH_SIZE);
+
+  applied_hash_ace_entry_t **applied_hash_aces =
+    vec_elt_at_index (am->hash_entry_vec_by_lc_index, lc_index);
+
+  hash_applied_mask_info_t **hash_applied_mask_info_vec =
+    vec_elt_at_index (am->hash_applied_mask_info_vec_by_lc_index, lc_index);
+
+  hash_applied_mask_info_t *minfo;
+
+  for (i = 0; i < n_match; i++)
+    {
+      out_match_index[i] = (~0 - 1);
+      match_priority[i] = ~0ULL;
+      active[i] = i;
+    }
+  n_active = n_match;
+
+  for (order_index = 0; order_index < vec_len ((*hash_applied_mask_info_vec));
+       order_index++)
+    {
+      minfo = vec_elt_at_index ((*hash_applied_mask_info_vec), order_index);
+
+      /*
+       * Partitions are sorted by their first rule priority, so a packet
+       * which already has a candidate lower than that is done with this
+       * and all the following ones.
+       */
+      for (i = 0, j = 0; j < n_active; j++)
+	if (minfo->first_rule_priority <= match_priority[active[j]])
+	  active[i++] = active[j];
+      n_active = i;
+
+      if (n_active == 0)
+	break;
+
+      mask_type_index = minfo->mask_type_index;
+      ace_mask_type_entry_t *mte =
+	vec_elt_at_index (am->ace_mask_type_pool, mask_type_index);
+
+      for (j = 0; j < n_active; j++)
+	{
+	  fa_5tuple_t *kv_key = (fa_5tuple_t *) kv[j].key;
+	  pmatch = (u64 *) match[active[j]];
+	  pmask = (u64 *) & mte->mask;
+	  pkey = (u64 *) kv[j].key;
+
+	  *pkey++ = *pmatch++ & *pmask++;
+	  *pkey++ = *pmatch++ & *pmask++;
+	  *pkey++ = *pmatch++ & *pmask++;
+	  *pkey++ = *pmatch++ & *pmask++;
+	  *pkey++ = *pmatch++ & *pmask++;
+	  *pkey++ = *pmatch++ & *pmask++;
+
+	  fa_packet_info_t tmp_pkt = kv_key->pkt;
+	  tmp_pkt.mask_type_index_lsb = mask_type_index;
+	  kv_key->pkt.as_u64 = tmp_pkt.as_u64;
+
+	  hash[j] = clib_bihash_hash_48_8 (&kv[j]);
+	  clib_bihash_prefetch_bucket_48_8 (h, hash[j]);
+	}
 
+      for (j = 0; j < n_active; j++)
+	{
+	  if (clib_bihash_search_inline_2_with_hash_48_8 (h, hash[j], &kv[j],
+							  &result))
+	    continue;
+
+	  /* There is a hit in the hash, so check the collision vector */
+	  u64 *curr_match_priority = &match_priority[active[j]];
+	  applied_hash_ace_entry_t *pae =
+	    vec_elt_at_index ((*applied_hash_aces),
+			      result_val->applied_entry_index);
+	  collision_match_rule_t *crs = pae->colliding_rules;
+	  for (i = 0; i < vec_len (crs); i++)
+	    {
+	      u64 priority = hash_acl_ace_priority (crs[i].acl_position,
+						    crs[i].ace_index);
+	      if (priority >= *curr_match_priority)
+		continue;
+	      if (single_rule_match_5tuple (&crs[i].rule, is_ip6,
+					    match[active[j]]))
+		{
+		  *curr_match_priority = priority;
+		  out_match_index[active[j]] = crs[i].applied_entry_index;
+		}
+	    }
+	}
+    }
+}
+
+/*
+ * Turn the result of multi_acl_match_get_applied_ace_index_xN () for one
+ * packet into the same outputs as hash_multi_acl_match_5tuple ().
+ */
+always_inline int
+hash_multi_acl_match_result (acl_main_t * am, u32 lc_index, u32 match_index,
+			     u8 * action, u32 * acl_pos_p, u32 * acl_match_p,
+			     u32 * rule_match_p)
+{
+  applied_hash_ace_entry_t **applied_hash_aces =
+    vec_elt_at_index (am->hash_entry_vec_by_lc_index, lc_index);
+  if (match_index < vec_len ((*applied_hash_aces)))
+    {
+      applied_hash_ace_entry_t *pae =
+	vec_elt_at_index ((*applied_hash_aces), match_index);
+      acl_plugin_count_ace_hit (am, pae);
+      *acl_pos_p = pae->acl_position;
+      *acl_match_p = pae->acl_index;
+      *rule_match_p = pae->ace_index;
+      *action = pae->action;
+      return 1;
+    }
+  return 0;
+}
+
+/*
+ * The decision tree of the lookup context, if the tree matching is on
+ * and the packet can use it. The non-first fragments have no ports, so
+ * they take the linear matching, like with the hash matching.
+ */
+always_inline acl_tree_t *
+acl_plugin_tree_for_5tuple (acl_main_t * am, u32 lc_index,
+			    fa_5tuple_t * pkt_5tuple)
+{
+  acl_tree_t **trees;
+
+  if (PREDICT_TRUE (!am->use_tree_acl_matching))
+    return 0;
+  if (PREDICT_FALSE (pkt_5tuple->pkt.is_nonfirst_fragment))
+    return 0;
+  /* the main thread replaces the vector and the trees without a barrier */
+  trees = clib_atomic_load_acq_n (&am->tree_by_lc_index);
+  if (lc_index >= vec_len (trees))
+    return 0;
+  return clib_atomic_load_acq_n (&trees[lc_index]);
+}
+
+always_inline void
+acl_tree_fill_key (fa_5tuple_t * pkt_5tuple, int is_ip6, u64 * key)
+{
+  if (is_ip6)
+    {
+      key[ACL_TREE_DIM_SRC_HI] =
+	clib_net_to_host_u64 (pkt_5tuple->ip6_addr[0].as_u64[0]);
+      key[ACL_TREE_DIM_SRC_LO] =
+	clib_net_to_host_u64 (pkt_5tuple->ip6_addr[0].as_u64[1]);
+      key[ACL_TREE_DIM_DST_HI] =
+	clib_net_to_host_u64 (pkt_5tuple->ip6_addr[1].as_u64[0]);
+      key[ACL_TREE_DIM_DST_LO] =
+	clib_net_to_host_u64 (pkt_5tuple->ip6_addr[1].as_u64[1]);
+    }
+  else
+    {
+      key[ACL_TREE_DIM_SRC_HI] =
+	clib_net_to_host_u32 (pkt_5tuple->ip4_addr[0].as_u32);
+      key[ACL_TREE_DIM_SRC_LO] = 0;
+      key[ACL_TREE_DIM_DST_HI] =
+	clib_net_to_host_u32 (pkt_5tuple->ip4_addr[1].as_u32);
+      key[ACL_TREE_DIM_DST_LO] = 0;
+    }
+  key[ACL_TREE_DIM_PROTO] = pkt_5tuple->l4.proto;
+  key[ACL_TREE_DIM_SPORT] = pkt_5tuple->l4.port[0];
+  key[ACL_TREE_DIM_DPORT] = pkt_5tuple->l4.port[1];
+}
+
+/*
+ * Walk the tree down to a leaf, at most ACL_TREE_MAX_DEPTH nodes, then
+ * take the first of its few ACEs the 5-tuple falls into.
+ */
+always_inline int
+tree_multi_acl_match_5tuple (acl_main_t * am, acl_tree_t * t,
+			     fa_5tuple_t * pkt_5tuple, int is_ip6,
+			     u8 * action, u32 * acl_pos_p, u32 * acl_match_p,
+			     u32 * rule_match_p)
+{
+  u64 key[ACL_TREE_N_DIM];
+  acl_tree_leaf_t *leaf;
+  u32 i, index;
+  int dim;
+
+  acl_tree_fill_key (pkt_5tuple, is_ip6, key);
+
+  index = t->root[is_ip6];
+  while (!(index & ACL_TREE_LEAF))
+    {
+      acl_tree_node_t *node = vec_elt_at_index (t->nodes, index);
+      index = node->child[key[node->dim] >= node->threshold];
+    }
+
+  leaf = vec_elt_at_index (t->leaves, index & ~ACL_TREE_LEAF);
+  ASSERT (leaf->n_rules <= ACL_TREE_LEAF_RULES);
+  for (i = 0; i < leaf->n_rules; i++)
+    {
+      acl_tree_rule_t *tr =
+	vec_elt_at_index (t->rules, t->leaf_rules[leaf->first_rule + i]);
+
+      for (dim = 0; dim < ACL_TREE_N_DIM; dim++)
+	if (key[dim] < tr->lo[dim] || key[dim] > tr->hi[dim])
+	  break;
+      if (dim < ACL_TREE_N_DIM)
+	continue;
+      if (tr->proto)
+	{
+	  if (PREDICT_FALSE (!pkt_5tuple->pkt.l4_valid))
+	    continue;
+	  if (pkt_5tuple->pkt.tcp_flags_valid
+	      && ((pkt_5tuple->pkt.tcp_flags & tr->tcp_flags_mask) !=
+		  tr->tcp_flags_value))
+	    continue;
+	}
+      vlib_increment_simple_counter (am->acl_hit_counters + tr->acl_index,
+				     os_get_thread_index (), tr->ace_index,
+				     1);
+      *acl_pos_p = tr->acl_position;
+      *acl_match_p = tr->acl_index;
+      *rule_match_p = tr->ace_index;
+      *action = tr->is_permit;
+      return 1;
+    }
+  return 0;
+}
 
 always_inline int
 acl_plugin_match_5tuple_inline (void *p_acl_main, u32 lc_index,
@@ -660,7 +927,13 @@ acl_plugin_match_5tuple_inline (void *p_acl_main, u32 lc_index,
 {
   acl_main_t *am = p_acl_main;
   fa_5tuple_t * pkt_5tuple_internal = (fa_5tuple_t *)pkt_5tuple;
+  acl_tree_t *tree;
   pkt_5tuple_internal->pkt.lc_index = lc_index;
+  tree = acl_plugin_tree_for_5tuple(am, lc_index, pkt_5tuple_internal);
+  if (tree) {
+    return tree_multi_acl_match_5tuple(am, tree, pkt_5tuple_internal, is_ip6, r_action,
+                                 r_acl_pos_p, r_acl_match_p, r_rule_match_p);
+  }
   if (PREDICT_TRUE(am->use_hash_acl_matching)) {
     if (PREDICT_FALSE(pkt_5tuple_internal->pkt.is_nonfirst_fragment)) {
       /*
@@ -695,8 +968,13 @@ acl_plugin_match_5tuple_inline_and_count (void *p_acl_main, u32 lc_index,
   acl_main_t *am = p_acl_main;
   int ret = 0;
   fa_5tuple_t * pkt_5tuple_internal = (fa_5tuple_t *)pkt_5tuple;
+  acl_tree_t *tree;
   pkt_5tuple_internal->pkt.lc_index = lc_index;
-  if (PREDICT_TRUE(am->use_hash_acl_matching)) {
+  tree = acl_plugin_tree_for_5tuple(am, lc_index, pkt_5tuple_internal);
+  if (tree) {
+    ret = tree_multi_acl_match_5tuple(am, tree, pkt_5tuple_internal, is_ip6, r_action,
+                                 r_acl_pos_p, r_acl_match_p, r_rule_match_p);
+  } else if (PREDICT_TRUE(am->use_hash_acl_matching)) {
     if (PREDICT_FALSE(pkt_5tuple_internal->pkt.is_nonfirst_fragment)) {
       /*
        * tuplemerge does not take fragments into account,
@@ -0,0 +1,736 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+/*
+ * Decision tree ACL matching.
+ *
+ * The ACEs of a lookup context are boxes in the space of the 5-tuple
+ * fields. The tree cuts the space in two at each node, on the field
+ * and the value which leave the fewest ACEs on the bigger side, until
+ * at most ACL_TREE_LEAF_RULES ACEs remain (HyperSplit). The ACEs which
+ * straddle a cut go to both sides, so unlike the hash matching a port
+ * range is never expanded into masks; the price is the replication,
+ * which the build keeps within a budget. The ACEs shadowed in a region
+ * by an earlier one which covers all of it are dropped. A leaf which
+ * still can not get within ACL_TREE_LEAF_RULES fails the build, and the
+ * lookup context stays on the hash matching.
+ *
+ * The tree is compiled on the main thread when the ACLs of the lookup
+ * context change; a single ACE edit only recomputes the leaves the old
+ * and the new ACE overlap. The new tree is published with an atomic
+ * pointer store and the old one is freed once all the workers have been
+ * round their loop, so the workers never stop.
+ */
+
+#include <stddef.h>
+
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+#include <vppinfra/error.h>
+#include <acl/acl.h>
+
+#include "tree_lookup.h"
+
+/* total ACE references in the leaves allowed per ACE of the context */
+#define ACL_TREE_REPLICATION_BUDGET 64
+/* a full build after single ACE edits of an eighth of the ACEs */
+#define ACL_TREE_EDITS_FRACTION 8
+
+typedef struct
+{
+  acl_tree_t *t;
+  /* the part of the space the node being built covers */
+  u64 lo[ACL_TREE_N_DIM];
+  u64 hi[ACL_TREE_N_DIM];
+  /* scratch for the split selection */
+  u64 *starts;
+  u64 *ends;
+  u64 *cuts;
+  u32 max_leaf_rules_total;
+  int is_ip6;
+  /* why there is no tree, 0 while the build goes on */
+  char *failed;
+} acl_tree_build_t;
+
+static int
+tree_acl_u64_cmp (void *a1, void *a2)
+{
+  u64 v1 = *(u64 *) a1;
+  u64 v2 = *(u64 *) a2;
+  return (v1 > v2) - (v1 < v2);
+}
+
+static void
+tree_acl_addr_range (acl_tree_rule_t * tr, int dim_hi, int is_ip6,
+		     ip46_address_t * addr, u8 prefixlen)
+{
+  int dim_lo = dim_hi + 1;
+  u64 v, m;
+
+  if (!is_ip6)
+    {
+      v = clib_net_to_host_u32 (addr->ip4.as_u32);
+      m = prefixlen ? (u32) (~0U << (32 - clib_min (prefixlen, 32))) : 0;
+      tr->lo[dim_hi] = v & m;
+      tr->hi[dim_hi] = (v & m) | (~m & 0xffffffff);
+      tr->lo[dim_lo] = tr->hi[dim_lo] = 0;
+      return;
+    }
+
+  v = clib_net_to_host_u64 (addr->ip6.as_u64[0]);
+  if (prefixlen <= 64)
+    {
+      m = prefixlen ? ~0ULL << (64 - prefixlen) : 0;
+      tr->lo[dim_hi] = v & m;
+      tr->hi[dim_hi] = v | ~m;
+      tr->lo[dim_lo] = 0;
+      tr->hi[dim_lo] = ~0ULL;
+      return;
+    }
+  tr->lo[dim_hi] = tr->hi[dim_hi] = v;
+  v = clib_net_to_host_u64 (addr->ip6.as_u64[1]);
+  m = ~0ULL << (128 - clib_min (prefixlen, 128));
+  tr->lo[dim_lo] = v & m;
+  tr->hi[dim_lo] = v | ~m;
+}
+
+static void
+tree_acl_fill_rule (acl_tree_rule_t * tr, acl_rule_t * r)
+{
+  int is_ip6 = r->is_ipv6;
+
+  tree_acl_addr_range (tr, ACL_TREE_DIM_SRC_HI, is_ip6, &r->src,
+		       r->src_prefixlen);
+  tree_acl_addr_range (tr, ACL_TREE_DIM_DST_HI, is_ip6, &r->dst,
+		       r->dst_prefixlen);
+  if (r->proto)
+    {
+      tr->lo[ACL_TREE_DIM_PROTO] = tr->hi[ACL_TREE_DIM_PROTO] = r->proto;
+      tr->lo[ACL_TREE_DIM_SPORT] = r->src_port_or_type_first;
+      tr->hi[ACL_TREE_DIM_SPORT] = r->src_port_or_type_last;
+      tr->lo[ACL_TREE_DIM_DPORT] = r->dst_port_or_code_first;
+      tr->hi[ACL_TREE_DIM_DPORT] = r->dst_port_or_code_last;
+    }
+  else
+    {
+      tr->lo[ACL_TREE_DIM_PROTO] = 0;
+      tr->hi[ACL_TREE_DIM_PROTO] = 255;
+      tr->lo[ACL_TREE_DIM_SPORT] = tr->lo[ACL_TREE_DIM_DPORT] = 0;
+      tr->hi[ACL_TREE_DIM_SPORT] = tr->hi[ACL_TREE_DIM_DPORT] = 65535;
+    }
+  tr->is_permit = r->is_permit;
+  tr->proto = r->proto;
+  tr->tcp_flags_value = r->tcp_flags_value;
+  tr->tcp_flags_mask = r->tcp_flags_mask;
+  tr->is_ip6 = is_ip6;
+}
+
+/* Fill the rules of the tree with the ACEs of the lookup context */
+static void
+tree_acl_fill_rules (acl_main_t * am, acl_lookup_context_t * acontext,
+		     acl_tree_t * t)
+{
+  acl_tree_rule_t *tr;
+  u32 i, j;
+
+  for (i = 0; i < vec_len (acontext->acl_indices); i++)
+    {
+      u32 acl_index = acontext->acl_indices[i];
+      acl_list_t *a;
+      if (pool_is_free_index (am->acls, acl_index))
+	continue;
+      a = pool_elt_at_index (am->acls, acl_index);
+      for (j = 0; j < vec_len (a->rules); j++)
+	{
+	  vec_add2 (t->rules, tr, 1);
+	  tree_acl_fill_rule (tr, &a->rules[j]);
+	  tr->acl_index = acl_index;
+	  tr->ace_index = j;
+	  tr->acl_position = i;
+	}
+    }
+}
+
+/* The whole key space of the address family */
+static void
+tree_acl_region_init (acl_tree_build_t * tb)
+{
+  int dim;
+
+  for (dim = 0; dim < ACL_TREE_N_DIM; dim++)
+    {
+      tb->lo[dim] = 0;
+      tb->hi[dim] = ~0ULL;
+    }
+  if (!tb->is_ip6)
+    {
+      tb->hi[ACL_TREE_DIM_SRC_HI] = tb->hi[ACL_TREE_DIM_DST_HI] = 0xffffffff;
+      tb->hi[ACL_TREE_DIM_SRC_LO] = tb->hi[ACL_TREE_DIM_DST_LO] = 0;
+    }
+  tb->hi[ACL_TREE_DIM_PROTO] = 255;
+  tb->hi[ACL_TREE_DIM_SPORT] = tb->hi[ACL_TREE_DIM_DPORT] = 65535;
+}
+
+static int
+tree_acl_rule_overlaps (acl_tree_build_t * tb, acl_tree_rule_t * tr)
+{
+  int dim;
+
+  if (tr->is_ip6 != tb->is_ip6)
+    return 0;
+  for (dim = 0; dim < ACL_TREE_N_DIM; dim++)
+    if (tr->lo[dim] > tb->hi[dim] || tr->hi[dim] < tb->lo[dim])
+      return 0;
+  return 1;
+}
+
+/*
+ * Which of the rules after this one can not match anywhere in the region:
+ * none, those with a protocol, or all of them. A rule shadows the others
+ * only if it covers the whole region and matches regardless of the TCP
+ * flags; with a protocol it also needs the L4 header, like them.
+ */
+#define ACL_TREE_SHADOWS_NONE 0
+#define ACL_TREE_SHADOWS_L4 1
+#define ACL_TREE_SHADOWS_ALL 2
+
+static int
+tree_acl_rule_shadows (acl_tree_build_t * tb, acl_tree_rule_t * tr)
+{
+  int dim;
+
+  for (dim = 0; dim < ACL_TREE_N_DIM; dim++)
+    if (tr->lo[dim] > tb->lo[dim] || tr->hi[dim] < tb->hi[dim])
+      return ACL_TREE_SHADOWS_NONE;
+  if (!tr->proto)
+    return ACL_TREE_SHADOWS_ALL;
+  if (!tr->tcp_flags_mask && !tr->tcp_flags_value)
+    return ACL_TREE_SHADOWS_L4;
+  return ACL_TREE_SHADOWS_NONE;
+}
+
+/* Drop the rules which can not match in the region, in place */
+static void
+tree_acl_drop_shadowed (acl_tree_build_t * tb, u32 * rules)
+{
+  u32 i, n = 0;
+  int shadows = ACL_TREE_SHADOWS_NONE;
+
+  for (i = 0; i < vec_len (rules); i++)
+    {
+      acl_tree_rule_t *tr = vec_elt_at_index (tb->t->rules, rules[i]);
+      if (shadows == ACL_TREE_SHADOWS_L4 && tr->proto)
+	continue;
+      rules[n++] = rules[i];
+      shadows = clib_max (shadows, tree_acl_rule_shadows (tb, tr));
+      if (shadows == ACL_TREE_SHADOWS_ALL)
+	break;
+    }
+  if (rules)
+    _vec_len (rules) = n;
+}
+
+static u32
+tree_acl_add_leaf (acl_tree_build_t * tb, u32 * rules, u32 depth)
+{
+  acl_tree_t *t = tb->t;
+  acl_tree_leaf_t *leaf;
+  u32 leaf_index = vec_len (t->leaves);
+
+  ASSERT (vec_len (rules) <= ACL_TREE_LEAF_RULES);
+  vec_add2 (t->leaves, leaf, 1);
+  leaf->first_rule = vec_len (t->leaf_rules);
+  leaf->n_rules = vec_len (rules);
+  vec_append (t->leaf_rules, rules);
+
+  if (vec_len (t->leaf_rules) > tb->max_leaf_rules_total)
+    tb->failed = "over the replication budget";
+  t->max_depth[tb->is_ip6] = clib_max (t->max_depth[tb->is_ip6], depth);
+  t->max_leaf_rules[tb->is_ip6] =
+    clib_max (t->max_leaf_rules[tb->is_ip6], leaf->n_rules);
+
+  return leaf_index | ACL_TREE_LEAF;
+}
+
+/*
+ * Find the cut in the dimension which minimizes the number of rules
+ * on the bigger side, preferring the one with less replication among
+ * the equally good ones. Returns 0 if no rule has a boundary inside the
+ * region in this dimension.
+ */
+static int
+tree_acl_best_cut (acl_tree_build_t * tb, u32 * rules, int dim,
+		   u64 * best_cut, u32 * best_max, u32 * best_sum)
+{
+  acl_tree_rule_t *tr;
+  u64 lo = tb->lo[dim], hi = tb->hi[dim];
+  u32 i, n = vec_len (rules), n_left = 0, n_right = n;
+  u32 s = 0, e = 0;
+  int found = 0;
+  u64 *cut;
+
+  if (lo == hi)
+    return 0;
+
+  vec_reset_length (tb->starts);
+  vec_reset_length (tb->ends);
+  vec_reset_length (tb->cuts);
+  for (i = 0; i < n; i++)
+    {
+      tr = vec_elt_at_index (tb->t->rules, rules[i]);
+      vec_add1 (tb->starts, clib_max (tr->lo[dim], lo));
+      vec_add1 (tb->ends, clib_min (tr->hi[dim], hi));
+      /* the first value of each side of the cut must be in the region */
+      if (tr->lo[dim] > lo)
+	vec_add1 (tb->cuts, tr->lo[dim]);
+      if (tr->hi[dim] < hi)
+	vec_add1 (tb->cuts, tr->hi[dim] + 1);
+    }
+  vec_sort_with_function (tb->starts, tree_acl_u64_cmp);
+  vec_sort_with_function (tb->ends, tree_acl_u64_cmp);
+  vec_sort_with_function (tb->cuts, tree_acl_u64_cmp);
+
+  /*
+   * Sweep the cuts in the ascending order: a rule is on the left of
+   * the cut if it starts below it, and on the right if it ends at or
+   * above it.
+   */
+  vec_foreach (cut, tb->cuts)
+  {
+    u32 max, sum;
+    if (cut > tb->cuts && cut[0] == cut[-1])
+      continue;
+    while (s < n && tb->starts[s] < cut[0])
+      s++;
+    while (e < n && tb->ends[e] < cut[0])
+      e++;
+    n_left = s;
+    n_right = n - e;
+    max = clib_max (n_left, n_right);
+    sum = n_left + n_right;
+    if (max < *best_max || (max == *best_max && sum < *best_sum))
+      {
+	*best_max = max;
+	*best_sum = sum;
+	*best_cut = cut[0];
+	found = 1;
+      }
+  }
+  return found;
+}
+
+/*
+ * Build the subtree for the region with the rules overlapping it, which
+ * may drop the shadowed ones from the rules vector.
+ */
+static u32
+tree_acl_build_node (acl_tree_build_t * tb, u32 * rules, u32 depth)
+{
+  acl_tree_t *t = tb->t;
+  u32 n, best_max, best_sum = ~0;
+  u64 best_cut = 0, saved;
+  int dim, best_dim = -1;
+  u32 *left = 0, *right = 0, *ri;
+  acl_tree_node_t *node;
+  u32 node_index, child;
+
+  if (tb->failed)
+    return ACL_TREE_LEAF;
+
+  tree_acl_drop_shadowed (tb, rules);
+  n = best_max = vec_len (rules);
+
+  if (n <= ACL_TREE_LEAF_RULES)
+    return tree_acl_add_leaf (tb, rules, depth);
+
+  if (depth >= ACL_TREE_MAX_DEPTH)
+    {
+      tb->failed = "deeper than the max depth";
+      return ACL_TREE_LEAF;
+    }
+
+  /*
+   * Each cut is on a boundary of a rule inside the region, which is then
+   * out of the region of both sides, so the splitting ends even when the
+   * bigger side keeps all the rules. When no rule has a boundary left in
+   * the region they all cover it, and the ones which are not shadowed
+   * only differ by their TCP flags.
+   */
+  for (dim = 0; dim < ACL_TREE_N_DIM; dim++)
+    if (tree_acl_best_cut (tb, rules, dim, &best_cut, &best_max, &best_sum))
+      best_dim = dim;
+
+  if (best_dim < 0)
+    {
+      tb->failed = "too many ACEs which differ only in TCP flags";
+      return ACL_TREE_LEAF;
+    }
+
+  vec_foreach (ri, rules)
+  {
+    acl_tree_rule_t *tr = vec_elt_at_index (t->rules, *ri);
+    if (tr->lo[best_dim] < best_cut)
+      vec_add1 (left, *ri);
+    if (tr->hi[best_dim] >= best_cut)
+      vec_add1 (right, *ri);
+  }
+
+  /* the children are added after the node, which may move it */
+  node_index = vec_len (t->nodes);
+  vec_add2 (t->nodes, node, 1);
+  node->dim = best_dim;
+  node->threshold = best_cut;
+
+  saved = tb->hi[best_dim];
+  tb->hi[best_dim] = best_cut - 1;
+  child = tree_acl_build_node (tb, left, depth + 1);
+  t->nodes[node_index].child[0] = child;
+  tb->hi[best_dim] = saved;
+
+  saved = tb->lo[best_dim];
+  tb->lo[best_dim] = best_cut;
+  child = tree_acl_build_node (tb, right, depth + 1);
+  t->nodes[node_index].child[1] = child;
+  tb->lo[best_dim] = saved;
+
+  vec_free (left);
+  vec_free (right);
+  return node_index;
+}
+
+static void
+tree_acl_free (acl_tree_t * t)
+{
+  if (!t)
+    return;
+  vec_free (t->nodes);
+  vec_free (t->leaves);
+  vec_free (t->leaf_rules);
+  vec_free (t->rules);
+  clib_mem_free (t);
+}
+
+static acl_tree_t *
+tree_acl_build (acl_main_t * am, u32 lc_index)
+{
+  acl_lookup_context_t *acontext =
+    pool_elt_at_index (am->acl_lookup_contexts, lc_index);
+  acl_tree_build_t tb = { 0 };
+  u32 *rules = 0;
+  u32 i;
+
+  tb.t = clib_mem_alloc (sizeof (*tb.t));
+  clib_memset (tb.t, 0, sizeof (*tb.t));
+  tree_acl_fill_rules (am, acontext, tb.t);
+  tb.max_leaf_rules_total =
+    ACL_TREE_REPLICATION_BUDGET * vec_len (tb.t->rules) + 1024;
+
+  for (tb.is_ip6 = 0; tb.is_ip6 <= 1; tb.is_ip6++)
+    {
+      vec_reset_length (rules);
+      for (i = 0; i < vec_len (tb.t->rules); i++)
+	if (tb.t->rules[i].is_ip6 == tb.is_ip6)
+	  vec_add1 (rules, i);
+
+      tree_acl_region_init (&tb);
+      tb.t->root[tb.is_ip6] = tree_acl_build_node (&tb, rules, 0);
+    }
+
+  vec_free (rules);
+  vec_free (tb.starts);
+  vec_free (tb.ends);
+  vec_free (tb.cuts);
+
+  if (tb.failed)
+    {
+      acl_log_warn ("lc_index %d: no decision tree for %d ACEs, %s, "
+		    "using the hash matching", lc_index,
+		    vec_len (tb.t->rules), tb.failed);
+      tree_acl_free (tb.t);
+      return 0;
+    }
+  return tb.t;
+}
+
+/*
+ * A single ACE edit as the tree sees it: the position of the ACE among
+ * the rules of the lookup context, the rule it was in the old tree and
+ * the rule it is in the new one.
+ */
+typedef struct
+{
+  acl_ace_change_t change;
+  u32 pos;
+  acl_tree_rule_t *old_rule;
+  acl_tree_rule_t *new_rule;
+} acl_tree_edit_t;
+
+/* The index in the new tree of a rule which is still there */
+static u32
+tree_acl_edit_remap (acl_tree_edit_t * e, u32 ri)
+{
+  if (e->change == ACL_ACE_INSERT && ri >= e->pos)
+    return ri + 1;
+  if (e->change == ACL_ACE_DELETE && ri > e->pos)
+    return ri - 1;
+  return ri;
+}
+
+/*
+ * Copy the subtree of the old tree into the new one. The nodes keep their
+ * index, the leaves get the rules they had with the edit applied, and
+ * become subtrees if that takes them over ACL_TREE_LEAF_RULES.
+ */
+static u32
+tree_acl_update_node (acl_tree_build_t * tb, acl_tree_t * old,
+		      acl_tree_edit_t * e, u32 index, u32 depth)
+{
+  acl_tree_node_t node;
+  acl_tree_leaf_t *leaf;
+  u32 *rules = 0, i, ri, child;
+  int new_overlaps;
+  u64 saved;
+
+  if (tb->failed)
+    return ACL_TREE_LEAF;
+
+  if (!(index & ACL_TREE_LEAF))
+    {
+      node = old->nodes[index];
+
+      saved = tb->hi[node.dim];
+      tb->hi[node.dim] = node.threshold - 1;
+      child = tree_acl_update_node (tb, old, e, node.child[0], depth + 1);
+      tb->t->nodes[index].child[0] = child;
+      tb->hi[node.dim] = saved;
+
+      saved = tb->lo[node.dim];
+      tb->lo[node.dim] = node.threshold;
+      child = tree_acl_update_node (tb, old, e, node.child[1], depth + 1);
+      tb->t->nodes[index].child[1] = child;
+      tb->lo[node.dim] = saved;
+      return index;
+    }
+
+  new_overlaps = e->new_rule && tree_acl_rule_overlaps (tb, e->new_rule);
+
+  if (e->old_rule && tree_acl_rule_overlaps (tb, e->old_rule)
+      && tree_acl_rule_shadows (tb, e->old_rule))
+    {
+      /* the leaf lost the rules the old one shadowed, look them up */
+      for (ri = 0; ri < vec_len (tb->t->rules); ri++)
+	if (tree_acl_rule_overlaps (tb, tb->t->rules + ri))
+	  vec_add1 (rules, ri);
+    }
+  else
+    {
+      leaf = vec_elt_at_index (old->leaves, index & ~ACL_TREE_LEAF);
+      for (i = 0; i < leaf->n_rules; i++)
+	{
+	  ri = old->leaf_rules[leaf->first_rule + i];
+	  if (ri == e->pos && e->change != ACL_ACE_INSERT)
+	    continue;
+	  ri = tree_acl_edit_remap (e, ri);
+	  if (new_overlaps && ri > e->pos)
+	    {
+	      vec_add1 (rules, e->pos);
+	      new_overlaps = 0;
+	    }
+	  vec_add1 (rules, ri);
+	}
+      if (new_overlaps)
+	vec_add1 (rules, e->pos);
+    }
+
+  child = tree_acl_build_node (tb, rules, depth);
+  vec_free (rules);
+  return child;
+}
+
+/*
+ * Make the tree of the lookup context after a single ACE edit from the
+ * one before it. Only the leaves the old or the new ACE overlap change,
+ * the others just follow the shift of the rule indices. Returns 0 if it
+ * takes a full build.
+ */
+static acl_tree_t *
+tree_acl_update (acl_main_t * am, u32 lc_index, acl_tree_t * old,
+		 u32 acl_index, u32 ace_index, acl_ace_change_t change)
+{
+  acl_lookup_context_t *acontext =
+    pool_elt_at_index (am->acl_lookup_contexts, lc_index);
+  acl_tree_build_t tb = { 0 };
+  acl_tree_edit_t e = {.change = change };
+  u32 i;
+
+  for (i = 0; i < vec_len (acontext->acl_indices); i++)
+    {
+      u32 ai = acontext->acl_indices[i];
+      if (ai == acl_index)
+	break;
+      if (!pool_is_free_index (am->acls, ai))
+	e.pos += vec_len (pool_elt_at_index (am->acls, ai)->rules);
+    }
+  if (i == vec_len (acontext->acl_indices))
+    return 0;
+  e.pos += ace_index;
+
+  tb.t = clib_mem_alloc (sizeof (*tb.t));
+  clib_memset (tb.t, 0, sizeof (*tb.t));
+  tree_acl_fill_rules (am, acontext, tb.t);
+
+  /* the old tree has to be of the ACEs just before the edit */
+  if (vec_len (tb.t->rules) + (change == ACL_ACE_DELETE) !=
+      vec_len (old->rules) + (change == ACL_ACE_INSERT)
+      || e.pos >= vec_len (old->rules) + (change == ACL_ACE_INSERT))
+    {
+      tree_acl_free (tb.t);
+      return 0;
+    }
+  if (change != ACL_ACE_INSERT)
+    e.old_rule = vec_elt_at_index (old->rules, e.pos);
+  if (change != ACL_ACE_DELETE)
+    e.new_rule = vec_elt_at_index (tb.t->rules, e.pos);
+
+  tb.max_leaf_rules_total =
+    ACL_TREE_REPLICATION_BUDGET * vec_len (tb.t->rules) + 1024;
+  tb.t->nodes = vec_dup (old->nodes);
+  tb.t->n_edits = old->n_edits + 1;
+
+  for (tb.is_ip6 = 0; tb.is_ip6 <= 1; tb.is_ip6++)
+    {
+      tree_acl_region_init (&tb);
+      tb.t->root[tb.is_ip6] =
+	tree_acl_update_node (&tb, old, &e, old->root[tb.is_ip6], 0);
+    }
+
+  vec_free (tb.starts);
+  vec_free (tb.ends);
+  vec_free (tb.cuts);
+
+  if (tb.failed)
+    {
+      tree_acl_free (tb.t);
+      return 0;
+    }
+  return tb.t;
+}
+
+/*
+ * Make the tree the one of the lookup context. The workers read the trees
+ * without a barrier, so what they may still be reading is only freed once
+ * they have all been round their loop.
+ */
+static void
+tree_acl_publish (acl_main_t * am, u32 lc_index, acl_tree_t * t)
+{
+  acl_tree_t **trees, *old;
+
+  if (lc_index >= vec_len (am->tree_by_lc_index))
+    {
+      if (!t)
+	return;
+      /* a vector of the new size rather than move the current one */
+      trees = vec_dup (am->tree_by_lc_index);
+      vec_validate (trees, lc_index);
+      trees = clib_atomic_swap_rel_n (&am->tree_by_lc_index, trees);
+      vlib_worker_wait_one_loop ();
+      vec_free (trees);
+    }
+
+  old = clib_atomic_swap_rel_n (&am->tree_by_lc_index[lc_index], t);
+  if (old)
+    {
+      vlib_worker_wait_one_loop ();
+      tree_acl_free (old);
+    }
+}
+
+void
+tree_acl_rebuild (acl_main_t * am, u32 lc_index)
+{
+  acl_tree_t *t = 0;
+
+  if (am->use_tree_acl_matching
+      && !pool_is_free_index (am->acl_lookup_contexts, lc_index))
+    t = tree_acl_build (am, lc_index);
+
+  tree_acl_publish (am, lc_index, t);
+}
+
+void
+tree_acl_edit_ace (acl_main_t * am, u32 lc_index, u32 acl_index,
+		   u32 ace_index, acl_ace_change_t change)
+{
+  acl_tree_t *old = 0, *t = 0;
+
+  if (lc_index < vec_len (am->tree_by_lc_index))
+    old = am->tree_by_lc_index[lc_index];
+
+  /* the edits drift away from the tree a full build would make */
+  if (am->use_tree_acl_matching && old
+      && old->n_edits < vec_len (old->rules) / ACL_TREE_EDITS_FRACTION)
+    t = tree_acl_update (am, lc_index, old, acl_index, ace_index, change);
+
+  if (t)
+    tree_acl_publish (am, lc_index, t);
+  else
+    tree_acl_rebuild (am, lc_index);
+}
+
+void
+tree_acl_rebuild_all (acl_main_t * am)
+{
+  u32 lc_index;
+  u32 n = clib_max (vec_len (am->tree_by_lc_index),
+		    pool_len (am->acl_lookup_contexts));
+
+  for (lc_index = 0; lc_index < n; lc_index++)
+    tree_acl_rebuild (am, lc_index);
+}
+
+void
+acl_plugin_show_tables_tree (u32 lc_index)
+{
+  acl_main_t *am = &acl_main;
+  vlib_main_t *vm = am->vlib_main;
+  u32 lci;
+  int is_ip6;
+
+  vlib_cli_output (vm, "Decision trees (tree matching %s):",
+		   am->use_tree_acl_matching ? "enabled" : "disabled");
+  for (lci = 0; lci < vec_len (am->tree_by_lc_index); lci++)
+    {
+      acl_tree_t *t = am->tree_by_lc_index[lci];
+      uword bytes;
+
+      if ((lc_index != ~0) && (lc_index != lci))
+	continue;
+      if (!t)
+	continue;
+      bytes = vec_bytes (t->nodes) + vec_bytes (t->leaves) +
+	vec_bytes (t->leaf_rules) + vec_bytes (t->rules);
+      vlib_cli_output (vm, "  lc_index %d: %d ACEs, %d nodes, %d leaves, "
+		       "%d ACE references, %U", lci, vec_len (t->rules),
+		       vec_len (t->nodes), vec_len (t->leaves),
+		       vec_len (t->leaf_rules), format_memory_size, bytes);
+      for (is_ip6 = 0; is_ip6 <= 1; is_ip6++)
+	vlib_cli_output (vm, "    %s: max depth %d, max ACEs per leaf %d",
+			 is_ip6 ? "ip6" : "ip4", t->max_depth[is_ip6],
+			 t->max_leaf_rules[is_ip6]);
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _ACL_TREE_LOOKUP_H_
+#define _ACL_TREE_LOOKUP_H_
+
+#include "acl.h"
+
+/*
+ * Compile the decision tree for the ACLs of the lookup context and publish
+ * it in place of the current one, or just drop the current one if the
+ * tree matching is off or the lookup context is gone.
+ */
+void tree_acl_rebuild (acl_main_t *am, u32 lc_index);
+
+/*
+ * Update the tree of the lookup context after the insert, replace or
+ * delete of a single ACE of one of its ACLs, or rebuild it if that is
+ * not possible.
+ */
+void tree_acl_edit_ace (acl_main_t *am, u32 lc_index, u32 acl_index,
+			u32 ace_index, acl_ace_change_t change);
+
+/* Rebuild the trees of all the lookup contexts, e.g. on enable/disable */
+void tree_acl_rebuild_all (acl_main_t *am);
+
+void acl_plugin_show_tables_tree (u32 lc_index);
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _ACL_TREE_LOOKUP_TYPES_H_
+#define _ACL_TREE_LOOKUP_TYPES_H_
+
+#include "types.h"
+
+/*
+ * The fields of the 5-tuple the decision tree splits on. IPv6 addresses
+ * are cut in two 64 bit halves, which keeps every prefix a single range
+ * in each of the dimensions. IPv4 addresses only use the _HI dimensions.
+ */
+typedef enum {
+  ACL_TREE_DIM_SRC_HI,
+  ACL_TREE_DIM_SRC_LO,
+  ACL_TREE_DIM_DST_HI,
+  ACL_TREE_DIM_DST_LO,
+  ACL_TREE_DIM_PROTO,
+  ACL_TREE_DIM_SPORT,
+  ACL_TREE_DIM_DPORT,
+  ACL_TREE_N_DIM,
+} acl_tree_dim_t;
+
+/* set in a child index which refers to a leaf rather than to a node */
+#define ACL_TREE_LEAF (1U << 31)
+
+/* max rules in a leaf, the build gives up on the tree rather than exceed it */
+#define ACL_TREE_LEAF_RULES 8
+/* max number of nodes on the path from the root to a leaf */
+#define ACL_TREE_MAX_DEPTH 32
+
+typedef struct {
+  /* the packets with key[dim] >= threshold go to child[1] */
+  u64 threshold;
+  u32 child[2];
+  u8 dim;
+} acl_tree_node_t;
+
+typedef struct {
+  /* slice of the leaf_rules vector */
+  u32 first_rule;
+  u32 n_rules;
+} acl_tree_leaf_t;
+
+/*
+ * An ACE of the lookup context as the box of the keys it matches,
+ * with the addresses and ports in host byte order.
+ */
+typedef struct {
+  u64 lo[ACL_TREE_N_DIM];
+  u64 hi[ACL_TREE_N_DIM];
+  u32 acl_index;
+  u32 ace_index;
+  u32 acl_position;
+  u8 is_permit;
+  u8 proto;
+  u8 tcp_flags_value;
+  u8 tcp_flags_mask;
+  u8 is_ip6;
+} acl_tree_rule_t;
+
+/*
+ * The decision tree compiled from all the ACEs of a lookup context.
+ * It is read-only once published: a change of the ACLs makes a new tree,
+ * which replaces the old one.
+ */
+typedef struct {
+  acl_tree_node_t *nodes;
+  acl_tree_leaf_t *leaves;
+  /* indices into rules, in ascending order within each leaf */
+  u32 *leaf_rules;
+  /* in the order the ACEs are evaluated */
+  acl_tree_rule_t *rules;
+  /* root of the IPv4 and the IPv6 tree */
+  u32 root[2];
+  /* the worst case per lookup, for show */
+  u32 max_depth[2];
+  u32 max_leaf_rules[2];
+  /* single ACE edits applied since the last full build */
+  u32 n_edits;
+} acl_tree_t;
+
+#endif
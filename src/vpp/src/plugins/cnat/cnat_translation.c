@@ -490,7 +490,7 @@ format_cnat_translation (u8 * s, va_list * args)
     s = format (s, "\n%U", format_cnat_ep_trk, ck, 2);
 
   /* If printing a trace, the LB object might be deleted */
-  if (!pool_is_free_index (load_balance_pool, ct->ct_lb.dpoi_index))
+  if (!chunk_pool_is_free_index (&load_balance_pool, ct->ct_lb.dpoi_index))
     {
       s = format (s, "\n via:");
       s = format (s, "\n%U%U",
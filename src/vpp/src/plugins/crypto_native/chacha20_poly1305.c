@@ -0,0 +1,747 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2021 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/plugin/plugin.h>
+#include <vnet/crypto/crypto.h>
+#include <crypto_native/crypto_native.h>
+
+#if __GNUC__ > 4  && !__clang__ && CLIB_DEBUG == 0
+#pragma GCC optimize ("O3")
+#endif
+
+/*
+ * RFC 8439 ChaCha20-Poly1305, vectorized across ops - each u32 lane runs
+ * the chacha20 state of a different op and each u64 lane carries the
+ * poly1305 accumulator of a different op.
+ */
+
+#ifdef CLIB_HAVE_VEC512
+#define CHACHA_N_LANES 16
+#define u32xN u32x16
+#define u32xN_splat u32x16_splat
+#define u32xN_load_unaligned u32x16_load_unaligned
+#define u32xN_store_unaligned u32x16_store_unaligned
+#define POLY_N_LANES 8
+#define u64xP u64x8
+#define u64xP_splat u64x8_splat
+#define u64xP_mul_lo(a, b)                                                    \
+  (u64x8) _mm512_mul_epu32 ((__m512i) (a), (__m512i) (b))
+#elif defined(CLIB_HAVE_VEC256)
+#define CHACHA_N_LANES 8
+#define u32xN u32x8
+#define u32xN_splat u32x8_splat
+#define u32xN_load_unaligned u32x8_load_unaligned
+#define u32xN_store_unaligned u32x8_store_unaligned
+#define POLY_N_LANES 4
+#define u64xP u64x4
+#define u64xP_splat u64x4_splat
+#define u64xP_mul_lo(a, b)                                                    \
+  (u64x4) _mm256_mul_epu32 ((__m256i) (a), (__m256i) (b))
+#else
+#define CHACHA_N_LANES 4
+#define u32xN u32x4
+#define u32xN_splat u32x4_splat
+#define u32xN_load_unaligned u32x4_load_unaligned
+#define u32xN_store_unaligned u32x4_store_unaligned
+#define POLY_N_LANES 2
+#define u64xP u64x2
+#define u64xP_splat u64x2_splat
+#ifdef __aarch64__
+#define u64xP_mul_lo(a, b) (u64x2) vmull_u32 (vmovn_u64 (a), vmovn_u64 (b))
+#else
+#define u64xP_mul_lo(a, b)                                                    \
+  (u64x2) _mm_mul_epu32 ((__m128i) (a), (__m128i) (b))
+#endif
+#endif
+
+#define CHACHA_BLOCK_SIZE 64
+#define POLY_BLOCK_SIZE	  16
+#define POLY_KEY_SIZE	  32
+#define POLY_TAG_SIZE	  16
+
+/* ops are processed in batches small enough to keep the packet data cache
+ * resident between the chacha20 and the poly1305 pass */
+#define CHACHA_POLY_BATCH_SIZE (2 * CHACHA_N_LANES)
+
+typedef enum
+{
+  CHACHA_LANE_IDLE,
+  CHACHA_LANE_KEY,
+  CHACHA_LANE_DATA,
+  CHACHA_LANE_TAIL,
+} chacha_lane_state_t;
+
+typedef enum
+{
+  POLY_LANE_IDLE,
+  POLY_LANE_AAD,
+  POLY_LANE_AAD_TAIL,
+  POLY_LANE_DATA,
+  POLY_LANE_TAIL,
+} poly_lane_state_t;
+
+static const u32 chacha_const[4] = { 0x61707865, 0x3320646e, 0x79622d32,
+				     0x6b206574 };
+static const u8 chacha_zero_block[CHACHA_BLOCK_SIZE];
+
+static_always_inline u32xN
+u32xN_rotl (u32xN x, int n)
+{
+#ifndef CLIB_HAVE_VEC512
+  /* rotates by whole bytes are a single byte shuffle */
+#if CHACHA_N_LANES == 8
+  if (n == 16)
+    return (u32xN) u8x32_shuffle ((u8x32) x, 2, 3, 0, 1, 6, 7, 4, 5, 10, 11,
+				  8, 9, 14, 15, 12, 13, 18, 19, 16, 17, 22,
+				  23, 20, 21, 26, 27, 24, 25, 30, 31, 28, 29);
+  if (n == 8)
+    return (u32xN) u8x32_shuffle ((u8x32) x, 3, 0, 1, 2, 7, 4, 5, 6, 11, 8,
+				  9, 10, 15, 12, 13, 14, 19, 16, 17, 18, 23,
+				  20, 21, 22, 27, 24, 25, 26, 31, 28, 29, 30);
+#else
+  if (n == 16)
+    return (u32xN) u8x16_shuffle ((u8x16) x, 2, 3, 0, 1, 6, 7, 4, 5, 10, 11,
+				  8, 9, 14, 15, 12, 13);
+  if (n == 8)
+    return (u32xN) u8x16_shuffle ((u8x16) x, 3, 0, 1, 2, 7, 4, 5, 6, 11, 8,
+				  9, 10, 15, 12, 13, 14);
+#endif
+#endif
+  return (x << n) | (x >> (32 - n));
+}
+
+#define CHACHA_QUARTER_ROUND(a, b, c, d)                                      \
+  do                                                                          \
+    {                                                                         \
+      x[a] += x[b];                                                           \
+      x[d] = u32xN_rotl (x[d] ^ x[a], 16);                                    \
+      x[c] += x[d];                                                           \
+      x[b] = u32xN_rotl (x[b] ^ x[c], 12);                                    \
+      x[a] += x[b];                                                           \
+      x[d] = u32xN_rotl (x[d] ^ x[a], 8);                                     \
+      x[c] += x[d];                                                           \
+      x[b] = u32xN_rotl (x[b] ^ x[c], 7);                                     \
+    }                                                                         \
+  while (0)
+
+/* one keystream block for each lane, x[i] holds word i of all lanes */
+static_always_inline void
+chacha20_block (u32xN x[16], u32xN s[16])
+{
+  for (int i = 0; i < 16; i++)
+    x[i] = s[i];
+
+  for (int i = 0; i < 10; i++)
+    {
+      CHACHA_QUARTER_ROUND (0, 4, 8, 12);
+      CHACHA_QUARTER_ROUND (1, 5, 9, 13);
+      CHACHA_QUARTER_ROUND (2, 6, 10, 14);
+      CHACHA_QUARTER_ROUND (3, 7, 11, 15);
+      CHACHA_QUARTER_ROUND (0, 5, 10, 15);
+      CHACHA_QUARTER_ROUND (1, 6, 11, 12);
+      CHACHA_QUARTER_ROUND (2, 7, 8, 13);
+      CHACHA_QUARTER_ROUND (3, 4, 9, 14);
+    }
+
+  for (int i = 0; i < 16; i++)
+    x[i] += s[i];
+}
+
+/* transpose keystream so x[k * CHACHA_N_LANES + lane] holds k-th
+ * CHACHA_N_LANES words of the lane's block */
+static_always_inline void
+chacha20_block_transpose (u32xN x[16])
+{
+#ifdef CLIB_HAVE_VEC512
+  u32x16_transpose (x);
+#elif defined(CLIB_HAVE_VEC256)
+  u32x8_transpose (x);
+  u32x8_transpose (x + 8);
+#else
+  for (int i = 0; i < 16; i += 4)
+    {
+      u32x4 t0 = u32x4_shuffle2 (x[i], x[i + 1], 0, 4, 1, 5);
+      u32x4 t1 = u32x4_shuffle2 (x[i], x[i + 1], 2, 6, 3, 7);
+      u32x4 t2 = u32x4_shuffle2 (x[i + 2], x[i + 3], 0, 4, 1, 5);
+      u32x4 t3 = u32x4_shuffle2 (x[i + 2], x[i + 3], 2, 6, 3, 7);
+      x[i] = u32x4_shuffle2 (t0, t2, 0, 1, 4, 5);
+      x[i + 1] = u32x4_shuffle2 (t0, t2, 2, 3, 6, 7);
+      x[i + 2] = u32x4_shuffle2 (t1, t3, 0, 1, 4, 5);
+      x[i + 3] = u32x4_shuffle2 (t1, t3, 2, 3, 6, 7);
+    }
+#endif
+}
+
+/* runs chacha20 over ops, optionally generating the poly1305 one-time key
+ * from block 0 first and optionally en/decrypting data from block 1 */
+static_always_inline void
+chacha20_ops (vnet_crypto_op_t *ops[], u32 n_ops,
+	      u8 poly_keys[][POLY_KEY_SIZE], int gen_key, int crypt)
+{
+  u8 tail[CHACHA_N_LANES][CHACHA_BLOCK_SIZE];
+  u8 state[CHACHA_N_LANES] = {};
+  u32 n_blocks[CHACHA_N_LANES] = {};
+  u32 op_index[CHACHA_N_LANES];
+  vnet_crypto_op_t *lane_op[CHACHA_N_LANES];
+  u8 *src[CHACHA_N_LANES], *dst[CHACHA_N_LANES];
+  u32xN s[16] = {}, x[16];
+  u32 i, j, k, count, n_busy, n_left = n_ops;
+
+  for (i = 0; i < 4; i++)
+    s[i] = u32xN_splat (chacha_const[i]);
+
+more:
+  n_busy = 0;
+  count = ~0;
+  for (i = 0; i < CHACHA_N_LANES; i++)
+    {
+      while (n_blocks[i] == 0)
+	{
+	  vnet_crypto_op_t *op = lane_op[i];
+	  u32 n_tail;
+	  u8 *key;
+
+	  if (state[i] == CHACHA_LANE_KEY)
+	    {
+	      clib_memcpy_fast (poly_keys[op_index[i]], tail[i],
+				POLY_KEY_SIZE);
+	      if (crypt)
+		{
+		  src[i] = op->src;
+		  dst[i] = op->dst;
+		  n_blocks[i] = op->len / CHACHA_BLOCK_SIZE;
+		  state[i] = CHACHA_LANE_DATA;
+		  continue;
+		}
+	    }
+	  else if (state[i] == CHACHA_LANE_DATA &&
+		   (n_tail = op->len % CHACHA_BLOCK_SIZE))
+	    {
+	      /* partial last block is processed in the lane scratch */
+	      clib_memcpy_fast (tail[i], src[i], n_tail);
+	      src[i] = dst[i] = tail[i];
+	      n_blocks[i] = 1;
+	      state[i] = CHACHA_LANE_TAIL;
+	      continue;
+	    }
+	  else if (state[i] == CHACHA_LANE_TAIL)
+	    {
+	      n_tail = op->len % CHACHA_BLOCK_SIZE;
+	      clib_memcpy_fast (op->dst + op->len - n_tail, tail[i], n_tail);
+	    }
+
+	  if (n_left == 0)
+	    {
+	      state[i] = CHACHA_LANE_IDLE;
+	      n_blocks[i] = ~0;
+	      break;
+	    }
+
+	  lane_op[i] = op = ops[n_ops - n_left];
+	  op_index[i] = n_ops - n_left;
+	  n_left--;
+
+	  key = vnet_crypto_get_key (op->key_index)->data;
+	  for (j = 0; j < 8; j++)
+	    s[4 + j][i] = ((u32u *) key)[j];
+	  s[12][i] = gen_key ? 0 : 1;
+	  for (j = 0; j < 3; j++)
+	    s[13 + j][i] = ((u32u *) op->iv)[j];
+
+	  if (gen_key)
+	    {
+	      src[i] = (u8 *) chacha_zero_block;
+	      dst[i] = tail[i];
+	      n_blocks[i] = 1;
+	      state[i] = CHACHA_LANE_KEY;
+	    }
+	  else
+	    {
+	      src[i] = op->src;
+	      dst[i] = op->dst;
+	      n_blocks[i] = op->len / CHACHA_BLOCK_SIZE;
+	      state[i] = CHACHA_LANE_DATA;
+	    }
+	}
+
+      if (state[i] != CHACHA_LANE_IDLE)
+	{
+	  n_busy++;
+	  count = clib_min (count, n_blocks[i]);
+	}
+    }
+
+  if (n_busy == 0)
+    return;
+
+  for (j = 0; j < count; j++)
+    {
+      chacha20_block (x, s);
+      chacha20_block_transpose (x);
+
+      for (i = 0; i < CHACHA_N_LANES; i++)
+	{
+	  if (state[i] == CHACHA_LANE_IDLE)
+	    continue;
+
+	  for (k = 0; k < 16 / CHACHA_N_LANES; k++)
+	    {
+	      u32 off = k * CHACHA_N_LANES * sizeof (u32);
+	      u32xN r = u32xN_load_unaligned (src[i] + off);
+	      u32xN_store_unaligned (r ^ x[k * CHACHA_N_LANES + i],
+				     dst[i] + off);
+	    }
+	  src[i] += CHACHA_BLOCK_SIZE;
+	  dst[i] += CHACHA_BLOCK_SIZE;
+	  n_blocks[i]--;
+	}
+
+      s[12] += u32xN_splat (1);
+    }
+
+  goto more;
+}
+
+static_always_inline void
+poly1305_finalize (u64xP h[5], int lane, u8 *key, u8 *tag)
+{
+  u32 h0 = h[0][lane], h1 = h[1][lane], h2 = h[2][lane];
+  u32 h3 = h[3][lane], h4 = h[4][lane];
+  u32 g0, g1, g2, g3, g4, c, mask;
+  u64 f;
+
+  /* fully carry h */
+  c = h1 >> 26;
+  h1 &= 0x3ffffff;
+  h2 += c;
+  c = h2 >> 26;
+  h2 &= 0x3ffffff;
+  h3 += c;
+  c = h3 >> 26;
+  h3 &= 0x3ffffff;
+  h4 += c;
+  c = h4 >> 26;
+  h4 &= 0x3ffffff;
+  h0 += c * 5;
+  c = h0 >> 26;
+  h0 &= 0x3ffffff;
+  h1 += c;
+
+  /* compute h - p and select it if h >= p */
+  g0 = h0 + 5;
+  c = g0 >> 26;
+  g0 &= 0x3ffffff;
+  g1 = h1 + c;
+  c = g1 >> 26;
+  g1 &= 0x3ffffff;
+  g2 = h2 + c;
+  c = g2 >> 26;
+  g2 &= 0x3ffffff;
+  g3 = h3 + c;
+  c = g3 >> 26;
+  g3 &= 0x3ffffff;
+  g4 = h4 + c - (1 << 26);
+
+  mask = (g4 >> 31) - 1;
+  h0 = (h0 & ~mask) | (g0 & mask);
+  h1 = (h1 & ~mask) | (g1 & mask);
+  h2 = (h2 & ~mask) | (g2 & mask);
+  h3 = (h3 & ~mask) | (g3 & mask);
+  h4 = (h4 & ~mask) | (g4 & mask);
+
+  /* tag = (h + s) % 2^128 */
+  f = (u64) (h0 | (h1 << 26)) + ((u32u *) key)[4];
+  ((u32u *) tag)[0] = f;
+  f = (u64) ((h1 >> 6) | (h2 << 20)) + ((u32u *) key)[5] + (f >> 32);
+  ((u32u *) tag)[1] = f;
+  f = (u64) ((h2 >> 12) | (h3 << 14)) + ((u32u *) key)[6] + (f >> 32);
+  ((u32u *) tag)[2] = f;
+  f = (u64) ((h3 >> 18) | (h4 << 8)) + ((u32u *) key)[7] + (f >> 32);
+  ((u32u *) tag)[3] = f;
+}
+
+/* runs poly1305 over aad and ciphertext of each op, sets op status and
+ * either stores or verifies the tag, returns number of failed ops */
+static_always_inline u32
+poly1305_ops (vnet_crypto_op_t *ops[], u32 n_ops,
+	      u8 poly_keys[][POLY_KEY_SIZE], int is_enc)
+{
+  u8 tail[POLY_N_LANES][2 * POLY_BLOCK_SIZE];
+  u8 state[POLY_N_LANES] = {};
+  u32 n_blocks[POLY_N_LANES] = {};
+  u32 op_index[POLY_N_LANES];
+  vnet_crypto_op_t *lane_op[POLY_N_LANES];
+  u8 *ptr[POLY_N_LANES];
+  u64xP h[5] = {}, r[5] = {}, r5[5] = {}, d[5], c;
+  u64xP mask = u64xP_splat (0x3ffffff);
+  u32 i, j, count, n_busy, n_left = n_ops, n_fail = 0;
+
+more:
+  n_busy = 0;
+  count = ~0;
+  for (i = 0; i < POLY_N_LANES; i++)
+    {
+      while (n_blocks[i] == 0)
+	{
+	  vnet_crypto_op_t *op = lane_op[i];
+	  u32 n_tail, t0, t1, t2, t3;
+	  u8 *key;
+
+	  if (state[i] == POLY_LANE_AAD &&
+	      (n_tail = op->aad_len % POLY_BLOCK_SIZE))
+	    {
+	      clib_memset_u8 (tail[i], 0, POLY_BLOCK_SIZE);
+	      clib_memcpy_fast (tail[i], ptr[i], n_tail);
+	      ptr[i] = tail[i];
+	      n_blocks[i] = 1;
+	      state[i] = POLY_LANE_AAD_TAIL;
+	      continue;
+	    }
+	  else if (state[i] == POLY_LANE_AAD ||
+		   state[i] == POLY_LANE_AAD_TAIL)
+	    {
+	      ptr[i] = is_enc ? op->dst : op->src;
+	      n_blocks[i] = op->len / POLY_BLOCK_SIZE;
+	      state[i] = POLY_LANE_DATA;
+	      continue;
+	    }
+	  else if (state[i] == POLY_LANE_DATA)
+	    {
+	      /* zero padded last data block followed by the lengths */
+	      u8 *p = tail[i];
+	      n_tail = op->len % POLY_BLOCK_SIZE;
+	      if (n_tail)
+		{
+		  clib_memset_u8 (p, 0, POLY_BLOCK_SIZE);
+		  clib_memcpy_fast (p, ptr[i], n_tail);
+		  p += POLY_BLOCK_SIZE;
+		}
+	      ((u64u *) p)[0] = op->aad_len;
+	      ((u64u *) p)[1] = op->len;
+	      ptr[i] = tail[i];
+	      n_blocks[i] = n_tail ? 2 : 1;
+	      state[i] = POLY_LANE_TAIL;
+	      continue;
+	    }
+	  else if (state[i] == POLY_LANE_TAIL)
+	    {
+	      u8 tag[POLY_TAG_SIZE], diff = 0;
+	      u32 tag_len = clib_min (op->tag_len, POLY_TAG_SIZE);
+	      poly1305_finalize (h, i, poly_keys[op_index[i]], tag);
+	      op->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+	      if (is_enc)
+		clib_memcpy_fast (op->tag, tag, tag_len);
+	      else
+		{
+		  /* constant time, don't tell how much of the tag matched */
+		  for (j = 0; j < tag_len; j++)
+		    diff |= op->tag[j] ^ tag[j];
+		  if (diff)
+		    {
+		      op->status = VNET_CRYPTO_OP_STATUS_FAIL_BAD_HMAC;
+		      n_fail++;
+		    }
+		}
+	    }
+
+	  if (n_left == 0)
+	    {
+	      state[i] = POLY_LANE_IDLE;
+	      n_blocks[i] = ~0;
+	      break;
+	    }
+
+	  lane_op[i] = op = ops[n_ops - n_left];
+	  op_index[i] = n_ops - n_left;
+	  n_left--;
+
+	  /* clamped r in 26-bit limbs */
+	  key = poly_keys[op_index[i]];
+	  t0 = ((u32u *) key)[0];
+	  t1 = ((u32u *) key)[1];
+	  t2 = ((u32u *) key)[2];
+	  t3 = ((u32u *) key)[3];
+	  r[0][i] = t0 & 0x3ffffff;
+	  r[1][i] = ((t0 >> 26) | (t1 << 6)) & 0x3ffff03;
+	  r[2][i] = ((t1 >> 20) | (t2 << 12)) & 0x3ffc0ff;
+	  r[3][i] = ((t2 >> 14) | (t3 << 18)) & 0x3f03fff;
+	  r[4][i] = (t3 >> 8) & 0x00fffff;
+	  for (j = 0; j < 5; j++)
+	    {
+	      r5[j][i] = r[j][i] * 5;
+	      h[j][i] = 0;
+	    }
+
+	  ptr[i] = op->aad;
+	  n_blocks[i] = op->aad_len / POLY_BLOCK_SIZE;
+	  state[i] = POLY_LANE_AAD;
+	}
+
+      if (state[i] != POLY_LANE_IDLE)
+	{
+	  n_busy++;
+	  count = clib_min (count, n_blocks[i]);
+	}
+    }
+
+  if (n_busy == 0)
+    return n_fail;
+
+  for (j = 0; j < count; j++)
+    {
+      u64xP lo = {}, hi = {};
+
+      for (i = 0; i < POLY_N_LANES; i++)
+	if (state[i] != POLY_LANE_IDLE)
+	  {
+	    lo[i] = ((u64u *) ptr[i])[0];
+	    hi[i] = ((u64u *) ptr[i])[1];
+	    ptr[i] += POLY_BLOCK_SIZE;
+	    n_blocks[i]--;
+	  }
+
+      /* h += m, with the 2^128 bit set */
+      h[0] += lo & mask;
+      h[1] += (lo >> 26) & mask;
+      h[2] += ((lo >> 52) | (hi << 12)) & mask;
+      h[3] += (hi >> 14) & mask;
+      h[4] += (hi >> 40) | u64xP_splat (1 << 24);
+
+      /* h *= r, partially reduced mod 2^130 - 5 */
+      d[0] = u64xP_mul_lo (h[0], r[0]) + u64xP_mul_lo (h[1], r5[4]) +
+	     u64xP_mul_lo (h[2], r5[3]) + u64xP_mul_lo (h[3], r5[2]) +
+	     u64xP_mul_lo (h[4], r5[1]);
+      d[1] = u64xP_mul_lo (h[0], r[1]) + u64xP_mul_lo (h[1], r[0]) +
+	     u64xP_mul_lo (h[2], r5[4]) + u64xP_mul_lo (h[3], r5[3]) +
+	     u64xP_mul_lo (h[4], r5[2]);
+      d[2] = u64xP_mul_lo (h[0], r[2]) + u64xP_mul_lo (h[1], r[1]) +
+	     u64xP_mul_lo (h[2], r[0]) + u64xP_mul_lo (h[3], r5[4]) +
+	     u64xP_mul_lo (h[4], r5[3]);
+      d[3] = u64xP_mul_lo (h[0], r[3]) + u64xP_mul_lo (h[1], r[2]) +
+	     u64xP_mul_lo (h[2], r[1]) + u64xP_mul_lo (h[3], r[0]) +
+	     u64xP_mul_lo (h[4], r5[4]);
+      d[4] = u64xP_mul_lo (h[0], r[4]) + u64xP_mul_lo (h[1], r[3]) +
+	     u64xP_mul_lo (h[2], r[2]) + u64xP_mul_lo (h[3], r[1]) +
+	     u64xP_mul_lo (h[4], r[0]);
+
+      c = d[0] >> 26;
+      h[0] = d[0] & mask;
+      d[1] += c;
+      c = d[1] >> 26;
+      h[1] = d[1] & mask;
+      d[2] += c;
+      c = d[2] >> 26;
+      h[2] = d[2] & mask;
+      d[3] += c;
+      c = d[3] >> 26;
+      h[3] = d[3] & mask;
+      d[4] += c;
+      c = d[4] >> 26;
+      h[4] = d[4] & mask;
+      h[0] += c + (c << 2);
+      c = h[0] >> 26;
+      h[0] &= mask;
+      h[1] += c;
+    }
+
+  goto more;
+}
+
+static_always_inline u32
+chacha20_poly1305_ops (vnet_crypto_op_t *ops[], u32 n_ops, int is_enc)
+{
+  u8 poly_keys[CHACHA_POLY_BATCH_SIZE][POLY_KEY_SIZE];
+  u32 n, n_fail = 0, n_left = n_ops;
+
+  while (n_left)
+    {
+      n = clib_min (n_left, CHACHA_POLY_BATCH_SIZE);
+
+      if (is_enc)
+	{
+	  chacha20_ops (ops, n, poly_keys, 1, 1);
+	  n_fail += poly1305_ops (ops, n, poly_keys, 1);
+	}
+      else
+	{
+	  /* authenticate ciphertext before it is decrypted in place */
+	  chacha20_ops (ops, n, poly_keys, 1, 0);
+	  n_fail += poly1305_ops (ops, n, poly_keys, 0);
+	  chacha20_ops (ops, n, 0, 0, 1);
+	}
+
+      ops += n;
+      n_left -= n;
+    }
+
+  clib_memset_u8 (poly_keys, 0, sizeof (poly_keys));
+  return n_ops - n_fail;
+}
+
+static u32
+chacha20_poly1305_ops_enc (vlib_main_t *vm, vnet_crypto_op_t *ops[],
+			   u32 n_ops)
+{
+  return chacha20_poly1305_ops (ops, n_ops, /* is_enc */ 1);
+}
+
+static u32
+chacha20_poly1305_ops_dec (vlib_main_t *vm, vnet_crypto_op_t *ops[],
+			   u32 n_ops)
+{
+  return chacha20_poly1305_ops (ops, n_ops, /* is_enc */ 0);
+}
+
+static_always_inline int
+chacha20_poly1305_enqueue (vlib_main_t *vm, vnet_crypto_async_frame_t *f,
+			   u8 aad_len, int is_enc)
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+  crypto_native_per_thread_data_t *ptd =
+    vec_elt_at_index (cm->per_thread_data, vm->thread_index);
+  vnet_crypto_op_t ops[CHACHA_POLY_BATCH_SIZE];
+  vnet_crypto_op_t *op_ptrs[CHACHA_POLY_BATCH_SIZE], *op;
+  vnet_crypto_async_frame_elt_t *fe;
+  u8 frame_state = VNET_CRYPTO_FRAME_STATE_SUCCESS;
+  u32 i, n, elt_index = 0;
+
+  while (elt_index < f->n_elts)
+    {
+      n = 0;
+      vec_reset_length (ptd->chunks);
+
+      for (; elt_index < f->n_elts && n < CHACHA_POLY_BATCH_SIZE;
+	   elt_index++)
+	{
+	  vlib_buffer_t *b = vlib_get_buffer (vm, f->buffer_indices[elt_index]);
+
+	  fe = f->elts + elt_index;
+	  op = ops + n;
+
+	  vnet_crypto_op_init (op, is_enc ?
+				     VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC :
+				     VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC);
+	  op->flags = fe->flags;
+	  op->key_index = fe->key_index;
+	  op->iv = fe->iv;
+	  op->aad = fe->aad;
+	  op->aad_len = aad_len;
+	  op->tag = fe->tag;
+	  op->tag_len = POLY_TAG_SIZE;
+	  op->user_data = elt_index;
+
+	  if (PREDICT_FALSE (fe->flags & VNET_CRYPTO_OP_FLAG_CHAINED_BUFFERS))
+	    {
+	      /* multi-segment packets are rare, leave them to whichever
+	       * engine serves chained ops */
+	      crypto_native_op_chunks (vm, ptd, b, op,
+				       fe->crypto_start_offset,
+				       fe->crypto_total_length);
+	      vnet_crypto_process_chained_ops (vm, op, ptd->chunks, 1);
+	      fe->status = op->status;
+	      if (fe->status != VNET_CRYPTO_OP_STATUS_COMPLETED)
+		frame_state = VNET_CRYPTO_FRAME_STATE_ELT_ERROR;
+	      continue;
+	    }
+
+	  op->src = op->dst = b->data + fe->crypto_start_offset;
+	  op->len = fe->crypto_total_length;
+	  op_ptrs[n++] = op;
+	}
+
+      if (n)
+	chacha20_poly1305_ops (op_ptrs, n, is_enc);
+
+      for (i = 0; i < n; i++)
+	{
+	  fe = f->elts + op_ptrs[i]->user_data;
+	  fe->status = op_ptrs[i]->status;
+	  if (fe->status != VNET_CRYPTO_OP_STATUS_COMPLETED)
+	    frame_state = VNET_CRYPTO_FRAME_STATE_ELT_ERROR;
+	}
+    }
+
+  f->state = frame_state;
+  crypto_native_frame_done (ptd, f);
+  return 0;
+}
+
+#define foreach_chacha20_poly1305_aad_len _ (0) _ (8) _ (12)
+
+#define _(a)                                                                  \
+  static int chacha20_poly1305_enqueue_enc_aad##a (                           \
+    vlib_main_t *vm, vnet_crypto_async_frame_t *f)                            \
+  {                                                                           \
+    return chacha20_poly1305_enqueue (vm, f, a, /* is_enc */ 1);              \
+  }                                                                           \
+  static int chacha20_poly1305_enqueue_dec_aad##a (                           \
+    vlib_main_t *vm, vnet_crypto_async_frame_t *f)                            \
+  {                                                                           \
+    return chacha20_poly1305_enqueue (vm, f, a, /* is_enc */ 0);              \
+  }
+
+foreach_chacha20_poly1305_aad_len;
+#undef _
+
+clib_error_t *
+#ifdef __VAES__
+crypto_native_chacha20_poly1305_init_icl (vlib_main_t *vm)
+#elif __AVX512F__
+crypto_native_chacha20_poly1305_init_skx (vlib_main_t *vm)
+#elif __aarch64__
+crypto_native_chacha20_poly1305_init_neon (vlib_main_t *vm)
+#elif __AVX2__
+crypto_native_chacha20_poly1305_init_hsw (vlib_main_t *vm)
+#else
+crypto_native_chacha20_poly1305_init_slm (vlib_main_t *vm)
+#endif
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+
+  vnet_crypto_register_ops_handler (vm, cm->crypto_engine_index,
+				    VNET_CRYPTO_OP_CHACHA20_POLY1305_ENC,
+				    chacha20_poly1305_ops_enc);
+  vnet_crypto_register_ops_handler (vm, cm->crypto_engine_index,
+				    VNET_CRYPTO_OP_CHACHA20_POLY1305_DEC,
+				    chacha20_poly1305_ops_dec);
+
+  if (cm->async_enabled)
+    {
+#define _(a)                                                                  \
+  vnet_crypto_register_enqueue_handler (                                      \
+    vm, cm->crypto_engine_index,                                              \
+    VNET_CRYPTO_OP_CHACHA20_POLY1305_TAG16_AAD##a##_ENC,                      \
+    chacha20_poly1305_enqueue_enc_aad##a);                                    \
+  vnet_crypto_register_enqueue_handler (                                      \
+    vm, cm->crypto_engine_index,                                              \
+    VNET_CRYPTO_OP_CHACHA20_POLY1305_TAG16_AAD##a##_DEC,                      \
+    chacha20_poly1305_enqueue_dec_aad##a);
+      foreach_chacha20_poly1305_aad_len;
+#undef _
+    }
+
+  return 0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
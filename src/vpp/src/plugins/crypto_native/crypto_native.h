@@ -24,6 +24,11 @@ typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   u8x16 cbc_iv[16];
+  /* async frames completed at enqueue time, handed back in order from
+   * frames_done_head on */
+  vnet_crypto_async_frame_t **frames_done;
+  u32 frames_done_head;
+  vnet_crypto_op_chunk_t *chunks;
 } crypto_native_per_thread_data_t;
 
 typedef struct
@@ -32,6 +37,8 @@ typedef struct
   crypto_native_per_thread_data_t *per_thread_data;
   crypto_native_key_fn_t *key_fn[VNET_CRYPTO_N_ALGS];
   void **key_data;
+  /* serve async ops, set by 'crypto-native { async }' */
+  u8 async_enabled;
 } crypto_native_main_t;
 
 extern crypto_native_main_t crypto_native_main;
@@ -41,10 +48,55 @@ extern crypto_native_main_t crypto_native_main;
 #define _(v) \
 clib_error_t __clib_weak *crypto_native_aes_cbc_init_##v (vlib_main_t * vm); \
 clib_error_t __clib_weak *crypto_native_aes_gcm_init_##v (vlib_main_t * vm); \
+clib_error_t __clib_weak *crypto_native_hmac_init_##v (vlib_main_t * vm); \
+clib_error_t __clib_weak * \
+crypto_native_chacha20_poly1305_init_##v (vlib_main_t * vm); \
 
 foreach_crypto_native_march_variant;
 #undef _
 
+/* build the chunk list of an async frame element spanning chained buffers */
+static_always_inline void
+crypto_native_op_chunks (vlib_main_t *vm,
+			 crypto_native_per_thread_data_t *ptd, vlib_buffer_t *b,
+			 vnet_crypto_op_t *op, i16 offset, u32 len)
+{
+  vnet_crypto_op_chunk_t *ch;
+
+  op->flags |= VNET_CRYPTO_OP_FLAG_CHAINED_BUFFERS;
+  op->chunk_index = vec_len (ptd->chunks);
+  op->n_chunks = 1;
+
+  vec_add2 (ptd->chunks, ch, 1);
+  offset = clib_min (b->current_data + b->current_length, offset);
+  ch->src = ch->dst = b->data + offset;
+  ch->len = clib_min (b->current_data + b->current_length - offset, len);
+  len -= ch->len;
+
+  while (len && b->flags & VLIB_BUFFER_NEXT_PRESENT)
+    {
+      b = vlib_get_buffer (vm, b->next_buffer);
+      vec_add2 (ptd->chunks, ch, 1);
+      ch->src = ch->dst = vlib_buffer_get_current (b);
+      ch->len = clib_min (b->current_length, len);
+      len -= ch->len;
+      op->n_chunks++;
+    }
+
+  /* ESP with ESN stashes the high sequence bits past the end of the last
+   * buffer without updating its length */
+  if (len && vlib_buffer_space_left_at_end (vm, b) >= len)
+    ch->len += len;
+}
+
+/* queue an async frame completed at enqueue time for the dequeue handler */
+static_always_inline void
+crypto_native_frame_done (crypto_native_per_thread_data_t *ptd,
+			  vnet_crypto_async_frame_t *f)
+{
+  vec_add1 (ptd->frames_done, f);
+}
+
 #endif /* __crypto_native_h__ */
 
 /*
@@ -0,0 +1,387 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2021 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/plugin/plugin.h>
+#include <vnet/crypto/crypto.h>
+#include <crypto_native/crypto_native.h>
+#include <crypto_native/sha.h>
+
+#if __GNUC__ > 4  && !__clang__ && CLIB_DEBUG == 0
+#pragma GCC optimize ("O3")
+#endif
+
+typedef struct
+{
+  /* hash state after compressing (key ^ ipad) and (key ^ opad) blocks */
+  u32 ipad[8];
+  u32 opad[8];
+} hmac_key_data_t;
+
+typedef enum
+{
+  HMAC_LANE_IDLE,
+  HMAC_LANE_DATA,
+  HMAC_LANE_TAIL,
+  HMAC_LANE_OUTER,
+} hmac_lane_state_t;
+
+/* linked cipher + hmac frames are processed in batches small enough to keep
+ * the packet data cache resident between the cipher and the hmac pass */
+#define HMAC_LINK_BATCH_SIZE (2 * SHA_N_LANES)
+
+static_always_inline u32
+hmac_ops (vlib_main_t *vm, vnet_crypto_op_t *ops[], u32 n_ops, sha_type_t t)
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+  u32 digest_size = SHA_DIGEST_SIZE (t);
+  u8 placeholder[4096];
+  u8 tail[SHA_N_LANES][2 * SHA_BLOCK_SIZE];
+  u8 digest[32];
+  u8 state[SHA_N_LANES] = { };
+  vnet_crypto_op_t *lane_op[SHA_N_LANES];
+  hmac_key_data_t *kd[SHA_N_LANES];
+  u8 *ptr[SHA_N_LANES];
+  u32xN s[8] = { }, w[16], n_blocks = { };
+  u32 i, j, count, n_busy, n_left = n_ops, n_fail = 0;
+
+more:
+  n_busy = 0;
+  for (i = 0; i < SHA_N_LANES; i++)
+    {
+      while (n_blocks[i] == 0)
+	{
+	  vnet_crypto_op_t *op = lane_op[i];
+
+	  if (state[i] == HMAC_LANE_DATA)
+	    {
+	      /* full blocks consumed, continue with the padded tail */
+	      ptr[i] = tail[i];
+	      n_blocks[i] = sha_tail (tail[i], op->src, op->len,
+				      SHA_BLOCK_SIZE + op->len);
+	      state[i] = HMAC_LANE_TAIL;
+	    }
+	  else if (state[i] == HMAC_LANE_TAIL)
+	    {
+	      /* inner hash done, outer hash is a single block */
+	      sha_state_store (t, s, i, digest);
+	      sha_tail (tail[i], digest, digest_size,
+			SHA_BLOCK_SIZE + digest_size);
+	      for (j = 0; j < SHA_STATE_WORDS (t); j++)
+		s[j][i] = kd[i]->opad[j];
+	      ptr[i] = tail[i];
+	      n_blocks[i] = 1;
+	      state[i] = HMAC_LANE_OUTER;
+	    }
+	  else
+	    {
+	      if (state[i] == HMAC_LANE_OUTER)
+		{
+		  u32 len = op->digest_len ?
+			      clib_min (op->digest_len, digest_size) :
+			      digest_size;
+		  sha_state_store (t, s, i, digest);
+		  op->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+		  if ((op->flags & VNET_CRYPTO_OP_FLAG_HMAC_CHECK) == 0)
+		    clib_memcpy_fast (op->digest, digest, len);
+		  else if (memcmp (op->digest, digest, len))
+		    {
+		      op->status = VNET_CRYPTO_OP_STATUS_FAIL_BAD_HMAC;
+		      n_fail++;
+		    }
+		}
+
+	      if (n_left == 0)
+		{
+		  /* no more work to enqueue, so we are enqueueing placeholder
+		   * buffer */
+		  ptr[i] = placeholder;
+		  n_blocks[i] = sizeof (placeholder) / SHA_BLOCK_SIZE;
+		  state[i] = HMAC_LANE_IDLE;
+		}
+	      else
+		{
+		  lane_op[i] = op = ops[0];
+		  kd[i] = (hmac_key_data_t *) cm->key_data[op->key_index];
+		  for (j = 0; j < SHA_STATE_WORDS (t); j++)
+		    s[j][i] = kd[i]->ipad[j];
+		  ptr[i] = op->src;
+		  n_blocks[i] = op->len / SHA_BLOCK_SIZE;
+		  state[i] = HMAC_LANE_DATA;
+		  n_left--;
+		  ops++;
+		}
+	    }
+	}
+      n_busy += state[i] != HMAC_LANE_IDLE;
+    }
+
+  if (n_busy == 0)
+    return n_ops - n_fail;
+
+  count = u32xN_min_scalar (n_blocks);
+
+  for (j = 0; j < count; j++)
+    {
+      sha_load_block (w, ptr);
+      sha_block (t, s, w);
+      for (i = 0; i < SHA_N_LANES; i++)
+	ptr[i] += SHA_BLOCK_SIZE;
+    }
+
+  n_blocks -= u32xN_splat (count);
+  goto more;
+}
+
+static_always_inline void *
+hmac_key_exp (vnet_crypto_key_t *key, sha_type_t t)
+{
+  hmac_key_data_t *kd;
+  u32 key_len = vec_len (key->data);
+  u8 pad[SHA_BLOCK_SIZE] = { };
+  int i;
+
+  kd = clib_mem_alloc_aligned (sizeof (*kd), CLIB_CACHE_LINE_BYTES);
+
+  if (key_len > SHA_BLOCK_SIZE)
+    sha_digest_one (t, key->data, key_len, pad);
+  else
+    clib_memcpy_fast (pad, key->data, key_len);
+
+  for (i = 0; i < SHA_BLOCK_SIZE; i++)
+    pad[i] ^= 0x36;
+  clib_memcpy_fast (kd->ipad, sha_iv (t), SHA_STATE_WORDS (t) * sizeof (u32));
+  sha_compress_one (t, kd->ipad, pad, 1);
+
+  for (i = 0; i < SHA_BLOCK_SIZE; i++)
+    pad[i] ^= 0x36 ^ 0x5c;
+  clib_memcpy_fast (kd->opad, sha_iv (t), SHA_STATE_WORDS (t) * sizeof (u32));
+  sha_compress_one (t, kd->opad, pad, 1);
+
+  clib_memset_u8 (pad, 0, sizeof (pad));
+  return kd;
+}
+
+static_always_inline int
+hmac_link_enqueue (vlib_main_t *vm, vnet_crypto_async_frame_t *f,
+		   vnet_crypto_op_id_t cipher_op_id,
+		   vnet_crypto_op_id_t hmac_op_id, sha_type_t t, u8 digest_len,
+		   int is_enc)
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+  crypto_native_per_thread_data_t *ptd =
+    vec_elt_at_index (cm->per_thread_data, vm->thread_index);
+  vnet_crypto_op_t cipher_ops[HMAC_LINK_BATCH_SIZE];
+  vnet_crypto_op_t hmac_ops_data[HMAC_LINK_BATCH_SIZE];
+  vnet_crypto_op_t *hmac_op_ptrs[HMAC_LINK_BATCH_SIZE];
+  vnet_crypto_op_t *cop, *hop;
+  vnet_crypto_async_frame_elt_t *fe;
+  u8 frame_state = VNET_CRYPTO_FRAME_STATE_SUCCESS;
+  u32 i, n, n_chained, elt_index = 0;
+
+  while (elt_index < f->n_elts)
+    {
+      n = 0;
+      n_chained = 0;
+      vec_reset_length (ptd->chunks);
+
+      for (; elt_index < f->n_elts && n < HMAC_LINK_BATCH_SIZE; elt_index++)
+	{
+	  vlib_buffer_t *b = vlib_get_buffer (vm, f->buffer_indices[elt_index]);
+	  vnet_crypto_key_t *key;
+
+	  fe = f->elts + elt_index;
+	  key = vnet_crypto_get_key (fe->key_index);
+	  cop = cipher_ops + n;
+	  hop = hmac_ops_data + n;
+
+	  vnet_crypto_op_init (cop, cipher_op_id);
+	  cop->flags = fe->flags & ~VNET_CRYPTO_OP_FLAG_HMAC_CHECK;
+	  cop->key_index = key->index_crypto;
+	  cop->iv = fe->iv;
+	  cop->user_data = elt_index;
+
+	  vnet_crypto_op_init (hop, hmac_op_id);
+	  hop->flags = fe->flags & ~VNET_CRYPTO_OP_FLAG_INIT_IV;
+	  hop->key_index = key->index_integ;
+	  hop->digest = fe->digest;
+	  hop->digest_len = digest_len;
+	  hop->user_data = elt_index;
+
+	  if (PREDICT_FALSE (fe->flags & VNET_CRYPTO_OP_FLAG_CHAINED_BUFFERS))
+	    {
+	      /* multi-segment packets are rare, leave them to whichever
+	       * engine serves chained ops */
+	      crypto_native_op_chunks (vm, ptd, b, cop,
+				       fe->crypto_start_offset,
+				       fe->crypto_total_length);
+	      crypto_native_op_chunks (vm, ptd, b, hop, fe->integ_start_offset,
+				       fe->crypto_total_length +
+					 fe->integ_length_adj);
+	      if (is_enc)
+		{
+		  vnet_crypto_process_chained_ops (vm, cop, ptd->chunks, 1);
+		  vnet_crypto_process_chained_ops (vm, hop, ptd->chunks, 1);
+		}
+	      else
+		{
+		  vnet_crypto_process_chained_ops (vm, hop, ptd->chunks, 1);
+		  vnet_crypto_process_chained_ops (vm, cop, ptd->chunks, 1);
+		}
+	      fe->status = cop->status != VNET_CRYPTO_OP_STATUS_COMPLETED ?
+			     cop->status :
+			     hop->status;
+	      n_chained++;
+	      continue;
+	    }
+
+	  cop->src = cop->dst = b->data + fe->crypto_start_offset;
+	  cop->len = fe->crypto_total_length;
+	  hop->src = b->data + fe->integ_start_offset;
+	  hop->len = fe->crypto_total_length + fe->integ_length_adj;
+	  hmac_op_ptrs[n] = hop;
+	  n++;
+	}
+
+      /* cipher and hmac pass run back to back over the same batch, so
+       * packet data is pulled from memory once */
+      if (n && is_enc)
+	{
+	  vnet_crypto_process_ops (vm, cipher_ops, n);
+	  hmac_ops (vm, hmac_op_ptrs, n, t);
+	}
+      else if (n)
+	{
+	  hmac_ops (vm, hmac_op_ptrs, n, t);
+	  vnet_crypto_process_ops (vm, cipher_ops, n);
+	}
+
+      for (i = 0; i < n; i++)
+	{
+	  cop = cipher_ops + i;
+	  hop = hmac_op_ptrs[i];
+	  fe = f->elts + cop->user_data;
+	  fe->status = cop->status != VNET_CRYPTO_OP_STATUS_COMPLETED ?
+			 cop->status :
+			 hop->status;
+	  if (fe->status != VNET_CRYPTO_OP_STATUS_COMPLETED)
+	    frame_state = VNET_CRYPTO_FRAME_STATE_ELT_ERROR;
+	}
+
+      if (PREDICT_FALSE (n_chained))
+	for (i = elt_index - n - n_chained; i < elt_index; i++)
+	  if (f->elts[i].status != VNET_CRYPTO_OP_STATUS_COMPLETED)
+	    frame_state = VNET_CRYPTO_FRAME_STATE_ELT_ERROR;
+    }
+
+  f->state = frame_state;
+  crypto_native_frame_done (ptd, f);
+  return 0;
+}
+
+#define foreach_hmac_handler_type _ (SHA1, 1) _ (SHA224, 224) _ (SHA256, 256)
+
+#define _(a, b)                                                               \
+  static u32 hmac_ops_##a (vlib_main_t *vm, vnet_crypto_op_t *ops[],          \
+			   u32 n_ops)                                         \
+  {                                                                           \
+    return hmac_ops (vm, ops, n_ops, SHA_TYPE_##b);                           \
+  }                                                                           \
+  static void *hmac_key_exp_##a (vnet_crypto_key_t *key)                      \
+  {                                                                           \
+    return hmac_key_exp (key, SHA_TYPE_##b);                                  \
+  }
+
+foreach_hmac_handler_type;
+#undef _
+
+/* cipher, integ, tag length */
+#define foreach_hmac_link_handler_type                                        \
+  _ (AES_128_CBC, SHA1, 1, 12)                                                \
+  _ (AES_192_CBC, SHA1, 1, 12)                                                \
+  _ (AES_256_CBC, SHA1, 1, 12)                                                \
+  _ (AES_128_CBC, SHA224, 224, 14)                                            \
+  _ (AES_192_CBC, SHA224, 224, 14)                                            \
+  _ (AES_256_CBC, SHA224, 224, 14)                                            \
+  _ (AES_128_CBC, SHA256, 256, 16)                                            \
+  _ (AES_192_CBC, SHA256, 256, 16)                                            \
+  _ (AES_256_CBC, SHA256, 256, 16)
+
+#define _(c, h, b, d)                                                         \
+  static int hmac_link_enqueue_enc_##c##_##h (vlib_main_t *vm,                \
+					      vnet_crypto_async_frame_t *f)   \
+  {                                                                           \
+    return hmac_link_enqueue (vm, f, VNET_CRYPTO_OP_##c##_ENC,                \
+			      VNET_CRYPTO_OP_##h##_HMAC, SHA_TYPE_##b, d, 1); \
+  }                                                                           \
+  static int hmac_link_enqueue_dec_##c##_##h (vlib_main_t *vm,                \
+					      vnet_crypto_async_frame_t *f)   \
+  {                                                                           \
+    return hmac_link_enqueue (vm, f, VNET_CRYPTO_OP_##c##_DEC,                \
+			      VNET_CRYPTO_OP_##h##_HMAC, SHA_TYPE_##b, d, 0); \
+  }
+
+foreach_hmac_link_handler_type;
+#undef _
+
+clib_error_t *
+#ifdef __VAES__
+crypto_native_hmac_init_icl (vlib_main_t *vm)
+#elif __AVX512F__
+crypto_native_hmac_init_skx (vlib_main_t *vm)
+#elif __aarch64__
+crypto_native_hmac_init_neon (vlib_main_t *vm)
+#elif __AVX2__
+crypto_native_hmac_init_hsw (vlib_main_t *vm)
+#else
+crypto_native_hmac_init_slm (vlib_main_t *vm)
+#endif
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+
+#define _(a, b)                                                               \
+  vnet_crypto_register_ops_handler (vm, cm->crypto_engine_index,              \
+				    VNET_CRYPTO_OP_##a##_HMAC,                \
+				    hmac_ops_##a);                            \
+  cm->key_fn[VNET_CRYPTO_ALG_HMAC_##a] = hmac_key_exp_##a;
+  foreach_hmac_handler_type;
+#undef _
+
+  /* linked async ops are only served on request, see crypto_native_config */
+  if (cm->async_enabled)
+    {
+#define _(c, h, b, d)                                                         \
+  vnet_crypto_register_enqueue_handler (                                      \
+    vm, cm->crypto_engine_index, VNET_CRYPTO_OP_##c##_##h##_TAG##d##_ENC,     \
+    hmac_link_enqueue_enc_##c##_##h);                                         \
+  vnet_crypto_register_enqueue_handler (                                      \
+    vm, cm->crypto_engine_index, VNET_CRYPTO_OP_##c##_##h##_TAG##d##_DEC,     \
+    hmac_link_enqueue_dec_##c##_##h);
+      foreach_hmac_link_handler_type;
+#undef _
+    }
+
+  return 0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -29,7 +29,8 @@ crypto_native_key_handler (vlib_main_t * vm, vnet_crypto_key_op_t kop,
   vnet_crypto_key_t *key = vnet_crypto_get_key (idx);
   crypto_native_main_t *cm = &crypto_native_main;
 
-  /** TODO: add linked alg support **/
+  /* linked keys carry no data of their own, linked op handlers use the
+   * crypto and integ keys they point to */
   if (key->type == VNET_CRYPTO_KEY_TYPE_LINK)
     return;
 
@@ -59,6 +60,31 @@ crypto_native_key_handler (vlib_main_t * vm, vnet_crypto_key_op_t kop,
   cm->key_data[idx] = cm->key_fn[key->alg] (key);
 }
 
+/* native async handlers complete frames at enqueue time, dequeue only
+ * hands them back on the enqueueing thread */
+static vnet_crypto_async_frame_t *
+crypto_native_frame_dequeue (vlib_main_t *vm, u32 *nb_elts_processed,
+			     u32 *enqueue_thread_idx)
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+  crypto_native_per_thread_data_t *ptd =
+    vec_elt_at_index (cm->per_thread_data, vm->thread_index);
+  vnet_crypto_async_frame_t *f;
+
+  if (ptd->frames_done_head >= vec_len (ptd->frames_done))
+    return 0;
+
+  f = ptd->frames_done[ptd->frames_done_head++];
+  if (ptd->frames_done_head == vec_len (ptd->frames_done))
+    {
+      vec_reset_length (ptd->frames_done);
+      ptd->frames_done_head = 0;
+    }
+  *nb_elts_processed = f->n_elts;
+  *enqueue_thread_idx = f->enqueue_thread_index;
+  return f;
+}
+
 clib_error_t *
 crypto_native_init (vlib_main_t * vm)
 {
@@ -126,9 +152,57 @@ crypto_native_init (vlib_main_t * vm)
     goto error;
 #endif
 
+  if (0);
+#if __x86_64__
+  else if (crypto_native_hmac_init_icl && clib_cpu_supports_vaes ())
+    error = crypto_native_hmac_init_icl (vm);
+  else if (crypto_native_hmac_init_skx && clib_cpu_supports_avx512f ())
+    error = crypto_native_hmac_init_skx (vm);
+  else if (crypto_native_hmac_init_hsw && clib_cpu_supports_avx2 ())
+    error = crypto_native_hmac_init_hsw (vm);
+  else if (crypto_native_hmac_init_slm)
+    error = crypto_native_hmac_init_slm (vm);
+#endif
+#if __aarch64__
+  else if (crypto_native_hmac_init_neon)
+    error = crypto_native_hmac_init_neon (vm);
+#endif
+  else
+    error = clib_error_return (0, "No HMAC implemenation available");
+
+  if (error)
+    goto error;
+
+  if (0);
+#if __x86_64__
+  else if (crypto_native_chacha20_poly1305_init_icl &&
+	   clib_cpu_supports_vaes ())
+    error = crypto_native_chacha20_poly1305_init_icl (vm);
+  else if (crypto_native_chacha20_poly1305_init_skx &&
+	   clib_cpu_supports_avx512f ())
+    error = crypto_native_chacha20_poly1305_init_skx (vm);
+  else if (crypto_native_chacha20_poly1305_init_hsw &&
+	   clib_cpu_supports_avx2 ())
+    error = crypto_native_chacha20_poly1305_init_hsw (vm);
+  else if (crypto_native_chacha20_poly1305_init_slm)
+    error = crypto_native_chacha20_poly1305_init_slm (vm);
+#endif
+#if __aarch64__
+  else if (crypto_native_chacha20_poly1305_init_neon)
+    error = crypto_native_chacha20_poly1305_init_neon (vm);
+#endif
+  else
+    error = clib_error_return (0, "No ChaCha20-Poly1305 implemenation "
+			       "available");
+
+  if (error)
+    goto error;
+
   vnet_crypto_register_key_handler (vm, cm->crypto_engine_index,
 				    crypto_native_key_handler);
-
+  if (cm->async_enabled)
+    vnet_crypto_register_dequeue_handler (vm, cm->crypto_engine_index,
+					  crypto_native_frame_dequeue);
 
 error:
   if (error)
@@ -137,6 +211,28 @@ error:
   return error;
 }
 
+static clib_error_t *
+crypto_native_config (vlib_main_t *vm, unformat_input_t *input)
+{
+  crypto_native_main_t *cm = &crypto_native_main;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      /* async handlers complete frames synchronously on the enqueueing
+       * thread, so they are only registered on request and otherwise leave
+       * async ops to the engines that offload them */
+      if (unformat (input, "async"))
+	cm->async_enabled = 1;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  return 0;
+}
+
+VLIB_EARLY_CONFIG_FUNCTION (crypto_native_config, "crypto-native");
+
 /* *INDENT-OFF* */
 VLIB_INIT_FUNCTION (crypto_native_init) =
 {
@@ -0,0 +1,304 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2021 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef __crypto_native_sha_h__
+#define __crypto_native_sha_h__
+
+#include <vppinfra/sha2.h>
+
+/*
+ * Multi-buffer SHA-1 and SHA-256 - each vector lane carries the state of
+ * an independent message, so one pass over the rounds compresses one
+ * 64-byte block of N different buffers.
+ */
+
+#ifdef CLIB_HAVE_VEC512
+#define SHA_N_LANES 16
+#define u32xN u32x16
+#define u32xN_splat u32x16_splat
+#define u32xN_min_scalar u32x16_min_scalar
+#define u32xN_byte_swap u32x16_byte_swap
+#elif defined(CLIB_HAVE_VEC256)
+#define SHA_N_LANES 8
+#define u32xN u32x8
+#define u32xN_splat u32x8_splat
+#define u32xN_min_scalar u32x8_min_scalar
+#define u32xN_byte_swap u32x8_byte_swap
+#else
+#define SHA_N_LANES 4
+#define u32xN u32x4
+#define u32xN_splat u32x4_splat
+#define u32xN_min_scalar u32x4_min_scalar
+#define u32xN_byte_swap u32x4_byte_swap
+#endif
+
+#define SHA_BLOCK_SIZE 64
+
+typedef enum
+{
+  SHA_TYPE_1,
+  SHA_TYPE_224,
+  SHA_TYPE_256,
+} sha_type_t;
+
+#define SHA_STATE_WORDS(t) ((t) == SHA_TYPE_1 ? 5 : 8)
+#define SHA_DIGEST_SIZE(t)                                                    \
+  ((t) == SHA_TYPE_1 ? 20 : (t) == SHA_TYPE_224 ? 28 : 32)
+
+static const u32 sha1_h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe,
+			       0x10325476, 0xc3d2e1f0 };
+
+static_always_inline const u32 *
+sha_iv (sha_type_t t)
+{
+  return t == SHA_TYPE_1 ? sha1_h : t == SHA_TYPE_224 ? sha224_h : sha256_h;
+}
+
+static_always_inline u32xN
+u32xN_rotl (u32xN x, int n)
+{
+  return (x << n) | (x >> (32 - n));
+}
+
+static_always_inline u32xN
+u32xN_xor3 (u32xN a, u32xN b, u32xN c)
+{
+#ifdef CLIB_HAVE_VEC512
+  return u32x16_ternary_logic (a, b, c, 0x96);
+#else
+  return a ^ b ^ c;
+#endif
+}
+
+static_always_inline u32xN
+u32xN_choose (u32xN a, u32xN b, u32xN c)
+{
+#ifdef CLIB_HAVE_VEC512
+  return u32x16_ternary_logic (a, b, c, 0xca);
+#else
+  return c ^ (a & (b ^ c));
+#endif
+}
+
+static_always_inline u32xN
+u32xN_majority (u32xN a, u32xN b, u32xN c)
+{
+#ifdef CLIB_HAVE_VEC512
+  return u32x16_ternary_logic (a, b, c, 0xe8);
+#else
+  return (a & b) | (c & (a | b));
+#endif
+}
+
+/* load one block from each lane and transpose it, so w[i] holds the i-th
+ * big-endian message word of all lanes */
+static_always_inline void
+sha_load_block (u32xN w[16], u8 *ptr[SHA_N_LANES])
+{
+#ifdef CLIB_HAVE_VEC512
+  for (int i = 0; i < 16; i++)
+    w[i] = u32x16_load_unaligned (ptr[i]);
+  u32x16_transpose (w);
+#elif defined(CLIB_HAVE_VEC256)
+  for (int i = 0; i < 8; i++)
+    {
+      w[i] = u32x8_load_unaligned (ptr[i]);
+      w[i + 8] = u32x8_load_unaligned (ptr[i] + 32);
+    }
+  u32x8_transpose (w);
+  u32x8_transpose (w + 8);
+#else
+  for (int i = 0; i < 16; i++)
+    w[i] = u32x4_gather (ptr[0] + 4 * i, ptr[1] + 4 * i, ptr[2] + 4 * i,
+			 ptr[3] + 4 * i);
+#endif
+  for (int i = 0; i < 16; i++)
+    w[i] = u32xN_byte_swap (w[i]);
+}
+
+#define SHA1_ROUND(f, k, a, b, c, d, e, i)                                    \
+  do                                                                          \
+    {                                                                         \
+      if (i >= 16)                                                            \
+	w[(i) & 15] = u32xN_rotl (w[((i) - 3) & 15] ^ w[((i) - 8) & 15] ^     \
+				   w[((i) - 14) & 15] ^ w[(i) & 15],          \
+				 1);                                          \
+      e += u32xN_rotl (a, 5) + f (b, c, d) + k + w[(i) & 15];                 \
+      b = u32xN_rotl (b, 30);                                                 \
+    }                                                                         \
+  while (0)
+
+#define SHA1_5_ROUNDS(f, k, i)                                                \
+  do                                                                          \
+    {                                                                         \
+      SHA1_ROUND (f, k, a, b, c, d, e, i);                                    \
+      SHA1_ROUND (f, k, e, a, b, c, d, i + 1);                                \
+      SHA1_ROUND (f, k, d, e, a, b, c, i + 2);                                \
+      SHA1_ROUND (f, k, c, d, e, a, b, i + 3);                                \
+      SHA1_ROUND (f, k, b, c, d, e, a, i + 4);                                \
+    }                                                                         \
+  while (0)
+
+static_always_inline void
+sha1_block (u32xN s[5], u32xN w[16])
+{
+  u32xN a = s[0], b = s[1], c = s[2], d = s[3], e = s[4];
+  int i;
+
+  for (i = 0; i < 20; i += 5)
+    SHA1_5_ROUNDS (u32xN_choose, 0x5a827999, i);
+  for (; i < 40; i += 5)
+    SHA1_5_ROUNDS (u32xN_xor3, 0x6ed9eba1, i);
+  for (; i < 60; i += 5)
+    SHA1_5_ROUNDS (u32xN_majority, 0x8f1bbcdc, i);
+  for (; i < 80; i += 5)
+    SHA1_5_ROUNDS (u32xN_xor3, 0xca62c1d6, i);
+
+  s[0] += a;
+  s[1] += b;
+  s[2] += c;
+  s[3] += d;
+  s[4] += e;
+}
+
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, i)                               \
+  do                                                                          \
+    {                                                                         \
+      u32xN t1, t2;                                                           \
+      if (i >= 16)                                                            \
+	w[(i) & 15] +=                                                        \
+	  w[((i) - 7) & 15] +                                                 \
+	  u32xN_xor3 (u32xN_rotl (w[((i) - 15) & 15], 25),                    \
+		      u32xN_rotl (w[((i) - 15) & 15], 14),                    \
+		      w[((i) - 15) & 15] >> 3) +                              \
+	  u32xN_xor3 (u32xN_rotl (w[((i) - 2) & 15], 15),                     \
+		      u32xN_rotl (w[((i) - 2) & 15], 13),                     \
+		      w[((i) - 2) & 15] >> 10);                               \
+      t1 = h + sha256_k[i] + w[(i) & 15] + u32xN_choose (e, f, g) +           \
+	   u32xN_xor3 (u32xN_rotl (e, 26), u32xN_rotl (e, 21),                \
+		       u32xN_rotl (e, 7));                                    \
+      t2 = u32xN_majority (a, b, c) +                                         \
+	   u32xN_xor3 (u32xN_rotl (a, 30), u32xN_rotl (a, 19),                \
+		       u32xN_rotl (a, 10));                                   \
+      d += t1;                                                                \
+      h = t1 + t2;                                                            \
+    }                                                                         \
+  while (0)
+
+static_always_inline void
+sha256_block (u32xN s[8], u32xN w[16])
+{
+  u32xN a = s[0], b = s[1], c = s[2], d = s[3];
+  u32xN e = s[4], f = s[5], g = s[6], h = s[7];
+
+  for (int i = 0; i < 64; i += 8)
+    {
+      SHA256_ROUND (a, b, c, d, e, f, g, h, i);
+      SHA256_ROUND (h, a, b, c, d, e, f, g, i + 1);
+      SHA256_ROUND (g, h, a, b, c, d, e, f, i + 2);
+      SHA256_ROUND (f, g, h, a, b, c, d, e, i + 3);
+      SHA256_ROUND (e, f, g, h, a, b, c, d, i + 4);
+      SHA256_ROUND (d, e, f, g, h, a, b, c, i + 5);
+      SHA256_ROUND (c, d, e, f, g, h, a, b, i + 6);
+      SHA256_ROUND (b, c, d, e, f, g, h, a, i + 7);
+    }
+
+  s[0] += a;
+  s[1] += b;
+  s[2] += c;
+  s[3] += d;
+  s[4] += e;
+  s[5] += f;
+  s[6] += g;
+  s[7] += h;
+}
+
+static_always_inline void
+sha_block (sha_type_t t, u32xN s[8], u32xN w[16])
+{
+  if (t == SHA_TYPE_1)
+    sha1_block (s, w);
+  else
+    sha256_block (s, w);
+}
+
+/* fill the final block(s) of a message whose last len % 64 bytes are in
+ * data, returns number of blocks written to tail */
+static_always_inline u32
+sha_tail (u8 tail[2 * SHA_BLOCK_SIZE], u8 *data, u32 len, u64 total_len)
+{
+  u32 n_bytes = len % SHA_BLOCK_SIZE;
+  u32 n_blocks = n_bytes + 9 > SHA_BLOCK_SIZE ? 2 : 1;
+  u8 *p = tail + n_blocks * SHA_BLOCK_SIZE - 8;
+
+  clib_memcpy_fast (tail, data + len - n_bytes, n_bytes);
+  tail[n_bytes] = 0x80;
+  clib_memset_u8 (tail + n_bytes + 1, 0, p - tail - n_bytes - 1);
+  *(u64u *) p = clib_host_to_net_u64 (total_len << 3);
+  return n_blocks;
+}
+
+static_always_inline void
+sha_state_store (sha_type_t t, u32xN s[8], int lane, u8 *dst)
+{
+  for (int i = 0; i < SHA_STATE_WORDS (t); i++)
+    ((u32u *) dst)[i] = clib_host_to_net_u32 (s[i][lane]);
+}
+
+/* single buffer helper for slow-path users (key setup), runs the same
+ * message through all lanes */
+static_always_inline void
+sha_compress_one (sha_type_t t, u32 state[8], u8 *data, u32 n_blocks)
+{
+  u32xN s[8], w[16];
+
+  for (int i = 0; i < SHA_STATE_WORDS (t); i++)
+    s[i] = u32xN_splat (state[i]);
+
+  for (; n_blocks; n_blocks--, data += SHA_BLOCK_SIZE)
+    {
+      for (int i = 0; i < 16; i++)
+	w[i] = u32xN_splat (clib_net_to_host_u32 (((u32u *) data)[i]));
+      sha_block (t, s, w);
+    }
+
+  for (int i = 0; i < SHA_STATE_WORDS (t); i++)
+    state[i] = s[i][0];
+}
+
+static_always_inline void
+sha_digest_one (sha_type_t t, u8 *data, u32 len, u8 *digest)
+{
+  u8 tail[2 * SHA_BLOCK_SIZE];
+  u32 state[8];
+
+  clib_memcpy_fast (state, sha_iv (t), SHA_STATE_WORDS (t) * sizeof (u32));
+  sha_compress_one (t, state, data, len / SHA_BLOCK_SIZE);
+  sha_compress_one (t, state, tail, sha_tail (tail, data, len, len));
+  for (int i = 0; i < SHA_DIGEST_SIZE (t) / 4; i++)
+    ((u32u *) digest)[i] = clib_host_to_net_u32 (state[i]);
+}
+
+#endif /* __crypto_native_sha_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
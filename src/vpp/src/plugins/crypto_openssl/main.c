@@ -107,8 +107,8 @@ openssl_ops_enc_cbc (vlib_main_t *vm, vnet_crypto_op_t *ops[],
 
       EVP_EncryptInit_ex (ctx, cipher, NULL, key->data, op->iv);
 
-      if (op->flags & VNET_CRYPTO_OP_FLAG_CHAINED_BUFFERS)
-	EVP_CIPHER_CTX_set_padding (ctx, 0);
+      /* callers pad the data themselves */
+      EVP_CIPHER_CTX_set_padding (ctx, 0);
 
       if (op->flags & VNET_CRYPTO_OP_FLAG_CHAINED_BUFFERS)
 	{
@@ -165,8 +165,7 @@ openssl_ops_dec_cbc (vlib_main_t *vm, vnet_crypto_op_t *ops[],
 
       EVP_DecryptInit_ex (ctx, cipher, NULL, key->data, op->iv);
 
-      if (op->flags & VNET_CRYPTO_OP_FLAG_CHAINED_BUFFERS)
-	EVP_CIPHER_CTX_set_padding (ctx, 0);
+      EVP_CIPHER_CTX_set_padding (ctx, 0);
 
       if (op->flags & VNET_CRYPTO_OP_FLAG_CHAINED_BUFFERS)
 	{
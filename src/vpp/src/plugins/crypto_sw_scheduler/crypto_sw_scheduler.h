@@ -25,6 +25,9 @@ STATIC_ASSERT ((0 == (CRYPTO_SW_SCHEDULER_QUEUE_SIZE &
 		      (CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1))),
 	       "CRYPTO_SW_SCHEDULER_QUEUE_SIZE is not pow2");
 
+/* max number of frames a worker takes from another worker's queue at once */
+#define CRYPTO_SW_SCHEDULER_STEAL_BATCH 4
+
 typedef enum crypto_sw_scheduler_queue_type_t_
 {
   CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT = 0,
@@ -32,21 +35,44 @@ typedef enum crypto_sw_scheduler_queue_type_t_
   CRYPTO_SW_SCHED_QUEUE_N_TYPES
 } crypto_sw_scheduler_queue_type_t;
 
+/*
+ * A queue belongs to the thread enqueueing the frames. The owner adds
+ * frames at head and returns the completed ones. Any thread takes
+ * pending frames for processing by moving the claim index with a CAS,
+ * so the frames between claim and head are the ones nobody works on.
+ * The frames are returned as soon as they complete, unless an older
+ * frame still in work uses one of their keys, which keeps the order of
+ * the frames of an SA. The slots of returned frames are cleared, and
+ * tail skips the cleared slots, so a non-empty slot at head means that
+ * the queue is full.
+ */
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   u32 head;
+  u32 claim;
   u32 tail;
   vnet_crypto_async_frame_t **jobs;
+  /* bitmap of the key indices (mod 64) used by the frame in each slot */
+  u64 *key_masks;
 } crypto_sw_scheduler_queue_t;
 
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   crypto_sw_scheduler_queue_t queue[CRYPTO_SW_SCHED_QUEUE_N_TYPES];
-  u32 last_serve_lcore_id;
+  /* threads to steal from, the ones on the same numa node first */
+  u32 *steal_order;
+  /* frames taken by the last steal, waiting for processing */
+  vnet_crypto_async_frame_t *stash[CRYPTO_SW_SCHEDULER_STEAL_BATCH];
+  u8 n_stash;
+  u8 steal_order_valid;
   u8 last_serve_encrypt;
   u8 last_return_queue;
+  u64 n_claimed;
+  u64 n_stolen;
+  u64 n_steals;
+  u64 n_out_of_order;
   vnet_crypto_op_t *crypto_ops;
   vnet_crypto_op_t *integ_ops;
   vnet_crypto_op_t *chained_crypto_ops;
@@ -66,6 +92,210 @@ extern crypto_sw_scheduler_main_t crypto_sw_scheduler_main;
 
 extern int crypto_sw_scheduler_set_worker_crypto (u32 worker_idx, u8 enabled);
 
+static_always_inline u32 *
+crypto_sw_scheduler_steal_order (u32 thread_index, u32 n_threads,
+				 u32 *numa_by_thread)
+{
+  u32 *order = 0, i, t;
+
+  /* the threads on the same numa node first, then the others, each list
+   * starting after the thread itself so that the thieves spread out */
+  for (i = 1; i < n_threads; i++)
+    {
+      t = (thread_index + i) % n_threads;
+      if (numa_by_thread[t] == numa_by_thread[thread_index])
+	vec_add1 (order, t);
+    }
+  for (i = 1; i < n_threads; i++)
+    {
+      t = (thread_index + i) % n_threads;
+      if (numa_by_thread[t] != numa_by_thread[thread_index])
+	vec_add1 (order, t);
+    }
+
+  return order;
+}
+
+static_always_inline void
+crypto_sw_scheduler_queue_init (crypto_sw_scheduler_queue_t *q)
+{
+  q->head = q->claim = q->tail = 0;
+  vec_validate_aligned (q->jobs, CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vec_validate_aligned (q->key_masks, CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1,
+			CLIB_CACHE_LINE_BYTES);
+}
+
+static_always_inline void
+crypto_sw_scheduler_queue_free (crypto_sw_scheduler_queue_t *q)
+{
+  vec_free (q->jobs);
+  vec_free (q->key_masks);
+}
+
+/* owner only */
+static_always_inline int
+crypto_sw_scheduler_queue_push (crypto_sw_scheduler_queue_t *q,
+				vnet_crypto_async_frame_t *f)
+{
+  u32 head = q->head, slot = head & CRYPTO_SW_SCHEDULER_QUEUE_MASK;
+  u64 key_mask = 0;
+  u32 i;
+
+  if (q->jobs[slot])
+    return -1;
+
+  for (i = 0; i < f->n_elts; i++)
+    key_mask |= 1ULL << (f->elts[i].key_index & 63);
+
+  q->key_masks[slot] = key_mask;
+  q->jobs[slot] = f;
+  CLIB_MEMORY_STORE_BARRIER ();
+  q->head = head + 1;
+  return 0;
+}
+
+/*
+ * Take up to max pending frames for processing, or half of the pending
+ * frames (but at least one) when stealing from another thread's queue.
+ */
+static_always_inline u32
+crypto_sw_scheduler_queue_claim (crypto_sw_scheduler_queue_t *q,
+				 vnet_crypto_async_frame_t **frames, u32 max,
+				 u8 is_steal)
+{
+  u32 claim, head, n, i;
+
+  do
+    {
+      claim = clib_atomic_load_acq_n (&q->claim);
+      head = clib_atomic_load_acq_n (&q->head);
+      n = head - claim;
+
+      if (n == 0)
+	return 0;
+
+      if (is_steal)
+	n = (n + 1) / 2;
+      n = clib_min (n, max);
+    }
+  while (!clib_atomic_bool_cmp_and_swap (&q->claim, claim, claim + n));
+
+  /* the claimed slots are not reused before the frames complete */
+  for (i = 0; i < n; i++)
+    {
+      frames[i] = q->jobs[(claim + i) & CRYPTO_SW_SCHEDULER_QUEUE_MASK];
+      frames[i]->state = VNET_CRYPTO_FRAME_STATE_WORK_IN_PROGRESS;
+    }
+
+  return n;
+}
+
+/*
+ * Next frame for the thread to process: a frame stolen earlier, a frame
+ * of its own queues or a batch of frames stolen from another thread.
+ * The stolen frames are processed even if the thread's crypto got
+ * disabled meanwhile, nobody else would.
+ */
+static_always_inline vnet_crypto_async_frame_t *
+crypto_sw_scheduler_get_frame (crypto_sw_scheduler_per_thread_data_t *ptds,
+			       crypto_sw_scheduler_per_thread_data_t *ptd)
+{
+  vnet_crypto_async_frame_t *frames[CRYPTO_SW_SCHEDULER_STEAL_BATCH];
+  u32 *victim, i, n, t;
+  u8 type;
+
+  if (ptd->n_stash)
+    return ptd->stash[--ptd->n_stash];
+
+  if (!ptd->self_crypto_enabled)
+    return 0;
+
+  type = ptd->last_serve_encrypt ? CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT :
+				   CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT;
+  ptd->last_serve_encrypt = !ptd->last_serve_encrypt;
+
+  for (t = 0; t < CRYPTO_SW_SCHED_QUEUE_N_TYPES; t++)
+    if (crypto_sw_scheduler_queue_claim (&ptd->queue[type ^ t], frames, 1,
+					 0))
+      {
+	ptd->n_claimed++;
+	return frames[0];
+      }
+
+  vec_foreach (victim, ptd->steal_order)
+    {
+      crypto_sw_scheduler_per_thread_data_t *st = ptds + victim[0];
+
+      for (t = 0; t < CRYPTO_SW_SCHED_QUEUE_N_TYPES; t++)
+	{
+	  crypto_sw_scheduler_queue_t *q = &st->queue[type ^ t];
+
+	  /* cheap check before touching the claim cache line for write */
+	  if (q->claim == q->head)
+	    continue;
+
+	  n = crypto_sw_scheduler_queue_claim (
+	    q, frames, CRYPTO_SW_SCHEDULER_STEAL_BATCH, 1);
+	  if (n == 0)
+	    continue;
+
+	  /* stash the rest, the oldest frame on top */
+	  for (i = n - 1; i > 0; i--)
+	    ptd->stash[ptd->n_stash++] = frames[i];
+
+	  ptd->n_stolen += n;
+	  ptd->n_steals++;
+	  return frames[0];
+	}
+    }
+
+  return 0;
+}
+
+/*
+ * Remove the oldest completed frame from the queue whose keys are not
+ * used by an older frame still in work. Owner only.
+ */
+static_always_inline vnet_crypto_async_frame_t *
+crypto_sw_scheduler_queue_pop (crypto_sw_scheduler_queue_t *q,
+			       u8 *is_out_of_order)
+{
+  u32 tail = q->tail, claim = clib_atomic_load_acq_n (&q->claim);
+  u64 blocked = 0;
+  u32 i;
+
+  /* the frames past claim are not complete and come after the others */
+  for (i = tail; i != claim; i++)
+    {
+      u32 slot = i & CRYPTO_SW_SCHEDULER_QUEUE_MASK;
+      vnet_crypto_async_frame_t *f = q->jobs[slot];
+
+      if (!f)
+	continue;
+
+      if (f->state >= VNET_CRYPTO_FRAME_STATE_SUCCESS &&
+	  !(q->key_masks[slot] & blocked))
+	{
+	  q->jobs[slot] = 0;
+	  *is_out_of_order = i != tail;
+
+	  while (tail != claim &&
+		 !q->jobs[tail & CRYPTO_SW_SCHEDULER_QUEUE_MASK])
+	    tail++;
+	  q->tail = tail;
+
+	  return f;
+	}
+
+      blocked |= q->key_masks[slot];
+      if (blocked == ~0ULL)
+	break;
+    }
+
+  return 0;
+}
+
 extern clib_error_t *crypto_sw_scheduler_api_init (vlib_main_t * vm);
 
 #endif // __crypto_native_h__
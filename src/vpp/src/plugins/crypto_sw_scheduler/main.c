@@ -50,6 +50,26 @@ crypto_sw_scheduler_set_worker_crypto (u32 worker_idx, u8 enabled)
   return 0;
 }
 
+static void
+crypto_sw_scheduler_update_steal_order (
+  crypto_sw_scheduler_per_thread_data_t *ptd, u32 thread_index)
+{
+  crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
+  u32 n_threads = vec_len (cm->per_thread_data);
+  u32 *numa_by_thread = 0, i;
+
+  /* the numa node of a thread is known once it runs */
+  for (i = 0; i < n_threads; i++)
+    vec_add1 (numa_by_thread, vlib_get_main_by_index (i)->numa_node);
+
+  vec_free (ptd->steal_order);
+  ptd->steal_order =
+    crypto_sw_scheduler_steal_order (thread_index, n_threads, numa_by_thread);
+  ptd->steal_order_valid = 1;
+
+  vec_free (numa_by_thread);
+}
+
 static void
 crypto_sw_scheduler_key_handler (vlib_main_t * vm, vnet_crypto_key_op_t kop,
 				 vnet_crypto_key_index_t idx)
@@ -83,9 +103,8 @@ crypto_sw_scheduler_frame_enqueue (vlib_main_t *vm,
   crypto_sw_scheduler_queue_t *current_queue =
     is_enc ? &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT] :
 	     &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT];
-  u64 head = current_queue->head;
 
-  if (current_queue->jobs[head & CRYPTO_SW_SCHEDULER_QUEUE_MASK])
+  if (crypto_sw_scheduler_queue_push (current_queue, frame))
     {
       u32 n_elts = frame->n_elts, i;
       for (i = 0; i < n_elts; i++)
@@ -93,10 +112,6 @@ crypto_sw_scheduler_frame_enqueue (vlib_main_t *vm,
       return -1;
     }
 
-  current_queue->jobs[head & CRYPTO_SW_SCHEDULER_QUEUE_MASK] = frame;
-  head += 1;
-  CLIB_MEMORY_STORE_BARRIER ();
-  current_queue->head = head;
   return 0;
 }
 
@@ -443,65 +458,17 @@ crypto_sw_scheduler_process_aead (vlib_main_t *vm,
       crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
       crypto_sw_scheduler_per_thread_data_t *ptd =
 	cm->per_thread_data + vm->thread_index;
-      vnet_crypto_async_frame_t *f = 0;
-      crypto_sw_scheduler_queue_t *current_queue = 0;
-      u32 tail, head;
-      u8 found = 0;
-
-      /* get a pending frame to process */
-      if (ptd->self_crypto_enabled)
-	{
-	  u32 i = ptd->last_serve_lcore_id + 1;
-
-	  while (1)
-	    {
-	      crypto_sw_scheduler_per_thread_data_t *st;
-	      u32 j;
-
-	      if (i >= vec_len (cm->per_thread_data))
-		i = 0;
-
-	      st = cm->per_thread_data + i;
-
-	      if (ptd->last_serve_encrypt)
-		current_queue = &st->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT];
-	      else
-		current_queue = &st->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT];
-
-	      tail = current_queue->tail;
-	      head = current_queue->head;
+      vnet_crypto_async_frame_t *f;
+      crypto_sw_scheduler_queue_t *current_queue;
+      u8 is_out_of_order;
 
-	      for (j = tail; j != head; j++)
-		{
+      if (PREDICT_FALSE (!ptd->steal_order_valid))
+	crypto_sw_scheduler_update_steal_order (ptd, vm->thread_index);
 
-		  f = current_queue->jobs[j & CRYPTO_SW_SCHEDULER_QUEUE_MASK];
-
-		  if (!f)
-		    continue;
-
-		  if (clib_atomic_bool_cmp_and_swap (
-			&f->state, VNET_CRYPTO_FRAME_STATE_PENDING,
-			VNET_CRYPTO_FRAME_STATE_WORK_IN_PROGRESS))
-		    {
-		      found = 1;
-		      break;
-		    }
-		}
-
-	      if (found || i == ptd->last_serve_lcore_id)
-		{
-		  CLIB_MEMORY_STORE_BARRIER ();
-		  ptd->last_serve_encrypt = !ptd->last_serve_encrypt;
-		  break;
-		}
-
-	      i++;
-	    }
-
-	  ptd->last_serve_lcore_id = i;
-	}
+      /* get a pending frame to process */
+      f = crypto_sw_scheduler_get_frame (cm->per_thread_data, ptd);
 
-      if (found)
+      if (f)
 	{
 	  u32 crypto_op, auth_op_or_aad_len;
 	  u16 digest_len;
@@ -534,21 +501,11 @@ crypto_sw_scheduler_process_aead (vlib_main_t *vm,
 	  ptd->last_return_queue = 1;
 	}
 
-      tail = current_queue->tail & CRYPTO_SW_SCHEDULER_QUEUE_MASK;
+      f = crypto_sw_scheduler_queue_pop (current_queue, &is_out_of_order);
+      if (f)
+	ptd->n_out_of_order += is_out_of_order;
 
-      if (current_queue->jobs[tail] &&
-	  current_queue->jobs[tail]->state >= VNET_CRYPTO_FRAME_STATE_SUCCESS)
-	{
-
-	  CLIB_MEMORY_STORE_BARRIER ();
-	  current_queue->tail++;
-	  f = current_queue->jobs[tail];
-	  current_queue->jobs[tail] = 0;
-
-	  return f;
-	}
-
-      return 0;
+      return f;
     }
 
 static clib_error_t *
@@ -624,13 +581,18 @@ sw_scheduler_show_workers (vlib_main_t * vm, unformat_input_t * input,
   crypto_sw_scheduler_main_t *cm = &crypto_sw_scheduler_main;
   u32 i;
 
-  vlib_cli_output (vm, "%-7s%-20s%-8s", "ID", "Name", "Crypto");
+  vlib_cli_output (vm, "%-7s%-20s%-8s%-12s%-12s%-12s%-12s", "ID", "Name",
+		   "Crypto", "Claimed", "Stolen", "Steals", "OutOfOrder");
   for (i = 1; i < vlib_thread_main.n_vlib_mains; i++)
     {
-      vlib_cli_output (vm, "%-7d%-20s%-8s", vlib_get_worker_index (i),
+      crypto_sw_scheduler_per_thread_data_t *ptd = cm->per_thread_data + i;
+
+      vlib_cli_output (vm, "%-7d%-20s%-8s%-12lu%-12lu%-12lu%-12lu",
+		       vlib_get_worker_index (i),
 		       (vlib_worker_threads + i)->name,
-		       cm->
-		       per_thread_data[i].self_crypto_enabled ? "on" : "off");
+		       ptd->self_crypto_enabled ? "on" : "off",
+		       ptd->n_claimed, ptd->n_stolen, ptd->n_steals,
+		       ptd->n_out_of_order);
     }
 
   return 0;
@@ -677,22 +639,13 @@ crypto_sw_scheduler_init (vlib_main_t * vm)
   {
     ptd->self_crypto_enabled = 1;
 
-    ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT].head = 0;
-    ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT].tail = 0;
-
-    vec_validate_aligned (ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT].jobs,
-			  CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1,
-			  CLIB_CACHE_LINE_BYTES);
-
-    ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT].head = 0;
-    ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT].tail = 0;
+    crypto_sw_scheduler_queue_init (
+      &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT]);
+    crypto_sw_scheduler_queue_init (
+      &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT]);
 
     ptd->last_serve_encrypt = 0;
     ptd->last_return_queue = 0;
-
-    vec_validate_aligned (ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT].jobs,
-			  CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1,
-			  CLIB_CACHE_LINE_BYTES);
   }
 
   cm->crypto_engine_index =
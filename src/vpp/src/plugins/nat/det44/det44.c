@@ -139,9 +139,9 @@ snat_det_add_map (ip4_address_t * in_addr, u8 in_plen,
       mp->sharing_ratio = (1 << (32 - in_plen)) / (1 << (32 - out_plen));
       mp->ports_per_host = (65535 - 1023) / mp->sharing_ratio;
 
-      vec_validate_init_empty (mp->sessions,
-			       DET44_SES_PER_USER * (1 << (32 - in_plen)) -
-			       1, empty_snat_det_session);
+      vec_validate_init_empty_aligned (
+	mp->sessions, DET44_SES_PER_USER * (1 << (32 - in_plen)) - 1,
+	empty_snat_det_session, CLIB_CACHE_LINE_BYTES);
     }
   else
     {
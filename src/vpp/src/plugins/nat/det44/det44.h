@@ -96,18 +96,30 @@ typedef struct
   };
 } snat_det_out_key_t;
 
+/* sessions are packed four per cache line and looked up by comparing
+   both of their u64 words under a mask, see snat_det_ses_find */
 typedef struct
 {
-  /* Inside network port */
-  u16 in_port;
-  /* Outside network address and port */
-  snat_det_out_key_t out;
-  /* Session state */
-  u8 state;
-  /* Expire timeout */
-  u32 expire;
+  union
+  {
+    struct
+    {
+      /* Inside network port */
+      u16 in_port;
+      /* Session state */
+      u8 state;
+      u8 __pad;
+      /* Expire timeout */
+      u32 expire;
+      /* Outside network address and port */
+      snat_det_out_key_t out;
+    };
+    u64 as_u64[2];
+  };
 } snat_det_session_t;
 
+STATIC_ASSERT_SIZEOF (snat_det_session_t, 16);
+
 typedef struct
 {
   /* inside IP address range */
@@ -341,42 +353,95 @@ snat_det_user_ses_offset (ip4_address_t * addr, u8 plen)
     DET44_SES_PER_USER;
 }
 
+STATIC_ASSERT (DET44_SES_PER_USER % 4 == 0,
+	       "user session block must be whole cache lines");
+
+/**
+ * @brief Find the first session of a user matching a key under a mask
+ *
+ * @param ses   first session of the user
+ * @param k     key, as the two u64 words of a session
+ * @param m     mask of the bits of the session compared with the key
+ *
+ * @return index of the session in the user block, DET44_SES_PER_USER if none
+ */
+static_always_inline u32
+snat_det_ses_find (snat_det_session_t *ses, snat_det_session_t *k,
+		   snat_det_session_t *m)
+{
+  u32 i;
+#if defined(CLIB_HAVE_VEC512)
+  u64x8 kv = { k->as_u64[0], k->as_u64[1], k->as_u64[0], k->as_u64[1],
+	       k->as_u64[0], k->as_u64[1], k->as_u64[0], k->as_u64[1] };
+  u64x8 mv = { m->as_u64[0], m->as_u64[1], m->as_u64[0], m->as_u64[1],
+	       m->as_u64[0], m->as_u64[1], m->as_u64[0], m->as_u64[1] };
+  u8 eq;
+
+  /* four sessions per compare, a session matches if both words do */
+  for (i = 0; i < DET44_SES_PER_USER; i += 4)
+    {
+      eq = u64x8_is_equal_mask (*(u64x8u *) (ses + i) & mv, kv);
+      eq &= (eq >> 1) & 0x55;
+      if (eq)
+	return i + (count_trailing_zeros (eq) >> 1);
+    }
+#elif defined(CLIB_HAVE_VEC256)
+  u64x4 kv = { k->as_u64[0], k->as_u64[1], k->as_u64[0], k->as_u64[1] };
+  u64x4 mv = { m->as_u64[0], m->as_u64[1], m->as_u64[0], m->as_u64[1] };
+  u64 eq;
+
+  /* four sessions per iteration, 16 bits of the byte mask per session */
+  for (i = 0; i < DET44_SES_PER_USER; i += 4)
+    {
+      eq = u8x32_msb_mask ((u8x32) ((*(u64x4u *) (ses + i) & mv) == kv));
+      eq |= (u64) u8x32_msb_mask (
+	      (u8x32) ((*(u64x4u *) (ses + i + 2) & mv) == kv))
+	    << 32;
+      eq &= (eq >> 8) & 0x0001000100010001ULL;
+      if (eq)
+	return i + (count_trailing_zeros (eq) >> 4);
+    }
+#else
+  for (i = 0; i < DET44_SES_PER_USER; i++)
+    if ((ses[i].as_u64[0] & m->as_u64[0]) == k->as_u64[0] &&
+	(ses[i].as_u64[1] & m->as_u64[1]) == k->as_u64[1])
+      return i;
+#endif
+  return DET44_SES_PER_USER;
+}
+
 static_always_inline snat_det_session_t *
 snat_det_get_ses_by_out (snat_det_map_t * dm, ip4_address_t * in_addr,
 			 u64 out_key)
 {
-  u32 user_offset;
-  u16 i;
+  snat_det_session_t *ses, k = { .out.as_u64 = out_key },
+			   m = { .out.as_u64 = ~0ULL };
+  u32 i;
 
-  user_offset = snat_det_user_ses_offset (in_addr, dm->in_plen);
-  for (i = 0; i < DET44_SES_PER_USER; i++)
-    {
-      if (dm->sessions[i + user_offset].out.as_u64 == out_key)
-	return &dm->sessions[i + user_offset];
-    }
+  ses = dm->sessions + snat_det_user_ses_offset (in_addr, dm->in_plen);
+  i = snat_det_ses_find (ses, &k, &m);
 
-  return 0;
+  return i < DET44_SES_PER_USER ? ses + i : 0;
 }
 
 static_always_inline snat_det_session_t *
 snat_det_find_ses_by_in (snat_det_map_t * dm, ip4_address_t * in_addr,
 			 u16 in_port, snat_det_out_key_t out_key)
 {
-  snat_det_session_t *ses;
-  u32 user_offset;
-  u16 i;
+  snat_det_session_t *ses, k = { .in_port = in_port },
+			   m = { .in_port = 0xffff };
+  u32 i;
 
-  user_offset = snat_det_user_ses_offset (in_addr, dm->in_plen);
-  for (i = 0; i < DET44_SES_PER_USER; i++)
-    {
-      ses = &dm->sessions[i + user_offset];
-      if (ses->in_port == in_port &&
-	  ses->out.ext_host_addr.as_u32 == out_key.ext_host_addr.as_u32 &&
-	  ses->out.ext_host_port == out_key.ext_host_port)
-	return &dm->sessions[i + user_offset];
-    }
+  /* any outside port */
+  k.out.ext_host_addr = out_key.ext_host_addr;
+  k.out.ext_host_port = out_key.ext_host_port;
+  m.out.ext_host_addr.as_u32 = ~0;
+  m.out.ext_host_port = 0xffff;
 
-  return 0;
+  ses = dm->sessions + snat_det_user_ses_offset (in_addr, dm->in_plen);
+  i = snat_det_ses_find (ses, &k, &m);
+
+  return i < DET44_SES_PER_USER ? ses + i : 0;
 }
 
 static_always_inline snat_det_session_t *
@@ -384,24 +449,21 @@ snat_det_ses_create (u32 thread_index, snat_det_map_t * dm,
 		     ip4_address_t * in_addr, u16 in_port,
 		     snat_det_out_key_t * out)
 {
-  u32 user_offset;
-  u16 i;
+  snat_det_session_t *ses, k = { .in_port = 0 }, m = { .in_port = 0xffff };
+  u32 i;
 
-  user_offset = snat_det_user_ses_offset (in_addr, dm->in_plen);
+  ses = dm->sessions + snat_det_user_ses_offset (in_addr, dm->in_plen);
 
-  for (i = 0; i < DET44_SES_PER_USER; i++)
+  /* a free slot may be taken by another thread before we get it */
+  while ((i = snat_det_ses_find (ses, &k, &m)) < DET44_SES_PER_USER)
     {
-      if (!dm->sessions[i + user_offset].in_port)
+      if (clib_atomic_bool_cmp_and_swap (&ses[i].in_port, 0, in_port))
 	{
-	  if (clib_atomic_bool_cmp_and_swap
-	      (&dm->sessions[i + user_offset].in_port, 0, in_port))
-	    {
-	      dm->sessions[i + user_offset].out.as_u64 = out->as_u64;
-	      dm->sessions[i + user_offset].state = DET44_SESSION_UNKNOWN;
-	      dm->sessions[i + user_offset].expire = 0;
-	      clib_atomic_add_fetch (&dm->ses_num, 1);
-	      return &dm->sessions[i + user_offset];
-	    }
+	  ses[i].out.as_u64 = out->as_u64;
+	  ses[i].state = DET44_SESSION_UNKNOWN;
+	  ses[i].expire = 0;
+	  clib_atomic_add_fetch (&dm->ses_num, 1);
+	  return ses + i;
 	}
     }
 
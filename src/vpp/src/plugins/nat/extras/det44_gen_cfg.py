@@ -0,0 +1,26 @@
+#!/usr/bin/env python3
+import argparse
+import math
+
+parser = argparse.ArgumentParser(description='Generate DET44 config.')
+parser.add_argument('users', metavar='N', type=int, nargs=1,
+                    help='number of inside hosts (det44 users)')
+args = parser.parse_args()
+
+# smallest inside prefix covering all users, 64 users share an outside address
+in_plen = 32 - max(math.ceil(math.log2(args.users[0])), 6)
+out_plen = in_plen + 6
+
+file_name = 'det44_%s' % (args.users[0])
+outfile = open(file_name, 'w')
+
+outfile.write('set int ip address TenGigabitEthernet4/0/0 172.16.2.1/24\n')
+outfile.write('set int ip address TenGigabitEthernet4/0/1 172.16.1.1/24\n')
+outfile.write('set int state TenGigabitEthernet4/0/0 up\n')
+outfile.write('set int state TenGigabitEthernet4/0/1 up\n')
+outfile.write('ip route add 2.2.0.0/16 via 172.16.1.2 TenGigabitEthernet4/0/1\n')
+outfile.write('ip route add 10.0.0.0/%d via 172.16.2.2 TenGigabitEthernet4/0/0\n'
+              % in_plen)
+outfile.write('det44 plugin enable\n')
+outfile.write('set interface det44 inside TenGigabitEthernet4/0/0 outside TenGigabitEthernet4/0/1\n')
+outfile.write('det44 add in 10.0.0.0/%d out 173.16.0.0/%d\n' % (in_plen, out_plen))
@@ -0,0 +1,38 @@
+from trex_stl_lib.api import *
+import ipaddress
+
+class STLS1:
+
+    def create_stream (self, users, sessions):
+        base_pkt = Ether()/IP(dst="2.2.0.1")/UDP(dport=12)
+
+        pad = Padding()
+        if len(base_pkt) < 64:
+            pad_len = 64 - len(base_pkt)
+            pad.load = '\x00' * pad_len
+
+        vm = STLVM()
+
+        # every inside host (det44 user) opens the same number of sessions
+        ip_max = str(ipaddress.IPv4Address(u'10.0.0.0') + users - 1)
+        vm.tuple_var(name="tuple", ip_min="10.0.0.0", ip_max=ip_max, port_min=1025, port_max=1024 + sessions, limit_flows = users * sessions)
+
+        vm.write(fv_name="tuple.ip", pkt_offset="IP.src")
+        vm.fix_chksum()
+
+        vm.write(fv_name="tuple.port", pkt_offset="UDP.sport")
+
+        pkt = STLPktBuilder(pkt=base_pkt/pad, vm=vm)
+
+        return STLStream(packet=pkt, mode=STLTXCont())
+
+    def get_streams (self, direction = 0, users = 1000, sessions = 10, **kwargs):
+        return [self.create_stream(int(users), int(sessions))]
+
+
+# dynamic load - used for trex console or simulator
+def register():
+    return STLS1()
+
+
+
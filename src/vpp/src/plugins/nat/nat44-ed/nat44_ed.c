@@ -36,6 +36,7 @@
 
 #include <nat/nat44-ed/nat44_ed.h>
 #include <nat/nat44-ed/nat44_ed_affinity.h>
+#include <nat/nat44-ed/nat44_ed_ha.h>
 #include <nat/nat44-ed/nat44_ed_inlines.h>
 
 #include <vpp/stats/stat_segment.h>
@@ -180,6 +181,7 @@ VLIB_PLUGIN_REGISTER () = {
 
 static void nat44_ed_db_init (u32 translations, u32 translation_buckets);
 static void nat44_ed_worker_db_free (snat_main_per_thread_data_t *tsm);
+static void nat44_ed_flow_hash_old_free ();
 
 static int nat44_ed_add_static_mapping_internal (
   ip4_address_t l_addr, ip4_address_t e_addr, u16 l_port, u16 e_port,
@@ -223,7 +225,7 @@ nat44_ed_sm_i2o_add (snat_main_t *sm, snat_static_mapping_t *m,
   clib_bihash_kv_16_8_t kv;
   nat44_ed_sm_init_i2o_kv (&kv, addr.as_u32, port, fib_index, proto,
 			   m - sm->static_mappings);
-  return clib_bihash_add_del_16_8 (&sm->flow_hash, &kv, 1 /*is_add*/);
+  return nat44_ed_flow_hash_add_del (sm, &kv, 1 /*is_add*/);
 }
 
 static_always_inline int
@@ -232,7 +234,7 @@ nat44_ed_sm_i2o_del (snat_main_t *sm, ip4_address_t addr, u16 port,
 {
   clib_bihash_kv_16_8_t kv;
   nat44_ed_sm_init_i2o_k (&kv, addr.as_u32, port, fib_index, proto);
-  return clib_bihash_add_del_16_8 (&sm->flow_hash, &kv, 0 /*is_add*/);
+  return nat44_ed_flow_hash_add_del (sm, &kv, 0 /*is_add*/);
 }
 
 static_always_inline int
@@ -243,7 +245,7 @@ nat44_ed_sm_o2i_add (snat_main_t *sm, snat_static_mapping_t *m,
   clib_bihash_kv_16_8_t kv;
   nat44_ed_sm_init_o2i_kv (&kv, addr.as_u32, port, fib_index, proto,
 			   m - sm->static_mappings);
-  return clib_bihash_add_del_16_8 (&sm->flow_hash, &kv, 1 /*is_add*/);
+  return nat44_ed_flow_hash_add_del (sm, &kv, 1 /*is_add*/);
 }
 
 static_always_inline int
@@ -252,7 +254,7 @@ nat44_ed_sm_o2i_del (snat_main_t *sm, ip4_address_t addr, u16 port,
 {
   clib_bihash_kv_16_8_t kv;
   nat44_ed_sm_init_o2i_k (&kv, addr.as_u32, port, fib_index, proto);
-  return clib_bihash_add_del_16_8 (&sm->flow_hash, &kv, 0 /*is_add*/);
+  return nat44_ed_flow_hash_add_del (sm, &kv, 0 /*is_add*/);
 }
 
 void
@@ -272,6 +274,9 @@ nat44_ed_free_session_data (snat_main_t *sm, snat_session_t *s,
       return;
     }
 
+  if (!is_ha)
+    nat44_ed_ha_sdel (sm, s, thread_index);
+
   if (nat44_ed_is_affinity_session (s))
     nat_affinity_unlock (s->ext_host_addr, s->out2in.addr, s->proto,
 			 s->out2in.port);
@@ -590,6 +595,20 @@ nat44_ed_add_address (ip4_address_t *addr, u32 vrf_id, u8 twice_nat)
   ap->addr_len = ~0;
   ap->fib_index = ~0;
   ap->addr = *addr;
+  ap->port_maps = 0;
+
+  if (!twice_nat)
+    {
+      u32 n_maps = vec_len (sm->per_thread_data) * NAT44_ED_N_PORT_MAPS;
+      nat44_ed_port_map_t *pm;
+
+      vec_validate_aligned (ap->port_maps, n_maps - 1, CLIB_CACHE_LINE_BYTES);
+      vec_foreach (pm, ap->port_maps)
+	{
+	  clib_bitmap_alloc (pm->busy_ports, sm->port_per_thread);
+	  vec_validate (pm->refs, sm->port_per_thread - 1);
+	}
+    }
 
   if (vrf_id != ~0)
     {
@@ -612,6 +631,7 @@ nat44_ed_del_address (ip4_address_t addr, u8 twice_nat)
 {
   snat_main_t *sm = &snat_main;
   snat_address_t *a = 0, *addresses;
+  nat44_ed_port_map_t *pm;
   snat_session_t *ses;
   u32 *ses_to_be_removed = 0, *ses_index;
   snat_main_per_thread_data_t *tsm;
@@ -667,9 +687,29 @@ nat44_ed_del_address (ip4_address_t addr, u8 twice_nat)
       fib_table_unlock (a->fib_index, FIB_PROTOCOL_IP4, sm->fib_src_low);
     }
 
+  vec_foreach (pm, a->port_maps)
+    {
+      clib_bitmap_free (pm->busy_ports);
+      vec_free (pm->refs);
+    }
+  vec_free (a->port_maps);
+
   if (!twice_nat)
     {
+      u32 last;
+
       vec_del1 (sm->addresses, j);
+
+      /* the last address took the place of the deleted one */
+      last = vec_len (sm->addresses);
+      if (j != last)
+	vec_foreach (tsm, sm->per_thread_data)
+	  pool_foreach (ses, tsm->sessions)
+	    {
+	      if ((ses->flags & SNAT_SESSION_FLAG_PORT_MAP) &&
+		  ses->port_map_addr_index == last)
+		ses->port_map_addr_index = j;
+	    }
     }
   else
     {
@@ -740,7 +780,7 @@ static_always_inline snat_static_mapping_t *
 nat44_ed_sm_lookup (snat_main_t *sm, clib_bihash_kv_16_8_t *kv)
 {
   clib_bihash_kv_16_8_t v;
-  int rc = clib_bihash_search_16_8 (&sm->flow_hash, kv, &v);
+  int rc = nat44_ed_flow_hash_search (sm, kv, &v);
   if (!rc)
     {
       ASSERT (0 == ed_value_get_thread_index (&v));
@@ -2281,6 +2321,9 @@ nat_init (vlib_main_t * vm)
   sm->fq_in2out_index = ~0;
   sm->fq_in2out_output_index = ~0;
 
+  sm->rss.sw_if_index = ~0;
+  sm->rss.flow_index = ~0;
+
   sm->log_level = NAT_LOG_ERROR;
 
   nat44_set_node_indexes (sm, vm);
@@ -2306,6 +2349,19 @@ nat_init (vlib_main_t * vm)
 #undef _
   nat_init_simple_counter (sm->counters.hairpinning, "hairpinning",
 			   "/nat44-ed/hairpinning");
+#define _(x)                                                                  \
+  nat_init_simple_counter (sm->counters.handoff.in2out.x, #x,                 \
+			   "/nat44-ed/handoff/in2out/" #x);                   \
+  nat_init_simple_counter (sm->counters.handoff.in2out_output.x, #x,          \
+			   "/nat44-ed/handoff/in2out-output/" #x);            \
+  nat_init_simple_counter (sm->counters.handoff.out2in.x, #x,                 \
+			   "/nat44-ed/handoff/out2in/" #x);
+  foreach_nat_handoff_counter;
+#undef _
+  nat_init_simple_counter (sm->counters.rss_port_steered, "rss-port-steered",
+			   "/nat44-ed/rss/port-steered");
+  nat_init_simple_counter (sm->counters.rss_port_missed, "rss-port-missed",
+			   "/nat44-ed/rss/port-missed");
 
   p = hash_get_mem (tm->thread_registrations_by_name, "workers");
   if (p)
@@ -2352,6 +2408,7 @@ nat_init (vlib_main_t * vm)
 			 FIB_SOURCE_BH_SIMPLE);
 
   nat_affinity_init (vm);
+  nat44_ed_ha_init (vm);
   test_key_calc_split ();
 
   return nat44_api_hookup (vm);
@@ -2554,6 +2611,11 @@ nat44_plugin_disable ()
 
   fail_if_disabled ();
 
+  nat44_ed_ha_disable ();
+
+  if (sm->rss.sw_if_index != ~0)
+    nat44_ed_rss_disable ();
+
   rc = nat44_ed_del_static_mappings ();
   if (rc)
     error = 1;
@@ -2574,6 +2636,7 @@ nat44_plugin_disable ()
   sm->max_translations_per_fib = 0;
 
   clib_bihash_free_16_8 (&sm->flow_hash);
+  nat44_ed_flow_hash_old_free ();
 
   vec_foreach (tsm, sm->per_thread_data)
     {
@@ -2885,7 +2948,7 @@ nat44_ed_get_in2out_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
 	      init_ed_k (&kv16, lookup_saddr.as_u32, lookup_sport,
 			 lookup_daddr.as_u32, lookup_dport, rx_fib_index,
 			 lookup_protocol);
-	      if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv16, &value16))
+	      if (!nat44_ed_flow_hash_search (sm, &kv16, &value16))
 		{
 		  next_worker_index = ed_value_get_thread_index (&value16);
 		  vnet_buffer2 (b)->nat.cached_session_index =
@@ -2900,7 +2963,7 @@ nat44_ed_get_in2out_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
 		 vnet_buffer (b)->ip.reass.l4_dst_port, fib_index,
 		 ip->protocol);
 
-      if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv16, &value16))
+      if (!nat44_ed_flow_hash_search (sm, &kv16, &value16))
 	{
 	  next_worker_index = ed_value_get_thread_index (&value16);
 	  vnet_buffer2 (b)->nat.cached_session_index =
@@ -2913,7 +2976,7 @@ nat44_ed_get_in2out_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
 		 vnet_buffer (b)->ip.reass.l4_dst_port, ip->src_address.as_u32,
 		 vnet_buffer (b)->ip.reass.l4_src_port, rx_fib_index,
 		 ip->protocol);
-      if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv16, &value16))
+      if (!nat44_ed_flow_hash_search (sm, &kv16, &value16))
 	{
 	  next_worker_index = ed_value_get_thread_index (&value16);
 	  vnet_buffer2 (b)->nat.cached_dst_nat_session_index =
@@ -2976,7 +3039,7 @@ nat44_ed_get_out2in_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
 		     lookup_daddr.as_u32, lookup_dport, rx_fib_index,
 		     lookup_protocol);
 	  if (PREDICT_TRUE (
-		!clib_bihash_search_16_8 (&sm->flow_hash, &kv16, &value16)))
+		!nat44_ed_flow_hash_search (sm, &kv16, &value16)))
 	    {
 	      next_worker_index = ed_value_get_thread_index (&value16);
 	      nat_elog_debug_handoff (
@@ -2994,7 +3057,7 @@ nat44_ed_get_out2in_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
 	     ip->protocol);
 
   if (PREDICT_TRUE (
-	!clib_bihash_search_16_8 (&sm->flow_hash, &kv16, &value16)))
+	!nat44_ed_flow_hash_search (sm, &kv16, &value16)))
     {
       vnet_buffer2 (b)->nat.cached_session_index =
 	ed_value_get_session_index (&value16);
@@ -3136,6 +3199,7 @@ int
 nat44_update_session_limit (u32 session_limit, u32 vrf_id)
 {
   snat_main_t *sm = &snat_main;
+  u32 translation_buckets;
 
   if (nat44_set_session_limit (session_limit, vrf_id))
     return 1;
@@ -3144,10 +3208,11 @@ nat44_update_session_limit (u32 session_limit, u32 vrf_id)
   stat_segment_set_state_counter (sm->max_cfg_sessions_gauge,
 				  sm->max_translations_per_thread);
 
-  sm->translation_buckets =
+  translation_buckets =
     nat_calc_bihash_buckets (sm->max_translations_per_thread);
-
-  nat44_ed_sessions_clear ();
+  if (translation_buckets != sm->translation_buckets &&
+      nat44_ed_flow_hash_resize (translation_buckets))
+    return 1;
   return 0;
 }
 
@@ -3179,6 +3244,24 @@ nat44_ed_worker_db_init (snat_main_per_thread_data_t *tsm, u32 translations,
   pool_get (tsm->lru_pool, head);
   tsm->unk_proto_lru_head_index = head - tsm->lru_pool;
   clib_dlist_init (tsm->lru_pool, tsm->unk_proto_lru_head_index);
+
+  tw_timer_wheel_init_1t_3w_1024sl_ov (&tsm->expire_wheel, 0 /* callback */,
+				       1.0 /* timer interval */,
+				       NAT44_ED_EXPIRE_WALK_BATCH);
+}
+
+static void
+nat44_ed_flow_hash_old_free ()
+{
+  snat_main_t *sm = &snat_main;
+
+  if (!sm->flow_hash_old)
+    return;
+
+  clib_bihash_free_16_8 (sm->flow_hash_old);
+  clib_mem_free (sm->flow_hash_old);
+  sm->flow_hash_old = 0;
+  sm->flow_hash_migrate_pending = 0;
 }
 
 static void
@@ -3213,6 +3296,8 @@ nat44_ed_worker_db_free (snat_main_per_thread_data_t *tsm)
   pool_free (tsm->lru_pool);
   pool_free (tsm->sessions);
   vec_free (tsm->per_vrf_sessions_vec);
+  tw_timer_wheel_free_1t_3w_1024sl_ov (&tsm->expire_wheel);
+  vec_free (tsm->expired_sessions);
 }
 
 void
@@ -3221,6 +3306,7 @@ nat44_ed_sessions_clear ()
   snat_main_t *sm = &snat_main;
   snat_main_per_thread_data_t *tsm;
 
+  nat44_ed_flow_hash_old_free ();
   reinit_ed_flow_hash ();
 
   vec_foreach (tsm, sm->per_thread_data)
@@ -3498,7 +3584,7 @@ nat44_ed_del_session (snat_main_t *sm, ip4_address_t *addr, u16 port,
 
   init_ed_k (&kv, addr->as_u32, port, eh_addr->as_u32, eh_port, fib_index,
 	     proto);
-  if (clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (nat44_ed_flow_hash_search (sm, &kv, &value))
     {
       return VNET_API_ERROR_NO_SUCH_ENTRY;
     }
@@ -3511,6 +3597,293 @@ nat44_ed_del_session (snat_main_t *sm, ip4_address_t *addr, u16 port,
   return 0;
 }
 
+#define foreach_nat44_ed_expire_walk_error                                     \
+  _ (EXPIRED, "sessions expired")                                             \
+  _ (REARMED, "session timers re-armed")
+
+typedef enum
+{
+#define _(sym, str) NAT44_ED_EXPIRE_WALK_ERROR_##sym,
+  foreach_nat44_ed_expire_walk_error
+#undef _
+    NAT44_ED_EXPIRE_WALK_N_ERROR,
+} nat44_ed_expire_walk_error_t;
+
+static char *nat44_ed_expire_walk_error_strings[] = {
+#define _(sym, string) string,
+  foreach_nat44_ed_expire_walk_error
+#undef _
+};
+
+/**
+ * @brief Per thread expiry of sessions whose timer fired.
+ *
+ * At most NAT44_ED_EXPIRE_WALK_BATCH sessions are looked at per run. If
+ * more are due, the node interrupts itself and carries on in the next
+ * dispatch cycle, after the packets that arrived in between.
+ */
+VLIB_NODE_FN (nat44_ed_expire_worker_walk_node)
+(vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *frame)
+{
+  snat_main_t *sm = &snat_main;
+  u32 thread_index = vm->thread_index;
+  snat_main_per_thread_data_t *tsm;
+  u32 n_left, n_expired = 0, n_rearmed = 0;
+  snat_session_t *s;
+  f64 now, expire;
+  u32 si;
+
+  if (!sm->enabled)
+    return 0;
+
+  tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+  now = vlib_time_now (vm);
+
+  if (vec_len (tsm->expired_sessions) < NAT44_ED_EXPIRE_WALK_BATCH)
+    tsm->expired_sessions = tw_timer_expire_timers_vec_1t_3w_1024sl_ov (
+      &tsm->expire_wheel, now, tsm->expired_sessions);
+
+  n_left = clib_min (vec_len (tsm->expired_sessions),
+		     NAT44_ED_EXPIRE_WALK_BATCH);
+  while (n_left--)
+    {
+      si = vec_pop (tsm->expired_sessions);
+      if (pool_is_free_index (tsm->sessions, si))
+	continue;
+      s = pool_elt_at_index (tsm->sessions, si);
+
+      /* deleted while waiting here, the index belongs to a new session */
+      if (nat44_ed_session_timer_is_armed (tsm, s))
+	continue;
+
+      expire = nat44_ed_session_expire_time (sm, s);
+      if (now >= expire)
+	{
+	  nat44_ed_free_session_data (sm, s, thread_index, 0);
+	  nat_ed_session_delete (sm, s, thread_index, 1);
+	  n_expired++;
+	}
+      else
+	{
+	  nat44_ed_session_timer_start (tsm, s, now, expire);
+	  n_rearmed++;
+	}
+    }
+
+  if (vec_len (tsm->expired_sessions))
+    vlib_node_set_interrupt_pending (vm, node->node_index);
+
+  vlib_node_increment_counter (vm, node->node_index,
+			       NAT44_ED_EXPIRE_WALK_ERROR_EXPIRED, n_expired);
+  vlib_node_increment_counter (vm, node->node_index,
+			       NAT44_ED_EXPIRE_WALK_ERROR_REARMED, n_rearmed);
+  return 0;
+}
+
+VLIB_REGISTER_NODE (nat44_ed_expire_worker_walk_node) = {
+  .name = "nat44-ed-expire-worker-walk",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_INTERRUPT,
+  .n_errors = NAT44_ED_EXPIRE_WALK_N_ERROR,
+  .error_strings = nat44_ed_expire_walk_error_strings,
+};
+
+/**
+ * @brief Drive the per thread expire walk once per wheel tick.
+ */
+static uword
+nat44_ed_expire_walk_fn (vlib_main_t *vm, vlib_node_runtime_t *rt,
+			 vlib_frame_t *f)
+{
+  snat_main_t *sm = &snat_main;
+  u32 i;
+
+  while (1)
+    {
+      vlib_process_wait_for_event_or_clock (vm, 1.0);
+      vlib_process_get_events (vm, 0);
+
+      if (!sm->enabled)
+	continue;
+
+      for (i = 0; i < vlib_get_n_threads (); i++)
+	vlib_node_set_interrupt_pending (
+	  vlib_get_main_by_index (i), nat44_ed_expire_worker_walk_node.index);
+
+      /* all threads moved their sessions, drop the old flow hash */
+      if (sm->flow_hash_old &&
+	  !clib_atomic_load_relax_n (&sm->flow_hash_migrate_pending))
+	{
+	  vlib_worker_thread_barrier_sync (vm);
+	  nat44_ed_flow_hash_old_free ();
+	  vlib_worker_thread_barrier_release (vm);
+	}
+    }
+
+  return 0;
+}
+
+VLIB_REGISTER_NODE (nat44_ed_expire_walk_node, static) = {
+  .function = nat44_ed_expire_walk_fn,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "nat44-ed-expire-walk",
+};
+
+static_always_inline int
+nat44_ed_flow_hash_migrate_kv (snat_main_t *sm, clib_bihash_kv_16_8_t *kv)
+{
+  clib_bihash_kv_16_8_t value;
+
+  if (clib_bihash_search_16_8 (sm->flow_hash_old, kv, &value))
+    return 0;
+
+  /* add before delete, see nat44_ed_flow_hash_search */
+  clib_bihash_add_del_16_8 (&sm->flow_hash, &value, 1);
+  clib_bihash_add_del_16_8 (sm->flow_hash_old, kv, 0);
+  return 1;
+}
+
+static void
+nat44_ed_flow_hash_migrate_sm (snat_main_t *sm, snat_static_mapping_t *m)
+{
+  nat44_lb_addr_port_t *local;
+  clib_bihash_kv_16_8_t kv;
+
+  nat44_ed_sm_init_o2i_k (&kv, m->external_addr.as_u32, m->external_port, 0,
+			  m->proto);
+  nat44_ed_flow_hash_migrate_kv (sm, &kv);
+  nat44_ed_sm_init_i2o_k (&kv, m->local_addr.as_u32, m->local_port,
+			  m->fib_index, m->proto);
+  nat44_ed_flow_hash_migrate_kv (sm, &kv);
+
+  pool_foreach (local, m->locals)
+    {
+      if (is_sm_lb (m->flags))
+	nat44_ed_sm_init_i2o_k (&kv, local->addr.as_u32, local->port,
+				local->fib_index, m->proto);
+      else
+	nat44_ed_sm_init_i2o_k (&kv, m->local_addr.as_u32, m->local_port,
+				local->fib_index, m->proto);
+      nat44_ed_flow_hash_migrate_kv (sm, &kv);
+    }
+}
+
+/**
+ * @brief Per thread move of flows to the resized flow hash.
+ *
+ * Each thread moves the flows of its own sessions, so a flow is never
+ * moved and deleted at the same time. The main thread also moves the
+ * static mappings, which only change on the main thread.
+ */
+VLIB_NODE_FN (nat44_ed_flow_hash_migrate_node)
+(vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *frame)
+{
+  snat_main_t *sm = &snat_main;
+  u32 thread_index = vm->thread_index;
+  snat_main_per_thread_data_t *tsm;
+  clib_bihash_kv_16_8_t kv;
+  u32 n_left = NAT44_ED_FLOW_HASH_MIGRATE_BATCH;
+  u32 n_moved = 0;
+  snat_session_t *s;
+
+  if (!sm->enabled || !sm->flow_hash_old)
+    return 0;
+
+  tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+  if (tsm->flow_hash_migrate_index == ~0)
+    return 0;
+
+  if (thread_index == 0)
+    {
+      while (n_left &&
+	     sm->flow_hash_migrate_sm_index < vec_len (sm->static_mappings))
+	{
+	  if (!pool_is_free_index (sm->static_mappings,
+				   sm->flow_hash_migrate_sm_index))
+	    nat44_ed_flow_hash_migrate_sm (
+	      sm, pool_elt_at_index (sm->static_mappings,
+				     sm->flow_hash_migrate_sm_index));
+	  sm->flow_hash_migrate_sm_index++;
+	  n_left--;
+	}
+    }
+
+  while (n_left && tsm->flow_hash_migrate_index < vec_len (tsm->sessions))
+    {
+      if (!pool_is_free_index (tsm->sessions, tsm->flow_hash_migrate_index))
+	{
+	  s = pool_elt_at_index (tsm->sessions, tsm->flow_hash_migrate_index);
+	  nat_6t_flow_to_ed_k (&kv, &s->i2o);
+	  n_moved += nat44_ed_flow_hash_migrate_kv (sm, &kv);
+	  nat_6t_flow_to_ed_k (&kv, &s->o2i);
+	  n_moved += nat44_ed_flow_hash_migrate_kv (sm, &kv);
+	}
+      tsm->flow_hash_migrate_index++;
+      n_left--;
+    }
+
+  vlib_node_increment_counter (vm, node->node_index, 0, n_moved);
+
+  if (n_left)
+    {
+      /* done, the main thread frees the old table */
+      tsm->flow_hash_migrate_index = ~0;
+      clib_atomic_fetch_sub (&sm->flow_hash_migrate_pending, 1);
+    }
+  else
+    vlib_node_set_interrupt_pending (vm, node->node_index);
+
+  return 0;
+}
+
+static char *nat44_ed_flow_hash_migrate_error_strings[] = {
+  "flows moved to the resized flow hash",
+};
+
+VLIB_REGISTER_NODE (nat44_ed_flow_hash_migrate_node) = {
+  .name = "nat44-ed-flow-hash-migrate",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_INTERRUPT,
+  .n_errors = ARRAY_LEN (nat44_ed_flow_hash_migrate_error_strings),
+  .error_strings = nat44_ed_flow_hash_migrate_error_strings,
+};
+
+int
+nat44_ed_flow_hash_resize (u32 translation_buckets)
+{
+  vlib_main_t *vm = vlib_get_main ();
+  snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm;
+  u32 i;
+
+  if (sm->flow_hash_old)
+    return VNET_API_ERROR_INSTANCE_IN_USE;
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  /* keep the current table, under a new address, while it is drained */
+  sm->flow_hash_old = clib_mem_alloc (sizeof (*sm->flow_hash_old));
+  clib_memcpy_fast (sm->flow_hash_old, &sm->flow_hash,
+		    sizeof (sm->flow_hash));
+  sm->flow_hash_old->dont_add_to_all_bihash_list = 1;
+  clib_memset (&sm->flow_hash, 0, sizeof (sm->flow_hash));
+
+  sm->translation_buckets = translation_buckets;
+  reinit_ed_flow_hash ();
+
+  sm->flow_hash_migrate_sm_index = 0;
+  sm->flow_hash_migrate_pending = vec_len (sm->per_thread_data);
+  vec_foreach (tsm, sm->per_thread_data)
+    tsm->flow_hash_migrate_index = 0;
+
+  vlib_worker_thread_barrier_release (vm);
+
+  for (i = 0; i < vlib_get_n_threads (); i++)
+    vlib_node_set_interrupt_pending (vlib_get_main_by_index (i),
+				     nat44_ed_flow_hash_migrate_node.index);
+  return 0;
+}
+
 VLIB_NODE_FN (nat_default_node) (vlib_main_t * vm,
 				 vlib_node_runtime_t * node,
 				 vlib_frame_t * frame)
@@ -31,6 +31,8 @@
 #include <vppinfra/hash.h>
 #include <vppinfra/dlist.h>
 #include <vppinfra/error.h>
+#include <vppinfra/tw_timer_1t_3w_1024sl_ov.h>
+#include <vppinfra/vector/toeplitz.h>
 #include <vlibapi/api.h>
 
 #include <nat/lib/lib.h>
@@ -44,6 +46,18 @@
  * as if there were no free ports available to conserve resources */
 #define ED_PORT_ALLOC_ATTEMPTS (10)
 
+/* number of free ports looked at for one whose return traffic is received
+ * by the allocating thread, see nat44_ed_rss_enable */
+#define NAT44_ED_RSS_PORT_ATTEMPTS (256)
+
+/* upper bound of sessions looked at by one run of the per thread expire
+ * walk, the rest is left for the following runs */
+#define NAT44_ED_EXPIRE_WALK_BATCH (256)
+
+/* sessions moved to the resized flow hash by one run of the per thread
+ * migration node */
+#define NAT44_ED_FLOW_HASH_MIGRATE_BATCH (256)
+
 /* NAT buffer flags */
 #define SNAT_FLAG_HAIRPINNING (1 << 0)
 
@@ -180,6 +194,8 @@ typedef enum
 #define SNAT_SESSION_FLAG_AFFINITY	     (1 << 6)
 #define SNAT_SESSION_FLAG_EXACT_ADDRESS	     (1 << 7)
 #define SNAT_SESSION_FLAG_HAIRPINNING	     (1 << 8)
+#define SNAT_SESSION_FLAG_PORT_MAP	     (1 << 9)
+#define SNAT_SESSION_FLAG_HA_REFRESH	     (1 << 10)
 
 /* NAT interface flags */
 #define NAT_INTERFACE_FLAG_IS_INSIDE 1
@@ -316,12 +332,20 @@ typedef CLIB_PACKED(struct
   /* Flags */
   u32 flags;
 
+  /* index in sm->addresses of the address whose port map holds a
+     reference on out2in.port, with SNAT_SESSION_FLAG_PORT_MAP */
+  u32 port_map_addr_index;
+
   /* head of LRU list in which this session is tracked */
   u32 lru_head_index;
   /* index in global LRU list */
   u32 lru_index;
   f64 last_lru_update;
 
+  /* expire wheel timer and the time it was armed for */
+  u32 expire_timer_handle;
+  f64 expire_timer_time;
+
   /* Last heard timer */
   f64 last_heard;
 
@@ -352,6 +376,31 @@ typedef CLIB_PACKED(struct
   u32 thread_index;
 }) snat_session_t;
 
+/* Outside ports of a pool address used by one thread for one protocol.
+ * refs counts the sessions on each port, which share it between
+ * destinations once the free set is exhausted; a set bit marks a port
+ * with at least one session. */
+typedef struct
+{
+  uword *busy_ports;
+  u32 *refs;
+  u32 n_busy;
+  /* next-fit position, released ports are not reused right away */
+  u32 cursor;
+  u8 pad[8];
+} nat44_ed_port_map_t;
+
+STATIC_ASSERT_SIZEOF (nat44_ed_port_map_t, 32);
+
+typedef enum
+{
+  NAT44_ED_PORT_MAP_TCP,
+  NAT44_ED_PORT_MAP_UDP,
+  NAT44_ED_PORT_MAP_ICMP,
+  NAT44_ED_PORT_MAP_OTHER,
+  NAT44_ED_N_PORT_MAPS,
+} nat44_ed_port_map_type_t;
+
 typedef struct
 {
   ip4_address_t addr;
@@ -359,6 +408,8 @@ typedef struct
   u32 sw_if_index;
   u32 fib_index;
   u32 addr_len;
+  /* NAT44_ED_N_PORT_MAPS per thread, two cache lines for each thread */
+  nat44_ed_port_map_t *port_maps;
 } snat_address_t;
 
 typedef struct
@@ -496,8 +547,45 @@ typedef struct
 
   per_vrf_sessions_t *per_vrf_sessions_vec;
 
+  /* session expiry, one second ticks; a timer firing for a session that
+   * saw traffic since it was armed is simply re-armed */
+  tw_timer_wheel_1t_3w_1024sl_ov_t expire_wheel;
+  /* sessions whose timer fired, waiting for the expire walk */
+  u32 *expired_sessions;
+
+  /* next session to move to the resized flow hash */
+  u32 flow_hash_migrate_index;
+
 } snat_main_per_thread_data_t;
 
+/* RSS-aware outside port selection */
+typedef struct
+{
+  /* outside interface whose RSS is mirrored, ~0 if disabled */
+  u32 sw_if_index;
+  /* Toeplitz key of the outside NIC */
+  clib_toeplitz_hash_key_t *key;
+  /* thread receiving each RSS redirection table entry */
+  u32 *reta_thread;
+  u32 reta_mask;
+  /* redirection table bits contributed by each destination port */
+  u16 *port_hash;
+  /* vnet flow setting the RSS function on the NIC, ~0 if none */
+  u32 flow_index;
+} nat44_ed_rss_t;
+
+#define foreach_nat_handoff_counter                                           \
+  _ (same_worker)                                                             \
+  _ (do_handoff)                                                              \
+  _ (congestion_drop)
+
+typedef struct
+{
+#define _(x) vlib_simple_counter_main_t x;
+  foreach_nat_handoff_counter
+#undef _
+} nat44_ed_handoff_counters_t;
+
 struct snat_main_s;
 
 u32 nat44_ed_get_in2out_worker_index (vlib_buffer_t *b, ip4_header_t *ip,
@@ -532,6 +620,12 @@ typedef struct snat_main_s
 
   /* Endpoint dependent lookup table */
   clib_bihash_16_8_t flow_hash;
+  /* table being drained after a resize, see nat44_ed_flow_hash_resize */
+  clib_bihash_16_8_t *flow_hash_old;
+  /* threads which have not moved all their sessions yet */
+  u32 flow_hash_migrate_pending;
+  /* next static mapping to move */
+  u32 flow_hash_migrate_sm_index;
 
   /* Interface pool */
   snat_interface_t *interfaces;
@@ -574,6 +668,9 @@ typedef struct snat_main_s
   /* Randomize port allocation order */
   u32 random_seed;
 
+  /* RSS-aware outside port selection, see nat44_ed_rss_enable */
+  nat44_ed_rss_t rss;
+
   /* Worker handoff frame-queue index */
   u32 fq_in2out_index;
   u32 fq_in2out_output_index;
@@ -640,7 +737,16 @@ typedef struct snat_main_s
       } out2in;
     } slowpath;
 
+    struct
+    {
+      nat44_ed_handoff_counters_t in2out;
+      nat44_ed_handoff_counters_t in2out_output;
+      nat44_ed_handoff_counters_t out2in;
+    } handoff;
+
     vlib_simple_counter_main_t hairpinning;
+    vlib_simple_counter_main_t rss_port_steered;
+    vlib_simple_counter_main_t rss_port_missed;
   } counters;
 #undef _
 
@@ -945,6 +1051,18 @@ int nat44_set_session_limit (u32 session_limit, u32 vrf_id);
  */
 int nat44_update_session_limit (u32 session_limit, u32 vrf_id);
 
+/**
+ * @brief Resize the session flow hash without dropping sessions
+ *
+ * A new table is set up and every thread moves its sessions to it in
+ * the background. Lookups check both tables until the old one is freed.
+ *
+ * @param translation_buckets number of buckets per worker
+ * @return 0 on success, VNET_API_ERROR_INSTANCE_IN_USE while a previous
+ *         resize is still in progress
+ */
+int nat44_ed_flow_hash_resize (u32 translation_buckets);
+
 void expire_per_vrf_sessions (u32 fib_index);
 
 /**
@@ -1004,6 +1122,28 @@ void nat44_ed_sessions_clear ();
 
 int nat44_ed_set_frame_queue_nelts (u32 frame_queue_nelts);
 
+/**
+ * @brief Pick outside ports so that return traffic is received by the
+ * thread owning the session
+ *
+ * The RSS hash of the outside NIC is computed in software for each
+ * candidate port; a port is preferred when the redirection table sends
+ * the return flow to an rx queue polled by the allocating thread. Only
+ * TCP and UDP can be steered this way.
+ *
+ * @param sw_if_index   outside interface
+ * @param key           Toeplitz key of the NIC, 0 for the default key
+ * @param reta_size     size of the NIC redirection table, a power of 2
+ * @param program_flow  also install a vnet flow selecting Toeplitz RSS over
+ *                      the IPv4 TCP/UDP 4-tuple on the NIC
+ *
+ * @return 0 on success, non-zero value otherwise
+ */
+int nat44_ed_rss_enable (u32 sw_if_index, u8 *key, u32 reta_size,
+			 u8 program_flow);
+int nat44_ed_rss_disable ();
+format_function_t format_nat44_ed_rss;
+
 typedef enum
 {
   NAT_ED_TRNSL_ERR_SUCCESS = 0,
@@ -1027,6 +1167,7 @@ void nat_6t_l3_l4_csum_calc (nat_6t_flow_t *f);
 format_function_t format_nat_ed_translation_error;
 format_function_t format_nat_6t_flow;
 format_function_t format_ed_session_kvp;
+format_function_t format_nat44_ed_flow_hash_occupancy;
 
 snat_static_mapping_t *nat44_ed_sm_i2o_lookup (snat_main_t *sm,
 					       ip4_address_t addr, u16 port,
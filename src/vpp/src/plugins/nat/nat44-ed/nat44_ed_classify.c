@@ -227,7 +227,7 @@ nat44_ed_classify_node_fn_inline (vlib_main_t * vm,
 			 vnet_buffer (b0)->ip.reass.l4_dst_port, rx_fib_index0,
 			 ip0->protocol);
 	      /* process whole packet */
-	      if (!clib_bihash_search_16_8 (&sm->flow_hash, &ed_kv0,
+	      if (!nat44_ed_flow_hash_search (sm, &ed_kv0,
 					    &ed_value0))
 		{
 		  ASSERT (vm->thread_index ==
@@ -26,6 +26,7 @@
 #include <nat/nat44-ed/nat44_ed.h>
 #include <nat/nat44-ed/nat44_ed_inlines.h>
 #include <nat/nat44-ed/nat44_ed_affinity.h>
+#include <nat/nat44-ed/nat44_ed_ha.h>
 
 #define NAT44_ED_EXPECTED_ARGUMENT "expected required argument(s)"
 
@@ -287,6 +288,15 @@ nat44_show_hash_command_fn (vlib_main_t * vm, unformat_input_t * input,
 
   vlib_cli_output (vm, "-------- hash table parameters --------\n");
   vlib_cli_output (vm, "translation buckets: %u", sm->translation_buckets);
+  vlib_cli_output (vm, "flow hash occupancy:\n  %U",
+		   format_nat44_ed_flow_hash_occupancy, &sm->flow_hash);
+  if (sm->flow_hash_old)
+    {
+      vlib_cli_output (vm, "resize in progress, %u threads pending",
+		       sm->flow_hash_migrate_pending);
+      vlib_cli_output (vm, "old flow hash occupancy:\n  %U",
+		       format_nat44_ed_flow_hash_occupancy, sm->flow_hash_old);
+    }
   return 0;
 }
 
@@ -337,6 +347,245 @@ nat_show_mss_clamping_command_fn (vlib_main_t * vm, unformat_input_t * input,
   return 0;
 }
 
+static clib_error_t *
+nat_ha_failover_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			    vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  ip4_address_t addr;
+  u32 port, session_refresh_interval = 10;
+  int rv;
+  clib_error_t *error = 0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, NAT44_ED_EXPECTED_ARGUMENT);
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "%U:%u", unformat_ip4_address, &addr, &port))
+	;
+      else if (unformat (line_input, "refresh-interval %u",
+			 &session_refresh_interval))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  rv = nat44_ed_ha_set_failover (vm, &addr, (u16) port,
+				 session_refresh_interval);
+  if (rv)
+    error = clib_error_return (0, "set HA failover failed");
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+static clib_error_t *
+nat_ha_listener_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			    vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  ip4_address_t addr;
+  u32 port, path_mtu = 512;
+  int rv;
+  clib_error_t *error = 0;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, NAT44_ED_EXPECTED_ARGUMENT);
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "%U:%u", unformat_ip4_address, &addr, &port))
+	;
+      else if (unformat (line_input, "path-mtu %u", &path_mtu))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  rv = nat44_ed_ha_set_listener (vm, &addr, (u16) port, path_mtu);
+  if (rv)
+    error = clib_error_return (0, "set HA listener failed");
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+static clib_error_t *
+nat_show_ha_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			vlib_cli_command_t *cmd)
+{
+  ip4_address_t addr;
+  u16 port;
+  u32 path_mtu, session_refresh_interval, resync_ack_missed;
+  u8 in_resync;
+
+  nat44_ed_ha_get_listener (&addr, &port, &path_mtu);
+  if (!port)
+    {
+      vlib_cli_output (vm, "NAT HA disabled\n");
+      return 0;
+    }
+
+  vlib_cli_output (vm, "LISTENER:\n");
+  vlib_cli_output (vm, "  %U:%u path-mtu %u\n", format_ip4_address, &addr,
+		   port, path_mtu);
+
+  nat44_ed_ha_get_failover (&addr, &port, &session_refresh_interval);
+  vlib_cli_output (vm, "FAILOVER:\n");
+  if (port)
+    vlib_cli_output (vm, "  %U:%u refresh-interval %usec\n",
+		     format_ip4_address, &addr, port,
+		     session_refresh_interval);
+  else
+    vlib_cli_output (vm, "  NA\n");
+
+  nat44_ed_ha_get_resync_status (&in_resync, &resync_ack_missed);
+  vlib_cli_output (vm, "RESYNC:\n");
+  if (in_resync)
+    vlib_cli_output (vm, "  in progress\n");
+  else
+    vlib_cli_output (vm, "  completed (%d ACK missed)\n", resync_ack_missed);
+
+  return 0;
+}
+
+static clib_error_t *
+nat_ha_flush_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			 vlib_cli_command_t *cmd)
+{
+  nat44_ed_ha_flush ();
+  return 0;
+}
+
+static clib_error_t *
+nat_ha_resync_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			  vlib_cli_command_t *cmd)
+{
+  clib_error_t *error = 0;
+  int rv;
+
+  rv = nat44_ed_ha_resync (0, 0, 0);
+  if (rv == VNET_API_ERROR_BUSY)
+    error = clib_error_return (0, "NAT HA resync already running");
+  else if (rv)
+    error = clib_error_return (0, "NAT HA failover not set");
+
+  return error;
+}
+
+static clib_error_t *
+nat_rss_command_fn (vlib_main_t *vm, unformat_input_t *input,
+		    vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0, reta_size = 128;
+  u8 *key = 0, program_flow = 0, is_disable = 0;
+  clib_error_t *error = 0;
+  int rv;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, NAT44_ED_EXPECTED_ARGUMENT);
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "outside-interface %U",
+		    unformat_vnet_sw_interface, vnm, &sw_if_index))
+	;
+      else if (unformat (line_input, "key %U", unformat_hex_string, &key))
+	;
+      else if (unformat (line_input, "reta-size %u", &reta_size))
+	;
+      else if (unformat (line_input, "flow"))
+	program_flow = 1;
+      else if (unformat (line_input, "disable"))
+	is_disable = 1;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (is_disable)
+    {
+      if (nat44_ed_rss_disable ())
+	error = clib_error_return (0, "NAT RSS not enabled");
+      goto done;
+    }
+
+  if (sw_if_index == ~0)
+    {
+      error = clib_error_return (0, "outside interface required");
+      goto done;
+    }
+
+  rv = nat44_ed_rss_enable (sw_if_index, key, reta_size, program_flow);
+  switch (rv)
+    {
+    case 0:
+      break;
+    case VNET_API_ERROR_INVALID_VALUE:
+      error = clib_error_return (0, "reta size must be a power of 2");
+      break;
+    case VNET_API_ERROR_INVALID_VALUE_2:
+      error = clib_error_return (0, "key too short");
+      break;
+    case VNET_API_ERROR_UNSUPPORTED:
+      error = clib_error_return (0, "RSS not supported by the interface");
+      break;
+    default:
+      error = clib_error_return (0, "nat44_ed_rss_enable returned %d", rv);
+      break;
+    }
+
+done:
+  vec_free (key);
+  unformat_free (line_input);
+
+  return error;
+}
+
+static clib_error_t *
+nat_show_rss_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			 vlib_cli_command_t *cmd)
+{
+  snat_main_t *sm = &snat_main;
+
+  vlib_cli_output (vm, "NAT44 RSS: %U", format_nat44_ed_rss, sm);
+  vlib_cli_output (vm, "  ports steered: %llu",
+		   vlib_get_simple_counter (&sm->counters.rss_port_steered, 0));
+  vlib_cli_output (vm, "  ports missed: %llu",
+		   vlib_get_simple_counter (&sm->counters.rss_port_missed, 0));
+
+#define _(x)                                                                  \
+  vlib_cli_output (                                                           \
+    vm, "handoff %s: same worker %llu, do handoff %llu, congestion drop %llu", \
+    #x, vlib_get_simple_counter (&sm->counters.handoff.x.same_worker, 0),     \
+    vlib_get_simple_counter (&sm->counters.handoff.x.do_handoff, 0),          \
+    vlib_get_simple_counter (&sm->counters.handoff.x.congestion_drop, 0));
+  _ (in2out)
+  _ (in2out_output)
+  _ (out2in)
+#undef _
+
+  return 0;
+}
+
 static clib_error_t *
 add_address_command_fn (vlib_main_t * vm,
 			unformat_input_t * input, vlib_cli_command_t * cmd)
@@ -605,6 +854,24 @@ nat44_show_summary_command_fn (vlib_main_t * vm, unformat_input_t * input,
   return 0;
 }
 
+static void
+nat44_show_address_port_usage (vlib_main_t *vm, snat_main_t *sm,
+			       snat_address_t *ap)
+{
+  static char *names[NAT44_ED_N_PORT_MAPS] = { "tcp", "udp", "icmp",
+					       "other" };
+  u32 n_busy[NAT44_ED_N_PORT_MAPS] = { 0 };
+  u32 n_ports, i;
+
+  n_ports = sm->port_per_thread * clib_max (vec_len (sm->workers), 1);
+  for (i = 0; i < vec_len (ap->port_maps); i++)
+    n_busy[i % NAT44_ED_N_PORT_MAPS] += ap->port_maps[i].n_busy;
+
+  for (i = 0; i < NAT44_ED_N_PORT_MAPS; i++)
+    vlib_cli_output (vm, "  %u busy %s ports (%.1f%% of %u)", n_busy[i],
+		     names[i], 100.0 * n_busy[i] / n_ports, n_ports);
+}
+
 static clib_error_t *
 nat44_show_addresses_command_fn (vlib_main_t * vm, unformat_input_t * input,
 				 vlib_cli_command_t * cmd)
@@ -625,6 +892,8 @@ nat44_show_addresses_command_fn (vlib_main_t * vm, unformat_input_t * input,
 
       if (ap->addr_len != ~0)
 	vlib_cli_output (vm, "  synced with interface address");
+
+      nat44_show_address_port_usage (vm, sm, ap);
     }
   vlib_cli_output (vm, "NAT44 twice-nat pool addresses:");
   vec_foreach (ap, sm->twice_nat_addresses)
@@ -1870,6 +2139,104 @@ VLIB_CLI_COMMAND (nat44_show_hash, static) = {
   .function = nat44_show_hash_command_fn,
 };
 
+/*?
+ * @cliexpar
+ * @cliexstart{nat44 ha failover}
+ * Set HA failover (remote settings). Setting a new failover resends the
+ * existing sessions to it.
+ *  vpp# nat44 ha failover 10.0.0.2:1234 refresh-interval 10
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_ha_failover_command, static) = {
+  .path = "nat44 ha failover",
+  .short_help =
+    "nat44 ha failover <ip4-address>:<port> [refresh-interval <sec>]",
+  .function = nat_ha_failover_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{nat44 ha listener}
+ * Set HA listener (local settings)
+ *  vpp# nat44 ha listener 10.0.0.1:1234 path-mtu 1500
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_ha_listener_command, static) = {
+  .path = "nat44 ha listener",
+  .short_help = "nat44 ha listener <ip4-address>:<port> [path-mtu <path-mtu>]",
+  .function = nat_ha_listener_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{show nat44 ha}
+ * Show HA configuration/status
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_show_ha_command, static) = {
+  .path = "show nat44 ha",
+  .short_help = "show nat44 ha",
+  .function = nat_show_ha_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{nat44 ha flush}
+ * Flush the current HA data (for testing)
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_ha_flush_command, static) = {
+  .path = "nat44 ha flush",
+  .short_help = "nat44 ha flush",
+  .function = nat_ha_flush_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{nat44 ha resync}
+ * Resync HA (resend existing sessions to new failover)
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_ha_resync_command, static) = {
+  .path = "nat44 ha resync",
+  .short_help = "nat44 ha resync",
+  .function = nat_ha_resync_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{nat44 rss}
+ * Pick outside TCP and UDP ports so that the NIC receives return traffic on
+ * an rx queue polled by the thread owning the session, which saves the
+ * out2in worker handoff. The key and the redirection table size must match
+ * the RSS configuration of the outside NIC (default: the common 40 byte
+ * Toeplitz key and 128 entries), the redirection table is assumed to spread
+ * the rx queues round robin. With "flow" a vnet flow selecting Toeplitz RSS
+ * over the IPv4 TCP/UDP 4-tuple is installed on the NIC too.
+ * Run it again after changing the rx queue placement of the interface.
+ *  vpp# nat44 rss outside-interface GigabitEthernet0/8/0 reta-size 512
+ *  vpp# nat44 rss disable
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_rss_command, static) = {
+  .path = "nat44 rss",
+  .short_help = "nat44 rss outside-interface <intfc> [key <hex>] "
+		"[reta-size <n>] [flow] | disable",
+  .function = nat_rss_command_fn,
+};
+
+/*?
+ * @cliexpar
+ * @cliexstart{show nat44 rss}
+ * Show RSS-aware port selection and worker handoff statistics
+ * @cliexend
+?*/
+VLIB_CLI_COMMAND (nat_show_rss_command, static) = {
+  .path = "show nat44 rss",
+  .short_help = "show nat44 rss",
+  .function = nat_show_rss_command_fn,
+};
+
 /*?
  * @cliexpar
  * @cliexstart{nat44 add address}
@@ -1909,20 +2276,19 @@ VLIB_CLI_COMMAND (nat44_show_summary_command, static) = {
  * NAT44 pool addresses:
  * 172.16.2.2
  *   tenant VRF independent
- *   10 busy udp ports
- *   0 busy tcp ports
- *   0 busy icmp ports
+ *   0 busy tcp ports (0.0% of 64511)
+ *   10 busy udp ports (0.0% of 64511)
+ *   0 busy icmp ports (0.0% of 64511)
+ *   0 busy other ports (0.0% of 64511)
  * 172.16.1.3
  *   tenant VRF: 10
- *   0 busy udp ports
- *   2 busy tcp ports
- *   0 busy icmp ports
+ *   2 busy tcp ports (0.0% of 64511)
+ *   0 busy udp ports (0.0% of 64511)
+ *   0 busy icmp ports (0.0% of 64511)
+ *   0 busy other ports (0.0% of 64511)
  * NAT44 twice-nat pool addresses:
  * 10.20.30.72
  *   tenant VRF independent
- *   0 busy udp ports
- *   0 busy tcp ports
- *   0 busy icmp ports
  * @cliexend
 ?*/
 VLIB_CLI_COMMAND (nat44_show_addresses_command, static) = {
@@ -2119,7 +2485,9 @@ VLIB_CLI_COMMAND (nat44_show_sessions_command, static) = {
 /*?
  * @cliexpar
  * @cliexstart{set nat44 session limit}
- * Set NAT44 session limit.
+ * Set NAT44 session limit. If the limit needs a differently sized flow hash,
+ * the table is resized in the background and existing sessions are kept;
+ * progress is shown by "show nat44 hash tables".
  * @cliexend
 ?*/
 VLIB_CLI_COMMAND (nat44_set_session_limit_command, static) = {
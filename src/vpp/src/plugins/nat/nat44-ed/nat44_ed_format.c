@@ -206,6 +206,51 @@ format_snat_static_map_to_resolve (u8 * s, va_list * args)
   return s;
 }
 
+/**
+ * @brief Flow hash occupancy: entries per bucket and colliding buckets.
+ *
+ * A bucket which had to grow past one page, or which fell back to a linear
+ * search, holds keys whose hashes collide; many of them mean the table is
+ * too small for the number of sessions.
+ */
+u8 *
+format_nat44_ed_flow_hash_occupancy (u8 *s, va_list *args)
+{
+  clib_bihash_16_8_t *h = va_arg (*args, clib_bihash_16_8_t *);
+  u32 indent = format_get_indent (s);
+  clib_bihash_bucket_16_8_t *b;
+  u64 hist[BIHASH_KVP_PER_PAGE + 2] = { 0 };
+  u64 n_entries = 0, n_multi_page = 0, n_linear = 0;
+  u32 i, n;
+
+  if (!h->instantiated)
+    return format (s, "%u buckets, not instantiated", h->nbuckets);
+
+  for (i = 0; i < h->nbuckets; i++)
+    {
+      b = clib_bihash_get_bucket_16_8 (h, i);
+      n = clib_bihash_bucket_is_empty_16_8 (b) ? 0 : b->refcnt;
+      n_entries += n;
+      hist[clib_min (n, BIHASH_KVP_PER_PAGE + 1)]++;
+      if (n && b->log2_pages)
+	n_multi_page++;
+      if (n && b->linear_search)
+	n_linear++;
+    }
+
+  s = format (s, "%u buckets, %lu entries, load factor %.2f", h->nbuckets,
+	      n_entries, (f64) n_entries / h->nbuckets);
+  s = format (s, "\n%Ucolliding buckets: %lu multi-page, %lu linear search",
+	      format_white_space, indent, n_multi_page, n_linear);
+  s = format (s, "\n%Uentries per bucket:", format_white_space, indent);
+  for (i = 0; i <= BIHASH_KVP_PER_PAGE; i++)
+    s = format (s, " %u:%lu", i, hist[i]);
+  s = format (s, " >%u:%lu", BIHASH_KVP_PER_PAGE,
+	      hist[BIHASH_KVP_PER_PAGE + 1]);
+
+  return s;
+}
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
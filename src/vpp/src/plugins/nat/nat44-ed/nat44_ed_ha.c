@@ -0,0 +1,1369 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/udp/udp_local.h>
+#include <vppinfra/atomics.h>
+
+#include <nat/lib/log.h>
+
+#include <nat/nat44-ed/nat44_ed.h>
+#include <nat/nat44-ed/nat44_ed_ha.h>
+#include <nat/nat44-ed/nat44_ed_inlines.h>
+
+/* number of retries */
+#define NAT44_ED_HA_RETRIES 3
+/* seconds between retries */
+#define NAT44_ED_HA_RETRY_INTERVAL 2.0
+
+/* NAT44-ED HA protocol version, NAT44-EI HA uses 0x01 */
+#define NAT44_ED_HA_VERSION 0x02
+
+/* NAT44-ED HA protocol flags */
+#define NAT44_ED_HA_FLAG_ACK 0x01
+
+/* session flags the standby needs to rebuild a session */
+#define NAT44_ED_HA_SESSION_FLAGS                                             \
+  (SNAT_SESSION_FLAG_STATIC_MAPPING | SNAT_SESSION_FLAG_LOAD_BALANCING |     \
+   SNAT_SESSION_FLAG_EXACT_ADDRESS | SNAT_SESSION_FLAG_HAIRPINNING)
+
+/* NAT44-ED HA event types */
+typedef enum
+{
+  NAT44_ED_HA_ADD = 1,
+  NAT44_ED_HA_DEL,
+  NAT44_ED_HA_REFRESH,
+} nat44_ed_ha_event_type_t;
+
+/* NAT44-ED HA protocol header */
+typedef CLIB_PACKED (struct {
+  /* version */
+  u8 version;
+  /* flags */
+  u8 flags;
+  /* event count */
+  u16 count;
+  /* sequence number */
+  u32 sequence_number;
+  /* thread index where events originated */
+  u32 thread_index;
+}) nat44_ed_ha_message_header_t;
+
+#define NAT44_ED_HA_MESSAGE_HDR_LEN                                           \
+  (sizeof (ip4_header_t) + sizeof (udp_header_t) +                            \
+   sizeof (nat44_ed_ha_message_header_t))
+
+nat44_ed_ha_main_t nat44_ed_ha_main;
+
+vlib_node_registration_t nat44_ed_ha_node;
+vlib_node_registration_t nat44_ed_ha_handoff_node;
+vlib_node_registration_t nat44_ed_ha_process_node;
+
+/*
+ * Twice-NAT sessions translate both ends of the flow and forwarding bypass
+ * sessions do not translate at all; neither can be rebuilt from the two
+ * flows sent to the standby.
+ */
+static_always_inline int
+nat44_ed_ha_is_synced_session (snat_session_t *s)
+{
+  return !(nat44_ed_is_twice_nat_session (s) ||
+	   na44_ed_is_fwd_bypass_session (s) ||
+	   nat44_ed_is_unk_proto (s->proto));
+}
+
+static_always_inline void
+nat44_ed_ha_event_init (nat44_ed_ha_event_t *e, u8 event_type,
+			snat_session_t *s)
+{
+  clib_memset (e, 0, sizeof (*e));
+  e->event_type = event_type;
+  e->protocol = s->proto;
+  e->flags = clib_host_to_net_u16 (s->flags & NAT44_ED_HA_SESSION_FLAGS);
+  e->in_addr = s->i2o.match.saddr.as_u32;
+  e->in_port = s->i2o.match.sport;
+  e->eh_addr = s->i2o.match.daddr.as_u32;
+  e->eh_port = s->i2o.match.dport;
+  e->fib_index = clib_host_to_net_u32 (s->i2o.match.fib_index);
+  e->out_addr = s->o2i.match.daddr.as_u32;
+  e->out_port = s->o2i.match.dport;
+  e->ehn_addr = s->o2i.match.saddr.as_u32;
+  e->ehn_port = s->o2i.match.sport;
+  e->out_fib_index = clib_host_to_net_u32 (s->o2i.match.fib_index);
+  e->total_pkts = clib_host_to_net_u32 (s->total_pkts);
+  e->total_bytes = clib_host_to_net_u64 (s->total_bytes);
+  e->state = s->state;
+}
+
+/* queue an event in the ring of the thread owning the session */
+static_always_inline void
+nat44_ed_ha_event_enqueue (nat44_ed_ha_main_t *ha, u32 thread_index,
+			   nat44_ed_ha_event_t *e)
+{
+  nat44_ed_ha_per_thread_data_t *td =
+    vec_elt_at_index (ha->per_thread_data, thread_index);
+  u32 n_queued = td->ring_head - td->ring_tail;
+
+  /* the main thread queues for other threads only under the barrier */
+  ASSERT (thread_index == vlib_get_thread_index () ||
+	  vlib_worker_thread_barrier_held ());
+
+  if (PREDICT_FALSE (n_queued >= NAT44_ED_HA_RING_SIZE))
+    {
+      vlib_increment_simple_counter (
+	&ha->counters[NAT44_ED_HA_COUNTER_RING_FULL], vlib_get_thread_index (),
+	0, 1);
+      return;
+    }
+
+  clib_memcpy_fast (&td->ring[td->ring_head & (NAT44_ED_HA_RING_SIZE - 1)], e,
+		    sizeof (*e));
+  td->ring_head++;
+
+  /* a full message is waiting, do not wait for the periodic run */
+  if (n_queued + 1 == ha->state_sync_max_events)
+    vlib_node_set_interrupt_pending (vlib_get_main_by_index (thread_index),
+				     nat44_ed_ha_worker_node.index);
+}
+
+void
+nat44_ed_ha_sadd (snat_main_t *sm, snat_session_t *s, u32 thread_index)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  nat44_ed_ha_event_t e;
+
+  if (PREDICT_TRUE (!ha->dst_port) || !nat44_ed_ha_is_synced_session (s))
+    return;
+
+  nat44_ed_ha_event_init (&e, NAT44_ED_HA_ADD, s);
+  nat44_ed_ha_event_enqueue (ha, thread_index, &e);
+}
+
+void
+nat44_ed_ha_sdel (snat_main_t *sm, snat_session_t *s, u32 thread_index)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  nat44_ed_ha_event_t e;
+
+  if (PREDICT_TRUE (!ha->dst_port) || !nat44_ed_ha_is_synced_session (s))
+    return;
+
+  nat44_ed_ha_event_init (&e, NAT44_ED_HA_DEL, s);
+  nat44_ed_ha_event_enqueue (ha, thread_index, &e);
+}
+
+static void
+nat44_ed_ha_header_create (nat44_ed_ha_main_t *ha, vlib_buffer_t *b,
+			   u32 thread_index)
+{
+  nat44_ed_ha_message_header_t *h;
+  ip4_header_t *ip;
+  udp_header_t *udp;
+  u32 sequence_number;
+
+  b->current_data = 0;
+  b->current_length = NAT44_ED_HA_MESSAGE_HDR_LEN;
+  b->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
+  b->flags |= VNET_BUFFER_F_LOCALLY_ORIGINATED;
+  vnet_buffer (b)->sw_if_index[VLIB_RX] = 0;
+  vnet_buffer (b)->sw_if_index[VLIB_TX] = 0;
+  ip = vlib_buffer_get_current (b);
+  udp = (udp_header_t *) (ip + 1);
+  h = (nat44_ed_ha_message_header_t *) (udp + 1);
+
+  /* IP header */
+  clib_memset (ip, 0, sizeof (*ip));
+  ip->ip_version_and_header_length = 0x45;
+  ip->ttl = 254;
+  ip->protocol = IP_PROTOCOL_UDP;
+  ip->flags_and_fragment_offset =
+    clib_host_to_net_u16 (IP4_HEADER_FLAG_DONT_FRAGMENT);
+  ip->src_address.as_u32 = ha->src_ip_address.as_u32;
+  ip->dst_address.as_u32 = ha->dst_ip_address.as_u32;
+  /* UDP header */
+  udp->src_port = clib_host_to_net_u16 (ha->src_port);
+  udp->dst_port = clib_host_to_net_u16 (ha->dst_port);
+  udp->checksum = 0;
+
+  /* NAT44-ED HA protocol header */
+  h->version = NAT44_ED_HA_VERSION;
+  h->flags = 0;
+  h->count = 0;
+  h->thread_index = clib_host_to_net_u32 (thread_index);
+  sequence_number = clib_atomic_fetch_add (&ha->sequence_number, 1);
+  h->sequence_number = clib_host_to_net_u32 (sequence_number);
+}
+
+/* finish the message under construction and queue it for ip4-lookup */
+static void
+nat44_ed_ha_send (vlib_main_t *vm, nat44_ed_ha_main_t *ha,
+		  nat44_ed_ha_per_thread_data_t *td)
+{
+  vlib_buffer_t *b = td->state_sync_buffer;
+  nat44_ed_ha_resend_entry_t *entry;
+  nat44_ed_ha_message_header_t *h;
+  vlib_frame_t *f;
+  ip4_header_t *ip;
+  udp_header_t *udp;
+  u32 *to_next;
+
+  ip = vlib_buffer_get_current (b);
+  udp = ip4_next_header (ip);
+  h = (nat44_ed_ha_message_header_t *) (udp + 1);
+
+  h->count = clib_host_to_net_u16 (td->state_sync_count);
+  ip->length = clib_host_to_net_u16 (b->current_length);
+  ip->checksum = ip4_header_checksum (ip);
+  udp->length = clib_host_to_net_u16 (b->current_length - sizeof (*ip));
+
+  /* keep a copy until the message is ACKed */
+  vec_add2 (td->resend_queue, entry, 1);
+  clib_memset (entry, 0, sizeof (*entry));
+  entry->retry_timer = vlib_time_now (vm) + NAT44_ED_HA_RETRY_INTERVAL;
+  entry->seq = h->sequence_number;
+  entry->is_resync = td->state_sync_is_resync;
+  vec_add (entry->data, (u8 *) ip, b->current_length);
+
+  if (td->state_sync_is_resync)
+    clib_atomic_fetch_add (&ha->resync_ack_count, 1);
+
+  f = td->state_sync_frame;
+  if (!f)
+    f = td->state_sync_frame =
+      vlib_get_frame_to_node (vm, ip4_lookup_node.index);
+  to_next = vlib_frame_vector_args (f);
+  to_next[f->n_vectors++] = vlib_get_buffer_index (vm, b);
+  if (f->n_vectors == VLIB_FRAME_SIZE)
+    {
+      vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
+      td->state_sync_frame = 0;
+    }
+
+  vlib_increment_simple_counter (&ha->counters[NAT44_ED_HA_COUNTER_SEND_MSG],
+				 vm->thread_index, 0, 1);
+
+  td->state_sync_buffer = 0;
+  td->state_sync_count = 0;
+  td->state_sync_is_resync = 0;
+}
+
+/* add an event to the message under construction */
+static void
+nat44_ed_ha_event_add (vlib_main_t *vm, nat44_ed_ha_main_t *ha,
+		       nat44_ed_ha_per_thread_data_t *td,
+		       nat44_ed_ha_event_t *e, u8 is_resync)
+{
+  snat_main_t *sm = &snat_main;
+  vlib_buffer_t *b = td->state_sync_buffer;
+  u32 bi;
+
+  if (PREDICT_FALSE (!b))
+    {
+      if (vlib_buffer_alloc (vm, &bi, 1) != 1)
+	{
+	  nat_elog_warn (sm, "HA NAT state sync can't allocate buffer");
+	  return;
+	}
+      b = td->state_sync_buffer = vlib_get_buffer (vm, bi);
+      clib_memset (vnet_buffer (b), 0, sizeof (*vnet_buffer (b)));
+      nat44_ed_ha_header_create (ha, b, vm->thread_index);
+    }
+
+  clib_memcpy_fast (vlib_buffer_get_tail (b), e, sizeof (*e));
+  b->current_length += sizeof (*e);
+  td->state_sync_count++;
+  td->state_sync_is_resync |= is_resync;
+
+  switch (e->event_type)
+    {
+    case NAT44_ED_HA_ADD:
+      vlib_increment_simple_counter (
+	&ha->counters[NAT44_ED_HA_COUNTER_SEND_ADD], vm->thread_index, 0, 1);
+      break;
+    case NAT44_ED_HA_DEL:
+      vlib_increment_simple_counter (
+	&ha->counters[NAT44_ED_HA_COUNTER_SEND_DEL], vm->thread_index, 0, 1);
+      break;
+    case NAT44_ED_HA_REFRESH:
+      vlib_increment_simple_counter (
+	&ha->counters[NAT44_ED_HA_COUNTER_SEND_REFRESH], vm->thread_index, 0,
+	1);
+      break;
+    default:
+      break;
+    }
+
+  if (td->state_sync_count == ha->state_sync_max_events)
+    nat44_ed_ha_send (vm, ha, td);
+}
+
+/* drop everything queued while sync is off */
+static void
+nat44_ed_ha_thread_reset (vlib_main_t *vm, snat_main_t *sm,
+			  nat44_ed_ha_per_thread_data_t *td, u32 thread_index)
+{
+  snat_main_per_thread_data_t *tsm;
+  nat44_ed_ha_resend_entry_t *entry;
+  snat_session_t *s;
+  u32 *si;
+
+  td->ring_tail = td->ring_head;
+
+  if (sm->enabled)
+    {
+      tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+      vec_foreach (si, td->refresh_sessions)
+	{
+	  if (pool_is_free_index (tsm->sessions, *si))
+	    continue;
+	  s = pool_elt_at_index (tsm->sessions, *si);
+	  s->flags &= ~SNAT_SESSION_FLAG_HA_REFRESH;
+	}
+    }
+  vec_reset_length (td->refresh_sessions);
+
+  if (td->state_sync_buffer)
+    {
+      vlib_buffer_free_one (vm,
+			    vlib_get_buffer_index (vm, td->state_sync_buffer));
+      td->state_sync_buffer = 0;
+      td->state_sync_count = 0;
+      td->state_sync_is_resync = 0;
+    }
+
+  vec_foreach (entry, td->resend_queue)
+    {
+      if (entry->is_resync)
+	clib_atomic_fetch_sub (&nat44_ed_ha_main.resync_ack_count, 1);
+      vec_free (entry->data);
+    }
+  vec_reset_length (td->resend_queue);
+
+  if (td->resync_index != ~0)
+    {
+      td->resync_index = ~0;
+      clib_atomic_fetch_sub (&nat44_ed_ha_main.resync_threads_pending, 1);
+    }
+}
+
+/* scan non-ACKed messages for retry */
+static void
+nat44_ed_ha_resend_scan (vlib_main_t *vm, nat44_ed_ha_main_t *ha,
+			 nat44_ed_ha_per_thread_data_t *td)
+{
+  snat_main_t *sm = &snat_main;
+  nat44_ed_ha_resend_entry_t *entry;
+  f64 now = vlib_time_now (vm);
+  vlib_buffer_t *b;
+  vlib_frame_t *f;
+  u32 bi, *to_next;
+  u32 i = 0;
+
+  while (i < vec_len (td->resend_queue))
+    {
+      entry = vec_elt_at_index (td->resend_queue, i);
+      if (entry->retry_timer > now)
+	{
+	  i++;
+	  continue;
+	}
+
+      /* maximum retry reached, delete cached data */
+      if (entry->retry_count >= NAT44_ED_HA_RETRIES)
+	{
+	  nat_elog_notice_X1 (sm, "HA seq %d missed", "i4",
+			      clib_net_to_host_u32 (entry->seq));
+	  if (entry->is_resync)
+	    {
+	      clib_atomic_fetch_add (&ha->resync_ack_missed, 1);
+	      clib_atomic_fetch_sub (&ha->resync_ack_count, 1);
+	    }
+	  vlib_increment_simple_counter (
+	    &ha->counters[NAT44_ED_HA_COUNTER_MISSED_COUNT], vm->thread_index,
+	    0, 1);
+	  vec_free (entry->data);
+	  vec_del1 (td->resend_queue, i);
+	  continue;
+	}
+
+      /* retry to send non-ACKed data */
+      if (vlib_buffer_alloc (vm, &bi, 1) != 1)
+	{
+	  nat_elog_warn (sm, "HA NAT state sync can't allocate buffer");
+	  return;
+	}
+      entry->retry_count++;
+      entry->retry_timer = now + NAT44_ED_HA_RETRY_INTERVAL;
+      vlib_increment_simple_counter (
+	&ha->counters[NAT44_ED_HA_COUNTER_RETRY_COUNT], vm->thread_index, 0,
+	1);
+
+      b = vlib_get_buffer (vm, bi);
+      clib_memset (vnet_buffer (b), 0, sizeof (*vnet_buffer (b)));
+      b->current_data = 0;
+      b->current_length = vec_len (entry->data);
+      b->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
+      b->flags |= VNET_BUFFER_F_LOCALLY_ORIGINATED;
+      clib_memcpy_fast (vlib_buffer_get_current (b), entry->data,
+			vec_len (entry->data));
+
+      f = td->state_sync_frame;
+      if (!f)
+	f = td->state_sync_frame =
+	  vlib_get_frame_to_node (vm, ip4_lookup_node.index);
+      to_next = vlib_frame_vector_args (f);
+      to_next[f->n_vectors++] = bi;
+      if (f->n_vectors == VLIB_FRAME_SIZE)
+	{
+	  vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
+	  td->state_sync_frame = 0;
+	}
+      i++;
+    }
+}
+
+/* turn the queued events of this thread into messages */
+static void
+nat44_ed_ha_thread_flush (vlib_main_t *vm, vlib_node_runtime_t *node)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  snat_main_t *sm = &snat_main;
+  u32 thread_index = vm->thread_index;
+  nat44_ed_ha_per_thread_data_t *td;
+  snat_main_per_thread_data_t *tsm;
+  nat44_ed_ha_event_t e;
+  f64 now = vlib_time_now (vm);
+  snat_session_t *s;
+  u32 *si, n_left;
+
+  td = vec_elt_at_index (ha->per_thread_data, thread_index);
+
+  if (!ha->dst_port || !sm->enabled)
+    {
+      nat44_ed_ha_thread_reset (vm, sm, td, thread_index);
+      return;
+    }
+
+  tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+
+  while (td->ring_tail != td->ring_head)
+    {
+      nat44_ed_ha_event_add (
+	vm, ha, td, &td->ring[td->ring_tail & (NAT44_ED_HA_RING_SIZE - 1)], 0);
+      td->ring_tail++;
+    }
+
+  /* coalesced refreshes, counters are taken as of now */
+  vec_foreach (si, td->refresh_sessions)
+    {
+      if (pool_is_free_index (tsm->sessions, *si))
+	continue;
+      s = pool_elt_at_index (tsm->sessions, *si);
+      if (!(s->flags & SNAT_SESSION_FLAG_HA_REFRESH))
+	continue;
+      s->flags &= ~SNAT_SESSION_FLAG_HA_REFRESH;
+      s->ha_last_refreshed = now;
+      if (!nat44_ed_ha_is_synced_session (s))
+	continue;
+      nat44_ed_ha_event_init (&e, NAT44_ED_HA_REFRESH, s);
+      nat44_ed_ha_event_add (vm, ha, td, &e, 0);
+    }
+  vec_reset_length (td->refresh_sessions);
+
+  if (td->resync_index != ~0)
+    {
+      for (n_left = NAT44_ED_HA_RESYNC_BATCH;
+	   n_left && td->resync_index < vec_len (tsm->sessions); n_left--)
+	{
+	  if (!pool_is_free_index (tsm->sessions, td->resync_index))
+	    {
+	      s = pool_elt_at_index (tsm->sessions, td->resync_index);
+	      if (nat44_ed_ha_is_synced_session (s))
+		{
+		  nat44_ed_ha_event_init (&e, NAT44_ED_HA_ADD, s);
+		  nat44_ed_ha_event_add (vm, ha, td, &e, 1);
+		}
+	    }
+	  td->resync_index++;
+	}
+
+      if (n_left)
+	{
+	  /* the last message must be counted before the thread is done */
+	  if (td->state_sync_count)
+	    nat44_ed_ha_send (vm, ha, td);
+	  td->resync_index = ~0;
+	  clib_atomic_fetch_sub (&ha->resync_threads_pending, 1);
+	}
+      else
+	vlib_node_set_interrupt_pending (vm, node->node_index);
+    }
+
+  if (td->state_sync_count)
+    nat44_ed_ha_send (vm, ha, td);
+
+  nat44_ed_ha_resend_scan (vm, ha, td);
+
+  if (td->state_sync_frame)
+    {
+      vlib_put_frame_to_node (vm, ip4_lookup_node.index, td->state_sync_frame);
+      td->state_sync_frame = 0;
+    }
+}
+
+/* per thread node sending the queued events, run on interrupt */
+VLIB_NODE_FN (nat44_ed_ha_worker_node)
+(vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *frame)
+{
+  nat44_ed_ha_thread_flush (vm, node);
+  return 0;
+}
+
+VLIB_REGISTER_NODE (nat44_ed_ha_worker_node) = {
+  .name = "nat44-ed-ha-worker",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_INTERRUPT,
+};
+
+static void
+nat44_ed_ha_resync_fin (nat44_ed_ha_main_t *ha)
+{
+  snat_main_t *sm = &snat_main;
+
+  ha->in_resync = 0;
+  if (ha->resync_ack_missed)
+    {
+      nat_elog_info (sm, "HA resync completed with result FAILED");
+    }
+  else
+    {
+      nat_elog_info (sm, "HA resync completed with result SUCCESS");
+    }
+
+  if (ha->event_callback)
+    ha->event_callback (ha->client_index, ha->pid, ha->resync_ack_missed);
+}
+
+/* periodically send interrupt to each thread */
+static uword
+nat44_ed_ha_process (vlib_main_t *vm, vlib_node_runtime_t *rt,
+		     vlib_frame_t *f)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  uword *event_data = 0;
+  u32 ti;
+
+  while (1)
+    {
+      /* idle until a failover is set */
+      if (ha->dst_port || ha->in_resync)
+	vlib_process_wait_for_event_or_clock (vm, 1.0);
+      else
+	vlib_process_wait_for_event (vm);
+      vlib_process_get_events (vm, &event_data);
+      vec_reset_length (event_data);
+
+      for (ti = 0; ti < vlib_get_n_threads (); ti++)
+	vlib_node_set_interrupt_pending (vlib_get_main_by_index (ti),
+					 nat44_ed_ha_worker_node.index);
+
+      if (ha->in_resync &&
+	  !clib_atomic_load_relax_n (&ha->resync_threads_pending) &&
+	  !clib_atomic_load_relax_n (&ha->resync_ack_count))
+	nat44_ed_ha_resync_fin (ha);
+    }
+
+  return 0;
+}
+
+VLIB_REGISTER_NODE (nat44_ed_ha_process_node) = {
+  .function = nat44_ed_ha_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "nat44-ed-ha-process",
+};
+
+void
+nat44_ed_ha_init (vlib_main_t *vm)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  nat44_ed_ha_per_thread_data_t *td;
+
+  clib_memset (ha, 0, sizeof (*ha));
+  ha->fq_index = ~0;
+
+  vec_validate_aligned (ha->per_thread_data, vlib_get_n_threads () - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vec_foreach (td, ha->per_thread_data)
+    {
+      vec_validate (td->ring, NAT44_ED_HA_RING_SIZE - 1);
+      td->resync_index = ~0;
+    }
+
+#define _(N, s, v)                                                            \
+  ha->counters[v].name = s;                                                   \
+  ha->counters[v].stat_segment_name = "/nat44-ed/ha/" s;                      \
+  vlib_validate_simple_counter (&ha->counters[v], 0);                         \
+  vlib_zero_simple_counter (&ha->counters[v], 0);
+  foreach_nat44_ed_ha_counter
+#undef _
+}
+
+void
+nat44_ed_ha_disable ()
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+
+  /* the worker nodes drop what is queued on their next run */
+  ha->dst_port = 0;
+  vlib_process_signal_event (vlib_get_main (), nat44_ed_ha_process_node.index,
+			     0, 0);
+}
+
+int
+nat44_ed_ha_set_listener (vlib_main_t *vm, ip4_address_t *addr, u16 port,
+			  u32 path_mtu)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  snat_main_t *sm = &snat_main;
+
+  if (path_mtu < NAT44_ED_HA_MESSAGE_HDR_LEN + sizeof (nat44_ed_ha_event_t))
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  /* unregister previously set UDP port */
+  if (ha->src_port)
+    udp_unregister_dst_port (vm, ha->src_port, 1);
+
+  ha->src_ip_address.as_u32 = addr->as_u32;
+  ha->src_port = port;
+  ha->state_sync_path_mtu = path_mtu;
+  ha->state_sync_max_events = clib_min (
+    (path_mtu - NAT44_ED_HA_MESSAGE_HDR_LEN) / sizeof (nat44_ed_ha_event_t),
+    NAT44_ED_HA_RING_SIZE);
+
+  if (port)
+    {
+      /* if multiple worker threads first go to handoff node */
+      if (sm->num_workers > 1)
+	{
+	  if (ha->fq_index == ~0)
+	    ha->fq_index =
+	      vlib_frame_queue_main_init (nat44_ed_ha_node.index, 0);
+	  udp_register_dst_port (vm, port, nat44_ed_ha_handoff_node.index, 1);
+	}
+      else
+	{
+	  udp_register_dst_port (vm, port, nat44_ed_ha_node.index, 1);
+	}
+      nat_elog_info_X1 (sm, "HA listening on port %d for state sync", "i4",
+			port);
+    }
+
+  return 0;
+}
+
+void
+nat44_ed_ha_get_listener (ip4_address_t *addr, u16 *port, u32 *path_mtu)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+
+  addr->as_u32 = ha->src_ip_address.as_u32;
+  *port = ha->src_port;
+  *path_mtu = ha->state_sync_path_mtu;
+}
+
+int
+nat44_ed_ha_set_failover (vlib_main_t *vm, ip4_address_t *addr, u16 port,
+			  u32 session_refresh_interval)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  u8 is_new;
+
+  if (port && !ha->src_port)
+    return VNET_API_ERROR_FEATURE_DISABLED;
+
+  is_new = port && (ha->dst_ip_address.as_u32 != addr->as_u32 ||
+		    ha->dst_port != port);
+
+  ha->dst_ip_address.as_u32 = addr->as_u32;
+  ha->session_refresh_interval = session_refresh_interval;
+  ha->dst_port = port;
+
+  vlib_process_signal_event (vm, nat44_ed_ha_process_node.index, 0, 0);
+
+  /* a new standby knows nothing about the existing sessions */
+  if (is_new)
+    nat44_ed_ha_resync (0, 0, 0);
+
+  return 0;
+}
+
+void
+nat44_ed_ha_get_failover (ip4_address_t *addr, u16 *port,
+			  u32 *session_refresh_interval)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+
+  addr->as_u32 = ha->dst_ip_address.as_u32;
+  *port = ha->dst_port;
+  *session_refresh_interval = ha->session_refresh_interval;
+}
+
+void
+nat44_ed_ha_flush ()
+{
+  vlib_main_t *vm = vlib_get_main ();
+  vlib_node_runtime_t *rt;
+  u32 ti;
+
+  /* the main thread owns its ring, workers flush on their next loop */
+  rt = vlib_node_get_runtime (vm, nat44_ed_ha_worker_node.index);
+  nat44_ed_ha_thread_flush (vm, rt);
+  for (ti = 1; ti < vlib_get_n_threads (); ti++)
+    vlib_node_set_interrupt_pending (vlib_get_main_by_index (ti),
+				     nat44_ed_ha_worker_node.index);
+}
+
+int
+nat44_ed_ha_resync (u32 client_index, u32 pid,
+		    nat44_ed_ha_resync_event_cb_t event_callback)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  nat44_ed_ha_per_thread_data_t *td;
+  u32 ti;
+
+  if (!ha->dst_port)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  if (ha->in_resync)
+    return VNET_API_ERROR_BUSY;
+
+  ha->client_index = client_index;
+  ha->pid = pid;
+  ha->event_callback = event_callback;
+  ha->resync_ack_count = 0;
+  ha->resync_ack_missed = 0;
+  ha->resync_threads_pending = vec_len (ha->per_thread_data);
+  vec_foreach (td, ha->per_thread_data)
+    td->resync_index = 0;
+  ha->in_resync = 1;
+
+  for (ti = 0; ti < vlib_get_n_threads (); ti++)
+    vlib_node_set_interrupt_pending (vlib_get_main_by_index (ti),
+				     nat44_ed_ha_worker_node.index);
+  return 0;
+}
+
+void
+nat44_ed_ha_get_resync_status (u8 *in_resync, u32 *resync_ack_missed)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+
+  *in_resync = ha->in_resync;
+  *resync_ack_missed = ha->resync_ack_missed;
+}
+
+static_always_inline void
+nat44_ed_ha_ack_recv (nat44_ed_ha_main_t *ha, u32 seq, u32 thread_index)
+{
+  snat_main_t *sm = &snat_main;
+  nat44_ed_ha_per_thread_data_t *td =
+    vec_elt_at_index (ha->per_thread_data, thread_index);
+  nat44_ed_ha_resend_entry_t *entry;
+
+  vec_foreach (entry, td->resend_queue)
+    {
+      if (entry->seq != seq)
+	continue;
+
+      vlib_increment_simple_counter (
+	&ha->counters[NAT44_ED_HA_COUNTER_RECV_ACK], thread_index, 0, 1);
+      if (entry->is_resync)
+	clib_atomic_fetch_sub (&ha->resync_ack_count, 1);
+      vec_free (entry->data);
+      vec_del1 (td->resend_queue, entry - td->resend_queue);
+      nat_elog_debug_X1 (sm, "HA ACK for seq %d received", "i4",
+			 clib_net_to_host_u32 (seq));
+      return;
+    }
+}
+
+/* mark the outside port of a dynamic session busy, as in2out would */
+static_always_inline void
+nat44_ed_ha_port_map_set (snat_main_t *sm, snat_session_t *s,
+			  u32 thread_index)
+{
+  snat_main_per_thread_data_t *tsm =
+    vec_elt_at_index (sm->per_thread_data, thread_index);
+  nat44_ed_port_map_t *pm;
+  snat_address_t *a;
+  u32 port_offset;
+
+  port_offset = clib_net_to_host_u16 (s->out2in.port) - 1024 -
+		sm->port_per_thread * tsm->snat_thread_index;
+  if (port_offset >= sm->port_per_thread)
+    return;
+
+  vec_foreach (a, sm->addresses)
+    {
+      if (a->addr.as_u32 != s->out2in.addr.as_u32)
+	continue;
+      pm = nat44_ed_port_map_get (a, thread_index, s->proto);
+      nat44_ed_port_map_take (pm, s, a - sm->addresses, port_offset);
+      return;
+    }
+}
+
+static_always_inline snat_session_t *
+nat44_ed_ha_session_lookup (snat_main_t *sm, nat44_ed_ha_event_t *e,
+			    u32 thread_index)
+{
+  snat_main_per_thread_data_t *tsm =
+    vec_elt_at_index (sm->per_thread_data, thread_index);
+  clib_bihash_kv_16_8_t kv, value;
+  u32 session_index;
+
+  init_ed_k (&kv, e->in_addr, e->in_port, e->eh_addr, e->eh_port,
+	     clib_net_to_host_u32 (e->fib_index), e->protocol);
+  if (nat44_ed_flow_hash_search (sm, &kv, &value))
+    return 0;
+
+  /* a session created on another thread, or a static mapping key */
+  if (ed_value_get_thread_index (&value) != thread_index)
+    return 0;
+  session_index = ed_value_get_session_index (&value);
+  if (pool_is_free_index (tsm->sessions, session_index))
+    return 0;
+  return pool_elt_at_index (tsm->sessions, session_index);
+}
+
+/* free a session whose flow keys could not all be added, the keys that
+   failed belong to other sessions and stay in the flow hash */
+static_always_inline void
+nat44_ed_ha_session_free (snat_main_t *sm, snat_session_t *s,
+			  u32 thread_index, int o2i_added)
+{
+  snat_main_per_thread_data_t *tsm =
+    vec_elt_at_index (sm->per_thread_data, thread_index);
+
+  if (o2i_added && nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 0))
+    nat_elog_warn (sm, "flow hash del failed");
+  if (nat44_ed_session_timer_is_armed (tsm, s))
+    tw_timer_stop_1t_3w_1024sl_ov (&tsm->expire_wheel,
+				   s->expire_timer_handle);
+  clib_dlist_remove (tsm->lru_pool, s->lru_index);
+  pool_put_index (tsm->lru_pool, s->lru_index);
+  pool_put (tsm->sessions, s);
+  vlib_set_simple_counter (&sm->total_sessions, thread_index, 0,
+			   pool_elts (tsm->sessions));
+}
+
+/* rebuild the session from its two flows, as slow_path_ed builds them */
+static_always_inline void
+nat44_ed_ha_recv_add (snat_main_t *sm, nat44_ed_ha_event_t *e, f64 now,
+		      u32 thread_index)
+{
+  ip4_address_t in_addr, out_addr, eh_addr, ehn_addr;
+  u32 fib_index, out_fib_index;
+  snat_session_t *s;
+
+  /* resync of a session the standby already knows */
+  if (nat44_ed_ha_session_lookup (sm, e, thread_index))
+    return;
+
+  in_addr.as_u32 = e->in_addr;
+  out_addr.as_u32 = e->out_addr;
+  eh_addr.as_u32 = e->eh_addr;
+  ehn_addr.as_u32 = e->ehn_addr;
+  fib_index = clib_net_to_host_u32 (e->fib_index);
+  out_fib_index = clib_net_to_host_u32 (e->out_fib_index);
+
+  if (nat44_ed_is_unk_proto (e->protocol))
+    return;
+
+  if (PREDICT_FALSE (
+	nat44_ed_maximum_sessions_exceeded (sm, fib_index, thread_index)) &&
+      !nat_lru_free_one (sm, thread_index, now))
+    {
+      nat_elog_notice (sm, "HA maximum sessions exceeded");
+      return;
+    }
+
+  s = nat_ed_session_alloc (sm, thread_index, now, e->protocol);
+
+  s->flags |= clib_net_to_host_u16 (e->flags) & NAT44_ED_HA_SESSION_FLAGS;
+  s->in2out.addr = in_addr;
+  s->in2out.port = e->in_port;
+  s->in2out.fib_index = fib_index;
+  s->out2in.addr = out_addr;
+  s->out2in.port = e->out_port;
+  s->out2in.fib_index = out_fib_index;
+  s->ext_host_addr = eh_addr;
+  s->ext_host_port = e->eh_port;
+  s->total_pkts = clib_net_to_host_u32 (e->total_pkts);
+  s->total_bytes = clib_net_to_host_u64 (e->total_bytes);
+  s->state = e->state;
+
+  nat_6t_i2o_flow_init (sm, thread_index, s, in_addr, e->in_port, eh_addr,
+			e->eh_port, fib_index, e->protocol);
+  nat_6t_flow_saddr_rewrite_set (&s->i2o, out_addr.as_u32);
+  nat_6t_flow_daddr_rewrite_set (&s->i2o, ehn_addr.as_u32);
+  if (IP_PROTOCOL_ICMP == e->protocol)
+    {
+      nat_6t_flow_icmp_id_rewrite_set (&s->i2o, e->out_port);
+    }
+  else
+    {
+      nat_6t_flow_sport_rewrite_set (&s->i2o, e->out_port);
+      nat_6t_flow_dport_rewrite_set (&s->i2o, e->ehn_port);
+    }
+  nat_6t_flow_txfib_rewrite_set (&s->i2o, out_fib_index);
+
+  nat_6t_o2i_flow_init (sm, thread_index, s, ehn_addr, e->ehn_port, out_addr,
+			e->out_port, out_fib_index, e->protocol);
+  nat_6t_flow_daddr_rewrite_set (&s->o2i, in_addr.as_u32);
+  if (IP_PROTOCOL_ICMP == e->protocol)
+    {
+      nat_6t_flow_icmp_id_rewrite_set (&s->o2i, e->in_port);
+    }
+  else
+    {
+      nat_6t_flow_dport_rewrite_set (&s->o2i, e->in_port);
+    }
+  nat_6t_flow_txfib_rewrite_set (&s->o2i, fib_index);
+
+  /* a key already in the flow hash belongs to a session of another thread
+     or to a static mapping, keep it */
+  if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 2))
+    {
+      nat_elog_notice (sm, "HA out2in key add failed");
+      nat44_ed_ha_session_free (sm, s, thread_index, 0);
+      return;
+    }
+
+  if (nat_ed_ses_i2o_flow_hash_add_del (sm, thread_index, s, 2))
+    {
+      nat_elog_notice (sm, "HA in2out key add failed");
+      nat44_ed_ha_session_free (sm, s, thread_index, 1);
+      return;
+    }
+
+  if (!(s->flags & SNAT_SESSION_FLAG_STATIC_MAPPING))
+    nat44_ed_ha_port_map_set (sm, s, thread_index);
+
+  per_vrf_sessions_register_session (s, thread_index);
+}
+
+static_always_inline void
+nat44_ed_ha_recv_del (snat_main_t *sm, nat44_ed_ha_event_t *e,
+		      u32 thread_index)
+{
+  snat_session_t *s;
+
+  s = nat44_ed_ha_session_lookup (sm, e, thread_index);
+  if (!s)
+    return;
+
+  nat44_ed_free_session_data (sm, s, thread_index, 1);
+  nat_ed_session_delete (sm, s, thread_index, 1);
+}
+
+/* the standby sees no traffic, a refresh keeps the session alive */
+static_always_inline void
+nat44_ed_ha_recv_refresh (snat_main_t *sm, nat44_ed_ha_event_t *e, f64 now,
+			  u32 thread_index)
+{
+  snat_session_t *s;
+
+  s = nat44_ed_ha_session_lookup (sm, e, thread_index);
+  if (!s)
+    return;
+
+  s->total_pkts = clib_net_to_host_u32 (e->total_pkts);
+  s->total_bytes = clib_net_to_host_u64 (e->total_bytes);
+  s->state = e->state;
+  s->last_heard = now;
+  nat44_session_update_lru (sm, s, thread_index);
+}
+
+/* process received NAT HA event */
+static_always_inline void
+nat44_ed_ha_event_process (snat_main_t *sm, nat44_ed_ha_main_t *ha,
+			   nat44_ed_ha_event_t *event, f64 now, u32 thread_index)
+{
+  switch (event->event_type)
+    {
+    case NAT44_ED_HA_ADD:
+      vlib_increment_simple_counter (
+	&ha->counters[NAT44_ED_HA_COUNTER_RECV_ADD], thread_index, 0, 1);
+      nat44_ed_ha_recv_add (sm, event, now, thread_index);
+      break;
+    case NAT44_ED_HA_DEL:
+      vlib_increment_simple_counter (
+	&ha->counters[NAT44_ED_HA_COUNTER_RECV_DEL], thread_index, 0, 1);
+      nat44_ed_ha_recv_del (sm, event, thread_index);
+      break;
+    case NAT44_ED_HA_REFRESH:
+      vlib_increment_simple_counter (
+	&ha->counters[NAT44_ED_HA_COUNTER_RECV_REFRESH], thread_index, 0, 1);
+      nat44_ed_ha_recv_refresh (sm, event, now, thread_index);
+      break;
+    default:
+      nat_elog_notice_X1 (sm, "Unsupported HA event type %d", "i4",
+			  event->event_type);
+      break;
+    }
+}
+
+typedef struct
+{
+  ip4_address_t addr;
+  u32 event_count;
+} nat44_ed_ha_trace_t;
+
+static u8 *
+format_nat44_ed_ha_trace (u8 *s, va_list *args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  nat44_ed_ha_trace_t *t = va_arg (*args, nat44_ed_ha_trace_t *);
+
+  s = format (s, "nat44-ed-ha: %u events from %U", t->event_count,
+	      format_ip4_address, &t->addr);
+
+  return s;
+}
+
+typedef enum
+{
+  NAT44_ED_HA_NEXT_IP4_LOOKUP,
+  NAT44_ED_HA_NEXT_DROP,
+  NAT44_ED_HA_N_NEXT,
+} nat44_ed_ha_next_t;
+
+#define foreach_nat44_ed_ha_error                                             \
+  _ (PROCESSED, "pkts-processed")                                             \
+  _ (BAD_VERSION, "bad-version")                                              \
+  _ (TRUNCATED, "truncated message")                                          \
+  _ (DISABLED, "NAT44-ED disabled")
+
+typedef enum
+{
+#define _(sym, str) NAT44_ED_HA_ERROR_##sym,
+  foreach_nat44_ed_ha_error
+#undef _
+    NAT44_ED_HA_N_ERROR,
+} nat44_ed_ha_error_t;
+
+static char *nat44_ed_ha_error_strings[] = {
+#define _(sym, str) str,
+  foreach_nat44_ed_ha_error
+#undef _
+};
+
+/* process received NAT44-ED HA protocol messages */
+VLIB_NODE_FN (nat44_ed_ha_node)
+(vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *frame)
+{
+  u32 n_left_from, *from, next_index, *to_next;
+  f64 now = vlib_time_now (vm);
+  u32 thread_index = vm->thread_index;
+  u32 pkts_processed = 0;
+  ip4_main_t *i4m = &ip4_main;
+  u8 host_config_ttl = i4m->host_config.ttl;
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  snat_main_t *sm = &snat_main;
+
+  from = vlib_frame_vector_args (frame);
+  n_left_from = frame->n_vectors;
+  next_index = node->cached_next_index;
+
+  while (n_left_from > 0)
+    {
+      u32 n_left_to_next;
+
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+
+      while (n_left_from > 0 && n_left_to_next > 0)
+	{
+	  u32 bi0, next0, src_addr0, dst_addr0;
+	  vlib_buffer_t *b0;
+	  nat44_ed_ha_message_header_t *h0;
+	  nat44_ed_ha_event_t *e0;
+	  u16 event_count0, src_port0, dst_port0, old_len0;
+	  ip4_header_t *ip0;
+	  udp_header_t *udp0;
+	  ip_csum_t sum0;
+
+	  bi0 = from[0];
+	  to_next[0] = bi0;
+	  from += 1;
+	  to_next += 1;
+	  n_left_from -= 1;
+	  n_left_to_next -= 1;
+
+	  b0 = vlib_get_buffer (vm, bi0);
+	  h0 = vlib_buffer_get_current (b0);
+	  vlib_buffer_advance (b0, -sizeof (*udp0));
+	  udp0 = vlib_buffer_get_current (b0);
+	  vlib_buffer_advance (b0, -sizeof (*ip0));
+	  ip0 = vlib_buffer_get_current (b0);
+
+	  next0 = NAT44_ED_HA_NEXT_DROP;
+
+	  if (b0->current_length < NAT44_ED_HA_MESSAGE_HDR_LEN)
+	    {
+	      b0->error = node->errors[NAT44_ED_HA_ERROR_TRUNCATED];
+	      goto done0;
+	    }
+
+	  if (h0->version != NAT44_ED_HA_VERSION)
+	    {
+	      b0->error = node->errors[NAT44_ED_HA_ERROR_BAD_VERSION];
+	      goto done0;
+	    }
+
+	  event_count0 = clib_net_to_host_u16 (h0->count);
+	  /* ACK for previously sent data */
+	  if (!event_count0 && (h0->flags & NAT44_ED_HA_FLAG_ACK))
+	    {
+	      nat44_ed_ha_ack_recv (ha, h0->sequence_number, thread_index);
+	      b0->error = node->errors[NAT44_ED_HA_ERROR_PROCESSED];
+	      goto done0;
+	    }
+
+	  if (b0->current_length < NAT44_ED_HA_MESSAGE_HDR_LEN +
+				     event_count0 * sizeof (*e0))
+	    {
+	      b0->error = node->errors[NAT44_ED_HA_ERROR_TRUNCATED];
+	      goto done0;
+	    }
+
+	  /* not ACKed, the active retries once NAT44-ED is enabled */
+	  if (!sm->enabled)
+	    {
+	      b0->error = node->errors[NAT44_ED_HA_ERROR_DISABLED];
+	      goto done0;
+	    }
+
+	  /* process each event */
+	  e0 = (nat44_ed_ha_event_t *) (h0 + 1);
+	  while (event_count0)
+	    {
+	      nat44_ed_ha_event_process (sm, ha, e0, now, thread_index);
+	      event_count0--;
+	      e0++;
+	    }
+
+	  next0 = NAT44_ED_HA_NEXT_IP4_LOOKUP;
+	  pkts_processed++;
+
+	  /* reply with ACK */
+	  b0->current_length = NAT44_ED_HA_MESSAGE_HDR_LEN;
+
+	  src_addr0 = ip0->src_address.data_u32;
+	  dst_addr0 = ip0->dst_address.data_u32;
+	  ip0->src_address.data_u32 = dst_addr0;
+	  ip0->dst_address.data_u32 = src_addr0;
+	  old_len0 = ip0->length;
+	  ip0->length = clib_host_to_net_u16 (b0->current_length);
+
+	  sum0 = ip0->checksum;
+	  sum0 = ip_csum_update (sum0, ip0->ttl, host_config_ttl, ip4_header_t,
+				 ttl);
+	  ip0->ttl = host_config_ttl;
+	  sum0 =
+	    ip_csum_update (sum0, old_len0, ip0->length, ip4_header_t, length);
+	  ip0->checksum = ip_csum_fold (sum0);
+
+	  udp0->checksum = 0;
+	  src_port0 = udp0->src_port;
+	  dst_port0 = udp0->dst_port;
+	  udp0->src_port = dst_port0;
+	  udp0->dst_port = src_port0;
+	  udp0->length =
+	    clib_host_to_net_u16 (b0->current_length - sizeof (*ip0));
+
+	  h0->flags = NAT44_ED_HA_FLAG_ACK;
+	  h0->count = 0;
+	  vlib_increment_simple_counter (
+	    &ha->counters[NAT44_ED_HA_COUNTER_SEND_ACK], thread_index, 0, 1);
+
+	done0:
+	  if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE) &&
+			     (b0->flags & VLIB_BUFFER_IS_TRACED)))
+	    {
+	      nat44_ed_ha_trace_t *t =
+		vlib_add_trace (vm, node, b0, sizeof (*t));
+	      t->event_count = clib_net_to_host_u16 (h0->count);
+	      t->addr.as_u32 = ip0->src_address.data_u32;
+	    }
+
+	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index, to_next,
+					   n_left_to_next, bi0, next0);
+	}
+
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+
+  vlib_node_increment_counter (vm, node->node_index,
+			       NAT44_ED_HA_ERROR_PROCESSED, pkts_processed);
+
+  return frame->n_vectors;
+}
+
+VLIB_REGISTER_NODE (nat44_ed_ha_node) = {
+  .name = "nat44-ed-ha",
+  .vector_size = sizeof (u32),
+  .format_trace = format_nat44_ed_ha_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+  .n_errors = ARRAY_LEN (nat44_ed_ha_error_strings),
+  .error_strings = nat44_ed_ha_error_strings,
+  .n_next_nodes = NAT44_ED_HA_N_NEXT,
+  .next_nodes = {
+     [NAT44_ED_HA_NEXT_IP4_LOOKUP] = "ip4-lookup",
+     [NAT44_ED_HA_NEXT_DROP] = "error-drop",
+  },
+};
+
+typedef struct
+{
+  u32 next_worker_index;
+} nat44_ed_ha_handoff_trace_t;
+
+#define foreach_nat44_ed_ha_handoff_error                                     \
+  _ (CONGESTION_DROP, "congestion drop")                                      \
+  _ (SAME_WORKER, "same worker")                                              \
+  _ (DO_HANDOFF, "do handoff")
+
+typedef enum
+{
+#define _(sym, str) NAT44_ED_HA_HANDOFF_ERROR_##sym,
+  foreach_nat44_ed_ha_handoff_error
+#undef _
+    NAT44_ED_HA_HANDOFF_N_ERROR,
+} nat44_ed_ha_handoff_error_t;
+
+static char *nat44_ed_ha_handoff_error_strings[] = {
+#define _(sym, string) string,
+  foreach_nat44_ed_ha_handoff_error
+#undef _
+};
+
+static u8 *
+format_nat44_ed_ha_handoff_trace (u8 *s, va_list *args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  nat44_ed_ha_handoff_trace_t *t =
+    va_arg (*args, nat44_ed_ha_handoff_trace_t *);
+
+  s = format (s, "NAT44_ED_HA_WORKER_HANDOFF: next-worker %d",
+	      t->next_worker_index);
+
+  return s;
+}
+
+/*
+ * Messages are handled by the thread named in the header: the thread which
+ * owns the sessions on the sender, and the thread waiting for the ACK.
+ * A peer with more workers is folded onto ours.
+ */
+static_always_inline u32
+nat44_ed_ha_handoff_thread_index (snat_main_t *sm, u32 thread_index)
+{
+  if (thread_index >= sm->first_worker_index &&
+      thread_index < sm->first_worker_index + sm->num_workers)
+    return thread_index;
+  return sm->first_worker_index + thread_index % sm->num_workers;
+}
+
+/* do worker handoff based on thread_index in NAT44-ED HA protocol header */
+VLIB_NODE_FN (nat44_ed_ha_handoff_node)
+(vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *frame)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  snat_main_t *sm = &snat_main;
+  vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b;
+  u32 n_enq, n_left_from, *from;
+  u16 thread_indices[VLIB_FRAME_SIZE], *ti;
+  u32 thread_index = vm->thread_index;
+  u32 do_handoff = 0, same_worker = 0;
+
+  from = vlib_frame_vector_args (frame);
+  n_left_from = frame->n_vectors;
+  vlib_get_buffers (vm, from, bufs, n_left_from);
+
+  b = bufs;
+  ti = thread_indices;
+
+  while (n_left_from > 0)
+    {
+      nat44_ed_ha_message_header_t *h0;
+
+      h0 = vlib_buffer_get_current (b[0]);
+      ti[0] = nat44_ed_ha_handoff_thread_index (
+	sm, clib_net_to_host_u32 (h0->thread_index));
+
+      if (ti[0] != thread_index)
+	do_handoff++;
+      else
+	same_worker++;
+
+      if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE) &&
+			 (b[0]->flags & VLIB_BUFFER_IS_TRACED)))
+	{
+	  nat44_ed_ha_handoff_trace_t *t =
+	    vlib_add_trace (vm, node, b[0], sizeof (*t));
+	  t->next_worker_index = ti[0];
+	}
+
+      n_left_from -= 1;
+      ti += 1;
+      b += 1;
+    }
+
+  n_enq = vlib_buffer_enqueue_to_thread (vm, node, ha->fq_index, from,
+					 thread_indices, frame->n_vectors, 1);
+
+  if (n_enq < frame->n_vectors)
+    vlib_node_increment_counter (vm, node->node_index,
+				 NAT44_ED_HA_HANDOFF_ERROR_CONGESTION_DROP,
+				 frame->n_vectors - n_enq);
+  vlib_node_increment_counter (
+    vm, node->node_index, NAT44_ED_HA_HANDOFF_ERROR_SAME_WORKER, same_worker);
+  vlib_node_increment_counter (
+    vm, node->node_index, NAT44_ED_HA_HANDOFF_ERROR_DO_HANDOFF, do_handoff);
+  return frame->n_vectors;
+}
+
+VLIB_REGISTER_NODE (nat44_ed_ha_handoff_node) = {
+  .name = "nat44-ed-ha-handoff",
+  .vector_size = sizeof (u32),
+  .format_trace = format_nat44_ed_ha_handoff_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+  .n_errors = ARRAY_LEN (nat44_ed_ha_handoff_error_strings),
+  .error_strings = nat44_ed_ha_handoff_error_strings,
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+};
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief NAT44 endpoint-dependent active-standby HA
+ *
+ * The active node replicates session add, delete and refresh events to the
+ * standby node in batched UDP messages. Events are queued by the data plane
+ * in a ring owned by the thread of the session, and turned into messages by
+ * the per thread nat44-ed-ha-worker node. Refreshes are coalesced: a session
+ * is queued for refresh at most once per refresh interval and its counters
+ * are read when the message is built.
+ */
+
+#ifndef __included_nat44_ed_ha_h__
+#define __included_nat44_ed_ha_h__
+
+#include <vnet/vnet.h>
+#include <vnet/ip/ip.h>
+
+#include <nat/nat44-ed/nat44_ed.h>
+
+/* events queued per thread between two runs of the HA worker node */
+#define NAT44_ED_HA_RING_SIZE (4096)
+/* sessions sent by one run of the HA worker node during resync */
+#define NAT44_ED_HA_RESYNC_BATCH (256)
+
+#define foreach_nat44_ed_ha_counter                                           \
+  _ (RECV_ADD, "add-event-recv", 0)                                           \
+  _ (RECV_DEL, "del-event-recv", 1)                                           \
+  _ (RECV_REFRESH, "refresh-event-recv", 2)                                   \
+  _ (SEND_ADD, "add-event-send", 3)                                           \
+  _ (SEND_DEL, "del-event-send", 4)                                           \
+  _ (SEND_REFRESH, "refresh-event-send", 5)                                   \
+  _ (RECV_ACK, "ack-recv", 6)                                                 \
+  _ (SEND_ACK, "ack-send", 7)                                                 \
+  _ (RETRY_COUNT, "retry-count", 8)                                           \
+  _ (MISSED_COUNT, "missed-count", 9)                                         \
+  _ (RING_FULL, "ring-full", 10)                                              \
+  _ (SEND_MSG, "msg-send", 11)
+
+typedef enum
+{
+#define _(N, s, v) NAT44_ED_HA_COUNTER_##N = v,
+  foreach_nat44_ed_ha_counter
+#undef _
+    NAT44_ED_HA_N_COUNTERS
+} nat44_ed_ha_counter_t;
+
+/* NAT44-ED HA protocol event data */
+typedef CLIB_PACKED (struct {
+  /* event type */
+  u8 event_type;
+  /* IP protocol */
+  u8 protocol;
+  /* session flags */
+  u16 flags;
+  /* in2out flow: in_addr:in_port -> eh_addr:eh_port in fib_index */
+  u32 in_addr;
+  /* out2in flow: ehn_addr:ehn_port -> out_addr:out_port in out_fib_index */
+  u32 out_addr;
+  u16 in_port;
+  u16 out_port;
+  u32 eh_addr;
+  u32 ehn_addr;
+  u16 eh_port;
+  u16 ehn_port;
+  u32 fib_index;
+  u32 out_fib_index;
+  u32 total_pkts;
+  u64 total_bytes;
+  /* TCP session state */
+  u8 state;
+  u8 reserved[3];
+}) nat44_ed_ha_event_t;
+
+STATIC_ASSERT_SIZEOF (nat44_ed_ha_event_t, 52);
+
+/* message waiting for ACK */
+typedef struct
+{
+  /* sequence number */
+  u32 seq;
+  /* retry count */
+  u32 retry_count;
+  /* next retry time */
+  f64 retry_timer;
+  /* 1 if the message carries resync events */
+  u8 is_resync;
+  /* packet data */
+  u8 *data;
+} nat44_ed_ha_resend_entry_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
+  /* events queued by the data plane, head and tail are free running */
+  nat44_ed_ha_event_t *ring;
+  u32 ring_head;
+  u32 ring_tail;
+
+  /* sessions with a refresh pending, see nat44_ed_ha_sref */
+  u32 *refresh_sessions;
+
+  /* message under construction */
+  vlib_buffer_t *state_sync_buffer;
+  u16 state_sync_count;
+  u8 state_sync_is_resync;
+  /* messages ready to be sent */
+  vlib_frame_t *state_sync_frame;
+
+  /* messages waiting for ACK */
+  nat44_ed_ha_resend_entry_t *resend_queue;
+
+  /* next session to send during resync, ~0 if none */
+  u32 resync_index;
+} nat44_ed_ha_per_thread_data_t;
+
+typedef void (*nat44_ed_ha_resync_event_cb_t) (u32 client_index, u32 pid,
+					       u32 missed_count);
+
+typedef struct
+{
+  /* local IP address and UDP port */
+  ip4_address_t src_ip_address;
+  u16 src_port;
+  /* failover IP address and UDP port, sync is off while dst_port is 0 */
+  ip4_address_t dst_ip_address;
+  u16 dst_port;
+  /* path MTU between local and failover */
+  u32 state_sync_path_mtu;
+  /* events fitting in one message */
+  u32 state_sync_max_events;
+  /* number of seconds after which to send session counters refresh */
+  u32 session_refresh_interval;
+
+  vlib_simple_counter_main_t counters[NAT44_ED_HA_N_COUNTERS];
+
+  /* sequence number counter */
+  u32 sequence_number;
+
+  /* 1 if resync in progress */
+  u8 in_resync;
+  /* threads still walking their sessions for resync */
+  u32 resync_threads_pending;
+  /* resync messages not ACKed yet */
+  u32 resync_ack_count;
+  /* resync messages never ACKed */
+  u32 resync_ack_missed;
+  nat44_ed_ha_resync_event_cb_t event_callback;
+  u32 client_index;
+  u32 pid;
+
+  nat44_ed_ha_per_thread_data_t *per_thread_data;
+
+  /* worker handoff frame-queue index */
+  u32 fq_index;
+} nat44_ed_ha_main_t;
+
+extern nat44_ed_ha_main_t nat44_ed_ha_main;
+extern vlib_node_registration_t nat44_ed_ha_worker_node;
+
+/**
+ * @brief Initialize NAT44-ED HA
+ */
+void nat44_ed_ha_init (vlib_main_t *vm);
+
+/**
+ * @brief Stop sending HA events and drop the queued ones
+ */
+void nat44_ed_ha_disable ();
+
+/**
+ * @brief Set HA listener (local settings)
+ *
+ * @param addr local IP4 address
+ * @param port local UDP port number, 0 to stop listening
+ * @param path_mtu path MTU between local and failover
+ *
+ * @returns 0 on success, non-zero value otherwise.
+ */
+int nat44_ed_ha_set_listener (vlib_main_t *vm, ip4_address_t *addr, u16 port,
+			      u32 path_mtu);
+
+/**
+ * @brief Get HA listener/local configuration
+ */
+void nat44_ed_ha_get_listener (ip4_address_t *addr, u16 *port,
+			       u32 *path_mtu);
+
+/**
+ * @brief Set HA failover (remote settings)
+ *
+ * Setting a new failover starts a resync, so that a standby joining late
+ * learns the sessions which already exist.
+ *
+ * @param addr failover IP4 address
+ * @param port failover UDP port number, 0 to stop sending
+ * @param session_refresh_interval number of seconds after which to send
+ *                                 session counters refresh
+ *
+ * @returns 0 on success, non-zero value otherwise.
+ */
+int nat44_ed_ha_set_failover (vlib_main_t *vm, ip4_address_t *addr, u16 port,
+			      u32 session_refresh_interval);
+
+/**
+ * @brief Get HA failover/remote settings
+ */
+void nat44_ed_ha_get_failover (ip4_address_t *addr, u16 *port,
+			       u32 *session_refresh_interval);
+
+/**
+ * @brief Send the queued HA events now (for testing)
+ */
+void nat44_ed_ha_flush ();
+
+/**
+ * @brief Resync HA (resend existing sessions to the failover)
+ *
+ * @returns 0 on success, VNET_API_ERROR_BUSY if a resync is running,
+ *          VNET_API_ERROR_INVALID_VALUE if no failover is set
+ */
+int nat44_ed_ha_resync (u32 client_index, u32 pid,
+			nat44_ed_ha_resync_event_cb_t event_callback);
+
+/**
+ * @brief Get resync status
+ *
+ * @param in_resync 1 if resync in progress
+ * @param resync_ack_missed number of missed (not ACKed) messages
+ */
+void nat44_ed_ha_get_resync_status (u8 *in_resync, u32 *resync_ack_missed);
+
+/**
+ * @brief Queue session add HA event
+ */
+void nat44_ed_ha_sadd (snat_main_t *sm, snat_session_t *s, u32 thread_index);
+
+/**
+ * @brief Queue session delete HA event
+ */
+void nat44_ed_ha_sdel (snat_main_t *sm, snat_session_t *s, u32 thread_index);
+
+/**
+ * @brief Queue session refresh HA event
+ *
+ * Called for every packet of the session, only the first call after the
+ * refresh interval queues the session. The event itself is built by the HA
+ * worker node, with the counters current at that time.
+ */
+static_always_inline void
+nat44_ed_ha_sref (snat_main_t *sm, snat_session_t *s, u32 thread_index,
+		  f64 now)
+{
+  nat44_ed_ha_main_t *ha = &nat44_ed_ha_main;
+  snat_main_per_thread_data_t *tsm;
+
+  if (PREDICT_TRUE (!ha->dst_port))
+    return;
+
+  if (s->flags & SNAT_SESSION_FLAG_HA_REFRESH ||
+      s->ha_last_refreshed + ha->session_refresh_interval > now)
+    return;
+
+  tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+  s->flags |= SNAT_SESSION_FLAG_HA_REFRESH;
+  vec_add1 (ha->per_thread_data[thread_index].refresh_sessions,
+	    s - tsm->sessions);
+}
+
+#endif /* __included_nat44_ed_ha_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
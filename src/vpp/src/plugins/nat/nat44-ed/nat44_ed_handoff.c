@@ -79,9 +79,13 @@ nat44_worker_handoff_fn_inline (vlib_main_t * vm,
 
   u16 thread_indices[VLIB_FRAME_SIZE], *ti = thread_indices;
   vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b = bufs;
+  u32 local[VLIB_FRAME_SIZE], remote[VLIB_FRAME_SIZE];
+  u16 remote_thread_indices[VLIB_FRAME_SIZE];
   snat_main_t *sm = &snat_main;
+  nat44_ed_handoff_counters_t *hc;
 
-  u32 fq_index, thread_index = vm->thread_index;
+  u32 fq_index, next_index, thread_index = vm->thread_index;
+  u32 i, n_local = 0, n_remote = 0;
 
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
@@ -91,10 +95,13 @@ nat44_worker_handoff_fn_inline (vlib_main_t * vm,
   if (is_in2out)
     {
       fq_index = is_output ? sm->fq_in2out_output_index : sm->fq_in2out_index;
+      next_index = is_output ? NAT_NEXT_IN2OUT_ED_OUTPUT_FAST_PATH :
+				     NAT_NEXT_IN2OUT_ED_FAST_PATH;
     }
   else
     {
       fq_index = sm->fq_out2in_index;
+      next_index = NAT_NEXT_OUT2IN_ED_FAST_PATH;
     }
 
   while (n_left_from >= 4)
@@ -246,7 +253,6 @@ nat44_worker_handoff_fn_inline (vlib_main_t * vm,
 
   if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)))
     {
-      u32 i;
       b = bufs;
       ti = thread_indices;
 
@@ -269,20 +275,51 @@ nat44_worker_handoff_fn_inline (vlib_main_t * vm,
 	}
     }
 
-  n_enq = vlib_buffer_enqueue_to_thread (vm, node, fq_index, from,
-					 thread_indices, frame->n_vectors, 1);
+  /* packets of sessions owned by this thread skip the frame queue */
+  for (i = 0; i < frame->n_vectors; i++)
+    {
+      if (thread_indices[i] == thread_index)
+	local[n_local++] = from[i];
+      else
+	{
+	  remote[n_remote] = from[i];
+	  remote_thread_indices[n_remote++] = thread_indices[i];
+	}
+    }
+
+  if (n_local)
+    vlib_buffer_enqueue_to_single_next (vm, node, local, next_index, n_local);
 
-  if (n_enq < frame->n_vectors)
+  n_enq = n_remote;
+  if (n_remote)
+    n_enq = vlib_buffer_enqueue_to_thread (vm, node, fq_index, remote,
+					   remote_thread_indices, n_remote, 1);
+
+  if (n_enq < n_remote)
     {
       vlib_node_increment_counter (vm, node->node_index,
 				   NAT44_HANDOFF_ERROR_CONGESTION_DROP,
-				   frame->n_vectors - n_enq);
+				   n_remote - n_enq);
     }
 
   vlib_node_increment_counter (vm, node->node_index,
 			       NAT44_HANDOFF_ERROR_SAME_WORKER, same_worker);
   vlib_node_increment_counter (vm, node->node_index,
 			       NAT44_HANDOFF_ERROR_DO_HANDOFF, do_handoff);
+
+  if (is_in2out)
+    hc = is_output ? &sm->counters.handoff.in2out_output :
+			   &sm->counters.handoff.in2out;
+  else
+    hc = &sm->counters.handoff.out2in;
+
+  vlib_increment_simple_counter (&hc->same_worker, thread_index, 0,
+				 same_worker);
+  vlib_increment_simple_counter (&hc->do_handoff, thread_index, 0,
+				 do_handoff);
+  vlib_increment_simple_counter (&hc->congestion_drop, thread_index, 0,
+				 n_remote - n_enq);
+
   return frame->n_vectors;
 }
 
@@ -158,6 +158,82 @@ snat_not_translate_fast (snat_main_t *sm, vlib_node_runtime_t *node,
   return 1;
 }
 
+static_always_inline int
+nat_ed_alloc_outside_port (snat_main_t *sm, u8 proto, u32 thread_index,
+			   snat_address_t *a, nat44_ed_port_map_t *pm,
+			   snat_session_t *s, u16 port_thread_offset,
+			   u32 port_offset)
+{
+  u16 port = clib_host_to_net_u16 (port_thread_offset + port_offset);
+
+  if (IP_PROTOCOL_ICMP == proto)
+    {
+      s->o2i.match.sport = port;
+    }
+  s->o2i.match.dport = port;
+  if (nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 2))
+    return 1;
+
+  nat44_ed_port_map_take (pm, s, a - sm->addresses, port_offset);
+  return 0;
+}
+
+/* pick a free port whose return traffic the NIC sends to this thread, the
+   suggested port first */
+static_always_inline int
+nat_ed_alloc_rss_port (snat_main_t *sm, u8 proto, u32 thread_index,
+		       snat_address_t *a, nat44_ed_port_map_t *pm,
+		       snat_session_t *s, u16 port_per_thread,
+		       u16 port_thread_offset, u32 suggested_offset,
+		       u32 *port_offset)
+{
+  u32 offset, flow_hash;
+  int attempts;
+
+  flow_hash = nat44_ed_rss_flow_hash (sm, &s->o2i.match.saddr,
+				      &s->o2i.match.daddr, s->o2i.match.sport);
+
+  if (suggested_offset < port_per_thread &&
+      nat44_ed_rss_port_is_local (sm, flow_hash,
+				  port_thread_offset + suggested_offset,
+				  thread_index) &&
+      !nat_ed_alloc_outside_port (sm, proto, thread_index, a, pm, s,
+				  port_thread_offset, suggested_offset))
+    {
+      *port_offset = suggested_offset;
+      goto done;
+    }
+
+  offset = pm->cursor;
+  for (attempts = NAT44_ED_RSS_PORT_ATTEMPTS;
+       attempts > 0 && pm->n_busy < port_per_thread; attempts--)
+    {
+      offset = clib_bitmap_next_clear (pm->busy_ports, offset);
+      if (offset >= port_per_thread)
+	offset = clib_bitmap_first_clear (pm->busy_ports);
+      if (nat44_ed_rss_port_is_local (sm, flow_hash,
+				      port_thread_offset + offset,
+				      thread_index) &&
+	  !nat_ed_alloc_outside_port (sm, proto, thread_index, a, pm, s,
+				      port_thread_offset, offset))
+	{
+	  pm->cursor = offset + 1;
+	  *port_offset = offset;
+	  goto done;
+	}
+      offset++;
+    }
+
+  vlib_increment_simple_counter (&sm->counters.rss_port_missed, thread_index,
+				 0, 1);
+  return 1;
+
+done:
+  vlib_increment_simple_counter (&sm->counters.rss_port_steered, thread_index,
+				 0, 1);
+  return 0;
+}
+
 static int
 nat_ed_alloc_addr_and_port_with_snat_address (
   snat_main_t *sm, u8 proto, u32 thread_index, snat_address_t *a,
@@ -165,39 +241,53 @@ nat_ed_alloc_addr_and_port_with_snat_address (
   ip4_address_t *outside_addr, u16 *outside_port)
 {
   const u16 port_thread_offset = (port_per_thread * snat_thread_index) + 1024;
+  nat44_ed_port_map_t *pm = nat44_ed_port_map_get (a, thread_index, proto);
+  u32 port_offset;
+  int attempts;
 
   s->o2i.match.daddr = a->addr;
+  port_offset = clib_net_to_host_u16 (*outside_port) - port_thread_offset;
+
+  /* return traffic received by this thread needs no handoff */
+  if (nat44_ed_rss_is_steerable (sm, proto) &&
+      !nat_ed_alloc_rss_port (sm, proto, thread_index, a, pm, s,
+			      port_per_thread, port_thread_offset, port_offset,
+			      &port_offset))
+    goto done;
+
   /* first try port suggested by caller */
-  u16 port = clib_net_to_host_u16 (*outside_port);
-  u16 port_offset = port - port_thread_offset;
-  if (port <= port_thread_offset ||
-      port > port_thread_offset + port_per_thread)
+  if (port_offset < port_per_thread &&
+      !nat_ed_alloc_outside_port (sm, proto, thread_index, a, pm, s,
+				  port_thread_offset, port_offset))
+    goto done;
+
+  /* then ports not used by any other session of this thread */
+  for (attempts = ED_PORT_ALLOC_ATTEMPTS;
+       attempts > 0 && pm->n_busy < port_per_thread; attempts--)
     {
-      /* need to pick a different port, suggested port doesn't fit in
-       * this thread's port range */
-      port_offset = snat_random_port (0, port_per_thread - 1);
-      port = port_thread_offset + port_offset;
+      port_offset = clib_bitmap_next_clear (pm->busy_ports, pm->cursor);
+      if (port_offset >= port_per_thread)
+	port_offset = clib_bitmap_first_clear (pm->busy_ports);
+      pm->cursor = port_offset + 1;
+      if (!nat_ed_alloc_outside_port (sm, proto, thread_index, a, pm, s,
+				      port_thread_offset, port_offset))
+	goto done;
     }
-  u16 attempts = ED_PORT_ALLOC_ATTEMPTS;
-  do
+
+  /* all ports are taken, share them between different destinations */
+  for (attempts = ED_PORT_ALLOC_ATTEMPTS; attempts > 0; attempts--)
     {
-      if (IP_PROTOCOL_ICMP == proto)
-	{
-	  s->o2i.match.sport = clib_host_to_net_u16 (port);
-	}
-      s->o2i.match.dport = clib_host_to_net_u16 (port);
-      if (0 == nat_ed_ses_o2i_flow_hash_add_del (sm, thread_index, s, 2))
-	{
-	  *outside_addr = a->addr;
-	  *outside_port = clib_host_to_net_u16 (port);
-	  return 0;
-	}
       port_offset = snat_random_port (0, port_per_thread - 1);
-      port = port_thread_offset + port_offset;
-      --attempts;
+      if (!nat_ed_alloc_outside_port (sm, proto, thread_index, a, pm, s,
+				      port_thread_offset, port_offset))
+	goto done;
     }
-  while (attempts > 0);
   return 1;
+
+done:
+  *outside_addr = a->addr;
+  *outside_port = clib_host_to_net_u16 (port_thread_offset + port_offset);
+  return 0;
 }
 
 static int
@@ -582,6 +672,8 @@ slow_path_ed (vlib_main_t *vm, snat_main_t *sm, vlib_buffer_t *b,
 
   per_vrf_sessions_register_session (s, thread_index);
 
+  nat44_ed_ha_sadd (sm, s, thread_index);
+
   *sessionp = s;
   return next;
 error:
@@ -607,7 +699,7 @@ nat44_ed_not_translate (vlib_main_t *vm, snat_main_t *sm,
 	     ip->protocol);
 
   /* NAT packet aimed at external address if has active sessions */
-  if (clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (nat44_ed_flow_hash_search (sm, &kv, &value))
     {
       /* or is static mappings */
       ip4_address_t placeholder_addr;
@@ -664,7 +756,7 @@ nat_not_translate_output_feature_fwd (snat_main_t * sm, ip4_header_t * ip,
 		 ip->protocol);
     }
 
-  if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (!nat44_ed_flow_hash_search (sm, &kv, &value))
     {
       ASSERT (thread_index == ed_value_get_thread_index (&value));
       s =
@@ -709,7 +801,7 @@ nat44_ed_not_translate_output_feature (snat_main_t *sm, vlib_buffer_t *b,
   /* src NAT check */
   init_ed_k (&kv, ip->src_address.as_u32, src_port, ip->dst_address.as_u32,
 	     dst_port, tx_fib_index, ip->protocol);
-  if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (!nat44_ed_flow_hash_search (sm, &kv, &value))
     {
       ASSERT (thread_index == ed_value_get_thread_index (&value));
       s =
@@ -747,7 +839,7 @@ nat44_ed_not_translate_output_feature (snat_main_t *sm, vlib_buffer_t *b,
 
   init_ed_k (&kv, ip->dst_address.as_u32, dst_port, ip->src_address.as_u32,
 	     src_port, rx_fib_index, ip->protocol);
-  if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (!nat44_ed_flow_hash_search (sm, &kv, &value))
     {
       ASSERT (thread_index == ed_value_get_thread_index (&value));
       s =
@@ -910,7 +1002,7 @@ nat44_ed_in2out_slowpath_unknown_proto (snat_main_t *sm, vlib_buffer_t *b,
 	      init_ed_k (&s_kv, s->out2in.addr.as_u32, 0,
 			 ip->dst_address.as_u32, 0, outside_fib_index,
 			 ip->protocol);
-	      if (clib_bihash_search_16_8 (&sm->flow_hash, &s_kv, &s_value))
+	      if (nat44_ed_flow_hash_search (sm, &s_kv, &s_value))
 		{
 		  new_src_addr = s->out2in.addr;
 		}
@@ -925,7 +1017,7 @@ nat44_ed_in2out_slowpath_unknown_proto (snat_main_t *sm, vlib_buffer_t *b,
 	      init_ed_k (&s_kv, sm->addresses[i].addr.as_u32, 0,
 			 ip->dst_address.as_u32, 0, outside_fib_index,
 			 ip->protocol);
-	      if (clib_bihash_search_16_8 (&sm->flow_hash, &s_kv, &s_value))
+	      if (nat44_ed_flow_hash_search (sm, &s_kv, &s_value))
 		{
 		  new_src_addr = sm->addresses[i].addr;
 		}
@@ -1148,7 +1240,7 @@ nat44_ed_in2out_fast_path_node_fn_inline (vlib_main_t *vm,
 		 lookup.dport, lookup.fib_index, lookup.proto);
 
       // lookup flow
-      if (clib_bihash_search_16_8 (&sm->flow_hash, &kv0, &value0))
+      if (nat44_ed_flow_hash_search (sm, &kv0, &value0))
 	{
 	  // flow does not exist go slow path
 	  next[0] = def_slow;
@@ -1420,7 +1512,7 @@ nat44_ed_in2out_slow_path_node_fn_inline (vlib_main_t *vm,
 	&kv0, ip0->src_address.as_u32, vnet_buffer (b0)->ip.reass.l4_src_port,
 	ip0->dst_address.as_u32, vnet_buffer (b0)->ip.reass.l4_dst_port,
 	rx_fib_index0, ip0->protocol);
-      if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv0, &value0))
+      if (!nat44_ed_flow_hash_search (sm, &kv0, &value0))
 	{
 	  ASSERT (thread_index == ed_value_get_thread_index (&value0));
 	  s0 =
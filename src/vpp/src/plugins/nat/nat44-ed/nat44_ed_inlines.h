@@ -25,6 +25,7 @@
 
 #include <nat/lib/log.h>
 #include <nat/nat44-ed/nat44_ed.h>
+#include <nat/nat44-ed/nat44_ed_ha.h>
 
 always_inline void
 init_ed_k (clib_bihash_kv_16_8_t *kv, u32 l_addr, u16 l_port, u32 r_addr,
@@ -84,6 +85,57 @@ ed_value_get_session_index (clib_bihash_kv_16_8_t *value)
   return value->value & ~(u32) 0;
 }
 
+/** \brief Search the session flow hash.
+
+    While the table is being resized a flow is in one of the two tables.
+    Migration adds a flow to the new table before deleting it from the old
+    one, so checking the new table again after a miss in the old one can
+    not lose a flow which is being moved.
+*/
+always_inline int
+nat44_ed_flow_hash_search (snat_main_t *sm, clib_bihash_kv_16_8_t *kv,
+			   clib_bihash_kv_16_8_t *value)
+{
+  if (PREDICT_TRUE (!clib_bihash_search_16_8 (&sm->flow_hash, kv, value)))
+    return 0;
+  if (PREDICT_TRUE (!sm->flow_hash_old))
+    return -1;
+  if (!clib_bihash_search_16_8 (sm->flow_hash_old, kv, value))
+    return 0;
+  return clib_bihash_search_16_8 (&sm->flow_hash, kv, value);
+}
+
+/** \brief Add or delete a flow hash entry, is_add as for bihash add_del.
+    New entries always go to the current table.
+*/
+always_inline int
+nat44_ed_flow_hash_add_del (snat_main_t *sm, clib_bihash_kv_16_8_t *kv,
+			    int is_add)
+{
+  clib_bihash_kv_16_8_t value;
+  int rv;
+
+  if (PREDICT_TRUE (!sm->flow_hash_old))
+    return clib_bihash_add_del_16_8 (&sm->flow_hash, kv, is_add);
+
+  if (!is_add)
+    {
+      if (!clib_bihash_add_del_16_8 (&sm->flow_hash, kv, 0))
+	return 0;
+      return clib_bihash_add_del_16_8 (sm->flow_hash_old, kv, 0);
+    }
+
+  if (is_add == 2 && !clib_bihash_search_16_8 (sm->flow_hash_old, kv, &value))
+    return -2;
+
+  rv = clib_bihash_add_del_16_8 (&sm->flow_hash, kv, is_add);
+  /* overwritten entry not moved yet */
+  if (!rv && is_add == 1 &&
+      !clib_bihash_search_16_8 (sm->flow_hash_old, kv, &value))
+    clib_bihash_add_del_16_8 (sm->flow_hash_old, kv, 0);
+  return rv;
+}
+
 always_inline void
 split_ed_kv (clib_bihash_kv_16_8_t *kv, ip4_address_t *l_addr,
 	     ip4_address_t *r_addr, u8 *proto, u32 *fib_index, u16 *l_port,
@@ -196,6 +248,69 @@ nat44_session_get_timeout (snat_main_t *sm, snat_session_t *s)
   return 0;
 }
 
+/** \brief Time a session times out at, with the timeouts configured now.
+    @param sm  NAT main
+    @param s   NAT session
+*/
+always_inline f64
+nat44_ed_session_expire_time (snat_main_t *sm, snat_session_t *s)
+{
+  f64 t = s->last_heard + (f64) nat44_session_get_timeout (sm, s);
+
+  if (s->tcp_closed_timestamp && s->tcp_closed_timestamp < t)
+    t = s->tcp_closed_timestamp;
+  return t;
+}
+
+always_inline int
+nat44_ed_session_timer_is_armed (snat_main_per_thread_data_t *tsm,
+				 snat_session_t *s)
+{
+  tw_timer_wheel_1t_3w_1024sl_ov_t *tw = &tsm->expire_wheel;
+  u32 h = s->expire_timer_handle;
+
+  /* the handle of an expired timer may have been reused by another
+   * session already */
+  return (!pool_is_free_index (tw->timers, h) &&
+	  pool_elt_at_index (tw->timers, h)->user_handle ==
+	    s - tsm->sessions);
+}
+
+always_inline void
+nat44_ed_session_timer_start (snat_main_per_thread_data_t *tsm,
+			      snat_session_t *s, f64 now, f64 expire)
+{
+  u64 ticks = expire > now ? (u64) (expire - now) + 1 : 1;
+
+  s->expire_timer_handle = tw_timer_start_1t_3w_1024sl_ov (
+    &tsm->expire_wheel, s - tsm->sessions, 0, ticks);
+  s->expire_timer_time = expire;
+}
+
+/** \brief Pull the expiry timer of a session in after its timeout got
+    shorter. Longer timeouts are picked up when the timer fires.
+    @param sm   NAT main
+    @param tsm  per thread data
+    @param s    NAT session
+    @param now  current time
+*/
+always_inline void
+nat44_ed_session_timer_update (snat_main_t *sm,
+			       snat_main_per_thread_data_t *tsm,
+			       snat_session_t *s, f64 now)
+{
+  f64 expire = nat44_ed_session_expire_time (sm, s);
+
+  if (expire + 1 >= s->expire_timer_time ||
+      !nat44_ed_session_timer_is_armed (tsm, s))
+    return;
+
+  tw_timer_update_1t_3w_1024sl_ov (
+    &tsm->expire_wheel, s->expire_timer_handle,
+    expire > now ? (u64) (expire - now) + 1 : 1);
+  s->expire_timer_time = expire;
+}
+
 static_always_inline u8
 nat44_ed_maximum_sessions_exceeded (snat_main_t *sm, u32 fib_index,
 				    u32 thread_index)
@@ -269,7 +384,7 @@ nat_ed_ses_i2o_flow_hash_add_del (snat_main_t *sm, u32 thread_idx,
     }
 
   ASSERT (thread_idx == s->thread_index);
-  return clib_bihash_add_del_16_8 (&sm->flow_hash, &kv, is_add);
+  return nat44_ed_flow_hash_add_del (sm, &kv, is_add);
 }
 
 static_always_inline int
@@ -298,7 +413,128 @@ nat_ed_ses_o2i_flow_hash_add_del (snat_main_t *sm, u32 thread_idx,
       nat_6t_l3_l4_csum_calc (&s->o2i);
     }
   ASSERT (thread_idx == s->thread_index);
-  return clib_bihash_add_del_16_8 (&sm->flow_hash, &kv, is_add);
+  return nat44_ed_flow_hash_add_del (sm, &kv, is_add);
+}
+
+always_inline nat44_ed_port_map_t *
+nat44_ed_port_map_get (snat_address_t *a, u32 thread_index,
+		       ip_protocol_t proto)
+{
+  nat44_ed_port_map_type_t t;
+
+  switch (proto)
+    {
+    case IP_PROTOCOL_TCP:
+      t = NAT44_ED_PORT_MAP_TCP;
+      break;
+    case IP_PROTOCOL_UDP:
+      t = NAT44_ED_PORT_MAP_UDP;
+      break;
+    case IP_PROTOCOL_ICMP:
+      t = NAT44_ED_PORT_MAP_ICMP;
+      break;
+    default:
+      t = NAT44_ED_PORT_MAP_OTHER;
+      break;
+    }
+  return vec_elt_at_index (a->port_maps,
+			   thread_index * NAT44_ED_N_PORT_MAPS + t);
+}
+
+/** \brief Whether outside ports of this protocol are picked by RSS.
+    The NIC hashes only the addresses of protocols without ports.
+*/
+always_inline int
+nat44_ed_rss_is_steerable (snat_main_t *sm, ip_protocol_t proto)
+{
+  return (sm->rss.sw_if_index != ~0 &&
+	  (proto == IP_PROTOCOL_TCP || proto == IP_PROTOCOL_UDP));
+}
+
+/** \brief RSS hash of a return flow, without its outside port part.
+    @param sm            NAT main
+    @param ext_addr      external host address
+    @param out_addr      outside address
+    @param ext_port      external host port (network byte order)
+*/
+always_inline u32
+nat44_ed_rss_flow_hash (snat_main_t *sm, ip4_address_t *ext_addr,
+			ip4_address_t *out_addr, u16 ext_port)
+{
+  /* the hash may step data back 3 bytes for its masked loads, keep the
+   * tuple off the start of the buffer */
+  u8 buf[16] = { 0 }, *data = buf + 4;
+
+  /* tuple as hashed by the NIC: saddr, daddr, sport, dport */
+  clib_memcpy_fast (data, ext_addr, 4);
+  clib_memcpy_fast (data + 4, out_addr, 4);
+  clib_memcpy_fast (data + 8, &ext_port, 2);
+  return clib_toeplitz_hash (sm->rss.key, data, 12);
+}
+
+/** \brief Whether return traffic to an outside port is received by a thread.
+    @param sm            NAT main
+    @param flow_hash     value returned by nat44_ed_rss_flow_hash
+    @param port          outside port (host byte order)
+    @param thread_index  thread index
+*/
+always_inline int
+nat44_ed_rss_port_is_local (snat_main_t *sm, u32 flow_hash, u16 port,
+			    u32 thread_index)
+{
+  nat44_ed_rss_t *rss = &sm->rss;
+  u32 i = (flow_hash ^ rss->port_hash[port]) & rss->reta_mask;
+
+  return rss->reta_thread[i] == thread_index;
+}
+
+/** \brief Take a reference on an outside port for a session.
+    @param pm            port map of the address, thread and protocol
+    @param s             NAT session
+    @param addr_index    index of the address in sm->addresses
+    @param port_offset   port offset in the thread's range
+*/
+always_inline void
+nat44_ed_port_map_take (nat44_ed_port_map_t *pm, snat_session_t *s,
+			u32 addr_index, u32 port_offset)
+{
+  if (pm->refs[port_offset]++ == 0)
+    {
+      clib_bitmap_set_no_check (pm->busy_ports, port_offset, 1);
+      pm->n_busy++;
+    }
+  s->port_map_addr_index = addr_index;
+  s->flags |= SNAT_SESSION_FLAG_PORT_MAP;
+}
+
+/** \brief Drop the reference of a session on its outside port, which goes
+    back to the free set with the last one.
+    @param sm            NAT main
+    @param s             NAT session
+    @param thread_index  thread index the session belongs to
+*/
+always_inline void
+nat44_ed_port_map_release (snat_main_t *sm, snat_session_t *s,
+			   u32 thread_index)
+{
+  snat_main_per_thread_data_t *tsm =
+    vec_elt_at_index (sm->per_thread_data, thread_index);
+  snat_address_t *a =
+    vec_elt_at_index (sm->addresses, s->port_map_addr_index);
+  nat44_ed_port_map_t *pm = nat44_ed_port_map_get (a, thread_index, s->proto);
+  u32 port_offset;
+
+  port_offset = clib_net_to_host_u16 (s->out2in.port) - 1024 -
+		sm->port_per_thread * tsm->snat_thread_index;
+  ASSERT (a->addr.as_u32 == s->out2in.addr.as_u32);
+  ASSERT (port_offset < sm->port_per_thread && pm->refs[port_offset]);
+
+  if (--pm->refs[port_offset] == 0)
+    {
+      clib_bitmap_set_no_check (pm->busy_ports, port_offset, 0);
+      pm->n_busy--;
+    }
+  s->flags &= ~SNAT_SESSION_FLAG_PORT_MAP;
 }
 
 always_inline void
@@ -309,6 +545,13 @@ nat_ed_session_delete (snat_main_t *sm, snat_session_t *ses, u32 thread_index,
   snat_main_per_thread_data_t *tsm =
     vec_elt_at_index (sm->per_thread_data, thread_index);
 
+  if (ses->flags & SNAT_SESSION_FLAG_PORT_MAP)
+    nat44_ed_port_map_release (sm, ses, thread_index);
+
+  if (nat44_ed_session_timer_is_armed (tsm, ses))
+    tw_timer_stop_1t_3w_1024sl_ov (&tsm->expire_wheel,
+				   ses->expire_timer_handle);
+
   if (lru_delete)
     {
       clib_dlist_remove (tsm->lru_pool, ses->lru_index);
@@ -381,13 +624,16 @@ nat_ed_session_alloc (snat_main_t *sm, u32 thread_index, f64 now, u8 proto)
   snat_session_t *s;
   snat_main_per_thread_data_t *tsm = &sm->per_thread_data[thread_index];
 
-  nat_lru_free_one (sm, thread_index, now);
-
   pool_get (tsm->sessions, s);
   clib_memset (s, 0, sizeof (*s));
 
   nat_ed_lru_insert (tsm, s, now, proto);
 
+  s->proto = proto;
+  s->last_heard = now;
+  nat44_ed_session_timer_start (tsm, s, now,
+				nat44_ed_session_expire_time (sm, s));
+
   s->ha_last_refreshed = now;
   vlib_set_simple_counter (&sm->total_sessions, thread_index, 0,
 			   pool_elts (tsm->sessions));
@@ -746,6 +992,7 @@ nat44_set_tcp_session_state_i2o (snat_main_t *sm, f64 now, snat_session_t *ses,
     }
   clib_dlist_remove (tsm->lru_pool, ses->lru_index);
   clib_dlist_addtail (tsm->lru_pool, ses->lru_head_index, ses->lru_index);
+  nat44_ed_session_timer_update (sm, tsm, ses, now);
 }
 
 always_inline void
@@ -789,6 +1036,7 @@ nat44_set_tcp_session_state_o2i (snat_main_t *sm, f64 now, snat_session_t *ses,
     }
   clib_dlist_remove (tsm->lru_pool, ses->lru_index);
   clib_dlist_addtail (tsm->lru_pool, ses->lru_head_index, ses->lru_index);
+  nat44_ed_session_timer_update (sm, tsm, ses, now);
 }
 
 always_inline void
@@ -798,6 +1046,7 @@ nat44_session_update_counters (snat_session_t *s, f64 now, uword bytes,
   s->last_heard = now;
   s->total_pkts++;
   s->total_bytes += bytes;
+  nat44_ed_ha_sref (&snat_main, s, thread_index, now);
 }
 
 /** \brief Per-user LRU list maintenance */
@@ -128,7 +128,7 @@ next_src_nat (snat_main_t *sm, ip4_header_t *ip, u16 src_port, u16 dst_port,
 
   init_ed_k (&kv, ip->src_address.as_u32, src_port, ip->dst_address.as_u32,
 	     dst_port, rx_fib_index, ip->protocol);
-  if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (!nat44_ed_flow_hash_search (sm, &kv, &value))
     return 1;
 
   return 0;
@@ -549,6 +549,8 @@ create_session_for_static_mapping_ed (
 
   per_vrf_sessions_register_session (s, thread_index);
 
+  nat44_ed_ha_sadd (sm, s, thread_index);
+
   return s;
 }
 
@@ -591,7 +593,7 @@ create_bypass_for_fwd (snat_main_t *sm, vlib_buffer_t *b, snat_session_t *s,
   init_ed_k (&kv, lookup_saddr.as_u32, lookup_sport, lookup_daddr.as_u32,
 	     lookup_dport, rx_fib_index, lookup_protocol);
 
-  if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv, &value))
+  if (!nat44_ed_flow_hash_search (sm, &kv, &value))
     {
       ASSERT (thread_index == ed_value_get_thread_index (&value));
       s =
@@ -858,7 +860,7 @@ nat44_ed_out2in_fast_path_node_fn_inline (vlib_main_t * vm,
 		 lookup.dport, lookup.fib_index, lookup.proto);
 
       // lookup flow
-      if (clib_bihash_search_16_8 (&sm->flow_hash, &kv0, &value0))
+      if (nat44_ed_flow_hash_search (sm, &kv0, &value0))
 	{
 	  // flow does not exist go slow path
 	  slow_path_reason = NAT_ED_SP_REASON_LOOKUP_FAILED;
@@ -1164,7 +1166,7 @@ nat44_ed_out2in_slow_path_node_fn_inline (vlib_main_t * vm,
 	rx_fib_index0, ip0->protocol);
 
       s0 = NULL;
-      if (!clib_bihash_search_16_8 (&sm->flow_hash, &kv0, &value0))
+      if (!nat44_ed_flow_hash_search (sm, &kv0, &value0))
 	{
 	  ASSERT (thread_index == ed_value_get_thread_index (&value0));
 	  s0 =
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief NAT44-ED RSS-aware outside port selection
+ *
+ * Return traffic of a session is received on the outside interface by the
+ * rx queue which the NIC selects from the Toeplitz hash of the IPv4 4-tuple
+ * (ext_addr, out_addr, ext_port, out_port). When the session was created by
+ * another thread, the out2in worker handoff node has to move every return
+ * packet to it. Knowing the key and the redirection table of the NIC, the
+ * allocating thread can compute that hash for each candidate outside port
+ * and pick one that brings return traffic straight back to it.
+ *
+ * The Toeplitz hash is linear over XOR, so the contribution of the outside
+ * port is computed once per port here and combined with the hash of the
+ * rest of the tuple at allocation time. The redirection table is assumed to
+ * be the usual default of the drivers, i.e. entry i pointing to rx queue
+ * (i modulo number of rx queues).
+ */
+
+#include <vnet/flow/flow.h>
+#include <vnet/interface/rx_queue_funcs.h>
+
+#include <nat/lib/log.h>
+#include <nat/nat44-ed/nat44_ed.h>
+
+static void
+nat44_ed_rss_free (nat44_ed_rss_t *rss)
+{
+  if (rss->key)
+    clib_toeplitz_hash_key_free (rss->key);
+  vec_free (rss->reta_thread);
+  vec_free (rss->port_hash);
+  rss->key = 0;
+  rss->reta_mask = 0;
+  rss->flow_index = ~0;
+  rss->sw_if_index = ~0;
+}
+
+int
+nat44_ed_rss_disable ()
+{
+  snat_main_t *sm = &snat_main;
+  nat44_ed_rss_t *rss = &sm->rss;
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_hw_interface_t *hw;
+
+  if (rss->sw_if_index == ~0)
+    return VNET_API_ERROR_FEATURE_DISABLED;
+
+  if (rss->flow_index != ~0)
+    {
+      if (vnet_sw_interface_is_valid (vnm, rss->sw_if_index))
+	{
+	  hw = vnet_get_sup_hw_interface (vnm, rss->sw_if_index);
+	  vnet_flow_disable (vnm, rss->flow_index, hw->hw_if_index);
+	}
+      vnet_flow_del (vnm, rss->flow_index);
+    }
+
+  nat44_ed_rss_free (rss);
+  return 0;
+}
+
+static int
+nat44_ed_rss_add_flow (vnet_main_t *vnm, u32 hw_if_index, u32 *flow_index)
+{
+  vnet_flow_t flow = {
+    .type = VNET_FLOW_TYPE_IP4,
+    .actions = VNET_FLOW_ACTION_RSS,
+    .rss_fun = VNET_RSS_FUNC_TOEPLITZ,
+    .rss_types = (1ULL << VNET_FLOW_RSS_TYPES_IPV4_TCP) |
+		 (1ULL << VNET_FLOW_RSS_TYPES_IPV4_UDP),
+  };
+  int rv;
+
+  /* all address and protocol masks zero, i.e. match any IPv4 packet */
+  rv = vnet_flow_add (vnm, &flow, flow_index);
+  if (rv)
+    return rv;
+
+  rv = vnet_flow_enable (vnm, *flow_index, hw_if_index);
+  if (rv)
+    {
+      vnet_flow_del (vnm, *flow_index);
+      *flow_index = ~0;
+    }
+  return rv;
+}
+
+int
+nat44_ed_rss_enable (u32 sw_if_index, u8 *key, u32 reta_size,
+		     u8 program_flow)
+{
+  snat_main_t *sm = &snat_main;
+  nat44_ed_rss_t *rss = &sm->rss;
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_hw_interface_t *hw;
+  u32 i, n_rx_queues, flow_index = ~0;
+  u8 data[12] = { 0 };
+  int rv;
+
+  if (!vnet_sw_interface_is_valid (vnm, sw_if_index))
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  if (!reta_size || reta_size > (1 << 16) || !is_pow2 (reta_size))
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  /* the key must cover the 12 byte IPv4 4-tuple */
+  if (key && vec_len (key) < sizeof (data) + 4)
+    return VNET_API_ERROR_INVALID_VALUE_2;
+
+  hw = vnet_get_sup_hw_interface (vnm, sw_if_index);
+  n_rx_queues = vec_len (hw->rx_queue_indices);
+  if (!n_rx_queues)
+    return VNET_API_ERROR_UNSUPPORTED;
+
+  if (rss->sw_if_index != ~0)
+    nat44_ed_rss_disable ();
+
+  if (program_flow)
+    {
+      rv = nat44_ed_rss_add_flow (vnm, hw->hw_if_index, &flow_index);
+      if (rv)
+	{
+	  nat_log_err ("failed to program RSS on %U: error %d",
+		       format_vnet_sw_if_index_name, vnm, sw_if_index, rv);
+	  return VNET_API_ERROR_UNSUPPORTED;
+	}
+    }
+
+  rss->key = clib_toeplitz_hash_key_init (key, vec_len (key));
+  rss->reta_mask = reta_size - 1;
+
+  vec_validate (rss->reta_thread, rss->reta_mask);
+  for (i = 0; i < reta_size; i++)
+    rss->reta_thread[i] = vnet_hw_if_get_rx_queue_thread_index (
+      vnm, hw->rx_queue_indices[i % n_rx_queues]);
+
+  /* hash of (0.0.0.0, 0.0.0.0, 0, port), the part of the return flow hash
+     which depends on the outside port only */
+  vec_validate (rss->port_hash, 0xffff);
+  for (i = 0; i <= 0xffff; i++)
+    {
+      *(u16 *) (data + 10) = clib_host_to_net_u16 (i);
+      rss->port_hash[i] = clib_toeplitz_hash (rss->key, data, sizeof (data));
+    }
+
+  rss->flow_index = flow_index;
+  rss->sw_if_index = sw_if_index;
+  return 0;
+}
+
+u8 *
+format_nat44_ed_rss (u8 *s, va_list *args)
+{
+  snat_main_t *sm = va_arg (*args, snat_main_t *);
+  nat44_ed_rss_t *rss = &sm->rss;
+  vnet_main_t *vnm = vnet_get_main ();
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u32 indent = format_get_indent (s);
+  u32 i, *n_entries = 0;
+
+  if (rss->sw_if_index == ~0)
+    return format (s, "disabled");
+
+  s = format (s, "outside interface %U, key length %u, reta size %u",
+	      format_vnet_sw_if_index_name, vnm, rss->sw_if_index,
+	      rss->key->key_length, rss->reta_mask + 1);
+  if (rss->flow_index != ~0)
+    s = format (s, ", flow %u", rss->flow_index);
+
+  vec_validate (n_entries, tm->n_vlib_mains - 1);
+  vec_foreach_index (i, rss->reta_thread)
+    n_entries[rss->reta_thread[i]]++;
+
+  vec_foreach_index (i, n_entries)
+    if (n_entries[i])
+      s = format (s, "\n%Uthread %u: %u reta entries", format_white_space,
+		  indent + 2, i, n_entries[i]);
+
+  vec_free (n_entries);
+  return s;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
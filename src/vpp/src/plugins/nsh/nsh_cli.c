@@ -141,7 +141,7 @@ nsh_get_adj_by_sw_if_index (u32 sw_if_index)
   adj_index_t ai = ~0;
 
   /* *INDENT-OFF* */
-  pool_foreach_index (ai, adj_pool)
+  chunk_pool_foreach_index (ai, &adj_pool)
    {
       if (sw_if_index == adj_get_sw_if_index(ai))
       {
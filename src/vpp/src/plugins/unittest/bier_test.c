@@ -202,7 +202,7 @@ bier_test_mpls_spf (void)
     int res;
 
     res = 0;
-    lb_count = pool_elts(load_balance_pool);
+    lb_count = chunk_pool_elts(&load_balance_pool);
     tm = &test_main;
 #define N_BIER_ECMP_TABLES 16
     int ii;
@@ -705,7 +705,7 @@ bier_test_mpls_spf (void)
     fib_table_entry_delete(0, &pfx_1_1_1_2_s_32, FIB_SOURCE_API);
 
     /* +1 to account for the one time alloc'd drop LB in the MPLS fibs */
-    BIER_TEST(lb_count+1 == pool_elts(load_balance_pool),
+    BIER_TEST(lb_count+1 == chunk_pool_elts(&load_balance_pool),
               "Load-balance resources freed ");
     BIER_TEST((0 == adj_nbr_db_size()), "ADJ DB size is %d",
              adj_nbr_db_size());
@@ -150,3 +150,23 @@ UNITTEST_REGISTER_CRYPTO_TEST (chacha20_poly1305_tc3) = {
 };
 /* *INDENT-ON* */
 
+
+/* *INDENT-OFF* */
+UNITTEST_REGISTER_CRYPTO_TEST (chacha20_poly1305_inc_1024) = {
+  .name = "CHACHA20-POLY1305 (incr 1024 B)",
+  .alg = VNET_CRYPTO_ALG_CHACHA20_POLY1305,
+  .plaintext_incremental = 1024,
+  .key.length = 32,
+  .aad.length = 12,
+  .tag.length = 16,
+};
+
+UNITTEST_REGISTER_CRYPTO_TEST (chacha20_poly1305_inc_1009) = {
+  .name = "CHACHA20-POLY1305 (incr 1009 B)",
+  .alg = VNET_CRYPTO_ALG_CHACHA20_POLY1305,
+  .plaintext_incremental = 1024 - 15,
+  .key.length = 32,
+  .aad.length = 8,
+  .tag.length = 16,
+};
+/* *INDENT-ON* */
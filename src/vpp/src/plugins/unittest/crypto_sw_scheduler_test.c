@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2020 Intel and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Scalability benchmark of the scheduler. Each benchmark thread plays a
+ * worker with its own queues, the first ones enqueue frames like the
+ * ipsec nodes would and all of them process and steal frames. The crypto
+ * work is replaced by spinning for a number of clocks, so what does not
+ * scale with the number of threads is the scheduler.
+ */
+
+#include <pthread.h>
+#include <vlib/vlib.h>
+
+#include <crypto_sw_scheduler/crypto_sw_scheduler.h>
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  vnet_crypto_async_frame_t *frames;
+  u32 *free_frames;
+  /* per frame sequence number within its SA */
+  u32 *frame_seq;
+  u32 *next_seq_by_sa;
+  u32 *expected_seq_by_sa;
+  u32 n_sent;
+  u32 n_done;
+  u64 n_order_errors;
+  u64 busy_clocks;
+} crypto_sw_scheduler_perf_thread_t;
+
+typedef struct
+{
+  crypto_sw_scheduler_per_thread_data_t *ptd;
+  crypto_sw_scheduler_perf_thread_t *threads;
+  u32 n_workers;
+  u32 n_producers;
+  u32 n_frames;
+  u32 n_elts;
+  u32 n_sas;
+  u32 n_numa_nodes;
+  u32 cost;
+  u32 slow_every;
+  u32 slow_factor;
+  volatile u32 thread_barrier;
+  volatile u32 threads_running;
+  volatile u32 producers_running;
+} crypto_sw_scheduler_perf_main_t;
+
+static crypto_sw_scheduler_perf_main_t crypto_sw_scheduler_perf_main;
+
+static void
+crypto_sw_scheduler_perf_enqueue (crypto_sw_scheduler_perf_main_t *pm,
+				  crypto_sw_scheduler_perf_thread_t *pt,
+				  crypto_sw_scheduler_queue_t *q)
+{
+  while (pt->n_sent < pm->n_frames && vec_len (pt->free_frames))
+    {
+      u32 fi = vec_pop (pt->free_frames);
+      vnet_crypto_async_frame_t *f = pt->frames + fi;
+      u32 sa = pt->n_sent % pm->n_sas, i, cost;
+
+      cost = pm->cost * f->n_elts;
+      if (pm->slow_every && (pt->n_sent % pm->slow_every) == 0)
+	cost *= pm->slow_factor;
+
+      for (i = 0; i < f->n_elts; i++)
+	f->elts[i].key_index = sa;
+      /* the synthetic frames carry their cost in clocks */
+      f->elts[0].crypto_total_length = cost;
+      f->state = VNET_CRYPTO_FRAME_STATE_PENDING;
+      pt->frame_seq[fi] = pt->next_seq_by_sa[sa];
+
+      if (crypto_sw_scheduler_queue_push (q, f))
+	{
+	  vec_add1 (pt->free_frames, fi);
+	  break;
+	}
+
+      pt->next_seq_by_sa[sa]++;
+      pt->n_sent++;
+    }
+}
+
+static void
+crypto_sw_scheduler_perf_return (crypto_sw_scheduler_perf_thread_t *pt,
+				 crypto_sw_scheduler_per_thread_data_t *ptd,
+				 crypto_sw_scheduler_queue_t *q)
+{
+  vnet_crypto_async_frame_t *f;
+  u8 is_out_of_order;
+
+  while ((f = crypto_sw_scheduler_queue_pop (q, &is_out_of_order)))
+    {
+      u32 fi = f - pt->frames, sa = f->elts[0].key_index;
+
+      ptd->n_out_of_order += is_out_of_order;
+      if (pt->frame_seq[fi] != pt->expected_seq_by_sa[sa]++)
+	pt->n_order_errors++;
+
+      vec_add1 (pt->free_frames, fi);
+      pt->n_done++;
+    }
+}
+
+static void *
+crypto_sw_scheduler_perf_thread_fn (void *arg)
+{
+  crypto_sw_scheduler_perf_main_t *pm = &crypto_sw_scheduler_perf_main;
+  u32 thread_index = (uword) arg;
+  crypto_sw_scheduler_perf_thread_t *pt = pm->threads + thread_index;
+  crypto_sw_scheduler_per_thread_data_t *ptd = pm->ptd + thread_index;
+  crypto_sw_scheduler_queue_t *q =
+    &ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT];
+  u8 is_producer = thread_index < pm->n_producers;
+
+  while (pm->thread_barrier)
+    CLIB_PAUSE ();
+
+  while (1)
+    {
+      vnet_crypto_async_frame_t *f;
+
+      if (is_producer)
+	crypto_sw_scheduler_perf_enqueue (pm, pt, q);
+
+      f = crypto_sw_scheduler_get_frame (pm->ptd, ptd);
+      if (f)
+	{
+	  u64 cost = f->elts[0].crypto_total_length;
+	  u64 end = clib_cpu_time_now () + cost;
+
+	  while (clib_cpu_time_now () < end)
+	    ;
+	  pt->busy_clocks += cost;
+	  CLIB_MEMORY_STORE_BARRIER ();
+	  f->state = VNET_CRYPTO_FRAME_STATE_SUCCESS;
+	}
+
+      if (is_producer)
+	{
+	  crypto_sw_scheduler_perf_return (pt, ptd, q);
+	  if (pt->n_done == pm->n_frames)
+	    {
+	      /* keep helping the others */
+	      is_producer = 0;
+	      __atomic_sub_fetch (&pm->producers_running, 1, __ATOMIC_RELEASE);
+	    }
+	}
+      else if (pm->producers_running == 0)
+	break;
+    }
+
+  __atomic_sub_fetch (&pm->threads_running, 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static clib_error_t *
+crypto_sw_scheduler_perf_run (vlib_main_t *vm,
+			      crypto_sw_scheduler_perf_main_t *pm)
+{
+  crypto_sw_scheduler_per_thread_data_t *ptd;
+  crypto_sw_scheduler_perf_thread_t *pt;
+  clib_error_t *error = 0;
+  u32 *numa_by_thread = 0;
+  u64 n_claimed = 0, n_stolen = 0, n_steals = 0, n_out_of_order = 0;
+  u64 n_order_errors = 0, busy_clocks = 0, start, clocks;
+  u32 i, j, n_started = 0;
+  f64 seconds;
+
+  vec_validate_aligned (pm->ptd, pm->n_workers - 1, CLIB_CACHE_LINE_BYTES);
+  vec_validate_aligned (pm->threads, pm->n_workers - 1,
+			CLIB_CACHE_LINE_BYTES);
+
+  for (i = 0; i < pm->n_workers; i++)
+    vec_add1 (numa_by_thread, i * pm->n_numa_nodes / pm->n_workers);
+
+  for (i = 0; i < pm->n_workers; i++)
+    {
+      ptd = pm->ptd + i;
+      pt = pm->threads + i;
+
+      ptd->self_crypto_enabled = 1;
+      crypto_sw_scheduler_queue_init (
+	&ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT]);
+      crypto_sw_scheduler_queue_init (
+	&ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT]);
+      ptd->steal_order =
+	crypto_sw_scheduler_steal_order (i, pm->n_workers, numa_by_thread);
+
+      if (i >= pm->n_producers)
+	continue;
+
+      vec_validate_aligned (pt->frames, CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      vec_validate (pt->frame_seq, CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1);
+      vec_validate (pt->next_seq_by_sa, pm->n_sas - 1);
+      vec_validate (pt->expected_seq_by_sa, pm->n_sas - 1);
+      for (j = 0; j < CRYPTO_SW_SCHEDULER_QUEUE_SIZE; j++)
+	{
+	  pt->frames[j].n_elts = pm->n_elts;
+	  vec_add1 (pt->free_frames, CRYPTO_SW_SCHEDULER_QUEUE_SIZE - 1 - j);
+	}
+    }
+
+  pm->thread_barrier = 1;
+
+  for (i = 0; i < pm->n_workers; i++)
+    {
+      pthread_t handle;
+      int rv;
+
+      rv = pthread_create (&handle, NULL, crypto_sw_scheduler_perf_thread_fn,
+			   (void *) (uword) i);
+      if (rv)
+	{
+	  error = clib_error_return_unix (0, "pthread_create");
+	  break;
+	}
+      pthread_detach (handle);
+      n_started++;
+    }
+
+  /* the producers started still process all their frames */
+  pm->producers_running = clib_min (n_started, pm->n_producers);
+  pm->threads_running = n_started;
+  CLIB_MEMORY_BARRIER ();
+
+  start = clib_cpu_time_now ();
+  pm->thread_barrier = 0;
+
+  while (pm->threads_running > 0)
+    CLIB_PAUSE ();
+
+  clocks = clib_cpu_time_now () - start;
+  seconds = (f64) clocks / vm->clib_time.clocks_per_second;
+
+  for (i = 0; i < pm->n_workers; i++)
+    {
+      ptd = pm->ptd + i;
+      pt = pm->threads + i;
+
+      n_claimed += ptd->n_claimed;
+      n_stolen += ptd->n_stolen;
+      n_steals += ptd->n_steals;
+      n_out_of_order += ptd->n_out_of_order;
+      n_order_errors += pt->n_order_errors;
+      busy_clocks += pt->busy_clocks;
+
+      crypto_sw_scheduler_queue_free (
+	&ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_ENCRYPT]);
+      crypto_sw_scheduler_queue_free (
+	&ptd->queue[CRYPTO_SW_SCHED_QUEUE_TYPE_DECRYPT]);
+      vec_free (ptd->steal_order);
+      vec_free (pt->frames);
+      vec_free (pt->free_frames);
+      vec_free (pt->frame_seq);
+      vec_free (pt->next_seq_by_sa);
+      vec_free (pt->expected_seq_by_sa);
+    }
+  vec_free (pm->ptd);
+  vec_free (pm->threads);
+  vec_free (numa_by_thread);
+
+  if (error)
+    return error;
+
+  vlib_cli_output (
+    vm, "%-8u%-12.3f%-12.3f%-12.1f%-12lu%-12lu%-12lu%-12lu", pm->n_workers,
+    seconds, (f64) pm->n_producers * pm->n_frames / seconds * 1e-6,
+    100.0 * busy_clocks / ((f64) clocks * pm->n_workers), n_claimed, n_stolen,
+    n_steals, n_out_of_order);
+
+  if (n_order_errors)
+    return clib_error_return (0, "%lu frames returned out of SA order",
+			      n_order_errors);
+  return 0;
+}
+
+static clib_error_t *
+crypto_sw_scheduler_perf_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				     vlib_cli_command_t *cmd)
+{
+  crypto_sw_scheduler_perf_main_t *pm = &crypto_sw_scheduler_perf_main;
+  clib_error_t *error = 0;
+  u32 n_workers = 2, max_workers = 0, n_producers = 0;
+
+  pm->n_frames = 10000;
+  pm->n_elts = 32;
+  pm->n_sas = 16;
+  pm->n_numa_nodes = 1;
+  pm->cost = 1000;
+  pm->slow_every = 0;
+  pm->slow_factor = 10;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "workers %u", &n_workers))
+	;
+      else if (unformat (input, "max-workers %u", &max_workers))
+	;
+      else if (unformat (input, "producers %u", &n_producers))
+	;
+      else if (unformat (input, "frames %u", &pm->n_frames))
+	;
+      else if (unformat (input, "elts %u", &pm->n_elts))
+	;
+      else if (unformat (input, "sas %u", &pm->n_sas))
+	;
+      else if (unformat (input, "numa-nodes %u", &pm->n_numa_nodes))
+	;
+      else if (unformat (input, "cost %u", &pm->cost))
+	;
+      else if (unformat (input, "slow-every %u", &pm->slow_every))
+	;
+      else if (unformat (input, "slow-factor %u", &pm->slow_factor))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (max_workers < n_workers)
+    max_workers = n_workers;
+
+  if (n_workers == 0 || pm->n_frames == 0 || pm->n_sas == 0 ||
+      pm->n_numa_nodes == 0)
+    return clib_error_return (0, "workers, frames, sas and numa-nodes "
+				 "must not be zero");
+
+  if (pm->n_elts == 0 || pm->n_elts > VNET_CRYPTO_FRAME_SIZE)
+    return clib_error_return (0, "elts must be between 1 and %u",
+			      VNET_CRYPTO_FRAME_SIZE);
+
+  vlib_cli_output (vm, "%-8s%-12s%-12s%-12s%-12s%-12s%-12s%-12s", "Workers",
+		   "Seconds", "Mframes/s", "Busy %", "Claimed", "Stolen",
+		   "Steals", "OutOfOrder");
+
+  /* double the number of workers up to max-workers */
+  for (pm->n_workers = n_workers; pm->n_workers <= max_workers;
+       pm->n_workers *= 2)
+    {
+      pm->n_producers = n_producers ? clib_min (n_producers, pm->n_workers) :
+				      pm->n_workers;
+      error = crypto_sw_scheduler_perf_run (vm, pm);
+      if (error)
+	break;
+    }
+
+  return error;
+}
+
+/*?
+ * Measures how the sw_scheduler scales with the number of workers. The
+ * workers are emulated by threads with their own queues, the first
+ * <producers> of them enqueue <frames> frames each, and the processing
+ * of an element is replaced by spinning <cost> clocks. Every <slow-every>
+ * frame is <slow-factor> times more expensive. The number of workers
+ * doubles from <workers> to <max-workers>. Busy % is the share of the
+ * clocks spent on the emulated crypto work.
+ *
+ * @cliexpar
+ * Example of how to measure the scalability from 2 to 32 workers:
+ * @cliexstart{test sw_scheduler perf workers 2 max-workers 32}
+ * @cliexend
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_test_sw_scheduler_perf, static) = {
+  .path = "test sw_scheduler perf",
+  .short_help = "test sw_scheduler perf [workers <n>] [max-workers <n>] "
+		"[producers <n>] [frames <n>] [elts <n>] [sas <n>] "
+		"[numa-nodes <n>] [cost <clocks>] [slow-every <n>] "
+		"[slow-factor <n>]",
+  .function = crypto_sw_scheduler_perf_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
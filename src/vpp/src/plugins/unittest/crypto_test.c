@@ -861,11 +861,37 @@ test_crypto_perf (vlib_main_t * vm, crypto_test_main_t * tm)
   int buffer_size = vlib_buffer_get_default_data_size (vm);
   u64 seed = clib_cpu_time_now ();
   u64 t0[5], t1[5], t2[5], n_bytes = 0;
+  vnet_crypto_ops_handler_t *saved_handlers[VNET_CRYPTO_OP_N_TYPES] = { };
   int i, j;
 
   if (tm->buffer_size > buffer_size)
     return clib_error_return (0, "buffer size must be <= %u", buffer_size);
 
+  if (tm->engine)
+    {
+      /* measure the given engine regardless of the active handlers */
+      uword *p = hash_get_mem (cm->engine_index_by_name, tm->engine);
+      vnet_crypto_engine_t *ce;
+
+      if (!p)
+	return clib_error_return (0, "unknown engine '%s'", tm->engine);
+
+      ce = vec_elt_at_index (cm->engines, p[0]);
+      for (i = 0; i < VNET_CRYPTO_OP_N_TYPES; i++)
+	if (ad->op_by_type[i] && ce->ops_handlers[ad->op_by_type[i]] == 0)
+	  return clib_error_return (0, "engine '%s' doesn't support %U",
+				    tm->engine, format_vnet_crypto_alg,
+				    tm->alg);
+
+      for (i = 0; i < VNET_CRYPTO_OP_N_TYPES; i++)
+	if (ad->op_by_type[i])
+	  {
+	    saved_handlers[i] = cm->ops_handlers[ad->op_by_type[i]];
+	    cm->ops_handlers[ad->op_by_type[i]] =
+	      ce->ops_handlers[ad->op_by_type[i]];
+	  }
+    }
+
   rounds = tm->rounds ? tm->rounds : 100;
   n_buffers = tm->n_buffers ? tm->n_buffers : 256;
   buffer_size = tm->buffer_size ? tm->buffer_size : 2048;
@@ -893,6 +919,8 @@ test_crypto_perf (vlib_main_t * vm, crypto_test_main_t * tm)
 		   rounds, warmup_rounds);
   vlib_cli_output (vm, "   cpu-freq %.2f GHz",
 		   (f64) vm->clib_time.clocks_per_second * 1e-9);
+  if (tm->engine)
+    vlib_cli_output (vm, "   engine %s", tm->engine);
 
   vnet_crypto_op_type_t ot = 0;
 
@@ -1009,6 +1037,10 @@ test_crypto_perf (vlib_main_t * vm, crypto_test_main_t * tm)
     }
 
 done:
+  for (i = 0; i < VNET_CRYPTO_OP_N_TYPES; i++)
+    if (saved_handlers[i])
+      cm->ops_handlers[ad->op_by_type[i]] = saved_handlers[i];
+
   if (n_alloc)
     vlib_buffer_free (vm, buffer_indices, n_alloc);
 
@@ -1027,6 +1059,7 @@ test_crypto_command_fn (vlib_main_t * vm,
 {
   crypto_test_main_t *tm = &crypto_test_main;
   unittest_crypto_test_registration_t *tr;
+  clib_error_t *err;
   int is_perf = 0;
 
   tr = tm->test_registrations;
@@ -1051,22 +1084,35 @@ test_crypto_command_fn (vlib_main_t * vm,
 	;
       else if (unformat (input, "buffer-size %u", &tm->buffer_size))
 	;
+      else if (unformat (input, "engine %s", &tm->engine))
+	;
       else
-	return clib_error_return (0, "unknown input '%U'",
-				  format_unformat_error, input);
+	{
+	  vec_free (tm->engine);
+	  return clib_error_return (0, "unknown input '%U'",
+				    format_unformat_error, input);
+	}
     }
 
+  if (tm->engine)
+    vec_add1 (tm->engine, 0);
+
   if (is_perf)
-    return test_crypto_perf (vm, tm);
+    err = test_crypto_perf (vm, tm);
   else
-    return test_crypto (vm, tm);
+    err = test_crypto (vm, tm);
+
+  vec_free (tm->engine);
+  return err;
 }
 
 /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (test_crypto_command, static) =
 {
   .path = "test crypto",
-  .short_help = "test crypto",
+  .short_help = "test crypto [verbose|detail] [perf <alg> [engine <name>] "
+		"[buffers <n>] [rounds <n>] [warmup-rounds <n>] "
+		"[buffer-size <n>]]",
   .function = test_crypto_command_fn,
 };
 /* *INDENT-ON* */
@@ -806,13 +806,13 @@ fib_test_v4 (void)
         .ip4.as_u32 = clib_host_to_net_u32(0x0a0a0a02),
     };
 
-    FIB_TEST((0 == pool_elts(load_balance_map_pool)), "LB-map pool size is %d",
-             pool_elts(load_balance_map_pool));
+    FIB_TEST((0 == chunk_pool_elts(&load_balance_map_pool)), "LB-map pool size is %d",
+             chunk_pool_elts(&load_balance_map_pool));
 
     tm = &test_main;
 
     /* record the nubmer of load-balances in use before we start */
-    lb_count = pool_elts(load_balance_pool);
+    lb_count = chunk_pool_elts(&load_balance_pool);
 
     /* Find or create FIB table 11 */
     fib_index = fib_table_find_or_create_and_lock(FIB_PROTOCOL_IP4, 11,
@@ -4399,12 +4399,12 @@ fib_test_v4 (void)
              fib_path_list_pool_size());
     FIB_TEST((ENBR-5 == fib_entry_pool_size()), "entry pool size is %d",
              fib_entry_pool_size());
-    FIB_TEST((ENBR-5 == pool_elts(fib_urpf_list_pool)), "uRPF pool size is %d",
-             pool_elts(fib_urpf_list_pool));
-    FIB_TEST((0 == pool_elts(load_balance_map_pool)), "LB-map pool size is %d",
-             pool_elts(load_balance_map_pool));
-    FIB_TEST((lb_count == pool_elts(load_balance_pool)), "LB pool size is %d",
-             pool_elts(load_balance_pool));
+    FIB_TEST((ENBR-5 == chunk_pool_elts(&fib_urpf_list_pool)), "uRPF pool size is %d",
+             chunk_pool_elts(&fib_urpf_list_pool));
+    FIB_TEST((0 == chunk_pool_elts(&load_balance_map_pool)), "LB-map pool size is %d",
+             chunk_pool_elts(&load_balance_map_pool));
+    FIB_TEST((lb_count == chunk_pool_elts(&load_balance_pool)), "LB pool size is %d",
+             chunk_pool_elts(&load_balance_pool));
     FIB_TEST((0 == pool_elts(dvr_dpo_pool)), "L2 DPO pool size is %d",
              pool_elts(dvr_dpo_pool));
 
@@ -6368,7 +6368,7 @@ fib_test_label (void)
     test_main_t *tm;
 
     res = 0;
-    lb_count = pool_elts(load_balance_pool);
+    lb_count = chunk_pool_elts(&load_balance_pool);
     tm = &test_main;
 
     /*
@@ -7544,9 +7544,9 @@ fib_test_label (void)
     /*
      * +1 for the drop LB in the MPLS tables.
      */
-    FIB_TEST(lb_count+1 == pool_elts(load_balance_pool),
+    FIB_TEST(lb_count+1 == chunk_pool_elts(&load_balance_pool),
              "Load-balance resources freed %d of %d",
-             lb_count+1, pool_elts(load_balance_pool));
+             lb_count+1, chunk_pool_elts(&load_balance_pool));
 
     return (res);
 }
@@ -8546,7 +8546,7 @@ lfib_test (void)
 
     res = 0;
     tm = &test_main;
-    lb_count = pool_elts(load_balance_pool);
+    lb_count = chunk_pool_elts(&load_balance_pool);
 
     FIB_TEST((0 == adj_nbr_db_size()), "ADJ DB size is %d",
              adj_nbr_db_size());
@@ -9134,9 +9134,9 @@ lfib_test (void)
     FIB_TEST(0 == pool_elts(mpls_disp_dpo_pool),
 	     "mpls_disp_dpo resources freed %d of %d",
              0, pool_elts(mpls_disp_dpo_pool));
-    FIB_TEST(lb_count == pool_elts(load_balance_pool),
+    FIB_TEST(lb_count == chunk_pool_elts(&load_balance_pool),
              "Load-balance resources freed %d of %d",
-             lb_count, pool_elts(load_balance_pool));
+             lb_count, chunk_pool_elts(&load_balance_pool));
     FIB_TEST(0 == pool_elts(interface_rx_dpo_pool),
              "interface_rx_dpo resources freed %d of %d",
              0, pool_elts(interface_rx_dpo_pool));
@@ -9907,9 +9907,9 @@ fib_test_inherit (void)
              "%U via interposer adj",
              format_fib_prefix,&pfx_11_11_11_11_s_32);
 
-    FIB_TEST(3 == pool_elts(mpls_label_dpo_pool),
+    FIB_TEST(3 == chunk_pool_elts(&mpls_label_dpo_pool),
              "MPLS label pool: %d",
-             pool_elts(mpls_label_dpo_pool));
+             chunk_pool_elts(&mpls_label_dpo_pool));
 
     fib_table_entry_delete(0, &pfx_11_11_11_11_s_32, FIB_SOURCE_API);
 
@@ -10083,9 +10083,9 @@ fib_test_inherit (void)
     /*          "%U via interposer label 99", */
     /*          format_fib_prefix,&pfx_11_11_11_11_s_32); */
 
-    /* FIB_TEST(3 == pool_elts(mpls_label_dpo_pool), */
+    /* FIB_TEST(3 == chunk_pool_elts(&mpls_label_dpo_pool), */
     /*          "MPLS label pool: %d", */
-    /*          pool_elts(mpls_label_dpo_pool)); */
+    /*          chunk_pool_elts(&mpls_label_dpo_pool)); */
     /* FIB_TEST((2 == mpls_label_dpo_get(interposer.dpoi_index)->mld_locks), */
     /*          "Interposer %d locks", */
     /*          mpls_label_dpo_get(interposer.dpoi_index)->mld_locks); */
@@ -10111,9 +10111,9 @@ fib_test_inherit (void)
     /* FIB_TEST((1 == mpls_label_dpo_get(interposer.dpoi_index)->mld_locks), */
     /*          "Interposer %d locks", */
     /*          mpls_label_dpo_get(interposer.dpoi_index)->mld_locks); */
-    /* FIB_TEST(2 == pool_elts(mpls_label_dpo_pool), */
+    /* FIB_TEST(2 == chunk_pool_elts(&mpls_label_dpo_pool), */
     /*          "MPLS label pool: %d", */
-    /*          pool_elts(mpls_label_dpo_pool)); */
+    /*          chunk_pool_elts(&mpls_label_dpo_pool)); */
 
     /* fei = fib_table_entry_special_dpo_add(0, */
     /*                                       &pfx_11_11_11_11_s_32, */
@@ -10242,9 +10242,9 @@ fib_test_inherit (void)
     adj_unlock(ai_10_10_10_3);
     dpo_reset(&interposer);
     dpo_reset(&interposer2);
-    FIB_TEST(0 == pool_elts(mpls_label_dpo_pool),
+    FIB_TEST(0 == chunk_pool_elts(&mpls_label_dpo_pool),
              "MPLS label pool empty: %d",
-             pool_elts(mpls_label_dpo_pool));
+             chunk_pool_elts(&mpls_label_dpo_pool));
     FIB_TEST(0 == adj_nbr_db_size(), "All adjacencies removed");
     FIB_TEST(N_PLS == fib_path_list_pool_size(),
              "number of path-lists: %d = %d",
@@ -10461,7 +10461,7 @@ fib_test_sticky (void)
     fib_test_lb_bucket_t buckets[N_PATHS];
     bfd_session_t bfds[N_PATHS] = {{0}};
 
-    lb_count = pool_elts(load_balance_pool);
+    lb_count = chunk_pool_elts(&load_balance_pool);
     pl_count = fib_path_list_pool_size();
 
     for (ii = 0; ii < N_PATHS; ii++)
@@ -10765,7 +10765,7 @@ fib_test_sticky (void)
     vec_free(r_paths2);
     vec_free(r_paths3);
 
-    FIB_TEST(lb_count == pool_elts(load_balance_pool), "no leaked LBs");
+    FIB_TEST(lb_count == chunk_pool_elts(&load_balance_pool), "no leaked LBs");
     FIB_TEST(pl_count == fib_path_list_pool_size(), "no leaked PLs");
 
     return 0;
@@ -15,6 +15,8 @@
 
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/ipsec_sa.h>
+#include <vnet/ipsec/ipsec_input.h>
+#include <vnet/ethernet/ethernet.h>
 
 static clib_error_t *
 test_ipsec_command_fn (vlib_main_t * vm,
@@ -67,6 +69,206 @@ VLIB_CLI_COMMAND (test_ipsec_command, static) =
 };
 /* *INDENT-ON* */
 
+static int
+test_ipsec_bypass_policy (vlib_main_t *vm, u32 spd_id, u32 i, int is_add)
+{
+  ipsec_policy_t policy;
+  u32 stat_index;
+
+  /* inbound bypass of anything from 10.0.0.<i> */
+  clib_memset (&policy, 0, sizeof (policy));
+  policy.id = spd_id;
+  policy.priority = i;
+  policy.policy = IPSEC_POLICY_ACTION_BYPASS;
+  ipsec_policy_mk_type (0, 0, policy.policy, &policy.type);
+  policy.laddr.stop.ip4.as_u32 = ~0;
+  policy.raddr.start.ip4.as_u32 = clib_host_to_net_u32 (0x0a000000 + i);
+  policy.raddr.stop.ip4.as_u32 = policy.raddr.start.ip4.as_u32;
+  policy.lport.stop = policy.rport.stop = ~0;
+
+  return ipsec_add_del_policy (vm, &policy, is_add, &stat_index);
+}
+
+/*
+ * Benchmark of the ipsec4-input-feature classification loop: n_policies
+ * inbound bypass policies, one per source address, and n_flows distinct
+ * flows spread over them. Runs on a loopback with the SPD bound, so each
+ * packet goes through the same feature arc steps as in the node. The x1
+ * loop is the node's tail loop, which shares the staged classification
+ * with the x4 loop; it is not the code the quad loop replaced.
+ */
+static clib_error_t *
+test_ipsec_input_perf (vlib_main_t *vm, u32 n_policies, u32 n_flows,
+		       u32 n_buffers, u32 rounds)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ip4_main_t *i4m = &ip4_main;
+  u8 arc = i4m->lookup_main.ucast_feature_arc_index;
+  u32 spd_id = 0x7fffffff, sw_if_index = ~0;
+  u32 *buffers = 0, *config_index = 0;
+  u8 mac[6] = { 0 };
+  vlib_buffer_t **bufs = 0;
+  u16 *nexts = 0;
+  ipsec_input_counters_t cnt;
+  vlib_node_runtime_t *rt;
+  clib_error_t *err = 0;
+  vlib_node_t *node;
+  u64 t0, ticks[2] = { 0, 0 };
+  u32 i, j, k, n_alloc = 0, n_added = 0;
+  int rv, quad;
+
+  node = vlib_get_node_by_name (vm, (u8 *) "ipsec4-input-feature");
+  rt = vlib_node_get_runtime (vm, node->index);
+
+  if ((rv = vnet_create_loopback_interface (&sw_if_index, mac, 0, 0)))
+    return clib_error_return (0, "loopback create failed: %d", rv);
+  ip4_sw_interface_enable_disable (sw_if_index, 1);
+
+  if ((rv = ipsec_add_del_spd (vm, spd_id, 1)))
+    {
+      err = clib_error_return (0, "spd add failed: %d", rv);
+      goto done;
+    }
+  ipsec_set_interface_spd (vm, sw_if_index, spd_id, 1);
+
+  for (i = 0; i < n_policies; i++)
+    {
+      if ((rv = test_ipsec_bypass_policy (vm, spd_id, i, 1)))
+	{
+	  err = clib_error_return (0, "policy add failed: %d", rv);
+	  goto done;
+	}
+      n_added++;
+    }
+
+  vec_validate (buffers, n_buffers - 1);
+  vec_validate (config_index, n_buffers - 1);
+  vec_validate (bufs, n_buffers - 1);
+  vec_validate (nexts, n_buffers - 1);
+
+  n_alloc = vlib_buffer_alloc (vm, buffers, n_buffers);
+  if (n_alloc != n_buffers)
+    {
+      err = clib_error_return (0, "buffer alloc failure");
+      goto done;
+    }
+  vlib_get_buffers (vm, buffers, bufs, n_buffers);
+
+  for (j = 0; j < n_buffers; j++)
+    {
+      vlib_buffer_t *b = bufs[j];
+      ip4_header_t *ip;
+      esp_header_t *esp;
+      u32 flow = j % n_flows, next;
+
+      b->current_data = 0;
+      ip = vlib_buffer_get_current (b);
+      esp = (esp_header_t *) (ip + 1);
+      clib_memset (ip, 0, sizeof (*ip) + sizeof (*esp));
+      ip->ip_version_and_header_length = 0x45;
+      ip->ttl = 64;
+      ip->protocol = IP_PROTOCOL_IPSEC_ESP;
+      ip->length = clib_host_to_net_u16 (sizeof (*ip) + sizeof (*esp));
+      ip->src_address.as_u32 =
+	clib_host_to_net_u32 (0x0a000000 + flow % n_policies);
+      ip->dst_address.as_u32 = clib_host_to_net_u32 (0xc0a80000 + flow);
+      esp->spi = clib_host_to_net_u32 (0x1000 + flow);
+      b->current_length = sizeof (*ip) + sizeof (*esp);
+
+      vnet_buffer (b)->sw_if_index[VLIB_RX] = sw_if_index;
+      vnet_feature_arc_start (arc, sw_if_index, &next, b);
+      config_index[j] = b->current_config_index;
+    }
+
+  vlib_cli_output (vm,
+		   "ipsec4-input: %u policies, %u flows, %u buffers, "
+		   "%u rounds, flow-cache %s, fast-path %s",
+		   n_policies, n_flows, n_buffers, rounds,
+		   im->input_flow_cache_flag ? "on" : "off",
+		   im->input_fp_flag ? "on" : "off");
+
+  /*
+   * One round of each loop for warmup, then the measured ones. The loops
+   * take turns so that both see the same machine, and the best round of
+   * each is kept.
+   */
+  for (k = 0; k < rounds + 1; k++)
+    for (quad = 0; quad < 2; quad++)
+      {
+	for (j = 0; j < n_buffers; j++)
+	  bufs[j]->current_config_index = config_index[j];
+
+	clib_memset (&cnt, 0, sizeof (cnt));
+	t0 = clib_cpu_time_now ();
+	for (j = 0; j < n_buffers; j += VLIB_FRAME_SIZE)
+	  ipsec4_input_inline (vm, rt, bufs + j, nexts + j,
+			       clib_min (VLIB_FRAME_SIZE, n_buffers - j),
+			       &cnt, quad);
+	t0 = clib_cpu_time_now () - t0;
+	if (k && (!ticks[quad] || t0 < ticks[quad]))
+	  ticks[quad] = t0;
+      }
+
+  if (cnt.bypassed != n_buffers)
+    err = clib_error_return (0, "%lu of %u packets bypassed", cnt.bypassed,
+			     n_buffers);
+
+  vlib_cli_output (vm, "  x1 loop: %.2f cycles/packet",
+		   (f64) ticks[0] / n_buffers);
+  vlib_cli_output (vm, "  x4 loop: %.2f cycles/packet",
+		   (f64) ticks[1] / n_buffers);
+
+done:
+  for (i = 0; i < n_added; i++)
+    test_ipsec_bypass_policy (vm, spd_id, i, 0);
+  if (n_alloc)
+    vlib_buffer_free (vm, buffers, n_alloc);
+  ipsec_set_interface_spd (vm, sw_if_index, spd_id, 0);
+  ipsec_add_del_spd (vm, spd_id, 0);
+  ip4_sw_interface_enable_disable (sw_if_index, 0);
+  vnet_delete_loopback_interface (sw_if_index);
+
+  vec_free (buffers);
+  vec_free (config_index);
+  vec_free (bufs);
+  vec_free (nexts);
+  return err;
+}
+
+static clib_error_t *
+test_ipsec_input_perf_command_fn (vlib_main_t *vm, unformat_input_t *input,
+				  vlib_cli_command_t *cmd)
+{
+  u32 n_policies = 32, n_flows = 1024, n_buffers = 1024, rounds = 100;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "policies %u", &n_policies))
+	;
+      else if (unformat (input, "flows %u", &n_flows))
+	;
+      else if (unformat (input, "buffers %u", &n_buffers))
+	;
+      else if (unformat (input, "rounds %u", &rounds))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (!n_policies || !n_flows || !n_buffers || !rounds)
+    return clib_error_return (0, "counts must be non-zero");
+
+  return test_ipsec_input_perf (vm, n_policies, n_flows, n_buffers, rounds);
+}
+
+VLIB_CLI_COMMAND (test_ipsec_input_perf_command, static) = {
+  .path = "test ipsec input-perf",
+  .short_help = "test ipsec input-perf [policies <n>] [flows <n>] "
+		"[buffers <n>] [rounds <n>]",
+  .function = test_ipsec_input_perf_command_fn,
+};
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
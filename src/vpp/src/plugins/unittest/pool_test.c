@@ -14,6 +14,7 @@
  */
 
 #include <vlib/vlib.h>
+#include <vppinfra/chunk_pool.h>
 
 static clib_error_t *
 test_pool_command_fn (vlib_main_t *vm, unformat_input_t *input,
@@ -61,6 +62,96 @@ VLIB_CLI_COMMAND (test_pool_command, static) = {
   .function = test_pool_command_fn,
 };
 
+static clib_error_t *
+test_chunk_pool_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			    vlib_cli_command_t *cmd)
+{
+  chunk_pool_t cp = { 0 };
+  u64 **elts = 0, *e;
+  u32 n_elts = 100000;
+  u32 i, n;
+
+  unformat_input_t _line_input, *line_input = &_line_input;
+
+  if (unformat_user (input, unformat_line_input, line_input))
+    {
+      while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+	{
+	  if (unformat (line_input, "elts %d", &n_elts))
+	    ;
+	  else
+	    {
+	      clib_error_t *error;
+
+	      error = clib_error_return (0, "unknown input '%U'",
+					 format_unformat_error, line_input);
+	      unformat_free (line_input);
+	      return error;
+	    }
+	}
+      unformat_free (line_input);
+    }
+
+  /* grow the pool, no element may move */
+  for (i = 0; i < n_elts; i++)
+    {
+      chunk_pool_get (&cp, e);
+      ALWAYS_ASSERT (chunk_pool_index_of (&cp, e) == i);
+      *e = i;
+      vec_add1 (elts, e);
+    }
+  for (i = 0; i < n_elts; i++)
+    {
+      ALWAYS_ASSERT (chunk_pool_elt_at_index (&cp, i) == elts[i]);
+      ALWAYS_ASSERT (*elts[i] == i);
+    }
+  ALWAYS_ASSERT (chunk_pool_elts (&cp) == n_elts);
+  vlib_cli_output (vm, "allocated %d elts in %d chunks, %U", n_elts,
+		   cp.n_chunks, format_memory_size, chunk_pool_bytes (&cp));
+
+  /* free every other element, walk the rest */
+  for (i = 0; i < n_elts; i += 2)
+    chunk_pool_put_index (&cp, i);
+  ALWAYS_ASSERT (chunk_pool_elts (&cp) == n_elts / 2);
+
+  n = 0;
+  chunk_pool_foreach_index (i, &cp)
+    {
+      ALWAYS_ASSERT (i & 1);
+      n++;
+    }
+  ALWAYS_ASSERT (n == n_elts / 2);
+
+  n = 0;
+  chunk_pool_foreach (e, &cp)
+    {
+      ALWAYS_ASSERT (*e & 1);
+      n++;
+    }
+  ALWAYS_ASSERT (n == n_elts / 2);
+
+  /* the freed elements are reused before the pool grows */
+  for (i = 0; i < (n_elts + 1) / 2; i++)
+    {
+      chunk_pool_get (&cp, e);
+      ALWAYS_ASSERT (chunk_pool_index_of (&cp, e) < n_elts);
+    }
+  ALWAYS_ASSERT (chunk_pool_len (&cp) == n_elts);
+  ALWAYS_ASSERT (chunk_pool_elts (&cp) == n_elts);
+
+  chunk_pool_free (&cp);
+  vec_free (elts);
+
+  vlib_cli_output (vm, "Test succeeded...\n");
+  return 0;
+}
+
+VLIB_CLI_COMMAND (test_chunk_pool_command, static) = {
+  .path = "test chunk-pool",
+  .short_help = "vppinfra chunk_pool.h tests [elts <n>]",
+  .function = test_chunk_pool_command_fn,
+};
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -29,9 +29,9 @@ vlib_combined_counter_main_t adjacency_counters = {
 };
 
 /*
- * the single adj pool
+ * the single adj pool. The adjacencies do not move when it grows.
  */
-ip_adjacency_t *adj_pool;
+chunk_pool_t adj_pool;
 
 /**
  * @brief Global Config for enabling per-adjacency counters.
@@ -64,37 +64,28 @@ ip_adjacency_t *
 adj_alloc (fib_protocol_t proto)
 {
     ip_adjacency_t *adj;
+    adj_index_t ai;
     u8 need_barrier_sync = 0;
     vlib_main_t *vm;
     vm = vlib_get_main();
 
     ASSERT (vm->thread_index == 0);
 
-    pool_get_aligned_will_expand (adj_pool, need_barrier_sync,
-                                  CLIB_CACHE_LINE_BYTES);
-    /* If the adj_pool will expand, stop the parade. */
-    if (need_barrier_sync)
-        vlib_worker_thread_barrier_sync (vm);
-
-    pool_get_aligned(adj_pool, adj, CLIB_CACHE_LINE_BYTES);
+    ai = chunk_pool_get_index(&adj_pool, sizeof(*adj),
+                              CLIB_CACHE_LINE_BYTES);
+    adj = adj_get(ai);
 
     adj_poison(adj);
 
-    /* Validate adjacency counters. */
-    if (need_barrier_sync == 0)
-    {
-        /* If the adj counter pool will expand, stop the parade */
-        need_barrier_sync = vlib_validate_combined_counter_will_expand
-            (&adjacency_counters, adj_get_index (adj));
-        if (need_barrier_sync)
-            vlib_worker_thread_barrier_sync (vm);
-    }
-    vlib_validate_combined_counter(&adjacency_counters,
-                                   adj_get_index(adj));
+    /* Validate adjacency counters. If they will expand, stop the parade */
+    need_barrier_sync = vlib_validate_combined_counter_will_expand
+        (&adjacency_counters, ai);
+    if (need_barrier_sync)
+        vlib_worker_thread_barrier_sync (vm);
+    vlib_validate_combined_counter(&adjacency_counters, ai);
 
     /* Make sure certain fields are always initialized. */
-    vlib_zero_combined_counter(&adjacency_counters,
-                               adj_get_index(adj));
+    vlib_zero_combined_counter(&adjacency_counters, ai);
     fib_node_init(&adj->ia_node,
                   FIB_NODE_TYPE_ADJ);
 
@@ -314,7 +305,7 @@ adj_last_lock_gone (ip_adjacency_t *adj)
     fib_node_deinit(&adj->ia_node);
     ASSERT(0 == vec_len(adj->ia_delegates));
     vec_free(adj->ia_delegates);
-    pool_put(adj_pool, adj);
+    chunk_pool_put(&adj_pool, adj);
 }
 
 u32
@@ -680,7 +671,8 @@ adj_show (vlib_main_t * vm,
 
     if (summary)
     {
-        vlib_cli_output (vm, "Number of adjacencies: %d", pool_elts(adj_pool));
+        vlib_cli_output (vm, "Number of adjacencies: %d",
+                         chunk_pool_elts(&adj_pool));
         vlib_cli_output (vm, "Per-adjacency counters: %s",
                          (adj_are_counters_enabled() ?
                           "enabled":
@@ -690,7 +682,7 @@ adj_show (vlib_main_t * vm,
     {
         if (ADJ_INDEX_INVALID != ai)
         {
-            if (pool_is_free_index(adj_pool, ai))
+            if (chunk_pool_is_free_index(&adj_pool, ai))
             {
                 vlib_cli_output (vm, "adjacency %d invalid", ai);
                 return 0;
@@ -704,7 +696,7 @@ adj_show (vlib_main_t * vm,
         else
         {
             /* *INDENT-OFF* */
-            pool_foreach_index (ai, adj_pool)
+            chunk_pool_foreach_index (ai, &adj_pool)
              {
                 if (~0 != sw_if_index &&
                     sw_if_index != adj_get_sw_if_index(ai))
@@ -41,6 +41,7 @@
 #ifndef __ADJ_H__
 #define __ADJ_H__
 
+#include <vppinfra/chunk_pool.h>
 #include <vnet/adj/adj_types.h>
 #include <vnet/adj/adj_nbr.h>
 #include <vnet/adj/adj_glean.h>
@@ -438,7 +439,7 @@ extern int adj_recursive_loop_detect (adj_index_t ai,
  * @brief
  * The global adjacency pool. Exposed for fast/inline data-plane access
  */
-extern ip_adjacency_t *adj_pool;
+extern chunk_pool_t adj_pool;
 
 /**
  * @brief 
@@ -459,13 +460,13 @@ extern int adj_per_adj_counters;
 static inline ip_adjacency_t *
 adj_get (adj_index_t adj_index)
 {
-    return (pool_elt_at_index(adj_pool, adj_index));
+    return (chunk_pool_elt_at_index(&adj_pool, adj_index));
 }
 
 static inline int
 adj_is_valid(adj_index_t adj_index)
 {
-  return !(pool_is_free_index(adj_pool, adj_index));
+  return !(chunk_pool_is_free_index(&adj_pool, adj_index));
 }
 
 /**
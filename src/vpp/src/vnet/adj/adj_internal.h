@@ -35,7 +35,7 @@
 #define ADJ_DBG(_adj, _fmt, _args...)		\
 {						\
     clib_warning("adj:[%d:%p]:" _fmt,		\
-		 _adj - adj_pool, _adj,		\
+		 adj_get_index(_adj), _adj,	\
 		 ##_args);			\
 }
 #else
@@ -107,7 +107,7 @@ adj_proto_to_46 (fib_protocol_t proto)
 static inline adj_index_t
 adj_get_index (const ip_adjacency_t *adj)
 {
-    return (adj - adj_pool);
+    return (chunk_pool_index_of(&adj_pool, adj));
 }
 
 extern void adj_nbr_update_rewrite_internal(ip_adjacency_t *adj,
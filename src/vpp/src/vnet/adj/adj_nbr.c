@@ -654,7 +654,7 @@ adj_nbr_walk (u32 sw_if_index,
     vec_foreach(aip, ais)
     {
         /* An adj may be deleted during the walk so check first */
-        if (!pool_is_free_index(adj_pool, *aip))
+        if (!chunk_pool_is_free_index(&adj_pool, *aip))
             cb(*aip, ctx);
     }
     vec_free(ais);
@@ -1135,8 +1135,8 @@ static void
 adj_mem_show (void)
 {
     fib_show_memory_usage("Adjacency",
-			  pool_elts(adj_pool),
-			  pool_len(adj_pool),
+			  chunk_pool_elts(&adj_pool),
+			  chunk_pool_len(&adj_pool),
 			  sizeof(ip_adjacency_t));
 }
 
@@ -20,18 +20,15 @@
 /*
  * pool of all MPLS Label DPOs
  */
-classify_dpo_t *classify_dpo_pool;
+chunk_pool_t classify_dpo_pool;
 
 static classify_dpo_t *
 classify_dpo_alloc (void)
 {
     classify_dpo_t *cd;
-    vlib_main_t *vm;
-    u8 did_barrier_sync;
 
-    dpo_pool_barrier_sync (vm, classify_dpo_pool, did_barrier_sync);
-    pool_get_aligned(classify_dpo_pool, cd, CLIB_CACHE_LINE_BYTES);
-    dpo_pool_barrier_release (vm, did_barrier_sync);
+    ASSERT (vlib_get_thread_index() == 0);
+    chunk_pool_get_aligned(&classify_dpo_pool, cd, CLIB_CACHE_LINE_BYTES);
 
     clib_memset(cd, 0, sizeof(*cd));
 
@@ -41,7 +38,7 @@ classify_dpo_alloc (void)
 static index_t
 classify_dpo_get_index (classify_dpo_t *cd)
 {
-    return (cd - classify_dpo_pool);
+    return (chunk_pool_index_of(&classify_dpo_pool, cd));
 }
 
 index_t
@@ -92,7 +89,7 @@ classify_dpo_unlock (dpo_id_t *dpo)
 
     if (0 == cd->cd_locks)
     {
-	pool_put(classify_dpo_pool, cd);
+	chunk_pool_put(&classify_dpo_pool, cd);
     }
 }
 
@@ -100,8 +97,8 @@ static void
 classify_dpo_mem_show (void)
 {
     fib_show_memory_usage("Classify",
-			  pool_elts(classify_dpo_pool),
-			  pool_len(classify_dpo_pool),
+			  chunk_pool_elts(&classify_dpo_pool),
+			  chunk_pool_len(&classify_dpo_pool),
 			  sizeof(classify_dpo_t));
 }
 
@@ -48,12 +48,12 @@ extern u8* format_classify_dpo(u8 *s, va_list *args);
 /*
  * Encapsulation violation for fast data-path access
  */
-extern classify_dpo_t *classify_dpo_pool;
+extern chunk_pool_t classify_dpo_pool;
 
 static inline classify_dpo_t *
 classify_dpo_get (index_t index)
 {
-    return (pool_elt_at_index(classify_dpo_pool, index));
+    return (chunk_pool_elt_at_index(&classify_dpo_pool, index));
 }
 
 extern void classify_dpo_module_init(void);
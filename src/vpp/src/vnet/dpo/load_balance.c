@@ -49,9 +49,11 @@ vlib_log_class_t load_balance_logger;
 }
 
 /**
- * Pool of all DPOs. It's not static so the DP can have fast access
+ * Pool of all DPOs. It's not static so the DP can have fast access.
+ * The load-balances do not move when it grows, so no worker barrier
+ * is needed to allocate one.
  */
-load_balance_t *load_balance_pool;
+chunk_pool_t load_balance_pool;
 
 /**
  * The one instance of load-balance main
@@ -76,7 +78,7 @@ load_balance_get_multipath_tolerance (void)
 static inline index_t
 load_balance_get_index (const load_balance_t *lb)
 {
-    return (lb - load_balance_pool);
+    return (chunk_pool_index_of(&load_balance_pool, lb));
 }
 
 static inline dpo_id_t*
@@ -96,41 +98,38 @@ static load_balance_t *
 load_balance_alloc_i (void)
 {
     load_balance_t *lb;
+    index_t lbi;
     u8 need_barrier_sync = 0;
     vlib_main_t *vm = vlib_get_main();
     ASSERT (vm->thread_index == 0);
 
-    pool_get_aligned_will_expand (load_balance_pool, need_barrier_sync,
-                                  CLIB_CACHE_LINE_BYTES);
-    if (need_barrier_sync)
-        vlib_worker_thread_barrier_sync (vm);
-
-    pool_get_aligned(load_balance_pool, lb, CLIB_CACHE_LINE_BYTES);
+    lbi = chunk_pool_get_index(&load_balance_pool, sizeof(*lb),
+                               CLIB_CACHE_LINE_BYTES);
+    lb = load_balance_get(lbi);
     clib_memset(lb, 0, sizeof(*lb));
 
     lb->lb_map = INDEX_INVALID;
     lb->lb_urpf = INDEX_INVALID;
 
-    if (need_barrier_sync == 0)
-    {
-        need_barrier_sync += vlib_validate_combined_counter_will_expand
-            (&(load_balance_main.lbm_to_counters),
-             load_balance_get_index(lb));
-        need_barrier_sync += vlib_validate_combined_counter_will_expand
-            (&(load_balance_main.lbm_via_counters),
-             load_balance_get_index(lb));
-        if (need_barrier_sync)
-            vlib_worker_thread_barrier_sync (vm);
-    }
+    /*
+     * the counters are still per-thread vectors, stop the workers
+     * if they grow.
+     */
+    need_barrier_sync += vlib_validate_combined_counter_will_expand
+        (&(load_balance_main.lbm_to_counters), lbi);
+    need_barrier_sync += vlib_validate_combined_counter_will_expand
+        (&(load_balance_main.lbm_via_counters), lbi);
+    if (need_barrier_sync)
+        vlib_worker_thread_barrier_sync (vm);
 
     vlib_validate_combined_counter(&(load_balance_main.lbm_to_counters),
-                                   load_balance_get_index(lb));
+                                   lbi);
     vlib_validate_combined_counter(&(load_balance_main.lbm_via_counters),
-                                   load_balance_get_index(lb));
+                                   lbi);
     vlib_zero_combined_counter(&(load_balance_main.lbm_to_counters),
-                               load_balance_get_index(lb));
+                               lbi);
     vlib_zero_combined_counter(&(load_balance_main.lbm_via_counters),
-                               load_balance_get_index(lb));
+                               lbi);
 
     if (need_barrier_sync)
         vlib_worker_thread_barrier_release (vm);
@@ -892,7 +891,7 @@ load_balance_destroy (load_balance_t *lb)
     fib_urpf_list_unlock(lb->lb_urpf);
     load_balance_map_unlock(lb->lb_map);
 
-    pool_put(load_balance_pool, lb);
+    chunk_pool_put(&load_balance_pool, lb);
 }
 
 static void
@@ -914,8 +913,8 @@ static void
 load_balance_mem_show (void)
 {
     fib_show_memory_usage("load-balance",
-			  pool_elts(load_balance_pool),
-			  pool_len(load_balance_pool),
+			  chunk_pool_elts(&load_balance_pool),
+			  chunk_pool_len(&load_balance_pool),
 			  sizeof(load_balance_t));
     load_balance_map_show_mem();
 }
@@ -1036,7 +1035,7 @@ load_balance_show (vlib_main_t * vm,
 
     if (INDEX_INVALID != lbi)
     {
-        if (pool_is_free_index(load_balance_pool, lbi))
+        if (chunk_pool_is_free_index(&load_balance_pool, lbi))
         {
             vlib_cli_output (vm, "no such load-balance:%d", lbi);
         }
@@ -1050,7 +1049,7 @@ load_balance_show (vlib_main_t * vm,
     {
         load_balance_t *lb;
 
-        pool_foreach (lb, load_balance_pool)
+        chunk_pool_foreach (lb, &load_balance_pool)
          {
             vlib_cli_output (vm, "%U", format_load_balance,
                              load_balance_get_index(lb),
@@ -215,11 +215,11 @@ extern f64 load_balance_get_multipath_tolerance(void);
 /**
  * The encapsulation breakages are for fast DP access
  */
-extern load_balance_t *load_balance_pool;
+extern chunk_pool_t load_balance_pool;
 static inline load_balance_t*
 load_balance_get (index_t lbi)
 {
-    return (pool_elt_at_index(load_balance_pool, lbi));
+    return (chunk_pool_elt_at_index(&load_balance_pool, lbi));
 }
 
 #define LB_HAS_INLINE_BUCKETS(_lb)		\
@@ -66,7 +66,7 @@ typedef struct load_balance_map_path_t_ {
 /**
  * The global pool of LB maps
  */
-load_balance_map_t *load_balance_map_pool;
+chunk_pool_t load_balance_map_pool;
 
 /**
  * the logger
@@ -86,7 +86,7 @@ vlib_log_class_t load_balance_map_logger;
 static index_t
 load_balance_map_get_index (load_balance_map_t *lbm)
 {
-    return (lbm - load_balance_map_pool);
+    return (chunk_pool_index_of(&load_balance_map_pool, lbm));
 }
 
 u8*
@@ -387,12 +387,9 @@ load_balance_map_alloc (const load_balance_path_t *paths)
 {
     load_balance_map_t *lbm;
     u32 ii;
-    vlib_main_t *vm;
-    u8 did_barrier_sync;
 
-    dpo_pool_barrier_sync (vm, load_balance_map_pool, did_barrier_sync);
-    pool_get_aligned(load_balance_map_pool, lbm, CLIB_CACHE_LINE_BYTES);
-    dpo_pool_barrier_release (vm, did_barrier_sync);
+    ASSERT (vlib_get_thread_index() == 0);
+    chunk_pool_get_aligned(&load_balance_map_pool, lbm, CLIB_CACHE_LINE_BYTES);
 
     clib_memset(lbm, 0, sizeof(*lbm));
 
@@ -430,7 +427,7 @@ load_balance_map_destroy (load_balance_map_t *lbm)
 {
     vec_free(lbm->lbm_paths);
     vec_free(lbm->lbm_buckets);
-    pool_put(load_balance_map_pool, lbm);
+    chunk_pool_put(&load_balance_map_pool, lbm);
 }
 
 index_t
@@ -547,8 +544,8 @@ void
 load_balance_map_show_mem (void)
 {
     fib_show_memory_usage("Load-Balance Map",
-			  pool_elts(load_balance_map_pool),
-			  pool_len(load_balance_map_pool),
+			  chunk_pool_elts(&load_balance_map_pool),
+			  chunk_pool_len(&load_balance_map_pool),
 			  sizeof(load_balance_map_t));
 }
 
@@ -575,7 +572,7 @@ load_balance_map_show (vlib_main_t * vm,
     {
         load_balance_map_t *lbm;
 
-        pool_foreach (lbm, load_balance_map_pool)
+        chunk_pool_foreach (lbm, &load_balance_map_pool)
          {
             vlib_cli_output (vm, "%U", format_load_balance_map,
                              load_balance_map_get_index(lbm), 0);
@@ -71,12 +71,12 @@ extern void load_balance_map_show_mem(void);
 /**
  * The encapsulation breakages are for fast DP access
  */
-extern load_balance_map_t *load_balance_map_pool;
+extern chunk_pool_t load_balance_map_pool;
 
 static inline load_balance_map_t*
 load_balance_map_get (index_t lbmi)
 {
-    return (pool_elt_at_index(load_balance_map_pool, lbmi));
+    return (chunk_pool_elt_at_index(&load_balance_map_pool, lbmi));
 }
 
 static inline u16
@@ -52,7 +52,7 @@ typedef enum lookup_sub_type_t_
 /**
  * @brief pool of all MPLS Label DPOs
  */
-lookup_dpo_t *lookup_dpo_pool;
+chunk_pool_t lookup_dpo_pool;
 
 /**
  * @brief An array of registered DPO type values for the sub-types
@@ -63,12 +63,9 @@ static lookup_dpo_t *
 lookup_dpo_alloc (void)
 {
     lookup_dpo_t *lkd;
-    vlib_main_t *vm;
-    u8 did_barrier_sync;
 
-    dpo_pool_barrier_sync (vm, lookup_dpo_pool, did_barrier_sync);
-    pool_get_aligned(lookup_dpo_pool, lkd, CLIB_CACHE_LINE_BYTES);
-    dpo_pool_barrier_release (vm, did_barrier_sync);
+    ASSERT (vlib_get_thread_index() == 0);
+    chunk_pool_get_aligned(&lookup_dpo_pool, lkd, CLIB_CACHE_LINE_BYTES);
 
     return (lkd);
 }
@@ -76,7 +73,7 @@ lookup_dpo_alloc (void)
 static index_t
 lookup_dpo_get_index (lookup_dpo_t *lkd)
 {
-    return (lkd - lookup_dpo_pool);
+    return (chunk_pool_index_of(&lookup_dpo_pool, lkd));
 }
 
 static void
@@ -264,7 +261,7 @@ lookup_dpo_unlock (dpo_id_t *dpo)
                                   MFIB_SOURCE_RR);
             }
         }
-        pool_put(lookup_dpo_pool, lkd);
+        chunk_pool_put(&lookup_dpo_pool, lkd);
     }
 }
 
@@ -1315,8 +1312,8 @@ static void
 lookup_dpo_mem_show (void)
 {
     fib_show_memory_usage("Lookup",
-			  pool_elts(lookup_dpo_pool),
-			  pool_len(lookup_dpo_pool),
+			  chunk_pool_elts(&lookup_dpo_pool),
+			  chunk_pool_len(&lookup_dpo_pool),
 			  sizeof(lookup_dpo_t));
 }
 
@@ -1426,7 +1423,7 @@ lookup_dpo_show (vlib_main_t * vm,
 
     if (INDEX_INVALID != lkdi)
     {
-	if (pool_is_free_index(lookup_dpo_pool, lkdi))
+	if (chunk_pool_is_free_index(&lookup_dpo_pool, lkdi))
 		vlib_cli_output (vm, "no such index %d", lkdi);
 	else
 		vlib_cli_output (vm, "%U", format_lookup_dpo, lkdi);
@@ -1435,7 +1432,7 @@ lookup_dpo_show (vlib_main_t * vm,
     {
         lookup_dpo_t *lkd;
 
-        pool_foreach (lkd, lookup_dpo_pool)
+        chunk_pool_foreach (lkd, &lookup_dpo_pool)
          {
             vlib_cli_output (vm, "[@%d] %U",
                              lookup_dpo_get_index(lkd),
@@ -121,12 +121,12 @@ extern u8* format_lookup_dpo(u8 *s, va_list *args);
 /*
  * Encapsulation violation for fast data-path access
  */
-extern lookup_dpo_t *lookup_dpo_pool;
+extern chunk_pool_t lookup_dpo_pool;
 
 static inline lookup_dpo_t *
 lookup_dpo_get (index_t index)
 {
-    return (pool_elt_at_index(lookup_dpo_pool, index));
+    return (chunk_pool_elt_at_index(&lookup_dpo_pool, index));
 }
 
 extern void lookup_dpo_module_init(void);
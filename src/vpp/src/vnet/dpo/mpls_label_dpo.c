@@ -24,7 +24,7 @@
 /*
  * pool of all MPLS Label DPOs
  */
-mpls_label_dpo_t *mpls_label_dpo_pool;
+chunk_pool_t mpls_label_dpo_pool;
 
 /**
  * Strings for the flags
@@ -41,12 +41,9 @@ static mpls_label_dpo_t *
 mpls_label_dpo_alloc (void)
 {
     mpls_label_dpo_t *mld;
-    vlib_main_t *vm;
-    u8 did_barrier_sync;
 
-    dpo_pool_barrier_sync (vm, mpls_label_dpo_pool, did_barrier_sync);
-    pool_get_aligned(mpls_label_dpo_pool, mld, CLIB_CACHE_LINE_BYTES);
-    dpo_pool_barrier_release (vm, did_barrier_sync);
+    ASSERT (vlib_get_thread_index() == 0);
+    chunk_pool_get_aligned(&mpls_label_dpo_pool, mld, CLIB_CACHE_LINE_BYTES);
 
     clib_memset(mld, 0, sizeof(*mld));
 
@@ -58,7 +55,7 @@ mpls_label_dpo_alloc (void)
 static index_t
 mpls_label_dpo_get_index (mpls_label_dpo_t *mld)
 {
-    return (mld - mpls_label_dpo_pool);
+    return (chunk_pool_index_of(&mpls_label_dpo_pool, mld));
 }
 
 void
@@ -204,7 +201,7 @@ format_mpls_label_dpo (u8 *s, va_list *args)
     mpls_label_dpo_t *mld;
     u32 ii;
 
-    if (pool_is_free_index(mpls_label_dpo_pool, index))
+    if (chunk_pool_is_free_index(&mpls_label_dpo_pool, index))
     {
         /*
          * the packet trace can be printed after the DPO has been deleted
@@ -252,7 +249,7 @@ mpls_label_dpo_unlock (dpo_id_t *dpo)
     if (0 == mld->mld_locks)
     {
 	dpo_reset(&mld->mld_dpo);
-	pool_put(mpls_label_dpo_pool, mld);
+	chunk_pool_put(&mpls_label_dpo_pool, mld);
     }
 }
 #endif /* CLIB_MARCH_VARIANT */
@@ -1186,8 +1183,8 @@ static void
 mpls_label_dpo_mem_show (void)
 {
     fib_show_memory_usage("MPLS label",
-			  pool_elts(mpls_label_dpo_pool),
-			  pool_len(mpls_label_dpo_pool),
+			  chunk_pool_elts(&mpls_label_dpo_pool),
+			  chunk_pool_len(&mpls_label_dpo_pool),
 			  sizeof(mpls_label_dpo_t));
 }
 
@@ -140,12 +140,12 @@ extern u8* format_mpls_label_dpo(u8 *s, va_list *args);
 /*
  * Encapsulation violation for fast data-path access
  */
-extern mpls_label_dpo_t *mpls_label_dpo_pool;
+extern chunk_pool_t mpls_label_dpo_pool;
 
 static inline mpls_label_dpo_t *
 mpls_label_dpo_get (index_t index)
 {
-    return (pool_elt_at_index(mpls_label_dpo_pool, index));
+    return (chunk_pool_elt_at_index(&mpls_label_dpo_pool, index));
 }
 
 extern void mpls_label_dpo_module_init(void);
@@ -23,7 +23,7 @@
 /**
  * @brief pool of all receive DPOs
  */
-receive_dpo_t *receive_dpo_pool;
+chunk_pool_t receive_dpo_pool;
 
 int
 dpo_is_receive (const dpo_id_t *dpo)
@@ -35,12 +35,9 @@ static receive_dpo_t *
 receive_dpo_alloc (void)
 {
     receive_dpo_t *rd;
-    vlib_main_t *vm;
-    u8 did_barrier_sync;
 
-    dpo_pool_barrier_sync (vm, receive_dpo_pool, did_barrier_sync);
-    pool_get_aligned(receive_dpo_pool, rd, CLIB_CACHE_LINE_BYTES);
-    dpo_pool_barrier_release (vm, did_barrier_sync);
+    ASSERT (vlib_get_thread_index() == 0);
+    chunk_pool_get_aligned(&receive_dpo_pool, rd, CLIB_CACHE_LINE_BYTES);
 
     clib_memset(rd, 0, sizeof(*rd));
 
@@ -79,7 +76,8 @@ receive_dpo_add_or_lock (dpo_proto_t proto,
 	rd->rd_addr = *nh_addr;
     }
 
-    dpo_set(dpo, DPO_RECEIVE, proto, (rd - receive_dpo_pool));
+    dpo_set(dpo, DPO_RECEIVE, proto,
+            chunk_pool_index_of(&receive_dpo_pool, rd));
 }
 
 static void
@@ -101,7 +99,7 @@ receive_dpo_unlock (dpo_id_t *dpo)
 
     if (0 == rd->rd_locks)
     {
-        pool_put(receive_dpo_pool, rd);
+        chunk_pool_put(&receive_dpo_pool, rd);
     }
 }
 
@@ -113,7 +111,7 @@ format_receive_dpo (u8 *s, va_list *ap)
     vnet_main_t * vnm = vnet_get_main();
     receive_dpo_t *rd;
 
-    if (pool_is_free_index(receive_dpo_pool, index))
+    if (chunk_pool_is_free_index(&receive_dpo_pool, index))
     {
         return (format(s, "dpo-receive DELETED"));
     }
@@ -137,8 +135,8 @@ static void
 receive_dpo_mem_show (void)
 {
     fib_show_memory_usage("Receive",
-			  pool_elts(receive_dpo_pool),
-			  pool_len(receive_dpo_pool),
+			  chunk_pool_elts(&receive_dpo_pool),
+			  chunk_pool_len(&receive_dpo_pool),
 			  sizeof(receive_dpo_t));
 }
 
@@ -59,12 +59,12 @@ extern void receive_dpo_module_init(void);
 /**
  * @brief pool of all receive DPOs
  */
-extern receive_dpo_t *receive_dpo_pool;
+extern chunk_pool_t receive_dpo_pool;
 
 static inline receive_dpo_t *
 receive_dpo_get (index_t index)
 {
-    return (pool_elt_at_index(receive_dpo_pool, index));
+    return (chunk_pool_elt_at_index(&receive_dpo_pool, index));
 }
 
 #endif
@@ -14,6 +14,7 @@
  */
 
 #include <vlib/vlib.h>
+#include <vppinfra/chunk_pool.h>
 #include <vnet/ip/format.h>
 #include <vnet/ip/lookup.h>
 #include <vnet/adj/adj.h>
@@ -38,9 +39,10 @@ static const char *fib_attribute_names[] = FIB_ENTRY_ATTRIBUTES;
 static const char *fib_src_attribute_names[] = FIB_ENTRY_SRC_ATTRIBUTES;
 
 /*
- * Pool for all fib_entries
+ * Pool for all fib_entries. A chunk pool, so the entries do not move
+ * when it grows and the workers need not be stopped.
  */
-static fib_entry_t *fib_entry_pool;
+static chunk_pool_t fib_entry_pool;
 
 /**
  * the logger
@@ -50,7 +52,7 @@ vlib_log_class_t fib_entry_logger;
 fib_entry_t *
 fib_entry_get (fib_node_index_t index)
 {
-    return (pool_elt_at_index(fib_entry_pool, index));
+    return (chunk_pool_elt_at_index(&fib_entry_pool, index));
 }
 
 static fib_node_t *
@@ -62,7 +64,7 @@ fib_entry_get_node (fib_node_index_t index)
 fib_node_index_t
 fib_entry_get_index (const fib_entry_t * fib_entry)
 {
-    return (fib_entry - fib_entry_pool);
+    return (chunk_pool_index_of(&fib_entry_pool, fib_entry));
 }
 
 fib_protocol_t
@@ -244,7 +246,7 @@ fib_entry_last_lock_gone (fib_node_t *node)
     ASSERT(0 == vec_len(fib_entry->fe_delegates));
     vec_free(fib_entry->fe_delegates);
     vec_free(fib_entry->fe_srcs);
-    pool_put(fib_entry_pool, fib_entry);
+    chunk_pool_put(&fib_entry_pool, fib_entry);
 }
 
 static fib_entry_src_t*
@@ -301,11 +303,11 @@ fib_entry_show_memory (void)
     fib_entry_t *entry;
 
     fib_show_memory_usage("Entry",
-			  pool_elts(fib_entry_pool),
-			  pool_len(fib_entry_pool),
+			  chunk_pool_elts(&fib_entry_pool),
+			  chunk_pool_len(&fib_entry_pool),
 			  sizeof(fib_entry_t));
 
-    pool_foreach (entry, fib_entry_pool)
+    chunk_pool_foreach (entry, &fib_entry_pool)
      {
 	n_srcs += vec_len(entry->fe_srcs);
 	vec_foreach(esrc, entry->fe_srcs)
@@ -537,18 +539,9 @@ fib_entry_alloc (u32 fib_index,
 {
     fib_entry_t *fib_entry;
     fib_prefix_t *fep;
-    u8 need_barrier_sync = 0;
-    vlib_main_t *vm = vlib_get_main();
-    ASSERT (vm->thread_index == 0);
+    ASSERT (vlib_get_thread_index() == 0);
 
-    pool_get_will_expand (fib_entry_pool, need_barrier_sync );
-    if (need_barrier_sync)
-        vlib_worker_thread_barrier_sync (vm);
-
-    pool_get(fib_entry_pool, fib_entry);
-
-    if (need_barrier_sync)
-        vlib_worker_thread_barrier_release (vm);
+    chunk_pool_get(&fib_entry_pool, fib_entry);
 
     clib_memset(fib_entry, 0, sizeof(*fib_entry));
 
@@ -1826,7 +1819,7 @@ fib_entry_get_fib_index (fib_node_index_t fib_entry_index)
 u32
 fib_entry_pool_size (void)
 {
-    return (pool_elts(fib_entry_pool));
+    return (chunk_pool_elts(&fib_entry_pool));
 }
 
 #if CLIB_DEBUG > 0
@@ -1836,7 +1829,7 @@ fib_table_assert_empty (const fib_table_t *fib_table)
     fib_node_index_t *fei, *feis = NULL;
     fib_entry_t *fib_entry;
 
-    pool_foreach (fib_entry, fib_entry_pool)
+    chunk_pool_foreach (fib_entry, &fib_entry_pool)
      {
         if (fib_entry->fe_fib_index == fib_table->ft_index)
             vec_add1 (feis, fib_entry_get_index(fib_entry));
@@ -1864,7 +1857,7 @@ show_fib_entry_command (vlib_main_t * vm,
 	/*
 	 * show one in detail
 	 */
-	if (!pool_is_free_index(fib_entry_pool, fei))
+	if (!chunk_pool_is_free_index(&fib_entry_pool, fei))
 	{
 	    vlib_cli_output (vm, "%d@%U",
 			     fei,
@@ -1882,7 +1875,7 @@ show_fib_entry_command (vlib_main_t * vm,
 	 * show all
 	 */
 	vlib_cli_output (vm, "FIB Entries:");
-	pool_foreach_index (fei, fib_entry_pool)
+	chunk_pool_foreach_index (fei, &fib_entry_pool)
          {
 	    vlib_cli_output (vm, "%d@%U",
 			     fei,
@@ -19,7 +19,7 @@
 /**
  * @brief pool of all fib_urpf_list
  */
-fib_urpf_list_t *fib_urpf_list_pool;
+chunk_pool_t fib_urpf_list_pool;
 
 u8 *
 format_fib_urpf_list (u8 *s, va_list *args)
@@ -55,24 +55,17 @@ index_t
 fib_urpf_list_alloc_and_lock (void)
 {
     fib_urpf_list_t *urpf;
-    u8 need_barrier_sync = 0;
-    vlib_main_t *vm = vlib_get_main();
-    ASSERT (vm->thread_index == 0);
-
-    pool_get_will_expand (fib_urpf_list_pool, need_barrier_sync );
-    if (need_barrier_sync)
-        vlib_worker_thread_barrier_sync (vm);
-
-    pool_get(fib_urpf_list_pool, urpf);
+    index_t ui;
+    ASSERT (vlib_get_thread_index() == 0);
 
-    if (need_barrier_sync)
-        vlib_worker_thread_barrier_release (vm);
+    ui = chunk_pool_get_index(&fib_urpf_list_pool, sizeof(*urpf), 0);
+    urpf = fib_urpf_list_get(ui);
 
     clib_memset(urpf, 0, sizeof(*urpf));
 
     urpf->furpf_locks++;
 
-    return (urpf - fib_urpf_list_pool);
+    return (ui);
 }
 
 void
@@ -90,7 +83,7 @@ fib_urpf_list_unlock (index_t ui)
     if (0 == urpf->furpf_locks)
     {
 	vec_free(urpf->furpf_itfs);
-	pool_put(fib_urpf_list_pool, urpf);
+	chunk_pool_put_index(&fib_urpf_list_pool, ui);
     }
 }
 
@@ -184,8 +177,8 @@ void
 fib_urpf_list_show_mem (void)
 {
     fib_show_memory_usage("uRPF-list",
-			  pool_elts(fib_urpf_list_pool),
-			  pool_len(fib_urpf_list_pool),
+			  chunk_pool_elts(&fib_urpf_list_pool),
+			  chunk_pool_len(&fib_urpf_list_pool),
 			  sizeof(fib_urpf_list_t));
 }
 
@@ -201,7 +194,7 @@ show_fib_urpf_list_command (vlib_main_t * vm,
 	/*
 	 * show one in detail
 	 */
-	if (!pool_is_free_index(fib_urpf_list_pool, ui))
+	if (!chunk_pool_is_free_index(&fib_urpf_list_pool, ui))
 	{
 	    vlib_cli_output (vm, "%d@%U",
 			     ui,
@@ -218,7 +211,7 @@ show_fib_urpf_list_command (vlib_main_t * vm,
 	 * show all
 	 */
 	vlib_cli_output (vm, "FIB uRPF Entries:");
-	pool_foreach_index (ui, fib_urpf_list_pool)
+	chunk_pool_foreach_index (ui, &fib_urpf_list_pool)
          {
 	    vlib_cli_output (vm, "%d@%U",
 			     ui,
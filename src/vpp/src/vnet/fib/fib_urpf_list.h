@@ -41,6 +41,7 @@
 
 #include <vnet/fib/fib_types.h>
 #include <vnet/adj/adj.h>
+#include <vppinfra/chunk_pool.h>
 
 /**
  * @brief flags
@@ -90,12 +91,12 @@ extern void fib_urpf_list_show_mem(void);
 /**
  * @brief pool of all fib_urpf_list
  */
-extern fib_urpf_list_t *fib_urpf_list_pool;
+extern chunk_pool_t fib_urpf_list_pool;
 
 static inline fib_urpf_list_t *
 fib_urpf_list_get (index_t index)
 {
-    return (pool_elt_at_index(fib_urpf_list_pool, index));
+    return (chunk_pool_elt_at_index(&fib_urpf_list_pool, index));
 }
 
 /**
@@ -807,6 +807,163 @@ vl_api_ip_route_add_del_v2_t_handler (vl_api_ip_route_add_del_v2_t *mp)
   /* clang-format on */
 }
 
+/*
+ * Do two bulk entries program the same route, i.e. should their paths
+ * be given to the FIB together
+ */
+static int
+ip_route_bulk_entry_same_route (const vl_api_ip_route_bulk_entry_t *r1,
+				const vl_api_ip_route_bulk_entry_t *r2)
+{
+  return (r1->table_id == r2->table_id && r1->is_add == r2->is_add &&
+	  r1->is_multipath == r2->is_multipath &&
+	  0 == memcmp (&r1->prefix, &r2->prefix, sizeof (r1->prefix)));
+}
+
+void
+vl_api_ip_route_add_del_bulk_t_handler (vl_api_ip_route_add_del_bulk_t *mp)
+{
+  vl_api_ip_route_add_del_bulk_reply_t *rmp;
+  fib_route_path_t paths[ARRAY_LEN (mp->paths)], *rpaths = NULL, *rpath;
+  fib_entry_flag_t path_flags[ARRAY_LEN (mp->paths)];
+  const vl_api_ip_route_bulk_entry_t *route;
+  u32 ii, jj, kk, n_routes, n_paths, n_failed;
+  u32 fib_index, table_id;
+  fib_protocol_t fproto;
+  fib_source_t src;
+  i32 *retvals;
+  int rv, rrv;
+
+  n_routes = ntohl (mp->n_routes);
+  n_paths = 0;
+  n_failed = 0;
+  retvals = NULL;
+  rv = 0;
+
+  if (mp->n_paths > ARRAY_LEN (mp->paths))
+    {
+      rv = VNET_API_ERROR_INVALID_VALUE;
+      goto out;
+    }
+
+  /* the decode expects zeroed paths, as vec_validate gives */
+  clib_memset (paths, 0, sizeof (paths));
+  for (n_paths = 0; n_paths < mp->n_paths; n_paths++)
+    {
+      rv = fib_api_path_decode (&mp->paths[n_paths], &paths[n_paths]);
+
+      if (0 != rv)
+	{
+	  vec_free (paths[n_paths].frp_label_stack);
+	  goto out;
+	}
+
+      path_flags[n_paths] = FIB_ENTRY_FLAG_NONE;
+      if ((paths[n_paths].frp_flags & FIB_ROUTE_PATH_LOCAL) &&
+	  (~0 == paths[n_paths].frp_sw_if_index))
+	path_flags[n_paths] |= (FIB_ENTRY_FLAG_CONNECTED |
+				FIB_ENTRY_FLAG_LOCAL);
+    }
+
+  src = (0 == mp->src ? FIB_SOURCE_API : mp->src);
+  vec_resize (retvals, n_routes);
+  fproto = FIB_PROTOCOL_MAX;
+  table_id = ~0;
+  fib_index = ~0;
+
+  /*
+   * a run of entries for the same route is one FIB update with all
+   * the run's paths.
+   */
+  for (ii = 0; ii < n_routes; ii = jj)
+    {
+      fib_entry_flag_t entry_flags;
+      fib_prefix_t pfx;
+
+      route = &mp->routes[ii];
+      entry_flags = FIB_ENTRY_FLAG_NONE;
+      vec_reset_length (rpaths);
+      rrv = 0;
+
+      for (jj = ii; jj < n_routes; jj++)
+	{
+	  const vl_api_ip_route_bulk_entry_t *path_route = &mp->routes[jj];
+
+	  if (!ip_route_bulk_entry_same_route (route, path_route))
+	    break;
+	  /* a delete of the whole route has no paths */
+	  if (!route->is_add && !route->is_multipath)
+	    continue;
+	  if (path_route->path_index >= n_paths)
+	    {
+	      rrv = VNET_API_ERROR_INVALID_VALUE;
+	      continue;
+	    }
+
+	  /* the FIB takes the label stack of the paths it adds */
+	  vec_add2 (rpaths, rpath, 1);
+	  *rpath = paths[path_route->path_index];
+	  rpath->frp_label_stack = vec_dup (rpath->frp_label_stack);
+	  entry_flags |= path_flags[path_route->path_index];
+	}
+
+      ip_prefix_decode (&route->prefix, &pfx);
+
+      /* the runs of routes in the same table save the table lookup */
+      if (0 == rrv &&
+	  (pfx.fp_proto != fproto || ntohl (route->table_id) != table_id))
+	{
+	  rrv = fib_api_table_id_decode (pfx.fp_proto,
+					 ntohl (route->table_id), &fib_index);
+	  if (0 == rrv)
+	    {
+	      fproto = pfx.fp_proto;
+	      table_id = ntohl (route->table_id);
+	    }
+	  else
+	    fproto = FIB_PROTOCOL_MAX;
+	}
+
+      if (0 == rrv)
+	rrv = fib_api_route_add_del (route->is_add, route->is_multipath,
+				     fib_index, &pfx, src, entry_flags,
+				     rpaths);
+
+      if (0 != rrv || !route->is_add)
+	vec_foreach (rpath, rpaths)
+	  vec_free (rpath->frp_label_stack);
+
+      for (kk = ii; kk < jj; kk++)
+	retvals[kk] = htonl (rrv);
+
+      if (0 != rrv)
+	{
+	  n_failed += jj - ii;
+	  if (0 == rv)
+	    rv = rrv;
+	}
+    }
+
+out:
+  for (ii = 0; ii < n_paths; ii++)
+    vec_free (paths[ii].frp_label_stack);
+  vec_free (rpaths);
+
+  /* no result per route if the request itself is bad */
+  n_routes = vec_len (retvals);
+
+  /* clang-format off */
+  REPLY_MACRO3 (VL_API_IP_ROUTE_ADD_DEL_BULK_REPLY, n_routes * sizeof (i32),
+  ({
+    rmp->n_failed = htonl (n_failed);
+    rmp->n_routes = htonl (n_routes);
+    clib_memcpy_fast (rmp->retvals, retvals, n_routes * sizeof (i32));
+  }));
+  /* clang-format on */
+
+  vec_free (retvals);
+}
+
 void
 vl_api_ip_route_lookup_t_handler (vl_api_ip_route_lookup_t * mp)
 {
@@ -2099,6 +2256,8 @@ ip_api_hookup (vlib_main_t * vm)
   am->is_mp_safe[VL_API_IP_ROUTE_ADD_DEL_REPLY] = 1;
   am->is_mp_safe[VL_API_IP_ROUTE_ADD_DEL_V2] = 1;
   am->is_mp_safe[VL_API_IP_ROUTE_ADD_DEL_V2_REPLY] = 1;
+  am->is_mp_safe[VL_API_IP_ROUTE_ADD_DEL_BULK] = 1;
+  am->is_mp_safe[VL_API_IP_ROUTE_ADD_DEL_BULK_REPLY] = 1;
 
   /*
    * Set up the (msg_name, crc, message-id) table
@@ -45,6 +45,8 @@ typedef struct
   /* API message ID base */
   u16 msg_id_base;
   vat_main_t *vat_main;
+  /* routes that failed in the last bulk add/del */
+  u32 bulk_n_failed;
 } ip_test_main_t;
 
 static ip_test_main_t ip_test_main;
@@ -413,6 +415,131 @@ api_ip_route_add_del (vat_main_t *vam)
   return (vam->retval);
 }
 
+static int
+api_ip_route_add_del_bulk (vat_main_t *vam)
+{
+  unformat_input_t *i = vam->input;
+  vl_api_ip_route_add_del_bulk_t *mp;
+  vl_api_ip_route_bulk_entry_t *route;
+  u32 vrf_id = 0;
+  u8 is_add = 1;
+  u8 is_multipath = 0;
+  u8 prefix_set = 0;
+  u8 path_count = 0;
+  vl_api_prefix_t pfx = {};
+  vl_api_fib_path_t paths[16];
+  u32 count = 1, batch = 256, n_failed = 0;
+  u32 j, n, p;
+  f64 before, after;
+  int ret = 0;
+
+  /* Parse args required to build the message */
+  while (unformat_check_input (i) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (i, "%U", unformat_vl_api_prefix, &pfx))
+	prefix_set = 1;
+      else if (unformat (i, "del"))
+	is_add = 0;
+      else if (unformat (i, "add"))
+	is_add = 1;
+      else if (unformat (i, "vrf %d", &vrf_id))
+	;
+      else if (unformat (i, "count %d", &count))
+	;
+      else if (unformat (i, "batch %d", &batch))
+	;
+      else if (unformat (i, "multipath"))
+	is_multipath = 1;
+      else if (unformat (i, "via %U", unformat_fib_path, vam,
+			 &paths[path_count]))
+	{
+	  path_count++;
+	  if (ARRAY_LEN (paths) == path_count)
+	    {
+	      errmsg ("max %d paths", ARRAY_LEN (paths));
+	      return -99;
+	    }
+	}
+      else
+	{
+	  clib_warning ("parse error '%U'", format_unformat_error, i);
+	  return -99;
+	}
+    }
+
+  if (!path_count && (is_add || is_multipath))
+    {
+      errmsg ("specify a path; via ...");
+      return -99;
+    }
+  if (prefix_set == 0)
+    {
+      errmsg ("missing prefix");
+      return -99;
+    }
+  if (batch == 0)
+    {
+      errmsg ("batch must be at least 1");
+      return -99;
+    }
+
+  /* each route is a run of entries, one per path */
+  p = clib_max (path_count, 1);
+  batch = clib_max (batch / p, 1) * p;
+
+  before = vat_time_now (vam);
+
+  for (j = 0; j < count * p; j += n)
+    {
+      n = clib_min (batch, count * p - j);
+
+      /* Construct the API message */
+      M2 (IP_ROUTE_ADD_DEL_BULK, mp, sizeof (*route) * n);
+
+      mp->n_paths = path_count;
+      clib_memcpy (&mp->paths, &paths, sizeof (paths[0]) * path_count);
+      mp->n_routes = htonl (n);
+
+      for (route = mp->routes; route < mp->routes + n; route += p)
+	{
+	  int k;
+
+	  for (k = 0; k < p; k++)
+	    {
+	      route[k].table_id = htonl (vrf_id);
+	      route[k].is_add = is_add;
+	      route[k].is_multipath = is_multipath;
+	      route[k].path_index = k;
+	      clib_memcpy (&route[k].prefix, &pfx, sizeof (pfx));
+	    }
+	  increment_address (&pfx.address);
+	}
+
+      /* send it... */
+      S (mp);
+
+      /* Wait for a reply... */
+      W (ret);
+      if (ret == -99)
+	{
+	  errmsg ("timeout");
+	  return ret;
+	}
+      n_failed += ip_test_main.bulk_n_failed;
+
+      /* If we receive SIGTERM, stop now... */
+      if (vam->do_exit)
+	break;
+    }
+
+  after = vat_time_now (vam);
+
+  print (vam->ofp, "%d routes in %.6f secs, %.2f routes/sec, %d failed",
+	 count, after - before, count / (after - before), n_failed / p);
+
+  return (n_failed ? -98 : 0);
+}
+
 static int
 api_ip_table_add_del (vat_main_t *vam)
 {
@@ -544,6 +671,17 @@ vl_api_ip_route_add_del_v2_reply_t_handler (
 {
 }
 
+static void
+vl_api_ip_route_add_del_bulk_reply_t_handler (
+  vl_api_ip_route_add_del_bulk_reply_t *mp)
+{
+  vat_main_t *vam = ip_test_main.vat_main;
+
+  vam->retval = ntohl (mp->retval);
+  ip_test_main.bulk_n_failed = ntohl (mp->n_failed);
+  vam->result_ready = 1;
+}
+
 static void
 vl_api_ip_route_details_t_handler (vl_api_ip_route_details_t *mp)
 {
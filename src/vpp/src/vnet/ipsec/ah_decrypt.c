@@ -44,7 +44,8 @@ typedef enum
   _ (INTEG_ERROR, "Integrity check failed")     \
   _ (NO_TAIL_SPACE, "not enough buffer tail space (dropped)")     \
   _ (DROP_FRAGMENTS, "IP fragments drop")       \
-  _ (REPLAY, "SA replayed packet")
+  _ (REPLAY, "SA replayed packet")              \
+  _ (REPLAY_OUT_OF_WINDOW, "SA packet out of replay window")
 
 typedef enum
 {
@@ -60,6 +61,14 @@ static char *ah_decrypt_error_strings[] = {
 #undef _
 };
 
+always_inline ah_decrypt_error_t
+ah_decrypt_replay_error (ipsec_sa_anti_replay_result_t ar)
+{
+  return (IPSEC_SA_ANTI_REPLAY_OUT_OF_WINDOW == ar ?
+	    AH_DECRYPT_ERROR_REPLAY_OUT_OF_WINDOW :
+	    AH_DECRYPT_ERROR_REPLAY);
+}
+
 typedef struct
 {
   ipsec_integ_alg_t integ_alg;
@@ -150,6 +159,7 @@ ah_decrypt_inline (vlib_main_t * vm,
   n_left = from_frame->n_vectors;
   ipsec_sa_t *sa0 = 0;
   u32 current_sa_index = ~0, current_sa_bytes = 0, current_sa_pkts = 0;
+  ipsec_sa_anti_replay_result_t ar;
 
   clib_memset (pkt_data, 0, VLIB_FRAME_SIZE * sizeof (pkt_data[0]));
   vlib_get_buffers (vm, from, b, n_left);
@@ -222,10 +232,11 @@ ah_decrypt_inline (vlib_main_t * vm,
       pd->seq = clib_host_to_net_u32 (ah0->seq_no);
 
       /* anti-replay check */
-      if (ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, ~0, false,
-					       &pd->seq_hi))
+      ar = ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, ~0, false,
+						&pd->seq_hi);
+      if (ar)
 	{
-	  b[0]->error = node->errors[AH_DECRYPT_ERROR_REPLAY];
+	  b[0]->error = node->errors[ah_decrypt_replay_error (ar)];
 	  next[0] = AH_DECRYPT_NEXT_DROP;
 	  goto next;
 	}
@@ -325,10 +336,11 @@ ah_decrypt_inline (vlib_main_t * vm,
       if (PREDICT_TRUE (sa0->integ_alg != IPSEC_INTEG_ALG_NONE))
 	{
 	  /* redo the anti-reply check. see esp_decrypt for details */
-	  if (ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, pd->seq_hi,
-						   true, NULL))
+	  ar = ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, pd->seq_hi,
+						    true, NULL);
+	  if (ar)
 	    {
-	      b[0]->error = node->errors[AH_DECRYPT_ERROR_REPLAY];
+	      b[0]->error = node->errors[ah_decrypt_replay_error (ar)];
 	      next[0] = AH_DECRYPT_NEXT_DROP;
 	      goto trace;
 	    }
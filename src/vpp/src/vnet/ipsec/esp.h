@@ -91,7 +91,7 @@ typedef struct esp_aead_t_
 
 u8 *format_esp_header (u8 * s, va_list * args);
 
-/* TODO seq increment should be atomic to be accessed by multiple workers */
+/* only the SA's thread advances the sequence number, see esp_seq_reserve */
 always_inline int
 esp_seq_advance (ipsec_sa_t * sa)
 {
@@ -117,6 +117,36 @@ esp_seq_advance (ipsec_sa_t * sa)
   return 0;
 }
 
+/*
+ * The next sequence number of a multi-worker SA. Each worker takes the
+ * numbers from a block it reserved with a single atomic add, rather than
+ * all the workers contending on the SA's counter for each packet. A block
+ * left idle while the other workers moved the counter on is dropped.
+ */
+always_inline int
+esp_seq_reserve (ipsec_sa_t *sa, u32 thread_index, u64 *seq64)
+{
+  ipsec_sa_seq_block_t *sb =
+    vec_elt_at_index (sa->multi_worker->seq_blocks, thread_index);
+
+  if (PREDICT_FALSE (sb->next == sb->end ||
+		     clib_atomic_load_relax_n (&sa->seq64) - sb->next >=
+		       IPSEC_SA_SEQ_BLOCK_MAX_LAG))
+    {
+      sb->next =
+	clib_atomic_fetch_add (&sa->seq64, IPSEC_SA_SEQ_BLOCK_SIZE) + 1;
+      sb->end = sb->next + IPSEC_SA_SEQ_BLOCK_SIZE;
+    }
+
+  if (PREDICT_FALSE (!ipsec_sa_is_set_USE_ESN (sa) &&
+		     ipsec_sa_is_set_USE_ANTI_REPLAY (sa) &&
+		     sb->next > ESP_SEQ_MAX))
+    return 1;
+
+  *seq64 = sb->next++;
+  return 0;
+}
+
 always_inline u16
 esp_aad_fill (u8 *data, const esp_header_t *esp, const ipsec_sa_t *sa,
 	      u32 seq_hi)
@@ -26,6 +26,7 @@
 #include <vnet/ipsec/ipsec_tun.h>
 
 #include <vnet/gre/packet.h>
+#include <vnet/vxlan/vxlan.h>
 
 #define foreach_esp_decrypt_next                                              \
   _ (DROP, "error-drop")                                                      \
@@ -33,7 +34,8 @@
   _ (IP6_INPUT, "ip6-input")                                                  \
   _ (L2_INPUT, "l2-input")                                                    \
   _ (MPLS_INPUT, "mpls-input")                                                \
-  _ (HANDOFF, "handoff")
+  _ (HANDOFF, "handoff")                                                      \
+  _ (VXLAN4_INPUT, "vxlan4-input")
 
 #define _(v, s) ESP_DECRYPT_NEXT_##v,
 typedef enum
@@ -66,6 +68,7 @@ typedef enum
   _ (INTEG_ERROR, "Integrity check failed")                                   \
   _ (CRYPTO_ENGINE_ERROR, "crypto engine error (packet dropped)")             \
   _ (REPLAY, "SA replayed packet")                                            \
+  _ (REPLAY_OUT_OF_WINDOW, "SA packet out of replay window")                  \
   _ (RUNT, "undersized packet")                                               \
   _ (NO_BUFFERS, "no buffers (packet dropped)")                               \
   _ (OVERSIZED_HEADER, "buffer with oversized header (dropped)")              \
@@ -87,6 +90,14 @@ static char *esp_decrypt_error_strings[] = {
 #undef _
 };
 
+always_inline esp_decrypt_error_t
+esp_decrypt_replay_error (ipsec_sa_anti_replay_result_t ar)
+{
+  return (IPSEC_SA_ANTI_REPLAY_OUT_OF_WINDOW == ar ?
+	    ESP_DECRYPT_ERROR_REPLAY_OUT_OF_WINDOW :
+	    ESP_DECRYPT_ERROR_REPLAY);
+}
+
 typedef struct
 {
   u32 seq;
@@ -783,16 +794,20 @@ esp_decrypt_post_crypto (vlib_main_t *vm, const vlib_node_runtime_t *node,
    * a sequence s, s+1, s+2, s+3, ... s+n and nothing will prevent any
    * implementation, sequential or batching, from decrypting these.
    */
-  if (ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, pd->seq_hi, true,
-					   NULL))
+  ipsec_sa_anti_replay_lock (sa0);
+  ipsec_sa_anti_replay_result_t ar = ipsec_sa_anti_replay_and_sn_advance (
+    sa0, pd->seq, pd->seq_hi, true, NULL);
+  if (ar)
     {
-      b->error = node->errors[ESP_DECRYPT_ERROR_REPLAY];
+      ipsec_sa_anti_replay_unlock (sa0);
+      b->error = node->errors[esp_decrypt_replay_error (ar)];
       next[0] = ESP_DECRYPT_NEXT_DROP;
       return;
     }
 
   u64 n_lost =
     ipsec_sa_anti_replay_advance (sa0, vm->thread_index, pd->seq, pd->seq_hi);
+  ipsec_sa_anti_replay_unlock (sa0);
 
   vlib_prefetch_simple_counter (&ipsec_sa_lost_counters, vm->thread_index,
 				pd->sa_index);
@@ -1014,6 +1029,20 @@ esp_decrypt_post_crypto (vlib_main_t *vm, const vlib_node_runtime_t *node,
 		    }
 		}
 	    }
+
+	  if (PREDICT_FALSE (vxlan_main.n_esp_fused) &&
+	      ESP_DECRYPT_NEXT_IP4_INPUT == next[0] &&
+	      !vnet_have_features (ip4_main.lookup_main.ucast_feature_arc_index,
+				   vnet_buffer (b)->sw_if_index[VLIB_RX]) &&
+	      vxlan4_is_tunnel_packet (&vxlan_main, b))
+	    {
+	      /* VXLAN for a local VTEP, there's nothing for ip4-input and
+	       * ip4-local to do. vxlan4-input expects current at the VXLAN
+	       * header */
+	      vlib_buffer_advance (b, sizeof (ip4_header_t) +
+					sizeof (udp_header_t));
+	      next[0] = ESP_DECRYPT_NEXT_VXLAN4_INPUT;
+	    }
 	}
     }
 
@@ -1053,6 +1082,7 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
   vnet_crypto_async_op_id_t async_op = ~0;
   vnet_crypto_async_frame_t *async_frames[VNET_CRYPTO_ASYNC_OP_N_IDS];
   esp_decrypt_error_t err;
+  ipsec_sa_anti_replay_result_t ar;
 
   vlib_get_buffers (vm, from, b, n_left);
   if (!is_async)
@@ -1112,7 +1142,8 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	  is_async = im->async_mode | ipsec_sa_is_set_IS_ASYNC (sa0);
 	}
 
-      if (PREDICT_FALSE (~0 == sa0->thread_index))
+      if (PREDICT_FALSE (~0 == sa0->thread_index) &&
+	  !(cpd.flags & IPSEC_SA_FLAG_IS_MULTI_WORKER))
 	{
 	  /* this is the first packet to use this SA, claim the SA
 	   * for this thread. this could happen simultaneously on
@@ -1121,7 +1152,8 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 				    ipsec_sa_assign_thread (thread_index));
 	}
 
-      if (PREDICT_FALSE (thread_index != sa0->thread_index))
+      if (PREDICT_FALSE (thread_index != sa0->thread_index) &&
+	  !(cpd.flags & IPSEC_SA_FLAG_IS_MULTI_WORKER))
 	{
 	  vnet_buffer (b[0])->ipsec.thread_index = sa0->thread_index;
 	  err = ESP_DECRYPT_ERROR_HANDOFF;
@@ -1160,10 +1192,13 @@ esp_decrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
       pd->current_length = b[0]->current_length;
 
       /* anti-reply check */
-      if (ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, ~0, false,
-					       &pd->seq_hi))
+      ipsec_sa_anti_replay_lock (sa0);
+      ar = ipsec_sa_anti_replay_and_sn_advance (sa0, pd->seq, ~0, false,
+						&pd->seq_hi);
+      ipsec_sa_anti_replay_unlock (sa0);
+      if (ar)
 	{
-	  err = ESP_DECRYPT_ERROR_REPLAY;
+	  err = esp_decrypt_replay_error (ar);
 	  esp_set_next_index (b[0], node, err, n_noop, noop_nexts,
 			      ESP_DECRYPT_NEXT_DROP);
 	  goto next;
@@ -1484,6 +1519,7 @@ VLIB_REGISTER_NODE (esp4_decrypt_node) = {
     [ESP_DECRYPT_NEXT_MPLS_INPUT] = "mpls-drop",
     [ESP_DECRYPT_NEXT_L2_INPUT] = "l2-input",
     [ESP_DECRYPT_NEXT_HANDOFF] = "esp4-decrypt-handoff",
+    [ESP_DECRYPT_NEXT_VXLAN4_INPUT] = "vxlan4-input",
   },
 };
 
@@ -1516,6 +1552,7 @@ VLIB_REGISTER_NODE (esp6_decrypt_node) = {
     [ESP_DECRYPT_NEXT_MPLS_INPUT] = "mpls-drop",
     [ESP_DECRYPT_NEXT_L2_INPUT] = "l2-input",
     [ESP_DECRYPT_NEXT_HANDOFF]=  "esp6-decrypt-handoff",
+    [ESP_DECRYPT_NEXT_VXLAN4_INPUT] = "vxlan4-input",
   },
 };
 
@@ -1546,6 +1583,7 @@ VLIB_REGISTER_NODE (esp4_decrypt_tun_node) = {
     [ESP_DECRYPT_NEXT_MPLS_INPUT] = "mpls-input",
     [ESP_DECRYPT_NEXT_L2_INPUT] = "l2-input",
     [ESP_DECRYPT_NEXT_HANDOFF] = "esp4-decrypt-tun-handoff",
+    [ESP_DECRYPT_NEXT_VXLAN4_INPUT] = "vxlan4-input",
   },
 };
 
@@ -1576,6 +1614,7 @@ VLIB_REGISTER_NODE (esp6_decrypt_tun_node) = {
     [ESP_DECRYPT_NEXT_MPLS_INPUT] = "mpls-input",
     [ESP_DECRYPT_NEXT_L2_INPUT] = "l2-input",
     [ESP_DECRYPT_NEXT_HANDOFF]=  "esp6-decrypt-tun-handoff",
+    [ESP_DECRYPT_NEXT_VXLAN4_INPUT] = "vxlan4-input",
   },
 };
 
@@ -25,6 +25,7 @@
 #include <vnet/ipsec/ipsec_tun.h>
 #include <vnet/ipsec/esp.h>
 #include <vnet/tunnel/tunnel_dp.h>
+#include <vnet/vxlan/vxlan.h>
 
 #define foreach_esp_encrypt_next                                              \
   _ (DROP4, "ip4-drop")                                                       \
@@ -43,6 +44,9 @@ typedef enum
     ESP_ENCRYPT_N_NEXT,
 } esp_encrypt_next_t;
 
+/* esp4-encrypt-vxlan gives the packets it can't encap back to vxlan4-encap */
+#define ESP_ENCRYPT_NEXT_VXLAN4_ENCAP ESP_ENCRYPT_N_NEXT
+
 #define foreach_esp_encrypt_error                                             \
   _ (RX_PKTS, "ESP pkts received")                                            \
   _ (POST_RX_PKTS, "ESP-post pkts received")                                  \
@@ -52,7 +56,8 @@ typedef enum
   _ (CRYPTO_QUEUE_FULL, "crypto queue full (packet dropped)")                 \
   _ (NO_BUFFERS, "no buffers (packet dropped)")                               \
   _ (NO_PROTECTION, "no protecting SA (packet dropped)")                      \
-  _ (NO_ENCRYPTION, "no Encrypting SA (packet dropped)")
+  _ (NO_ENCRYPTION, "no Encrypting SA (packet dropped)")                      \
+  _ (VXLAN_UNFUSED, "VXLAN pkts passed to vxlan4-encap")
 
 typedef enum
 {
@@ -333,7 +338,7 @@ esp_encrypt_chain_crypto (vlib_main_t * vm, ipsec_per_thread_data_t * ptd,
 
 static_always_inline u32
 esp_encrypt_chain_integ (vlib_main_t * vm, ipsec_per_thread_data_t * ptd,
-			 ipsec_sa_t * sa0, vlib_buffer_t * b,
+			 ipsec_sa_t * sa0, u32 seq_hi, vlib_buffer_t * b,
 			 vlib_buffer_t * lb, u8 icv_sz, u8 * start,
 			 u32 start_len, u8 * digest, u16 * n_ch)
 {
@@ -355,8 +360,8 @@ esp_encrypt_chain_integ (vlib_main_t * vm, ipsec_per_thread_data_t * ptd,
 	  total_len += ch->len = cb->current_length - icv_sz;
 	  if (ipsec_sa_is_set_USE_ESN (sa0))
 	    {
-	      u32 seq_hi = clib_net_to_host_u32 (sa0->seq_hi);
-	      clib_memcpy_fast (digest, &seq_hi, sizeof (seq_hi));
+	      u32 tmp = clib_net_to_host_u32 (seq_hi);
+	      clib_memcpy_fast (digest, &tmp, sizeof (seq_hi));
 	      ch->len += sizeof (seq_hi);
 	      total_len += sizeof (seq_hi);
 	    }
@@ -377,14 +382,29 @@ esp_encrypt_chain_integ (vlib_main_t * vm, ipsec_per_thread_data_t * ptd,
   return total_len;
 }
 
+/*
+ * The IV of the CTR modes, which must not repeat for a key. A multi-worker
+ * SA uses its sequence number, which the workers already reserve without
+ * sharing a counter per packet.
+ */
+static_always_inline u64
+esp_ctr_iv (ipsec_sa_t *sa, u64 seq64)
+{
+  if (PREDICT_FALSE (ipsec_sa_is_set_IS_MULTI_WORKER (sa)))
+    return seq64;
+  return sa->ctr_iv_counter++;
+}
+
 always_inline void
 esp_prepare_sync_op (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 		     vnet_crypto_op_t **crypto_ops,
-		     vnet_crypto_op_t **integ_ops, ipsec_sa_t *sa0, u32 seq_hi,
+		     vnet_crypto_op_t **integ_ops, ipsec_sa_t *sa0, u64 seq64,
 		     u8 *payload, u16 payload_len, u8 iv_sz, u8 icv_sz, u32 bi,
 		     vlib_buffer_t **b, vlib_buffer_t *lb, u32 hdr_len,
 		     esp_header_t *esp)
 {
+  u32 seq_hi = seq64 >> 32;
+
   if (sa0->crypto_enc_op_id)
     {
       vnet_crypto_op_t *op;
@@ -419,7 +439,7 @@ esp_prepare_sync_op (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 	    }
 
 	  nonce->salt = sa0->salt;
-	  nonce->iv = *pkt_iv = clib_host_to_net_u64 (sa0->ctr_iv_counter++);
+	  nonce->iv = *pkt_iv = clib_host_to_net_u64 (esp_ctr_iv (sa0, seq64));
 	  op->iv = (u8 *) nonce;
 	}
       else
@@ -458,7 +478,7 @@ esp_prepare_sync_op (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 	  op->chunk_index = vec_len (ptd->chunks);
 	  op->digest = vlib_buffer_get_tail (lb) - icv_sz;
 
-	  esp_encrypt_chain_integ (vm, ptd, sa0, b[0], lb, icv_sz,
+	  esp_encrypt_chain_integ (vm, ptd, sa0, seq_hi, b[0], lb, icv_sz,
 				   payload - iv_sz - sizeof (esp_header_t),
 				   payload_len + iv_sz +
 				   sizeof (esp_header_t), op->digest,
@@ -476,15 +496,16 @@ esp_prepare_sync_op (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 static_always_inline void
 esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 			 vnet_crypto_async_frame_t *async_frame,
-			 ipsec_sa_t *sa, vlib_buffer_t *b, esp_header_t *esp,
-			 u8 *payload, u32 payload_len, u8 iv_sz, u8 icv_sz,
+			 ipsec_sa_t *sa, u64 seq64, vlib_buffer_t *b,
+			 esp_header_t *esp, u8 *payload, u32 payload_len,
+			 u8 iv_sz, u8 icv_sz,
 			 u32 bi, u16 next, u32 hdr_len, u16 async_next,
 			 vlib_buffer_t *lb)
 {
   esp_post_data_t *post = esp_post_data (b);
   u8 *tag, *iv, *aad = 0;
   u8 flag = 0;
-  u32 key_index;
+  u32 key_index, seq_hi = seq64 >> 32;
   i16 crypto_start_offset, integ_start_offset = 0;
   u16 crypto_total_len, integ_total_len;
 
@@ -509,7 +530,7 @@ esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 	{
 	  /* constuct aad in a scratch space in front of the nonce */
 	  aad = (u8 *) nonce - sizeof (esp_aead_t);
-	  esp_aad_fill (aad, esp, sa, sa->seq_hi);
+	  esp_aad_fill (aad, esp, sa, seq_hi);
 	  key_index = sa->crypto_key_index;
 	}
       else
@@ -518,7 +539,7 @@ esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 	}
 
       nonce->salt = sa->salt;
-      nonce->iv = *pkt_iv = clib_host_to_net_u64 (sa->ctr_iv_counter++);
+      nonce->iv = *pkt_iv = clib_host_to_net_u64 (esp_ctr_iv (sa, seq64));
       iv = (u8 *) nonce;
     }
   else
@@ -544,14 +565,14 @@ esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
       if (b != lb)
 	{
 	  integ_total_len = esp_encrypt_chain_integ (
-	    vm, ptd, sa, b, lb, icv_sz,
+	    vm, ptd, sa, seq_hi, b, lb, icv_sz,
 	    payload - iv_sz - sizeof (esp_header_t),
 	    payload_len + iv_sz + sizeof (esp_header_t), tag, 0);
 	}
       else if (ipsec_sa_is_set_USE_ESN (sa))
 	{
-	  u32 seq_hi = clib_net_to_host_u32 (sa->seq_hi);
-	  clib_memcpy_fast (tag, &seq_hi, sizeof (seq_hi));
+	  u32 tmp = clib_net_to_host_u32 (seq_hi);
+	  clib_memcpy_fast (tag, &tmp, sizeof (seq_hi));
 	  integ_total_len += sizeof (seq_hi);
 	}
     }
@@ -563,10 +584,39 @@ esp_prepare_async_frame (vlib_main_t *vm, ipsec_per_thread_data_t *ptd,
 				  async_next, iv, tag, aad, flag);
 }
 
+/**
+ * The midchain adj through which a VXLAN tunnel's underlay leaves, when
+ * esp4-encrypt-vxlan can stand in for vxlan4-encap, ip4-midchain and
+ * esp4-encrypt-tun, i.e. the adj has an SA to encrypt with and neither a
+ * rewrite, a fixup nor output features to apply. Otherwise invalid.
+ */
+static_always_inline adj_index_t
+esp_vxlan_fused_adj (const vxlan_tunnel_t *t)
+{
+  const ip_adjacency_t *adj;
+  adj_index_t ai;
+
+  if (DPO_ADJACENCY_MIDCHAIN != t->next_dpo.dpoi_type)
+    return ADJ_INDEX_INVALID;
+
+  ai = t->next_dpo.dpoi_index;
+  if (ai >= vec_len (ipsec_tun_protect_sa_by_adj_index) ||
+      INDEX_INVALID == ipsec_tun_protect_sa_by_adj_index[ai])
+    return ADJ_INDEX_INVALID;
+
+  adj = adj_get (ai);
+  if (adj->rewrite_header.data_bytes || adj->sub_type.midchain.fixup_func ||
+      (adj->rewrite_header.flags &
+       (VNET_REWRITE_HAS_FEATURES | VNET_REWRITE_FIXUP_IP4_O_4)))
+    return ADJ_INDEX_INVALID;
+
+  return ai;
+}
+
 always_inline uword
 esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 		    vlib_frame_t *frame, vnet_link_t lt, int is_tun,
-		    u16 async_next_node)
+		    int is_vxlan, u16 async_next_node)
 {
   ipsec_main_t *im = &ipsec_main;
   ipsec_per_thread_data_t *ptd = vec_elt_at_index (im->ptd, vm->thread_index);
@@ -600,6 +650,14 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
   u32 sync_bi[VLIB_FRAME_SIZE];
   u32 noop_bi[VLIB_FRAME_SIZE];
   esp_encrypt_error_t err;
+  vxlan_main_t *vxm = &vxlan_main;
+  vnet_main_t *vnm = vnet_get_main ();
+  vlib_combined_counter_main_t *tx_counter =
+    vnm->interface_main.combined_sw_if_counters + VNET_INTERFACE_COUNTER_TX;
+  u32 vxlan_sw_if_index = ~0, vxlan_mtu = 0, n_unfused = 0;
+  adj_index_t vxlan_ai = ADJ_INDEX_INVALID;
+  vxlan_tunnel_t *vxlan_t = 0;
+  const ip_adjacency_t *vxlan_adj = 0;
 
   vlib_get_buffers (vm, from, b, n_left);
 
@@ -619,6 +677,7 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
       u8 *payload, *next_hdr_ptr;
       u16 payload_len, payload_len_total, n_bufs;
       u32 hdr_len;
+      u64 seq64;
 
       err = ESP_ENCRYPT_ERROR_RX_PKTS;
 
@@ -635,6 +694,47 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 			 CLIB_CACHE_LINE_BYTES, LOAD);
 	}
 
+      if (is_vxlan)
+	{
+	  /* we are a VXLAN tunnel's output node, encap as vxlan4-encap
+	   * would and skip the protected midchain's ip4-midchain */
+	  if (vxlan_sw_if_index != vnet_buffer (b[0])->sw_if_index[VLIB_TX])
+	    {
+	      vxlan_sw_if_index = vnet_buffer (b[0])->sw_if_index[VLIB_TX];
+	      vxlan_t = pool_elt_at_index (
+		vxm->tunnels,
+		vnet_get_sup_hw_interface (vnm, vxlan_sw_if_index)
+		  ->dev_instance);
+	      vxlan_ai = esp_vxlan_fused_adj (vxlan_t);
+	      if (ADJ_INDEX_INVALID != vxlan_ai)
+		{
+		  vxlan_adj = adj_get (vxlan_ai);
+		  vxlan_mtu = vxlan_adj->rewrite_header.max_l3_packet_bytes;
+		}
+	    }
+
+	  if (PREDICT_FALSE (
+		ADJ_INDEX_INVALID == vxlan_ai ||
+		(b[0]->flags & (VNET_BUFFER_F_OFFLOAD | VNET_BUFFER_F_GSO)) ||
+		vlib_buffer_length_in_chain (vm, b[0]) +
+		    sizeof (ip4_vxlan_header_t) >
+		  vxlan_mtu))
+	    {
+	      sa_index0 = INDEX_INVALID;
+	      err = ESP_ENCRYPT_ERROR_VXLAN_UNFUSED;
+	      noop_nexts[n_noop] = ESP_ENCRYPT_NEXT_VXLAN4_ENCAP;
+	      n_unfused++;
+	      goto trace;
+	    }
+
+	  vlib_increment_combined_counter (tx_counter, thread_index,
+					   vxlan_sw_if_index, 1,
+					   vxlan4_encap_one (vm, vxlan_t, b[0]));
+	  vnet_buffer (b[0])->ip.adj_index[VLIB_TX] = vxlan_ai;
+	  vnet_buffer (b[0])->sw_if_index[VLIB_TX] =
+	    vxlan_adj->rewrite_header.sw_if_index;
+	}
+
       if (is_tun)
 	{
 	  /* we are on a ipsec tunnel's feature arc */
@@ -684,7 +784,8 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	  is_async = im->async_mode | ipsec_sa_is_set_IS_ASYNC (sa0);
 	}
 
-      if (PREDICT_FALSE (~0 == sa0->thread_index))
+      if (PREDICT_FALSE (~0 == sa0->thread_index) &&
+	  !ipsec_sa_is_set_IS_MULTI_WORKER (sa0))
 	{
 	  /* this is the first packet to use this SA, claim the SA
 	   * for this thread. this could happen simultaneously on
@@ -693,7 +794,8 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 				    ipsec_sa_assign_thread (thread_index));
 	}
 
-      if (PREDICT_FALSE (thread_index != sa0->thread_index))
+      if (PREDICT_FALSE (thread_index != sa0->thread_index) &&
+	  !ipsec_sa_is_set_IS_MULTI_WORKER (sa0))
 	{
 	  vnet_buffer (b[0])->ipsec.thread_index = sa0->thread_index;
 	  err = ESP_ENCRYPT_ERROR_HANDOFF;
@@ -718,12 +820,24 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	    lb = vlib_get_buffer (vm, lb->next_buffer);
 	}
 
-      if (PREDICT_FALSE (esp_seq_advance (sa0)))
+      if (PREDICT_FALSE (ipsec_sa_is_set_IS_MULTI_WORKER (sa0)))
+	{
+	  if (esp_seq_reserve (sa0, thread_index, &seq64))
+	    {
+	      err = ESP_ENCRYPT_ERROR_SEQ_CYCLED;
+	      esp_set_next_index (b[0], node, err, n_noop, noop_nexts,
+				  drop_next);
+	      goto trace;
+	    }
+	}
+      else if (PREDICT_FALSE (esp_seq_advance (sa0)))
 	{
 	  err = ESP_ENCRYPT_ERROR_SEQ_CYCLED;
 	  esp_set_next_index (b[0], node, err, n_noop, noop_nexts, drop_next);
 	  goto trace;
 	}
+      else
+	seq64 = sa0->seq64;
 
       /* space for IV */
       hdr_len = iv_sz;
@@ -963,7 +1077,7 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	}
 
       esp->spi = spi;
-      esp->seq = clib_net_to_host_u32 (sa0->seq);
+      esp->seq = clib_net_to_host_u32 ((u32) seq64);
 
       if (is_async)
 	{
@@ -980,13 +1094,13 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 	      vec_add1 (ptd->async_frames, async_frames[async_op]);
 	    }
 
-	  esp_prepare_async_frame (vm, ptd, async_frames[async_op], sa0, b[0],
-				   esp, payload, payload_len, iv_sz, icv_sz,
+	  esp_prepare_async_frame (vm, ptd, async_frames[async_op], sa0, seq64,
+				   b[0], esp, payload, payload_len, iv_sz, icv_sz,
 				   from[b - bufs], sync_next[0], hdr_len,
 				   async_next_node, lb);
 	}
       else
-	esp_prepare_sync_op (vm, ptd, crypto_ops, integ_ops, sa0, sa0->seq_hi,
+	esp_prepare_sync_op (vm, ptd, crypto_ops, integ_ops, sa0, seq64,
 			     payload, payload_len, iv_sz, icv_sz, n_sync, b,
 			     lb, hdr_len, esp);
 
@@ -1078,6 +1192,9 @@ esp_encrypt_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
 
   vlib_node_increment_counter (vm, node->node_index, ESP_ENCRYPT_ERROR_RX_PKTS,
 			       frame->n_vectors);
+  if (is_vxlan)
+    vlib_node_increment_counter (vm, node->node_index,
+				 ESP_ENCRYPT_ERROR_VXLAN_UNFUSED, n_unfused);
 
   return frame->n_vectors;
 }
@@ -1172,7 +1289,7 @@ VLIB_NODE_FN (esp4_encrypt_node) (vlib_main_t * vm,
 				  vlib_node_runtime_t * node,
 				  vlib_frame_t * from_frame)
 {
-  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_IP4, 0,
+  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_IP4, 0, 0,
 			     esp_encrypt_async_next.esp4_post_next);
 }
 
@@ -1221,7 +1338,7 @@ VLIB_NODE_FN (esp6_encrypt_node) (vlib_main_t * vm,
 				  vlib_node_runtime_t * node,
 				  vlib_frame_t * from_frame)
 {
-  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_IP6, 0,
+  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_IP6, 0, 0,
 			     esp_encrypt_async_next.esp6_post_next);
 }
 
@@ -1262,7 +1379,7 @@ VLIB_NODE_FN (esp4_encrypt_tun_node) (vlib_main_t * vm,
 				      vlib_node_runtime_t * node,
 				      vlib_frame_t * from_frame)
 {
-  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_IP4, 1,
+  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_IP4, 1, 0,
 			     esp_encrypt_async_next.esp4_tun_post_next);
 }
 
@@ -1312,7 +1429,7 @@ VLIB_NODE_FN (esp6_encrypt_tun_node) (vlib_main_t * vm,
 				      vlib_node_runtime_t * node,
 				      vlib_frame_t * from_frame)
 {
-  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_IP6, 1,
+  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_IP6, 1, 0,
 			     esp_encrypt_async_next.esp6_tun_post_next);
 }
 
@@ -1360,10 +1477,42 @@ VLIB_REGISTER_NODE (esp6_encrypt_tun_post_node) = {
 };
 /* *INDENT-ON* */
 
+VLIB_NODE_FN (esp4_encrypt_vxlan_node)
+(vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *from_frame)
+{
+  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_IP4, 1, 1,
+			     esp_encrypt_async_next.esp4_tun_post_next);
+}
+
+/* the output node of the VXLAN tunnels in esp-fused mode, its async
+ * crypto completes in esp4-encrypt-tun-post, so the next node indices of
+ * the two must match */
+VLIB_REGISTER_NODE (esp4_encrypt_vxlan_node) = {
+  .name = "esp4-encrypt-vxlan",
+  .vector_size = sizeof (u32),
+  .format_trace = format_esp_encrypt_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+
+  .n_errors = ARRAY_LEN(esp_encrypt_error_strings),
+  .error_strings = esp_encrypt_error_strings,
+
+  .n_next_nodes = ESP_ENCRYPT_N_NEXT + 1,
+  .next_nodes = {
+    [ESP_ENCRYPT_NEXT_DROP4] = "ip4-drop",
+    [ESP_ENCRYPT_NEXT_DROP6] = "ip6-drop",
+    [ESP_ENCRYPT_NEXT_DROP_MPLS] = "mpls-drop",
+    [ESP_ENCRYPT_NEXT_HANDOFF4] = "esp4-encrypt-tun-handoff",
+    [ESP_ENCRYPT_NEXT_HANDOFF6] = "esp6-encrypt-tun-handoff",
+    [ESP_ENCRYPT_NEXT_HANDOFF_MPLS] = "esp-mpls-encrypt-tun-handoff",
+    [ESP_ENCRYPT_NEXT_INTERFACE_OUTPUT] = "adj-midchain-tx",
+    [ESP_ENCRYPT_NEXT_VXLAN4_ENCAP] = "vxlan4-encap",
+  },
+};
+
 VLIB_NODE_FN (esp_mpls_encrypt_tun_node)
 (vlib_main_t *vm, vlib_node_runtime_t *node, vlib_frame_t *from_frame)
 {
-  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_MPLS, 1,
+  return esp_encrypt_inline (vm, node, from_frame, VNET_LINK_MPLS, 1, 0,
 			     esp_encrypt_async_next.esp_mpls_tun_post_next);
 }
 
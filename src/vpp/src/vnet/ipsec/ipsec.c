@@ -26,10 +26,13 @@
 #include <vnet/ipsec/ah.h>
 #include <vnet/ipsec/ipsec_tun.h>
 #include <vnet/ipsec/ipsec_itf.h>
+#include <vnet/ipsec/ipsec_spd_fp.h>
 
 /* Flow cache is sized for 1 million flows with a load factor of .25.
  */
 #define IPSEC4_OUT_SPD_DEFAULT_HASH_NUM_BUCKETS (1 << 22)
+#define IPSEC4_IN_SPD_DEFAULT_HASH_NUM_BUCKETS	(1 << 22)
+#define IPSEC6_OUT_SPD_DEFAULT_HASH_NUM_BUCKETS (1 << 22)
 
 ipsec_main_t ipsec_main;
 esp_async_post_next_t esp_encrypt_async_next;
@@ -560,6 +563,24 @@ ipsec_init (vlib_main_t * vm)
   im->ipsec4_out_spd_hash_num_buckets =
     IPSEC4_OUT_SPD_DEFAULT_HASH_NUM_BUCKETS;
 
+  im->ipsec4_in_spd_hash_tbl = NULL;
+  im->input_flow_cache_flag = 0;
+  im->ipsec4_in_spd_flow_cache_entries = 0;
+  im->input_epoch_count = 0;
+  im->ipsec4_in_spd_hash_num_buckets = IPSEC4_IN_SPD_DEFAULT_HASH_NUM_BUCKETS;
+
+  im->ipsec6_out_spd_hash_tbl = NULL;
+  im->output6_flow_cache_flag = 0;
+  im->ipsec6_out_spd_flow_cache_entries = 0;
+  im->output6_epoch_count = 0;
+  im->ipsec6_out_spd_hash_num_buckets =
+    IPSEC6_OUT_SPD_DEFAULT_HASH_NUM_BUCKETS;
+
+  im->input_fp_flag = 0;
+  im->output6_fp_flag = 0;
+  im->fp_num_buckets = IPSEC_FP_DEFAULT_HASH_NUM_BUCKETS;
+  im->fp_memory_size = IPSEC_FP_DEFAULT_HASH_MEMORY_SIZE;
+
   return 0;
 }
 
@@ -571,6 +592,10 @@ ipsec_config (vlib_main_t *vm, unformat_input_t *input)
   ipsec_main_t *im = &ipsec_main;
   unformat_input_t sub_input;
   u32 ipsec4_out_spd_hash_num_buckets;
+  u32 ipsec4_in_spd_hash_num_buckets;
+  u32 ipsec6_out_spd_hash_num_buckets;
+  u32 fp_num_buckets;
+  uword fp_memory_size;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
@@ -585,6 +610,42 @@ ipsec_config (vlib_main_t *vm, unformat_input_t *input)
 	  im->ipsec4_out_spd_hash_num_buckets =
 	    1ULL << max_log2 (ipsec4_out_spd_hash_num_buckets);
 	}
+      else if (unformat (input, "ipv4-inbound-spd-flow-cache on"))
+	im->input_flow_cache_flag = 1;
+      else if (unformat (input, "ipv4-inbound-spd-flow-cache off"))
+	im->input_flow_cache_flag = 0;
+      else if (unformat (input, "ipv4-inbound-spd-hash-buckets %d",
+			 &ipsec4_in_spd_hash_num_buckets))
+	{
+	  /* Size of hash is power of 2 >= number of buckets */
+	  im->ipsec4_in_spd_hash_num_buckets =
+	    1ULL << max_log2 (ipsec4_in_spd_hash_num_buckets);
+	}
+      else if (unformat (input, "ipv6-outbound-spd-flow-cache on"))
+	im->output6_flow_cache_flag = 1;
+      else if (unformat (input, "ipv6-outbound-spd-flow-cache off"))
+	im->output6_flow_cache_flag = 0;
+      else if (unformat (input, "ipv6-outbound-spd-hash-buckets %d",
+			 &ipsec6_out_spd_hash_num_buckets))
+	{
+	  /* Size of hash is power of 2 >= number of buckets */
+	  im->ipsec6_out_spd_hash_num_buckets =
+	    1ULL << max_log2 (ipsec6_out_spd_hash_num_buckets);
+	}
+      else if (unformat (input, "ipv4-inbound-spd-fast-path on"))
+	im->input_fp_flag = 1;
+      else if (unformat (input, "ipv4-inbound-spd-fast-path off"))
+	im->input_fp_flag = 0;
+      else if (unformat (input, "ipv6-outbound-spd-fast-path on"))
+	im->output6_fp_flag = 1;
+      else if (unformat (input, "ipv6-outbound-spd-fast-path off"))
+	im->output6_fp_flag = 0;
+      else if (unformat (input, "spd-fast-path-num-buckets %d",
+			 &fp_num_buckets))
+	im->fp_num_buckets = 1ULL << max_log2 (fp_num_buckets);
+      else if (unformat (input, "spd-fast-path-memory-size %U",
+			 unformat_memory_size, &fp_memory_size))
+	im->fp_memory_size = fp_memory_size;
       else if (unformat (input, "ip4 %U", unformat_vlib_cli_sub_input,
 			 &sub_input))
 	{
@@ -628,6 +689,16 @@ ipsec_config (vlib_main_t *vm, unformat_input_t *input)
       vec_add2 (im->ipsec4_out_spd_hash_tbl, im->ipsec4_out_spd_hash_tbl,
 		im->ipsec4_out_spd_hash_num_buckets);
     }
+  if (im->input_flow_cache_flag)
+    {
+      vec_add2 (im->ipsec4_in_spd_hash_tbl, im->ipsec4_in_spd_hash_tbl,
+		im->ipsec4_in_spd_hash_num_buckets);
+    }
+  if (im->output6_flow_cache_flag)
+    {
+      vec_add2 (im->ipsec6_out_spd_hash_tbl, im->ipsec6_out_spd_hash_tbl,
+		im->ipsec6_out_spd_hash_num_buckets);
+    }
 
   return 0;
 }
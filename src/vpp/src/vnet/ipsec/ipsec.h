@@ -54,6 +54,49 @@ typedef union
   ipsec4_hash_kv_16_8_t kv_16_8;
 } ipsec4_spd_5tuple_t;
 
+typedef struct
+{
+  u64 key[5];
+  u64 value;
+  i32 bucket_lock;
+  u32 un_used;
+} ipsec6_hash_kv_40_8_t;
+
+typedef union
+{
+  struct
+  {
+    ip6_address_t ip6_addr[2];
+    u16 port[2];
+    u8 proto;
+    u8 pad[3];
+  };
+  ipsec6_hash_kv_40_8_t kv_40_8;
+} ipsec6_spd_5tuple_t;
+
+typedef union
+{
+  struct
+  {
+    ip4_address_t ip4_src_addr;
+    ip4_address_t ip4_dest_addr;
+    /* SPI for protect policies, L4 ports for the others */
+    union
+    {
+      u32 spi;
+      struct
+      {
+	u16 lport;
+	u16 rport;
+      };
+    };
+    u8 policy_type;
+    u8 protocol;
+    u8 pad[2];
+  };
+  ipsec4_hash_kv_16_8_t kv_16_8;
+} ipsec4_inbound_spd_tuple_t;
+
 typedef struct
 {
   u8 *name;
@@ -123,6 +166,9 @@ typedef struct
   vnet_crypto_op_t *chained_integ_ops;
   vnet_crypto_op_chunk_t *chunks;
   vnet_crypto_async_frame_t **async_frames;
+  /* IPv6 outbound SPD flow cache statistics */
+  u64 ip6_out_flow_cache_hits;
+  u64 ip6_out_flow_cache_misses;
 } ipsec_per_thread_data_t;
 
 typedef struct
@@ -151,6 +197,8 @@ typedef struct
   uword *ipsec_if_by_sw_if_index;
 
   ipsec4_hash_kv_16_8_t *ipsec4_out_spd_hash_tbl;
+  ipsec4_hash_kv_16_8_t *ipsec4_in_spd_hash_tbl;
+  ipsec6_hash_kv_40_8_t *ipsec6_out_spd_hash_tbl;
   clib_bihash_8_16_t tun4_protect_by_key;
   clib_bihash_24_16_t tun6_protect_by_key;
 
@@ -226,6 +274,24 @@ typedef struct
   u8 async_mode;
   u16 msg_id_base;
   u8 flow_cache_flag;
+
+  /* Number of buckets for inbound flow cache */
+  u32 ipsec4_in_spd_hash_num_buckets;
+  u32 ipsec4_in_spd_flow_cache_entries;
+  u32 input_epoch_count;
+  u8 input_flow_cache_flag;
+
+  /* Number of buckets for IPv6 outbound flow cache */
+  u32 ipsec6_out_spd_hash_num_buckets;
+  u32 ipsec6_out_spd_flow_cache_entries;
+  u32 output6_epoch_count;
+  u8 output6_flow_cache_flag;
+
+  /* SPD fast path (tuple-space classifier) */
+  u8 input_fp_flag;
+  u8 output6_fp_flag;
+  u32 fp_num_buckets;
+  uword fp_memory_size;
 } ipsec_main_t;
 
 typedef enum ipsec_format_flags_t_
@@ -276,6 +342,24 @@ ipsec4_hash_16_8 (ipsec4_hash_kv_16_8_t *v)
 #endif
 }
 
+static_always_inline u64
+ipsec6_hash_40_8 (ipsec6_hash_kv_40_8_t *v)
+{
+#ifdef clib_crc32c_uses_intrinsics
+  return clib_crc32c ((u8 *) v->key, 40);
+#else
+  u64 tmp = v->key[0] ^ v->key[1] ^ v->key[2] ^ v->key[3] ^ v->key[4];
+  return clib_xxhash (tmp);
+#endif
+}
+
+static_always_inline int
+ipsec6_hash_key_compare_40_8 (u64 *a, u64 *b)
+{
+  return ((a[0] ^ b[0]) | (a[1] ^ b[1]) | (a[2] ^ b[2]) | (a[3] ^ b[3]) |
+	  (a[4] ^ b[4])) == 0;
+}
+
 static_always_inline int
 ipsec4_hash_key_compare_16_8 (u64 *a, u64 *b)
 {
@@ -310,6 +394,38 @@ ipsec_spinlock_unlock (i32 *lock)
   clib_atomic_release (lock);
 }
 
+/*
+ * Inbound flow cache entries are valid only when their epoch matches
+ * input_epoch_count. Bumping it invalidates every entry at once; on roll
+ * over the table is cleared so an old entry can never look current.
+ */
+static_always_inline void
+ipsec4_in_spd_flow_cache_invalidate (ipsec_main_t *im)
+{
+  if (im->input_epoch_count == 0xFFFFFFFF)
+    {
+      /* Reset all the entries in flow cache */
+      clib_memset_u8 (im->ipsec4_in_spd_hash_tbl, 0,
+		      im->ipsec4_in_spd_hash_num_buckets *
+			(sizeof (*(im->ipsec4_in_spd_hash_tbl))));
+    }
+  /* Increment epoch counter by 1 */
+  clib_atomic_fetch_add_relax (&im->input_epoch_count, 1);
+  /* Reset spd flow cache counter since all old entries are stale */
+  clib_atomic_store_relax_n (&im->ipsec4_in_spd_flow_cache_entries, 0);
+}
+
+static_always_inline void
+ipsec6_out_spd_flow_cache_invalidate (ipsec_main_t *im)
+{
+  if (im->output6_epoch_count == 0xFFFFFFFF)
+    clib_memset_u8 (im->ipsec6_out_spd_hash_tbl, 0,
+		    im->ipsec6_out_spd_hash_num_buckets *
+		      (sizeof (*(im->ipsec6_out_spd_hash_tbl))));
+  clib_atomic_fetch_add_relax (&im->output6_epoch_count, 1);
+  clib_atomic_store_relax_n (&im->ipsec6_out_spd_flow_cache_entries, 0);
+}
+
 u32 ipsec_register_ah_backend (vlib_main_t * vm, ipsec_main_t * im,
 			       const char *name,
 			       const char *ah4_encrypt_node_name,
@@ -94,6 +94,7 @@ ipsec_sa_add_del_command_fn (vlib_main_t * vm,
   ipsec_key_t ck = { 0 };
   ipsec_key_t ik = { 0 };
   u32 id, spi, salt, sai;
+  u32 anti_replay_window_size;
   int i = 0;
   u16 udp_src, udp_dst;
   int is_add, rv;
@@ -101,6 +102,7 @@ ipsec_sa_add_del_command_fn (vlib_main_t * vm,
   tunnel_t tun = {};
 
   salt = 0;
+  anti_replay_window_size = IPSEC_SA_DEFAULT_REPLAY_WINDOW;
   error = NULL;
   is_add = 0;
   flags = IPSEC_SA_FLAG_NONE;
@@ -157,12 +159,17 @@ ipsec_sa_add_del_command_fn (vlib_main_t * vm,
 	flags |= IPSEC_SA_FLAG_IS_INBOUND;
       else if (unformat (line_input, "use-anti-replay"))
 	flags |= IPSEC_SA_FLAG_USE_ANTI_REPLAY;
+      else if (unformat (line_input, "anti-replay-window %u",
+			 &anti_replay_window_size))
+	;
       else if (unformat (line_input, "use-esn"))
 	flags |= IPSEC_SA_FLAG_USE_ESN;
       else if (unformat (line_input, "udp-encap"))
 	flags |= IPSEC_SA_FLAG_UDP_ENCAP;
       else if (unformat (line_input, "async"))
 	flags |= IPSEC_SA_FLAG_IS_ASYNC;
+      else if (unformat (line_input, "multi-worker"))
+	flags |= IPSEC_SA_FLAG_IS_MULTI_WORKER;
       else
 	{
 	  error = clib_error_return (0, "parse error: '%U'",
@@ -185,8 +192,9 @@ ipsec_sa_add_del_command_fn (vlib_main_t * vm,
 	  goto done;
 	}
       rv = ipsec_sa_add_and_lock (id, spi, proto, crypto_alg, &ck, integ_alg,
-				  &ik, flags, clib_host_to_net_u32 (salt),
-				  udp_src, udp_dst, &tun, &sai);
+				  &ik, flags, anti_replay_window_size,
+				  clib_host_to_net_u32 (salt), udp_src, udp_dst,
+				  &tun, &sai);
     }
   else
     {
@@ -428,7 +436,8 @@ ipsec_spd_show_all (vlib_main_t * vm, ipsec_main_t * im)
     vlib_cli_output(vm, "%U", format_ipsec_spd, spdi);
   }
 
-  if (im->flow_cache_flag)
+  if (im->flow_cache_flag || im->input_flow_cache_flag ||
+      im->output6_flow_cache_flag)
     {
       vlib_cli_output (vm, "%U", format_ipsec_spd_flow_cache);
     }
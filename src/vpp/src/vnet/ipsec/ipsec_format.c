@@ -22,6 +22,7 @@
 #include <vnet/fib/fib_table.h>
 
 #include <vnet/ipsec/ipsec.h>
+#include <vnet/ipsec/ipsec_spd_fp.h>
 #include <vnet/ipsec/ipsec_tun.h>
 #include <vnet/ipsec/ipsec_itf.h>
 
@@ -227,6 +228,9 @@ format_ipsec_spd (u8 * s, va_list * args)
   foreach_ipsec_spd_policy_type;
 #undef _
 
+  if (im->input_fp_flag || im->output6_fp_flag)
+    s = format (s, "%U", format_ipsec_spd_fp, spd);
+
 done:
   return (s);
 }
@@ -236,8 +240,27 @@ format_ipsec_spd_flow_cache (u8 *s, va_list *args)
 {
   ipsec_main_t *im = &ipsec_main;
 
-  s = format (s, "\nip4-outbound-spd-flow-cache-entries: %u",
-	      im->ipsec4_out_spd_flow_cache_entries);
+  if (im->flow_cache_flag)
+    s = format (s, "\nip4-outbound-spd-flow-cache-entries: %u",
+		im->ipsec4_out_spd_flow_cache_entries);
+  if (im->input_flow_cache_flag)
+    s = format (s, "\nip4-inbound-spd-flow-cache-entries: %u",
+		im->ipsec4_in_spd_flow_cache_entries);
+  if (im->output6_flow_cache_flag)
+    {
+      ipsec_per_thread_data_t *ptd;
+      u64 hits = 0, misses = 0;
+
+      vec_foreach (ptd, im->ptd)
+	{
+	  hits += ptd->ip6_out_flow_cache_hits;
+	  misses += ptd->ip6_out_flow_cache_misses;
+	}
+      s = format (s, "\nip6-outbound-spd-flow-cache-entries: %u",
+		  im->ipsec6_out_spd_flow_cache_entries);
+      s = format (s, "\nip6-outbound-spd-flow-cache-hits: %lu", hits);
+      s = format (s, "\nip6-outbound-spd-flow-cache-misses: %lu", misses);
+    }
 
   return (s);
 }
@@ -305,8 +328,10 @@ format_ipsec_sa (u8 * s, va_list * args)
   s = format (s, "\n   salt 0x%x", clib_net_to_host_u32 (sa->salt));
   s = format (s, "\n   thread-index:%d", sa->thread_index);
   s = format (s, "\n   seq %u seq-hi %u", sa->seq, sa->seq_hi);
+  s = format (s, "\n   window-size: %u",
+	      IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE (sa));
   s = format (s, "\n   window %U", format_ipsec_replay_window,
-	      sa->replay_window);
+	      ipsec_sa_anti_replay_get_64b_window (sa));
   s = format (s, "\n   crypto alg %U",
 	      format_ipsec_crypto_alg, sa->crypto_alg);
   if (sa->crypto_alg && (flags & IPSEC_FORMAT_INSECURE))
@@ -0,0 +1,864 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __IPSEC_INPUT_H__
+#define __IPSEC_INPUT_H__
+
+#include <vnet/vnet.h>
+#include <vnet/ip/ip.h>
+#include <vnet/feature/feature.h>
+
+#include <vnet/ipsec/ipsec.h>
+#include <vnet/ipsec/esp.h>
+#include <vnet/ipsec/ah.h>
+#include <vnet/ipsec/ipsec_io.h>
+#include <vnet/ipsec/ipsec_spd_fp.h>
+
+typedef struct
+{
+  ip_protocol_t proto;
+  u32 spd;
+  u32 policy_index;
+  u32 sa_id;
+  u32 spi;
+  u32 seq;
+} ipsec_input_trace_t;
+
+typedef struct
+{
+  u64 unprocessed;
+  u64 matched;
+  u64 dropped;
+  u64 bypassed;
+  /* policy counter updates not applied yet, all for last_policy_index */
+  u32 last_policy_index;
+  u32 n_policy_packets;
+  u64 n_policy_bytes;
+} ipsec_input_counters_t;
+
+always_inline void
+ipsec_input_policy_counters_flush (ipsec_input_counters_t *cnt,
+				   u32 thread_index)
+{
+  if (cnt->n_policy_packets)
+    vlib_increment_combined_counter (
+      &ipsec_spd_policy_counters, thread_index, cnt->last_policy_index,
+      cnt->n_policy_packets, cnt->n_policy_bytes);
+  cnt->n_policy_packets = 0;
+  cnt->n_policy_bytes = 0;
+}
+
+/*
+ * Count a packet against a policy. Consecutive packets of a frame mostly
+ * hit the same policy, so updates are accumulated until it changes.
+ */
+always_inline void
+ipsec_input_policy_count (ipsec_input_counters_t *cnt, u32 thread_index,
+			  u32 policy_index, u32 n_bytes)
+{
+  if (PREDICT_FALSE (policy_index != cnt->last_policy_index))
+    {
+      ipsec_input_policy_counters_flush (cnt, thread_index);
+      cnt->last_policy_index = policy_index;
+    }
+  cnt->n_policy_packets += 1;
+  cnt->n_policy_bytes += n_bytes;
+}
+
+/*
+ * Match of the inbound bypass and discard policies. Ports are in host
+ * byte order; lp is the packet's destination port.
+ */
+always_inline ipsec_policy_t *
+ipsec_input_policy_match (ipsec_spd_t *spd, u32 sa, u32 da, u8 pr, u16 lp,
+			  u16 rp, ipsec_spd_policy_type_t policy_type)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_policy_t *p;
+  u32 *i;
+
+  vec_foreach (i, spd->policies[policy_type])
+  {
+    p = pool_elt_at_index (im->policies, *i);
+
+    if (PREDICT_FALSE (p->protocol && (p->protocol != pr)))
+      continue;
+
+    if (da < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
+      continue;
+
+    if (da > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
+      continue;
+
+    if (sa < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
+      continue;
+
+    if (sa > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
+      continue;
+
+    if (PREDICT_TRUE (!ipsec_fp_proto_has_ports (pr)))
+      return p;
+
+    if (lp < p->lport.start)
+      continue;
+
+    if (lp > p->lport.stop)
+      continue;
+
+    if (rp < p->rport.start)
+      continue;
+
+    if (rp > p->rport.stop)
+      continue;
+
+    return p;
+  }
+  return 0;
+}
+
+always_inline ipsec_policy_t *
+ipsec_input_protect_policy_match (ipsec_spd_t * spd, u32 sa, u32 da, u32 spi)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_policy_t *p;
+  ipsec_sa_t *s;
+  u32 *i;
+
+  vec_foreach (i, spd->policies[IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT])
+  {
+    p = pool_elt_at_index (im->policies, *i);
+    s = ipsec_sa_get (p->sa_index);
+
+    if (spi != s->spi)
+      continue;
+
+    if (ipsec_sa_is_set_IS_TUNNEL (s))
+      {
+	if (da != clib_net_to_host_u32 (s->tunnel.t_dst.ip.ip4.as_u32))
+	  continue;
+
+	if (sa != clib_net_to_host_u32 (s->tunnel.t_src.ip.ip4.as_u32))
+	  continue;
+
+	return p;
+      }
+
+    if (da < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
+      continue;
+
+    if (da > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
+      continue;
+
+    if (sa < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
+      continue;
+
+    if (sa > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
+      continue;
+
+    return p;
+  }
+  return 0;
+}
+
+always_inline void
+ipsec4_in_spd_add_flow_cache_entry (ipsec_main_t *im,
+				    ipsec4_inbound_spd_tuple_t *ip4_tuple,
+				    u32 pol_id)
+{
+  u64 hash;
+  u8 overwrite = 0, stale_overwrite = 0;
+
+  ip4_tuple->kv_16_8.value =
+    (((u64) pol_id) << 32) | ((u64) im->input_epoch_count);
+
+  hash = ipsec4_hash_16_8 (&ip4_tuple->kv_16_8);
+  hash &= (im->ipsec4_in_spd_hash_num_buckets - 1);
+
+  ipsec_spinlock_lock (&im->ipsec4_in_spd_hash_tbl[hash].bucket_lock);
+  /* As for the outbound cache, overwriting a stale entry still counts as
+   * a new entry since the counter is reset on invalidation */
+  overwrite = (im->ipsec4_in_spd_hash_tbl[hash].value != 0);
+  if (PREDICT_FALSE (overwrite))
+    stale_overwrite =
+      (im->input_epoch_count !=
+       ((u32) (im->ipsec4_in_spd_hash_tbl[hash].value & 0xFFFFFFFF)));
+  clib_memcpy_fast (&im->ipsec4_in_spd_hash_tbl[hash], &ip4_tuple->kv_16_8,
+		    sizeof (ip4_tuple->kv_16_8));
+  ipsec_spinlock_unlock (&im->ipsec4_in_spd_hash_tbl[hash].bucket_lock);
+
+  if (!overwrite || stale_overwrite)
+    clib_atomic_fetch_add_relax (&im->ipsec4_in_spd_flow_cache_entries, 1);
+}
+
+/*
+ * Match a packet against the policies of the given type of the SPD with
+ * the fast path classifier or a walk of the SPD, and add the result to
+ * the flow cache. The tuple holds the addresses, SPI and ports in network
+ * byte order; protect policies are matched on the SPI, bypass and discard
+ * policies on the protocol and ports.
+ */
+static never_inline ipsec_policy_t *
+ipsec4_input_spd_match (ipsec_main_t *im, ipsec_spd_t *spd,
+			ipsec4_inbound_spd_tuple_t *ip4_tuple)
+{
+  ipsec_spd_policy_type_t policy_type = ip4_tuple->policy_type;
+  u32 sa = clib_net_to_host_u32 (ip4_tuple->ip4_src_addr.as_u32);
+  u32 da = clib_net_to_host_u32 (ip4_tuple->ip4_dest_addr.as_u32);
+  ipsec_policy_t *p = NULL;
+
+  if (im->input_fp_flag)
+    {
+      ipsec_fp_ip4_tuple_t t = {
+	.laddr = da,
+	.raddr = sa,
+	.protocol = ip4_tuple->protocol,
+      };
+      if (policy_type == IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT)
+	t.spi = clib_net_to_host_u32 (ip4_tuple->spi);
+      else
+	{
+	  t.lport = clib_net_to_host_u16 (ip4_tuple->lport);
+	  t.rport = clib_net_to_host_u16 (ip4_tuple->rport);
+	}
+      p = ipsec_fp_ip4_lookup (im, spd, policy_type, &t);
+    }
+  else if (policy_type == IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT)
+    p = ipsec_input_protect_policy_match (
+      spd, sa, da, clib_net_to_host_u32 (ip4_tuple->spi));
+  else
+    p = ipsec_input_policy_match (spd, sa, da, ip4_tuple->protocol,
+				  clib_net_to_host_u16 (ip4_tuple->lport),
+				  clib_net_to_host_u16 (ip4_tuple->rport),
+				  policy_type);
+
+  if (p && im->input_flow_cache_flag)
+    ipsec4_in_spd_add_flow_cache_entry (im, ip4_tuple, p - im->policies);
+
+  return p;
+}
+
+always_inline uword
+ip6_addr_match_range (ip6_address_t * a, ip6_address_t * la,
+		      ip6_address_t * ua)
+{
+  if ((memcmp (a->as_u64, la->as_u64, 2 * sizeof (u64)) >= 0) &&
+      (memcmp (a->as_u64, ua->as_u64, 2 * sizeof (u64)) <= 0))
+    return 1;
+  return 0;
+}
+
+always_inline ipsec_policy_t *
+ipsec6_input_protect_policy_match (ipsec_spd_t * spd,
+				   ip6_address_t * sa,
+				   ip6_address_t * da, u32 spi)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_policy_t *p;
+  ipsec_sa_t *s;
+  u32 *i;
+
+  vec_foreach (i, spd->policies[IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT])
+  {
+    p = pool_elt_at_index (im->policies, *i);
+    s = ipsec_sa_get (p->sa_index);
+
+    if (spi != s->spi)
+      continue;
+
+    if (ipsec_sa_is_set_IS_TUNNEL (s))
+      {
+	if (!ip6_address_is_equal (sa, &s->tunnel.t_src.ip.ip6))
+	  continue;
+
+	if (!ip6_address_is_equal (da, &s->tunnel.t_dst.ip.ip6))
+	  continue;
+
+	return p;
+      }
+
+    if (!ip6_addr_match_range (sa, &p->raddr.start.ip6, &p->raddr.stop.ip6))
+      continue;
+
+    if (!ip6_addr_match_range (da, &p->laddr.start.ip6, &p->laddr.stop.ip6))
+      continue;
+
+    return p;
+  }
+  return 0;
+}
+
+/*
+ * A packet of ipsec4-input between the classification steps. The packets
+ * of a quad go through each step together, so that their flow cache and
+ * policy reads are in flight at the same time.
+ */
+typedef struct
+{
+  ipsec_spd_t *spd;
+  ip4_header_t *ip;
+  esp_header_t *esp;
+  ah_header_t *ah;
+  ipsec_policy_t *policy;
+  ipsec4_inbound_spd_tuple_t tuple;
+  u64 bucket;
+  /* policy of the flow cache hit, ~0 if none */
+  u32 cached_index;
+  /* policy the packet is counted against, ~0 if none */
+  u32 policy_index;
+  u32 spi;
+  u16 lp, rp;
+  u8 has_space;
+  /* ESP or AH, the others are left alone */
+  u8 is_ipsec;
+  u8 done;
+  /* same SPD and tuple as the previous packet, which has the policy */
+  u8 same_as_prev;
+} ipsec4_input_pkt_t;
+
+/* Find the SPD and the ESP or AH header of the packet */
+always_inline void
+ipsec4_input_parse (ipsec_main_t *im, vlib_buffer_t *b, u16 *next,
+		    ipsec_input_counters_t *cnt, ipsec4_input_pkt_t *pkt)
+{
+  ip4_ipsec_config_t *c0;
+  ip4_header_t *ip0;
+  u32 next32;
+  u8 *hdr_end0;
+
+  b->flags |= VNET_BUFFER_F_IS_IP4;
+  b->flags &= ~VNET_BUFFER_F_IS_IP6;
+  c0 = vnet_feature_next_with_data (&next32, b, sizeof (c0[0]));
+  next[0] = (u16) next32;
+
+  pkt->spd = pool_elt_at_index (im->spds, c0->spd_index);
+  pkt->ip = ip0 = vlib_buffer_get_current (b);
+  pkt->esp = 0;
+  pkt->ah = 0;
+  pkt->policy = 0;
+  pkt->policy_index = ~0;
+  pkt->lp = pkt->rp = 0;
+  pkt->has_space = 0;
+  pkt->is_ipsec = 1;
+  pkt->done = 0;
+
+  if (PREDICT_TRUE (ip0->protocol == IP_PROTOCOL_IPSEC_ESP ||
+		    ip0->protocol == IP_PROTOCOL_UDP))
+    {
+      pkt->esp = (esp_header_t *) ((u8 *) ip0 + ip4_header_bytes (ip0));
+      if (PREDICT_FALSE (ip0->protocol == IP_PROTOCOL_UDP))
+	{
+	  /* FIXME Skip, if not a UDP encapsulated packet */
+	  pkt->esp = (esp_header_t *) ((u8 *) pkt->esp + sizeof (udp_header_t));
+	}
+      pkt->spi = pkt->esp->spi;
+      hdr_end0 = (u8 *) (pkt->esp + 1);
+    }
+  else if (ip0->protocol == IP_PROTOCOL_IPSEC_AH)
+    {
+      pkt->ah = (ah_header_t *) ((u8 *) ip0 + ip4_header_bytes (ip0));
+      pkt->spi = pkt->ah->spi;
+      hdr_end0 = (u8 *) (pkt->ah + 1);
+    }
+  else
+    {
+      cnt->unprocessed += 1;
+      pkt->is_ipsec = 0;
+      pkt->done = 1;
+      return;
+    }
+
+  pkt->has_space = vlib_buffer_has_space (b, hdr_end0 - (u8 *) ip0);
+}
+
+/* Bypass and discard policies may select on the L4 ports */
+always_inline void
+ipsec4_input_parse_ports (vlib_buffer_t *b, ipsec4_input_pkt_t *pkt)
+{
+  ip4_header_t *ip0 = pkt->ip;
+  udp_header_t *udp0;
+
+  if (!ipsec_fp_proto_has_ports (ip0->protocol))
+    return;
+
+  udp0 = (udp_header_t *) ((u8 *) ip0 + ip4_header_bytes (ip0));
+  if (vlib_buffer_has_space (b, (u8 *) (udp0 + 1) - (u8 *) ip0))
+    {
+      pkt->lp = udp0->dst_port;
+      pkt->rp = udp0->src_port;
+    }
+}
+
+/*
+ * Fill in the tuple of the packet for the policy type and start reading
+ * its flow cache bucket.
+ */
+always_inline void
+ipsec4_input_set_tuple (ipsec_main_t *im, ipsec4_input_pkt_t *pkt,
+			ipsec_spd_policy_type_t policy_type)
+{
+  ipsec4_inbound_spd_tuple_t *t = &pkt->tuple;
+  ip4_header_t *ip0 = pkt->ip;
+
+  *t = (ipsec4_inbound_spd_tuple_t){
+    .ip4_src_addr = ip0->src_address,
+    .ip4_dest_addr = ip0->dst_address,
+    .policy_type = policy_type,
+  };
+  if (policy_type == IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT)
+    t->spi = pkt->spi;
+  else
+    {
+      t->protocol = ip0->protocol;
+      if (ipsec_fp_proto_has_ports (ip0->protocol))
+	{
+	  t->lport = pkt->lp;
+	  t->rport = pkt->rp;
+	}
+    }
+
+  pkt->policy = 0;
+  pkt->cached_index = ~0;
+
+  if (im->input_flow_cache_flag)
+    {
+      pkt->bucket = ipsec4_hash_16_8 (&t->kv_16_8) &
+		    (im->ipsec4_in_spd_hash_num_buckets - 1);
+      clib_prefetch_load (&im->ipsec4_in_spd_hash_tbl[pkt->bucket]);
+    }
+}
+
+/* Read the flow cache bucket and start reading the policy it points to */
+always_inline void
+ipsec4_input_read_flow_cache (ipsec_main_t *im, ipsec4_input_pkt_t *pkt)
+{
+  ipsec4_hash_kv_16_8_t kv;
+
+  ipsec_spinlock_lock (&im->ipsec4_in_spd_hash_tbl[pkt->bucket].bucket_lock);
+  kv = im->ipsec4_in_spd_hash_tbl[pkt->bucket];
+  ipsec_spinlock_unlock (
+    &im->ipsec4_in_spd_hash_tbl[pkt->bucket].bucket_lock);
+
+  if (ipsec4_hash_key_compare_16_8 ((u64 *) &pkt->tuple.kv_16_8,
+				    (u64 *) &kv) &&
+      im->input_epoch_count == ((u32) (kv.value & 0xFFFFFFFF)))
+    {
+      pkt->cached_index = (u32) (kv.value >> 32);
+      clib_prefetch_load (pool_elt_at_index (im->policies, pkt->cached_index));
+    }
+}
+
+/*
+ * Compared field by field: the tuple was just written that way and
+ * reading it back as the two key words would stall on the stores.
+ */
+always_inline int
+ipsec4_input_same_tuple (ipsec4_input_pkt_t *a, ipsec4_input_pkt_t *b)
+{
+  return !a->done && a->spd == b->spd &&
+	 a->tuple.ip4_src_addr.as_u32 == b->tuple.ip4_src_addr.as_u32 &&
+	 a->tuple.ip4_dest_addr.as_u32 == b->tuple.ip4_dest_addr.as_u32 &&
+	 a->tuple.spi == b->tuple.spi && a->tuple.protocol == b->tuple.protocol;
+}
+
+/*
+ * Look up the policies of the type for the packets not classified yet:
+ * the tuples and flow cache reads of all of them first, then the policy
+ * reads, then the classifier or SPD walk for the misses. A packet with the
+ * same SPD and tuple as the previous one takes its policy.
+ */
+always_inline void
+ipsec4_input_lookup_n (ipsec_main_t *im, ipsec4_input_pkt_t *pkts, u32 n,
+		       ipsec_spd_policy_type_t policy_type)
+{
+  ipsec4_input_pkt_t *pkt;
+  u32 i;
+
+  for (i = 0; i < n; i++)
+    {
+      pkt = pkts + i;
+      if (pkt->done)
+	continue;
+      ipsec4_input_set_tuple (im, pkt, policy_type);
+      pkt->same_as_prev = i && ipsec4_input_same_tuple (pkts + i - 1, pkt);
+    }
+
+  if (im->input_flow_cache_flag)
+    for (i = 0; i < n; i++)
+      if (!pkts[i].done && !pkts[i].same_as_prev)
+	ipsec4_input_read_flow_cache (im, pkts + i);
+
+  for (i = 0; i < n; i++)
+    {
+      pkt = pkts + i;
+      if (pkt->done)
+	continue;
+      if (i && pkt->same_as_prev)
+	{
+	  pkt->policy = pkts[i - 1].policy;
+	  continue;
+	}
+      if (pkt->cached_index != ~0)
+	{
+	  pkt->policy = pool_elt_at_index (im->policies, pkt->cached_index);
+	  /* the cache is shared by all SPDs, the policy's tells them apart */
+	  if (PREDICT_TRUE (pkt->policy->id == pkt->spd->id))
+	    continue;
+	}
+      pkt->policy = ipsec4_input_spd_match (im, pkt->spd, &pkt->tuple);
+    }
+}
+
+always_inline void
+ipsec4_input_trace (vlib_main_t *vm, vlib_node_runtime_t *node,
+		    vlib_buffer_t *b, ipsec4_input_pkt_t *pkt)
+{
+  ipsec_input_trace_t *tr = vlib_add_trace (vm, node, b, sizeof (*tr));
+  ipsec_policy_t *p0 = pkt->policy;
+
+  tr->proto = pkt->ip->protocol;
+  tr->sa_id = p0 ? p0->sa_id : ~0;
+  tr->spi = pkt->has_space ? clib_net_to_host_u32 (pkt->spi) : ~0;
+  tr->seq = pkt->has_space ? clib_net_to_host_u32 (pkt->esp ? pkt->esp->seq :
+							      pkt->ah->seq_no) :
+			     ~0;
+  tr->spd = pkt->spd->id;
+  tr->policy_index = pkt->policy_index;
+}
+
+/*
+ * Classify n packets, at most four, against the inbound SPD of their
+ * interface: protect, then bypass, then discard policies. Each step runs
+ * for all the packets still unclassified before the next one.
+ */
+always_inline void
+ipsec4_input_n (vlib_main_t *vm, vlib_node_runtime_t *node, ipsec_main_t *im,
+		vlib_buffer_t **b, u16 *next, ipsec_input_counters_t *cnt,
+		u32 n)
+{
+  ipsec4_input_pkt_t pkts[4], *pkt;
+  u32 i;
+
+  for (i = 0; i < n; i++)
+    ipsec4_input_parse (im, b[i], next + i, cnt, pkts + i);
+
+  ipsec4_input_lookup_n (im, pkts, n, IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT);
+
+  for (i = 0; i < n; i++)
+    {
+      pkt = pkts + i;
+      if (pkt->done)
+	continue;
+      if (PREDICT_TRUE ((pkt->policy != NULL) & (pkt->has_space)))
+	{
+	  cnt->matched += 1;
+
+	  pkt->policy_index = pkt->policy - im->policies;
+	  ipsec_input_policy_count (cnt, vm->thread_index, pkt->policy_index,
+				    clib_net_to_host_u16 (pkt->ip->length));
+
+	  vnet_buffer (b[i])->ipsec.sad_index = pkt->policy->sa_index;
+	  if (pkt->esp)
+	    {
+	      next[i] = im->esp4_decrypt_next_index;
+	      vlib_buffer_advance (b[i], ((u8 *) pkt->esp - (u8 *) pkt->ip));
+	    }
+	  else
+	    next[i] = im->ah4_decrypt_next_index;
+	  pkt->done = 1;
+	  continue;
+	}
+      ipsec4_input_parse_ports (b[i], pkt);
+    }
+
+  ipsec4_input_lookup_n (im, pkts, n, IPSEC_SPD_POLICY_IP4_INBOUND_BYPASS);
+
+  for (i = 0; i < n; i++)
+    {
+      pkt = pkts + i;
+      if (pkt->done || !pkt->policy)
+	continue;
+      cnt->bypassed += 1;
+
+      pkt->policy_index = pkt->policy - im->policies;
+      ipsec_input_policy_count (cnt, vm->thread_index, pkt->policy_index,
+				clib_net_to_host_u16 (pkt->ip->length));
+      pkt->done = 1;
+    }
+
+  ipsec4_input_lookup_n (im, pkts, n, IPSEC_SPD_POLICY_IP4_INBOUND_DISCARD);
+
+  for (i = 0; i < n; i++)
+    {
+      pkt = pkts + i;
+      if (pkt->done || !pkt->policy)
+	continue;
+      cnt->dropped += 1;
+
+      pkt->policy_index = pkt->policy - im->policies;
+      ipsec_input_policy_count (cnt, vm->thread_index, pkt->policy_index,
+				clib_net_to_host_u16 (pkt->ip->length));
+
+      next[i] = IPSEC_INPUT_NEXT_DROP;
+    }
+
+  if (PREDICT_FALSE (node->flags & VLIB_NODE_FLAG_TRACE))
+    for (i = 0; i < n; i++)
+      if (pkts[i].is_ipsec &&
+	  PREDICT_FALSE (b[i]->flags & VLIB_BUFFER_IS_TRACED))
+	ipsec4_input_trace (vm, node, b[i], pkts + i);
+}
+
+/*
+ * Classify a vector of IPv4 packets, filling in their next nodes.
+ * Packets are handled four at a time, with the buffer headers and data of
+ * the following ones prefetched, unless quad_loop is zero, which is only
+ * meant for comparing both loops.
+ */
+always_inline void
+ipsec4_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
+		     vlib_buffer_t **b, u16 *next, u32 n_left,
+		     ipsec_input_counters_t *cnt, int quad_loop)
+{
+  ipsec_main_t *im = &ipsec_main;
+  u8 flow_cache_enabled = im->input_flow_cache_flag;
+
+  while (quad_loop && n_left >= 8)
+    {
+      if (n_left >= 12)
+	{
+	  vlib_prefetch_buffer_header (b[8], LOAD);
+	  vlib_prefetch_buffer_header (b[9], LOAD);
+	  vlib_prefetch_buffer_header (b[10], LOAD);
+	  vlib_prefetch_buffer_header (b[11], LOAD);
+	}
+      vlib_prefetch_buffer_data (b[4], LOAD);
+      vlib_prefetch_buffer_data (b[5], LOAD);
+      vlib_prefetch_buffer_data (b[6], LOAD);
+      vlib_prefetch_buffer_data (b[7], LOAD);
+
+      /*
+       * Without the flow cache the lookups are SPD walks or classifier
+       * probes with no reads to overlap, so the packets go one at a time
+       */
+      if (flow_cache_enabled)
+	ipsec4_input_n (vm, node, im, b, next, cnt, 4);
+      else
+	{
+	  ipsec4_input_n (vm, node, im, b + 0, next + 0, cnt, 1);
+	  ipsec4_input_n (vm, node, im, b + 1, next + 1, cnt, 1);
+	  ipsec4_input_n (vm, node, im, b + 2, next + 2, cnt, 1);
+	  ipsec4_input_n (vm, node, im, b + 3, next + 3, cnt, 1);
+	}
+
+      b += 4;
+      next += 4;
+      n_left -= 4;
+    }
+
+  while (n_left > 0)
+    {
+      if (n_left > 1)
+	vlib_prefetch_buffer_data (b[1], LOAD);
+
+      ipsec4_input_n (vm, node, im, b, next, cnt, 1);
+
+      b += 1;
+      next += 1;
+      n_left -= 1;
+    }
+
+  ipsec_input_policy_counters_flush (cnt, vm->thread_index);
+}
+
+/*
+ * A packet of ipsec6-input between the classification steps, as for
+ * ipsec4-input. IPv6 has no flow cache: the SPD walks of a quad run back
+ * to back once all the headers are parsed and the heads of the walks are
+ * in flight, and a packet of the same SA as the previous one skips its walk.
+ */
+typedef struct
+{
+  ipsec_spd_t *spd;
+  ip6_header_t *ip;
+  esp_header_t *esp;
+  ipsec_policy_t *policy;
+  u32 policy_index;
+  u32 spi;
+  u8 is_ipsec;
+} ipsec6_input_pkt_t;
+
+always_inline void
+ipsec6_input_parse (ipsec_main_t *im, vlib_buffer_t *b, u16 *next,
+		    ipsec_input_counters_t *cnt, ipsec6_input_pkt_t *pkt)
+{
+  ip4_ipsec_config_t *c0;
+  ip6_header_t *ip0;
+  u32 next32, *pi;
+
+  b->flags |= VNET_BUFFER_F_IS_IP6;
+  b->flags &= ~VNET_BUFFER_F_IS_IP4;
+  c0 = vnet_feature_next_with_data (&next32, b, sizeof (c0[0]));
+  next[0] = (u16) next32;
+
+  pkt->spd = pool_elt_at_index (im->spds, c0->spd_index);
+  pkt->ip = ip0 = vlib_buffer_get_current (b);
+  pkt->esp = (esp_header_t *) (ip0 + 1);
+  pkt->policy = 0;
+  pkt->policy_index = ~0;
+
+  if (PREDICT_TRUE (ip0->protocol == IP_PROTOCOL_IPSEC_ESP))
+    pkt->spi = clib_net_to_host_u32 (pkt->esp->spi);
+  else if (ip0->protocol == IP_PROTOCOL_IPSEC_AH)
+    pkt->spi = clib_net_to_host_u32 (((ah_header_t *) (ip0 + 1))->spi);
+  else
+    {
+      cnt->unprocessed += 1;
+      pkt->is_ipsec = 0;
+      return;
+    }
+  pkt->is_ipsec = 1;
+
+  pi = pkt->spd->policies[IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT];
+  if (vec_len (pi))
+    clib_prefetch_load (pool_elt_at_index (im->policies, pi[0]));
+}
+
+always_inline int
+ipsec6_input_same_sa (ipsec6_input_pkt_t *a, ipsec6_input_pkt_t *b)
+{
+  return a->is_ipsec && a->spd == b->spd && a->spi == b->spi &&
+	 ip6_address_is_equal (&a->ip->src_address, &b->ip->src_address) &&
+	 ip6_address_is_equal (&a->ip->dst_address, &b->ip->dst_address);
+}
+
+/*
+ * Classify n packets, at most four, against the inbound protect policies
+ * of the SPD of their interface.
+ */
+always_inline void
+ipsec6_input_n (vlib_main_t *vm, vlib_node_runtime_t *node, ipsec_main_t *im,
+		vlib_buffer_t **b, u16 *next, ipsec_input_counters_t *cnt,
+		u32 n)
+{
+  ipsec6_input_pkt_t pkts[4], *pkt;
+  u32 header_size = sizeof (ip6_header_t);
+  u32 i;
+
+  for (i = 0; i < n; i++)
+    ipsec6_input_parse (im, b[i], next + i, cnt, pkts + i);
+
+  for (i = 0; i < n; i++)
+    {
+      pkt = pkts + i;
+      if (!pkt->is_ipsec)
+	continue;
+      if (i && ipsec6_input_same_sa (pkts + i - 1, pkt))
+	pkt->policy = pkts[i - 1].policy;
+      else
+	pkt->policy = ipsec6_input_protect_policy_match (
+	  pkt->spd, &pkt->ip->src_address, &pkt->ip->dst_address, pkt->spi);
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      pkt = pkts + i;
+      if (PREDICT_FALSE (pkt->policy == 0))
+	continue;
+      cnt->matched += 1;
+
+      pkt->policy_index = pkt->policy - im->policies;
+      ipsec_input_policy_count (
+	cnt, vm->thread_index, pkt->policy_index,
+	clib_net_to_host_u16 (pkt->ip->payload_length) + header_size);
+
+      vnet_buffer (b[i])->ipsec.sad_index = pkt->policy->sa_index;
+      if (pkt->ip->protocol == IP_PROTOCOL_IPSEC_ESP)
+	{
+	  next[i] = im->esp6_decrypt_next_index;
+	  vlib_buffer_advance (b[i], header_size);
+	}
+      else
+	next[i] = im->ah6_decrypt_next_index;
+    }
+
+  if (PREDICT_FALSE (node->flags & VLIB_NODE_FLAG_TRACE))
+    for (i = 0; i < n; i++)
+      if (PREDICT_FALSE (b[i]->flags & VLIB_BUFFER_IS_TRACED))
+	{
+	  ipsec_input_trace_t *tr =
+	    vlib_add_trace (vm, node, b[i], sizeof (*tr));
+	  pkt = pkts + i;
+
+	  tr->sa_id = pkt->policy ? pkt->policy->sa_id : ~0;
+	  tr->proto = pkt->ip->protocol;
+	  tr->spi = clib_net_to_host_u32 (pkt->esp->spi);
+	  tr->seq = clib_net_to_host_u32 (pkt->esp->seq);
+	  tr->spd = pkt->spd->id;
+	  tr->policy_index = pkt->policy_index;
+	}
+}
+
+/* Classify a vector of IPv6 packets, as ipsec4_input_inline */
+always_inline void
+ipsec6_input_inline (vlib_main_t *vm, vlib_node_runtime_t *node,
+		     vlib_buffer_t **b, u16 *next, u32 n_left,
+		     ipsec_input_counters_t *cnt, int quad_loop)
+{
+  ipsec_main_t *im = &ipsec_main;
+
+  while (quad_loop && n_left >= 8)
+    {
+      if (n_left >= 12)
+	{
+	  vlib_prefetch_buffer_header (b[8], LOAD);
+	  vlib_prefetch_buffer_header (b[9], LOAD);
+	  vlib_prefetch_buffer_header (b[10], LOAD);
+	  vlib_prefetch_buffer_header (b[11], LOAD);
+	}
+      vlib_prefetch_buffer_data (b[4], LOAD);
+      vlib_prefetch_buffer_data (b[5], LOAD);
+      vlib_prefetch_buffer_data (b[6], LOAD);
+      vlib_prefetch_buffer_data (b[7], LOAD);
+
+      ipsec6_input_n (vm, node, im, b, next, cnt, 4);
+
+      b += 4;
+      next += 4;
+      n_left -= 4;
+    }
+
+  while (n_left > 0)
+    {
+      if (n_left > 1)
+	vlib_prefetch_buffer_data (b[1], LOAD);
+
+      ipsec6_input_n (vm, node, im, b, next, cnt, 1);
+
+      b += 1;
+      next += 1;
+      n_left -= 1;
+    }
+
+  ipsec_input_policy_counters_flush (cnt, vm->thread_index);
+}
+
+#endif /* __IPSEC_INPUT_H__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
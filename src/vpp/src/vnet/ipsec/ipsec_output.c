@@ -21,6 +21,7 @@
 
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/ipsec_io.h>
+#include <vnet/ipsec/ipsec_spd_fp.h>
 
 #define foreach_ipsec_output_error                   \
  _(RX_PKTS, "IPSec pkts received")                   \
@@ -264,6 +265,123 @@ ipsec6_output_policy_match (ipsec_spd_t * spd,
   return 0;
 }
 
+always_inline void
+ipsec6_out_spd_add_flow_cache_entry (ipsec_main_t *im,
+				     ipsec6_spd_5tuple_t *ip6_5tuple,
+				     u32 pol_id)
+{
+  u64 hash;
+  u8 overwrite = 0, stale_overwrite = 0;
+  ipsec6_hash_kv_40_8_t *e;
+
+  ip6_5tuple->kv_40_8.value =
+    (((u64) pol_id) << 32) | ((u64) im->output6_epoch_count);
+
+  hash = ipsec6_hash_40_8 (&ip6_5tuple->kv_40_8);
+  hash &= (im->ipsec6_out_spd_hash_num_buckets - 1);
+  e = &im->ipsec6_out_spd_hash_tbl[hash];
+
+  ipsec_spinlock_lock (&e->bucket_lock);
+  /* Same stale entry accounting as the IPv4 outbound flow cache */
+  overwrite = (e->value != 0);
+  if (PREDICT_FALSE (overwrite))
+    stale_overwrite =
+      (im->output6_epoch_count != ((u32) (e->value & 0xFFFFFFFF)));
+  clib_memcpy_fast (e->key, ip6_5tuple->kv_40_8.key, sizeof (e->key));
+  e->value = ip6_5tuple->kv_40_8.value;
+  ipsec_spinlock_unlock (&e->bucket_lock);
+
+  if (!overwrite || stale_overwrite)
+    clib_atomic_fetch_add_relax (&im->ipsec6_out_spd_flow_cache_entries, 1);
+}
+
+always_inline ipsec_policy_t *
+ipsec6_out_spd_find_flow_cache_entry (ipsec_main_t *im, ipsec_spd_t *spd,
+				      ipsec6_spd_5tuple_t *ip6_5tuple)
+{
+  ipsec_policy_t *p = NULL;
+  ipsec6_hash_kv_40_8_t kv_result, *e;
+  u64 hash;
+
+  hash = ipsec6_hash_40_8 (&ip6_5tuple->kv_40_8);
+  hash &= (im->ipsec6_out_spd_hash_num_buckets - 1);
+  e = &im->ipsec6_out_spd_hash_tbl[hash];
+
+  ipsec_spinlock_lock (&e->bucket_lock);
+  kv_result = *e;
+  ipsec_spinlock_unlock (&e->bucket_lock);
+
+  if (ipsec6_hash_key_compare_40_8 (ip6_5tuple->kv_40_8.key, kv_result.key) &&
+      im->output6_epoch_count == ((u32) (kv_result.value & 0xFFFFFFFF)))
+    {
+      p = pool_elt_at_index (im->policies, ((u32) (kv_result.value >> 32)));
+      /* the cache is shared by all SPDs */
+      if (PREDICT_FALSE (p->id != spd->id))
+	p = NULL;
+    }
+
+  return p;
+}
+
+/**
+ * @brief IPv6 outbound policy lookup: flow cache, then either the SPD
+ * fast path or the linear policy walk. Ports are in host byte order.
+ */
+always_inline ipsec_policy_t *
+ipsec6_output_policy_lookup (ipsec_main_t *im, ipsec_spd_t *spd,
+			     ip6_address_t *la, ip6_address_t *ra, u16 lp,
+			     u16 rp, u8 pr, u8 flow_cache_enabled,
+			     u32 *n_cache_hits)
+{
+  ipsec6_spd_5tuple_t ip6_5tuple;
+  ipsec_policy_t *p;
+
+  if (!spd)
+    return 0;
+
+  if (!ipsec_fp_proto_has_ports (pr))
+    {
+      lp = 0;
+      rp = 0;
+    }
+
+  if (flow_cache_enabled)
+    {
+      clib_memset_u8 (&ip6_5tuple, 0, sizeof (ip6_5tuple));
+      ip6_address_copy (&ip6_5tuple.ip6_addr[0], la);
+      ip6_address_copy (&ip6_5tuple.ip6_addr[1], ra);
+      ip6_5tuple.port[0] = lp;
+      ip6_5tuple.port[1] = rp;
+      ip6_5tuple.proto = pr;
+
+      p = ipsec6_out_spd_find_flow_cache_entry (im, spd, &ip6_5tuple);
+      if (p)
+	{
+	  *n_cache_hits += 1;
+	  return p;
+	}
+    }
+
+  if (im->output6_fp_flag)
+    {
+      ipsec_fp_ip6_tuple_t t = {
+	.laddr = *la,
+	.raddr = *ra,
+	.lport = lp,
+	.rport = rp,
+	.protocol = pr,
+      };
+      p = ipsec_fp_ip6_lookup (im, spd, IPSEC_SPD_POLICY_IP6_OUTBOUND, &t);
+    }
+  else
+    p = ipsec6_output_policy_match (spd, la, ra, lp, rp, pr);
+
+  if (p && flow_cache_enabled)
+    ipsec6_out_spd_add_flow_cache_entry (im, &ip6_5tuple, p - im->policies);
+
+  return p;
+}
+
 static inline uword
 ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 		     vlib_frame_t * from_frame, int is_ipv6)
@@ -279,6 +397,8 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   int bogus;
   u64 nc_protect = 0, nc_bypass = 0, nc_discard = 0, nc_nomatch = 0;
   u8 flow_cache_enabled = im->flow_cache_flag;
+  u8 flow6_cache_enabled = im->output6_flow_cache_flag;
+  u32 n_flow6_cache_lookups = 0, n_flow6_cache_hits = 0;
 
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
@@ -335,13 +455,12 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 	     spd0->id);
 #endif
 
-	  p0 = ipsec6_output_policy_match (spd0,
-					   &ip6_0->src_address,
-					   &ip6_0->dst_address,
-					   clib_net_to_host_u16
-					   (udp0->src_port),
-					   clib_net_to_host_u16
-					   (udp0->dst_port), ip6_0->protocol);
+	  p0 = ipsec6_output_policy_lookup (
+	    im, spd0, &ip6_0->src_address, &ip6_0->dst_address,
+	    clib_net_to_host_u16 (udp0->src_port),
+	    clib_net_to_host_u16 (udp0->dst_port), ip6_0->protocol,
+	    flow6_cache_enabled, &n_flow6_cache_hits);
+	  n_flow6_cache_lookups += flow6_cache_enabled;
 	}
       else
 	{
@@ -525,6 +644,13 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   vlib_node_increment_counter (vm, node->node_index,
 			       IPSEC_OUTPUT_ERROR_POLICY_NO_MATCH,
 			       nc_nomatch);
+  if (n_flow6_cache_lookups)
+    {
+      ipsec_per_thread_data_t *ptd = vec_elt_at_index (im->ptd, thread_index);
+      ptd->ip6_out_flow_cache_hits += n_flow6_cache_hits;
+      ptd->ip6_out_flow_cache_misses +=
+	n_flow6_cache_lookups - n_flow6_cache_hits;
+    }
   return from_frame->n_vectors;
 }
 
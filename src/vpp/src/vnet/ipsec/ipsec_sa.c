@@ -170,12 +170,60 @@ ipsec_sa_set_async_op_ids (ipsec_sa_t * sa)
   /* *INDENT-ON* */
 }
 
+static void
+ipsec_sa_multi_worker_init (ipsec_sa_t *sa)
+{
+  ipsec_sa_multi_worker_t *mw;
+
+  mw = clib_mem_alloc_aligned (sizeof (*mw), CLIB_CACHE_LINE_BYTES);
+  clib_memset (mw, 0, sizeof (*mw));
+  vec_validate_aligned (mw->seq_blocks, vlib_get_n_threads () - 1,
+			CLIB_CACHE_LINE_BYTES);
+  clib_spinlock_init (&mw->replay_lock);
+  sa->multi_worker = mw;
+}
+
+static void
+ipsec_sa_multi_worker_free (ipsec_sa_t *sa)
+{
+  ipsec_sa_multi_worker_t *mw = sa->multi_worker;
+
+  if (!mw)
+    return;
+
+  vec_free (mw->seq_blocks);
+  clib_spinlock_free (&mw->replay_lock);
+  clib_mem_free (mw);
+  sa->multi_worker = 0;
+}
+
+static void
+ipsec_sa_anti_replay_window_init (ipsec_sa_t *sa, u32 window_size)
+{
+  /* the ring is indexed with the low bits of the sequence number */
+  window_size = max_pow2 (window_size);
+
+  vec_validate_aligned (sa->replay_window_huge,
+			window_size / BITS (u64) - 1, CLIB_CACHE_LINE_BYTES);
+  sa->flags |= IPSEC_SA_FLAG_ANTI_REPLAY_HUGE;
+}
+
+/* release the memory of an SA before it is returned to the pool */
+static void
+ipsec_sa_free_data (ipsec_sa_t *sa)
+{
+  ipsec_sa_multi_worker_free (sa);
+  if (ipsec_sa_is_set_ANTI_REPLAY_HUGE (sa))
+    vec_free (sa->replay_window_huge);
+}
+
 int
 ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
 		       ipsec_crypto_alg_t crypto_alg, const ipsec_key_t *ck,
 		       ipsec_integ_alg_t integ_alg, const ipsec_key_t *ik,
-		       ipsec_sa_flags_t flags, u32 salt, u16 src_port,
-		       u16 dst_port, const tunnel_t *tun, u32 *sa_out_index)
+		       ipsec_sa_flags_t flags, u32 anti_replay_window_size,
+		       u32 salt, u16 src_port, u16 dst_port, const tunnel_t *tun,
+		       u32 *sa_out_index)
 {
   vlib_main_t *vm = vlib_get_main ();
   ipsec_main_t *im = &ipsec_main;
@@ -189,6 +237,16 @@ ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
   if (p)
     return VNET_API_ERROR_ENTRY_ALREADY_EXISTS;
 
+  /* only the ESP nodes process an SA on more than one worker */
+  if ((flags & IPSEC_SA_FLAG_IS_MULTI_WORKER) && IPSEC_PROTOCOL_ESP != proto)
+    return VNET_API_ERROR_UNSUPPORTED;
+
+  if (anti_replay_window_size > IPSEC_SA_MAX_REPLAY_WINDOW)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  /* the window representation follows from its size */
+  flags &= ~IPSEC_SA_FLAG_ANTI_REPLAY_HUGE;
+
   pool_get_aligned_zero (ipsec_sa_pool, sa, CLIB_CACHE_LINE_BYTES);
 
   fib_node_init (&sa->node, FIB_NODE_TYPE_IPSEC_SA);
@@ -208,6 +266,11 @@ ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
   sa->flags = flags;
   sa->salt = salt;
   sa->thread_index = (vlib_num_workers ()) ? ~0 : 0;
+  if (ipsec_sa_is_set_IS_MULTI_WORKER (sa))
+    ipsec_sa_multi_worker_init (sa);
+  if (ipsec_sa_is_set_USE_ANTI_REPLAY (sa) &&
+      anti_replay_window_size > IPSEC_SA_DEFAULT_REPLAY_WINDOW)
+    ipsec_sa_anti_replay_window_init (sa, anti_replay_window_size);
   if (integ_alg != IPSEC_INTEG_ALG_NONE)
     {
       ipsec_sa_set_integ_alg (sa, integ_alg);
@@ -223,6 +286,7 @@ ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
 					      (u8 *) ck->data, ck->len);
   if (~0 == sa->crypto_key_index)
     {
+      ipsec_sa_free_data (sa);
       pool_put (ipsec_sa_pool, sa);
       return VNET_API_ERROR_KEY_LENGTH;
     }
@@ -235,6 +299,7 @@ ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
 						 (u8 *) ik->data, ik->len);
       if (~0 == sa->integ_key_index)
 	{
+	  ipsec_sa_free_data (sa);
 	  pool_put (ipsec_sa_pool, sa);
 	  return VNET_API_ERROR_KEY_LENGTH;
 	}
@@ -265,6 +330,7 @@ ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
   if (err)
     {
       clib_warning ("%s", err->what);
+      ipsec_sa_free_data (sa);
       pool_put (ipsec_sa_pool, sa);
       return VNET_API_ERROR_UNIMPLEMENTED;
     }
@@ -272,6 +338,7 @@ ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
   err = ipsec_call_add_del_callbacks (im, sa, sa_index, 1);
   if (err)
     {
+      ipsec_sa_free_data (sa);
       pool_put (ipsec_sa_pool, sa);
       return VNET_API_ERROR_SYSCALL_ERROR_1;
     }
@@ -288,6 +355,7 @@ ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
 
       if (rv)
 	{
+	  ipsec_sa_free_data (sa);
 	  pool_put (ipsec_sa_pool, sa);
 	  return rv;
 	}
@@ -360,6 +428,7 @@ ipsec_sa_del (ipsec_sa_t * sa)
   vnet_crypto_key_del (vm, sa->crypto_key_index);
   if (sa->integ_alg != IPSEC_INTEG_ALG_NONE)
     vnet_crypto_key_del (vm, sa->integ_key_index);
+  ipsec_sa_free_data (sa);
   pool_put (ipsec_sa_pool, sa);
 }
 
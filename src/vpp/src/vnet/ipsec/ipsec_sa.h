@@ -103,7 +103,9 @@ typedef struct ipsec_key_t_
   _ (128, IS_AEAD, "aead")                                                    \
   _ (256, IS_CTR, "ctr")                                                      \
   _ (512, IS_ASYNC, "async")                                                  \
-  _ (1024, NO_ALGO_NO_DROP, "no-algo-no-drop")
+  _ (1024, NO_ALGO_NO_DROP, "no-algo-no-drop")                               \
+  _ (2048, IS_MULTI_WORKER, "multi-worker")                                  \
+  _ (4096, ANTI_REPLAY_HUGE, "anti-replay-huge")
 
 typedef enum ipsec_sad_flags_t_
 {
@@ -114,6 +116,35 @@ typedef enum ipsec_sad_flags_t_
 
 STATIC_ASSERT (sizeof (ipsec_sa_flags_t) == 2, "IPSEC SA flags != 2 byte");
 
+/*
+ * The packets of a multi-worker SA are processed on any worker, instead
+ * of being handed off to the SA's thread.
+ */
+
+/* outbound sequence numbers a worker reserved, next up to end */
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  u64 next;
+  u64 end;
+} ipsec_sa_seq_block_t;
+
+/* small enough that the peer's anti-replay window absorbs the reordering
+ * between the packets of the workers */
+#define IPSEC_SA_SEQ_BLOCK_SIZE 8
+/* a worker drops the rest of its block once the other workers sent this
+ * far past it, before the peer's window would take its numbers for
+ * replays */
+#define IPSEC_SA_SEQ_BLOCK_MAX_LAG (IPSEC_SA_DEFAULT_REPLAY_WINDOW / 2)
+
+typedef struct
+{
+  /* per thread blocks of outbound sequence numbers */
+  ipsec_sa_seq_block_t *seq_blocks;
+  /* serializes the anti-replay checks and window updates of the workers */
+  clib_spinlock_t replay_lock;
+} ipsec_sa_multi_worker_t;
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -130,9 +161,28 @@ typedef struct
   u32 thread_index;
 
   u32 spi;
-  u32 seq;
-  u32 seq_hi;
-  u64 replay_window;
+  union
+  {
+    struct
+    {
+#if CLIB_ARCH_IS_BIG_ENDIAN
+      u32 seq_hi;
+      u32 seq;
+#else
+      u32 seq;
+      u32 seq_hi;
+#endif
+    };
+    /* the 64 bit sequence number, for the reservations of the workers */
+    u64 seq64;
+  };
+  union
+  {
+    /* the window of the last 64 sequence numbers, bit 0 is seq */
+    u64 replay_window;
+    /* windows larger than 64 are a ring, bit (n % size) is n */
+    u64 *replay_window_huge;
+  };
   u64 ctr_iv_counter;
   dpo_id_t dpo;
 
@@ -176,6 +226,9 @@ typedef struct
   tunnel_encap_decap_flags_t tunnel_flags;
   u8 __pad[2];
 
+  /* state shared by the workers of a multi-worker SA, else null */
+  ipsec_sa_multi_worker_t *multi_worker;
+
   /* data accessed by dataplane code should be above this comment */
     CLIB_CACHE_LINE_ALIGN_MARK (cacheline2);
 
@@ -270,8 +323,9 @@ extern int
 ipsec_sa_add_and_lock (u32 id, u32 spi, ipsec_protocol_t proto,
 		       ipsec_crypto_alg_t crypto_alg, const ipsec_key_t *ck,
 		       ipsec_integ_alg_t integ_alg, const ipsec_key_t *ik,
-		       ipsec_sa_flags_t flags, u32 salt, u16 src_port,
-		       u16 dst_port, const tunnel_t *tun, u32 *sa_out_index);
+		       ipsec_sa_flags_t flags, u32 anti_replay_window_size,
+		       u32 salt, u16 src_port, u16 dst_port, const tunnel_t *tun,
+		       u32 *sa_out_index);
 extern index_t ipsec_sa_find_and_lock (u32 id);
 extern int ipsec_sa_unlock_id (u32 id);
 extern void ipsec_sa_unlock (index_t sai);
@@ -302,24 +356,149 @@ extern uword unformat_ipsec_key (unformat_input_t * input, va_list * args);
  * Anti Replay definitions
  */
 
-#define IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE (64)
-#define IPSEC_SA_ANTI_REPLAY_WINDOW_MAX_INDEX (IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE-1)
+#define IPSEC_SA_DEFAULT_REPLAY_WINDOW (64)
+#define IPSEC_SA_MAX_REPLAY_WINDOW     (1 << 16)
+
+/* the window size of an SA, a power of 2 */
+#define IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE(_sa)                                 \
+  ((u32) (PREDICT_FALSE (ipsec_sa_is_set_ANTI_REPLAY_HUGE (_sa)) ?            \
+	    vec_len ((_sa)->replay_window_huge) * BITS (u64) :                \
+	    IPSEC_SA_DEFAULT_REPLAY_WINDOW))
+#define IPSEC_SA_ANTI_REPLAY_WINDOW_MAX_INDEX(_sa)                            \
+  (IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE (_sa) - 1)
 
 /*
  * sequence number less than the lower bound are outside of the window
  * From RFC4303 Appendix A:
  *  Bl = Tl - W + 1
  */
-#define IPSEC_SA_ANTI_REPLAY_WINDOW_LOWER_BOUND(_tl) (_tl - IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE + 1)
+#define IPSEC_SA_ANTI_REPLAY_WINDOW_LOWER_BOUND(_sa)                          \
+  ((_sa)->seq - IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE (_sa) + 1)
+
+/* why ipsec_sa_anti_replay_and_sn_advance rejected a packet */
+typedef enum ipsec_sa_anti_replay_result_t_
+{
+  IPSEC_SA_ANTI_REPLAY_OK = 0,
+  /* the sequence number was already received */
+  IPSEC_SA_ANTI_REPLAY_DUPLICATE,
+  /* the sequence number is older than the window */
+  IPSEC_SA_ANTI_REPLAY_OUT_OF_WINDOW,
+} ipsec_sa_anti_replay_result_t;
+
+/*
+ * The workers processing the packets of a multi-worker SA check and
+ * update its anti-replay window under a lock.
+ */
+always_inline void
+ipsec_sa_anti_replay_lock (ipsec_sa_t *sa)
+{
+  if (PREDICT_FALSE (sa->multi_worker != 0))
+    clib_spinlock_lock (&sa->multi_worker->replay_lock);
+}
+
+always_inline void
+ipsec_sa_anti_replay_unlock (ipsec_sa_t *sa)
+{
+  if (PREDICT_FALSE (sa->multi_worker != 0))
+    clib_spinlock_unlock (&sa->multi_worker->replay_lock);
+}
+
+/*
+ * The ring of a huge window holds the bit of sequence number n at
+ * n % size. It needs no shifting as the window moves, only the bits of
+ * the sequence numbers it moves over are cleared, a word at a time.
+ */
+always_inline u32
+ipsec_sa_anti_replay_window_pos (const ipsec_sa_t *sa, u32 seq)
+{
+  return (seq & IPSEC_SA_ANTI_REPLAY_WINDOW_MAX_INDEX (sa));
+}
 
 always_inline int
+ipsec_sa_anti_replay_window_test (const ipsec_sa_t *sa, u32 seq)
+{
+  u32 pos;
+
+  if (PREDICT_FALSE (ipsec_sa_is_set_ANTI_REPLAY_HUGE (sa)))
+    {
+      pos = ipsec_sa_anti_replay_window_pos (sa, seq);
+      return ((sa->replay_window_huge[pos / BITS (u64)] >>
+	       (pos % BITS (u64))) &
+	      1);
+    }
+
+  return ((sa->replay_window >> (sa->seq - seq)) & 1);
+}
+
+always_inline void
+ipsec_sa_anti_replay_window_set (ipsec_sa_t *sa, u32 seq)
+{
+  u32 pos;
+
+  if (PREDICT_FALSE (ipsec_sa_is_set_ANTI_REPLAY_HUGE (sa)))
+    {
+      pos = ipsec_sa_anti_replay_window_pos (sa, seq);
+      sa->replay_window_huge[pos / BITS (u64)] |= 1ULL << (pos % BITS (u64));
+    }
+  else
+    sa->replay_window |= (1ULL << (sa->seq - seq));
+}
+
+/*
+ * clear n_bits of the ring from position pos, wrapping at its end.
+ * returns how many of them were set
+ */
+always_inline u32
+ipsec_sa_anti_replay_window_clear (ipsec_sa_t *sa, u32 pos, u32 n_bits)
+{
+  u64 *ring = sa->replay_window_huge;
+  u32 max_pos = IPSEC_SA_ANTI_REPLAY_WINDOW_MAX_INDEX (sa);
+  u32 n_set = 0, off, len;
+  u64 mask;
+
+  while (n_bits)
+    {
+      off = pos % BITS (u64);
+      len = clib_min (n_bits, BITS (u64) - off);
+      mask = (len == BITS (u64)) ? ~0ULL : pow2_mask (len) << off;
+
+      n_set += count_set_bits (ring[pos / BITS (u64)] & mask);
+      ring[pos / BITS (u64)] &= ~mask;
+
+      n_bits -= len;
+      pos = (pos + len) & max_pos;
+    }
+
+  return (n_set);
+}
+
+/*
+ * the window state of the SA's last 64 sequence numbers, bit 0 is the
+ * last one, as the API and the CLI show it
+ */
+always_inline u64
+ipsec_sa_anti_replay_get_64b_window (const ipsec_sa_t *sa)
+{
+  u64 window = 0;
+  u32 i;
+
+  if (!ipsec_sa_is_set_ANTI_REPLAY_HUGE (sa))
+    return (sa->replay_window);
+
+  for (i = 0; i < BITS (u64); i++)
+    window |= (u64) ipsec_sa_anti_replay_window_test (sa, sa->seq - i) << i;
+
+  return (window);
+}
+
+always_inline ipsec_sa_anti_replay_result_t
 ipsec_sa_anti_replay_check (const ipsec_sa_t *sa, u32 seq)
 {
   if (ipsec_sa_is_set_USE_ANTI_REPLAY (sa) &&
-      sa->replay_window & (1ULL << (sa->seq - seq)))
-    return 1;
+      ipsec_sa_anti_replay_window_test (sa, seq))
+    return IPSEC_SA_ANTI_REPLAY_DUPLICATE;
   else
-    return 0;
+    return IPSEC_SA_ANTI_REPLAY_OK;
 }
 
 /*
@@ -335,8 +514,9 @@ ipsec_sa_anti_replay_check (const ipsec_sa_t *sa, u32 seq)
  *
  * This funcion should be called even without anti-replay enabled to ensure
  * the high sequence number is set.
+ * A rejected packet is either a duplicate or out of the window.
  */
-always_inline int
+always_inline ipsec_sa_anti_replay_result_t
 ipsec_sa_anti_replay_and_sn_advance (const ipsec_sa_t *sa, u32 seq,
 				     u32 hi_seq_used, bool post_decrypt,
 				     u32 *hi_seq_req)
@@ -350,19 +530,17 @@ ipsec_sa_anti_replay_and_sn_advance (const ipsec_sa_t *sa, u32 seq,
 	*hi_seq_req = 0;
 
       if (!ipsec_sa_is_set_USE_ANTI_REPLAY (sa))
-	return 0;
+	return IPSEC_SA_ANTI_REPLAY_OK;
 
       if (PREDICT_TRUE (seq > sa->seq))
-	return 0;
+	return IPSEC_SA_ANTI_REPLAY_OK;
 
       u32 diff = sa->seq - seq;
 
-      if (IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE > diff)
-	return ((sa->replay_window & (1ULL << diff)) ? 1 : 0);
+      if (IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE (sa) > diff)
+	return (ipsec_sa_anti_replay_check (sa, seq));
       else
-	return 1;
-
-      return 0;
+	return IPSEC_SA_ANTI_REPLAY_OUT_OF_WINDOW;
     }
 
   if (!ipsec_sa_is_set_USE_ANTI_REPLAY (sa))
@@ -400,16 +578,16 @@ ipsec_sa_anti_replay_and_sn_advance (const ipsec_sa_t *sa, u32 seq,
        * else
        *   this is post-decrpyt and since it decrypted we accept it
        */
-      return 0;
+      return IPSEC_SA_ANTI_REPLAY_OK;
     }
-  if (PREDICT_TRUE (sa->seq >= (IPSEC_SA_ANTI_REPLAY_WINDOW_MAX_INDEX)))
+  if (PREDICT_TRUE (sa->seq >= IPSEC_SA_ANTI_REPLAY_WINDOW_MAX_INDEX (sa)))
     {
       /*
        * the last sequence number VPP recieved is more than one
        * window size greater than zero.
        * Case A from RFC4303 Appendix A.
        */
-      if (seq < IPSEC_SA_ANTI_REPLAY_WINDOW_LOWER_BOUND (sa->seq))
+      if (seq < IPSEC_SA_ANTI_REPLAY_WINDOW_LOWER_BOUND (sa))
 	{
 	  /*
 	   * the received sequence number is lower than the lower bound
@@ -424,12 +602,12 @@ ipsec_sa_anti_replay_and_sn_advance (const ipsec_sa_t *sa, u32 seq,
 		 * packet is the same as the last-sequnence number of the SA.
 		 * that means this packet did not cause a wrap.
 		 * this packet is thus out of window and should be dropped */
-		return 1;
+		return IPSEC_SA_ANTI_REPLAY_OUT_OF_WINDOW;
 	      else
 		/* The packet decrypted with a different high sequence number
 		 * to the SA, that means it is the wrap packet and should be
 		 * accepted */
-		return 0;
+		return IPSEC_SA_ANTI_REPLAY_OK;
 	    }
 	  else
 	    {
@@ -437,7 +615,7 @@ ipsec_sa_anti_replay_and_sn_advance (const ipsec_sa_t *sa, u32 seq,
 	       * need to decrpyt to find out */
 	      if (hi_seq_req)
 		*hi_seq_req = sa->seq_hi + 1;
-	      return 0;
+	      return IPSEC_SA_ANTI_REPLAY_OK;
 	    }
 	}
       else
@@ -460,7 +638,7 @@ ipsec_sa_anti_replay_and_sn_advance (const ipsec_sa_t *sa, u32 seq,
 	     * upper bound. this packet will move the window along, assuming
 	     * it decrypts correctly.
 	     */
-	    return 0;
+	    return IPSEC_SA_ANTI_REPLAY_OK;
 	}
     }
   else
@@ -473,7 +651,7 @@ ipsec_sa_anti_replay_and_sn_advance (const ipsec_sa_t *sa, u32 seq,
        * RHS will be a larger number.
        * Case B from RFC4303 Appendix A.
        */
-      if (seq < IPSEC_SA_ANTI_REPLAY_WINDOW_LOWER_BOUND (sa->seq))
+      if (seq < IPSEC_SA_ANTI_REPLAY_WINDOW_LOWER_BOUND (sa))
 	{
 	  /*
 	   * the sequence number is less than the lower bound.
@@ -501,7 +679,7 @@ ipsec_sa_anti_replay_and_sn_advance (const ipsec_sa_t *sa, u32 seq,
 	       */
 	      if (hi_seq_req)
 		*hi_seq_req = sa->seq_hi;
-	      return 0;
+	      return IPSEC_SA_ANTI_REPLAY_OK;
 	    }
 	}
       else
@@ -521,17 +699,50 @@ ipsec_sa_anti_replay_and_sn_advance (const ipsec_sa_t *sa, u32 seq,
 
   /* unhandled case */
   ASSERT (0);
-  return 0;
+  return IPSEC_SA_ANTI_REPLAY_OK;
 }
 
+/*
+ * move the window of a huge SA on by inc, to the new last sequence
+ * number seq. the bits of the sequence numbers moved over are cleared,
+ * those that were not set were lost.
+ */
 always_inline u32
-ipsec_sa_anti_replay_window_shift (ipsec_sa_t *sa, u32 inc)
+ipsec_sa_anti_replay_window_shift_huge (ipsec_sa_t *sa, u32 inc, u32 seq)
+{
+  u32 window_size = IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE (sa);
+  u32 n_lost = 0, n_seen;
+
+  if (inc < window_size)
+    {
+      n_seen = ipsec_sa_anti_replay_window_clear (
+	sa, ipsec_sa_anti_replay_window_pos (sa, sa->seq + 1), inc);
+      if (sa->seq > window_size)
+	n_lost = inc - n_seen;
+    }
+  else
+    {
+      n_seen = ipsec_sa_anti_replay_window_clear (sa, 0, window_size);
+      n_lost = window_size - n_seen + inc - window_size;
+    }
+
+  sa->seq = seq;
+  ipsec_sa_anti_replay_window_set (sa, seq);
+
+  return (n_lost);
+}
+
+always_inline u32
+ipsec_sa_anti_replay_window_shift (ipsec_sa_t *sa, u32 inc, u32 seq)
 {
   u32 n_lost = 0;
 
-  if (inc < IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE)
+  if (PREDICT_FALSE (ipsec_sa_is_set_ANTI_REPLAY_HUGE (sa)))
+    return (ipsec_sa_anti_replay_window_shift_huge (sa, inc, seq));
+
+  if (inc < IPSEC_SA_DEFAULT_REPLAY_WINDOW)
     {
-      if (sa->seq > IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE)
+      if (sa->seq > IPSEC_SA_DEFAULT_REPLAY_WINDOW)
 	{
 	  /*
 	   * count how many holes there are in the portion
@@ -558,11 +769,13 @@ ipsec_sa_anti_replay_window_shift (ipsec_sa_t *sa, u32 inc)
 
       /* any sequence numbers that now fall outside the window
        * are forever lost */
-      n_lost += inc - IPSEC_SA_ANTI_REPLAY_WINDOW_SIZE;
+      n_lost += inc - IPSEC_SA_DEFAULT_REPLAY_WINDOW;
 
       sa->replay_window = 1;
     }
 
+  sa->seq = seq;
+
   return (n_lost);
 }
 
@@ -573,7 +786,7 @@ ipsec_sa_anti_replay_window_shift (ipsec_sa_t *sa, u32 inc)
  * We always need to move on the SN but the window updates are only needed
  * if AR is on.
  * However, updating the window is trivial, so we do it anyway to save
- * the branch cost.
+ * the branch cost. A huge window is only allocated with AR on.
  */
 always_inline u64
 ipsec_sa_anti_replay_advance (ipsec_sa_t *sa, u32 thread_index, u32 seq,
@@ -589,40 +802,28 @@ ipsec_sa_anti_replay_advance (ipsec_sa_t *sa, u32 thread_index, u32 seq,
       if (wrap == 0 && seq > sa->seq)
 	{
 	  pos = seq - sa->seq;
-	  n_lost = ipsec_sa_anti_replay_window_shift (sa, pos);
-	  sa->seq = seq;
+	  n_lost = ipsec_sa_anti_replay_window_shift (sa, pos, seq);
 	}
       else if (wrap > 0)
 	{
 	  pos = ~seq + sa->seq + 1;
-	  n_lost = ipsec_sa_anti_replay_window_shift (sa, pos);
-	  sa->seq = seq;
+	  n_lost = ipsec_sa_anti_replay_window_shift (sa, pos, seq);
 	  sa->seq_hi = hi_seq;
 	}
-      else if (wrap < 0)
-	{
-	  pos = ~seq + sa->seq + 1;
-	  sa->replay_window |= (1ULL << pos);
-	}
       else
-	{
-	  pos = sa->seq - seq;
-	  sa->replay_window |= (1ULL << pos);
-	}
+	/* wrap < 0 is a packet from before the last wrap, else it is
+	 * in the window below the last sequence number */
+	ipsec_sa_anti_replay_window_set (sa, seq);
     }
   else
     {
       if (seq > sa->seq)
 	{
 	  pos = seq - sa->seq;
-	  n_lost = ipsec_sa_anti_replay_window_shift (sa, pos);
-	  sa->seq = seq;
+	  n_lost = ipsec_sa_anti_replay_window_shift (sa, pos, seq);
 	}
       else
-	{
-	  pos = sa->seq - seq;
-	  sa->replay_window |= (1ULL << pos);
-	}
+	ipsec_sa_anti_replay_window_set (sa, seq);
     }
 
   return n_lost;
@@ -15,6 +15,7 @@
 
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/ipsec_io.h>
+#include <vnet/ipsec/ipsec_spd_fp.h>
 
 int
 ipsec_add_del_spd (vlib_main_t * vm, u32 spd_id, int is_add)
@@ -46,7 +47,13 @@ ipsec_add_del_spd (vlib_main_t * vm, u32 spd_id, int is_add)
 #define _(s,v) vec_free(spd->policies[IPSEC_SPD_POLICY_##s]);
       foreach_ipsec_spd_policy_type
 #undef _
-	pool_put (im->spds, spd);
+      ipsec_fp_spd_free (spd);
+      /* cached policies of this SPD must not outlive it */
+      if (im->input_flow_cache_flag)
+	ipsec4_in_spd_flow_cache_invalidate (im);
+      if (im->output6_flow_cache_flag)
+	ipsec6_out_spd_flow_cache_invalidate (im);
+      pool_put (im->spds, spd);
     }
   else				/* create new SPD */
     {
@@ -16,6 +16,9 @@
 #define __IPSEC_SPD_H__
 
 #include <vlib/vlib.h>
+#include <vnet/ip/ip6_packet.h>
+#include <vppinfra/bihash_16_8.h>
+#include <vppinfra/bihash_40_8.h>
 
 #define foreach_ipsec_spd_policy_type                 \
   _(IP4_OUTBOUND, "ip4-outbound")                     \
@@ -40,6 +43,93 @@ typedef enum ipsec_spd_policy_t_
 
 extern u8 *format_ipsec_policy_type (u8 * s, va_list * args);
 
+/**
+ * @brief An IPv4 selector tuple as seen by the SPD fast path.
+ *
+ * Addresses and ports are in host byte order. Inbound protect policies
+ * are keyed on the SPI, all other policy types on the ports.
+ */
+typedef union
+{
+  struct
+  {
+    u32 laddr;
+    u32 raddr;
+    union
+    {
+      struct
+      {
+	u16 lport;
+	u16 rport;
+      };
+      u32 spi;
+    };
+    u8 protocol;
+    u8 policy_type;
+    u16 mask_type_index;
+  };
+  u64 as_u64[2];
+} ipsec_fp_ip4_tuple_t;
+
+STATIC_ASSERT_SIZEOF (ipsec_fp_ip4_tuple_t, 16);
+
+/**
+ * @brief An IPv6 selector tuple as seen by the SPD fast path.
+ *
+ * Addresses are in network byte order, ports in host byte order.
+ */
+typedef union
+{
+  struct
+  {
+    ip6_address_t laddr;
+    ip6_address_t raddr;
+    u16 lport;
+    u16 rport;
+    u8 protocol;
+    u8 policy_type;
+    u16 mask_type_index;
+  };
+  u64 as_u64[5];
+} ipsec_fp_ip6_tuple_t;
+
+STATIC_ASSERT_SIZEOF (ipsec_fp_ip6_tuple_t, 40);
+
+/**
+ * @brief A set of policies whose selectors widen to the same prefixes
+ */
+typedef struct
+{
+  union
+  {
+    ipsec_fp_ip4_tuple_t ip4;
+    ipsec_fp_ip6_tuple_t ip6;
+    u64 as_u64[5];
+  } mask;
+  /** highest priority of any policy added with this mask */
+  i32 max_priority;
+  /** number of policies using this mask */
+  u32 refcount;
+} ipsec_fp_mask_type_t;
+
+/**
+ * @brief Tuple-space classifier state of an SPD
+ */
+typedef struct
+{
+  /** masked tuple -> index of a rule list */
+  clib_bihash_16_8_t ip4_tbl;
+  clib_bihash_40_8_t ip6_tbl;
+  /** pool of mask types; the pool index is part of the hash key */
+  ipsec_fp_mask_type_t *mask_types;
+  /** per policy type, mask type indices by descending max priority */
+  u32 *mask_type_order[IPSEC_SPD_POLICY_N_TYPES];
+  /** pool of policy index vectors, each by descending priority */
+  u32 **rule_lists;
+  u8 ip4_tbl_inited;
+  u8 ip6_tbl_inited;
+} ipsec_spd_fp_t;
+
 /**
  * @brief A Secruity Policy Database
  */
@@ -49,6 +139,8 @@ typedef struct
   u32 id;
   /** vectors for each of the policy types */
   u32 *policies[IPSEC_SPD_POLICY_N_TYPES];
+  /** tuple-space classifier over the same policies */
+  ipsec_spd_fp_t fp;
 } ipsec_spd_t;
 
 /**
@@ -0,0 +1,459 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/ipsec/ipsec.h>
+#include <vnet/ipsec/ipsec_spd_fp.h>
+
+/* the 40_8 bihash functions are instantiated by ip6_forward.c */
+#include <vppinfra/bihash_40_8.h>
+
+/**
+ * Mask of the smallest prefix covering [start, stop]
+ */
+static u32
+ipsec_fp_range_mask_u32 (u32 start, u32 stop)
+{
+  u32 diff = start ^ stop;
+
+  if (!diff)
+    return ~0;
+
+  return (u32) ~pow2_mask (64 - count_leading_zeros (diff));
+}
+
+static u16
+ipsec_fp_range_mask_u16 (u16 start, u16 stop)
+{
+  return (u16) ipsec_fp_range_mask_u32 (start, stop);
+}
+
+static void
+ipsec_fp_range_mask_ip6 (ip6_address_t *start, ip6_address_t *stop,
+			 ip6_address_t *mask)
+{
+  u64 hi, lo;
+  u64 diff;
+
+  hi = clib_net_to_host_u64 (start->as_u64[0]);
+  lo = clib_net_to_host_u64 (start->as_u64[1]);
+
+  if ((diff = hi ^ clib_net_to_host_u64 (stop->as_u64[0])))
+    {
+      mask->as_u64[0] =
+	clib_host_to_net_u64 (~pow2_mask (64 - count_leading_zeros (diff)));
+      mask->as_u64[1] = 0;
+    }
+  else if ((diff = lo ^ clib_net_to_host_u64 (stop->as_u64[1])))
+    {
+      mask->as_u64[0] = ~0ULL;
+      mask->as_u64[1] =
+	clib_host_to_net_u64 (~pow2_mask (64 - count_leading_zeros (diff)));
+    }
+  else
+    {
+      mask->as_u64[0] = ~0ULL;
+      mask->as_u64[1] = ~0ULL;
+    }
+}
+
+static void
+ipsec_fp_ports_get_mask (ipsec_policy_t *p, u16 *lport, u16 *rport,
+			 u16 *lmask, u16 *rmask)
+{
+  if (!ipsec_fp_proto_has_ports (p->protocol))
+    {
+      *lport = *rport = *lmask = *rmask = 0;
+      return;
+    }
+
+  *lport = p->lport.start;
+  *rport = p->rport.start;
+  *lmask = ipsec_fp_range_mask_u16 (p->lport.start, p->lport.stop);
+  *rmask = ipsec_fp_range_mask_u16 (p->rport.start, p->rport.stop);
+}
+
+/**
+ * Build the (unmasked) selector tuple and the mask of an IPv4 policy
+ */
+static void
+ipsec_fp_ip4_policy_get_tuple (ipsec_policy_t *p, ipsec_fp_ip4_tuple_t *t,
+			       ipsec_fp_ip4_tuple_t *mask)
+{
+  u32 lstart, lstop, rstart, rstop;
+
+  clib_memset (t, 0, sizeof (*t));
+  clib_memset (mask, 0, sizeof (*mask));
+
+  lstart = clib_net_to_host_u32 (p->laddr.start.ip4.as_u32);
+  lstop = clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32);
+  rstart = clib_net_to_host_u32 (p->raddr.start.ip4.as_u32);
+  rstop = clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32);
+
+  if (p->type == IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT)
+    {
+      ipsec_sa_t *s = ipsec_sa_get (p->sa_index);
+
+      t->spi = s->spi;
+      mask->spi = ~0;
+
+      /* tunnel SAs are matched on the tunnel's endpoints only */
+      if (ipsec_sa_is_set_IS_TUNNEL (s))
+	{
+	  lstart = lstop =
+	    clib_net_to_host_u32 (s->tunnel.t_dst.ip.ip4.as_u32);
+	  rstart = rstop =
+	    clib_net_to_host_u32 (s->tunnel.t_src.ip.ip4.as_u32);
+	}
+    }
+  else
+    {
+      if (p->protocol)
+	{
+	  t->protocol = p->protocol;
+	  mask->protocol = ~0;
+	}
+      ipsec_fp_ports_get_mask (p, &t->lport, &t->rport, &mask->lport,
+			       &mask->rport);
+    }
+
+  mask->laddr = ipsec_fp_range_mask_u32 (lstart, lstop);
+  mask->raddr = ipsec_fp_range_mask_u32 (rstart, rstop);
+  t->laddr = lstart;
+  t->raddr = rstart;
+}
+
+/**
+ * Build the (unmasked) selector tuple and the mask of an IPv6 policy
+ */
+static void
+ipsec_fp_ip6_policy_get_tuple (ipsec_policy_t *p, ipsec_fp_ip6_tuple_t *t,
+			       ipsec_fp_ip6_tuple_t *mask)
+{
+  clib_memset (t, 0, sizeof (*t));
+  clib_memset (mask, 0, sizeof (*mask));
+
+  ipsec_fp_range_mask_ip6 (&p->laddr.start.ip6, &p->laddr.stop.ip6,
+			   &mask->laddr);
+  ipsec_fp_range_mask_ip6 (&p->raddr.start.ip6, &p->raddr.stop.ip6,
+			   &mask->raddr);
+  t->laddr = p->laddr.start.ip6;
+  t->raddr = p->raddr.start.ip6;
+
+  if (p->protocol)
+    {
+      t->protocol = p->protocol;
+      mask->protocol = ~0;
+    }
+  ipsec_fp_ports_get_mask (p, &t->lport, &t->rport, &mask->lport,
+			   &mask->rport);
+}
+
+static int
+ipsec_fp_mask_is_equal (ipsec_fp_mask_type_t *mt, u64 *mask)
+{
+  return (mt->mask.as_u64[0] == mask[0] && mt->mask.as_u64[1] == mask[1] &&
+	  mt->mask.as_u64[2] == mask[2] && mt->mask.as_u64[3] == mask[3] &&
+	  mt->mask.as_u64[4] == mask[4]);
+}
+
+/**
+ * Keep the per type mask order sorted by descending max priority
+ */
+static void
+ipsec_fp_mask_type_order_update (ipsec_spd_fp_t *fp,
+				 ipsec_spd_policy_type_t type, u32 mti)
+{
+  ipsec_fp_mask_type_t *mt = pool_elt_at_index (fp->mask_types, mti);
+  u32 ii, pos;
+
+  vec_foreach_index (ii, fp->mask_type_order[type])
+    if (fp->mask_type_order[type][ii] == mti)
+      {
+	vec_delete (fp->mask_type_order[type], 1, ii);
+	break;
+      }
+
+  if (!mt->refcount)
+    return;
+
+  pos = 0;
+  vec_foreach_index (ii, fp->mask_type_order[type])
+    {
+      ipsec_fp_mask_type_t *other =
+	pool_elt_at_index (fp->mask_types, fp->mask_type_order[type][ii]);
+      if (other->max_priority < mt->max_priority)
+	break;
+      pos = ii + 1;
+    }
+  vec_insert_elts (fp->mask_type_order[type], &mti, 1, pos);
+}
+
+static u32
+ipsec_fp_mask_type_find (ipsec_spd_fp_t *fp, ipsec_spd_policy_type_t type,
+			 u64 *mask)
+{
+  u32 *mti;
+
+  vec_foreach (mti, fp->mask_type_order[type])
+    if (ipsec_fp_mask_is_equal (pool_elt_at_index (fp->mask_types, *mti),
+				mask))
+      return *mti;
+
+  return ~0;
+}
+
+static void
+ipsec_fp_tbl_init (ipsec_spd_t *spd, int is_ip6)
+{
+  ipsec_main_t *im = &ipsec_main;
+
+  if (is_ip6 && !spd->fp.ip6_tbl_inited)
+    {
+      clib_bihash_init_40_8 (&spd->fp.ip6_tbl, "ipsec spd fast-path ip6",
+			     im->fp_num_buckets, im->fp_memory_size);
+      spd->fp.ip6_tbl_inited = 1;
+    }
+  else if (!is_ip6 && !spd->fp.ip4_tbl_inited)
+    {
+      clib_bihash_init_16_8 (&spd->fp.ip4_tbl, "ipsec spd fast-path ip4",
+			     im->fp_num_buckets, im->fp_memory_size);
+      spd->fp.ip4_tbl_inited = 1;
+    }
+}
+
+static void
+ipsec_fp_rule_list_insert (u32 **rules, u32 policy_index)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_policy_t *p, *other;
+  u32 ii, pos = 0;
+
+  p = pool_elt_at_index (im->policies, policy_index);
+  vec_foreach_index (ii, *rules)
+    {
+      other = pool_elt_at_index (im->policies, (*rules)[ii]);
+      if (other->priority < p->priority)
+	break;
+      pos = ii + 1;
+    }
+  vec_insert_elts (*rules, &policy_index, 1, pos);
+}
+
+/**
+ * Search for the rule list of a masked key; if absent and is_add, create
+ * it. Returns the rule list index or ~0.
+ */
+static u32
+ipsec_fp_rule_list_get (ipsec_spd_fp_t *fp, int is_ip6, u64 *key, int is_add)
+{
+  clib_bihash_kv_40_8_t kv6;
+  clib_bihash_kv_16_8_t kv4;
+  u32 **rules;
+
+  if (is_ip6)
+    {
+      clib_memcpy_fast (kv6.key, key, sizeof (kv6.key));
+      if (!clib_bihash_search_40_8 (&fp->ip6_tbl, &kv6, &kv6))
+	return kv6.value;
+    }
+  else
+    {
+      clib_memcpy_fast (kv4.key, key, sizeof (kv4.key));
+      if (!clib_bihash_search_16_8 (&fp->ip4_tbl, &kv4, &kv4))
+	return kv4.value;
+    }
+
+  if (!is_add)
+    return ~0;
+
+  pool_get_zero (fp->rule_lists, rules);
+  kv6.value = kv4.value = rules - fp->rule_lists;
+
+  if (is_ip6)
+    clib_bihash_add_del_40_8 (&fp->ip6_tbl, &kv6, 1);
+  else
+    clib_bihash_add_del_16_8 (&fp->ip4_tbl, &kv4, 1);
+
+  return kv4.value;
+}
+
+static void
+ipsec_fp_rule_list_put (ipsec_spd_fp_t *fp, int is_ip6, u64 *key, u32 rli)
+{
+  clib_bihash_kv_40_8_t kv6;
+  clib_bihash_kv_16_8_t kv4;
+  u32 **rules = pool_elt_at_index (fp->rule_lists, rli);
+
+  vec_free (*rules);
+  pool_put (fp->rule_lists, rules);
+
+  if (is_ip6)
+    {
+      clib_memcpy_fast (kv6.key, key, sizeof (kv6.key));
+      clib_bihash_add_del_40_8 (&fp->ip6_tbl, &kv6, 0);
+    }
+  else
+    {
+      clib_memcpy_fast (kv4.key, key, sizeof (kv4.key));
+      clib_bihash_add_del_16_8 (&fp->ip4_tbl, &kv4, 0);
+    }
+}
+
+void
+ipsec_fp_add_del_policy (ipsec_spd_t *spd, u32 policy_index, int is_add)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_spd_fp_t *fp = &spd->fp;
+  ipsec_fp_mask_type_t *mt;
+  ipsec_policy_t *p;
+  u32 mti, rli, ii;
+  int is_ip6, i;
+  union
+  {
+    ipsec_fp_ip4_tuple_t ip4;
+    ipsec_fp_ip6_tuple_t ip6;
+    u64 as_u64[5];
+  } t, mask;
+
+  p = pool_elt_at_index (im->policies, policy_index);
+
+  if (ipsec_fp_is_ip4_policy_type (p->type))
+    is_ip6 = 0;
+  else if (p->type == IPSEC_SPD_POLICY_IP6_OUTBOUND)
+    is_ip6 = 1;
+  else
+    return;
+
+  clib_memset (&t, 0, sizeof (t));
+  clib_memset (&mask, 0, sizeof (mask));
+  ipsec_fp_tbl_init (spd, is_ip6);
+  if (is_ip6)
+    ipsec_fp_ip6_policy_get_tuple (p, &t.ip6, &mask.ip6);
+  else
+    ipsec_fp_ip4_policy_get_tuple (p, &t.ip4, &mask.ip4);
+
+  mti = ipsec_fp_mask_type_find (fp, p->type, mask.as_u64);
+
+  if (is_add)
+    {
+      if (~0 == mti)
+	{
+	  pool_get_zero (fp->mask_types, mt);
+	  clib_memcpy_fast (mt->mask.as_u64, mask.as_u64,
+			    sizeof (mask.as_u64));
+	  mt->max_priority = p->priority;
+	  mti = mt - fp->mask_types;
+	}
+      mt = pool_elt_at_index (fp->mask_types, mti);
+      mt->refcount++;
+      mt->max_priority = clib_max (mt->max_priority, p->priority);
+      ipsec_fp_mask_type_order_update (fp, p->type, mti);
+    }
+  else if (~0 == mti)
+    return;
+
+  for (i = 0; i < 5; i++)
+    t.as_u64[i] &= mask.as_u64[i];
+  if (is_ip6)
+    {
+      t.ip6.policy_type = p->type;
+      t.ip6.mask_type_index = mti;
+    }
+  else
+    {
+      t.ip4.policy_type = p->type;
+      t.ip4.mask_type_index = mti;
+    }
+
+  rli = ipsec_fp_rule_list_get (fp, is_ip6, t.as_u64, is_add);
+
+  if (is_add)
+    {
+      ipsec_fp_rule_list_insert (&fp->rule_lists[rli], policy_index);
+      return;
+    }
+
+  if (~0 != rli)
+    {
+      u32 **rules = pool_elt_at_index (fp->rule_lists, rli);
+
+      vec_foreach_index (ii, *rules)
+	if ((*rules)[ii] == policy_index)
+	  {
+	    vec_delete (*rules, 1, ii);
+	    break;
+	  }
+
+      if (!vec_len (*rules))
+	ipsec_fp_rule_list_put (fp, is_ip6, t.as_u64, rli);
+    }
+
+  mt = pool_elt_at_index (fp->mask_types, mti);
+  mt->refcount--;
+  ipsec_fp_mask_type_order_update (fp, p->type, mti);
+  if (!mt->refcount)
+    pool_put (fp->mask_types, mt);
+}
+
+void
+ipsec_fp_spd_free (ipsec_spd_t *spd)
+{
+  ipsec_spd_fp_t *fp = &spd->fp;
+  ipsec_spd_policy_type_t type;
+  u32 **rules;
+
+  if (fp->ip4_tbl_inited)
+    clib_bihash_free_16_8 (&fp->ip4_tbl);
+  if (fp->ip6_tbl_inited)
+    clib_bihash_free_40_8 (&fp->ip6_tbl);
+
+  pool_foreach (rules, fp->rule_lists)
+    vec_free (*rules);
+  pool_free (fp->rule_lists);
+  pool_free (fp->mask_types);
+
+  FOR_EACH_IPSEC_SPD_POLICY_TYPE (type)
+    vec_free (fp->mask_type_order[type]);
+
+  clib_memset (fp, 0, sizeof (*fp));
+}
+
+u8 *
+format_ipsec_spd_fp (u8 *s, va_list *args)
+{
+  ipsec_spd_t *spd = va_arg (*args, ipsec_spd_t *);
+  ipsec_spd_fp_t *fp = &spd->fp;
+  ipsec_spd_policy_type_t type;
+
+  s = format (s, "\n fast-path: %u mask types, %u rule lists",
+	      pool_elts (fp->mask_types), pool_elts (fp->rule_lists));
+
+  FOR_EACH_IPSEC_SPD_POLICY_TYPE (type)
+    {
+      if (vec_len (fp->mask_type_order[type]))
+	s = format (s, "\n  %U: %u mask types", format_ipsec_policy_type,
+		    type, vec_len (fp->mask_type_order[type]));
+    }
+
+  return (s);
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __IPSEC_SPD_FP_H__
+#define __IPSEC_SPD_FP_H__
+
+#include <vnet/ipsec/ipsec.h>
+
+/*
+ * SPD fast path: a tuple-space classifier over the policies of an SPD.
+ * It covers the IPv4 inbound and the IPv6 outbound policy types.
+ *
+ * Each selector range (address, port) is widened to the smallest prefix
+ * that covers it. Policies whose widened selectors have the same prefix
+ * lengths share a mask type. A lookup masks the packet's tuple once per
+ * mask type and probes the SPD's bihash; the candidates found there are
+ * then checked against their exact ranges. The cost of a miss therefore
+ * grows with the number of distinct mask types, not the number of
+ * policies.
+ *
+ * Ports are only part of a policy's mask when the policy names a protocol
+ * that carries ports; an "any protocol" policy with a port range is
+ * widened to all ports, as ports are ignored for e.g. ICMP packets.
+ */
+
+#define IPSEC_FP_DEFAULT_HASH_NUM_BUCKETS (1 << 12)
+#define IPSEC_FP_DEFAULT_HASH_MEMORY_SIZE (32 << 20)
+
+extern void ipsec_fp_add_del_policy (ipsec_spd_t *spd, u32 policy_index,
+				     int is_add);
+extern void ipsec_fp_spd_free (ipsec_spd_t *spd);
+extern u8 *format_ipsec_spd_fp (u8 *s, va_list *args);
+
+always_inline int
+ipsec_fp_is_ip4_policy_type (ipsec_spd_policy_type_t type)
+{
+  return (type == IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT ||
+	  type == IPSEC_SPD_POLICY_IP4_INBOUND_BYPASS ||
+	  type == IPSEC_SPD_POLICY_IP4_INBOUND_DISCARD);
+}
+
+/**
+ * @brief Whether policies of this type are classified by the fast path
+ */
+always_inline int
+ipsec_fp_is_enabled (ipsec_main_t *im, ipsec_spd_policy_type_t type)
+{
+  if (ipsec_fp_is_ip4_policy_type (type))
+    return im->input_fp_flag;
+  if (type == IPSEC_SPD_POLICY_IP6_OUTBOUND)
+    return im->output6_fp_flag;
+  return 0;
+}
+
+always_inline int
+ipsec_fp_proto_has_ports (u8 protocol)
+{
+  return (protocol == IP_PROTOCOL_TCP || protocol == IP_PROTOCOL_UDP ||
+	  protocol == IP_PROTOCOL_SCTP);
+}
+
+/**
+ * @brief Exact match of an IPv4 inbound policy against a host order tuple.
+ * Protect policies select on the SPI, the others on protocol and ports.
+ */
+always_inline int
+ipsec_fp_ip4_policy_match (ipsec_policy_t *p, ipsec_fp_ip4_tuple_t *t)
+{
+  if (p->type == IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT)
+    {
+      ipsec_sa_t *s = ipsec_sa_get (p->sa_index);
+
+      if (t->spi != s->spi)
+	return 0;
+
+      if (ipsec_sa_is_set_IS_TUNNEL (s))
+	return (
+	  t->laddr == clib_net_to_host_u32 (s->tunnel.t_dst.ip.ip4.as_u32) &&
+	  t->raddr == clib_net_to_host_u32 (s->tunnel.t_src.ip.ip4.as_u32));
+    }
+
+  if (t->laddr < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
+    return 0;
+
+  if (t->laddr > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
+    return 0;
+
+  if (t->raddr < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
+    return 0;
+
+  if (t->raddr > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
+    return 0;
+
+  if (p->type == IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT)
+    return 1;
+
+  if (PREDICT_FALSE (p->protocol && (p->protocol != t->protocol)))
+    return 0;
+
+  if (PREDICT_TRUE (!ipsec_fp_proto_has_ports (t->protocol)))
+    return 1;
+
+  return (t->lport >= p->lport.start && t->lport <= p->lport.stop &&
+	  t->rport >= p->rport.start && t->rport <= p->rport.stop);
+}
+
+/**
+ * @brief Find the highest priority policy of the given type matching
+ * the host order tuple, or NULL
+ */
+always_inline ipsec_policy_t *
+ipsec_fp_ip4_lookup (ipsec_main_t *im, ipsec_spd_t *spd,
+		     ipsec_spd_policy_type_t type, ipsec_fp_ip4_tuple_t *t)
+{
+  ipsec_spd_fp_t *fp = &spd->fp;
+  ipsec_policy_t *best = 0, *p;
+  clib_bihash_kv_16_8_t kv;
+  ipsec_fp_mask_type_t *mt;
+  u32 *mti, *pi, *rules;
+
+  vec_foreach (mti, fp->mask_type_order[type])
+    {
+      mt = pool_elt_at_index (fp->mask_types, *mti);
+
+      /* mask types are ordered, nothing further down can win */
+      if (best && best->priority >= mt->max_priority)
+	break;
+
+      kv.key[0] = t->as_u64[0] & mt->mask.as_u64[0];
+      kv.key[1] = t->as_u64[1] & mt->mask.as_u64[1];
+      ((ipsec_fp_ip4_tuple_t *) kv.key)->policy_type = type;
+      ((ipsec_fp_ip4_tuple_t *) kv.key)->mask_type_index = *mti;
+
+      if (clib_bihash_search_inline_16_8 (&fp->ip4_tbl, &kv))
+	continue;
+
+      rules = fp->rule_lists[kv.value];
+      vec_foreach (pi, rules)
+	{
+	  p = pool_elt_at_index (im->policies, *pi);
+	  if (best && best->priority >= p->priority)
+	    break;
+	  if (ipsec_fp_ip4_policy_match (p, t))
+	    {
+	      best = p;
+	      break;
+	    }
+	}
+    }
+
+  return best;
+}
+
+always_inline int
+ipsec_fp_ip6_addr_in_range (ip6_address_t *a, ip6_address_t *start,
+			    ip6_address_t *stop)
+{
+  return (memcmp (a->as_u8, start->as_u8, sizeof (*a)) >= 0 &&
+	  memcmp (a->as_u8, stop->as_u8, sizeof (*a)) <= 0);
+}
+
+/**
+ * @brief Exact match of an IPv6 outbound policy against a tuple
+ */
+always_inline int
+ipsec_fp_ip6_policy_match (ipsec_policy_t *p, ipsec_fp_ip6_tuple_t *t)
+{
+  if (PREDICT_FALSE (p->protocol && (p->protocol != t->protocol)))
+    return 0;
+
+  if (!ipsec_fp_ip6_addr_in_range (&t->raddr, &p->raddr.start.ip6,
+				   &p->raddr.stop.ip6))
+    return 0;
+
+  if (!ipsec_fp_ip6_addr_in_range (&t->laddr, &p->laddr.start.ip6,
+				   &p->laddr.stop.ip6))
+    return 0;
+
+  if (PREDICT_FALSE (!ipsec_fp_proto_has_ports (t->protocol)))
+    return 1;
+
+  return (t->lport >= p->lport.start && t->lport <= p->lport.stop &&
+	  t->rport >= p->rport.start && t->rport <= p->rport.stop);
+}
+
+/**
+ * @brief Find the highest priority policy of the given type matching
+ * the tuple, or NULL
+ */
+always_inline ipsec_policy_t *
+ipsec_fp_ip6_lookup (ipsec_main_t *im, ipsec_spd_t *spd,
+		     ipsec_spd_policy_type_t type, ipsec_fp_ip6_tuple_t *t)
+{
+  ipsec_spd_fp_t *fp = &spd->fp;
+  ipsec_policy_t *best = 0, *p;
+  /* the AVX-512 key compare loads 64 bytes from the key */
+  union
+  {
+    clib_bihash_kv_40_8_t kv;
+    u64 as_u64[8];
+  } k;
+  ipsec_fp_mask_type_t *mt;
+  u32 *mti, *pi, *rules;
+  int i;
+
+  vec_foreach (mti, fp->mask_type_order[type])
+    {
+      mt = pool_elt_at_index (fp->mask_types, *mti);
+
+      if (best && best->priority >= mt->max_priority)
+	break;
+
+      for (i = 0; i < 5; i++)
+	k.kv.key[i] = t->as_u64[i] & mt->mask.as_u64[i];
+      ((ipsec_fp_ip6_tuple_t *) k.kv.key)->policy_type = type;
+      ((ipsec_fp_ip6_tuple_t *) k.kv.key)->mask_type_index = *mti;
+
+      if (clib_bihash_search_inline_40_8 (&fp->ip6_tbl, &k.kv))
+	continue;
+
+      rules = fp->rule_lists[k.kv.value];
+      vec_foreach (pi, rules)
+	{
+	  p = pool_elt_at_index (im->policies, *pi);
+	  if (best && best->priority >= p->priority)
+	    break;
+	  if (ipsec_fp_ip6_policy_match (p, t))
+	    {
+	      best = p;
+	      break;
+	    }
+	}
+    }
+
+  return best;
+}
+
+#endif /* __IPSEC_SPD_FP_H__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
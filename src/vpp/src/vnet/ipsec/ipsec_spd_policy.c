@@ -14,6 +14,7 @@
  */
 
 #include <vnet/ipsec/ipsec.h>
+#include <vnet/ipsec/ipsec_spd_fp.h>
 
 /**
  * @brief
@@ -179,6 +180,16 @@ ipsec_add_del_policy (vlib_main_t * vm,
       clib_atomic_store_relax_n (&im->ipsec4_out_spd_flow_cache_entries, 0);
     }
 
+  if (im->input_flow_cache_flag && !policy->is_ipv6 &&
+      (policy->type == IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT ||
+       policy->type == IPSEC_SPD_POLICY_IP4_INBOUND_BYPASS ||
+       policy->type == IPSEC_SPD_POLICY_IP4_INBOUND_DISCARD))
+    ipsec4_in_spd_flow_cache_invalidate (im);
+
+  if (im->output6_flow_cache_flag && policy->is_ipv6 &&
+      policy->type == IPSEC_SPD_POLICY_IP6_OUTBOUND)
+    ipsec6_out_spd_flow_cache_invalidate (im);
+
   if (is_add)
     {
       u32 policy_index;
@@ -205,6 +216,8 @@ ipsec_add_del_policy (vlib_main_t * vm,
       vec_add1 (spd->policies[policy->type], policy_index);
       vec_sort_with_function (spd->policies[policy->type],
 			      ipsec_spd_entry_sort);
+      if (ipsec_fp_is_enabled (im, policy->type))
+	ipsec_fp_add_del_policy (spd, policy_index, 1);
       *stat_index = policy_index;
     }
   else
@@ -217,6 +230,8 @@ ipsec_add_del_policy (vlib_main_t * vm,
 				spd->policies[policy->type][ii]);
 	if (ipsec_policy_is_equal (vp, policy))
 	  {
+	    if (ipsec_fp_is_enabled (im, vp->type))
+	      ipsec_fp_add_del_policy (spd, vp - im->policies, 0);
 	    vec_del1 (spd->policies[policy->type], ii);
 	    ipsec_sa_unlock (vp->sa_index);
 	    pool_put (im->policies, vp);
@@ -18,10 +18,12 @@
 #include <vlib/vlib.h>
 #include <vnet/vxlan/vxlan.h>
 #include <vnet/udp/udp_local.h>
+#include <vnet/gso/gro_func.h>
 
 #ifndef CLIB_MARCH_VARIANT
 vlib_node_registration_t vxlan4_input_node;
 vlib_node_registration_t vxlan6_input_node;
+vlib_node_registration_t vxlan4_gro_flush_node;
 #endif
 
 typedef struct
@@ -46,8 +48,6 @@ format_vxlan_rx_trace (u8 * s, va_list * args)
 		 t->tunnel_index, t->vni, t->next_index, t->error);
 }
 
-typedef vxlan4_tunnel_key_t last_tunnel_cache4;
-
 static const vxlan_decap_info_t decap_not_found = {
   .sw_if_index = ~0,
   .next_index = VXLAN_INPUT_NEXT_DROP,
@@ -61,7 +61,63 @@ static const vxlan_decap_info_t decap_bad_flags = {
 };
 
 always_inline vxlan_decap_info_t
-vxlan4_find_tunnel (vxlan_main_t * vxm, last_tunnel_cache4 * cache,
+vxlan4_find_mcast_tunnel (vxlan_main_t * vxm, ip4_header_t * ip4_0,
+			  vxlan4_tunnel_key_t * key4, u32 * stats_sw_if_index)
+{
+  if (PREDICT_TRUE (!ip4_address_is_multicast (&ip4_0->dst_address)))
+    return decap_not_found;
+
+  /* search for mcast decap info by mcast address */
+  key4->key[0] = ip4_0->dst_address.as_u32;
+  int rv = clib_bihash_search_inline_16_8 (&vxm->vxlan4_tunnel_by_key, key4);
+  if (rv != 0)
+    return decap_not_found;
+
+  /* search for unicast tunnel using the mcast tunnel local(src) ip */
+  vxlan_decap_info_t mdi = {.as_u64 = key4->value };
+  key4->key[0] = ((u64) mdi.local_ip.as_u32 << 32) |
+    ip4_0->src_address.as_u32;
+  rv = clib_bihash_search_inline_16_8 (&vxm->vxlan4_tunnel_by_key, key4);
+  if (PREDICT_FALSE (rv != 0))
+    return decap_not_found;
+
+  /* mcast traffic does not update the cache */
+  *stats_sw_if_index = mdi.sw_if_index;
+  vxlan_decap_info_t di = {.as_u64 = key4->value };
+  return di;
+}
+
+always_inline u32
+vxlan4_tunnel_cache_slot (ip4_header_t * ip4_0, udp_header_t * udp0,
+			  vxlan_header_t * vxlan0)
+{
+  /* the source port carries the flow entropy of the remote encap, so the
+     flows of a tunnel spread over the slots as RSS spreads them over the
+     workers */
+  u32 h = udp0->src_port ^ vxlan0->vni_reserved ^
+    ip4_0->src_address.as_u32;
+  h ^= h >> 16;
+  h ^= h >> 8;
+  return h & (VXLAN4_TUNNEL_CACHE_SIZE - 1);
+}
+
+always_inline vxlan4_tunnel_cache_t *
+vxlan4_get_tunnel_cache (vxlan_main_t * vxm, u32 thread_index)
+{
+  vxlan4_tunnel_cache_t *cache =
+    vec_elt_at_index (vxm->tunnel4_cache_by_thread, thread_index);
+
+  /* tunnels are deleted with the workers stopped, between frames */
+  if (PREDICT_FALSE (cache->epoch != vxm->tunnel4_cache_epoch))
+    {
+      clib_memset (cache->entries, 0xff, sizeof (cache->entries));
+      cache->epoch = vxm->tunnel4_cache_epoch;
+    }
+  return cache;
+}
+
+always_inline vxlan_decap_info_t
+vxlan4_find_tunnel (vxlan_main_t * vxm, vxlan4_tunnel_cache_t * cache,
 		    u32 fib_index, ip4_header_t * ip4_0,
 		    vxlan_header_t * vxlan0, u32 * stats_sw_if_index)
 {
@@ -78,12 +134,13 @@ vxlan4_find_tunnel (vxlan_main_t * vxm, last_tunnel_cache4 * cache,
     .key[1] = ((u64) udp->dst_port << 48) | ((u64) fib_index << 32) |
 	      vxlan0->vni_reserved,
   };
+  vxlan4_tunnel_key_t *e =
+    &cache->entries[vxlan4_tunnel_cache_slot (ip4_0, udp, vxlan0)];
 
-  if (PREDICT_TRUE
-      (key4.key[0] == cache->key[0] && key4.key[1] == cache->key[1]))
+  if (PREDICT_TRUE (key4.key[0] == e->key[0] && key4.key[1] == e->key[1]))
     {
       /* cache hit */
-      vxlan_decap_info_t di = {.as_u64 = cache->value };
+      vxlan_decap_info_t di = {.as_u64 = e->value };
       *stats_sw_if_index = di.sw_if_index;
       return di;
     }
@@ -91,33 +148,107 @@ vxlan4_find_tunnel (vxlan_main_t * vxm, last_tunnel_cache4 * cache,
   int rv = clib_bihash_search_inline_16_8 (&vxm->vxlan4_tunnel_by_key, &key4);
   if (PREDICT_TRUE (rv == 0))
     {
-      *cache = key4;
+      *e = key4;
       vxlan_decap_info_t di = {.as_u64 = key4.value };
       *stats_sw_if_index = di.sw_if_index;
       return di;
     }
 
-  /* try multicast */
-  if (PREDICT_TRUE (!ip4_address_is_multicast (&ip4_0->dst_address)))
-    return decap_not_found;
+  return vxlan4_find_mcast_tunnel (vxm, ip4_0, &key4, stats_sw_if_index);
+}
 
-  /* search for mcast decap info by mcast address */
-  key4.key[0] = dst;
-  rv = clib_bihash_search_inline_16_8 (&vxm->vxlan4_tunnel_by_key, &key4);
-  if (rv != 0)
-    return decap_not_found;
+/*
+ * Make sure VXLAN tunnels exist according to the packets' S/D IP, UDP port,
+ * VRF and VNI, for a whole frame. Packets whose key is in the thread's cache
+ * need no lookup; the keys of the others are hashed and their buckets
+ * prefetched in a first pass, then looked up in a second one, so that the
+ * cache misses on the tunnel table overlap.
+ */
+static_always_inline void
+vxlan4_find_tunnels (vxlan_main_t * vxm, vxlan4_tunnel_cache_t * cache,
+		     vlib_buffer_t ** b, u32 n_left, vxlan_decap_info_t * dis,
+		     u32 * stats_sw_if_index)
+{
+  clib_bihash_16_8_t *h = &vxm->vxlan4_tunnel_by_key;
+  vxlan4_tunnel_key_t keys[VLIB_FRAME_SIZE], *e;
+  u64 hashes[VLIB_FRAME_SIZE];
+  u8 slots[VLIB_FRAME_SIZE];
+  u16 misses[VLIB_FRAME_SIZE];
+  u32 i, j, n_misses = 0;
+  const u32 hdr_sz = sizeof (ip4_header_t) + sizeof (udp_header_t);
+
+  for (i = 0; i < n_left; i++)
+    {
+      if (i + 4 < n_left)
+	vlib_prefetch_buffer_header (b[i + 4], LOAD);
+      if (i + 2 < n_left)
+	CLIB_PREFETCH (vlib_buffer_get_current (b[i + 2]) - hdr_sz,
+		       sizeof (ip4_vxlan_header_t), LOAD);
 
-  /* search for unicast tunnel using the mcast tunnel local(src) ip */
-  vxlan_decap_info_t mdi = {.as_u64 = key4.value };
-  key4.key[0] = ((u64) mdi.local_ip.as_u32 << 32) | src;
-  rv = clib_bihash_search_inline_16_8 (&vxm->vxlan4_tunnel_by_key, &key4);
-  if (PREDICT_FALSE (rv != 0))
-    return decap_not_found;
+      /* udp leaves current_data pointing at the vxlan header */
+      vxlan_header_t *vxlan0 = vlib_buffer_get_current (b[i]);
+      ip4_header_t *ip4_0 = (void *) vxlan0 - hdr_sz;
+      udp_header_t *udp0 = ip4_next_header (ip4_0);
 
-  /* mcast traffic does not update the cache */
-  *stats_sw_if_index = mdi.sw_if_index;
-  vxlan_decap_info_t di = {.as_u64 = key4.value };
-  return di;
+      if (PREDICT_FALSE (vxlan0->flags != VXLAN_FLAGS_I))
+	{
+	  dis[i] = decap_bad_flags;
+	  continue;
+	}
+
+      keys[i].key[0] = ((u64) ip4_0->dst_address.as_u32 << 32) |
+	ip4_0->src_address.as_u32;
+      keys[i].key[1] = ((u64) udp0->dst_port << 48) |
+	((u64) vlib_buffer_get_ip4_fib_index (b[i]) << 32) |
+	vxlan0->vni_reserved;
+      slots[i] = vxlan4_tunnel_cache_slot (ip4_0, udp0, vxlan0);
+
+      e = &cache->entries[slots[i]];
+      if (PREDICT_TRUE (keys[i].key[0] == e->key[0] &&
+			keys[i].key[1] == e->key[1]))
+	{
+	  /* cache hit */
+	  dis[i].as_u64 = e->value;
+	  stats_sw_if_index[i] = dis[i].sw_if_index;
+	  continue;
+	}
+
+      hashes[i] = clib_bihash_hash_16_8 (&keys[i]);
+      clib_bihash_prefetch_bucket_16_8 (h, hashes[i]);
+      misses[n_misses++] = i;
+    }
+
+  for (j = 0; j < n_misses; j++)
+    {
+      if (j + 2 < n_misses)
+	clib_bihash_prefetch_data_16_8 (h, hashes[misses[j + 2]]);
+
+      i = misses[j];
+      e = &cache->entries[slots[i]];
+
+      /* an earlier packet of the frame may have filled the slot */
+      if (keys[i].key[0] == e->key[0] && keys[i].key[1] == e->key[1])
+	{
+	  dis[i].as_u64 = e->value;
+	  stats_sw_if_index[i] = dis[i].sw_if_index;
+	  continue;
+	}
+
+      if (PREDICT_TRUE
+	  (clib_bihash_search_inline_with_hash_16_8 (h, hashes[i], &keys[i])
+	   == 0))
+	{
+	  *e = keys[i];
+	  dis[i].as_u64 = keys[i].value;
+	  stats_sw_if_index[i] = dis[i].sw_if_index;
+	  continue;
+	}
+
+      /* try multicast */
+      dis[i] = vxlan4_find_mcast_tunnel (vxm, vlib_buffer_get_current (b[i]) -
+					 hdr_sz, &keys[i],
+					 &stats_sw_if_index[i]);
+    }
 }
 
 typedef vxlan6_tunnel_key_t last_tunnel_cache6;
@@ -180,6 +311,71 @@ vxlan6_find_tunnel (vxlan_main_t * vxm, last_tunnel_cache6 * cache,
   return di;
 }
 
+/*
+ * The flow table marks the packets it releases GSO with checksum offload,
+ * which is done with the header offsets
+ */
+static_always_inline void
+vxlan_gro_set_hdr_offsets (vlib_main_t * vm, u32 bi)
+{
+  vlib_buffer_t *b = vlib_get_buffer (vm, bi);
+  generic_header_offset_t gho = { 0 };
+
+  vnet_generic_header_offset_parser (b, &gho, 1 /* is_l2 */ ,
+				     (b->flags & VNET_BUFFER_F_IS_IP4) != 0,
+				     (b->flags & VNET_BUFFER_F_IS_IP6) != 0);
+  vnet_buffer (b)->l2_hdr_offset = b->current_data;
+  vnet_buffer (b)->l3_hdr_offset = b->current_data + gho.l3_hdr_offset;
+  vnet_buffer (b)->l4_hdr_offset = b->current_data + gho.l4_hdr_offset;
+  b->flags |= (VNET_BUFFER_F_L2_HDR_OFFSET_VALID |
+	       VNET_BUFFER_F_L3_HDR_OFFSET_VALID |
+	       VNET_BUFFER_F_L4_HDR_OFFSET_VALID);
+}
+
+/*
+ * Pass the decapsulated packets of the tunnels with GRO enabled through the
+ * thread's flow table. The table may hold on to a packet, or release it
+ * with one held from an earlier frame, so the buffers and nexts to enqueue
+ * are rewritten to 'to' and 'to_nexts', which have room for the table.
+ */
+static_always_inline u32
+vxlan4_gro (vlib_main_t * vm, vxlan_main_t * vxm, vlib_buffer_t ** b,
+	    u32 * from, u16 * nexts, u32 n_left, u32 * to, u16 * to_nexts)
+{
+  gro_flow_table_t *ft = vxm->gro_flow_tables[vm->thread_index];
+  u32 i, n_to = 0;
+
+  for (i = 0; i < n_left; i++)
+    {
+      if (nexts[i] != VXLAN_INPUT_NEXT_L2_INPUT ||
+	  !clib_bitmap_get (vxm->gro_enabled_by_sw_if,
+			    vnet_buffer (b[i])->sw_if_index[VLIB_RX]))
+	{
+	  to[n_to] = from[i];
+	  to_nexts[n_to++] = nexts[i];
+	  continue;
+	}
+
+      /* what is known of the outer headers does not hold for the inner */
+      b[i]->flags &= ~(VNET_BUFFER_F_IS_IP4 | VNET_BUFFER_F_IS_IP6 |
+		       VNET_BUFFER_F_L4_CHECKSUM_COMPUTED |
+		       VNET_BUFFER_F_L4_CHECKSUM_CORRECT |
+		       VNET_BUFFER_F_L2_HDR_OFFSET_VALID |
+		       VNET_BUFFER_F_L3_HDR_OFFSET_VALID |
+		       VNET_BUFFER_F_L4_HDR_OFFSET_VALID);
+
+      u32 n = vnet_gro_flow_table_inline (vm, ft, from[i], to + n_to);
+      while (n--)
+	{
+	  if (vlib_get_buffer (vm, to[n_to])->flags & VNET_BUFFER_F_GSO)
+	    vxlan_gro_set_hdr_offsets (vm, to[n_to]);
+	  to_nexts[n_to++] = VXLAN_INPUT_NEXT_L2_INPUT;
+	}
+    }
+
+  return n_to;
+}
+
 always_inline uword
 vxlan_input (vlib_main_t * vm,
 	     vlib_node_runtime_t * node,
@@ -190,22 +386,24 @@ vxlan_input (vlib_main_t * vm,
   vnet_interface_main_t *im = &vnm->interface_main;
   vlib_combined_counter_main_t *rx_counter =
     im->combined_sw_if_counters + VNET_INTERFACE_COUNTER_RX;
-  last_tunnel_cache4 last4;
   last_tunnel_cache6 last6;
+  vxlan_decap_info_t dis4[VLIB_FRAME_SIZE], *di4 = dis4;
+  u32 stats_ifs4[VLIB_FRAME_SIZE], *stats_if4 = stats_ifs4;
   u32 pkts_dropped = 0;
   u32 thread_index = vlib_get_thread_index ();
 
-  if (is_ip4)
-    clib_memset (&last4, 0xff, sizeof last4);
-  else
-    clib_memset (&last6, 0xff, sizeof last6);
-
   u32 *from = vlib_frame_vector_args (from_frame);
   u32 n_left_from = from_frame->n_vectors;
 
   vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b = bufs;
   vlib_get_buffers (vm, from, bufs, n_left_from);
 
+  if (is_ip4)
+    vxlan4_find_tunnels (vxm, vxlan4_get_tunnel_cache (vxm, thread_index),
+			 bufs, n_left_from, dis4, stats_ifs4);
+  else
+    clib_memset (&last6, 0xff, sizeof last6);
+
   u32 stats_if0 = ~0, stats_if1 = ~0;
   u16 nexts[VLIB_FRAME_SIZE], *next = nexts;
   while (n_left_from >= 4)
@@ -220,33 +418,33 @@ vxlan_input (vlib_main_t * vm,
       vxlan_header_t *vxlan0 = cur0;
       vxlan_header_t *vxlan1 = cur1;
 
+      /* pop vxlan */
+      vlib_buffer_advance (b[0], sizeof *vxlan0);
+      vlib_buffer_advance (b[1], sizeof *vxlan1);
 
-      ip4_header_t *ip4_0, *ip4_1;
-      ip6_header_t *ip6_0, *ip6_1;
+      /* ip4 tunnels were looked up for the whole frame */
+      vxlan_decap_info_t di0, di1;
       if (is_ip4)
 	{
-	  ip4_0 = cur0 - sizeof (udp_header_t) - sizeof (ip4_header_t);
-	  ip4_1 = cur1 - sizeof (udp_header_t) - sizeof (ip4_header_t);
+	  di0 = di4[0];
+	  di1 = di4[1];
+	  stats_if0 = stats_if4[0];
+	  stats_if1 = stats_if4[1];
 	}
       else
 	{
+	  ip6_header_t *ip6_0, *ip6_1;
 	  ip6_0 = cur0 - sizeof (udp_header_t) - sizeof (ip6_header_t);
 	  ip6_1 = cur1 - sizeof (udp_header_t) - sizeof (ip6_header_t);
-	}
-
-      /* pop vxlan */
-      vlib_buffer_advance (b[0], sizeof *vxlan0);
-      vlib_buffer_advance (b[1], sizeof *vxlan1);
 
-      u32 fi0 = vlib_buffer_get_ip_fib_index (b[0], is_ip4);
-      u32 fi1 = vlib_buffer_get_ip_fib_index (b[1], is_ip4);
+	  u32 fi0 = vlib_buffer_get_ip6_fib_index (b[0]);
+	  u32 fi1 = vlib_buffer_get_ip6_fib_index (b[1]);
 
-      vxlan_decap_info_t di0 = is_ip4 ?
-	vxlan4_find_tunnel (vxm, &last4, fi0, ip4_0, vxlan0, &stats_if0) :
-	vxlan6_find_tunnel (vxm, &last6, fi0, ip6_0, vxlan0, &stats_if0);
-      vxlan_decap_info_t di1 = is_ip4 ?
-	vxlan4_find_tunnel (vxm, &last4, fi1, ip4_1, vxlan1, &stats_if1) :
-	vxlan6_find_tunnel (vxm, &last6, fi1, ip6_1, vxlan1, &stats_if1);
+	  di0 = vxlan6_find_tunnel (vxm, &last6, fi0, ip6_0, vxlan0,
+				    &stats_if0);
+	  di1 = vxlan6_find_tunnel (vxm, &last6, fi1, ip6_1, vxlan1,
+				    &stats_if1);
+	}
 
       /* Prefetch next iteration. */
       clib_prefetch_load (b[2]->data);
@@ -323,6 +521,8 @@ vxlan_input (vlib_main_t * vm,
 	}
       b += 2;
       next += 2;
+      di4 += 2;
+      stats_if4 += 2;
       n_left_from -= 2;
     }
 
@@ -331,21 +531,25 @@ vxlan_input (vlib_main_t * vm,
       /* udp leaves current_data pointing at the vxlan header */
       void *cur0 = vlib_buffer_get_current (b[0]);
       vxlan_header_t *vxlan0 = cur0;
-      ip4_header_t *ip4_0;
-      ip6_header_t *ip6_0;
-      if (is_ip4)
-	ip4_0 = cur0 - sizeof (udp_header_t) - sizeof (ip4_header_t);
-      else
-	ip6_0 = cur0 - sizeof (udp_header_t) - sizeof (ip6_header_t);
 
       /* pop (ip, udp, vxlan) */
       vlib_buffer_advance (b[0], sizeof (*vxlan0));
 
-      u32 fi0 = vlib_buffer_get_ip_fib_index (b[0], is_ip4);
+      vxlan_decap_info_t di0;
+      if (is_ip4)
+	{
+	  di0 = di4[0];
+	  stats_if0 = stats_if4[0];
+	}
+      else
+	{
+	  ip6_header_t *ip6_0 =
+	    cur0 - sizeof (udp_header_t) - sizeof (ip6_header_t);
+	  u32 fi0 = vlib_buffer_get_ip6_fib_index (b[0]);
 
-      vxlan_decap_info_t di0 = is_ip4 ?
-	vxlan4_find_tunnel (vxm, &last4, fi0, ip4_0, vxlan0, &stats_if0) :
-	vxlan6_find_tunnel (vxm, &last6, fi0, ip6_0, vxlan0, &stats_if0);
+	  di0 = vxlan6_find_tunnel (vxm, &last6, fi0, ip6_0, vxlan0,
+				    &stats_if0);
+	}
 
       uword len0 = vlib_buffer_length_in_chain (vm, b[0]);
 
@@ -381,9 +585,21 @@ vxlan_input (vlib_main_t * vm,
 	}
       b += 1;
       next += 1;
+      di4 += 1;
+      stats_if4 += 1;
       n_left_from -= 1;
     }
-  vlib_buffer_enqueue_to_next (vm, node, from, nexts, from_frame->n_vectors);
+  if (is_ip4 && PREDICT_FALSE (vxm->n_gro != 0))
+    {
+      u32 to[GRO_TO_VECTOR_SIZE (VLIB_FRAME_SIZE)];
+      u16 to_nexts[GRO_TO_VECTOR_SIZE (VLIB_FRAME_SIZE)];
+      u32 n_to = vxlan4_gro (vm, vxm, bufs, from, nexts,
+			     from_frame->n_vectors, to, to_nexts);
+      vlib_buffer_enqueue_to_next (vm, node, to, to_nexts, n_to);
+    }
+  else
+    vlib_buffer_enqueue_to_next (vm, node, from, nexts,
+				 from_frame->n_vectors);
   /* Do we still need this now that tunnel tx stats is kept? */
   u32 node_idx = is_ip4 ? vxlan4_input_node.index : vxlan6_input_node.index;
   vlib_node_increment_counter (vm, node_idx, VXLAN_ERROR_DECAPSULATED,
@@ -442,6 +658,42 @@ VLIB_REGISTER_NODE (vxlan6_input_node) =
   },
   .format_trace = format_vxlan_rx_trace,
 };
+
+/* Flush the flows the thread's GRO table held for too long to l2-input */
+VLIB_NODE_FN (vxlan4_gro_flush_node) (vlib_main_t * vm,
+				      vlib_node_runtime_t * node,
+				      vlib_frame_t * frame)
+{
+  vxlan_main_t *vxm = &vxlan_main;
+  gro_flow_table_t *ft = vxm->gro_flow_tables[vm->thread_index];
+
+  if (ft->flow_table_size == 0 || !gro_flow_table_is_timeout (vm, ft))
+    return 0;
+
+  u32 to[GRO_FLOW_TABLE_MAX_SIZE];
+  u32 i, n_to = vnet_gro_flow_table_flush (vm, ft, to);
+
+  if (n_to > 0)
+    {
+      for (i = 0; i < n_to; i++)
+	vxlan_gro_set_hdr_offsets (vm, to[i]);
+      vlib_frame_t *f = vlib_get_frame_to_node (vm, ft->node_index);
+      clib_memcpy_fast (vlib_frame_vector_args (f), to,
+			n_to * sizeof (to[0]));
+      f->n_vectors = n_to;
+      vlib_put_frame_to_node (vm, ft->node_index, f);
+    }
+  gro_flow_table_set_timeout (vm, ft, GRO_FLOW_TABLE_FLUSH);
+
+  return n_to;
+}
+
+/* Polls once GRO is enabled on a tunnel, see vnet_vxlan_set_gro */
+VLIB_REGISTER_NODE (vxlan4_gro_flush_node) = {
+  .type = VLIB_NODE_TYPE_PRE_INPUT,
+  .name = "vxlan4-gro-flush",
+  .state = VLIB_NODE_STATE_DISABLED,
+};
 /* *INDENT-ON* */
 
 typedef enum
@@ -466,7 +718,7 @@ ip_vxlan_bypass_inline (vlib_main_t * vm,
 				   matching a local VTEP address */
   vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b = bufs;
 
-  last_tunnel_cache4 last4;
+  vxlan4_tunnel_cache_t *cache4 = 0;
   last_tunnel_cache6 last6;
 
   from = vlib_frame_vector_args (frame);
@@ -481,7 +733,7 @@ ip_vxlan_bypass_inline (vlib_main_t * vm,
   if (is_ip4)
     {
       vtep4_key_init (&last_vtep4);
-      clib_memset (&last4, 0xff, sizeof last4);
+      cache4 = vxlan4_get_tunnel_cache (vxm, vm->thread_index);
     }
   else
     {
@@ -569,7 +821,7 @@ ip_vxlan_bypass_inline (vlib_main_t * vm,
 
 	  vxlan_decap_info_t di0 =
 	    is_ip4 ?
-	      vxlan4_find_tunnel (vxm, &last4, fi0, ip40, vxlan0, &stats_if0) :
+	      vxlan4_find_tunnel (vxm, cache4, fi0, ip40, vxlan0, &stats_if0) :
 	      vxlan6_find_tunnel (vxm, &last6, fi0, ip60, vxlan0, &stats_if0);
 
 	  if (PREDICT_FALSE (di0.sw_if_index == ~0))
@@ -657,7 +909,7 @@ ip_vxlan_bypass_inline (vlib_main_t * vm,
 
 	  vxlan_decap_info_t di1 =
 	    is_ip4 ?
-	      vxlan4_find_tunnel (vxm, &last4, fi1, ip41, vxlan1, &stats_if1) :
+	      vxlan4_find_tunnel (vxm, cache4, fi1, ip41, vxlan1, &stats_if1) :
 	      vxlan6_find_tunnel (vxm, &last6, fi1, ip61, vxlan1, &stats_if1);
 
 	  if (PREDICT_FALSE (di1.sw_if_index == ~0))
@@ -784,7 +1036,7 @@ ip_vxlan_bypass_inline (vlib_main_t * vm,
 
 	  vxlan_decap_info_t di0 =
 	    is_ip4 ?
-	      vxlan4_find_tunnel (vxm, &last4, fi0, ip40, vxlan0, &stats_if0) :
+	      vxlan4_find_tunnel (vxm, cache4, fi0, ip40, vxlan0, &stats_if0) :
 	      vxlan6_find_tunnel (vxm, &last6, fi0, ip60, vxlan0, &stats_if0);
 
 	  if (PREDICT_FALSE (di0.sw_if_index == ~0))
@@ -97,6 +97,12 @@ format_vxlan_tunnel (u8 * s, va_list * args)
     s = format (s, "flow-index %d [%U]", t->flow_index,
 		format_flow_enabled_hw, t->flow_index);
 
+  if (t->esp_fused)
+    s = format (s, "esp-fused ");
+
+  if (t->gro)
+    s = format (s, "gro ");
+
   return s;
 }
 
@@ -640,11 +646,24 @@ int vnet_vxlan_add_del_tunnel
       sw_if_index = t->sw_if_index;
       vnet_sw_interface_set_flags (vnm, sw_if_index, 0 /* down */ );
 
+      if (t->esp_fused)
+	vxm->n_esp_fused--;
+      if (t->gro)
+	{
+	  vxm->gro_enabled_by_sw_if =
+	    clib_bitmap_set (vxm->gro_enabled_by_sw_if, sw_if_index, 0);
+	  vxm->n_gro--;
+	}
+
       vxm->tunnel_index_by_sw_if_index[sw_if_index] = ~0;
 
       if (!is_ip6)
-	clib_bihash_add_del_16_8 (&vxm->vxlan4_tunnel_by_key, &key4,
-				  0 /*del */ );
+	{
+	  clib_bihash_add_del_16_8 (&vxm->vxlan4_tunnel_by_key, &key4,
+				    0 /*del */ );
+	  /* the workers may have the key cached */
+	  vxm->tunnel4_cache_epoch++;
+	}
       else
 	clib_bihash_add_del_24_8 (&vxm->vxlan6_tunnel_by_key, &key6,
 				  0 /*del */ );
@@ -957,6 +976,14 @@ show_vxlan_tunnel_command_fn (vlib_main_t * vm,
   }
 /* *INDENT-ON* */
 
+  if (vxm->n_gro)
+    {
+      gro_flow_table_t **ft;
+      vec_foreach (ft, vxm->gro_flow_tables)
+	vlib_cli_output (vm, "gro thread %d: %U", ft - vxm->gro_flow_tables,
+			 gro_flow_table_format, *ft);
+    }
+
   if (raw)
     {
       vlib_cli_output (vm, "Raw IPv4 Hash Table:\n%U\n",
@@ -1234,6 +1261,271 @@ vnet_vxlan_get_tunnel_index (u32 sw_if_index)
   return vxm->tunnel_index_by_sw_if_index[sw_if_index];
 }
 
+/**
+ * Have the ESP encrypt node build the underlay of the IPv4 tunnel with the
+ * given sw_if_index, so that when the underlay resolves through an IPsec
+ * protected midchain the packets get VXLAN and ESP headers in one node.
+ * Packets for which that's not possible still go through vxlan4-encap.
+ */
+int
+vnet_vxlan_set_esp_fused (u32 sw_if_index, u8 is_enable)
+{
+  vxlan_main_t *vxm = &vxlan_main;
+  vnet_main_t *vnm = vxm->vnet_main;
+  vlib_node_t *fused_node;
+  vxlan_tunnel_t *t;
+  u32 t_index;
+
+  t_index = vnet_vxlan_get_tunnel_index (sw_if_index);
+  if (t_index == ~0)
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  t = pool_elt_at_index (vxm->tunnels, t_index);
+  if (!ip46_address_is_ip4 (&t->dst))
+    return VNET_API_ERROR_INVALID_ADDRESS_FAMILY;
+  if (ip46_address_is_multicast (&t->dst))
+    return VNET_API_ERROR_INVALID_DST_ADDRESS;
+
+  if (!is_enable == !t->esp_fused)
+    return 0;
+
+  if (is_enable)
+    {
+      fused_node =
+	vlib_get_node_by_name (vxm->vlib_main, (u8 *) "esp4-encrypt-vxlan");
+      vnet_set_interface_output_node (vnm, t->hw_if_index, fused_node->index);
+      vxm->n_esp_fused++;
+    }
+  else
+    {
+      vnet_set_interface_output_node (vnm, t->hw_if_index,
+				      vxlan4_encap_node.index);
+      vxm->n_esp_fused--;
+    }
+  t->esp_fused = is_enable;
+
+  /* l2-output caches the tunnel's output node */
+  l2_input_config_t *config = l2input_intf_config (sw_if_index);
+  if (l2_input_is_bridge (config) || l2_input_is_xconnect (config))
+    l2output_create_output_node_mapping (vxm->vlib_main, vnm, sw_if_index);
+
+  return 0;
+}
+
+static clib_error_t *
+vxlan_esp_fused_command_fn (vlib_main_t *vm, unformat_input_t *input,
+			    vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  clib_error_t *error = 0;
+  u32 sw_if_index = ~0;
+  u8 is_enable = 1;
+  int rv;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "%U", unformat_vnet_sw_interface, vnm,
+		    &sw_if_index))
+	;
+      else if (unformat (line_input, "disable"))
+	is_enable = 0;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (sw_if_index == ~0)
+    {
+      error = clib_error_return (0, "missing tunnel interface");
+      goto done;
+    }
+
+  rv = vnet_vxlan_set_esp_fused (sw_if_index, is_enable);
+  switch (rv)
+    {
+    case 0:
+      break;
+    case VNET_API_ERROR_INVALID_SW_IF_INDEX:
+      error = clib_error_return (0, "%U is not a vxlan tunnel",
+				 format_vnet_sw_if_index_name, vnm,
+				 sw_if_index);
+      break;
+    default:
+      error = clib_error_return (
+	0, "only IPv4 unicast tunnels are supported (%d)", rv);
+      break;
+    }
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+/*?
+ * Build the VXLAN and ESP headers of the packets sent on an IPv4 VXLAN
+ * tunnel in one node, when the tunnel's underlay resolves through an
+ * IPsec protected interface with no encap of its own, i.e. an ipsec
+ * interface. The packets skip vxlan4-encap, ip4-midchain and
+ * esp4-encrypt-tun; the ones that can't, e.g. because the protected
+ * interface has output features or their size is above its MTU, still go
+ * through those nodes. While any tunnel is in this mode, the decrypted
+ * VXLAN packets received on an IPsec protected interface without input
+ * features go directly to vxlan4-input, as with the vxlan-bypass feature.
+ *
+ * @cliexpar
+ * @cliexcmd{set vxlan esp-fused vxlan_tunnel0}
+ * @cliexcmd{set vxlan esp-fused vxlan_tunnel0 disable}
+ ?*/
+VLIB_CLI_COMMAND (vxlan_esp_fused_command, static) = {
+  .path = "set vxlan esp-fused",
+  .short_help = "set vxlan esp-fused <tunnel-name> [disable]",
+  .function = vxlan_esp_fused_command_fn,
+};
+
+/**
+ * Coalesce the TCP segments decapsulated from the IPv4 tunnel with the
+ * given sw_if_index, with a GRO flow table per thread, before they go on
+ * to l2-input. The flows are held for at most GRO_FLOW_TIMEOUT, a pre-input
+ * node flushes them when no further segment comes in time.
+ */
+int
+vnet_vxlan_set_gro (u32 sw_if_index, u8 is_enable)
+{
+  vxlan_main_t *vxm = &vxlan_main;
+  gro_flow_table_t **ft;
+  vxlan_tunnel_t *t;
+  u32 t_index;
+
+  t_index = vnet_vxlan_get_tunnel_index (sw_if_index);
+  if (t_index == ~0)
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  t = pool_elt_at_index (vxm->tunnels, t_index);
+  if (!ip46_address_is_ip4 (&t->dst))
+    return VNET_API_ERROR_INVALID_ADDRESS_FAMILY;
+  if (t->decap_next_index != VXLAN_INPUT_NEXT_L2_INPUT)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  if (!is_enable == !t->gro)
+    return 0;
+
+  if (is_enable && !vxm->gro_flow_tables)
+    {
+      vlib_node_t *l2_input =
+	vlib_get_node_by_name (vxm->vlib_main, (u8 *) "l2-input");
+
+      /* the tables stay, they may hold packets after the last tunnel
+	 has GRO disabled until the pre-input node flushes them */
+      vec_validate (vxm->gro_flow_tables, vlib_num_workers ());
+      vec_foreach (ft, vxm->gro_flow_tables)
+	gro_flow_table_init (ft, 1 /* is_l2 */ , l2_input->index);
+
+      foreach_vlib_main ()
+	{
+	  vlib_node_set_state (this_vlib_main, vxlan4_gro_flush_node.index,
+			       VLIB_NODE_STATE_POLLING);
+	}
+    }
+
+  vxm->gro_enabled_by_sw_if =
+    clib_bitmap_set (vxm->gro_enabled_by_sw_if, sw_if_index, is_enable);
+  if (is_enable)
+    vxm->n_gro++;
+  else
+    vxm->n_gro--;
+  t->gro = is_enable;
+
+  return 0;
+}
+
+static clib_error_t *
+vxlan_gro_command_fn (vlib_main_t *vm, unformat_input_t *input,
+		      vlib_cli_command_t *cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  clib_error_t *error = 0;
+  u32 sw_if_index = ~0;
+  u8 is_enable = 1;
+  int rv;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "%U", unformat_vnet_sw_interface, vnm,
+		    &sw_if_index))
+	;
+      else if (unformat (line_input, "disable"))
+	is_enable = 0;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (sw_if_index == ~0)
+    {
+      error = clib_error_return (0, "missing tunnel interface");
+      goto done;
+    }
+
+  rv = vnet_vxlan_set_gro (sw_if_index, is_enable);
+  switch (rv)
+    {
+    case 0:
+      break;
+    case VNET_API_ERROR_INVALID_SW_IF_INDEX:
+      error = clib_error_return (0, "%U is not a vxlan tunnel",
+				 format_vnet_sw_if_index_name, vnm,
+				 sw_if_index);
+      break;
+    case VNET_API_ERROR_INVALID_VALUE:
+      error = clib_error_return (0, "the tunnel does not decap to l2");
+      break;
+    default:
+      error = clib_error_return (0, "only IPv4 tunnels are supported (%d)",
+				 rv);
+      break;
+    }
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+/*?
+ * Coalesce the TCP segments received on an IPv4 VXLAN tunnel after
+ * decapsulation, before they are switched, so that e.g. a tap or virtio
+ * interface in the bridge domain gets fewer, larger packets. Each thread
+ * keeps its own flow table and holds a flow for at most 10 microseconds.
+ * The coalesced packets are marked GSO; an output interface without GSO
+ * support needs the gso feature enabled to segment them again.
+ *
+ * @cliexpar
+ * @cliexcmd{set vxlan gro vxlan_tunnel0}
+ * @cliexcmd{set vxlan gro vxlan_tunnel0 disable}
+ ?*/
+VLIB_CLI_COMMAND (vxlan_gro_command, static) = {
+  .path = "set vxlan gro",
+  .short_help = "set vxlan gro <tunnel-name> [disable]",
+  .function = vxlan_gro_command_fn,
+};
+
 static clib_error_t *
 vxlan_offload_command_fn (vlib_main_t * vm,
 			  unformat_input_t * input, vlib_cli_command_t * cmd)
@@ -1330,6 +1622,12 @@ vxlan_init (vlib_main_t * vm)
   clib_bihash_init_24_8 (&vxm->vxlan6_tunnel_by_key, "vxlan6",
 			 VXLAN_HASH_NUM_BUCKETS, VXLAN_HASH_MEMORY_SIZE);
   vxm->vtep_table = vtep_table_create ();
+
+  vxlan4_tunnel_cache_t *cache;
+  vec_validate_aligned (vxm->tunnel4_cache_by_thread, vlib_num_workers (),
+			CLIB_CACHE_LINE_BYTES);
+  vec_foreach (cache, vxm->tunnel4_cache_by_thread)
+    cache->epoch = ~vxm->tunnel4_cache_epoch;
   vxm->mcast_shared = hash_create_mem (0,
 				       sizeof (ip46_address_t),
 				       sizeof (mcast_shared_t));
@@ -32,6 +32,7 @@
 #include <vnet/udp/udp_packet.h>
 #include <vnet/dpo/dpo.h>
 #include <vnet/adj/adj_types.h>
+#include <vnet/gso/gro.h>
 
 /* *INDENT-OFF* */
 typedef CLIB_PACKED (struct {
@@ -78,6 +79,21 @@ typedef union
   u64 as_u64;
 } vxlan_decap_info_t;
 
+/* Entries in the per-thread ip4 decap tunnel cache, a power of 2 */
+#define VXLAN4_TUNNEL_CACHE_SIZE 64
+
+/*
+* Per-thread cache of recently used ip4 tunnel keys, direct mapped on a
+* hash of the outer UDP source port, VNI and source address
+*/
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* value of vxlan_main.tunnel4_cache_epoch the entries are valid for */
+  u32 epoch;
+  vxlan4_tunnel_key_t entries[VXLAN4_TUNNEL_CACHE_SIZE];
+} vxlan4_tunnel_cache_t;
+
 typedef struct
 {
   /* Required for pool_get_aligned */
@@ -134,6 +150,12 @@ typedef struct
   u32 dev_instance;		/* Real device instance in tunnel vector */
   u32 user_instance;		/* Instance name being shown to user */
 
+  /* encap and ESP encrypt in one node, see vnet_vxlan_set_esp_fused */
+  u8 esp_fused;
+
+  /* coalesce the decapsulated TCP packets, see vnet_vxlan_set_gro */
+  u8 gro;
+
   VNET_DECLARE_REWRITE;
 } vxlan_tunnel_t;
 
@@ -193,6 +215,21 @@ typedef struct
   /* cache for last 8 vxlan tunnel */
   vtep4_cache_t vtep4_u512;
 
+  /* decap tunnel caches, by thread index, flushed when a tunnel is
+     deleted and the epoch moves on */
+  vxlan4_tunnel_cache_t *tunnel4_cache_by_thread;
+  u32 tunnel4_cache_epoch;
+
+  /* number of tunnels in esp-fused mode, the ESP tunnel decrypt nodes
+     pass decrypted VXLAN straight to vxlan4-input while there are any */
+  u32 n_esp_fused;
+
+  /* GRO after ip4 decap, flow tables by thread index and the tunnels
+     it's enabled on */
+  gro_flow_table_t **gro_flow_tables;
+  uword *gro_enabled_by_sw_if;
+  u32 n_gro;
+
 } vxlan_main_t;
 
 extern vxlan_main_t vxlan_main;
@@ -202,6 +239,7 @@ extern vlib_node_registration_t vxlan6_input_node;
 extern vlib_node_registration_t vxlan4_encap_node;
 extern vlib_node_registration_t vxlan6_encap_node;
 extern vlib_node_registration_t vxlan4_flow_input_node;
+extern vlib_node_registration_t vxlan4_gro_flush_node;
 
 u8 *format_vxlan_encap_trace (u8 * s, va_list * args);
 
@@ -231,6 +269,86 @@ void vnet_int_vxlan_bypass_mode (u32 sw_if_index, u8 is_ip6, u8 is_enable);
 int vnet_vxlan_add_del_rx_flow (u32 hw_if_index, u32 t_imdex, int is_add);
 
 u32 vnet_vxlan_get_tunnel_index (u32 sw_if_index);
+
+int vnet_vxlan_set_esp_fused (u32 sw_if_index, u8 is_enable);
+int vnet_vxlan_set_gro (u32 sw_if_index, u8 is_enable);
+
+/**
+ * Prepend tunnel t's IPv4 underlay to the l2 frame in b, as vxlan4-encap
+ * does for a buffer without checksum offload.
+ * Returns the length of the encapsulated packet.
+ */
+always_inline u32
+vxlan4_encap_one (vlib_main_t *vm, vxlan_tunnel_t *t, vlib_buffer_t *b)
+{
+  u32 flow_hash = vnet_l2_compute_flow_hash (b);
+  ip4_vxlan_header_t *hdr;
+  ip_csum_t sum;
+  u32 len;
+
+  ASSERT (t->rewrite_header.data_bytes == sizeof (*hdr));
+  vnet_rewrite_one_header (*t, vlib_buffer_get_current (b), sizeof (*hdr));
+  vlib_buffer_advance (b, -(word) sizeof (*hdr));
+  hdr = vlib_buffer_get_current (b);
+  len = vlib_buffer_length_in_chain (vm, b);
+
+  /* Fix the IP4 checksum and length */
+  hdr->ip4.length = clib_host_to_net_u16 (len);
+  sum = ip_csum_update (hdr->ip4.checksum, 0, hdr->ip4.length, ip4_header_t,
+			length /* changed member */);
+  if (PREDICT_FALSE (b->flags & VNET_BUFFER_F_QOS_DATA_VALID))
+    {
+      hdr->ip4.tos = vnet_buffer2 (b)->qos.bits;
+      sum = ip_csum_update (sum, 0, hdr->ip4.tos, ip4_header_t,
+			    tos /* changed member */);
+    }
+  hdr->ip4.checksum = ip_csum_fold (sum);
+
+  /* Fix UDP length and set source port */
+  hdr->udp.length = clib_host_to_net_u16 (len - sizeof (ip4_header_t));
+  hdr->udp.src_port = flow_hash;
+
+  /* save inner packet flow_hash for load-balance node */
+  vnet_buffer (b)->ip.flow_hash = flow_hash;
+
+  return len;
+}
+
+/**
+ * Is the IPv4 packet in b VXLAN for a unicast tunnel, with nothing for
+ * ip4-input or ip4-local to check on the way to vxlan4-input; as for
+ * the vxlan-bypass feature, but without UDP checksum verification.
+ */
+always_inline int
+vxlan4_is_tunnel_packet (vxlan_main_t *vxm, vlib_buffer_t *b)
+{
+  ip4_header_t *ip4 = vlib_buffer_get_current (b);
+  udp_header_t *udp = ip4_next_header (ip4);
+  vxlan_header_t *vxlan = (vxlan_header_t *) (udp + 1);
+  vxlan4_tunnel_key_t key4;
+  u16 len;
+
+  if (PREDICT_FALSE (b->flags & VLIB_BUFFER_NEXT_PRESENT) ||
+      b->current_length < sizeof (ip4_vxlan_header_t))
+    return 0;
+
+  len = clib_net_to_host_u16 (ip4->length);
+  if (ip4->ip_version_and_header_length != 0x45 ||
+      ip4->protocol != IP_PROTOCOL_UDP || ip4_is_fragment (ip4) ||
+      len != b->current_length ||
+      clib_net_to_host_u16 (udp->length) != len - sizeof (*ip4) ||
+      udp->checksum != 0 || vxlan->flags != VXLAN_FLAGS_I)
+    return 0;
+
+  key4.key[0] =
+    ((u64) ip4->dst_address.as_u32 << 32) | ip4->src_address.as_u32;
+  key4.key[1] = ((u64) udp->dst_port << 48) |
+		((u64) vlib_buffer_get_ip4_fib_index (b) << 32) |
+		vxlan->vni_reserved;
+
+  return (0 == clib_bihash_search_inline_16_8 (&vxm->vxlan4_tunnel_by_key,
+					       &key4));
+}
 #endif /* included_vnet_vxlan_h */
 
 /*
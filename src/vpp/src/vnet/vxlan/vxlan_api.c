@@ -89,6 +89,36 @@ err:
   REPLY_MACRO (VL_API_VXLAN_OFFLOAD_RX_REPLY);
 }
 
+static void
+vl_api_vxlan_set_esp_fused_t_handler (vl_api_vxlan_set_esp_fused_t *mp)
+{
+  vl_api_vxlan_set_esp_fused_reply_t *rmp;
+  int rv = 0;
+
+  VALIDATE_SW_IF_INDEX (mp);
+
+  rv = vnet_vxlan_set_esp_fused (ntohl (mp->sw_if_index), mp->enable);
+
+  BAD_SW_IF_INDEX_LABEL;
+
+  REPLY_MACRO (VL_API_VXLAN_SET_ESP_FUSED_REPLY);
+}
+
+static void
+vl_api_vxlan_set_gro_t_handler (vl_api_vxlan_set_gro_t *mp)
+{
+  vl_api_vxlan_set_gro_reply_t *rmp;
+  int rv = 0;
+
+  VALIDATE_SW_IF_INDEX (mp);
+
+  rv = vnet_vxlan_set_gro (ntohl (mp->sw_if_index), mp->enable);
+
+  BAD_SW_IF_INDEX_LABEL;
+
+  REPLY_MACRO (VL_API_VXLAN_SET_GRO_REPLY);
+}
+
 static void
   vl_api_sw_interface_set_vxlan_bypass_t_handler
   (vl_api_sw_interface_set_vxlan_bypass_t * mp)
@@ -625,7 +625,30 @@ again:
 vapi_error_e
 vapi_wait (vapi_ctx_t ctx, vapi_wait_mode_e mode)
 {
-  return VAPI_ENOTSUP;
+  if (!ctx || !ctx->connected)
+    {
+      return VAPI_EINVAL;
+    }
+  if (mode != VAPI_WAIT_FOR_READ)
+    {
+      return VAPI_ENOTSUP;
+    }
+  api_main_t *am = vlibapi_get_main ();
+  svm_queue_t *q = am->vl_input_queue;
+  vapi_error_e rv = VAPI_OK;
+
+  svm_queue_lock (q);
+  if (q->cursize == 0)
+    {
+      /* bounded, so that a caller parked here can notice it is stopping */
+      svm_queue_timedwait (q, 1.0);
+      if (q->cursize == 0)
+	{
+	  rv = VAPI_EAGAIN;
+	}
+    }
+  svm_queue_unlock (q);
+  return rv;
 }
 
 static vapi_error_e
@@ -788,19 +811,21 @@ vapi_dispatch_one (vapi_ctx_t ctx)
       return VAPI_EINVAL;
     }
   const vapi_msg_id_t id = ctx->vl_msg_id_to_vapi_msg_t[vpp_id];
+  /* the size of a variable length array depends on its host order count */
+  vapi_get_swap_to_host_func (id) (msg);
   if (vapi_verify_msg_size (id, msg, size))
     {
       vapi_msg_free (ctx, msg);
       return VAPI_EINVAL;
     }
   u32 context;
-  vapi_get_swap_to_host_func (id) (msg);
   if (vapi_msg_is_with_context (id))
     {
       context = *(u32 *) (((u8 *) msg) + vapi_get_context_offset (id));
       /* is this a message originating from VAPI? */
       VAPI_DBG ("dispatch, context is %x", context);
-      if (context & context_counter_mask)
+      /* the details streamed by a get service go to their event callback */
+      if ((context & context_counter_mask) && !ctx->event_cbs[id].cb)
 	{
 	  rv = vapi_dispatch_response (ctx, id, context, msg);
 	  goto done;
@@ -177,10 +177,18 @@ extern "C"
 /**
  * @brief wait for connection to become readable or writable
  *
+ * @note only VAPI_WAIT_FOR_READ is supported; the wait gives up after about
+ * a second and returns VAPI_EAGAIN if no message arrived in the meantime.
+ * A queued memclnt_keepalive counts as readable, so a caller which waits
+ * before dispatching should connect with handle_keepalives disabled and
+ * answer keepalives itself, or vapi_dispatch_one may block after consuming
+ * it
+ *
  * @param ctx opaque vapi context
  * @param mode type of property to wait for - readability, writability or both
  *
- * @return VAPI_OK on success, other error code on error
+ * @return VAPI_OK if a message is waiting, VAPI_EAGAIN on timeout,
+ *         other error code on error
  */
   vapi_error_e vapi_wait (vapi_ctx_t ctx, vapi_wait_mode_e mode);
 
@@ -214,6 +222,10 @@ extern "C"
 /**
  * @brief set event callback to call when message with given id is dispatched
  *
+ * The details streamed in reply to a get request (e.g. lcp_itf_pair_get)
+ * are dispatched to their event callback, while the callback of the
+ * request sees the get reply and then the end of the stream.
+ *
  * @param ctx opaque vapi context
  * @param id message id
  * @param callback callback
@@ -29,6 +29,8 @@
 #include <vapi/vpe.api.vapi.h>
 #include <vapi/interface.api.vapi.h>
 #include <vapi/l2.api.vapi.h>
+#include <vapi/ipfix_export.api.vapi.h>
+#include <vapi/ip.api.vapi.h>
 #include <fake.api.vapi.h>
 
 #include <vppinfra/vec.h>
@@ -37,6 +39,8 @@
 DEFINE_VAPI_MSG_IDS_VPE_API_JSON;
 DEFINE_VAPI_MSG_IDS_INTERFACE_API_JSON;
 DEFINE_VAPI_MSG_IDS_L2_API_JSON;
+DEFINE_VAPI_MSG_IDS_IPFIX_EXPORT_API_JSON;
+DEFINE_VAPI_MSG_IDS_IP_API_JSON;
 DEFINE_VAPI_MSG_IDS_FAKE_API_JSON;
 
 static char *app_name = NULL;
@@ -573,6 +577,109 @@ START_TEST (test_loopbacks_1)
 
 END_TEST;
 
+typedef struct
+{
+  bool last_called;
+  int reply_called;
+  int details_called;
+} exporter_get_ctx;
+
+vapi_error_e
+exporter_get_cb (struct vapi_ctx_s *ctx, void *callback_ctx,
+		 vapi_error_e rv, bool is_last,
+		 vapi_payload_ipfix_all_exporter_get_reply * reply)
+{
+  exporter_get_ctx *gctx = callback_ctx;
+  ck_assert_int_eq (VAPI_OK, rv);
+  ck_assert_int_eq (false, gctx->last_called);
+  if (is_last)
+    {
+      ck_assert (NULL == reply);
+      gctx->last_called = true;
+    }
+  else
+    {
+      ck_assert (NULL != reply);
+      ck_assert_int_eq (0, reply->retval);
+      ck_assert_int_eq ((u32) ~0, reply->cursor);
+      ++gctx->reply_called;
+    }
+  return VAPI_OK;
+}
+
+vapi_error_e
+exporter_details_cb (struct vapi_ctx_s *ctx, void *callback_ctx,
+		     vapi_payload_ipfix_all_exporter_details * details)
+{
+  exporter_get_ctx *gctx = callback_ctx;
+  /* the details arrive before the get reply */
+  ck_assert_int_eq (0, gctx->reply_called);
+  ck_assert_int_eq (false, gctx->last_called);
+  ++gctx->details_called;
+  return VAPI_OK;
+}
+
+START_TEST (test_get_details)
+{
+  printf ("--- Get service details dispatched to the event callback ---\n");
+  exporter_get_ctx gctx = { 0 };
+  vapi_set_vapi_msg_ipfix_all_exporter_details_event_cb (
+    ctx, exporter_details_cb, &gctx);
+  vapi_msg_ipfix_all_exporter_get *get =
+    vapi_alloc_ipfix_all_exporter_get (ctx);
+  get->payload.cursor = 0;
+  vapi_error_e rv =
+    vapi_ipfix_all_exporter_get (ctx, get, exporter_get_cb, &gctx);
+  ck_assert_int_eq (VAPI_OK, rv);
+  ck_assert_int_eq (true, gctx.last_called);
+  ck_assert_int_eq (1, gctx.reply_called);
+  /* the default exporter always exists */
+  ck_assert_int_ne (0, gctx.details_called);
+  vapi_clear_event_cb (ctx, vapi_msg_id_ipfix_all_exporter_details);
+}
+
+END_TEST;
+
+vapi_error_e
+route_bulk_cb (struct vapi_ctx_s *ctx, void *caller_ctx, vapi_error_e rv,
+	       bool is_last, vapi_payload_ip_route_add_del_bulk_reply *reply)
+{
+  int *called = caller_ctx;
+  ck_assert_int_eq (VAPI_OK, rv);
+  ck_assert_int_eq (true, is_last);
+  ck_assert_int_eq (2, reply->n_routes);
+  ck_assert_int_eq (2, reply->n_failed);
+  ck_assert_int_ne (0, reply->retvals[0]);
+  ck_assert_int_ne (0, reply->retvals[1]);
+  ++*called;
+  return VAPI_OK;
+}
+
+START_TEST (test_variable_reply)
+{
+  printf ("--- Reply with a variable length array ---\n");
+  int called = 0;
+  /* there is no table 4242, both routes fail */
+  vapi_msg_ip_route_add_del_bulk *bulk =
+    vapi_alloc_ip_route_add_del_bulk (ctx, 2);
+  ck_assert_ptr_ne (NULL, bulk);
+  int i;
+  for (i = 0; i < 2; ++i)
+    {
+      bulk->payload.routes[i].table_id = 4242;
+      bulk->payload.routes[i].prefix.address.af = ADDRESS_IP4;
+      bulk->payload.routes[i].prefix.address.un.ip4[0] = 10;
+      bulk->payload.routes[i].prefix.address.un.ip4[2] = i;
+      bulk->payload.routes[i].prefix.len = 24;
+    }
+  vapi_error_e rv =
+    vapi_ip_route_add_del_bulk (ctx, bulk, route_bulk_cb, &called);
+  ck_assert_int_eq (VAPI_OK, rv);
+  ck_assert_int_eq (1, called);
+}
+
+END_TEST;
+
 START_TEST (test_show_version_3)
 {
   printf ("--- Show version via async callback ---\n");
@@ -596,6 +703,32 @@ START_TEST (test_show_version_3)
 
 END_TEST;
 
+START_TEST (test_wait)
+{
+  printf ("--- Wait for a reply before dispatching it ---\n");
+  int called = 0;
+  vapi_error_e rv;
+  rv = vapi_wait (ctx, VAPI_WAIT_FOR_WRITE);
+  ck_assert_int_eq (VAPI_ENOTSUP, rv);
+  rv = vapi_wait (ctx, VAPI_WAIT_FOR_READ);
+  ck_assert_int_eq (VAPI_EAGAIN, rv);
+  vapi_msg_show_version *sv = vapi_alloc_show_version (ctx);
+  ck_assert_ptr_ne (NULL, sv);
+  while (VAPI_EAGAIN ==
+	 (rv = vapi_show_version (ctx, sv, show_version_cb, &called)))
+    ;
+  ck_assert_int_eq (VAPI_OK, rv);
+  while (VAPI_EAGAIN == (rv = vapi_wait (ctx, VAPI_WAIT_FOR_READ)))
+    ;
+  ck_assert_int_eq (VAPI_OK, rv);
+  ck_assert_int_eq (0, called);
+  rv = vapi_dispatch_one (ctx);
+  ck_assert_int_eq (VAPI_OK, rv);
+  ck_assert_int_eq (1, called);
+}
+
+END_TEST;
+
 START_TEST (test_show_version_4)
 {
   printf ("--- Show version via async callback - multiple messages ---\n");
@@ -951,6 +1084,8 @@ test_suite (void)
   tcase_add_test (tc_block, test_show_version_1);
   tcase_add_test (tc_block, test_show_version_2);
   tcase_add_test (tc_block, test_loopbacks_1);
+  tcase_add_test (tc_block, test_get_details);
+  tcase_add_test (tc_block, test_variable_reply);
   suite_add_tcase (s, tc_block);
 
   TCase *tc_nonblock = tcase_create ("Nonblocking API");
@@ -959,6 +1094,7 @@ test_suite (void)
   tcase_add_test (tc_nonblock, test_show_version_3);
   tcase_add_test (tc_nonblock, test_show_version_4);
   tcase_add_test (tc_nonblock, test_show_version_5);
+  tcase_add_test (tc_nonblock, test_wait);
   tcase_add_test (tc_nonblock, test_loopbacks_2);
   tcase_add_test (tc_nonblock, test_no_response_1);
   tcase_add_test (tc_nonblock, test_no_response_2);
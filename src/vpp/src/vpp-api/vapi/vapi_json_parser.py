@@ -353,6 +353,12 @@ class JsonParser(object):
                 if "events" in self.services[k]:
                     for x in self.services[k]["events"]:
                         self.events.add(x)
+            # the details streamed by a get service are delivered to the
+            # event callbacks, unless they're also the reply to a dump
+            for k in j['services']:
+                x = self.services[k].get("stream_msg")
+                if x is not None and x not in self.replies:
+                    self.events.add(x)
             for e in j['enums']:
                 name = e[0]
                 value_pairs = e[1:-1]
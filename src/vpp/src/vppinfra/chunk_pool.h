@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2022 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/** @file
+ * @brief Fixed length block allocator with stable element addresses.
+
+   A chunk pool hands out indices like a pool does, but keeps the
+   elements in a list of chunks rather than in a single vector. Growing
+   the pool allocates a new chunk and never moves the existing elements,
+   so the worker threads may keep translating indices to elements while
+   the main thread allocates, without a worker barrier.
+
+   Chunk k holds (1 << (log2_first_chunk_elts + k)) elements, i.e. each
+   chunk is as big as all the chunks before it together, like the vector
+   of a pool would grow. The chunk of an index is found with a count of
+   the leading zeros, and there are never more than a few tens of chunks,
+   whose pointers live in the pool itself.
+
+   Only the main thread allocates and frees elements. The chunk pointer
+   is written before the index of any element in the chunk can be handed
+   out, and the workers load it through the index, so that needs no
+   further synchronization.
+ */
+
+#ifndef included_chunk_pool_h
+#define included_chunk_pool_h
+
+#include <vppinfra/bitmap.h>
+#include <vppinfra/error.h>
+
+/** Enough chunks for 2^32 elements with the smallest first chunk */
+#define CHUNK_POOL_MAX_CHUNKS 32
+
+/** Aim for first chunks of about this many bytes */
+#define CHUNK_POOL_FIRST_CHUNK_BYTES 4096
+
+typedef struct
+{
+  /** Chunk k holds the elements from index
+      (1 << (log2_first_chunk_elts + k)) - (1 << log2_first_chunk_elts) */
+  u8 *chunks[CHUNK_POOL_MAX_CHUNKS];
+
+  /** Bitmap of indices of free objects. */
+  uword *free_bitmap;
+
+  /** Vector of free indices.  One element for each set bit in bitmap. */
+  u32 *free_indices;
+
+  /** Number of elements ever allocated, the next new index */
+  u32 n_elts;
+
+  /** Element size and alignment, set by the first allocation */
+  u32 elt_bytes;
+  u16 align;
+  u8 log2_first_chunk_elts;
+  u8 n_chunks;
+} chunk_pool_t;
+
+/** Index of the chunk holding element i */
+always_inline uword
+chunk_pool_chunk_index (chunk_pool_t * cp, uword i)
+{
+  return min_log2 (i + (1ULL << cp->log2_first_chunk_elts)) -
+    cp->log2_first_chunk_elts;
+}
+
+/** Index of the first element of chunk k */
+always_inline uword
+chunk_pool_chunk_first_index (chunk_pool_t * cp, uword k)
+{
+  return (1ULL << (cp->log2_first_chunk_elts + k)) -
+    (1ULL << cp->log2_first_chunk_elts);
+}
+
+/** Number of elements in chunk k */
+always_inline uword
+chunk_pool_chunk_elts (chunk_pool_t * cp, uword k)
+{
+  return 1ULL << (cp->log2_first_chunk_elts + k);
+}
+
+/** Use free bitmap to query whether given index is free */
+always_inline uword
+chunk_pool_is_free_index (chunk_pool_t * cp, uword i)
+{
+  return (i < cp->n_elts) ? clib_bitmap_get (cp->free_bitmap, i) : 1;
+}
+
+/** Returns pointer to element at given index, safe from any thread.
+    ASSERTs that the supplied index is valid. */
+always_inline void *
+chunk_pool_elt_at_index (chunk_pool_t * cp, uword i)
+{
+  uword k = chunk_pool_chunk_index (cp, i);
+
+  ASSERT (!chunk_pool_is_free_index (cp, i));
+  return cp->chunks[k] +
+    (i - chunk_pool_chunk_first_index (cp, k)) * cp->elt_bytes;
+}
+
+/** Index of the element at the given address. Slower than pointer
+    arithmetic on a pool, as the chunk of the element needs finding. */
+always_inline u32
+chunk_pool_index_of (chunk_pool_t * cp, const void *e)
+{
+  const u8 *p = e;
+  word k;
+
+  /* the big chunks at the end hold most of the elements */
+  for (k = cp->n_chunks - 1; k >= 0; k--)
+    {
+      uword offset = p - cp->chunks[k];
+      if (p >= cp->chunks[k] &&
+	  offset < chunk_pool_chunk_elts (cp, k) * cp->elt_bytes)
+	return chunk_pool_chunk_first_index (cp, k) + offset / cp->elt_bytes;
+    }
+  ASSERT (0);
+  return ~0;
+}
+
+/** Number of active elements in a chunk pool. */
+always_inline uword
+chunk_pool_elts (chunk_pool_t * cp)
+{
+  return cp->n_elts - vec_len (cp->free_indices);
+}
+
+/** Number of elements allocated so far, the bound of the indices.
+
+    @note You probably want to call chunk_pool_elts() instead.
+*/
+always_inline uword
+chunk_pool_len (chunk_pool_t * cp)
+{
+  return cp->n_elts;
+}
+
+/** Memory usage of a chunk pool. */
+always_inline uword
+chunk_pool_bytes (chunk_pool_t * cp)
+{
+  uword k, n_bytes = 0;
+
+  for (k = 0; k < cp->n_chunks; k++)
+    n_bytes += chunk_pool_chunk_elts (cp, k) * cp->elt_bytes;
+  return n_bytes + vec_bytes (cp->free_bitmap) + vec_bytes (cp->free_indices);
+}
+
+/** Allocate an element and return its index (general version).
+    First search the free list, if nothing is free add a chunk if the
+    last one is full. Main thread only. */
+always_inline u32
+chunk_pool_get_index (chunk_pool_t * cp, u32 elt_bytes, u32 align)
+{
+  uword l = vec_len (cp->free_indices);
+  u32 i;
+
+  if (l > 0)
+    {
+      /* Return free element from free list. */
+      i = cp->free_indices[l - 1];
+      cp->free_bitmap = clib_bitmap_andnoti_notrim (cp->free_bitmap, i);
+      _vec_len (cp->free_indices) = l - 1;
+      CLIB_MEM_UNPOISON (chunk_pool_elt_at_index (cp, i), elt_bytes);
+      return i;
+    }
+
+  if (PREDICT_FALSE (0 == cp->elt_bytes))
+    {
+      /* the first allocation sets up the pool */
+      ASSERT (align == 0 || (elt_bytes % align) == 0
+	      || (align % elt_bytes) == 0);
+      cp->elt_bytes = elt_bytes;
+      cp->align = clib_max (align, CLIB_CACHE_LINE_BYTES);
+      cp->log2_first_chunk_elts =
+	clib_max (1, min_log2 (clib_max (1, CHUNK_POOL_FIRST_CHUNK_BYTES /
+					 elt_bytes)));
+    }
+  ASSERT (cp->elt_bytes == elt_bytes);
+
+  i = cp->n_elts;
+  if (chunk_pool_chunk_index (cp, i) == cp->n_chunks)
+    {
+      /* Nothing on free list and the last chunk is full, add a chunk. */
+      uword k = cp->n_chunks;
+
+      if (k == CHUNK_POOL_MAX_CHUNKS)
+	{
+	  clib_warning ("can't expand chunk pool");
+	  os_out_of_memory ();
+	}
+      /* zeroed, as new elements of a pool's vector are */
+      cp->chunks[k] = clib_mem_alloc_aligned (chunk_pool_chunk_elts (cp, k) *
+					      elt_bytes, cp->align);
+      clib_memset (cp->chunks[k], 0, chunk_pool_chunk_elts (cp, k) * elt_bytes);
+      cp->n_chunks = k + 1;
+    }
+  cp->n_elts = i + 1;
+  return i;
+}
+
+/** Allocate an object E from a chunk pool CP with alignment A */
+#define chunk_pool_get_aligned(CP,E,A)					\
+do {									\
+  chunk_pool_t *_cp = (CP);						\
+  (E) = chunk_pool_elt_at_index (_cp,					\
+    chunk_pool_get_index (_cp, sizeof ((E)[0]), (A)));			\
+} while (0)
+
+/** Allocate an object E from a chunk pool CP (unspecified alignment). */
+#define chunk_pool_get(CP,E) chunk_pool_get_aligned(CP,E,0)
+
+/** Free the element with the given index. Main thread only. */
+always_inline void
+chunk_pool_put_index (chunk_pool_t * cp, u32 i)
+{
+  void *e = chunk_pool_elt_at_index (cp, i);
+
+  /* Add element to free bitmap and to free list. */
+  cp->free_bitmap = clib_bitmap_ori_notrim (cp->free_bitmap, i);
+  vec_add1 (cp->free_indices, i);
+  CLIB_MEM_POISON (e, cp->elt_bytes);
+}
+
+/** Free an object E in chunk pool CP. */
+#define chunk_pool_put(CP,E) \
+  chunk_pool_put_index ((CP), chunk_pool_index_of ((CP), (E)))
+
+/** Free the chunks and reset the chunk pool */
+always_inline void
+chunk_pool_free (chunk_pool_t * cp)
+{
+  uword k;
+
+  for (k = 0; k < cp->n_chunks; k++)
+    clib_mem_free (cp->chunks[k]);
+  vec_free (cp->free_bitmap);
+  vec_free (cp->free_indices);
+  clib_memset (cp, 0, sizeof (*cp));
+}
+
+/** Index of the first active element at or after i, or the pool length */
+always_inline uword
+chunk_pool_next_index (chunk_pool_t * cp, uword i)
+{
+  i = clib_bitmap_next_clear (cp->free_bitmap, i);
+  return clib_min (i, cp->n_elts);
+}
+
+/** Iterate through the indices of the active elements of a chunk pool. */
+#define chunk_pool_foreach_index(i,CP)					\
+  for (i = chunk_pool_next_index ((CP), 0);				\
+       i < chunk_pool_len (CP);						\
+       i = chunk_pool_next_index ((CP), i + 1))
+
+/** Iterate through the active elements of a chunk pool. */
+#define chunk_pool_foreach(VAR,CP)					\
+  for (uword _cp_i = chunk_pool_next_index ((CP), 0);			\
+       _cp_i < chunk_pool_len (CP) &&					\
+	 ((VAR) = chunk_pool_elt_at_index ((CP), _cp_i));		\
+       _cp_i = chunk_pool_next_index ((CP), _cp_i + 1))
+
+#endif /* included_chunk_pool_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
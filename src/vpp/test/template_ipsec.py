@@ -64,6 +64,7 @@ class IPsecIPv4Params:
                           TUNNEL_API_ENCAP_DECAP_FLAG_NONE)
         self.dscp = 0
         self.async_mode = False
+        self.anti_replay_window_size = 64
 
 
 class IPsecIPv6Params:
@@ -109,6 +110,7 @@ class IPsecIPv6Params:
                           TUNNEL_API_ENCAP_DECAP_FLAG_NONE)
         self.dscp = 0
         self.async_mode = False
+        self.anti_replay_window_size = 64
 
 
 def mk_scapy_crypt_key(p):
@@ -303,18 +305,22 @@ class IpsecTcpTests(IpsecTcp):
 
 class IpsecTra4(object):
     """ verify methods for Transport v4 """
-    def get_replay_counts(self, p):
-        replay_node_name = ('/err/%s/SA replayed packet' %
-                            self.tra4_decrypt_node_name[0])
+    def get_replay_counts(self, p, reason='SA replayed packet'):
+        replay_node_name = ('/err/%s/%s' %
+                            (self.tra4_decrypt_node_name[0], reason))
         count = self.statistics.get_err_counter(replay_node_name)
 
         if p.async_mode:
-            replay_post_node_name = ('/err/%s/SA replayed packet' %
-                                     self.tra4_decrypt_node_name[p.async_mode])
+            replay_post_node_name = ('/err/%s/%s' %
+                                     (self.tra4_decrypt_node_name[
+                                         p.async_mode], reason))
             count += self.statistics.get_err_counter(replay_post_node_name)
 
         return count
 
+    def get_replay_oow_counts(self, p):
+        return self.get_replay_counts(p, 'SA packet out of replay window')
+
     def get_hash_failed_counts(self, p):
         if ESP == self.encryption_type and p.crypt_algo == "AES-GCM":
             hash_failed_node_name = ('/err/%s/ESP decryption failed' %
@@ -531,6 +537,7 @@ class IpsecTra4(object):
             ('/err/%s/sequence number cycled (packet dropped)' %
              self.tra4_encrypt_node_name)
         replay_count = self.get_replay_counts(p)
+        oow_count = self.get_replay_oow_counts(p)
         hash_failed_count = self.get_hash_failed_counts(p)
         seq_cycle_count = self.statistics.get_err_counter(seq_cycle_node_name)
 
@@ -670,7 +677,8 @@ class IpsecTra4(object):
             self.assertEqual(self.get_hash_failed_counts(p), hash_failed_count)
 
         else:
-            replay_count += 17
+            oow_count += 17
+            self.assertEqual(self.get_replay_oow_counts(p), oow_count)
             self.assertEqual(self.get_replay_counts(p), replay_count)
 
         # valid packet moves the window over to 258
@@ -798,6 +806,62 @@ class IpsecTra4(object):
         p.scapy_tra_sa.seq_num = 351
         p.vpp_tra_sa.seq_num = 351
 
+    def verify_tra_anti_replay_huge_window(self):
+        p = self.params[socket.AF_INET]
+        esn_en = p.vpp_tra_sa.esn_en
+        window = p.anti_replay_window_size
+
+        replay_count = self.get_replay_counts(p)
+        oow_count = self.get_replay_oow_counts(p)
+        hash_failed_count = self.get_hash_failed_counts(p)
+
+        def mk_pkts(seqs):
+            return [(Ether(src=self.tra_if.remote_mac,
+                           dst=self.tra_if.local_mac) /
+                     p.scapy_tra_sa.encrypt(IP(src=self.tra_if.remote_ip4,
+                                               dst=self.tra_if.local_ip4) /
+                                            ICMP(),
+                                            seq_num=seq))
+                    for seq in seqs]
+
+        # move the window on by more than its size
+        self.send_and_expect(self.tra_if, mk_pkts([1, 2]), self.tra_if)
+        self.send_and_expect(self.tra_if, mk_pkts([2 * window]), self.tra_if)
+
+        # packets much later than 64 but within the window are accepted,
+        # once
+        pkts = mk_pkts(range(window + 1, 2 * window, window // 32))
+        self.send_and_expect(self.tra_if, pkts, self.tra_if)
+        self.send_and_assert_no_replies(self.tra_if, pkts, timeout=0.2)
+        replay_count += len(pkts)
+        self.assertEqual(self.get_replay_counts(p), replay_count)
+
+        # move the window on by less than its size, over the end of the
+        # ring, the packets it passes over are then out of window
+        self.send_and_expect(self.tra_if,
+                             mk_pkts([2 * window + window // 2 + 7]),
+                             self.tra_if)
+        self.send_and_expect(self.tra_if,
+                             mk_pkts([2 * window + 1, 2 * window + 3]),
+                             self.tra_if)
+        self.send_and_assert_no_replies(self.tra_if,
+                                        mk_pkts([2 * window + 3]),
+                                        timeout=0.2)
+        replay_count += 1
+        self.assertEqual(self.get_replay_counts(p), replay_count)
+
+        self.send_and_assert_no_replies(self.tra_if, pkts[:3], timeout=0.2)
+        if esn_en:
+            # out of window with ESN is taken to be a wrap of the high
+            # sequence number, which fails to decrypt
+            hash_failed_count += 3
+            self.assertEqual(self.get_hash_failed_counts(p),
+                             hash_failed_count)
+        else:
+            oow_count += 3
+            self.assertEqual(self.get_replay_oow_counts(p), oow_count)
+        self.assertEqual(self.get_replay_counts(p), replay_count)
+
     def verify_tra_lost(self):
         p = self.params[socket.AF_INET]
         esn_en = p.vpp_tra_sa.esn_en
@@ -1759,15 +1823,18 @@ class SpdFlowCacheTemplate(VppTestCase):
             "Policy %s matched: %d pkts", str(spdEntry), matched_pkts)
         self.assert_equal(pkt_count, matched_pkts)
 
-    def get_spd_flow_cache_entries(self):
+    def get_spd_flow_cache_entries(self, outbound, af="ip4"):
         """ 'show ipsec spd' output:
         ip4-outbound-spd-flow-cache-entries: 0
+        ip4-inbound-spd-flow-cache-entries: 0
+        ip6-outbound-spd-flow-cache-entries: 0
         """
         show_ipsec_reply = self.vapi.cli("show ipsec spd")
         # match the relevant section of 'show ipsec spd' output
-        regex_match = re.search(
-            'ip4-outbound-spd-flow-cache-entries: (.*)',
-            show_ipsec_reply, re.DOTALL)
+        direction = "outbound" if outbound else "inbound"
+        regex_match = search(
+            '%s-%s-spd-flow-cache-entries: (\\d+)' % (af, direction),
+            show_ipsec_reply)
         if regex_match is None:
             raise Exception("Unable to find spd flow cache entries \
                 in \'show ipsec spd\' CLI output - regex failed to match")
@@ -1781,11 +1848,21 @@ class SpdFlowCacheTemplate(VppTestCase):
         return num_entries
 
     def verify_num_outbound_flow_cache_entries(self, expected_elements):
-        self.assertEqual(self.get_spd_flow_cache_entries(), expected_elements)
+        self.assertEqual(self.get_spd_flow_cache_entries(outbound=True),
+                         expected_elements)
+
+    def verify_num_inbound_flow_cache_entries(self, expected_elements):
+        self.assertEqual(self.get_spd_flow_cache_entries(outbound=False),
+                         expected_elements)
+
+    def verify_num_outbound_ip6_flow_cache_entries(self, expected_elements):
+        self.assertEqual(self.get_spd_flow_cache_entries(outbound=True,
+                                                         af="ip6"),
+                         expected_elements)
 
     def crc32_supported(self):
         # lscpu is part of util-linux package, available on all Linux Distros
-        stream = os.popen('lscpu')
+        stream = popen('lscpu')
         cpu_info = stream.read()
         # feature/flag "crc32" on Aarch64 and "sse4_2" on x86
         # see vppinfra/crc32.h
@@ -2,6 +2,7 @@
 """ACL plugin Test Case HLD:
 """
 
+import re
 import unittest
 import random
 
@@ -10,7 +11,7 @@ from scapy.layers.l2 import Ether
 from scapy.layers.inet import IP, TCP, UDP, ICMP
 from scapy.layers.inet6 import IPv6, ICMPv6EchoRequest
 from scapy.layers.inet6 import IPv6ExtHdrFragment
-from framework import VppTestCase, VppTestRunner
+from framework import VppTestCase, VppTestRunner, running_extended_tests
 from framework import tag_fixme_vpp_workers
 from util import Host, ppp
 from ipaddress import IPv4Network, IPv6Network
@@ -36,6 +37,7 @@ class TestACLplugin(VppTestCase):
     # rule types
     DENY = 0
     PERMIT = 1
+    PERMIT_REFLECT = 2
 
     # supported protocols
     proto = [[6, 17], [1, 58]]
@@ -584,6 +586,11 @@ class TestACLplugin(VppTestCase):
         total_hits = matches[0][0]['packets'] + matches[0][1]['packets']
         self.assertEqual(total_hits, 64)
 
+        # per-thread hash lookup hits, kept regardless of the above
+        hits = self.statistics.get_counter('/acl/%d/hits' % acl_idx)
+        self.logger.info("stat segment hits: %s" % repr(hits))
+        self.assertEqual(sum(sum(per_thread) for per_thread in hits), 64)
+
         # disable counters
         reply = self.vapi.papi.acl_stats_intf_counters_enable(enable=0)
 
@@ -1433,6 +1440,183 @@ class TestACLplugin(VppTestCase):
 
         self.logger.info("ACLP_TEST_FINISH_0315")
 
+    def match_perf(self, n_aces, ip=0, aces_per_acl=5000, tree=False):
+        """ classify new flows against n_aces ACEs, per-packet and batched
+        """
+        rules = []
+        for i in range(n_aces):
+            # spread the rules over a few mask types
+            s_plen = random.choice([8, 16, 24, 32]) if ip == self.IPV4 \
+                else random.choice([32, 48, 64, 128])
+            d_plen = random.choice([16, 24, 32]) if ip == self.IPV4 \
+                else random.choice([48, 64, 128])
+            if ip == self.IPV4:
+                s_ip = IPv4Network((random.getrandbits(32) &
+                                    ~((1 << (32 - s_plen)) - 1), s_plen))
+                d_ip = IPv4Network((random.getrandbits(32) &
+                                    ~((1 << (32 - d_plen)) - 1), d_plen))
+            else:
+                s_ip = IPv6Network((random.getrandbits(128) &
+                                    ~((1 << (128 - s_plen)) - 1), s_plen))
+                d_ip = IPv6Network((random.getrandbits(128) &
+                                    ~((1 << (128 - d_plen)) - 1), d_plen))
+            rules.append(AclRule(is_permit=random.choice([0, 1, 2]),
+                                 src_prefix=s_ip, dst_prefix=d_ip,
+                                 proto=random.choice(self.proto[self.IP]),
+                                 ports=random.choice([self.PORTS_ALL,
+                                                      self.PORTS_RANGE,
+                                                      self.PORTS_RANGE_2])))
+        acls = []
+        for i in range(0, n_aces, aces_per_acl):
+            acl = VppAcl(self, rules[i:i + aces_per_acl], tag="match-perf")
+            acl.add_vpp_config()
+            acls.append(acl)
+
+        cmd = "test acl-plugin match-perf %s flows 10000 iterations 2%s" % (
+            " ".join("acl %u" % acl.acl_index for acl in acls),
+            " ip6" if ip == self.IPV6 else "")
+        reply = self.vapi.cli(cmd)
+        self.logger.info(reply)
+        self.assertIn("%u ACEs" % n_aces, reply)
+        self.assertIn("mismatches: 0", reply)
+        if tree:
+            self.assertIn("tree mismatches: 0", reply)
+
+        for acl in acls:
+            acl.remove_vpp_config()
+
+    def test_0400_match_perf(self):
+        """ batched ACL lookup of new flows matches per-packet lookup
+        """
+        self.logger.info("ACLP_TEST_START_0400")
+        self.match_perf(1000, self.IPV4)
+        self.match_perf(1000, self.IPV6)
+        self.logger.info("ACLP_TEST_FINISH_0400")
+
+    @unittest.skipUnless(running_extended_tests, "part of extended tests")
+    def test_0401_match_perf_scale(self):
+        """ new flow classification rate with 10k and 50k ACEs
+        """
+        self.logger.info("ACLP_TEST_START_0401")
+        self.match_perf(10000, self.IPV4)
+        self.match_perf(50000, self.IPV4)
+        self.logger.info("ACLP_TEST_FINISH_0401")
+
+    def session_adds(self):
+        reply = self.vapi.cli("show acl-plugin sessions")
+        m = re.search(r"Sessions total: add (\d+)", reply)
+        return int(m.group(1))
+
+    def test_0402_new_flow_repeated_in_frame(self):
+        """ one session for a new flow seen again later in the frame
+        """
+        self.logger.info("ACLP_TEST_START_0402")
+        rules = []
+        rules.append(self.create_rule(self.IPV4, self.PERMIT_REFLECT,
+                                      self.PORTS_ALL, 0))
+        self.apply_rules(rules, "permit+reflect ip4 any")
+
+        src_host = self.hosts_by_pg_idx[self.pg0.sw_if_index][0]
+        dst_host = self.hosts_by_pg_idx[self.pg1.sw_if_index][0]
+        flows = []
+        for sport in (4001, 4002):
+            flows.append(Ether(dst=dst_host.mac, src=src_host.mac) /
+                         IP(src=src_host.ip4, dst=dst_host.ip4) /
+                         UDP(sport=sport, dport=5001) /
+                         Raw(b"\xa5" * 32))
+        # A, B, A, B, A: the repeats are not adjacent to the packet which
+        # created the session
+        pkts = [flows[i % 2] for i in range(5)]
+
+        adds = self.session_adds()
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(len(pkts))
+        self.assertEqual(self.session_adds() - adds, 2)
+
+        self.logger.info("ACLP_TEST_FINISH_0402")
+
+    def test_0402_tree_match(self):
+        """ decision tree ACL lookup agrees with the hash lookup
+        """
+        self.logger.info("ACLP_TEST_START_0402")
+        self.vapi.cli("set acl-plugin use-tree-acl-matching 1")
+        try:
+            self.match_perf(1000, self.IPV4, tree=True)
+            self.match_perf(1000, self.IPV6, tree=True)
+
+            port = random.randint(16384, 65535)
+            rules = []
+            rules.append(self.create_rule(self.IPV4, self.DENY, port,
+                                          self.proto[self.IP][self.UDP]))
+            rules.append(self.create_rule(self.IPV6, self.DENY, port,
+                                          self.proto[self.IP][self.UDP]))
+            rules.append(self.create_rule(self.IPV4, self.PERMIT,
+                                          self.PORTS_ALL, 0))
+            rules.append(self.create_rule(self.IPV6, self.PERMIT,
+                                          self.PORTS_ALL, 0))
+            self.apply_rules(rules, "deny ip4/ip6 udp %d" % port)
+            self.assertIn("ACE references",
+                          self.vapi.cli("show acl-plugin tables tree"))
+
+            # Traffic should not pass
+            self.run_verify_negat_test(self.IP, self.IPRANDOM,
+                                       self.proto[self.IP][self.UDP], port)
+        finally:
+            self.vapi.cli("set acl-plugin use-tree-acl-matching 0")
+        self.logger.info("ACLP_TEST_FINISH_0402")
+
+    def test_0403_rule_edit(self):
+        """ insert, replace and delete single ACL rules
+        """
+        self.logger.info("ACLP_TEST_START_0403")
+        reply = self.vapi.cli("test acl-plugin edit-perf rules 1000 "
+                              "contexts 2 edits 50")
+        self.logger.info(reply)
+        self.assertIn("mismatches: 0", reply)
+
+        # the edits update the decision trees in place
+        self.vapi.cli("set acl-plugin use-tree-acl-matching 1")
+        try:
+            reply = self.vapi.cli("test acl-plugin edit-perf rules 1000 "
+                                  "contexts 2 edits 50")
+            self.logger.info(reply)
+            self.assertIn("tree mismatches: 0", reply)
+        finally:
+            self.vapi.cli("set acl-plugin use-tree-acl-matching 0")
+
+        rules = []
+        rules.append(self.create_rule(self.IPV4, self.PERMIT, self.PORTS_RANGE,
+                                      self.proto[self.IP][self.UDP]))
+        # deny ip any any in the end
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL, 0))
+        acl_index = self.apply_rules(rules, "permit ipv4 udp")
+
+        # deny the same traffic ahead of the permit
+        deny = self.create_rule(self.IPV4, self.DENY, self.PORTS_RANGE,
+                                self.proto[self.IP][self.UDP])
+        self.vapi.acl_rule_insert(acl_index=acl_index, position=0,
+                                  r=deny.encode())
+        self.run_verify_negat_test(self.IP, self.IPV4,
+                                   self.proto[self.IP][self.UDP])
+
+        # and permit it again
+        permit = self.create_rule(self.IPV4, self.PERMIT, self.PORTS_RANGE,
+                                  self.proto[self.IP][self.UDP])
+        self.vapi.acl_rule_replace(acl_index=acl_index, position=0,
+                                   r=permit.encode())
+        self.run_verify_test(self.IP, self.IPV4, self.proto[self.IP][self.UDP])
+
+        self.vapi.acl_rule_delete(acl_index=acl_index, position=0)
+        self.assertEqual(
+            len(self.vapi.acl_dump(acl_index=acl_index)[0].r), 2)
+        with self.vapi.assert_negative_api_retval():
+            self.vapi.acl_rule_delete(acl_index=acl_index, position=2)
+        self.run_verify_test(self.IP, self.IPV4, self.proto[self.IP][self.UDP])
+
+        self.logger.info("ACLP_TEST_FINISH_0403")
+
 
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestCryptoSwScheduler(VppTestCase):
+    """ Crypto SW Scheduler Test Case """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestCryptoSwScheduler, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestCryptoSwScheduler, cls).tearDownClass()
+
+    def test_sw_scheduler_perf(self):
+        """ SW Scheduler work stealing keeps the SA order """
+        reply = self.vapi.cli("test sw_scheduler perf workers 2 "
+                              "max-workers 4 producers 1 frames 2000 "
+                              "sas 3 cost 200 slow-every 5")
+
+        self.logger.info(reply)
+        self.assertNotIn("out of SA order", reply)
+        self.assertIn("Workers", reply)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
@@ -290,6 +290,116 @@ class TestIPv4RouteLookup(VppTestCase):
         # Can't seem to delete the default route so no negative LPM test.
 
 
+class TestIPv4RouteBulk(VppTestCase):
+    """ IPv4 Bulk Route Add/Del Test Case """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestIPv4RouteBulk, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestIPv4RouteBulk, cls).tearDownClass()
+
+    def setUp(self):
+        super(TestIPv4RouteBulk, self).setUp()
+
+        self.create_pg_interfaces(range(2))
+        for i in self.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    def tearDown(self):
+        for i in self.pg_interfaces:
+            i.unconfig_ip4()
+            i.admin_down()
+
+        super(TestIPv4RouteBulk, self).tearDown()
+
+    def route_bulk(self, routes, paths):
+        # the request always carries the full table of paths
+        paths = [p.encode() for p in paths]
+        n_paths = len(paths)
+        paths += [paths[0]] * (16 - n_paths)
+
+        return self.vapi.ip_route_add_del_bulk(n_paths=n_paths,
+                                               paths=paths,
+                                               n_routes=len(routes),
+                                               routes=routes)
+
+    def test_bulk(self):
+        """ IPv4 Bulk Route Add/Del """
+
+        paths = [VppRoutePath(self.pg0.remote_ip4, self.pg0.sw_if_index),
+                 VppRoutePath(self.pg1.remote_ip4, self.pg1.sw_if_index)]
+
+        #
+        # 100 routes via pg0, then an ECMP route via both paths
+        # and a route with a path that is not in the request
+        #
+        routes = [{'table_id': 0,
+                   'prefix': "10.10.0.%d/32" % i,
+                   'is_add': 1,
+                   'path_index': 0} for i in range(100)]
+        routes += [{'table_id': 0,
+                    'prefix': "10.10.1.0/24",
+                    'is_add': 1,
+                    'path_index': i} for i in range(2)]
+        routes += [{'table_id': 0,
+                    'prefix': "10.10.2.0/24",
+                    'is_add': 1,
+                    'path_index': 5}]
+
+        with self.vapi.assert_negative_api_retval():
+            r = self.route_bulk(routes, paths)
+
+        self.assertEqual(r.n_routes, len(routes))
+        self.assertEqual(r.n_failed, 1)
+        self.assertEqual(r.retvals[:-1], [0] * (len(routes) - 1))
+        self.assertNotEqual(r.retvals[-1], 0)
+
+        for i in range(100):
+            self.assertTrue(find_route(self, "10.10.0.%d" % i, 32))
+        self.assertFalse(find_route(self, "10.10.2.0", 24))
+
+        ecmp = self.vapi.ip_route_lookup(table_id=0, exact=1,
+                                         prefix="10.10.1.0/24")
+        self.assertEqual(ecmp.route.n_paths, 2)
+
+        #
+        # remove one path of the ECMP route, then all the routes
+        #
+        r = self.route_bulk([{'table_id': 0,
+                              'prefix': "10.10.1.0/24",
+                              'is_add': 0,
+                              'is_multipath': 1,
+                              'path_index': 1}], paths)
+        self.assertEqual(r.n_failed, 0)
+        ecmp = self.vapi.ip_route_lookup(table_id=0, exact=1,
+                                         prefix="10.10.1.0/24")
+        self.assertEqual(ecmp.route.n_paths, 1)
+
+        for rt in routes:
+            rt['is_add'] = 0
+        r = self.route_bulk(routes[:-1], paths)
+        self.assertEqual(r.retval, 0)
+        self.assertEqual(r.n_failed, 0)
+
+        for i in range(100):
+            self.assertFalse(find_route(self, "10.10.0.%d" % i, 32))
+        self.assertFalse(find_route(self, "10.10.1.0", 24))
+
+        #
+        # a request with more paths than it can carry programs nothing
+        #
+        with self.vapi.assert_negative_api_retval():
+            r = self.vapi.ip_route_add_del_bulk(
+                n_paths=17, paths=[paths[0].encode()] * 16,
+                n_routes=1, routes=routes[:1])
+        self.assertEqual(r.n_routes, 0)
+
+
 class TestIPv4IfAddrRoute(VppTestCase):
     """ IPv4 Interface Addr Route Test Case """
 
@@ -215,7 +215,9 @@ class ConfigIpsecESP(TemplateIpsec):
                                       crypt_algo_vpp_id, crypt_key,
                                       self.vpp_esp_protocol,
                                       flags=flags,
-                                      salt=salt)
+                                      salt=salt,
+                                      anti_replay_window_size=(
+                                          params.anti_replay_window_size))
         params.tra_sa_out = VppIpsecSA(self, vpp_tra_sa_id, vpp_tra_spi,
                                        auth_algo_vpp_id, auth_key,
                                        crypt_algo_vpp_id, crypt_key,
@@ -971,6 +973,15 @@ class RunTestIpsecEspAll(ConfigIpsecESP,
             self.config_network(self.params.values())
             self.verify_tra_anti_replay()
 
+            # and again with a window much larger than 64
+            for p in self.params.values():
+                p.anti_replay_window_size = 4096
+            self.unconfig_network()
+            self.config_network(self.params.values())
+            self.verify_tra_anti_replay_huge_window()
+            for p in self.params.values():
+                p.anti_replay_window_size = 64
+
         self.unconfig_network()
         self.config_network(self.params.values())
         self.verify_hi_seq_num()
@@ -990,6 +1001,25 @@ class RunTestIpsecEspAll(ConfigIpsecESP,
 
         self.unconfig_network()
 
+
+class TestIpsecEspAsyncNative(RunTestIpsecEspAll):
+    """async ESNon ARon AES-CBC-256/SHA1-96 IPSec test"""
+    extra_vpp_punt_config = ["crypto-native", "{", "async", "}"]
+
+    def test_ipsec(self):
+        """native async ESNon ARon AES-CBC-256/SHA1-96 IPSec test"""
+        # the native engine serves linked ops only when asked to, and then
+        # still needs to be picked over the sw scheduler
+        self.vapi.cli("set crypto async handler aes-256-cbc-hmac-sha-1 "
+                      "native")
+        handlers = self.vapi.cli("show crypto async handlers")
+        self.logger.info(handlers)
+        algo = [line for line in handlers.splitlines()
+                if line.startswith("aes-256-cbc-hmac-sha-1 ")]
+        self.assertEqual(len(algo), 1)
+        self.assertIn("native*", algo[0])
+        self.run_test()
+
 #
 # To generate test classes, do:
 #   grep '# GEN' test_ipsec_esp.py | sed -e 's/# GEN //g' | bash
@@ -0,0 +1,286 @@
+import socket
+import unittest
+
+from util import ppp
+from framework import VppTestRunner
+from template_ipsec import SpdFlowCacheTemplate
+from vpp_ipsec import VppIpsecSpd, VppIpsecSpdEntry
+
+
+class SpdFlowCacheInbound(SpdFlowCacheTemplate):
+    # Override setUpConstants to enable inbound flow cache in config
+    @classmethod
+    def setUpConstants(cls):
+        super(SpdFlowCacheInbound, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["ipsec", "{",
+                                "ipv4-inbound-spd-flow-cache on",
+                                "}"])
+        cls.logger.info("VPP modified cmdline is %s" % " "
+                        .join(cls.vpp_cmdline))
+
+    def send_and_capture(self, packets, dst_if):
+        self.pg0.add_stream(packets)
+        for pg in self.pg_interfaces:
+            pg.enable_capture()
+        self.pg_start()
+        if dst_if is None:
+            for pg in self.pg_interfaces:
+                pg.assert_nothing_captured()
+            return None
+        capture = dst_if.get_capture()
+        for packet in capture:
+            try:
+                self.logger.debug(ppp("SPD - Got packet:", packet))
+            except Exception:
+                self.logger.error(ppp("Unexpected or invalid packet:", packet))
+                raise
+        return capture
+
+
+class IPSec4SpdTestCaseInboundBypass(SpdFlowCacheInbound):
+    """ IPSec/IPv4 inbound: Policy mode test case with flow cache \
+        (bypass rule)"""
+    def test_ipsec_spd_inbound_bypass(self):
+        # In this test case, packets in IPv4 FWD path are configured
+        # to go through IPSec inbound SPD policy lookup.
+        # An inbound BYPASS and an inbound DISCARD rule match the traffic;
+        # bypass rules are always checked before discard rules, so the
+        # traffic is forwarded and the bypass match is cached.
+        self.create_interfaces(2)
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg0])
+        # inbound selectors: local is the destination, remote the source
+        policy_0 = self.spd_add_rem_policy(  # inbound, priority 10
+            1, self.pg1, self.pg0, socket.IPPROTO_UDP,
+            is_out=0, priority=10, policy_type="bypass")
+        policy_1 = self.spd_add_rem_policy(  # inbound, priority 15
+            1, self.pg1, self.pg0, socket.IPPROTO_UDP,
+            is_out=0, priority=15, policy_type="discard")
+
+        # check flow cache is empty before sending traffic
+        self.verify_num_inbound_flow_cache_entries(0)
+
+        packets = self.create_stream(self.pg0, self.pg1, pkt_count)
+        capture = self.send_and_capture(packets, self.pg1)
+
+        self.pg0.assert_nothing_captured()
+        self.verify_capture(self.pg0, self.pg1, capture)
+        self.verify_policy_match(pkt_count, policy_0)
+        self.verify_policy_match(0, policy_1)
+        # the first packet filled the cache, the others hit it
+        self.verify_num_inbound_flow_cache_entries(1)
+
+
+class IPSec4SpdTestCaseInboundDiscard(SpdFlowCacheInbound):
+    """ IPSec/IPv4 inbound: Policy mode test case with flow cache \
+        (discard rule)"""
+    def test_ipsec_spd_inbound_discard(self):
+        # Only an inbound DISCARD rule matches the traffic, which is
+        # dropped after the SPD lookup.
+        self.create_interfaces(2)
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg0])
+        policy_0 = self.spd_add_rem_policy(  # inbound, priority 10
+            1, self.pg1, self.pg0, socket.IPPROTO_UDP,
+            is_out=0, priority=10, policy_type="discard")
+
+        self.verify_num_inbound_flow_cache_entries(0)
+
+        packets = self.create_stream(self.pg0, self.pg1, pkt_count)
+        self.send_and_capture(packets, None)
+
+        self.verify_policy_match(pkt_count, policy_0)
+        self.verify_num_inbound_flow_cache_entries(1)
+
+
+class IPSec4SpdTestCaseInboundRemove(SpdFlowCacheInbound):
+    """ IPSec/IPv4 inbound: Policy mode test case with flow cache \
+        (remove rule)"""
+    def test_ipsec_spd_inbound_remove(self):
+        # An inbound BYPASS and an inbound DISCARD rule match the traffic.
+        # Once the BYPASS rule is removed the cached match is stale and
+        # the same traffic must now be discarded.
+        self.create_interfaces(2)
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg0])
+        policy_0 = self.spd_add_rem_policy(  # inbound, priority 10
+            1, self.pg1, self.pg0, socket.IPPROTO_UDP,
+            is_out=0, priority=10, policy_type="bypass")
+        policy_1 = self.spd_add_rem_policy(  # inbound, priority 5
+            1, self.pg1, self.pg0, socket.IPPROTO_UDP,
+            is_out=0, priority=5, policy_type="discard")
+
+        self.verify_num_inbound_flow_cache_entries(0)
+
+        packets = self.create_stream(self.pg0, self.pg1, pkt_count)
+        capture = self.send_and_capture(packets, self.pg1)
+        self.verify_capture(self.pg0, self.pg1, capture)
+        self.verify_policy_match(pkt_count, policy_0)
+        self.verify_policy_match(0, policy_1)
+        self.verify_num_inbound_flow_cache_entries(1)
+
+        # now remove the bypass rule
+        self.spd_add_rem_policy(  # inbound, priority 10
+            1, self.pg1, self.pg0, socket.IPPROTO_UDP,
+            is_out=0, priority=10, policy_type="bypass",
+            remove=True)
+        # verify flow cache counter has been reset by rule removal
+        self.verify_num_inbound_flow_cache_entries(0)
+
+        # resend the same packets, all are dropped by the discard rule
+        self.send_and_capture(packets, None)
+        self.verify_policy_match(pkt_count, policy_0)
+        self.verify_policy_match(pkt_count, policy_1)
+        # the stale entry has been overwritten
+        self.verify_num_inbound_flow_cache_entries(1)
+
+        # adding an outbound policy does not invalidate the inbound cache
+        self.spd_add_rem_policy(  # outbound, priority 10
+            1, self.pg0, self.pg1, socket.IPPROTO_UDP,
+            is_out=1, priority=10, policy_type="bypass")
+        self.verify_num_inbound_flow_cache_entries(1)
+
+
+class IPSec4SpdTestCaseInboundPorts(SpdFlowCacheInbound):
+    """ IPSec/IPv4 inbound: Policy mode test case with flow cache \
+        (port and protocol selectors)"""
+    def add_port_policy(self, spd, proto, priority, policy_type,
+                        local_ports=(0, 65535)):
+        entry = VppIpsecSpdEntry(self, spd, 0,
+                                 self.pg1.remote_ip4, self.pg1.remote_ip4,
+                                 self.pg0.remote_ip4, self.pg0.remote_ip4,
+                                 proto,
+                                 priority=priority,
+                                 policy=self.get_policy(policy_type),
+                                 is_outbound=0,
+                                 local_port_start=local_ports[0],
+                                 local_port_stop=local_ports[1])
+        entry.add_vpp_config()
+        self.spd_policies.append(entry)
+        return entry
+
+    def test_ipsec_spd_inbound_ports(self):
+        # An inbound BYPASS rule for one UDP destination port sits above
+        # a DISCARD rule for all UDP traffic; a TCP BYPASS rule of higher
+        # priority must not match UDP packets.
+        self.create_interfaces(2)
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg0])
+        spd = VppIpsecSpd(self, 1)
+        policy_tcp = self.add_port_policy(spd, socket.IPPROTO_TCP, 20,
+                                          "bypass")
+        policy_bypass = self.add_port_policy(spd, socket.IPPROTO_UDP, 10,
+                                             "bypass", (5678, 5678))
+        policy_discard = self.add_port_policy(spd, socket.IPPROTO_UDP, 5,
+                                              "discard")
+
+        packets = self.create_stream(self.pg0, self.pg1, pkt_count,
+                                     dst_prt=5678)
+        capture = self.send_and_capture(packets, self.pg1)
+        self.verify_capture(self.pg0, self.pg1, capture)
+        self.verify_policy_match(pkt_count, policy_bypass)
+        self.verify_policy_match(0, policy_discard)
+        self.verify_policy_match(0, policy_tcp)
+        self.verify_num_inbound_flow_cache_entries(1)
+
+        # another destination port falls through to the discard rule
+        packets = self.create_stream(self.pg0, self.pg1, pkt_count,
+                                     dst_prt=9999)
+        self.send_and_capture(packets, None)
+        self.verify_policy_match(pkt_count, policy_bypass)
+        self.verify_policy_match(pkt_count, policy_discard)
+        self.verify_policy_match(0, policy_tcp)
+        self.verify_num_inbound_flow_cache_entries(2)
+
+
+class IPSec4SpdTestCaseInboundFastPath(SpdFlowCacheTemplate):
+    """ IPSec/IPv4 inbound: Policy mode test case with the SPD fast path \
+        and flow cache"""
+    @classmethod
+    def setUpConstants(cls):
+        super(IPSec4SpdTestCaseInboundFastPath, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["ipsec", "{",
+                                "ipv4-inbound-spd-flow-cache on",
+                                "ipv4-inbound-spd-fast-path on",
+                                "}"])
+        cls.logger.info("VPP modified cmdline is %s" % " "
+                        .join(cls.vpp_cmdline))
+
+    def add_range_policy(self, spd, local, remote, priority, policy_type):
+        entry = VppIpsecSpdEntry(self, spd, 0,
+                                 local[0], local[1],
+                                 remote[0], remote[1],
+                                 socket.IPPROTO_UDP,
+                                 priority=priority,
+                                 policy=self.get_policy(policy_type),
+                                 is_outbound=0)
+        entry.add_vpp_config()
+        self.spd_policies.append(entry)
+        return entry
+
+    def test_ipsec_spd_inbound_fast_path(self):
+        # Several inbound rules with prefix and non prefix aligned ranges
+        # are added; only the highest priority bypass rule covering the
+        # traffic may count it, whatever the mask type it ended up in.
+        self.create_interfaces(3)
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg0])
+        spd = VppIpsecSpd(self, 1)
+        src = self.pg0.remote_ip4
+        dst = self.pg1.remote_ip4
+
+        # any to any, lowest priority
+        policy_any = self.add_range_policy(
+            spd, ("0.0.0.0", "255.255.255.255"),
+            ("0.0.0.0", "255.255.255.255"), 1, "bypass")
+        # exact match on the source, not aligned on the destination
+        policy_exact = self.add_range_policy(
+            spd, ("0.0.0.1", dst), (src, src), 50, "bypass")
+        # exact match on a different source
+        policy_other = self.add_range_policy(
+            spd, (dst, dst), (self.pg2.remote_ip4, self.pg2.remote_ip4),
+            100, "bypass")
+
+        self.logger.info(self.vapi.ppcli("show ipsec spd"))
+
+        packets = self.create_stream(self.pg0, self.pg1, pkt_count)
+        self.pg0.add_stream(packets)
+        for pg in self.pg_interfaces:
+            pg.enable_capture()
+        self.pg_start()
+        capture = self.pg1.get_capture()
+        self.verify_capture(self.pg0, self.pg1, capture)
+
+        self.verify_policy_match(pkt_count, policy_exact)
+        self.verify_policy_match(0, policy_any)
+        self.verify_policy_match(0, policy_other)
+        self.verify_num_inbound_flow_cache_entries(1)
+
+        # removing the best match falls back to the any to any rule
+        policy_exact.remove_vpp_config()
+        self.spd_policies.remove(policy_exact)
+        self.verify_num_inbound_flow_cache_entries(0)
+
+        self.pg0.add_stream(packets)
+        for pg in self.pg_interfaces:
+            pg.enable_capture()
+        self.pg_start()
+        self.pg1.get_capture(pkt_count)
+        self.verify_policy_match(pkt_count, policy_any)
+        self.verify_policy_match(0, policy_other)
+
+
+class IPSec4SpdTestCaseInboundPerf(SpdFlowCacheInbound):
+    """ IPSec/IPv4 inbound: SPD classification loop benchmark"""
+    def test_ipsec_spd_inbound_perf(self):
+        # The benchmark checks that every packet was bypassed by both the
+        # single and the quad loop; run it briefly as a functional test.
+        reply = self.vapi.cli("test ipsec input-perf policies 8 flows 64 "
+                              "buffers 300 rounds 2")
+        self.logger.info(reply)
+        self.assertIn("x4 loop", reply)
+        self.assertNotIn("bypassed", reply)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
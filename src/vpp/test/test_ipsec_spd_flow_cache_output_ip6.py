@@ -0,0 +1,182 @@
+import socket
+import unittest
+
+from scapy.layers.inet6 import IPv6
+from scapy.layers.inet import UDP
+from scapy.layers.l2 import Ether
+from scapy.packet import Raw
+
+from framework import VppTestRunner
+from template_ipsec import SpdFlowCacheTemplate
+from vpp_ipsec import VppIpsecSpd, VppIpsecSpdEntry
+
+
+class SpdFlowCacheOutboundIp6(SpdFlowCacheTemplate):
+    ipsec_options = ["ipv6-outbound-spd-flow-cache on"]
+
+    # Override setUpConstants to enable the IPv6 outbound flow cache
+    @classmethod
+    def setUpConstants(cls):
+        super(SpdFlowCacheOutboundIp6, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["ipsec", "{"] + cls.ipsec_options + ["}"])
+        cls.logger.info("VPP modified cmdline is %s" % " "
+                        .join(cls.vpp_cmdline))
+
+    def tearDown(self):
+        for pg in self.pg_interfaces:
+            pg.unconfig_ip6()
+        super(SpdFlowCacheOutboundIp6, self).tearDown()
+
+    def create_interfaces(self, num_ifs=2):
+        self.create_pg_interfaces(range(num_ifs))
+        for pg in self.pg_interfaces:
+            pg.admin_up()
+            pg.config_ip6()
+            pg.resolve_ndp()
+        self.logger.info(self.vapi.ppcli("show int addr"))
+
+    def add_policy(self, spd, local, remote, priority, policy_type,
+                   proto=socket.IPPROTO_UDP):
+        entry = VppIpsecSpdEntry(self, spd, 0,
+                                 local[0], local[1],
+                                 remote[0], remote[1],
+                                 proto,
+                                 priority=priority,
+                                 policy=self.get_policy(policy_type),
+                                 is_outbound=1)
+        entry.add_vpp_config()
+        self.spd_policies.append(entry)
+        return entry
+
+    def create_stream6(self, src_if, dst_if, pkt_count,
+                       src_prt=1234, dst_prt=5678):
+        return [(Ether(dst=src_if.local_mac, src=src_if.remote_mac) /
+                 IPv6(src=src_if.remote_ip6, dst=dst_if.remote_ip6) /
+                 UDP(sport=src_prt, dport=dst_prt) /
+                 Raw(b'\xa5' * 100)) for i in range(pkt_count)]
+
+    def send_and_expect6(self, packets, dst_if):
+        self.pg0.add_stream(packets)
+        for pg in self.pg_interfaces:
+            pg.enable_capture()
+        self.pg_start()
+        if dst_if is None:
+            for pg in self.pg_interfaces:
+                pg.assert_nothing_captured()
+            return None
+        capture = dst_if.get_capture(len(packets))
+        for packet in capture:
+            self.assert_equal(packet[IPv6].src, self.pg0.remote_ip6)
+        return capture
+
+
+class IPSec6SpdTestCaseOutboundAdd(SpdFlowCacheOutboundIp6):
+    """ IPSec/IPv6 outbound: Policy mode test case with flow cache \
+        (add rule)"""
+    def test_ipsec6_spd_outbound_add(self):
+        # Packets in the IPv6 FWD path go through the outbound SPD of
+        # pg1. The high priority BYPASS rule wins over the DISCARD rule
+        # and the match is cached after the first packet.
+        self.create_interfaces(2)
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg1])
+        spd = VppIpsecSpd(self, 1)
+        src = self.pg0.remote_ip6
+        dst = self.pg1.remote_ip6
+        policy_0 = self.add_policy(spd, (src, src), (dst, dst), 10,
+                                   "bypass")
+        policy_1 = self.add_policy(spd, (src, src), (dst, dst), 5,
+                                   "discard")
+
+        self.verify_num_outbound_ip6_flow_cache_entries(0)
+
+        packets = self.create_stream6(self.pg0, self.pg1, pkt_count)
+        self.send_and_expect6(packets, self.pg1)
+
+        self.verify_policy_match(pkt_count, policy_0)
+        self.verify_policy_match(0, policy_1)
+        self.verify_num_outbound_ip6_flow_cache_entries(1)
+
+        # a second flow (other source port) gets its own entry
+        packets = self.create_stream6(self.pg0, self.pg1, pkt_count,
+                                      src_prt=4321)
+        self.send_and_expect6(packets, self.pg1)
+        self.verify_policy_match(2 * pkt_count, policy_0)
+        self.verify_num_outbound_ip6_flow_cache_entries(2)
+
+
+class IPSec6SpdTestCaseOutboundRemove(SpdFlowCacheOutboundIp6):
+    """ IPSec/IPv6 outbound: Policy mode test case with flow cache \
+        (remove rule)"""
+    def test_ipsec6_spd_outbound_remove(self):
+        # Once the cached BYPASS rule is removed the same traffic must
+        # hit the DISCARD rule.
+        self.create_interfaces(2)
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg1])
+        spd = VppIpsecSpd(self, 1)
+        src = self.pg0.remote_ip6
+        dst = self.pg1.remote_ip6
+        policy_0 = self.add_policy(spd, (src, src), (dst, dst), 10,
+                                   "bypass")
+        policy_1 = self.add_policy(spd, (src, src), (dst, dst), 5,
+                                   "discard")
+
+        packets = self.create_stream6(self.pg0, self.pg1, pkt_count)
+        self.send_and_expect6(packets, self.pg1)
+        self.verify_policy_match(pkt_count, policy_0)
+        self.verify_num_outbound_ip6_flow_cache_entries(1)
+
+        policy_0.remove_vpp_config()
+        self.spd_policies.remove(policy_0)
+        self.verify_num_outbound_ip6_flow_cache_entries(0)
+
+        self.send_and_expect6(packets, None)
+        self.verify_policy_match(pkt_count, policy_1)
+        self.verify_num_outbound_ip6_flow_cache_entries(1)
+
+
+class IPSec6SpdTestCaseOutboundFastPath(SpdFlowCacheOutboundIp6):
+    """ IPSec/IPv6 outbound: Policy mode test case with the SPD fast path \
+        and flow cache"""
+    ipsec_options = ["ipv6-outbound-spd-flow-cache on",
+                     "ipv6-outbound-spd-fast-path on"]
+
+    def test_ipsec6_spd_outbound_fast_path(self):
+        # Rules with prefix and non prefix aligned address ranges
+        # end up in different mask types; only the highest priority rule
+        # covering the traffic may count it.
+        self.create_interfaces(3)
+        pkt_count = 5
+        self.spd_create_and_intf_add(1, [self.pg1])
+        spd = VppIpsecSpd(self, 1)
+        src = self.pg0.remote_ip6
+        dst = self.pg1.remote_ip6
+        any6 = ("::", "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff")
+
+        policy_any = self.add_policy(spd, any6, any6, 1, "bypass", proto=0)
+        policy_range = self.add_policy(spd, ("::1", src), (dst, dst), 50,
+                                       "bypass")
+        policy_other = self.add_policy(
+            spd, (self.pg2.remote_ip6, self.pg2.remote_ip6), (dst, dst),
+            100, "discard")
+
+        self.logger.info(self.vapi.ppcli("show ipsec spd"))
+
+        packets = self.create_stream6(self.pg0, self.pg1, pkt_count)
+        self.send_and_expect6(packets, self.pg1)
+        self.verify_policy_match(pkt_count, policy_range)
+        self.verify_policy_match(0, policy_any)
+        self.verify_policy_match(0, policy_other)
+        self.verify_num_outbound_ip6_flow_cache_entries(1)
+
+        policy_range.remove_vpp_config()
+        self.spd_policies.remove(policy_range)
+
+        self.send_and_expect6(packets, self.pg1)
+        self.verify_policy_match(pkt_count, policy_any)
+        self.verify_policy_match(0, policy_other)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
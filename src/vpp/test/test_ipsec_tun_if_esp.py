@@ -6,6 +6,7 @@ from scapy.layers.ipsec import SecurityAssociation, ESP
 from scapy.layers.l2 import Ether, GRE, Dot1Q
 from scapy.packet import Raw, bind_layers
 from scapy.layers.inet import IP, UDP
+from scapy.layers.vxlan import VXLAN
 from scapy.layers.inet6 import IPv6
 from scapy.contrib.mpls import MPLS
 from framework import tag_fixme_vpp_workers
@@ -16,11 +17,13 @@ from template_ipsec import TemplateIpsec, IpsecTun4Tests, IpsecTun6Tests, \
 from vpp_gre_interface import VppGreInterface
 from vpp_ipip_tun_interface import VppIpIpTunInterface
 from vpp_ip_route import VppIpRoute, VppRoutePath, DpoProto, VppMplsLabel, \
-    VppMplsTable, VppMplsRoute, FibPathProto
+    VppMplsTable, VppMplsRoute, FibPathProto, VppIpInterfaceAddress
 from vpp_ipsec import VppIpsecSA, VppIpsecTunProtect, VppIpsecInterface
 from vpp_l2 import VppBridgeDomain, VppBridgeDomainPort
 from vpp_sub_interface import L2_VTR_OP, VppDot1QSubint
 from vpp_teib import VppTeib
+from vpp_lo_interface import VppLoInterface
+from vpp_vxlan_tunnel import VppVxlanTunnel
 from util import ppp
 from vpp_papi import VppEnum
 from vpp_papi_provider import CliFailedCommandError
@@ -632,6 +635,100 @@ class TestIpsec4TunIfEspHandoff(TemplateIpsec4TunIfEsp,
         policer.apply_vpp_config(p.tun_if.sw_if_index, False)
         policer.remove_vpp_config()
 
+    def test_tun_multi_worker_44(self):
+        """ ESP 4o4 tunnel with multi-worker SAs, no hand-off """
+        N_PKTS = 15
+        p = self.params[socket.AF_INET]
+
+        self.unconfig_protect(p)
+        self.unconfig_sa(p)
+        saved_flags = p.flags
+        p.flags = p.flags | (VppEnum.vl_api_ipsec_sad_flags_t.
+                             IPSEC_API_SAD_FLAG_MULTI_WORKER) | (
+                                 VppEnum.vl_api_ipsec_sad_flags_t.
+                                 IPSEC_API_SAD_FLAG_USE_ANTI_REPLAY)
+        self.config_sa_tra(p)
+        self.config_protect(p)
+
+        self.vapi.cli("clear errors")
+        self.vapi.cli("clear ipsec sa")
+
+        for worker in [0, 1, 0, 1]:
+            send_pkts = self.gen_encrypt_pkts(p, p.scapy_tun_sa, self.tun_if,
+                                              src=p.remote_tun_if_host,
+                                              dst=self.pg1.remote_ip4,
+                                              count=N_PKTS)
+            recv_pkts = self.send_and_expect(self.tun_if, send_pkts,
+                                             self.pg1, worker=worker)
+            self.verify_decrypted(p, recv_pkts)
+
+            send_pkts = self.gen_pkts(self.pg1, src=self.pg1.remote_ip4,
+                                      dst=p.remote_tun_if_host,
+                                      count=N_PKTS)
+            recv_pkts = self.send_and_expect(self.pg1, send_pkts,
+                                             self.tun_if, worker=worker)
+            self.verify_encrypted(p, p.vpp_tun_sa, recv_pkts)
+
+        # each worker processed its own share of the SA's packets
+        for worker in [0, 1]:
+            self.assertEqual(p.tun_sa_in.get_stats(worker)['packets'],
+                             2 * N_PKTS)
+            self.assertEqual(p.tun_sa_out.get_stats(worker)['packets'],
+                             2 * N_PKTS)
+        self.assertIn("multi-worker", self.vapi.cli("show ipsec sa 0"))
+
+        # a replay seen by the other worker is still dropped
+        replay = self.gen_encrypt_pkts(p, p.scapy_tun_sa, self.tun_if,
+                                       src=p.remote_tun_if_host,
+                                       dst=self.pg1.remote_ip4,
+                                       count=1)
+        self.send_and_expect(self.tun_if, replay, self.pg1, worker=0)
+        replay_node_name = ('/err/%s/SA replayed packet' %
+                            self.tun4_decrypt_node_name[0])
+        self.pg_send(self.tun_if, replay, worker=1)
+        self.pg1.assert_nothing_captured()
+        self.assertEqual(
+            self.statistics.get_err_counter(replay_node_name), 1)
+
+        self.unconfig_protect(p)
+        self.unconfig_sa(p)
+        p.flags = saved_flags
+        self.config_sa_tra(p)
+        self.config_protect(p)
+
+    def test_tun_multi_worker_seq_44(self):
+        """ ESP 4o4 multi-worker SA, idle worker leaves its old numbers """
+        p = self.params[socket.AF_INET]
+
+        self.unconfig_protect(p)
+        self.unconfig_sa(p)
+        saved_flags = p.flags
+        p.flags = p.flags | (VppEnum.vl_api_ipsec_sad_flags_t.
+                             IPSEC_API_SAD_FLAG_MULTI_WORKER)
+        self.config_sa_tra(p)
+        self.config_protect(p)
+
+        seqs = []
+        for worker, count in [(0, 2), (1, 60), (0, 2)]:
+            send_pkts = self.gen_pkts(self.pg1, src=self.pg1.remote_ip4,
+                                      dst=p.remote_tun_if_host,
+                                      count=count)
+            recv_pkts = self.send_and_expect(self.pg1, send_pkts,
+                                             self.tun_if, worker=worker)
+            self.verify_encrypted(p, p.vpp_tun_sa, recv_pkts)
+            seqs.append([rx[ESP].seq for rx in recv_pkts])
+
+        # worker 0 did not go on with the block it reserved first, which
+        # the peer's window has left behind
+        self.assertEqual(seqs[0], [1, 2])
+        self.assertGreater(min(seqs[2]), max(seqs[1]))
+
+        self.unconfig_protect(p)
+        self.unconfig_sa(p)
+        p.flags = saved_flags
+        self.config_sa_tra(p)
+        self.config_protect(p)
+
 
 @tag_fixme_vpp_workers
 class TestIpsec4MultiTunIfEsp(TemplateIpsec4TunProtect,
@@ -2753,6 +2850,91 @@ class TestIpsecItf4(TemplateIpsec,
         self.unconfig_sa(p)
         self.unconfig_network(p)
 
+    def test_tun_44_vxlan_fused(self):
+        """IPSEC interface IPv4 carrying VXLAN, fused encap/decap"""
+
+        n_pkts = 63
+        p = self.ipv4_params
+        vtep = "10.99.0.1"
+        omac = "00:11:22:33:44:55"
+
+        self.config_network(p)
+        self.config_sa_tun(p,
+                           self.pg0.local_ip4,
+                           self.pg0.remote_ip4)
+        self.config_protect(p)
+
+        # a local VTEP on a loopback, the remote VTEP is routed via the tun
+        loop = VppLoInterface(self)
+        loop.add_vpp_config()
+        loop.admin_up()
+        VppIpInterfaceAddress(self, loop, vtep, 32).add_vpp_config()
+
+        vxlan = VppVxlanTunnel(self, src=vtep, dst=p.remote_tun_if_host,
+                               vni=99)
+        vxlan.add_vpp_config()
+        vxlan.admin_up()
+
+        bd = VppBridgeDomain(self, 1)
+        bd.add_vpp_config()
+        VppBridgeDomainPort(self, bd, vxlan).add_vpp_config()
+        VppBridgeDomainPort(self, bd, self.pg1).add_vpp_config()
+
+        self.vapi.vxlan_set_esp_fused(sw_if_index=vxlan.sw_if_index)
+        self.assertIn("esp-fused", self.vapi.cli("show vxlan tunnel"))
+
+        # encap: the frames leave encrypted, straight from the fused node
+        tx_l2 = (Ether(src=self.pg1.remote_mac, dst=omac) /
+                 IP(src="1.1.1.1", dst="1.1.1.2") /
+                 UDP(sport=1144, dport=2233) /
+                 Raw(b'X' * 100)) * n_pkts
+        rxs = self.send_and_expect(self.pg1, tx_l2, self.pg0)
+        for rx in rxs:
+            pkt = p.vpp_tun_sa.decrypt(rx[IP])
+            if not pkt.haslayer(IP):
+                pkt = IP(pkt[Raw].load)
+            self.assert_packet_checksums_valid(pkt)
+            self.assert_equal(pkt[IP].src, vtep)
+            self.assert_equal(pkt[IP].dst, p.remote_tun_if_host)
+            self.assert_equal(pkt[UDP].dport, 4789)
+            self.assert_equal(pkt[VXLAN].vni, 99)
+            self.assert_equal(pkt[VXLAN][Ether].dst, omac)
+            self.assert_equal(pkt[VXLAN][IP].dst, "1.1.1.2")
+        self.assertEqual(
+            self.statistics.get_err_counter(
+                "/err/esp4-encrypt-vxlan/VXLAN pkts passed to vxlan4-encap"),
+            0)
+
+        # decap: the decrypted VXLAN goes directly to vxlan4-input
+        tx = [Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+              p.scapy_tun_sa.encrypt(
+                  IP(src=p.remote_tun_if_host, dst=vtep) /
+                  UDP(sport=1234, dport=4789, chksum=0) /
+                  VXLAN(vni=99) /
+                  Ether(src=omac, dst=self.pg1.remote_mac) /
+                  IP(src="1.1.1.2", dst="1.1.1.1") /
+                  UDP(sport=2233, dport=1144) /
+                  Raw(b'X' * 100))
+              for i in range(n_pkts)]
+        rxs = self.send_and_expect(self.pg0, tx, self.pg1)
+        for rx in rxs:
+            self.assert_equal(rx[Ether].src, omac)
+            self.assert_equal(rx[IP].dst, "1.1.1.1")
+
+        # unfused, the same frames take the vxlan4-encap path
+        self.vapi.vxlan_set_esp_fused(sw_if_index=vxlan.sw_if_index,
+                                      enable=False)
+        self.assertNotIn("esp-fused", self.vapi.cli("show vxlan tunnel"))
+        self.send_and_expect(self.pg1, tx_l2, self.pg0)
+
+        # teardown
+        bd.remove_vpp_config()
+        vxlan.remove_vpp_config()
+        loop.remove_vpp_config()
+        self.unconfig_protect(p)
+        self.unconfig_sa(p)
+        self.unconfig_network(p)
+
 
 class TestIpsecItf4MPLS(TemplateIpsec,
                         TemplateIpsecItf4,
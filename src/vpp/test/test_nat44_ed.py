@@ -6,6 +6,9 @@ from random import randint, shuffle, choice
 
 import scapy.compat
 from framework import VppTestCase, VppTestRunner
+from scapy.all import bind_layers, Packet, ByteEnumField, ShortField, \
+    IPField, IntField, LongField, XByteField, FlagsField, FieldLenField, \
+    PacketListField, ByteField, StrFixedLenField
 from scapy.data import IP_PROTOS
 from scapy.layers.inet import IP, TCP, UDP, ICMP, GRE
 from scapy.layers.inet import IPerror, TCPerror
@@ -19,6 +22,45 @@ from vpp_ip_route import VppIpRoute, VppRoutePath
 from vpp_papi import VppEnum
 
 
+# NAT44-ED HA protocol event data
+class Event(Packet):
+    name = "Event"
+    fields_desc = [ByteEnumField("event_type", None,
+                                 {1: "add", 2: "del", 3: "refresh"}),
+                   ByteEnumField("protocol", None,
+                                 {1: "icmp", 6: "tcp", 17: "udp"}),
+                   ShortField("flags", 0),
+                   IPField("in_addr", None),
+                   IPField("out_addr", None),
+                   ShortField("in_port", None),
+                   ShortField("out_port", None),
+                   IPField("eh_addr", None),
+                   IPField("ehn_addr", None),
+                   ShortField("eh_port", None),
+                   ShortField("ehn_port", None),
+                   IntField("fib_index", None),
+                   IntField("out_fib_index", None),
+                   IntField("total_pkts", 0),
+                   LongField("total_bytes", 0),
+                   ByteField("state", 0),
+                   StrFixedLenField("reserved", b"\x00" * 3, 3)]
+
+    def extract_padding(self, s):
+        return "", s
+
+
+# NAT44-ED HA protocol header
+class HANATStateSync(Packet):
+    name = "HA NAT state sync"
+    fields_desc = [XByteField("version", 2),
+                   FlagsField("flags", 0, 8, ['ACK']),
+                   FieldLenField("count", None, count_of="events"),
+                   IntField("sequence_number", 1),
+                   IntField("thread_index", 0),
+                   PacketListField("events", [], Event,
+                                   count_from=lambda pkt: pkt.count)]
+
+
 class TestNAT44ED(VppTestCase):
     """ NAT44ED Test Case """
 
@@ -2151,6 +2193,208 @@ class TestNAT44ED(VppTestCase):
                 "Invalid packet (src IP %s translated to %s, but expected %s)"
                 % (p_sent[IP].src, p_recvd[IP].src, a))
 
+    def test_outside_port_allocation(self):
+        """ Outside ports handed out and returned per pool address """
+
+        x = 10
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+
+        self.pg0.generate_remote_hosts(x)
+
+        # same source port and destination for every host, so each
+        # session needs an outside port of its own
+        pkts = []
+        for i in range(x):
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_hosts[i].ip4,
+                    dst=self.pg1.remote_ip4) /
+                 UDP(sport=5000, dport=6000))
+            pkts.append(p)
+
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        ports = set(p[UDP].sport for p in capture)
+        self.assertEqual(len(ports), x)
+        self.assertIn(5000, ports)
+
+        addresses = self.vapi.cli("show nat44 addresses")
+        self.logger.info(addresses)
+        self.assertIn("%d busy udp ports" % x, addresses)
+
+        self.vapi.nat44_del_session(
+            address=self.pg0.remote_hosts[0].ip4,
+            port=5000,
+            protocol=IP_PROTOS.udp,
+            flags=(self.config_flags.NAT_IS_INSIDE |
+                   self.config_flags.NAT_IS_EXT_HOST_VALID),
+            ext_host_address=self.pg1.remote_ip4,
+            ext_host_port=6000)
+
+        addresses = self.vapi.cli("show nat44 addresses")
+        self.assertIn("%d busy udp ports" % (x - 1), addresses)
+
+    def test_outside_port_shared(self):
+        """ Outside port shared between destinations stays busy """
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+
+        # one source port to two destination ports: without workers both
+        # sessions keep the suggested outside port 5000
+        pkts = []
+        for dport in (6000, 6001):
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=5000, dport=dport))
+            pkts.append(p)
+
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        ports = set(p[UDP].sport for p in capture)
+        if self.vpp_worker_count == 0:
+            self.assertEqual(ports, {5000})
+
+        addresses = self.vapi.cli("show nat44 addresses")
+        self.assertIn("%d busy udp ports" % len(ports), addresses)
+
+        for dport, busy in ((6000, 1), (6001, 0)):
+            self.vapi.nat44_del_session(
+                address=self.pg0.remote_ip4,
+                port=5000,
+                protocol=IP_PROTOS.udp,
+                flags=(self.config_flags.NAT_IS_INSIDE |
+                       self.config_flags.NAT_IS_EXT_HOST_VALID),
+                ext_host_address=self.pg1.remote_ip4,
+                ext_host_port=dport)
+
+            addresses = self.vapi.cli("show nat44 addresses")
+            self.logger.info(addresses)
+            self.assertIn("%d busy udp ports" % busy, addresses)
+
+    def test_ha_sync(self):
+        """ NAT44ED HA session synchronization (active and standby) """
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+
+        self.vapi.nat_ha_set_listener(
+            ip_address=self.pg3.local_ip4, port=12345, path_mtu=512)
+        self.vapi.nat_ha_set_failover(
+            ip_address=self.pg3.remote_ip4, port=12346,
+            session_refresh_interval=10)
+        bind_layers(UDP, HANATStateSync, sport=12345)
+
+        # create sessions
+        pkts = self.create_stream_in(self.pg0, self.pg1)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        self.verify_capture_out(capture, ignore_port=True)
+
+        # active sends one message with an add event per session
+        self.vapi.nat_ha_flush()
+        capture = self.pg3.get_capture(1)
+        sync = capture[0]
+        self.assert_packet_checksums_valid(sync)
+        try:
+            ip = sync[IP]
+            udp = sync[UDP]
+            hanat = sync[HANATStateSync]
+        except IndexError:
+            self.logger.error(ppp("Invalid packet:", sync))
+            raise
+        else:
+            self.assertEqual(ip.src, self.pg3.local_ip4)
+            self.assertEqual(ip.dst, self.pg3.remote_ip4)
+            self.assertEqual(udp.sport, 12345)
+            self.assertEqual(udp.dport, 12346)
+            self.assertEqual(hanat.version, 2)
+            self.assertEqual(hanat.count, 3)
+            for event in hanat.events:
+                self.assertEqual(event.event_type, 1)
+                self.assertEqual(event.in_addr, self.pg0.remote_ip4)
+                self.assertEqual(event.out_addr, self.nat_addr)
+                self.assertEqual(event.eh_addr, self.pg1.remote_ip4)
+                self.assertEqual(event.ehn_addr, self.pg1.remote_ip4)
+                self.assertEqual(event.fib_index, 0)
+        stats = self.statistics['/nat44-ed/ha/add-event-send']
+        self.assertEqual(stats[:, 0].sum(), 3)
+
+        ack = (Ether(dst=self.pg3.local_mac, src=self.pg3.remote_mac) /
+               IP(src=self.pg3.remote_ip4, dst=self.pg3.local_ip4) /
+               UDP(sport=12346, dport=12345) /
+               HANATStateSync(sequence_number=hanat.sequence_number,
+                              flags='ACK', thread_index=hanat.thread_index))
+        self.pg3.add_stream(ack)
+        self.pg_start()
+        stats = self.statistics['/nat44-ed/ha/ack-recv']
+        self.assertEqual(stats[:, 0].sum(), 1)
+
+        # refreshes are coalesced, one event per session per interval
+        self.virtual_sleep(11)
+        pkts = self.create_stream_out(self.pg1)
+        self.pg1.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg0.get_capture(len(pkts))
+        self.vapi.nat_ha_flush()
+        capture = self.pg3.get_capture(1)
+        hanat = capture[0][HANATStateSync]
+        self.assertEqual(hanat.count, 3)
+        for event in hanat.events:
+            self.assertEqual(event.event_type, 3)
+            self.assertEqual(event.out_addr, self.nat_addr)
+            self.assertGreater(event.total_pkts, 1)
+        stats = self.statistics['/nat44-ed/ha/refresh-event-send']
+        self.assertEqual(stats[:, 0].sum(), 3)
+
+        # a fresh instance acting as standby learns the sessions
+        self.plugin_disable()
+        self.plugin_enable()
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+        self.vapi.nat_ha_set_listener(
+            ip_address=self.pg3.local_ip4, port=12345, path_mtu=512)
+
+        p = (Ether(dst=self.pg3.local_mac, src=self.pg3.remote_mac) /
+             IP(src=self.pg3.remote_ip4, dst=self.pg3.local_ip4) /
+             UDP(sport=12346, dport=12345) /
+             sync[HANATStateSync])
+        self.pg3.add_stream(p)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg3.get_capture(1)
+        ack = capture[0][HANATStateSync]
+        self.assertEqual(ack.flags, 'ACK')
+        self.assertEqual(ack.count, 0)
+        self.assertEqual(ack.sequence_number,
+                         sync[HANATStateSync].sequence_number)
+        stats = self.statistics['/nat44-ed/ha/add-event-recv']
+        self.assertEqual(stats[:, 0].sum(), 3)
+        sessions = self.statistics['/nat44-ed/total-sessions']
+        self.assertEqual(sessions[:, 0].sum(), 3)
+
+        # replicated sessions translate without the inside sending first
+        pkts = self.create_stream_out(self.pg1)
+        self.pg1.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg0.get_capture(len(pkts))
+        self.verify_capture_in(capture, self.pg0)
+
+        self.vapi.nat_ha_set_listener(
+            ip_address=self.pg3.local_ip4, port=0, path_mtu=512)
+
 
 class TestNAT44EDMW(TestNAT44ED):
     """ NAT44ED MW Test Case """
@@ -2534,6 +2778,220 @@ class TestNAT44EDMW(TestNAT44ED):
         self.pg_start()
         self.pg1.get_capture(len(pkts))
 
+    def test_session_expire_walk(self):
+        """ NAT44ED idle sessions expire without table pressure """
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+
+        self.vapi.nat_set_timeouts(
+            udp=2, tcp_established=7440, tcp_transitory=240, icmp=60)
+
+        pkts = []
+        for i in range(0, 10):
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=7000+i, dport=80))
+            pkts.append(p)
+
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(len(pkts))
+
+        sessions = self.statistics['/nat44-ed/total-sessions']
+        self.assertEqual(sessions[:, 0].sum(), len(pkts))
+
+        err_old = self.statistics.get_err_counter(
+            '/err/nat44-ed-expire-worker-walk/sessions expired')
+        self.virtual_sleep(3, "wait for timeouts")
+
+        for i in range(0, 10):
+            sessions = self.statistics['/nat44-ed/total-sessions']
+            if sessions[:, 0].sum() == 0:
+                break
+            self.sleep(0.5, "wait for expire walk")
+        self.assertEqual(sessions[:, 0].sum(), 0)
+
+        err_new = self.statistics.get_err_counter(
+            '/err/nat44-ed-expire-worker-walk/sessions expired')
+        self.assertEqual(err_new - err_old, len(pkts))
+
+    def test_flow_hash_resize(self):
+        """ NAT44ED flow hash resize keeps sessions """
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+
+        pkts = []
+        for i in range(0, 10):
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=7000+i, dport=80))
+            pkts.append(p)
+
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        ports = sorted(p[UDP].sport for p in capture)
+
+        err_old = self.statistics.get_err_counter(
+            '/err/nat44-ed-flow-hash-migrate/'
+            'flows moved to the resized flow hash')
+
+        self.vapi.cli("set nat44 session limit %d" % (self.max_sessions * 64))
+        for i in range(0, 10):
+            if "resize in progress" not in \
+                    self.vapi.cli("show nat44 hash tables"):
+                break
+            self.sleep(0.5, "wait for flow hash migration")
+        self.logger.info(self.vapi.cli("show nat44 hash tables"))
+        self.assertNotIn("resize in progress",
+                         self.vapi.cli("show nat44 hash tables"))
+
+        # both flows of every session were moved
+        err_new = self.statistics.get_err_counter(
+            '/err/nat44-ed-flow-hash-migrate/'
+            'flows moved to the resized flow hash')
+        self.assertEqual(err_new - err_old, 2 * len(pkts))
+
+        # existing sessions keep translating on the same ports
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        self.assertEqual(sorted(p[UDP].sport for p in capture), ports)
+
+        sessions = self.statistics['/nat44-ed/total-sessions']
+        self.assertEqual(sessions[:, 0].sum(), len(pkts))
+
+    def test_rss_port_selection(self):
+        """ NAT44ED RSS-aware outside port selection """
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+
+        self.vapi.cli("nat44 rss outside-interface %s reta-size 64" %
+                      self.pg1.name)
+        self.logger.info(self.vapi.cli("show nat44 rss"))
+
+        steered1 = self.statistics['/nat44-ed/rss/port-steered']
+        missed1 = self.statistics['/nat44-ed/rss/port-missed']
+        same1 = self.statistics['/nat44-ed/handoff/in2out/same_worker']
+        handoff1 = self.statistics['/nat44-ed/handoff/in2out/do_handoff']
+
+        pkts = [[] for x in range(0, self.vpp_worker_count)]
+        for i in range(0, 40):
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=7000 + i, dport=80))
+            pkts[i % self.vpp_worker_count].append(p)
+        for i in range(0, self.vpp_worker_count):
+            self.pg0.add_stream(pkts[i], worker=i)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(40)
+
+        # every new session went through RSS-aware port selection
+        steered2 = self.statistics['/nat44-ed/rss/port-steered']
+        missed2 = self.statistics['/nat44-ed/rss/port-missed']
+        self.assertEqual(steered2[:, 0].sum() - steered1[:, 0].sum() +
+                         missed2[:, 0].sum() - missed1[:, 0].sum(), 40)
+
+        same2 = self.statistics['/nat44-ed/handoff/in2out/same_worker']
+        handoff2 = self.statistics['/nat44-ed/handoff/in2out/do_handoff']
+        self.assertEqual(same2[:, 0].sum() - same1[:, 0].sum() +
+                         handoff2[:, 0].sum() - handoff1[:, 0].sum(), 40)
+
+        # return traffic is translated whichever thread receives it
+        pkts = []
+        for p in capture:
+            pkts.append(
+                Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                IP(src=self.pg1.remote_ip4, dst=self.nat_addr) /
+                UDP(sport=80, dport=p[UDP].sport))
+        self.pg1.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg0.get_capture(40)
+        self.assertEqual(sorted(p[UDP].dport for p in capture),
+                         list(range(7000, 7040)))
+
+        self.vapi.cli("nat44 rss disable")
+        self.assertIn("disabled", self.vapi.cli("show nat44 rss"))
+
+    def test_ha_recv_known_flow(self):
+        """ NAT44ED HA add event for a flow owned by another worker """
+
+        self.nat_add_address(self.nat_addr)
+        self.nat_add_inside_interface(self.pg0)
+        self.nat_add_outside_interface(self.pg1)
+        self.vapi.nat_ha_set_listener(
+            ip_address=self.pg3.local_ip4, port=12345, path_mtu=512)
+
+        p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+             IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+             UDP(sport=self.udp_port_in, dport=20))
+        self.pg0.add_stream(p)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(1)
+        out_port = capture[0][UDP].sport
+
+        # the same flow announced by every worker of the peer, only the
+        # owner knows it, the others must keep its keys
+        event = Event(event_type='add', protocol='udp',
+                      in_addr=self.pg0.remote_ip4, out_addr=self.nat_addr,
+                      in_port=self.udp_port_in, out_port=out_port,
+                      eh_addr=self.pg1.remote_ip4,
+                      ehn_addr=self.pg1.remote_ip4, eh_port=20, ehn_port=20,
+                      fib_index=0, out_fib_index=0)
+        pkts = []
+        for i in range(self.vpp_worker_count):
+            pkts.append(
+                Ether(dst=self.pg3.local_mac, src=self.pg3.remote_mac) /
+                IP(src=self.pg3.remote_ip4, dst=self.pg3.local_ip4) /
+                UDP(sport=12346, dport=12345) /
+                HANATStateSync(sequence_number=i + 1, thread_index=i + 1,
+                               events=[event]))
+        self.pg3.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg3.get_capture(len(pkts))
+        sessions = self.statistics['/nat44-ed/total-sessions']
+        self.assertEqual(sessions[:, 0].sum(), 1)
+
+        # return traffic still reaches the session of the owner
+        p = (Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+             IP(src=self.pg1.remote_ip4, dst=self.nat_addr) /
+             UDP(sport=20, dport=out_port))
+        self.pg1.add_stream(p)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg0.get_capture(1)
+        self.assertEqual(capture[0][UDP].dport, self.udp_port_in)
+
+        # a message shorter than the header is dropped without an ACK
+        err = self.get_err_counter('/err/nat44-ed-ha/truncated message')
+        p = (Ether(dst=self.pg3.local_mac, src=self.pg3.remote_mac) /
+             IP(src=self.pg3.remote_ip4, dst=self.pg3.local_ip4) /
+             UDP(sport=12346, dport=12345) /
+             Raw(b"\x02\x01\x00\x00"))
+        self.pg3.add_stream(p)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg3.assert_nothing_captured()
+        self.assertEqual(
+            self.get_err_counter('/err/nat44-ed-ha/truncated message'),
+            err + 1)
+
+        self.vapi.nat_ha_set_listener(
+            ip_address=self.pg3.local_ip4, port=0, path_mtu=512)
+
     def test_session_rst_timeout(self):
         """ NAT44ED session RST timeouts """
 
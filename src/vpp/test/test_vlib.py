@@ -208,6 +208,8 @@ class TestVlib(VppTestCase):
         """ Fixed-size Pool Test """
 
         cmds = ["test pool",
+                "test chunk-pool",
+                "test chunk-pool elts 3",
                 ]
 
         for cmd in cmds:
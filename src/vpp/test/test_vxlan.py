@@ -9,12 +9,12 @@ from template_bd import BridgeDomain
 from scapy.layers.l2 import Ether
 from scapy.layers.l2 import ARP
 from scapy.packet import Raw, bind_layers
-from scapy.layers.inet import IP, UDP
+from scapy.layers.inet import IP, UDP, TCP
 from scapy.layers.vxlan import VXLAN
 
 import util
 from vpp_ip_route import VppIpRoute, VppRoutePath
-from vpp_vxlan_tunnel import VppVxlanTunnel
+from vpp_vxlan_tunnel import VppVxlanTunnel, find_vxlan_tunnel
 from vpp_ip import INVALID_INDEX
 from vpp_neighbor import VppNeighbor
 
@@ -319,6 +319,69 @@ class TestVxlan(BridgeDomain, VppTestCase):
         self.createVxLANInterfaces()
         super(TestVxlan, self).test_mcast_rcv()
 
+    def test_decap_many_tunnels(self):
+        """ Decapsulation test, many tunnels and flows
+        Send frames of several tunnels with varying UDP source ports
+        Verify a deleted tunnel no longer decapsulates
+        """
+        self.createVxLANInterfaces()
+        vni = self.ucast_flood_bd
+
+        def encap(rip, n_flows):
+            return [(Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+                     IP(src=rip, dst=self.pg0.local_ip4) /
+                     UDP(sport=10000 + i, dport=self.dport, chksum=0) /
+                     VXLAN(vni=vni, flags=self.flags) /
+                     self.frame_request)
+                    for i in range(n_flows)]
+
+        pkts = []
+        for rip in self.ip_range(10, 10 + self.n_ucast_tunnels):
+            pkts += encap(rip, 8)
+        self.send_and_expect(self.pg0, pkts, self.pg3)
+
+        rip = next(self.ip_range(40, 41))
+        r = VppVxlanTunnel(self, src=self.pg0.local_ip4, dst=rip,
+                           src_port=self.dport, dst_port=self.dport, vni=vni)
+        r.add_vpp_config()
+        self.vapi.sw_interface_set_l2_bridge(rx_sw_if_index=r.sw_if_index,
+                                             bd_id=vni)
+        pkts = encap(rip, 8)
+        self.send_and_expect(self.pg0, pkts, self.pg3)
+
+        # the tunnel must not be found in the workers' caches
+        r.remove_vpp_config()
+        self.send_and_assert_no_replies(self.pg0, pkts)
+        self.assertEqual(
+            self.statistics.get_err_counter(
+                "/err/vxlan4-input/no such tunnel packets"), len(pkts))
+
+    def test_decap_gro(self):
+        """ Decapsulation test with GRO
+        Send encapsulated TCP segments of a flow from pg0
+        Verify receipt of one coalesced frame on pg1
+        """
+        self.createVxLANInterfaces()
+        sw_if_index = find_vxlan_tunnel(self, self.pg0.local_ip4,
+                                        self.pg0.remote_ip4, self.dport,
+                                        self.dport, self.single_tunnel_vni)
+        self.vapi.vxlan_set_gro(sw_if_index=sw_if_index)
+
+        n_segs = 8
+        pkts = [self.encapsulate(
+            Ether(src='00:00:00:00:00:02', dst='00:00:00:00:00:01') /
+            IP(src='4.3.2.1', dst='1.2.3.4') /
+            TCP(sport=1234, dport=80, flags='A', seq=1000 + i * 1000) /
+            Raw(b'\xa5' * 1000), self.single_tunnel_vni)
+            for i in range(n_segs)]
+
+        rx = self.send_and_expect(self.pg0, pkts, self.pg1, n_rx=1)
+        self.assertEqual(rx[0][TCP].seq, 1000)
+        self.assertEqual(rx[0][IP].len, 40 + n_segs * 1000)
+
+        self.vapi.vxlan_set_gro(sw_if_index=sw_if_index, enable=False)
+        self.send_and_expect(self.pg0, pkts, self.pg1, n_rx=n_segs)
+
     """
     Tests with custom port
     """
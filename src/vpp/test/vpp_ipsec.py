@@ -195,7 +195,8 @@ class VppIpsecSA(VppObject):
                  tun_src=None, tun_dst=None,
                  flags=None, salt=0, tun_flags=None,
                  dscp=None,
-                 udp_src=None, udp_dst=None, hop_limit=None):
+                 udp_src=None, udp_dst=None, hop_limit=None,
+                 anti_replay_window_size=None):
         e = VppEnum.vl_api_ipsec_sad_flags_t
         self.test = test
         self.id = id
@@ -231,6 +232,7 @@ class VppIpsecSA(VppObject):
         self.hop_limit = 255
         if hop_limit:
             self.hop_limit = hop_limit
+        self.anti_replay_window_size = anti_replay_window_size
 
     def tunnel_encode(self):
         return {'src': (self.tun_src if self.tun_src else []),
@@ -265,7 +267,9 @@ class VppIpsecSA(VppObject):
             entry['udp_src_port'] = self.udp_src
         if self.udp_dst:
             entry['udp_dst_port'] = self.udp_dst
-        r = self.test.vapi.ipsec_sad_entry_add(entry=entry)
+        if self.anti_replay_window_size:
+            entry['anti_replay_window_size'] = self.anti_replay_window_size
+        r = self.test.vapi.ipsec_sad_entry_add_v2(entry=entry)
         self.stat_index = r.stat_index
         self.test.registry.register(self, self.test.logger)
         return self
@@ -279,9 +283,14 @@ class VppIpsecSA(VppObject):
     def query_vpp_config(self):
         e = VppEnum.vl_api_ipsec_sad_flags_t
 
-        bs = self.test.vapi.ipsec_sa_v3_dump()
+        bs = self.test.vapi.ipsec_sa_v4_dump()
         for b in bs:
             if b.entry.sad_id == self.id:
+                if (self.anti_replay_window_size and
+                        (self.flags & e.IPSEC_API_SAD_FLAG_USE_ANTI_REPLAY)):
+                    if (b.entry.anti_replay_window_size <
+                            self.anti_replay_window_size):
+                        return False
                 # if udp encap is configured then the ports should match
                 # those configured or the default
                 if (self.flags & e.IPSEC_API_SAD_FLAG_UDP_ENCAP):